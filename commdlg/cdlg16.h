@@ -157,7 +157,7 @@ short WINAPI GetFileTitle16(LPCSTR lpFile, LPSTR lpTitle, UINT16 cbBuf);
 BOOL16 CALLBACK PrintDlgProc16(HWND16 hDlg16, UINT16 uMsg, WPARAM16 wParam, LPARAM lParam);
 BOOL16 CALLBACK PrintSetupDlgProc16(HWND16 hWnd16, UINT16 wMsg, WPARAM16 wParam, LPARAM lParam);
 
-typedef struct
+typedef struct tagCOMMDLGTHUNK
 {
     BYTE pop_eax;   //58
     BYTE push;      //68
@@ -167,7 +167,6 @@ typedef struct
     DWORD address;
     BYTE jmp;       //FF E0
     BYTE eax;       //E0
-    BOOL used;
     SEGPTR segofn16;
     SEGPTR func;
     union
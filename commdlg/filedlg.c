@@ -29,14 +29,26 @@
 #include "winternl.h"
 #include "commdlg.h"
 #include "cdlg16.h"
+#include "thunkpool.h"
 #include "wine/debug.h"
 #include <windows.h>
 #include "resource.h"
 #include <DbgHelp.h>
 
 WINE_DEFAULT_DEBUG_CHANNEL(commdlg);
-#define MAX_THUNK 5
-COMMDLGTHUNK *thunk_array;
+
+/* hook thunks, pool accesses are serialized by thunk_cs */
+static struct thunk_pool thunk_pool = { sizeof(COMMDLGTHUNK) };
+
+static CRITICAL_SECTION thunk_cs;
+static CRITICAL_SECTION_DEBUG thunk_cs_debug =
+{
+    0, 0, &thunk_cs,
+    { &thunk_cs_debug.ProcessLocksList, &thunk_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": thunk_cs") }
+};
+static CRITICAL_SECTION thunk_cs = { &thunk_cs_debug, -1, 0, 0, 0, 0 };
+
 UINT WMFILEOK;
 UINT WMHELPMSG;
 UINT WMFINDMSG;
@@ -61,7 +73,7 @@ static UINT_PTR CALLBACK thunk_hook(COMMDLGTHUNK *thunk, HWND hwnd, UINT msg, WP
 
 static void init_thunk()
 {
-    if (thunk_array)
+    if (WMFILEOK)
         return;
     WMFILEOK = RegisterWindowMessageW(FILEOKSTRINGW);
     WMHELPMSG = RegisterWindowMessageW(HELPMSGSTRINGW);
@@ -70,39 +82,53 @@ static void init_thunk()
     WMSHAREVI = RegisterWindowMessageW(SHAREVISTRINGW);
     /* undocumented */
     WMWOWDirChange = RegisterWindowMessageW(L"WOWDirChange");
-    thunk_array = VirtualAlloc(NULL, MAX_THUNK * sizeof(COMMDLGTHUNK), MEM_COMMIT, PAGE_EXECUTE_READWRITE);
 }
 
 void delete_thunk(LPVOID func)
 {
-    if (func && (SIZE_T)thunk_array <= (SIZE_T)func && (SIZE_T)func <= (SIZE_T)(thunk_array + MAX_THUNK))
+    UINT used, capacity;
+
+    if (!func)
+        return;
+
+    EnterCriticalSection(&thunk_cs);
+    if (thunk_pool_free(&thunk_pool, func))
     {
-        ((COMMDLGTHUNK*)func)->used = FALSE;
+        thunk_pool_usage(&thunk_pool, &used, &capacity);
+        TRACE("released %p, %u of %u thunks in use\n", func, used, capacity);
     }
+    LeaveCriticalSection(&thunk_cs);
 }
 
 COMMDLGTHUNK *allocate_thunk(SEGPTR ofnseg, SEGPTR func)
 {
+    COMMDLGTHUNK *thunk;
+    UINT used, capacity;
+
     init_thunk();
-    for (int i = 0; i < MAX_THUNK; i++)
+
+    EnterCriticalSection(&thunk_cs);
+    thunk = thunk_pool_alloc(&thunk_pool);
+    thunk_pool_usage(&thunk_pool, &used, &capacity);
+    LeaveCriticalSection(&thunk_cs);
+    if (!thunk)
     {
-        if (!thunk_array[i].used)
-        {
-            thunk_array[i].pop_eax  = 0x58;
-            thunk_array[i].push     = 0x68;
-            thunk_array[i].this_    = (DWORD)(thunk_array + i);
-            thunk_array[i].push_eax = 0x50;
-            thunk_array[i].mov_eax  = 0xB8;
-            thunk_array[i].address  = (DWORD)thunk_hook;
-            thunk_array[i].jmp      = 0xFF;
-            thunk_array[i].eax      = 0xE0;
-            thunk_array[i].used     = TRUE;
-            thunk_array[i].func     = func;
-            thunk_array[i].segofn16 = ofnseg;
-            return thunk_array + i;
-        }
+        ERR("out of memory, %u thunks in use\n", used);
+        return NULL;
     }
-    return NULL;
+
+    thunk->pop_eax   = 0x58;
+    thunk->push      = 0x68;
+    thunk->this_     = (DWORD)thunk;
+    thunk->push_eax  = 0x50;
+    thunk->mov_eax   = 0xB8;
+    thunk->address   = (DWORD)thunk_hook;
+    thunk->jmp       = 0xFF;
+    thunk->eax       = 0xE0;
+    thunk->func      = func;
+    thunk->segofn16  = ofnseg;
+    TRACE("allocated %p, %u of %u thunks in use\n", thunk, used, capacity);
+    return thunk;
 }
 
 
@@ -288,13 +314,14 @@ BOOL16 WINAPI GetOpenFileName16( SEGPTR ofn ) /* [in/out] address of structure w
 
     if (lpofn->Flags & OFN_ENABLEHOOK)
     {
-        ofn32.lpfnHook = (LPOFNHOOKPROC)allocate_thunk(ofn, (SEGPTR)lpofn->lpfnHook);
-        ((COMMDLGTHUNK*)ofn32.lpfnHook)->ofn16 = ofn16;
-        if (!ofn32.lpfnHook)
+        COMMDLGTHUNK *thunk = allocate_thunk(ofn, (SEGPTR)lpofn->lpfnHook);
+        if (thunk)
         {
-            ERR("could not allocate GetOpenFileName16 thunk\n");
-            ofn32.lpfnHook = dummy_hook;
+            thunk->ofn16 = ofn16;
+            ofn32.lpfnHook = (LPOFNHOOKPROC)thunk;
         }
+        else
+            ERR("could not allocate GetOpenFileName16 thunk\n");
     }
 
     if (ofn32.lpstrFile && ofn32.lpstrFile[0])
@@ -379,13 +406,14 @@ BOOL16 WINAPI GetSaveFileName16( SEGPTR ofn ) /* [in/out] address of structure w
 
     if (lpofn->Flags & OFN_ENABLEHOOK)
     {
-        ofn32.lpfnHook = (LPOFNHOOKPROC)allocate_thunk(ofn, (SEGPTR)lpofn->lpfnHook);
-        ((COMMDLGTHUNK*)ofn32.lpfnHook)->ofn16 = ofn16;
-        if (!ofn32.lpfnHook)
+        COMMDLGTHUNK *thunk = allocate_thunk(ofn, (SEGPTR)lpofn->lpfnHook);
+        if (thunk)
         {
-            ERR("could not allocate GetOpenFileName16 thunk\n");
-            ofn32.lpfnHook = dummy_hook;
+            thunk->ofn16 = ofn16;
+            ofn32.lpfnHook = (LPOFNHOOKPROC)thunk;
         }
+        else
+            ERR("could not allocate GetSaveFileName16 thunk\n");
     }
     if (ofn32.lpstrFile && ofn32.lpstrFile[0])
         CharUpperBuffA(ofn32.lpstrFile, min(strlen(ofn32.lpstrFile), ofn32.nMaxFile));
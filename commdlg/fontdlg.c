@@ -116,11 +116,21 @@ BOOL16 WINAPI ChooseFont16(SEGPTR cf)
     if (lpChFont->Flags & CF_ENABLEHOOK)
     {
         COMMDLGTHUNK *thunk = allocate_thunk(cf, (SEGPTR)lpChFont->lpfnHook);
-        cf32.Flags |= CF_ENABLEHOOK;
-        cf32.lpfnHook = (LPCFHOOKPROC)thunk;
+        if (thunk)
+        {
+            cf32.Flags |= CF_ENABLEHOOK;
+            cf32.lpfnHook = (LPCFHOOKPROC)thunk;
+        }
+        else
+            ERR("could not allocate ChooseFont16 thunk\n");
     }
 
-    if (!ChooseFontA( &cf32 )) return FALSE;
+    if (!ChooseFontA( &cf32 ))
+    {
+        delete_thunk(cf32.lpfnHook);
+        HeapFree(GetProcessHeap(), 0, template);
+        return FALSE;
+    }
 
     lpChFont->iPointSize = cf32.iPointSize;
     lpChFont->Flags = cf32.Flags;
@@ -256,14 +256,24 @@ BOOL16 WINAPI PrintDlg16( SEGPTR pd )
     if (lppd->Flags & PD_ENABLEPRINTHOOK)
     {
         COMMDLGTHUNK *thunk = allocate_thunk(pd, (SEGPTR)lppd->lpfnPrintHook);
-        pd32.Flags |= PD_ENABLEPRINTHOOK;
-        pd32.lpfnPrintHook = (LPPRINTHOOKPROC)thunk;
+        if (thunk)
+        {
+            pd32.Flags |= PD_ENABLEPRINTHOOK;
+            pd32.lpfnPrintHook = (LPPRINTHOOKPROC)thunk;
+        }
+        else
+            ERR("could not allocate PrintDlg16 print hook thunk\n");
     }
     if (lppd->Flags & PD_ENABLESETUPHOOK)
     {
         COMMDLGTHUNK *thunk = allocate_thunk(pd, (SEGPTR)lppd->lpfnSetupHook);
-        pd32.Flags |= PD_ENABLESETUPHOOK;
-        pd32.lpfnSetupHook = (LPSETUPHOOKPROC)thunk;
+        if (thunk)
+        {
+            pd32.Flags |= PD_ENABLESETUPHOOK;
+            pd32.lpfnSetupHook = (LPSETUPHOOKPROC)thunk;
+        }
+        else
+            ERR("could not allocate PrintDlg16 setup hook thunk\n");
     }
 
     /* Generate failure with CDERR_STRUCTSIZE, when needed */
@@ -0,0 +1,148 @@
+/*
+ * Pool of executable thunks
+ *
+ * Copyright 1994 Martin Ayotte
+ * Copyright 1996 Albrecht Kleine
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Thunks are carved out of executable pages that are added as needed.
+ * Free thunks are chained through their first bytes, which are copied
+ * as packed thunks need not be aligned. Pages are kept until the process
+ * exits. Only pointers to thunks handed out by a pool can be freed to
+ * it, so callers may pass any hook address.
+ *
+ * Nothing here knows what a thunk contains, so filedlg.c writes the code
+ * and does the locking.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "thunkpool.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(commdlg);
+
+static inline UINT thunks_per_page( const struct thunk_pool *pool )
+{
+    return THUNK_PAGE_SIZE / pool->thunk_size;
+}
+
+/* add a page of thunks to the free list */
+static BOOL grow_thunk_pool( struct thunk_pool *pool )
+{
+    UINT per_page = thunks_per_page( pool ), i;
+    BYTE **pages, *used, *page;
+
+    if (pool->pages)
+        pages = HeapReAlloc( GetProcessHeap(), 0, pool->pages, (pool->page_count + 1) * sizeof(*pages) );
+    else
+        pages = HeapAlloc( GetProcessHeap(), 0, sizeof(*pages) );
+    if (!pages)
+        return FALSE;
+    pool->pages = pages;
+
+    if (pool->used)
+        used = HeapReAlloc( GetProcessHeap(), 0, pool->used, (pool->page_count + 1) * per_page );
+    else
+        used = HeapAlloc( GetProcessHeap(), 0, per_page );
+    if (!used)
+        return FALSE;
+    pool->used = used;
+
+    if (!(page = VirtualAlloc( NULL, THUNK_PAGE_SIZE, MEM_COMMIT, PAGE_EXECUTE_READWRITE )))
+        return FALSE;
+    memset( pool->used + pool->page_count * per_page, 0, per_page );
+    pool->pages[pool->page_count++] = page;
+
+    for (i = per_page; i > 0; i--)
+    {
+        void *thunk = page + (i - 1) * pool->thunk_size;
+
+        memcpy( thunk, &pool->free_list, sizeof(pool->free_list) );
+        pool->free_list = thunk;
+    }
+    TRACE( "grown to %u thunks in %u pages\n", pool->page_count * per_page, pool->page_count );
+    return TRUE;
+}
+
+/* index of the thunk at ptr, -1 if ptr is not a thunk of the pool */
+static int find_thunk( const struct thunk_pool *pool, const void *ptr )
+{
+    UINT per_page = thunks_per_page( pool ), i;
+
+    for (i = 0; i < pool->page_count; i++)
+    {
+        SIZE_T offset = (const BYTE *)ptr - pool->pages[i];
+
+        if (offset < per_page * pool->thunk_size && !(offset % pool->thunk_size))
+            return i * per_page + offset / pool->thunk_size;
+    }
+    return -1;
+}
+
+/***********************************************************************
+ *           thunk_pool_alloc
+ *
+ * A thunk of thunk_size bytes of executable memory, NULL if the pool
+ * can't grow.
+ */
+void *thunk_pool_alloc( struct thunk_pool *pool )
+{
+    void *thunk;
+
+    if (!pool->free_list && !grow_thunk_pool( pool ))
+        return NULL;
+    thunk = pool->free_list;
+    memcpy( &pool->free_list, thunk, sizeof(pool->free_list) );
+    pool->used[find_thunk( pool, thunk )] = TRUE;
+    pool->used_count++;
+    return thunk;
+}
+
+/***********************************************************************
+ *           thunk_pool_free
+ *
+ * Put a thunk back on the free list. FALSE if thunk is not one handed
+ * out by the pool and still in use.
+ */
+BOOL thunk_pool_free( struct thunk_pool *pool, void *thunk )
+{
+    int index = find_thunk( pool, thunk );
+
+    if (index < 0 || !pool->used[index])
+        return FALSE;
+    pool->used[index] = FALSE;
+    memcpy( thunk, &pool->free_list, sizeof(pool->free_list) );
+    pool->free_list = thunk;
+    pool->used_count--;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           thunk_pool_usage
+ *
+ * Number of thunks in use and in the pages of the pool.
+ */
+void thunk_pool_usage( const struct thunk_pool *pool, UINT *used, UINT *capacity )
+{
+    *used = pool->used_count;
+    *capacity = pool->page_count * thunks_per_page( pool );
+}
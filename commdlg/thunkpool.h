@@ -0,0 +1,44 @@
+/*
+ * Pool of executable thunks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_THUNKPOOL_H
+#define __WINE_THUNKPOOL_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+
+#define THUNK_PAGE_SIZE 0x1000
+
+/* initialize with { size }, size is at least that of a pointer */
+struct thunk_pool
+{
+    SIZE_T thunk_size;
+    void  *free_list;   /* chained through the first bytes of the free thunks */
+    BYTE **pages;
+    BYTE  *used;        /* one flag per thunk, page by page */
+    UINT   page_count;
+    UINT   used_count;
+};
+
+extern void *thunk_pool_alloc( struct thunk_pool *pool ) DECLSPEC_HIDDEN;
+extern BOOL thunk_pool_free( struct thunk_pool *pool, void *thunk ) DECLSPEC_HIDDEN;
+extern void thunk_pool_usage( const struct thunk_pool *pool, UINT *used, UINT *capacity ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_THUNKPOOL_H */
@@ -803,10 +803,10 @@ HRESULT WINAPI CLSIDFromProgID16(LPCOLESTR16 progid, LPCLSID riid)
 	HeapFree(GetProcessHeap(),0,buf);
 	buf2len = sizeof(buf2);
 	if (RegQueryValue16(xhkey,NULL,buf2,&buf2len)) {
-		RegCloseKey(xhkey);
+		RegCloseKey16(xhkey);
                 return CO_E_CLASSSTRING;
 	}
-	RegCloseKey(xhkey);
+	RegCloseKey16(xhkey);
 	return CLSIDFromString16(buf2,riid);
 }
 
@@ -35,6 +35,7 @@
 #if 0
 #include "wine/gdi_driver.h"
 #endif
+#include "textcache.h"
 #include "wine/debug.h"
 #include "wine/exception.h"
 #define STRSAFE_NO_DEPRECATE
@@ -917,6 +918,7 @@ INT16 WINAPI SetBkMode16( HDC16 hdc, INT16 mode )
  */
 INT16 WINAPI SetMapMode16( HDC16 hdc, INT16 mode )
 {
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     return SetMapMode( HDC_32(hdc), mode );
 }
 
@@ -1004,6 +1006,7 @@ DWORD WINAPI SetWindowOrg16( HDC16 hdc, INT16 x, INT16 y )
 DWORD WINAPI SetWindowExt16( HDC16 hdc, INT16 x, INT16 y )
 {
     SIZE size;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     if (!SetWindowExtEx( HDC_32(hdc), x, y, &size )) return 0;
     return MAKELONG( size.cx, size.cy );
 }
@@ -1026,6 +1029,7 @@ DWORD WINAPI SetViewportOrg16( HDC16 hdc, INT16 x, INT16 y )
 DWORD WINAPI SetViewportExt16( HDC16 hdc, INT16 x, INT16 y )
 {
     SIZE size;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     if (!SetViewportExtEx( HDC_32(hdc), x, y, &size )) return 0;
     return MAKELONG( size.cx, size.cy );
 }
@@ -1049,6 +1053,7 @@ DWORD WINAPI ScaleWindowExt16( HDC16 hdc, INT16 xNum, INT16 xDenom,
                              INT16 yNum, INT16 yDenom )
 {
     SIZE size;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     if (!ScaleWindowExtEx( HDC_32(hdc), xNum, xDenom, yNum, yDenom, &size ))
         return FALSE;
     return MAKELONG( size.cx,  size.cy );
@@ -1073,6 +1078,7 @@ DWORD WINAPI ScaleViewportExt16( HDC16 hdc, INT16 xNum, INT16 xDenom,
                                INT16 yNum, INT16 yDenom )
 {
     SIZE size;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     if (!ScaleViewportExtEx( HDC_32(hdc), xNum, xDenom, yNum, yDenom, &size ))
         return FALSE;
     return MAKELONG( size.cx,  size.cy );
@@ -1588,6 +1594,7 @@ INT16 WINAPI Escape16( HDC16 hdc, INT16 escape, INT16 in_count, SEGPTR in_data,
  */
 BOOL16 WINAPI RestoreDC16( HDC16 hdc, INT16 level )
 {
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     return RestoreDC( HDC_32(hdc), level );
 }
 
@@ -1647,6 +1654,7 @@ HGDIOBJ16 WINAPI SelectObject16( HDC16 hdc, HGDIOBJ16 handle )
     HGDIOBJ handle32 = HGDIOBJ_32(handle);
     HGDIOBJ result = SelectObject( hdc32, handle32 );
     DWORD type = GetObjectType(handle32);
+    if (type == OBJ_FONT) flush_text_metrics_cache( hdc32, 0 );
     if (krnl386_get_compat_mode("256color") && krnl386_get_config_int("otvdm", "DIBPalette", FALSE) && result && (type == OBJ_BITMAP) && (GetCurrentObject(hdc32, OBJ_PAL) != GetStockObject(DEFAULT_PALETTE)))
     {
         DIBSECTION dib;
@@ -2193,6 +2201,7 @@ BOOL16 WINAPI DeleteDC16( HDC16 hdc )
         struct gdi_thunk* thunk;
 
         if ((thunk = GDI_FindThunk(hdc))) GDI_DeleteThunk(thunk);
+        flush_text_metrics_cache( hdc32, 0 );
 
         LIST_FOR_EACH_ENTRY_SAFE( saved, next, &saved_regions, struct saved_visrgn, entry )
         {
@@ -2231,6 +2240,7 @@ BOOL16 WINAPI DeleteObject16( HGDIOBJ16 obj )
     for (int i = 0; i <= STOCK_LAST; i++)
         if (obj == stock[i]) return TRUE;
     if (type == OBJ_BITMAP) free_segptr_bits( obj );
+    else if (type == OBJ_FONT) flush_text_metrics_cache( 0, object );
     else if ((type == OBJ_PAL) && GetPtr16(object, 1))
     {
         HeapFree(GetProcessHeap(), 0, GetPtr16(object, 1));
@@ -3686,6 +3696,7 @@ BOOL16 WINAPI Chord16( HDC16 hdc, INT16 left, INT16 top,
  */
 DWORD WINAPI SetMapperFlags16( HDC16 hdc, DWORD flags )
 {
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     return SetMapperFlags( HDC_32(hdc), flags );
 }
 
@@ -3695,34 +3706,7 @@ DWORD WINAPI SetMapperFlags16( HDC16 hdc, DWORD flags )
  */
 BOOL16 WINAPI GetCharWidth16( HDC16 hdc, UINT16 firstChar, UINT16 lastChar, LPINT16 buffer )
 {
-    BOOL retVal = FALSE;
-    TEXTMETRIC tm = {0};
-    HDC hdc32 = HDC_32(hdc);
-    GetTextMetricsA(hdc32, &tm);
-
-    if( firstChar != lastChar )
-    {
-        LPINT buf32 = HeapAlloc(GetProcessHeap(), 0, sizeof(INT)*(1 + (lastChar - firstChar)));
-        if( buf32 )
-        {
-            LPINT obuf32 = buf32;
-            UINT i;
-
-            retVal = GetCharWidth32A( hdc32, firstChar, lastChar, buf32);
-            if (retVal)
-            {
-                for (i = firstChar; i <= lastChar; i++) *buffer++ = (*buf32++) + tm.tmOverhang;
-            }
-            HeapFree(GetProcessHeap(), 0, obuf32);
-        }
-    }
-    else /* happens quite often to warrant a special treatment */
-    {
-        INT chWidth;
-        retVal = GetCharWidth32A( hdc32, firstChar, lastChar, &chWidth );
-        *buffer = chWidth + tm.tmOverhang;
-    }
-    return retVal;
+    return get_char_widths16( HDC_32(hdc), firstChar, lastChar, buffer );
 }
 
 
@@ -4601,13 +4585,12 @@ BOOL16 WINAPI GetTextExtentPoint16( HDC16 hdc, LPCSTR str, INT16 count, LPSIZE16
 {
     SIZE size32;
     HDC hdc32 = HDC_32(hdc);
-    TEXTMETRICA tm;
-    GetTextMetricsA(hdc32, &tm);
+    INT overhang = get_text_overhang( hdc32 );
     BOOL ret = GetTextExtentPoint32A( hdc32, str, count, &size32 );
 
     if (ret)
     {
-        size->cx = size32.cx + tm.tmOverhang;
+        size->cx = size32.cx + overhang;
         size->cy = size32.cy;
         check_font_rotation( hdc32, size ); 
     }
@@ -4722,6 +4705,7 @@ BOOL16 WINAPI SetBitmapDimensionEx16( HBITMAP16 hbitmap, INT16 x, INT16 y, LPSIZ
 BOOL16 WINAPI SetViewportExtEx16( HDC16 hdc, INT16 x, INT16 y, LPSIZE16 size )
 {
     SIZE size32;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     BOOL16 ret = SetViewportExtEx( HDC_32(hdc), x, y, &size32 );
     if (size) { size->cx = size32.cx; size->cy = size32.cy; }
     return ret;
@@ -4750,6 +4734,7 @@ BOOL16 WINAPI SetViewportOrgEx16( HDC16 hdc, INT16 x, INT16 y, LPPOINT16 pt )
 BOOL16 WINAPI SetWindowExtEx16( HDC16 hdc, INT16 x, INT16 y, LPSIZE16 size )
 {
     SIZE size32;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     BOOL16 ret = SetWindowExtEx( HDC_32(hdc), x, y, &size32 );
     if (size) { size->cx = size32.cx; size->cy = size32.cy; }
     return ret;
@@ -4796,6 +4781,7 @@ BOOL16 WINAPI ScaleViewportExtEx16( HDC16 hdc, INT16 xNum, INT16 xDenom,
                                     INT16 yNum, INT16 yDenom, LPSIZE16 size )
 {
     SIZE size32;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     BOOL16 ret = ScaleViewportExtEx( HDC_32(hdc), xNum, xDenom, yNum, yDenom,
                                        &size32 );
     if (size) { size->cx = size32.cx; size->cy = size32.cy; }
@@ -4810,6 +4796,7 @@ BOOL16 WINAPI ScaleWindowExtEx16( HDC16 hdc, INT16 xNum, INT16 xDenom,
                                   INT16 yNum, INT16 yDenom, LPSIZE16 size )
 {
     SIZE size32;
+    flush_text_metrics_cache( HDC_32(hdc), 0 );
     BOOL16 ret = ScaleWindowExtEx( HDC_32(hdc), xNum, xDenom, yNum, yDenom,
                                      &size32 );
     if (size) { size->cx = size32.cx; size->cy = size32.cy; }
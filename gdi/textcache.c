@@ -0,0 +1,136 @@
+/*
+ * Cache of the text metrics of the fonts selected in DCs
+ *
+ * Copyright 2002 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Text metrics and 0-255 char widths of the font selected in a DC, so that
+ * GetCharWidth16 and GetTextExtentPoint16 don't have to query them on every
+ * call. Entries are keyed by DC, font and map mode, and are dropped by the
+ * 16-bit calls that change the font or the mapping (see gdi.c). All callers
+ * run under the Win16 lock so no further locking is needed.
+ *
+ * Only the 32-bit GDI is called here, nothing of the 16-bit side.
+ */
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "textcache.h"
+
+static struct text_metrics_cache
+{
+    HDC         hdc;
+    HFONT       hfont;
+    INT         map_mode;
+    TEXTMETRICA tm;
+    BOOL        widths_valid;
+    INT         widths[256];
+} text_metrics_cache[TEXT_METRICS_CACHE_SIZE];
+static UINT text_metrics_cache_next;
+
+static struct text_metrics_cache *get_text_metrics_cache( HDC hdc )
+{
+    HFONT hfont = GetCurrentObject( hdc, OBJ_FONT );
+    INT map_mode = GetMapMode( hdc );
+    struct text_metrics_cache *cache = NULL;
+    UINT i;
+
+    for (i = 0; i < TEXT_METRICS_CACHE_SIZE; i++)
+    {
+        if (text_metrics_cache[i].hdc != hdc) continue;
+        cache = &text_metrics_cache[i];
+        if (cache->hfont == hfont && cache->map_mode == map_mode) return cache;
+        break;
+    }
+    if (!cache) cache = &text_metrics_cache[text_metrics_cache_next++ % TEXT_METRICS_CACHE_SIZE];
+    cache->hdc = 0;
+    if (!hfont || !GetTextMetricsA( hdc, &cache->tm )) return NULL;
+    cache->hdc = hdc;
+    cache->hfont = hfont;
+    cache->map_mode = map_mode;
+    cache->widths_valid = FALSE;
+    return cache;
+}
+
+/***********************************************************************
+ *           get_text_overhang
+ *
+ * tmOverhang of the font selected in a DC, which the 16-bit width and
+ * extent functions add.
+ */
+INT get_text_overhang( HDC hdc )
+{
+    struct text_metrics_cache *cache = get_text_metrics_cache( hdc );
+
+    return cache ? cache->tm.tmOverhang : 0;
+}
+
+/***********************************************************************
+ *           get_char_widths16
+ *
+ * Widths of the chars first to last with the overhang added, the way
+ * GetCharWidth16 returns them. Chars 0-255 come from the cache, others
+ * are queried 256 at a time.
+ */
+BOOL get_char_widths16( HDC hdc, UINT first, UINT last, INT16 *buffer )
+{
+    struct text_metrics_cache *cache = get_text_metrics_cache( hdc );
+    INT overhang = cache ? cache->tm.tmOverhang : 0;
+    INT widths[256];
+    UINT i, end;
+
+    if (first > last) return FALSE;
+    if (cache && last <= 0xff)
+    {
+        if (!cache->widths_valid)
+            cache->widths_valid = GetCharWidth32A( hdc, 0, 0xff, cache->widths );
+        if (cache->widths_valid)
+        {
+            for (i = first; i <= last; i++) *buffer++ = cache->widths[i] + overhang;
+            return TRUE;
+        }
+    }
+
+    for (; first <= last; first = end + 1)
+    {
+        end = last - first >= ARRAY_SIZE(widths) ? first + ARRAY_SIZE(widths) - 1 : last;
+        if (!GetCharWidth32A( hdc, first, end, widths )) return FALSE;
+        for (i = 0; i <= end - first; i++) *buffer++ = widths[i] + overhang;
+        if (end == last) break;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           flush_text_metrics_cache
+ *
+ * Drop the entries of a DC and/or a font.
+ */
+void flush_text_metrics_cache( HDC hdc, HFONT hfont )
+{
+    UINT i;
+
+    for (i = 0; i < TEXT_METRICS_CACHE_SIZE; i++)
+    {
+        if ((hdc && text_metrics_cache[i].hdc == hdc) || (hfont && text_metrics_cache[i].hfont == hfont))
+            text_metrics_cache[i].hdc = 0;
+    }
+}
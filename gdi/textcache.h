@@ -0,0 +1,35 @@
+/*
+ * Cache of the text metrics of the fonts selected in DCs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_TEXTCACHE_H
+#define __WINE_TEXTCACHE_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+
+/* DCs whose font metrics are cached at the same time */
+#define TEXT_METRICS_CACHE_SIZE 8
+
+extern INT  get_text_overhang( HDC hdc ) DECLSPEC_HIDDEN;
+extern BOOL get_char_widths16( HDC hdc, UINT first, UINT last, INT16 *buffer ) DECLSPEC_HIDDEN;
+extern void flush_text_metrics_cache( HDC hdc, HFONT hfont ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_TEXTCACHE_H */
@@ -379,6 +379,14 @@ extern void DOSVM_ASPIHandler(CONTEXT*) DECLSPEC_HIDDEN;
 extern BIOSDATA *DOSVM_BiosData( void ) DECLSPEC_HIDDEN;
 __declspec(dllexport) extern void DOSVM_start_bios_timer(void) DECLSPEC_HIDDEN;
 
+/* dpmimem.c */
+extern BOOL DPMI_IsArenaPtr(LPCVOID) DECLSPEC_HIDDEN;
+extern LPVOID DPMI_ArenaAlloc(DWORD) DECLSPEC_HIDDEN;
+extern BOOL DPMI_ArenaFree(LPVOID) DECLSPEC_HIDDEN;
+extern LPVOID DPMI_ArenaReAlloc(LPVOID,DWORD) DECLSPEC_HIDDEN;
+extern DWORD DPMI_ArenaBlockSize(LPCVOID) DECLSPEC_HIDDEN;
+extern BOOL DPMI_ArenaGetFreeInfo(DWORD*,DWORD*,DWORD*) DECLSPEC_HIDDEN;
+
 /* fpu.c */
 extern void WINAPI DOSVM_Int34Handler(CONTEXT*) DECLSPEC_HIDDEN;
 extern void WINAPI DOSVM_Int35Handler(CONTEXT*) DECLSPEC_HIDDEN;
@@ -461,6 +469,8 @@ extern void        DOSVM_SetRMHandler( BYTE, FARPROC16 ) DECLSPEC_HIDDEN;
 /* ioports.c */
 extern DWORD DOSVM_inport( int port, int size, CONTEXT *ctx ) DECLSPEC_HIDDEN;
 extern void DOSVM_outport( int port, int size, DWORD value, CONTEXT *ctx ) DECLSPEC_HIDDEN;
+extern void DOSVM_inport_block( int port, int size, void *buffer, DWORD count, CONTEXT *ctx ) DECLSPEC_HIDDEN;
+extern void DOSVM_outport_block( int port, int size, const void *buffer, DWORD count, CONTEXT *ctx ) DECLSPEC_HIDDEN;
 extern void DOSVM_setportcb(OUTPROC outproc, INPROC inproc, int port, OUTPROC *oldout, INPROC* oldin) DECLSPEC_HIDDEN;
 
 /* relay.c */
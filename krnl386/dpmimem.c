@@ -0,0 +1,429 @@
+/*
+ * DPMI linear memory arena
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * INT 31h memory blocks are carved out of one contiguous address range.
+ * The range is reserved in chunks as it fills up, pages are committed
+ * when a block is allocated or grown and decommitted when it is freed or
+ * shrunk.
+ *
+ * Like the VirtualAlloc based allocator it replaces, blocks start on 64k
+ * boundaries and successive allocations get growing addresses: the
+ * search for a free block starts where the previous allocation ended and
+ * only goes back to the bottom of the arena once the top is used up.
+ * Some DOS extenders rely on that. Free blocks below the cursor are still
+ * used to grow the block in front of them in place.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "dosexe.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(int31);
+
+typedef struct tagDPMI_BLOCK
+{
+    DWORD offset;                   /* offset from the arena base */
+    DWORD size;                     /* size in bytes, page aligned */
+    BOOL  free;
+    struct tagDPMI_BLOCK *next;     /* next block, in address order */
+} DPMI_BLOCK;
+
+#define DPMI_PAGE_SIZE   0x1000
+#define DPMI_ALIGN       0x10000                /* allocation granularity of VirtualAlloc */
+#define DPMI_CHUNK_SIZE  (16 * 1024 * 1024)     /* address space is reserved in chunks */
+
+static BYTE *dpmi_arena;            /* base of the reserved range */
+static DWORD dpmi_arena_size;       /* bytes reserved so far */
+static DWORD dpmi_arena_max;        /* bytes the arena may grow to */
+static DWORD dpmi_arena_next;       /* where the search for a free block starts */
+static DPMI_BLOCK *dpmi_blocks;
+
+static inline DWORD DPMI_PageRound( DWORD len )
+{
+    return (len + DPMI_PAGE_SIZE - 1) & ~(DPMI_PAGE_SIZE - 1);
+}
+
+/**********************************************************************
+ *          DPMI_InitArena
+ *
+ * Reserve the first chunk of the arena. DPMIArenaSize in otvdm.ini (MB)
+ * caps how far it may grow.
+ */
+static BOOL DPMI_InitArena(void)
+{
+    static BOOL init_done;
+
+    if (init_done) return dpmi_arena != NULL;
+    init_done = TRUE;
+
+    dpmi_arena_max = krnl386_get_config_int( "otvdm", "DPMIArenaSize", 256 ) * 1024 * 1024;
+    dpmi_arena_max = min( dpmi_arena_max, 0x80000000 ) & ~(DPMI_CHUNK_SIZE - 1);
+    if (!dpmi_arena_max) return FALSE;
+
+    if (!(dpmi_arena = VirtualAlloc( NULL, DPMI_CHUNK_SIZE, MEM_RESERVE, PAGE_EXECUTE_READWRITE )))
+    {
+        WARN( "cannot reserve DPMI arena\n" );
+        return FALSE;
+    }
+    if (!(dpmi_blocks = HeapAlloc( GetProcessHeap(), 0, sizeof(*dpmi_blocks) )))
+    {
+        VirtualFree( dpmi_arena, 0, MEM_RELEASE );
+        dpmi_arena = NULL;
+        return FALSE;
+    }
+    dpmi_blocks->offset = 0;
+    dpmi_blocks->size = DPMI_CHUNK_SIZE;
+    dpmi_blocks->free = TRUE;
+    dpmi_blocks->next = NULL;
+    dpmi_arena_size = DPMI_CHUNK_SIZE;
+    TRACE( "reserved %u bytes at %p, up to %u bytes\n", dpmi_arena_size, dpmi_arena, dpmi_arena_max );
+    return TRUE;
+}
+
+/**********************************************************************
+ *          DPMI_GrowArena
+ *
+ * Reserve the chunk above the arena and add it to the free space. This
+ * fails for good once the address space above is taken.
+ */
+static BOOL DPMI_GrowArena(void)
+{
+    DPMI_BLOCK *last, *block;
+
+    if (dpmi_arena_size >= dpmi_arena_max) return FALSE;
+    if (!VirtualAlloc( dpmi_arena + dpmi_arena_size, DPMI_CHUNK_SIZE, MEM_RESERVE, PAGE_EXECUTE_READWRITE ))
+    {
+        WARN( "cannot grow DPMI arena beyond %u bytes\n", dpmi_arena_size );
+        dpmi_arena_max = dpmi_arena_size;
+        return FALSE;
+    }
+    for (last = dpmi_blocks; last->next; last = last->next);
+    if (last->free) last->size += DPMI_CHUNK_SIZE;
+    else
+    {
+        if (!(block = HeapAlloc( GetProcessHeap(), 0, sizeof(*block) )))
+        {
+            VirtualFree( dpmi_arena + dpmi_arena_size, 0, MEM_RELEASE );
+            return FALSE;
+        }
+        block->offset = dpmi_arena_size;
+        block->size = DPMI_CHUNK_SIZE;
+        block->free = TRUE;
+        block->next = NULL;
+        last->next = block;
+    }
+    dpmi_arena_size += DPMI_CHUNK_SIZE;
+    TRACE( "grown to %u bytes\n", dpmi_arena_size );
+    return TRUE;
+}
+
+/**********************************************************************
+ *          DPMI_CommitRange
+ *
+ * Commit or decommit pages of the arena. Each chunk is a reservation of
+ * its own, so calls are split at chunk boundaries.
+ */
+static BOOL DPMI_CommitRange( DWORD offset, DWORD size, BOOL commit )
+{
+    DWORD start = offset;
+
+    while (size)
+    {
+        DWORD len = min( size, DPMI_CHUNK_SIZE - offset % DPMI_CHUNK_SIZE );
+
+        if (!commit)
+            VirtualFree( dpmi_arena + offset, len, MEM_DECOMMIT );
+        else if (!VirtualAlloc( dpmi_arena + offset, len, MEM_COMMIT, PAGE_EXECUTE_READWRITE ))
+        {
+            DPMI_CommitRange( start, offset - start, FALSE );
+            return FALSE;
+        }
+        offset += len;
+        size -= len;
+    }
+    return TRUE;
+}
+
+/**********************************************************************
+ *          DPMI_SplitBlock
+ *
+ * Split the tail of a block beyond size into a new free block.
+ */
+static BOOL DPMI_SplitBlock( DPMI_BLOCK *block, DWORD size )
+{
+    DPMI_BLOCK *tail;
+
+    if (block->size == size) return TRUE;
+    if (!(tail = HeapAlloc( GetProcessHeap(), 0, sizeof(*tail) ))) return FALSE;
+    tail->offset = block->offset + size;
+    tail->size = block->size - size;
+    tail->free = TRUE;
+    tail->next = block->next;
+    block->size = size;
+    block->next = tail;
+    return TRUE;
+}
+
+/**********************************************************************
+ *          DPMI_MergeFree
+ *
+ * Coalesce a free block with the free blocks that follow it.
+ */
+static void DPMI_MergeFree( DPMI_BLOCK *block )
+{
+    DPMI_BLOCK *next;
+
+    while ((next = block->next) && next->free)
+    {
+        block->size += next->size;
+        block->next = next->next;
+        HeapFree( GetProcessHeap(), 0, next );
+    }
+}
+
+/**********************************************************************
+ *          DPMI_FindBlock
+ *
+ * Find the allocated arena block starting at ptr. *prev receives the
+ * block before it.
+ */
+static DPMI_BLOCK *DPMI_FindBlock( LPCVOID ptr, DPMI_BLOCK **prev )
+{
+    DPMI_BLOCK *block;
+    DWORD offset = (const BYTE *)ptr - dpmi_arena;
+
+    *prev = NULL;
+    for (block = dpmi_blocks; block; *prev = block, block = block->next)
+    {
+        if (block->offset == offset) return block->free ? NULL : block;
+        if (block->offset > offset) break;
+    }
+    return NULL;
+}
+
+/**********************************************************************
+ *          DPMI_FindFree
+ *
+ * Find the first free block with room for size bytes on a 64k boundary
+ * at or above offset start.
+ */
+static DPMI_BLOCK *DPMI_FindFree( DWORD start, DWORD size, DWORD *offset )
+{
+    DPMI_BLOCK *block;
+
+    for (block = dpmi_blocks; block; block = block->next)
+    {
+        DWORD pos, end = block->offset + block->size;
+
+        if (!block->free || end <= start) continue;
+        pos = (max( block->offset, start ) + DPMI_ALIGN - 1) & ~(DPMI_ALIGN - 1);
+        if (pos < end && end - pos >= size)
+        {
+            *offset = pos;
+            return block;
+        }
+    }
+    return NULL;
+}
+
+/**********************************************************************
+ *          DPMI_ReleaseBlock
+ *
+ * Mark a block free and coalesce it with its free neighbours.
+ */
+static void DPMI_ReleaseBlock( DPMI_BLOCK *block, DPMI_BLOCK *prev )
+{
+    block->free = TRUE;
+    DPMI_MergeFree( block );
+    if (prev && prev->free) DPMI_MergeFree( prev );
+}
+
+/**********************************************************************
+ *          DPMI_IsArenaPtr
+ */
+BOOL DPMI_IsArenaPtr( LPCVOID ptr )
+{
+    return dpmi_arena && (const BYTE *)ptr >= dpmi_arena &&
+           (const BYTE *)ptr < dpmi_arena + dpmi_arena_size;
+}
+
+/**********************************************************************
+ *          DPMI_ArenaAlloc
+ *
+ * Allocate a block from the arena. Returns NULL if the arena is full.
+ */
+LPVOID DPMI_ArenaAlloc( DWORD len )
+{
+    DPMI_BLOCK *block, *prev = NULL;
+    DWORD offset, size = DPMI_PageRound( len );
+
+    if (!size || size < len || !DPMI_InitArena()) return NULL;
+
+    while (!(block = DPMI_FindFree( dpmi_arena_next, size, &offset )))
+        if (!DPMI_GrowArena()) break;
+    if (!block)
+    {
+        if (!(block = DPMI_FindFree( 0, size, &offset ))) return NULL;
+        FIXME( "failed to allocate linearly growing memory (%u bytes), "
+               "using non-linear growing...\n", len );
+    }
+
+    /* keep the space in front of a 64k boundary as a free block of its own */
+    if (offset > block->offset)
+    {
+        if (!DPMI_SplitBlock( block, offset - block->offset )) return NULL;
+        prev = block;
+        block = block->next;
+    }
+    if (!DPMI_SplitBlock( block, size ) || !DPMI_CommitRange( block->offset, size, TRUE ))
+    {
+        DPMI_ReleaseBlock( block, prev );
+        return NULL;
+    }
+    block->free = FALSE;
+    dpmi_arena_next = (offset + size + DPMI_ALIGN - 1) & ~(DPMI_ALIGN - 1);
+    TRACE( "%u bytes at %p\n", size, dpmi_arena + offset );
+    return dpmi_arena + offset;
+}
+
+/**********************************************************************
+ *          DPMI_ArenaFree
+ */
+BOOL DPMI_ArenaFree( LPVOID ptr )
+{
+    DPMI_BLOCK *block, *prev;
+
+    if (!(block = DPMI_FindBlock( ptr, &prev ))) return FALSE;
+    DPMI_CommitRange( block->offset, block->size, FALSE );
+    DPMI_ReleaseBlock( block, prev );
+    return TRUE;
+}
+
+/**********************************************************************
+ *          DPMI_ArenaBlockSize
+ *
+ * Committed size of an arena block, 0 if ptr isn't one.
+ */
+DWORD DPMI_ArenaBlockSize( LPCVOID ptr )
+{
+    DPMI_BLOCK *block, *prev;
+
+    return (block = DPMI_FindBlock( ptr, &prev )) ? block->size : 0;
+}
+
+/**********************************************************************
+ *          DPMI_ArenaResize
+ *
+ * Resize an arena block without moving it, shrinking it or growing it
+ * into the free block that follows. Returns FALSE if it has to move.
+ */
+static BOOL DPMI_ArenaResize( DPMI_BLOCK *block, DWORD size )
+{
+    DPMI_BLOCK *next;
+
+    if (size <= block->size)
+    {
+        if (size == block->size || !DPMI_SplitBlock( block, size )) return TRUE;
+        next = block->next;
+        DPMI_CommitRange( next->offset, next->size, FALSE );
+        DPMI_MergeFree( next );
+        return TRUE;
+    }
+
+    /* a block at the top of the arena can grow along with it */
+    while ((!(next = block->next) || (next->free && !next->next)) &&
+           block->size + (next ? next->size : 0) < size)
+    {
+        if (!DPMI_GrowArena()) break;
+    }
+    if (!next || !next->free || block->size + next->size < size) return FALSE;
+    if (!DPMI_SplitBlock( next, size - block->size )) return FALSE;
+    if (!DPMI_CommitRange( next->offset, next->size, TRUE ))
+    {
+        DPMI_MergeFree( next );
+        return FALSE;
+    }
+    block->size += next->size;
+    block->next = next->next;
+    HeapFree( GetProcessHeap(), 0, next );
+    return TRUE;
+}
+
+/**********************************************************************
+ *          DPMI_ArenaReAlloc
+ *
+ * Resize an arena block, in place when possible, else by moving it to
+ * another place in the arena. Returns NULL if it doesn't fit in the
+ * arena; the block is left alone then.
+ */
+LPVOID DPMI_ArenaReAlloc( LPVOID ptr, DWORD len )
+{
+    DPMI_BLOCK *block, *prev;
+    DWORD size = DPMI_PageRound( len );
+    LPVOID newptr;
+
+    if (!size || size < len || !(block = DPMI_FindBlock( ptr, &prev ))) return NULL;
+    if (DPMI_ArenaResize( block, size )) return ptr;
+
+    if (!(newptr = DPMI_ArenaAlloc( len ))) return NULL;
+    /* the allocation may have changed the list, but not this block */
+    memcpy( newptr, ptr, min( block->size, size ) );
+    DPMI_ArenaFree( ptr );
+    return newptr;
+}
+
+/**********************************************************************
+ *          DPMI_ArenaGetFreeInfo
+ *
+ * Report the free space of the arena for INT 31h AX=0500h, counting the
+ * address space it may still reserve. FALSE if there is no arena.
+ */
+BOOL DPMI_ArenaGetFreeInfo( DWORD *largest, DWORD *free, DWORD *total )
+{
+    DPMI_BLOCK *block;
+    DWORD unreserved;
+
+    if (!DPMI_InitArena()) return FALSE;
+
+    unreserved = dpmi_arena_max - dpmi_arena_size;
+    *largest = unreserved;
+    *free = unreserved;
+    *total = dpmi_arena_max;
+    for (block = dpmi_blocks; block; block = block->next)
+    {
+        DWORD size = block->size;
+
+        if (!block->free) continue;
+        *free += size;
+        if (!block->next) size += unreserved;
+        /* a new block starts on a 64k boundary */
+        size -= min( size, (DPMI_ALIGN - block->offset % DPMI_ALIGN) % DPMI_ALIGN );
+        if (size > *largest) *largest = size;
+    }
+    return TRUE;
+}
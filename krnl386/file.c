@@ -36,6 +36,7 @@
 #include "winternl.h"
 #include "wine/winbase16.h"
 #include "kernel16_private.h"
+#include "inicache.h"
 #include "wine/unicode.h"
 #include "wine/debug.h"
 
@@ -495,49 +496,93 @@ BOOL16 WINAPI WriteProfileString16( LPCSTR section, LPCSTR entry,
 }
 
 
-/* get the search path for the current module; helper for OpenFile16 */
-/*static */char *get_search_path(void)
+/*
+ * The directories of the search path that stay the same while the process
+ * runs: the emulator directory, the 16-bit system directory, the windows
+ * directory and the real system directory. GetShortPathNameA is slow
+ * enough to notice when a module search runs on every LoadModule.
+ */
+static char *search_path_dirs;
+static char *search_path_winsys;
+
+static CRITICAL_SECTION search_path_section;
+static CRITICAL_SECTION_DEBUG search_path_critsect_debug =
 {
-    UINT len, i;
-    char *ret, *p, module[OFS_MAXPATHNAME];
+    0, 0, &search_path_section,
+    { &search_path_critsect_debug.ProcessLocksList, &search_path_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": search_path_section") }
+};
+static CRITICAL_SECTION search_path_section = { &search_path_critsect_debug, -1, 0, 0, 0, 0 };
 
-    module[0] = 0;
-    if (GetCurrentTask() && GetModuleFileName16( GetCurrentTask(), module, sizeof(module) ))
-    {
-        if (!(p = strrchr( module, '\\' ))) p = module;
-        *p = 0;
-    }
+static BOOL get_search_path_dirs(void)
+{
     char windir[MAX_PATH];
     char windir2[MAX_PATH];
     char realwinsys[MAX_PATH];
-    char *windir3;
+    char vdmpath[MAX_PATH];
+    char *windir3, *p;
+    UINT len;
+
+    EnterCriticalSection( &search_path_section );
+    if (search_path_dirs)
+    {
+        LeaveCriticalSection( &search_path_section );
+        return TRUE;
+    }
     GetWindowsDirectoryA(windir, MAX_PATH);
     windir3 = RedirectSystemDir(windir, windir2, MAX_PATH);
-    char vdmpath[MAX_PATH];
     GetModuleFileNameA(GetModuleHandleA(NULL), vdmpath, MAX_PATH);
     PathRemoveFileSpecA(vdmpath);
     GetShortPathNameA(vdmpath, vdmpath, MAX_PATH);
     strcpy(realwinsys, windir);
     strcat(realwinsys, "\\SYSTEM");
 
-    len = (strlen(vdmpath) + 1 + 2 +                                              /* search order: first current dir */
-           GetSystemDirectory16( NULL, 0 ) + 1 +            /* then system dir */
-           strlen(windir3) + 1 +            /* then windows dir */
+    len = strlen(vdmpath) + 1 +                   /* first the emulator dir */
+          GetSystemDirectory16( NULL, 0 ) + 1 +   /* then system dir */
+          strlen(windir3) + 1 +                   /* then windows dir */
+          strlen(realwinsys) + 1;                 /* the real windows system dir comes last */
+    if ((p = HeapAlloc( GetProcessHeap(), 0, len )))
+    {
+        search_path_dirs = p;
+        strcpy(p, vdmpath);
+        p += strlen(p);
+        *p++ = ';';
+        GetSystemDirectory16( p, search_path_dirs + len - p );
+        p += strlen( p );
+        *p++ = ';';
+        strcpy(p, windir3);
+        p += strlen( p ) + 1;
+        search_path_winsys = p;
+        strcpy(p, realwinsys);
+    }
+    LeaveCriticalSection( &search_path_section );
+    return search_path_dirs != NULL;
+}
+
+/* get the search path for the current module; helper for OpenFile16 */
+/*static */char *get_search_path(void)
+{
+    UINT len, i;
+    char *ret, *p, module[OFS_MAXPATHNAME];
+
+    module[0] = 0;
+    if (GetCurrentTask() && GetModuleFileName16( GetCurrentTask(), module, sizeof(module) ))
+    {
+        if (!(p = strrchr( module, '\\' ))) p = module;
+        *p = 0;
+    }
+    if (!get_search_path_dirs()) return NULL;
+
+    len = (2 +                                              /* search order: first current dir */
+           strlen(search_path_dirs) + 1 +                   /* then the fixed dirs */
            strlen( module ) + 1 +                           /* then module path */
            GetEnvironmentVariableA( "PATH16", NULL, 0 ) + 1 + /* then look in PATH */
-           strlen(realwinsys) + 1); /* then the real windows system dir */
+           strlen(search_path_winsys) + 1); /* then the real windows system dir */
     if (!(ret = HeapAlloc( GetProcessHeap(), 0, len ))) return NULL;
     strcpy(ret, ".;");
     p = ret + 2;
-    strcpy(p, vdmpath);
-    p += strlen(vdmpath);
-    *p++ = ';';
-
-    GetSystemDirectory16( p, ret + len - p );
-    p += strlen( p );
-    *p++ = ';';
-    strcpy(p, windir3);//GetWindowsDirectoryA( p, ret + len - p );
-    p += strlen( p );
+    strcpy(p, search_path_dirs);
+    p += strlen(p);
     *p++ = ';';
     if (module[0])
     {
@@ -546,12 +591,12 @@ BOOL16 WINAPI WriteProfileString16( LPCSTR section, LPCSTR entry,
         *p++ = ';';
     }
     i = GetEnvironmentVariableA("PATH16", p, ret + len - p);
-    if (i)
+    if (i && i < ret + len - p)
     {
         p += i;
         *p++ = ';';
     }
-    strcpy(p, realwinsys);
+    strcpy(p, search_path_winsys);
     return ret;
 }
 char *krnl386_get_search_path(void)
@@ -1444,7 +1489,7 @@ UINT16 WINAPI GetPrivateProfileInt16( LPCSTR section, LPCSTR entry,
         }
     }
     RedirectPrivateProfileStringWindowsDir(filename,ini);
-    return (INT16)GetPrivateProfileIntA(section,entry,def_val,ini);
+    return (INT16)ini_cache_get_int(section,entry,def_val,ini);
 }
 
 
@@ -1616,6 +1661,7 @@ INT16 WINAPI GetPrivateProfileString16( LPCSTR section, LPCSTR entry,
 
         if (overwrite_section)
             return construct_redirected_ini_section(section, buffer, oldlen, filename);
+        ini_cache_write_back( filename );
         for (;;)
         {
             if (!(data = HeapAlloc(GetProcessHeap(), 0, size ))) return 0;
@@ -1675,7 +1721,7 @@ INT16 WINAPI GetPrivateProfileString16( LPCSTR section, LPCSTR entry,
         }
         return 0;
     }
-    return GetPrivateProfileStringA( section, entry, def_val, buffer, len, filename );
+    return ini_cache_get_string( section, entry, def_val, buffer, len, filename );
 }
 
 static BOOL16 check_write_profile_error(LPCSTR filename, DWORD error)
@@ -1702,7 +1748,17 @@ BOOL16 WINAPI WritePrivateProfileString16( LPCSTR section, LPCSTR entry,
     char filenamebuf[MAX_PATH];
     RedirectPrivateProfileStringWindowsDir(filename, &filenamebuf);
     filename = filenamebuf;
+    if (!section && !entry && !string)
+    {
+        /* flush the file */
+        ini_cache_write_back(filename);
+        return WritePrivateProfileStringA(NULL, NULL, NULL, filename);
+    }
+    if (ini_cache_write_string(section, entry, string, filename))
+        return TRUE;
+    ini_cache_write_back(filename);
     BOOL ret = WritePrivateProfileStringA(section,entry,string,filename);
+    ini_cache_invalidate(filename);
     if (!ret)
         return check_write_profile_error(filename, GetLastError());
     return ret;
@@ -1778,6 +1834,9 @@ UINT16 WINAPI GetDriveType16( UINT16 drive ) /* [in] number (NOT letter) of driv
 WORD WINAPI GetProfileSectionNames16(LPSTR buffer, WORD size)
 
 {
+    char filenamebuf[MAX_PATH];
+    RedirectPrivateProfileStringWindowsDir("win.ini", &filenamebuf);
+    ini_cache_write_back( filenamebuf );
     return GetPrivateProfileSectionNamesA(buffer,size,"win.ini");
 }
 
@@ -1788,6 +1847,9 @@ WORD WINAPI GetProfileSectionNames16(LPSTR buffer, WORD size)
 WORD WINAPI GetPrivateProfileSectionNames16( LPSTR buffer, WORD size,
                                              LPCSTR filename )
 {
+    char filenamebuf[MAX_PATH];
+    RedirectPrivateProfileStringWindowsDir(filename, &filenamebuf);
+    ini_cache_write_back( filenamebuf );
     return GetPrivateProfileSectionNamesA(buffer,size,filename);
 }
 
@@ -1842,6 +1904,7 @@ WORD WINAPI GetShortPathName16( LPCSTR longpath, LPSTR shortpath, WORD len )
  */
 void WINAPI WriteOutProfiles16(void)
 {
+    ini_cache_write_back( NULL );
     WritePrivateProfileSectionW( NULL, NULL, NULL );
 }
 
@@ -1855,7 +1918,10 @@ BOOL16 WINAPI WritePrivateProfileStruct16 (LPCSTR section, LPCSTR key,
     char filenamebuf[MAX_PATH];
     RedirectPrivateProfileStringWindowsDir(filename, &filenamebuf);
     filename = filenamebuf;
-    return WritePrivateProfileStructA( section, key, buf, bufsize, filename );
+    ini_cache_write_back( filename );
+    BOOL16 ret = WritePrivateProfileStructA( section, key, buf, bufsize, filename );
+    ini_cache_invalidate( filename );
+    return ret;
 }
 
 
@@ -1868,6 +1934,7 @@ BOOL16 WINAPI GetPrivateProfileStruct16(LPCSTR section, LPCSTR key,
     char filenamebuf[MAX_PATH];
     RedirectPrivateProfileStringWindowsDir(filename, &filenamebuf);
     filename = filenamebuf;
+    ini_cache_write_back( filename );
     return GetPrivateProfileStructA( section, key, buf, len, filename );
 }
 
@@ -1977,7 +2044,12 @@ BOOL16 WINAPI FindClose16( HANDLE16 handle )
 BOOL16 WINAPI WritePrivateProfileSection16( LPCSTR section,
                                             LPCSTR string, LPCSTR filename )
 {
-    return WritePrivateProfileSectionA( section, string, filename );
+    char filenamebuf[MAX_PATH];
+    RedirectPrivateProfileStringWindowsDir(filename, &filenamebuf);
+    ini_cache_write_back( filenamebuf );
+    BOOL16 ret = WritePrivateProfileSectionA( section, string, filename );
+    ini_cache_invalidate( filenamebuf );
+    return ret;
 }
 
 
@@ -1996,6 +2068,9 @@ BOOL16 WINAPI WriteProfileSection16( LPCSTR section, LPCSTR keys_n_values)
 INT16 WINAPI GetPrivateProfileSection16( LPCSTR section, LPSTR buffer,
                                          UINT16 len, LPCSTR filename )
 {
+    char filenamebuf[MAX_PATH];
+    RedirectPrivateProfileStringWindowsDir(filename, &filenamebuf);
+    ini_cache_write_back( filenamebuf );
     return GetPrivateProfileSectionA( section, buffer, len, filename );
 }
 
@@ -40,6 +40,7 @@
 #include "wine/winbase16.h"
 #include "winternl.h"
 #include "kernel16_private.h"
+#include "otvdmstats.h"
 #include "wine/debug.h"
 #include "winuser.h"
 #include "wingdi.h"
@@ -61,7 +62,8 @@ typedef struct
     WORD      wSeg;
     WORD      wType;
     HGLOBAL   link_hndl;
-    BYTE      pad[0x10 - 4 - 2 - 2 - 4];     /* win31 GLOBALARENA size = 0x20 */
+    DWORD     lru;           /* Last access stamp for discarding */
+                             /* win31 GLOBALARENA size = 0x20 */
 } GLOBALARENA;
 
   /* Flags definitions */
@@ -82,6 +84,35 @@ static DWORD *selTable;
 #define VALID_HANDLE(handle) (((handle)&4)&&(((handle)>>__AHSHIFT)<globalArenaSize))
 #define GET_ARENA_PTR(handle)  (pGlobalArena + ((handle) >> __AHSHIFT))
 
+static DWORD global_lru_clock;  /* source of the arena access stamps */
+static DWORD global_used;       /* bytes allocated from the win16 heap */
+
+/* record an access to a block for the discard LRU */
+static inline void GLOBAL_Touch( GLOBALARENA *pArena )
+{
+    pArena->lru = ++global_lru_clock;
+}
+
+/* lock a block, saturating instead of wrapping the lock count */
+static inline void GLOBAL_LockArena( GLOBALARENA *pArena )
+{
+    if (pArena->lockCount < 0xff) pArena->lockCount++;
+    GLOBAL_Touch( pArena );
+}
+
+static inline void GLOBAL_AddUsed( DWORD size )
+{
+    global_used += size;
+}
+
+static inline void GLOBAL_SubUsed( DWORD size )
+{
+    global_used = (global_used > size) ? global_used - size : 0;
+}
+
+static DWORD GLOBAL_Discard( DWORD needed, HGLOBAL16 keep );
+static DWORD GLOBAL_GetBudget(void);
+
 static HANDLE get_win16_heap(void)
 {
     static HANDLE win16_heap;
@@ -278,9 +309,10 @@ HGLOBAL16 GLOBAL_Alloc( UINT16 flags, DWORD size, HGLOBAL16 hOwner, unsigned cha
     if (size > GLOBAL_MAX_ALLOC_SIZE) return 0;
     size = (size + fixup_size) & ~fixup_size;
 
-    /* Allocate the linear memory */
+    /* Allocate the linear memory, discarding old blocks if needed */
     ptr = HeapAlloc( get_win16_heap(), 0, size);
-      /* FIXME: free discardable blocks and try again? */
+    if (!ptr && GLOBAL_Discard( size, 0 ))
+        ptr = HeapAlloc( get_win16_heap(), 0, size);
     if (!ptr) return 0;
 
       /* Allocate the selector(s) */
@@ -291,6 +323,10 @@ HGLOBAL16 GLOBAL_Alloc( UINT16 flags, DWORD size, HGLOBAL16 hOwner, unsigned cha
         HeapFree( get_win16_heap(), 0, ptr );
         return 0;
     }
+    GLOBAL_AddUsed( GET_ARENA_PTR(handle)->size );
+    GLOBAL_Touch( GET_ARENA_PTR(handle) );
+    if (GLOBAL_GetBudget() && global_used > GLOBAL_GetBudget())
+        GLOBAL_Discard( global_used - GLOBAL_GetBudget(), handle );
 
     if (flags & GMEM_ZEROINIT) memset( ptr, 0, size );
     else if (size > 100) // some programs depend on the block not being cleared also work around bug in procyan2
@@ -306,6 +342,11 @@ WORD GLOBAL_GetSegNum(HGLOBAL16 hg)
     return GET_ARENA_PTR(hg)->wSeg;
 }
 
+WORD GLOBAL_GetSegType(HGLOBAL16 hg)
+{
+    return GET_ARENA_PTR(hg)->wType;
+}
+
 void GLOBAL_SetSeg(HGLOBAL16 hg, WORD wSeg, WORD type)
 {
     GET_ARENA_PTR(hg)->wSeg = wSeg;
@@ -381,7 +422,7 @@ HGLOBAL16 WINAPI GlobalReAlloc16(
 ) {
     WORD selcount;
     DWORD oldsize;
-    void *ptr, *newptr;
+    void *ptr, *newptr, *oldptr;
     GLOBALARENA *pArena, *pNewArena;
     WORD sel = GlobalHandleToSel16( handle );
     HANDLE heap = get_win16_heap();
@@ -413,8 +454,11 @@ HGLOBAL16 WINAPI GlobalReAlloc16(
         }
         else if (pArena->flags & GA_DOSMEM)
             DOSMEM_FreeBlock( pArena->base );
-        else
+        else if (pArena->base)
+        {
             HeapFree( heap, 0, pArena->base );
+            GLOBAL_SubUsed( pArena->size );
+        }
         pArena->base = 0;
 
         /* Note: we rely on the fact that SELECTOR_ReallocBlock won't
@@ -449,7 +493,7 @@ HGLOBAL16 WINAPI GlobalReAlloc16(
 
       /* Reallocate the linear memory */
 
-    ptr = pArena->base;
+    ptr = oldptr = pArena->base;
     oldsize = pArena->size;
     TRACE("oldbase %p oldsize %08x newsize %08x\n", ptr,oldsize,size);
     if (ptr && (size == oldsize)) return handle;  /* Nothing to do */
@@ -506,7 +550,10 @@ HGLOBAL16 WINAPI GlobalReAlloc16(
             if (pArena->flags & GA_DOSMEM)
                 DOSMEM_FreeBlock( pArena->base );
             else
+            {
                 HeapFree( heap, 0, ptr );
+                if (ptr) GLOBAL_SubUsed( oldsize );
+            }
             SELECTOR_FreeBlock( sel );
             memset( pArena, 0, sizeof(GLOBALARENA) );
         }
@@ -551,6 +598,12 @@ HGLOBAL16 WINAPI GlobalReAlloc16(
     pNewArena->base = ptr;
     pNewArena->size = GetSelectorLimit16(sel) + 1 - add_size;
     pNewArena->selCount = selcount;
+    if (!(pNewArena->flags & GA_DOSMEM))
+    {
+        GLOBAL_SubUsed( oldptr ? oldsize : 0 );
+        GLOBAL_AddUsed( pNewArena->size );
+    }
+    GLOBAL_Touch( pNewArena );
     pNewArena->handle = (pNewArena->flags & GA_MOVEABLE) ? sel - 1 : sel;
 
     if (selcount > 1)  /* clear the next arena blocks */
@@ -607,8 +660,10 @@ HGLOBAL16 WINAPI GlobalFree16(
         return 0;
     }
     HGLOBAL ddehndl = GLOBAL_GetLink(handle);
+    DWORD size = (ptr && !(pArena->flags & GA_DOSMEM)) ? pArena->size : 0;
     if (!GLOBAL_FreeBlock( handle )) return handle;  /* failed */
     HeapFree( get_win16_heap(), 0, ptr );
+    GLOBAL_SubUsed( size );
     if (ddehndl) check_gptr(ddehndl);
     return 0;
 }
@@ -633,7 +688,9 @@ SEGPTR WINAPI K32WOWGlobalLock16( HGLOBAL16 handle )
 	else if (!GET_ARENA_PTR(handle)->base)
             sel = 0;
         else if ((GET_ARENA_PTR(handle)->flags & GA_DISCARDABLE) || IsOldWindowsTask(GetCurrentTask()))
-            GET_ARENA_PTR(handle)->lockCount++;
+            GLOBAL_LockArena( GET_ARENA_PTR(handle) );
+        else
+            GLOBAL_Touch( GET_ARENA_PTR(handle) );
     }
 
     return MAKESEGPTR( sel, 0 );
@@ -859,7 +916,7 @@ LPVOID WINAPI GlobalLock16(
         return 0;
     // don't use IsOldWindowsTask here as it'll cause an infinite loop
     if (GET_ARENA_PTR(handle)->flags & GA_DISCARDABLE)
-        GET_ARENA_PTR(handle)->lockCount++;
+        GLOBAL_LockArena( GET_ARENA_PTR(handle) );
     return GET_ARENA_PTR(handle)->base;
 }
 
@@ -1023,7 +1080,7 @@ HGLOBAL16 WINAPI LockSegment16( HGLOBAL16 handle )
 	return 0;
     }
     if ((GET_ARENA_PTR(handle)->flags & GA_DISCARDABLE) || IsOldWindowsTask(GetCurrentTask()))
-        GET_ARENA_PTR(handle)->lockCount++;
+        GLOBAL_LockArena( GET_ARENA_PTR(handle) );
     return handle;
 }
 
@@ -1044,12 +1101,135 @@ void WINAPI UnlockSegment16( HGLOBAL16 handle )
 }
 
 
+/***********************************************************************
+ *           GLOBAL_GetBudget
+ *
+ * Return the configured limit of win16 heap memory (0 if unlimited).
+ */
+static DWORD GLOBAL_GetBudget(void)
+{
+    static DWORD budget = ~0u;
+
+    if (budget == ~0u) budget = krnl386_get_config_int( "otvdm", "GlobalHeapBudget", 0 ) * 1024;
+    return budget;
+}
+
+
+/***********************************************************************
+ *           GLOBAL_IsDiscardable
+ *
+ * Check whether a block can be discarded now. Only moveable blocks that
+ * are reloaded on demand (resources) or that the application must expect
+ * to lose (discardable memory) qualify; fixed blocks may be used without
+ * a lock, and code and data segments are never discarded as there is no
+ * not-present fault to reload them.
+ */
+static BOOL GLOBAL_IsDiscardable( const GLOBALARENA *pArena )
+{
+    WORD type = pArena->wType & 0x0f;
+
+    if (!pArena->size || !pArena->base) return FALSE;
+    if ((pArena->flags & (GA_MOVEABLE | GA_DISCARDABLE)) != (GA_MOVEABLE | GA_DISCARDABLE)) return FALSE;
+    if (pArena->flags & (GA_DOSMEM | GA_IPCSHARE)) return FALSE;
+    if (pArena->lockCount || pArena->pageLockCount) return FALSE;
+    if (pArena->dib_avail_size || pArena->link_hndl) return FALSE;
+    return (type == GT_RESOURCE) || (type == GT_UNKNOWN);
+}
+
+
+/***********************************************************************
+ *           GLOBAL_DiscardArena
+ */
+static void GLOBAL_DiscardArena( GLOBALARENA *pArena )
+{
+    WORD sel = GlobalHandleToSel16( pArena->handle );
+
+    TRACE("discarding %04x size %08x\n", pArena->handle, pArena->size );
+    HeapFree( get_win16_heap(), 0, pArena->base );
+    GLOBAL_SubUsed( pArena->size );
+    pArena->base = 0;
+    /* see GlobalReAlloc16: the selector is kept for the discarded block */
+    SELECTOR_ReallocBlock( sel, 0, 1 );
+}
+
+
+static int __cdecl compare_lru( const void *a, const void *b )
+{
+    DWORD lru1 = pGlobalArena[*(const int *)a].lru;
+    DWORD lru2 = pGlobalArena[*(const int *)b].lru;
+    return (lru1 > lru2) - (lru1 < lru2);
+}
+
+
+/***********************************************************************
+ *           GLOBAL_Discard
+ *
+ * Discard the least recently used discardable blocks until 'needed'
+ * bytes are released. Returns the number of bytes released.
+ */
+static DWORD GLOBAL_Discard( DWORD needed, HGLOBAL16 keep )
+{
+    GLOBALARENA *pKeep = keep ? GET_ARENA_PTR(keep) : NULL;
+    DWORD freed = 0;
+    int *list, count = 0, i;
+
+    if (!pGlobalArena) return 0;
+    if (!(list = HeapAlloc( GetProcessHeap(), 0, globalArenaSize * sizeof(*list) ))) return 0;
+    for (i = 0; i < globalArenaSize; i++)
+        if (pGlobalArena + i != pKeep && GLOBAL_IsDiscardable( pGlobalArena + i )) list[count++] = i;
+    qsort( list, count, sizeof(*list), compare_lru );
+
+    for (i = 0; i < count && freed < needed; i++)
+    {
+        freed += pGlobalArena[list[i]].size;
+        GLOBAL_DiscardArena( pGlobalArena + list[i] );
+    }
+    HeapFree( GetProcessHeap(), 0, list );
+    TRACE("needed %08x, discarded %d blocks, %08x bytes\n", needed, i, freed );
+    return freed;
+}
+
+
+/***********************************************************************
+ *           GLOBAL_GetAvailable
+ *
+ * Largest allocation that currently fits in the budget.
+ */
+static DWORD GLOBAL_GetAvailable(void)
+{
+    DWORD budget = GLOBAL_GetBudget();
+    MEMORYSTATUS ms;
+
+    if (budget) return min( budget > global_used ? budget - global_used : 0, GLOBAL_MAX_ALLOC_SIZE );
+    GlobalMemoryStatus( &ms );
+    return min( ms.dwAvailVirtual, GLOBAL_MAX_ALLOC_SIZE );
+}
+
+
 /***********************************************************************
  *           GlobalCompact   (KERNEL.25)
+ *
+ * Discard blocks until 'desired' bytes are available. With 0, report
+ * what would be available if all discardable blocks were discarded.
  */
 DWORD WINAPI GlobalCompact16( DWORD desired )
 {
-    return GLOBAL_MAX_ALLOC_SIZE;
+    DWORD avail = GLOBAL_GetAvailable();
+    int i;
+
+    TRACE("%08x\n", desired );
+    if (!desired)
+    {
+        for (i = 0; i < globalArenaSize; i++)
+            if (GLOBAL_IsDiscardable( pGlobalArena + i )) avail += pGlobalArena[i].size;
+        return min( avail, GLOBAL_MAX_ALLOC_SIZE );
+    }
+    if (avail < desired)
+    {
+        GLOBAL_Discard( desired - avail, 0 );
+        avail = GLOBAL_GetAvailable();
+    }
+    return avail;
 }
 
 
@@ -1107,6 +1287,7 @@ HGLOBAL16 WINAPI GlobalLRUOldest16( HGLOBAL16 handle )
 {
     TRACE("%04x\n", handle );
     if (handle == (HGLOBAL16)-1) handle = CURRENT_DS;
+    if (VALID_HANDLE(handle)) GET_ARENA_PTR(handle)->lru = 0;
     return handle;
 }
 
@@ -1118,6 +1299,7 @@ HGLOBAL16 WINAPI GlobalLRUNewest16( HGLOBAL16 handle )
 {
     TRACE("%04x\n", handle );
     if (handle == (HGLOBAL16)-1) handle = CURRENT_DS;
+    if (VALID_HANDLE(handle)) GLOBAL_Touch( GET_ARENA_PTR(handle) );
     return handle;
 }
 
@@ -1231,7 +1413,7 @@ WORD WINAPI GlobalFix16( HGLOBAL16 handle )
 	return 0;
     }
     if ((GET_ARENA_PTR(handle)->flags & GA_DISCARDABLE) || IsOldWindowsTask(GetCurrentTask()))
-        GET_ARENA_PTR(handle)->lockCount++;
+        GLOBAL_LockArena( GET_ARENA_PTR(handle) );
 
     return GlobalHandleToSel16(handle);
 }
@@ -1417,3 +1599,29 @@ void WINAPI GlobalMapInternal(WORD sel, void *base, DWORD size)
     pArena->size = size;
     pArena->wType = GT_INTERNAL;
 }
+
+/***********************************************************************
+ *           GLOBAL_GetStats
+ *
+ * Fill the global heap part of the published runtime statistics.
+ */
+void GLOBAL_GetStats( struct otvdm_stats *stats )
+{
+    GLOBALARENA *pArena;
+    int i;
+
+    stats->global_arena_max = GLOBAL_MAX_COUNT;
+    stats->global_bytes = global_used;
+    for (i = 0, pArena = pGlobalArena; i < globalArenaSize; i++, pArena++)
+    {
+        if (!pArena->handle) continue;
+        stats->global_arena_used++;
+        if (!pArena->base)
+        {
+            stats->global_discarded_blocks++;
+            continue;
+        }
+        if (pArena->lockCount || pArena->pageLockCount) stats->global_locked_blocks++;
+        if (GLOBAL_IsDiscardable( pArena )) stats->global_discardable_bytes += pArena->size;
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ * Cache of the icon directories of NE files
+ *
+ * Copyright 1997 Alex Korobka
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Parsed icon directories of NE files, so that counting the icons of a
+ * file and then extracting them one by one (as Progman does for every
+ * group) don't walk the resource table each time. Entries are keyed by
+ * path, size and last write time; files without icons are remembered too.
+ *
+ * Nothing here opens files, so resource.c maps them and does the locking.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "iconcache.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(resource);
+
+/* size of a type entry in the file, NE_TYPEINFO is bigger where pointers are */
+#define NE_TYPEINFO_SIZE 8
+
+static struct ne_icon_dir *ne_icon_dirs;
+
+/***********************************************************************
+ *           ne_icon_dir_find
+ *
+ * Find a cached directory, moving it to the front. A directory of an
+ * older version of the file is dropped.
+ */
+struct ne_icon_dir *ne_icon_dir_find( LPCSTR path, DWORD size, const FILETIME *mtime )
+{
+    struct ne_icon_dir **prev, *dir;
+
+    for (prev = &ne_icon_dirs; (dir = *prev); prev = &dir->next)
+    {
+        if (stricmp( dir->path, path )) continue;
+        *prev = dir->next;
+        if (dir->size != size || CompareFileTime( &dir->mtime, mtime ))
+        {
+            HeapFree( GetProcessHeap(), 0, dir );
+            return NULL;
+        }
+        dir->next = ne_icon_dirs;
+        ne_icon_dirs = dir;
+        return dir;
+    }
+    return NULL;
+}
+
+/***********************************************************************
+ *           ne_icon_dir_parse
+ *
+ * Parse the icon resources of a mapped file and add them to the cache.
+ * Anything that isn't an NE file with both icon tables gets an empty
+ * directory.
+ */
+struct ne_icon_dir *ne_icon_dir_parse( const BYTE *image, DWORD fsize, LPCSTR path,
+                                       DWORD size, const FILETIME *mtime )
+{
+    const IMAGE_DOS_HEADER *mz_header = (const IMAGE_DOS_HEADER *)image;
+    const IMAGE_OS2_HEADER *ne_header;
+    const BYTE *pData = NULL, *end = image + fsize;
+    const BYTE *pTInfo;
+    const NE_NAMEINFO *pIconDir = NULL, *pIconStorage = NULL;
+    UINT16 dir_count = 0, icon_count = 0;
+    struct ne_icon_dir *dir, **prev;
+    int count;
+
+    if (strlen( path ) >= MAX_PATH) return NULL;
+    if (fsize >= sizeof(*mz_header) && mz_header->e_magic == IMAGE_DOS_SIGNATURE &&
+        (DWORD)mz_header->e_lfanew + sizeof(*ne_header) <= fsize)
+    {
+        ne_header = (const IMAGE_OS2_HEADER *)(image + mz_header->e_lfanew);
+        if (ne_header->ne_magic == IMAGE_OS2_SIGNATURE && ne_header->ne_rsrctab < ne_header->ne_restab &&
+            (DWORD)mz_header->e_lfanew + ne_header->ne_rsrctab + sizeof(WORD) <= fsize)
+        {
+            pData = image + mz_header->e_lfanew + ne_header->ne_rsrctab;
+            pTInfo = pData + 2;
+            while (pTInfo + NE_TYPEINFO_SIZE <= end && ((const NE_TYPEINFO *)pTInfo)->type_id &&
+                   !(pIconStorage && pIconDir))
+            {
+                const NE_TYPEINFO *type = (const NE_TYPEINFO *)pTInfo;
+                const NE_NAMEINFO *names = (const NE_NAMEINFO *)(pTInfo + NE_TYPEINFO_SIZE);
+
+                if ((const BYTE *)(names + type->count) > end) break;
+                if (type->type_id == NE_RSCTYPE_GROUP_ICON)	/* find icon directory and icon repository */
+                {
+                    dir_count = type->count;
+                    pIconDir = names;
+                    TRACE("\tfound directory - %i icon families\n", dir_count);
+                }
+                if (type->type_id == NE_RSCTYPE_ICON)
+                {
+                    icon_count = type->count;
+                    pIconStorage = names;
+                    TRACE("\ttotal icons - %i\n", icon_count);
+                }
+                pTInfo = (const BYTE *)(names + type->count);
+            }
+        }
+    }
+    if (!pIconDir || !pIconStorage) dir_count = icon_count = 0;
+
+    dir = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct ne_icon_dir, entries[dir_count + icon_count] ) );
+    if (!dir) return NULL;
+    strcpy( dir->path, path );
+    dir->size = size;
+    dir->mtime = *mtime;
+    dir->shift = dir_count ? *(const WORD *)pData : 0;
+    dir->dir_count = dir_count;
+    dir->icon_count = icon_count;
+    memcpy( dir->entries, pIconDir, dir_count * sizeof(NE_NAMEINFO) );
+    memcpy( dir->entries + dir_count, pIconStorage, icon_count * sizeof(NE_NAMEINFO) );
+
+    dir->next = ne_icon_dirs;
+    ne_icon_dirs = dir;
+    for (prev = &ne_icon_dirs, count = 0; *prev; count++)
+    {
+        struct ne_icon_dir *old = *prev;
+
+        if (count < NE_ICON_DIR_CACHE_SIZE)
+        {
+            prev = &old->next;
+            continue;
+        }
+        *prev = old->next;
+        HeapFree( GetProcessHeap(), 0, old );
+    }
+    return dir;
+}
+
+/***********************************************************************
+ *           ne_icon_dir_get_icon
+ *
+ * The RT_ICON resource with the id a group icon entry refers to.
+ */
+const NE_NAMEINFO *ne_icon_dir_get_icon( const struct ne_icon_dir *dir, WORD id )
+{
+    const NE_NAMEINFO *icons = dir->entries + dir->dir_count;
+    UINT16 i;
+
+    for (i = 0; i < dir->icon_count; i++)
+        if (icons[i].id == (id | 0x8000)) return icons + i;
+    return NULL;
+}
+
+/***********************************************************************
+ *           ne_icon_resource
+ *
+ * Get a resource of a mapped file, NULL if it doesn't lie within the file.
+ */
+BYTE *ne_icon_resource( BYTE *image, DWORD fsize, const NE_NAMEINFO *info, WORD shift, ULONG *size )
+{
+    ULONGLONG offset, length;
+
+    if (shift > 16) return NULL;
+    offset = (ULONGLONG)info->offset << shift;
+    length = (ULONGLONG)info->length << shift;
+    if (offset + length > fsize) return NULL;
+    *size = (ULONG)length;
+    return image + offset;
+}
@@ -0,0 +1,49 @@
+/*
+ * Cache of the icon directories of NE files
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_ICONCACHE_H
+#define __WINE_ICONCACHE_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+
+/* files whose directories are kept, the least recently used ones are dropped */
+#define NE_ICON_DIR_CACHE_SIZE 16
+
+struct ne_icon_dir
+{
+    struct ne_icon_dir *next;
+    char        path[MAX_PATH];
+    DWORD       size;
+    FILETIME    mtime;
+    WORD        shift;          /* resource alignment shift */
+    UINT16      dir_count;      /* RT_GROUP_ICON resources */
+    UINT16      icon_count;     /* RT_ICON resources */
+    NE_NAMEINFO entries[1];     /* group icons, followed by the icons */
+};
+
+extern struct ne_icon_dir *ne_icon_dir_find( LPCSTR path, DWORD size, const FILETIME *mtime ) DECLSPEC_HIDDEN;
+extern struct ne_icon_dir *ne_icon_dir_parse( const BYTE *image, DWORD fsize, LPCSTR path,
+                                              DWORD size, const FILETIME *mtime ) DECLSPEC_HIDDEN;
+extern const NE_NAMEINFO *ne_icon_dir_get_icon( const struct ne_icon_dir *dir, WORD id ) DECLSPEC_HIDDEN;
+extern BYTE *ne_icon_resource( BYTE *image, DWORD fsize, const NE_NAMEINFO *info, WORD shift, ULONG *size ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_ICONCACHE_H */
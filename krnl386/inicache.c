@@ -0,0 +1,590 @@
+/*
+ * Cache of 16-bit profile (.INI file) accesses
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The host parses the whole .INI file on every GetPrivateProfileString
+ * call and rewrites it on every WritePrivateProfileString call.
+ *
+ * Lookups are remembered per file and dropped when the file changes: a
+ * change notification fires on its directory, or its size or write time
+ * differ (checked at most every INI_CACHE_STAT_INTERVAL ms). The answers
+ * come from the host, so its parsing rules are kept.
+ *
+ * Writes of single entries are held back and written to the host, in
+ * order and with repeated writes of an entry merged, when:
+ *   - the program flushes the file with WritePrivateProfileString(NULL,
+ *     NULL, NULL, file), or all files with WriteOutProfiles
+ *   - the entry is read back, or the file is accessed in a way the cache
+ *     doesn't handle (see ini_cache_write_back)
+ *   - they are INI_CACHE_WRITE_DELAY ms old at the next profile call, or
+ *     INI_CACHE_MAX_WRITES are pending
+ *   - the task exits
+ * Files that are missing or read-only are written through, so that the
+ * program still sees the error.
+ *
+ * Sections that IniFileMapping redirects to the registry bypass all of
+ * this, as do relative paths.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winreg.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "inicache.h"
+#include "wine/debug.h"
+
+#include <shlwapi.h>
+
+WINE_DEFAULT_DEBUG_CHANNEL(profile);
+
+#define INI_CACHE_BUCKETS    64
+
+struct ini_cache_entry
+{
+    struct ini_cache_entry *next;
+    BOOL   is_int;
+    INT    def_int;
+    UINT   result_int;
+    char  *section;
+    char  *entry;
+    char  *def;
+    char  *value;
+    char   data[1];
+};
+
+/* a write held back */
+struct ini_cache_write
+{
+    struct ini_cache_write *next;
+    char  *section;
+    char  *entry;
+    char  *string;              /* NULL deletes the entry */
+    char   data[1];
+};
+
+struct ini_cache_file
+{
+    struct ini_cache_file *next;
+    char     path[MAX_PATH];
+    FILETIME mtime;
+    DWORD    size;
+    BOOL     writable;          /* exists and isn't read-only */
+    DWORD    checked;           /* tick count of the last stat */
+    HANDLE   change;            /* change notification on the directory */
+    BOOL     mapped;            /* the whole file is mapped to the registry */
+    char    *mapped_sections;   /* double null terminated list */
+    struct ini_cache_write *writes;
+    DWORD    write_count;
+    DWORD    write_time;        /* tick count of the oldest pending write */
+    struct ini_cache_entry *entries[INI_CACHE_BUCKETS];
+};
+
+static struct ini_cache_file *ini_cache_files;
+
+static CRITICAL_SECTION ini_cache_section;
+static CRITICAL_SECTION_DEBUG critsect_debug =
+{
+    0, 0, &ini_cache_section,
+    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": ini_cache_section") }
+};
+static CRITICAL_SECTION ini_cache_section = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+static DWORD ini_cache_hash( LPCSTR section, LPCSTR entry )
+{
+    DWORD hash = 0;
+
+    for (; *section; section++) hash = hash * 31 + toupper( (unsigned char)*section );
+    for (; *entry; entry++) hash = hash * 31 + toupper( (unsigned char)*entry );
+    return hash % INI_CACHE_BUCKETS;
+}
+
+/* drop all cached values of a file */
+static void ini_cache_flush( struct ini_cache_file *file )
+{
+    struct ini_cache_entry *entry, *next;
+    int i;
+
+    for (i = 0; i < INI_CACHE_BUCKETS; i++)
+    {
+        for (entry = file->entries[i]; entry; entry = next)
+        {
+            next = entry->next;
+            HeapFree( GetProcessHeap(), 0, entry );
+        }
+        file->entries[i] = NULL;
+    }
+}
+
+/* drop the cached values of one entry */
+static void ini_cache_flush_entry( struct ini_cache_file *file, LPCSTR section, LPCSTR entry )
+{
+    struct ini_cache_entry **cached, *next;
+
+    for (cached = &file->entries[ini_cache_hash( section, entry )]; *cached; )
+    {
+        if (!stricmp( (*cached)->section, section ) && !stricmp( (*cached)->entry, entry ))
+        {
+            next = (*cached)->next;
+            HeapFree( GetProcessHeap(), 0, *cached );
+            *cached = next;
+        }
+        else cached = &(*cached)->next;
+    }
+}
+
+static void ini_cache_get_stamp( struct ini_cache_file *file )
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    file->checked = GetTickCount();
+    if (GetFileAttributesExA( file->path, GetFileExInfoStandard, &data ))
+    {
+        file->mtime = data.ftLastWriteTime;
+        file->size = data.nFileSizeLow;
+        file->writable = !(data.dwFileAttributes & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_DIRECTORY));
+    }
+    else
+    {
+        file->mtime.dwLowDateTime = file->mtime.dwHighDateTime = 0;
+        file->size = ~0u;
+        file->writable = FALSE;
+    }
+}
+
+/* write the pending writes of a file to the host */
+static BOOL ini_cache_commit( struct ini_cache_file *file )
+{
+    struct ini_cache_write *write;
+    BOOL ret = TRUE;
+
+    if (!file->writes) return TRUE;
+    TRACE( "writing %u entries to %s\n", file->write_count, debugstr_a(file->path) );
+    while ((write = file->writes))
+    {
+        if (!WritePrivateProfileStringA( write->section, write->entry, write->string, file->path ))
+        {
+            WARN( "writing [%s] %s to %s failed, error %u\n", debugstr_a(write->section),
+                  debugstr_a(write->entry), debugstr_a(file->path), GetLastError() );
+            ret = FALSE;
+        }
+        file->writes = write->next;
+        HeapFree( GetProcessHeap(), 0, write );
+    }
+    file->write_count = 0;
+    /* the host may normalize what was written */
+    ini_cache_flush( file );
+    ini_cache_get_stamp( file );
+    return ret;
+}
+
+static void ini_cache_commit_expired(void)
+{
+    struct ini_cache_file *file;
+    DWORD now = GetTickCount();
+
+    for (file = ini_cache_files; file; file = file->next)
+        if (file->writes && now - file->write_time >= INI_CACHE_WRITE_DELAY) ini_cache_commit( file );
+}
+
+static void ini_cache_free_file( struct ini_cache_file *file )
+{
+    ini_cache_commit( file );
+    ini_cache_flush( file );
+    if (file->change != INVALID_HANDLE_VALUE) FindCloseChangeNotification( file->change );
+    HeapFree( GetProcessHeap(), 0, file->mapped_sections );
+    HeapFree( GetProcessHeap(), 0, file );
+}
+
+/* read which sections of the file IniFileMapping sends to the registry */
+static void ini_cache_get_mapping( struct ini_cache_file *file )
+{
+    char key_name[MAX_PATH + 64], name[256];
+    DWORD i, len, total = 0, name_len;
+    HKEY hkey;
+
+    strcpy( key_name, "Software\\Microsoft\\Windows NT\\CurrentVersion\\IniFileMapping\\" );
+    strcat( key_name, PathFindFileNameA( file->path ) );
+    if (RegOpenKeyExA( HKEY_LOCAL_MACHINE, key_name, 0, KEY_READ, &hkey ) != ERROR_SUCCESS) return;
+
+    for (i = 0; ; i++)
+    {
+        name_len = sizeof(name);
+        if (RegEnumValueA( hkey, i, name, &name_len, NULL, NULL, NULL, NULL ) != ERROR_SUCCESS) break;
+        if (!name_len)
+        {
+            file->mapped = TRUE;  /* default value: every section is mapped */
+            break;
+        }
+        len = name_len + 1;
+        if (!file->mapped_sections)
+            file->mapped_sections = HeapAlloc( GetProcessHeap(), 0, len + 1 );
+        else
+            file->mapped_sections = HeapReAlloc( GetProcessHeap(), 0, file->mapped_sections, total + len + 1 );
+        if (!file->mapped_sections)
+        {
+            file->mapped = TRUE;
+            break;
+        }
+        memcpy( file->mapped_sections + total, name, len );
+        total += len;
+        file->mapped_sections[total] = 0;
+    }
+    RegCloseKey( hkey );
+}
+
+static BOOL ini_cache_is_mapped( struct ini_cache_file *file, LPCSTR section )
+{
+    LPCSTR p;
+
+    if (file->mapped) return TRUE;
+    if (!file->mapped_sections) return FALSE;
+    for (p = file->mapped_sections; *p; p += strlen( p ) + 1)
+        if (!stricmp( p, section )) return TRUE;
+    return FALSE;
+}
+
+/* full path of a file the cache handles, name points to its file name */
+static BOOL ini_cache_get_path( LPCSTR filename, char *path, LPSTR *name )
+{
+    /* the host resolves relative names against the Windows directory */
+    if (PathIsRelativeA( filename )) return FALSE;
+    return GetFullPathNameA( filename, MAX_PATH, path, name ) && *name;
+}
+
+static struct ini_cache_file *ini_cache_find_file( LPCSTR path )
+{
+    struct ini_cache_file *file;
+
+    for (file = ini_cache_files; file; file = file->next)
+        if (!stricmp( file->path, path )) return file;
+    return NULL;
+}
+
+/* find the cache of a file and make sure it is still current */
+static struct ini_cache_file *ini_cache_get_file( LPCSTR filename )
+{
+    struct ini_cache_file *file, **prev;
+    char path[MAX_PATH], dir[MAX_PATH];
+    FILETIME mtime;
+    DWORD size, count = 0;
+    LPSTR name;
+
+    if (!ini_cache_get_path( filename, path, &name )) return NULL;
+
+    for (prev = &ini_cache_files; (file = *prev); prev = &file->next, count++)
+    {
+        if (stricmp( file->path, path )) continue;
+        /* move to the front */
+        *prev = file->next;
+        file->next = ini_cache_files;
+        ini_cache_files = file;
+        break;
+    }
+
+    if (!file)
+    {
+        if (count >= INI_CACHE_MAX_FILES)
+        {
+            for (prev = &ini_cache_files; (*prev)->next; prev = &(*prev)->next) ;
+            ini_cache_free_file( *prev );
+            *prev = NULL;
+        }
+        if (!(file = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*file) ))) return NULL;
+        strcpy( file->path, path );
+        lstrcpynA( dir, path, name - path + 1 );
+        file->change = FindFirstChangeNotificationA( dir, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                                     FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_FILE_NAME );
+        ini_cache_get_stamp( file );
+        ini_cache_get_mapping( file );
+        file->next = ini_cache_files;
+        ini_cache_files = file;
+        return file;
+    }
+
+    if (file->change != INVALID_HANDLE_VALUE && WaitForSingleObject( file->change, 0 ) == WAIT_OBJECT_0)
+    {
+        TRACE( "directory of %s changed\n", debugstr_a(file->path) );
+        ini_cache_flush( file );
+        if (!FindNextChangeNotification( file->change ))
+        {
+            FindCloseChangeNotification( file->change );
+            file->change = INVALID_HANDLE_VALUE;
+        }
+    }
+    if (GetTickCount() - file->checked >= INI_CACHE_STAT_INTERVAL)
+    {
+        mtime = file->mtime;
+        size = file->size;
+        ini_cache_get_stamp( file );
+        if (CompareFileTime( &mtime, &file->mtime ) || size != file->size) ini_cache_flush( file );
+    }
+    return file;
+}
+
+static struct ini_cache_write *ini_cache_find_write( struct ini_cache_file *file, LPCSTR section, LPCSTR entry,
+                                                     struct ini_cache_write ***prev )
+{
+    struct ini_cache_write **write;
+
+    for (write = &file->writes; *write; write = &(*write)->next)
+    {
+        if (stricmp( (*write)->section, section ) || stricmp( (*write)->entry, entry )) continue;
+        if (prev) *prev = write;
+        return *write;
+    }
+    if (prev) *prev = write;
+    return NULL;
+}
+
+/* look up a cached value, querying the host and caching it on a miss */
+static struct ini_cache_entry *ini_cache_lookup( struct ini_cache_file *file, LPCSTR section, LPCSTR entry,
+                                                 LPCSTR def, INT def_int, BOOL is_int )
+{
+    struct ini_cache_entry *cached;
+    char value[INI_CACHE_MAX_VALUE];
+    DWORD hash, len, section_len, entry_len, def_len, value_len = 0;
+    UINT result_int = 0;
+
+    if (ini_cache_is_mapped( file, section )) return NULL;
+    if (!def) def = "";
+
+    /* reading back a pending write: let the host parse it */
+    if (ini_cache_find_write( file, section, entry, NULL )) ini_cache_commit( file );
+
+    hash = ini_cache_hash( section, entry );
+    for (cached = file->entries[hash]; cached; cached = cached->next)
+    {
+        if (cached->is_int != is_int || stricmp( cached->section, section ) || stricmp( cached->entry, entry ))
+            continue;
+        if (is_int ? cached->def_int == def_int : !strcmp( cached->def, def )) return cached;
+    }
+
+    if (is_int)
+        result_int = GetPrivateProfileIntA( section, entry, def_int, file->path );
+    else
+    {
+        len = GetPrivateProfileStringA( section, entry, def, value, sizeof(value), file->path );
+        if (len >= sizeof(value) - 1) return NULL;  /* may be truncated */
+        value_len = len + 1;
+    }
+
+    section_len = strlen( section ) + 1;
+    entry_len = strlen( entry ) + 1;
+    def_len = is_int ? 0 : strlen( def ) + 1;
+    cached = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET(struct ini_cache_entry, data[section_len + entry_len + def_len + value_len]) );
+    if (!cached) return NULL;
+    cached->is_int = is_int;
+    cached->def_int = def_int;
+    cached->result_int = result_int;
+    cached->section = cached->data;
+    cached->entry = cached->section + section_len;
+    cached->def = cached->entry + entry_len;
+    cached->value = cached->def + def_len;
+    memcpy( cached->section, section, section_len );
+    memcpy( cached->entry, entry, entry_len );
+    if (!is_int)
+    {
+        memcpy( cached->def, def, def_len );
+        memcpy( cached->value, value, value_len );
+    }
+    cached->next = file->entries[hash];
+    file->entries[hash] = cached;
+    return cached;
+}
+
+/***********************************************************************
+ *           ini_cache_get_string
+ *
+ * GetPrivateProfileStringA for an entry, filename is a full path.
+ */
+INT16 ini_cache_get_string( LPCSTR section, LPCSTR entry, LPCSTR def_val,
+                            LPSTR buffer, UINT16 len, LPCSTR filename )
+{
+    struct ini_cache_file *file;
+    struct ini_cache_entry *cached = NULL;
+    INT16 ret = -1;
+
+    if (section && entry && len)
+    {
+        EnterCriticalSection( &ini_cache_section );
+        ini_cache_commit_expired();
+        if ((file = ini_cache_get_file( filename )))
+            cached = ini_cache_lookup( file, section, entry, def_val, 0, FALSE );
+        if (cached)
+        {
+            size_t size = min( strlen( cached->value ), len - 1 );
+            memcpy( buffer, cached->value, size );
+            buffer[size] = 0;
+            ret = size;
+        }
+        LeaveCriticalSection( &ini_cache_section );
+    }
+    if (ret < 0)
+    {
+        ini_cache_write_back( filename );
+        ret = GetPrivateProfileStringA( section, entry, def_val, buffer, len, filename );
+    }
+    return ret;
+}
+
+/***********************************************************************
+ *           ini_cache_get_int
+ *
+ * GetPrivateProfileIntA, filename is a full path.
+ */
+UINT ini_cache_get_int( LPCSTR section, LPCSTR entry, INT def_val, LPCSTR filename )
+{
+    struct ini_cache_file *file;
+    struct ini_cache_entry *cached = NULL;
+    UINT ret = 0;
+
+    if (section && entry)
+    {
+        EnterCriticalSection( &ini_cache_section );
+        ini_cache_commit_expired();
+        if ((file = ini_cache_get_file( filename )))
+            cached = ini_cache_lookup( file, section, entry, NULL, def_val, TRUE );
+        if (cached) ret = cached->result_int;
+        LeaveCriticalSection( &ini_cache_section );
+    }
+    if (!cached)
+    {
+        ini_cache_write_back( filename );
+        ret = GetPrivateProfileIntA( section, entry, def_val, filename );
+    }
+    return ret;
+}
+
+/***********************************************************************
+ *           ini_cache_write_string
+ *
+ * Hold back a WritePrivateProfileStringA of an entry (string NULL
+ * deletes it). FALSE if the caller has to write it through, after
+ * ini_cache_write_back.
+ */
+BOOL ini_cache_write_string( LPCSTR section, LPCSTR entry, LPCSTR string, LPCSTR filename )
+{
+    struct ini_cache_file *file;
+    struct ini_cache_write *write, *old, **prev;
+    size_t section_len, entry_len, string_len;
+    BOOL ret = FALSE;
+
+    if (!section || !entry) return FALSE;
+
+    EnterCriticalSection( &ini_cache_section );
+    ini_cache_commit_expired();
+    if (!(file = ini_cache_get_file( filename )) || !file->writable || ini_cache_is_mapped( file, section ))
+        goto done;
+
+    section_len = strlen( section ) + 1;
+    entry_len = strlen( entry ) + 1;
+    string_len = string ? strlen( string ) + 1 : 0;
+    if (!(write = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET(struct ini_cache_write, data[section_len + entry_len + string_len]) )))
+        goto done;
+    write->section = write->data;
+    write->entry = write->section + section_len;
+    write->string = string ? write->entry + entry_len : NULL;
+    memcpy( write->section, section, section_len );
+    memcpy( write->entry, entry, entry_len );
+    if (string) memcpy( write->string, string, string_len );
+
+    /* a rewritten entry keeps its place, so new entries are added in the order they were first written */
+    if ((old = ini_cache_find_write( file, section, entry, &prev )))
+    {
+        write->next = old->next;
+        HeapFree( GetProcessHeap(), 0, old );
+    }
+    else
+    {
+        write->next = NULL;
+        if (!file->write_count++) file->write_time = GetTickCount();
+    }
+    *prev = write;
+    ini_cache_flush_entry( file, section, entry );
+    if (file->write_count >= INI_CACHE_MAX_WRITES) ini_cache_commit( file );
+    ret = TRUE;
+
+done:
+    LeaveCriticalSection( &ini_cache_section );
+    return ret;
+}
+
+/***********************************************************************
+ *           ini_cache_write_back
+ *
+ * Write the pending writes of a file, or of every file if filename is
+ * NULL. Must be called before the file is accessed without the cache.
+ */
+BOOL ini_cache_write_back( LPCSTR filename )
+{
+    struct ini_cache_file *file;
+    char path[MAX_PATH];
+    LPSTR name;
+    BOOL ret = TRUE;
+
+    EnterCriticalSection( &ini_cache_section );
+    if (!filename)
+    {
+        for (file = ini_cache_files; file; file = file->next)
+            if (!ini_cache_commit( file )) ret = FALSE;
+    }
+    else if (ini_cache_get_path( filename, path, &name ) && (file = ini_cache_find_file( path )))
+        ret = ini_cache_commit( file );
+    LeaveCriticalSection( &ini_cache_section );
+    return ret;
+}
+
+/***********************************************************************
+ *           ini_cache_invalidate
+ *
+ * Forget a file written without the cache, or every file if filename
+ * is NULL.
+ */
+void ini_cache_invalidate( LPCSTR filename )
+{
+    struct ini_cache_file *file, **prev;
+    char path[MAX_PATH];
+    LPSTR name;
+
+    EnterCriticalSection( &ini_cache_section );
+    if (!filename)
+    {
+        while ((file = ini_cache_files))
+        {
+            ini_cache_files = file->next;
+            ini_cache_free_file( file );
+        }
+    }
+    else if (ini_cache_get_path( filename, path, &name ))
+    {
+        for (prev = &ini_cache_files; (file = *prev); prev = &file->next)
+        {
+            if (stricmp( file->path, path )) continue;
+            *prev = file->next;
+            ini_cache_free_file( file );
+            break;
+        }
+    }
+    LeaveCriticalSection( &ini_cache_section );
+}
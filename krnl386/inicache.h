@@ -0,0 +1,45 @@
+/*
+ * Cache of 16-bit profile (.INI file) accesses
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_INICACHE_H
+#define __WINE_INICACHE_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+
+/* files whose values are cached at the same time */
+#define INI_CACHE_MAX_FILES     16
+/* longer values aren't cached */
+#define INI_CACHE_MAX_VALUE     1024
+/* the file is checked for changes at most this often (ms) */
+#define INI_CACHE_STAT_INTERVAL 500
+/* pending writes are written back when they get this old (ms) */
+#define INI_CACHE_WRITE_DELAY   2000
+/* or when a file has this many */
+#define INI_CACHE_MAX_WRITES    64
+
+extern INT16 ini_cache_get_string( LPCSTR section, LPCSTR entry, LPCSTR def_val,
+                                   LPSTR buffer, UINT16 len, LPCSTR filename ) DECLSPEC_HIDDEN;
+extern UINT ini_cache_get_int( LPCSTR section, LPCSTR entry, INT def_val, LPCSTR filename ) DECLSPEC_HIDDEN;
+extern BOOL ini_cache_write_string( LPCSTR section, LPCSTR entry, LPCSTR string, LPCSTR filename ) DECLSPEC_HIDDEN;
+extern BOOL ini_cache_write_back( LPCSTR filename ) DECLSPEC_HIDDEN;
+extern void ini_cache_invalidate( LPCSTR filename ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_INICACHE_H */
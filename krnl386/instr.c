@@ -665,6 +665,32 @@ DWORD __wine_emulate_instruction( EXCEPTION_RECORD *rec, CONTEXT *context )
 		else SET_LOWORD(context->Ecx,0);
               }
 
+              /* a forward string that does not wrap goes to the port as one block */
+              if (count > 1 && step > 0 && !TRACE_ON(io))
+              {
+                  DWORD offset = outp ? context->Esi : context->Edi;
+
+                  if (!long_addr) offset = LOWORD(offset);
+                  if (long_addr || offset + count * opsize <= 0x10000)
+                  {
+                      void *data = make_ptr( context, seg, offset, long_addr );
+
+                      if (outp)
+                      {
+                          DOSVM_outport_block( LOWORD(context->Edx), opsize, data, count, context );
+                          if (long_addr) context->Esi += count * opsize;
+                          else ADD_LOWORD(context->Esi, count * opsize);
+                      }
+                      else
+                      {
+                          DOSVM_inport_block( LOWORD(context->Edx), opsize, data, count, context );
+                          if (long_addr) context->Edi += count * opsize;
+                          else ADD_LOWORD(context->Edi, count * opsize);
+                      }
+                      count = 0;
+                  }
+              }
+
 	      while (count-- > 0)
 		{
 		  void *data;
@@ -700,6 +700,7 @@ static BOOL INT10_SetVideoMode( BIOSDATA *data, WORD mode )
     const VGA_MODE *ptr = VGA_GetModeInfo( mode );
     INT10_HEAP *heap = INT10_GetHeap();
     BOOL clearScreen = TRUE;
+    unsigned cols, rows;
 
     if (!ptr)
         return FALSE;
@@ -752,6 +753,15 @@ static BOOL INT10_SetVideoMode( BIOSDATA *data, WORD mode )
 
         if (!VGA_SetMode(mode))
             return FALSE;
+
+        VGA_GetTextGrid( &cols, &rows );
+        data->VideoColumns = cols;
+        data->RowsOnScreenMinus1 = rows - 1;
+        if (clearScreen)
+        {
+            INT10_SetCursorPos( data, 0, 0, 0 );
+            VGA_SetCursorPos( 0, 0 );
+        }
     }
 
     return TRUE;
@@ -1164,18 +1174,18 @@ void WINAPI DOSVM_Int10Handler( CONTEXT *context )
         break;
 
     case 0x0c: /* WRITE GRAPHICS PIXEL */
-
-        /* Only supported in CGA mode for now */
-        if(data->VideoMode >= 4 && data->VideoMode <= 6)
-        {
-          VGA_WritePixel(AL_reg(context), BH_reg(context), CX_reg(context), DX_reg(context));
-        }
-        else FIXME("Write pixel not implemented for current mode\n");
+        /* AL = Color, bit 7 XORs it below 256 colors */
+        /* BH = Page Number */
+        /* CX,DX = column, row */
+        TRACE("Write Graphics Pixel %d at %d/%d\n", AL_reg(context), CX_reg(context), DX_reg(context));
+        VGA_WritePixel(AL_reg(context), BH_reg(context), CX_reg(context), DX_reg(context));
         break;
 
     case 0x0d: /* READ GRAPHICS PIXEL */
-        /* Not in graphics mode, can ignore w/o error */
-        FIXME("Read Graphics Pixel - Not Supported\n");
+        /* BH = Page Number */
+        /* CX,DX = column, row */
+        SET_AL( context, VGA_ReadPixel(BH_reg(context), CX_reg(context), DX_reg(context)) );
+        TRACE("Read Graphics Pixel at %d/%d: %d\n", CX_reg(context), DX_reg(context), AL_reg(context));
         break;
 
     case 0x0e: /* TELETYPE OUTPUT */
@@ -1380,8 +1390,65 @@ void WINAPI DOSVM_Int10Handler( CONTEXT *context )
         break;
 
     case 0x13: /* WRITE STRING */
+        /* AL = Mode, bit 0 moves the cursor, bit 1 takes char/attribute pairs */
+        /* BH = Page Number */ /* We can't write to non-0 pages, yet. */
+        /* BL = Attribute, unless AL bit 1 is set */
+        /* CX = Length in characters */
+        /* DH,DL = row, col */
+        /* ES:BP = String */
         /* This one does not imply that string be at cursor. */
-        FIXME("Write String - Not Supported\n");
+        {
+            const BYTE *str = CTX_SEG_OFF_TO_LIN(context, context->SegEs, context->Ebp);
+            unsigned cols = data->VideoColumns, rows = data->RowsOnScreenMinus1 + 1;
+            unsigned col = DL_reg(context), row = DH_reg(context), count = CX_reg(context);
+            const VGA_MODE *ptr = VGA_GetModeInfo( INT10_GetHeap()->VesaCurrentMode );
+            BYTE blank = (ptr && ptr->ModeType == TEXT) ? 0x07 : 0x00;
+
+            TRACE("Write String (mode %d, %d chars) at %d/%d\n", AL_reg(context), count, col, row);
+            if (BH_reg(context))
+            {
+                FIXME("Write String: Cannot write to page %d\n", BH_reg(context));
+                break;
+            }
+            while (count--)
+            {
+                BYTE ascii = *str++;
+                BYTE attr = (AL_reg(context) & 2) ? *str++ : BL_reg(context);
+
+                switch (ascii)
+                {
+                case '\a':
+                    break;
+                case '\b':
+                    if (col) col--;
+                    break;
+                case '\n':
+                    row++;
+                    break;
+                case '\r':
+                    col = 0;
+                    break;
+                default:
+                    VGA_WriteChars(col, row, ascii, attr, 1);
+                    col++;
+                }
+                if (col >= cols)
+                {
+                    col = 0;
+                    row++;
+                }
+                if (row >= rows)
+                {
+                    row = rows - 1;
+                    VGA_ScrollUpText(0, 0, rows - 1, cols - 1, 1, blank);
+                }
+            }
+            if (AL_reg(context) & 1)
+            {
+                INT10_SetCursorPos(data, 0, col, row);
+                VGA_SetCursorPos(col, row);
+            }
+        }
         break;
 
     case 0x1a:
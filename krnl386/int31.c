@@ -199,11 +199,12 @@ static void INT_SetRealModeContext( REALMODECALL *call, CONTEXT *context, BOOL m
 }
 
 /**********************************************************************
- *          DPMI_xalloc
+ *          DPMI_VirtualAlloc
  * special virtualalloc, allocates linearly monoton growing memory.
  * (the usual VirtualAlloc does not satisfy that restriction)
+ * Used once the DPMI arena is exhausted.
  */
-static LPVOID DPMI_xalloc( DWORD len ) 
+static LPVOID DPMI_VirtualAlloc( DWORD len )
 {
     LPVOID  ret;
     LPVOID  oldlastv = lastvalloced;
@@ -253,23 +254,62 @@ static LPVOID DPMI_xalloc( DWORD len )
     return ret;
 }
 
+/**********************************************************************
+ *          DPMI_xalloc
+ */
+static LPVOID DPMI_xalloc( DWORD len )
+{
+    LPVOID ret;
+
+    if ((ret = DPMI_ArenaAlloc( len ))) return ret;
+    return DPMI_VirtualAlloc( len );
+}
+
 /**********************************************************************
  *          DPMI_xfree
  */
 static void DPMI_xfree( LPVOID ptr ) 
 {
+    if (DPMI_IsArenaPtr( ptr ))
+    {
+        if (!DPMI_ArenaFree( ptr )) FIXME( "free of unknown DPMI block %p\n", ptr );
+        return;
+    }
     VirtualFree( ptr, 0, MEM_RELEASE );
 }
 
 /**********************************************************************
  *          DPMI_xrealloc
  *
- * FIXME: perhaps we could grow this mapped area... 
+ * Blocks from the arena are resized in place when possible.
  */
 static LPVOID DPMI_xrealloc( LPVOID ptr, DWORD newsize )
 {
     MEMORY_BASIC_INFORMATION        mbi;
 
+    if (ptr && DPMI_IsArenaPtr( ptr ))
+    {
+        DWORD oldsize = DPMI_ArenaBlockSize( ptr );
+        LPVOID newptr;
+
+        if (!oldsize)
+        {
+            FIXME( "realloc of DPMI_xallocd region %p?\n", ptr );
+            return NULL;
+        }
+        if ((newptr = DPMI_ArenaReAlloc( ptr, newsize ))) return newptr;
+
+        /* the arena is full */
+        newptr = DPMI_VirtualAlloc( newsize );
+        if (!newptr)
+            return NULL;
+
+        memcpy( newptr, ptr, min( oldsize, newsize ) );
+        DPMI_xfree( ptr );
+
+        return newptr;
+    }
+
     if (ptr)
     {
         LPVOID newptr;
@@ -1355,10 +1395,26 @@ void WINAPI DOSVM_Int31Handler( CONTEXT *context )
                 WORD  wPageSize;
             } *info = CTX_SEG_OFF_TO_LIN( context, context->SegEs, context->Edi );
 
+            DWORD largest, free, total;
+
             GlobalMemoryStatus( &status );
             NtQuerySystemInformation( SystemBasicInformation, &sbi, sizeof(sbi), NULL );
 
             info->wPageSize            = sbi.PageSize;
+            info->dwSwapFilePages      = status.dwTotalPageFile / info->wPageSize;
+            if (DPMI_ArenaGetFreeInfo( &largest, &free, &total ))
+            {
+                /* what 0501h can actually hand out */
+                info->dwLargestFreeBlock   = largest;
+                info->dwMaxPagesAvailable  = largest / info->wPageSize;
+                info->dwMaxPagesLockable   = info->dwMaxPagesAvailable;
+                info->dwTotalLinearSpace   = total / info->wPageSize;
+                info->dwTotalUnlockedPages = info->dwTotalLinearSpace;
+                info->dwFreePages          = free / info->wPageSize;
+                info->dwTotalPages         = info->dwTotalLinearSpace;
+                info->dwFreeLinearSpace    = info->dwFreePages;
+                break;
+            }
             info->dwLargestFreeBlock   = min(status.dwAvailVirtual, 102400000);
             info->dwMaxPagesAvailable  = info->dwLargestFreeBlock / info->wPageSize;
             info->dwMaxPagesLockable   = info->dwMaxPagesAvailable;
@@ -1367,7 +1423,6 @@ void WINAPI DOSVM_Int31Handler( CONTEXT *context )
             info->dwFreePages          = info->dwMaxPagesAvailable;
             info->dwTotalPages         = info->dwTotalLinearSpace;
             info->dwFreeLinearSpace    = info->dwMaxPagesAvailable;
-            info->dwSwapFilePages      = status.dwTotalPageFile / info->wPageSize;
             break;
         }
 
@@ -28,19 +28,33 @@
 #include "winuser.h"
 #include "dosexe.h"
 #include "vga.h"
+#include "mousestate.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(int);
 
-static struct
+/* mousestate.c keeps the state, this file draws the cursor and queues the callbacks */
+static struct mouse_state mouse_info = MOUSE_STATE_INIT;
+
+/* last queued callback event, motion can still be merged into it */
+static MCALLDATA *mouse_pending;
+
+static CRITICAL_SECTION mouse_cs;
+static CRITICAL_SECTION_DEBUG mouse_cs_debug =
+{
+    0, 0, &mouse_cs,
+    { &mouse_cs_debug.ProcessLocksList, &mouse_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": mouse_cs") }
+};
+static CRITICAL_SECTION mouse_cs = { &mouse_cs_debug, -1, 0, 0, 0, 0 };
+
+
+/* tell the display when a state change hid the cursor */
+static void INT33_UpdateCursor( BOOL was_visible )
 {
-    WORD x, y, but;
-    WORD lbcount, rbcount, rlastx, rlasty, llastx, llasty;
-    FARPROC16 callback;
-    WORD callmask;
-    WORD VMPratio, HMPratio, oldx, oldy;
-    WORD hide_count;
-} mouse_info;
+    if (was_visible && mouse_info.hide_count)
+        VGA_ShowMouse( FALSE );
+}
 
 
 /**********************************************************************
@@ -52,15 +66,8 @@ static struct
  */
 static void INT33_ResetMouse( CONTEXT *context )
 {
-    memset( &mouse_info, 0, sizeof(mouse_info) );
-    
-    /* Set the default mickey/pixel ratio */
-    mouse_info.HMPratio = 8;
-    mouse_info.VMPratio = 16;
-
-    /* Hide the mouse cursor */
-    mouse_info.hide_count = 1;
-    VGA_ShowMouse( FALSE );    
+    mouse_state_reset( &mouse_info );
+    VGA_ShowMouse( FALSE );
 
     if (context)
     {
@@ -87,8 +94,7 @@ void WINAPI DOSVM_Int33Handler( CONTEXT *context )
     case 0x0001:
         TRACE("Show mouse cursor, old hide count: %d\n",
               mouse_info.hide_count);
-        if (mouse_info.hide_count >= 1)
-            mouse_info.hide_count--;
+        mouse_state_show( &mouse_info, TRUE );
         if (!mouse_info.hide_count)
             VGA_ShowMouse( TRUE );
         break;
@@ -98,7 +104,7 @@ void WINAPI DOSVM_Int33Handler( CONTEXT *context )
               mouse_info.hide_count);
         if(!mouse_info.hide_count)
             VGA_ShowMouse( FALSE );            
-        mouse_info.hide_count++;
+        mouse_state_show( &mouse_info, FALSE );
         break;
 
     case 0x0003:
@@ -110,38 +116,46 @@ void WINAPI DOSVM_Int33Handler( CONTEXT *context )
         break;
 
     case 0x0004:
-        FIXME("Position mouse cursor\n");
+        TRACE("Position mouse cursor (%d,%d)\n",
+              (SHORT)CX_reg(context), (SHORT)DX_reg(context));
+    {
+        BOOL visible = !mouse_info.hide_count;
+        mouse_state_set_position( &mouse_info, (SHORT)CX_reg(context), (SHORT)DX_reg(context) );
+        INT33_UpdateCursor( visible );
         break;
+    }
 
     case 0x0005:
         TRACE("Return Mouse button press Information for %s mouse button\n",
               BX_reg(context) ? "right" : "left");
-        if (BX_reg(context)) 
-        {
-            SET_BX( context, mouse_info.rbcount );
-            mouse_info.rbcount = 0;
-            SET_CX( context, mouse_info.rlastx );
-            SET_DX( context, mouse_info.rlasty );
-        } 
-        else 
-        {
-            SET_BX( context, mouse_info.lbcount );
-            mouse_info.lbcount = 0;
-            SET_CX( context, mouse_info.llastx );
-            SET_DX( context, mouse_info.llasty );
-        }
+    {
+        WORD x, y;
+        SET_BX( context, mouse_state_read_presses( &mouse_info, BX_reg(context) != 0, &x, &y ) );
+        SET_CX( context, x );
+        SET_DX( context, y );
         SET_AX( context, mouse_info.but );
         break;
+    }
 
     case 0x0007:
-        FIXME("Define horizontal mouse cursor range %d..%d\n",
-              CX_reg(context), DX_reg(context));
+        TRACE("Define horizontal mouse cursor range %d..%d\n",
+              (SHORT)CX_reg(context), (SHORT)DX_reg(context));
+    {
+        BOOL visible = !mouse_info.hide_count;
+        mouse_state_set_range( &mouse_info, FALSE, (SHORT)CX_reg(context), (SHORT)DX_reg(context) );
+        INT33_UpdateCursor( visible );
         break;
+    }
 
     case 0x0008:
-        FIXME("Define vertical mouse cursor range %d..%d\n",
-              CX_reg(context), DX_reg(context));
+        TRACE("Define vertical mouse cursor range %d..%d\n",
+              (SHORT)CX_reg(context), (SHORT)DX_reg(context));
+    {
+        BOOL visible = !mouse_info.hide_count;
+        mouse_state_set_range( &mouse_info, TRUE, (SHORT)CX_reg(context), (SHORT)DX_reg(context) );
+        INT33_UpdateCursor( visible );
         break;
+    }
 
     case 0x0009:
         FIXME("Define graphics mouse cursor\n");
@@ -152,20 +166,15 @@ void WINAPI DOSVM_Int33Handler( CONTEXT *context )
         break;
 
     case 0x000B:
-        TRACE("Read Mouse motion counters\n");
-        {
-            int dx = ((int)mouse_info.x - (int)mouse_info.oldx)
-                * (mouse_info.HMPratio / 8);
-            int dy = ((int)mouse_info.y - (int)mouse_info.oldy)
-                * (mouse_info.VMPratio / 8);
-
-            SET_CX( context, (WORD)dx );
-            SET_DX( context, (WORD)dy );
-
-            mouse_info.oldx = mouse_info.x;
-            mouse_info.oldy = mouse_info.y;
-        }
+        TRACE("Read Mouse motion counters (%d,%d)\n",
+              mouse_info.mickeyx, mouse_info.mickeyy);
+    {
+        SHORT mx, my;
+        mouse_state_read_motion( &mouse_info, &mx, &my );
+        SET_CX( context, (WORD)mx );
+        SET_DX( context, (WORD)my );
         break;
+    }
 
     case 0x000C:
         TRACE("Define mouse interrupt subroutine\n");
@@ -181,8 +190,16 @@ void WINAPI DOSVM_Int33Handler( CONTEXT *context )
         break;
 
     case 0x0010:
-        FIXME("Define screen region for update\n");
+        TRACE("Define screen region for update (%d,%d)-(%d,%d)\n",
+              (SHORT)CX_reg(context), (SHORT)DX_reg(context),
+              (SHORT)SI_reg(context), (SHORT)DI_reg(context));
+    {
+        BOOL visible = !mouse_info.hide_count;
+        mouse_state_set_exclude( &mouse_info, (SHORT)CX_reg(context), (SHORT)DX_reg(context),
+                                 (SHORT)SI_reg(context), (SHORT)DI_reg(context) );
+        INT33_UpdateCursor( visible );
         break;
+    }
 
     case 0x0015:
         TRACE("Get mouse driver state and memory requirements\n");
@@ -199,100 +216,66 @@ void WINAPI DOSVM_Int33Handler( CONTEXT *context )
     }
 }
 
-typedef struct {
-  FARPROC16 proc;
-  WORD mask,but,x,y,mx,my;
-} MCALLDATA;
-
 static void MouseRelay(CONTEXT *context,void *mdata)
 {
-  MCALLDATA *data = mdata;
+  MCALLDATA data;
   CONTEXT ctx = *context;
 
+  /* nothing more can be merged into the event once it is delivered */
+  EnterCriticalSection(&mouse_cs);
+  data = *(MCALLDATA *)mdata;
+  if (mouse_pending == mdata)
+    mouse_pending = NULL;
+  LeaveCriticalSection(&mouse_cs);
+  HeapFree(GetProcessHeap(), 0, mdata);
+
   if (!ISV86(&ctx))
   {
       ctx.EFlags |= V86_FLAG;
       ctx.SegSs = 0; /* Allocate new stack. */
   }
 
-  ctx.Eax   = data->mask;
-  ctx.Ebx   = data->but;
-  ctx.Ecx   = data->x;
-  ctx.Edx   = data->y;
-  ctx.Esi   = data->mx;
-  ctx.Edi   = data->my;
-  ctx.SegCs = SELECTOROF(data->proc);
-  ctx.Eip   = OFFSETOF(data->proc);
-  HeapFree(GetProcessHeap(), 0, data);
+  ctx.Eax   = data.mask;
+  ctx.Ebx   = data.but;
+  ctx.Ecx   = data.x;
+  ctx.Edx   = data.y;
+  ctx.Esi   = data.mx;
+  ctx.Edi   = data.my;
+  ctx.SegCs = SELECTOROF(data.proc);
+  ctx.Eip   = OFFSETOF(data.proc);
   DPMI_CallRMProc(&ctx, NULL, 0, 0);
 }
 
-static void QueueMouseRelay(DWORD mx, DWORD my, WORD mask)
+static void QueueMouseRelay(int mx, int my, WORD mask)
 {
-  mouse_info.x = mx;
-  mouse_info.y = my;
-
-  /* Left button down */
-  if(mask & 0x02) {
-    mouse_info.but |= 0x01;
-    mouse_info.llastx = mx;
-    mouse_info.llasty = my;
-    mouse_info.lbcount++;
-  }
+  MCALLDATA *data;
+  BOOL visible = !mouse_info.hide_count;
 
-  /* Left button up */
-  if(mask & 0x04) {
-    mouse_info.but &= ~0x01;
-  }
+  mouse_state_pointer(&mouse_info, mx, my, mask);
+  INT33_UpdateCursor(visible);
 
-  /* Right button down */
-  if(mask & 0x08) {
-    mouse_info.but |= 0x02;
-    mouse_info.rlastx = mx;
-    mouse_info.rlasty = my;
-    mouse_info.rbcount++;
-  }
+  if (!(mask & mouse_info.callmask) || !mouse_info.callback)
+    return;
 
-  /* Right button up */
-  if(mask & 0x10) {
-    mouse_info.but &= ~0x02;
+  EnterCriticalSection(&mouse_cs);
+  if (mouse_event_merge(mouse_pending, &mouse_info, mask)) {
+    LeaveCriticalSection(&mouse_cs);
+    return;
   }
-
-  /* Middle button down */
-  if(mask & 0x20) {
-    mouse_info.but |= 0x04;
-  }
-
-  /* Middle button up */
-  if(mask & 0x40) {
-    mouse_info.but &= ~0x04;
+  data = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(MCALLDATA));
+  if (!data) {
+    LeaveCriticalSection(&mouse_cs);
+    return;
   }
+  mouse_event_fill(data, &mouse_info, mask);
+  mouse_pending = data;
+  LeaveCriticalSection(&mouse_cs);
 
-  if ((mask & mouse_info.callmask) && mouse_info.callback) {
-    MCALLDATA *data = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(MCALLDATA));
-    data->proc = mouse_info.callback;
-    data->mask = mask & mouse_info.callmask;
-    data->but = mouse_info.but;
-    data->x = mouse_info.x;
-    data->y = mouse_info.y;
-
-    /*
-     * Fake mickeys. 
-     *
-     * FIXME: This is not entirely correct. If mouse if moved to the edge
-     *        of the screen, mouse will stop moving and mickeys won't
-     *        be updated even though they should be.
-     */
-    data->mx = mouse_info.x * (mouse_info.HMPratio / 8);
-    data->my = mouse_info.y * (mouse_info.VMPratio / 8);
-
-    DOSVM_QueueEvent(-1, DOS_PRIORITY_MOUSE, MouseRelay, data);
-  }
+  DOSVM_QueueEvent(-1, DOS_PRIORITY_MOUSE, MouseRelay, data);
 }
 
 void DOSVM_Int33Message(UINT message,WPARAM wParam,LPARAM lParam)
 {
-  WORD mask = 0;
   unsigned Height, Width, SX=1, SY=1;
 
   if (VGA_GetMode(&Height, &Width, NULL)) {
@@ -302,64 +285,17 @@ void DOSVM_Int33Message(UINT message,WPARAM wParam,LPARAM lParam)
     if (!SX) SX=1;
   }
 
-  switch (message) {
-  case WM_MOUSEMOVE:
-    mask |= 0x01;
-    break;
-  case WM_LBUTTONDOWN:
-  case WM_LBUTTONDBLCLK:
-    mask |= 0x02;
-    break;
-  case WM_LBUTTONUP:
-    mask |= 0x04;
-    break;
-  case WM_RBUTTONDOWN:
-  case WM_RBUTTONDBLCLK:
-    mask |= 0x08;
-    break;
-  case WM_RBUTTONUP:
-    mask |= 0x10;
-    break;
-  case WM_MBUTTONDOWN:
-  case WM_MBUTTONDBLCLK:
-    mask |= 0x20;
-    break;
-  case WM_MBUTTONUP:
-    mask |= 0x40;
-    break;
-  }
-
-  QueueMouseRelay(LOWORD(lParam) * SX,
-                 HIWORD(lParam) * SY,
-                 mask);
+  /* coordinates are signed while the mouse is captured */
+  QueueMouseRelay((SHORT)LOWORD(lParam) * (int)SX,
+                 (SHORT)HIWORD(lParam) * (int)SY,
+                 mouse_message_mask(message));
 }
 
 void DOSVM_Int33Console(MOUSE_EVENT_RECORD *record)
 {
   unsigned Height, Width;
-  WORD mask = 0;
-  BOOL newLeftButton = record->dwButtonState & FROM_LEFT_1ST_BUTTON_PRESSED;
-  BOOL oldLeftButton = mouse_info.but & 0x01;
-  BOOL newRightButton = record->dwButtonState & RIGHTMOST_BUTTON_PRESSED;
-  BOOL oldRightButton = mouse_info.but & 0x02;
-  BOOL newMiddleButton = record->dwButtonState & FROM_LEFT_2ND_BUTTON_PRESSED;
-  BOOL oldMiddleButton = mouse_info.but & 0x04;
-
-  if(newLeftButton && !oldLeftButton)
-    mask |= 0x02;
-  else if(!newLeftButton && oldLeftButton)
-    mask |= 0x04;
-
-  if(newRightButton && !oldRightButton)
-    mask |= 0x08;
-  else if(!newRightButton && oldRightButton)
-    mask |= 0x10;
-
-  if(newMiddleButton && !oldMiddleButton)
-    mask |= 0x20;
-  else if(!newMiddleButton && oldMiddleButton)
-    mask |= 0x40;
-  
+  WORD mask = mouse_console_mask(&mouse_info, record->dwButtonState, record->dwEventFlags);
+
   if (VGA_GetAlphaMode(&Width, &Height))
     QueueMouseRelay( 640 / Width * record->dwMousePosition.X,
                      200 / Height * record->dwMousePosition.Y,
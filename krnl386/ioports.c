@@ -30,6 +30,7 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #ifdef HAVE_SYS_STAT_H
 # include <sys/stat.h>
@@ -744,6 +745,328 @@ void DOSVM_setportcb(OUTPROC outproc, INPROC inproc, int port, OUTPROC *oldout,
 
 BOOL vdd_io_read(int port, int size, WORD *val, CONTEXT *ctx);
 BOOL vdd_io_write(int port, int size, WORD val, CONTEXT *ctx);
+BOOL vdd_io_hooked(int port);
+
+/**********************************************************************
+ *	    Built-in devices
+ *
+ * Each device takes byte accesses to its own registers. A word or dword
+ * access whose bytes all belong to the same device goes straight to the
+ * device handler instead of being split and dispatched again byte by byte.
+ */
+
+static BYTE pit_ioport_in( WORD port )
+{
+    BYTE chan = port & 3;
+    WORD tempval = tmr_8253[chan].flags & TMR_LATCHED
+        ? tmr_8253[chan].latch : get_timer_val(chan);
+    BYTE res = 0;
+
+    if (tmr_8253[chan].flags & TMR_STATUS)
+    {
+        WARN("Read-back status\n");
+        /* We differ slightly from the spec:
+         * - TMR_UPDATE is already set with the first write
+         *   of a two byte counter update
+         * - 0x80 should be set if OUT signal is 1 (high)
+         */
+        tmr_8253[chan].flags &= ~TMR_STATUS;
+        return (tmr_8253[chan].ctrlbyte_ch & 0x3F) |
+            (tmr_8253[chan].flags & TMR_UPDATE ? 0x40 : 0x00);
+    }
+    switch ((tmr_8253[chan].ctrlbyte_ch & 0x30) >> 4)
+    {
+    case 0:
+        res = 0; /* shouldn't happen? */
+        break;
+    case 1: /* read lo byte */
+        res = (BYTE)tempval;
+        tmr_8253[chan].flags &= ~TMR_LATCHED;
+        break;
+    case 3: /* read lo byte, then hi byte */
+        tmr_8253[chan].flags ^= TMR_RTOGGLE; /* toggle */
+        if (tmr_8253[chan].flags & TMR_RTOGGLE)
+        {
+            res = (BYTE)tempval;
+            break;
+        }
+        /* else [fall through if read hi byte !] */
+    case 2: /* read hi byte */
+        res = (BYTE)(tempval >> 8);
+        tmr_8253[chan].flags &= ~TMR_LATCHED;
+        break;
+    }
+    return res;
+}
+
+static void pit_ioport_out( WORD port, BYTE value )
+{
+    BYTE chan;
+
+    if (port != 0x43)
+    {
+        chan = port & 3;
+        tmr_8253[chan].flags |= TMR_UPDATE;
+        switch ((tmr_8253[chan].ctrlbyte_ch & 0x30) >> 4)
+        {
+        case 0:
+            break; /* shouldn't happen? */
+        case 1: /* write lo byte */
+            tmr_8253[chan].countmax =
+                (tmr_8253[chan].countmax & 0xff00) | value;
+            break;
+        case 3: /* write lo byte, then hi byte */
+            tmr_8253[chan].flags ^= TMR_WTOGGLE; /* toggle */
+            if (tmr_8253[chan].flags & TMR_WTOGGLE)
+            {
+                tmr_8253[chan].countmax =
+                    (tmr_8253[chan].countmax & 0xff00) | value;
+                break;
+            }
+            /* else [fall through if write hi byte !] */
+        case 2: /* write hi byte */
+            tmr_8253[chan].countmax =
+                (tmr_8253[chan].countmax & 0x00ff) | (value << 8);
+            break;
+        }
+        /* if programming is finished, update to new value */
+        if ((tmr_8253[chan].ctrlbyte_ch & 0x30) &&
+            !(tmr_8253[chan].flags & TMR_WTOGGLE))
+            set_timer(chan);
+        return;
+    }
+
+    chan = (value & 0xc0) >> 6;
+    /* ctrl byte for specific timer channel */
+    if (chan == 3)
+    {
+        if ( !(value & 0x20) )
+        {
+            if ((value & 0x02) && !(tmr_8253[0].flags & TMR_LATCHED))
+            {
+                tmr_8253[0].flags |= TMR_LATCHED;
+                tmr_8253[0].latch = get_timer_val(0);
+            }
+            if ((value & 0x04) && !(tmr_8253[1].flags & TMR_LATCHED))
+            {
+                tmr_8253[1].flags |= TMR_LATCHED;
+                tmr_8253[1].latch = get_timer_val(1);
+            }
+            if ((value & 0x08) && !(tmr_8253[2].flags & TMR_LATCHED))
+            {
+                tmr_8253[2].flags |= TMR_LATCHED;
+                tmr_8253[2].latch = get_timer_val(2);
+            }
+        }
+
+        if ( !(value & 0x10) )
+        {
+            if (value & 0x02)
+                tmr_8253[0].flags |= TMR_STATUS;
+            if (value & 0x04)
+                tmr_8253[1].flags |= TMR_STATUS;
+            if (value & 0x08)
+                tmr_8253[2].flags |= TMR_STATUS;
+        }
+        return;
+    }
+    switch ((value & 0x30) >> 4)
+    {
+    case 0:	/* latch timer */
+        if ( !(tmr_8253[chan].flags & TMR_LATCHED) )
+        {
+            tmr_8253[chan].flags |= TMR_LATCHED;
+            tmr_8253[chan].latch = get_timer_val(chan);
+        }
+        break;
+    case 1:	/* write lo byte only */
+    case 2:	/* write hi byte only */
+    case 3:	/* write lo byte, then hi byte */
+        tmr_8253[chan].ctrlbyte_ch = value;
+        tmr_8253[chan].countmax = 0;
+        tmr_8253[chan].flags = TMR_UPDATE;
+        break;
+    }
+}
+
+static BYTE kbd_ioport_in( WORD port )
+{
+    return DOSVM_Int09ReadScan(NULL);
+}
+
+static BYTE ppi_ioport_in( WORD port )
+{
+    return parport_8255[port & 3];
+}
+
+static void ppi_ioport_out( WORD port, BYTE value )
+{
+    parport_8255[1] = value;
+    if (((parport_8255[1] & 3) == 3) && (tmr_8253[2].countmax != 1))
+    {
+        if (tmr_8253[2].countmax == 0)
+        {
+            ERR("Beep tmr_8253[2].countmax == 0 !\n", tmr_8253[2].countmax);
+            return;
+        }
+        TRACE("Beep (freq: %d) !\n", 1193180 / tmr_8253[2].countmax);
+        Beep(1193180 / tmr_8253[2].countmax, 20);
+    }
+}
+
+static BYTE cmos_ioport_in( WORD port )
+{
+    if (port == 0x70) return cmosaddress;
+    if (!cmos_image_initialized)
+    {
+        IO_FixCMOSCheckSum();
+        cmos_image_initialized = TRUE;
+    }
+    return cmosimage[cmosaddress & 0x3f];
+}
+
+static void cmos_ioport_out( WORD port, BYTE value )
+{
+    if (port == 0x70)
+    {
+        cmosaddress = value & 0x7f;
+        return;
+    }
+    if (!cmos_image_initialized)
+    {
+        IO_FixCMOSCheckSum();
+        cmos_image_initialized = TRUE;
+    }
+    cmosimage[cmosaddress & 0x3f] = value;
+}
+
+static BYTE joystick_ioport_in( WORD port )
+{
+    return 0xff; /* no joystick */
+}
+
+struct io_device
+{
+    BYTE (*in)( WORD port );
+    void (*out)( WORD port, BYTE value );
+    /* optional, a string instruction writing one port */
+    void (*out_block)( WORD port, const BYTE *data, DWORD count );
+};
+
+enum io_device_id
+{
+    IO_NONE, IO_DMA, IO_PIC, IO_PIT, IO_KBD, IO_PPI, IO_CMOS, IO_JOYSTICK, IO_SB, IO_VGA
+};
+
+static const struct io_device io_devices[] =
+{
+    { NULL },                                                  /* IO_NONE */
+    { DMA_ioport_in, DMA_ioport_out },                         /* IO_DMA */
+    { NULL, DOSVM_PIC_ioport_out },                            /* IO_PIC */
+    { pit_ioport_in, pit_ioport_out },                         /* IO_PIT */
+    { kbd_ioport_in, NULL },                                   /* IO_KBD */
+    { ppi_ioport_in, ppi_ioport_out },                         /* IO_PPI */
+    { cmos_ioport_in, cmos_ioport_out },                       /* IO_CMOS */
+    { joystick_ioport_in, NULL },                              /* IO_JOYSTICK */
+    { SB_ioport_in, SB_ioport_out },                           /* IO_SB */
+    { VGA_ioport_in, VGA_ioport_out, VGA_ioport_out_block },   /* IO_VGA */
+};
+
+#define IO_DEV_IN   1
+#define IO_DEV_OUT  2
+
+static const struct
+{
+    WORD first;
+    WORD last;
+    BYTE device;
+    BYTE access;
+} io_port_ranges[] =
+{
+    { 0x00,  0x08,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x09,  0x0c,  IO_DMA,      IO_DEV_OUT },
+    { 0x0d,  0x0d,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x0e,  0x0f,  IO_DMA,      IO_DEV_OUT },
+    { 0x20,  0x20,  IO_PIC,      IO_DEV_OUT },
+    { 0x40,  0x42,  IO_PIT,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x43,  0x43,  IO_PIT,      IO_DEV_OUT },
+    { 0x60,  0x60,  IO_KBD,      IO_DEV_IN },
+    { 0x61,  0x61,  IO_PPI,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x62,  0x62,  IO_PPI,      IO_DEV_IN },
+    { 0x70,  0x71,  IO_CMOS,     IO_DEV_IN | IO_DEV_OUT },
+    { 0x81,  0x83,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x87,  0x87,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x89,  0x8b,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xc0,  0xc0,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xc2,  0xc2,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xc4,  0xc4,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xc6,  0xc6,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xc8,  0xc8,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xca,  0xca,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xcc,  0xcc,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xce,  0xce,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xd0,  0xd0,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xd2,  0xd2,  IO_DMA,      IO_DEV_OUT },
+    { 0xd4,  0xd4,  IO_DMA,      IO_DEV_OUT },
+    { 0xd6,  0xd6,  IO_DMA,      IO_DEV_OUT },
+    { 0xd8,  0xd8,  IO_DMA,      IO_DEV_OUT },
+    { 0xda,  0xda,  IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0xdc,  0xdc,  IO_DMA,      IO_DEV_OUT },
+    { 0xde,  0xde,  IO_DMA,      IO_DEV_OUT },
+    { 0x200, 0x201, IO_JOYSTICK, IO_DEV_IN },
+    { 0x226, 0x226, IO_SB,       IO_DEV_OUT },
+    { 0x22a, 0x22a, IO_SB,       IO_DEV_IN },
+    { 0x22c, 0x22c, IO_SB,       IO_DEV_IN | IO_DEV_OUT },
+    { 0x22e, 0x22e, IO_SB,       IO_DEV_IN },
+    { 0x3b4, 0x3b5, IO_VGA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x3ba, 0x3ba, IO_VGA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x3c0, 0x3df, IO_VGA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x481, 0x483, IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x487, 0x487, IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+    { 0x489, 0x48b, IO_DMA,      IO_DEV_IN | IO_DEV_OUT },
+};
+
+#define IO_MAP_SIZE 0x500
+
+/* port -> enum io_device_id, built from io_port_ranges on first use */
+static BYTE io_in_map[IO_MAP_SIZE];
+static BYTE io_out_map[IO_MAP_SIZE];
+static BOOL io_map_initialized;
+
+static void IO_init_device_map(void)
+{
+    unsigned int i, port;
+
+    for (i = 0; i < ARRAY_SIZE(io_port_ranges); i++)
+    {
+        for (port = io_port_ranges[i].first; port <= io_port_ranges[i].last; port++)
+        {
+            if (io_port_ranges[i].access & IO_DEV_IN) io_in_map[port] = io_port_ranges[i].device;
+            if (io_port_ranges[i].access & IO_DEV_OUT) io_out_map[port] = io_port_ranges[i].device;
+        }
+    }
+    io_map_initialized = TRUE;
+}
+
+/* the built-in device taking all bytes of an access, unless a callback or a VDD hooks one of them */
+static const struct io_device *IO_get_device( int port, int size, BOOL out )
+{
+    const BYTE *map = out ? io_out_map : io_in_map;
+    BYTE device;
+    int i;
+
+    if (port < 0 || port + size > IO_MAP_SIZE) return NULL;
+    if (!io_map_initialized) IO_init_device_map();
+    if (!(device = map[port])) return NULL;
+    for (i = 0; i < size; i++)
+    {
+        if (map[port + i] != device) return NULL;
+        if (port + i < ARRAY_SIZE(incb) && (out ? outcb[port + i] != NULL : incb[port + i] != NULL))
+            return NULL;
+        if (vdd_io_hooked( port + i )) return NULL;
+    }
+    return &io_devices[device];
+}
 
 /**********************************************************************
  *	    DOSVM_inport
@@ -753,7 +1076,9 @@ BOOL vdd_io_write(int port, int size, WORD val, CONTEXT *ctx);
  */
 DWORD DOSVM_inport( int port, int size, CONTEXT* ctx )
 {
+    const struct io_device *device;
     DWORD res = ~0U;
+    int i;
 
     TRACE("%d-byte value from port 0x%04x\n", size, port );
 
@@ -787,174 +1112,26 @@ DWORD DOSVM_inport( int port, int size, CONTEXT* ctx )
     }
 #endif
 
-    switch (size)
+    if (size <= 2 && vdd_io_read(port, size, (WORD *)&res, ctx))
+        return res;
+
+    if ((device = IO_get_device( port, size, FALSE )))
     {
-        case 4:
-            res |= DOSVM_inport(port, 2, ctx);
-            res |= DOSVM_inport(port + 2, 2, ctx) << 16;
-            return res;
-        case 2:
-            if (!vdd_io_read(port, 2, &res, ctx))
-            {
-                res |= DOSVM_inport(port, 1, ctx);
-                res |= DOSVM_inport(port + 1, 1, ctx) << 8;
-            }
-            return res;
-        case 1:
-            if (vdd_io_read(port, 1, &res, ctx))
-                return res;
+        res = 0;
+        for (i = 0; i < size; i++)
+            res |= (DWORD)device->in( port + i ) << (i * 8);
+        return res;
     }
-    switch (port)
-    {
-    case 0x40:
-    case 0x41:
-    case 0x42:
-        {
-            BYTE chan = port & 3;
-            WORD tempval = tmr_8253[chan].flags & TMR_LATCHED
-                ? tmr_8253[chan].latch : get_timer_val(chan);
 
-            if (tmr_8253[chan].flags & TMR_STATUS)
-            {
-                WARN("Read-back status\n");
-                /* We differ slightly from the spec:
-                 * - TMR_UPDATE is already set with the first write
-                 *   of a two byte counter update
-                 * - 0x80 should be set if OUT signal is 1 (high)
-                 */
-                tmr_8253[chan].flags &= ~TMR_STATUS;
-                res = (tmr_8253[chan].ctrlbyte_ch & 0x3F) |
-                    (tmr_8253[chan].flags & TMR_UPDATE ? 0x40 : 0x00);
-                break;
-            }
-            switch ((tmr_8253[chan].ctrlbyte_ch & 0x30) >> 4)
-            {
-            case 0:
-                res = 0; /* shouldn't happen? */
-                break;
-            case 1: /* read lo byte */
-                res = (BYTE)tempval;
-                tmr_8253[chan].flags &= ~TMR_LATCHED;
-                break;
-            case 3: /* read lo byte, then hi byte */
-                tmr_8253[chan].flags ^= TMR_RTOGGLE; /* toggle */
-                if (tmr_8253[chan].flags & TMR_RTOGGLE)
-                {
-                    res = (BYTE)tempval;
-                    break;
-                }
-                /* else [fall through if read hi byte !] */
-            case 2: /* read hi byte */
-                res = (BYTE)(tempval >> 8);
-                tmr_8253[chan].flags &= ~TMR_LATCHED;
-                break;
-            }
-        }
-        break;
-    case 0x60:
-        res = DOSVM_Int09ReadScan(NULL);
-        break;
-    case 0x61:
-        res = (DWORD)parport_8255[1];
-        break;
-    case 0x62:
-        res = (DWORD)parport_8255[2];
-        break;
-    case 0x70:
-        res = (DWORD)cmosaddress;
-        break;
-    case 0x71:
-        if (!cmos_image_initialized)
-        {
-            IO_FixCMOSCheckSum();
-            cmos_image_initialized = TRUE;
-        }
-        res = (DWORD)cmosimage[cmosaddress & 0x3f];
-        break;
-    case 0x200:
-    case 0x201:
-        res = ~0U; /* no joystick */
-        break;
-    case 0x22a:
-    case 0x22c:
-    case 0x22e:
-        res = (DWORD)SB_ioport_in( port );
-	break;
-    /* VGA read registers */
-    case 0x3b4:  /* CRT Controller Register - Index (MDA) */
-    case 0x3b5:  /* CRT Controller Register - Other (MDA) */
-    case 0x3ba:  /* General Register - Input status 1 (MDA) */
-    case 0x3c0:  /* Attribute Controller - Address */
-    case 0x3c1:  /* Attribute Controller - Other */
-    case 0x3c2:  /* General Register - Input status 0 */
-    case 0x3c3:  /* General Register - Video subsystem enable */
-    case 0x3c4:  /* Sequencer Register - Address */
-    case 0x3c5:  /* Sequencer Register - Other */
-    case 0x3c6:
-    case 0x3c7:  /* General Register -  DAC State */
-    case 0x3c8:
-    case 0x3c9:
-    case 0x3ca:  /* General Register - Feature control */
-    case 0x3cb:
-    case 0x3cc:  /* General Register - Misc output */
-    case 0x3cd:
-    case 0x3ce:  /* Graphics Controller Register - Address */
-    case 0x3cf:  /* Graphics Controller Register - Other */
-    case 0x3d0:
-    case 0x3d1:
-    case 0x3d2:
-    case 0x3d3:
-    case 0x3d4:  /* CRT Controller Register - Index (CGA) */
-    case 0x3d5:  /* CRT Controller Register - Other (CGA) */
-    case 0x3d6:
-    case 0x3d7:
-    case 0x3d8:
-    case 0x3d9:
-    case 0x3da:
-    case 0x3db:
-    case 0x3dc:
-    case 0x3dd:
-    case 0x3de:
-    case 0x3df:
-        if (size > 1)
-            FIXME("Trying to read more than one byte from VGA!\n");
-        res = (DWORD)VGA_ioport_in( port );
+    switch (size)
+    {
+    case 4:
+        res = DOSVM_inport(port, 2, ctx) & 0xffff;
+        res |= DOSVM_inport(port + 2, 2, ctx) << 16;
         break;
-    case 0x00:
-    case 0x01:
-    case 0x02:
-    case 0x03:
-    case 0x04:
-    case 0x05:
-    case 0x06:
-    case 0x07:
-    case 0xC0:
-    case 0xC2:
-    case 0xC4:
-    case 0xC6:
-    case 0xC8:
-    case 0xCA:
-    case 0xCC:
-    case 0xCE:
-    case 0x87:
-    case 0x83:
-    case 0x81:
-    case 0x82:
-    case 0x8B:
-    case 0x89:
-    case 0x8A:
-    case 0x487:
-    case 0x483:
-    case 0x481:
-    case 0x482:
-    case 0x48B:
-    case 0x489:
-    case 0x48A:
-    case 0x08:
-    case 0xD0:
-    case 0x0D:
-    case 0xDA:
-        res = (DWORD)DMA_ioport_in( port );
+    case 2:
+        res = DOSVM_inport(port, 1, ctx) & 0xff;
+        res |= (DOSVM_inport(port + 1, 1, ctx) & 0xff) << 8;
         break;
     default:
         WARN("Direct I/O read attempted from port %x\n", port);
@@ -969,6 +1146,9 @@ DWORD DOSVM_inport( int port, int size, CONTEXT* ctx )
  */
 void DOSVM_outport( int port, int size, DWORD value, CONTEXT *ctx )
 {
+    const struct io_device *device;
+    int i;
+
     TRACE("IO: 0x%x (%d-byte value) to port 0x%04x\n", value, size, port );
 
     if (0 <= port && port < ARRAY_SIZE(outcb) && outcb[port]) return outcb[port](port, size, value);
@@ -1002,241 +1182,98 @@ void DOSVM_outport( int port, int size, DWORD value, CONTEXT *ctx )
     }
 #endif
 
-    switch (size)
+    if (size <= 2 && vdd_io_write(port, size, value, ctx))
+        return;
+
+    if ((device = IO_get_device( port, size, TRUE )))
     {
-        case 4:
-            DOSVM_outport(port, 2, value & 0xffff, ctx);
-            DOSVM_outport(port + 2, 2, value >> 16, ctx);
-            return;
-        case 2:
-            if (!vdd_io_write(port, 2, value, ctx))
-            {
-                DOSVM_outport(port, 1, value & 0xff, ctx);
-                DOSVM_outport(port + 1, 1, value >> 8, ctx);
-            }
-            return;
-        case 1:
-            if (vdd_io_write(port, 1, value, ctx))
-                return;
+        for (i = 0; i < size; i++)
+            device->out( port + i, (BYTE)(value >> (i * 8)) );
+        return;
     }
-    switch (port)
-    {
-    case 0x20:
-        DOSVM_PIC_ioport_out( port, (BYTE)value );
-        break;
-    case 0x40:
-    case 0x41:
-    case 0x42:
-        {
-            BYTE chan = port & 3;
 
-            tmr_8253[chan].flags |= TMR_UPDATE;
-            switch ((tmr_8253[chan].ctrlbyte_ch & 0x30) >> 4)
-            {
-            case 0:
-                break; /* shouldn't happen? */
-            case 1: /* write lo byte */
-                tmr_8253[chan].countmax =
-                    (tmr_8253[chan].countmax & 0xff00) | (BYTE)value;
-                break;
-            case 3: /* write lo byte, then hi byte */
-                tmr_8253[chan].flags ^= TMR_WTOGGLE; /* toggle */
-                if (tmr_8253[chan].flags & TMR_WTOGGLE)
-                {
-                    tmr_8253[chan].countmax =
-                        (tmr_8253[chan].countmax & 0xff00) | (BYTE)value;
-                    break;
-                }
-                /* else [fall through if write hi byte !] */
-            case 2: /* write hi byte */
-                tmr_8253[chan].countmax =
-                    (tmr_8253[chan].countmax & 0x00ff) | ((BYTE)value << 8);
-                break;
-            }
-            /* if programming is finished, update to new value */
-            if ((tmr_8253[chan].ctrlbyte_ch & 0x30) &&
-                !(tmr_8253[chan].flags & TMR_WTOGGLE))
-                set_timer(chan);
-        }
+    switch (size)
+    {
+    case 4:
+        DOSVM_outport(port, 2, value & 0xffff, ctx);
+        DOSVM_outport(port + 2, 2, value >> 16, ctx);
         break;
-    case 0x43:
-       {
-           BYTE chan = ((BYTE)value & 0xc0) >> 6;
-           /* ctrl byte for specific timer channel */
-           if (chan == 3)
-           {
-               if ( !(value & 0x20) )
-               {
-                   if ((value & 0x02) && !(tmr_8253[0].flags & TMR_LATCHED))
-                   {
-                       tmr_8253[0].flags |= TMR_LATCHED;
-                       tmr_8253[0].latch = get_timer_val(0);
-                   }
-                   if ((value & 0x04) && !(tmr_8253[1].flags & TMR_LATCHED))
-                   {
-                       tmr_8253[1].flags |= TMR_LATCHED;
-                       tmr_8253[1].latch = get_timer_val(1);
-                   }
-                   if ((value & 0x08) && !(tmr_8253[2].flags & TMR_LATCHED))
-                   {
-                       tmr_8253[2].flags |= TMR_LATCHED;
-                       tmr_8253[2].latch = get_timer_val(2);
-                   }
-               }
-
-               if ( !(value & 0x10) )
-               {
-                   if (value & 0x02)
-                       tmr_8253[0].flags |= TMR_STATUS;
-                   if (value & 0x04)
-                       tmr_8253[1].flags |= TMR_STATUS;
-                   if (value & 0x08)
-                       tmr_8253[2].flags |= TMR_STATUS;
-               }
-               break;
-           }
-           switch (((BYTE)value & 0x30) >> 4)
-           {
-           case 0:	/* latch timer */
-               if ( !(tmr_8253[chan].flags & TMR_LATCHED) )
-               {
-                   tmr_8253[chan].flags |= TMR_LATCHED;
-                   tmr_8253[chan].latch = get_timer_val(chan);
-               }
-               break;
-           case 1:	/* write lo byte only */
-           case 2:	/* write hi byte only */
-           case 3:	/* write lo byte, then hi byte */
-               tmr_8253[chan].ctrlbyte_ch = (BYTE)value;
-               tmr_8253[chan].countmax = 0;
-               tmr_8253[chan].flags = TMR_UPDATE;
-               break;
-           }
-       }
-       break;
-    case 0x61:
-        parport_8255[1] = (BYTE)value;
-        if (((parport_8255[1] & 3) == 3) && (tmr_8253[2].countmax != 1))
-        {
-            if (tmr_8253[2].countmax == 0)
-            {
-                ERR("Beep tmr_8253[2].countmax == 0 !\n", tmr_8253[2].countmax);
-                break;
-            }
-            TRACE("Beep (freq: %d) !\n", 1193180 / tmr_8253[2].countmax);
-            Beep(1193180 / tmr_8253[2].countmax, 20);
-        }
+    case 2:
+        DOSVM_outport(port, 1, value & 0xff, ctx);
+        DOSVM_outport(port + 1, 1, (value >> 8) & 0xff, ctx);
         break;
-    case 0x70:
-        cmosaddress = (BYTE)value & 0x7f;
+    default:
+        WARN("Direct I/O write attempted to port %x\n", port );
         break;
-    case 0x71:
-        if (!cmos_image_initialized)
+    }
+}
+
+
+/**********************************************************************
+ *	    DOSVM_inport_block
+ *
+ * Read count values of size bytes from one port into buffer, as done
+ * by a REP INS.
+ */
+void DOSVM_inport_block( int port, int size, void *buffer, DWORD count, CONTEXT *ctx )
+{
+    const struct io_device *device = NULL;
+    BYTE *data = buffer;
+    DWORD i;
+
+    TRACE("%u %d-byte values from port 0x%04x\n", count, size, port );
+
+    DOSMEM_InitDosMemory();
+#if !defined(HAVE_PPDEV) && !defined(DIRECT_IO_ACCESS)
+    device = IO_get_device( port, size, FALSE );
+#endif
+    if (!device)
+    {
+        for (i = 0; i < count; i++, data += size)
         {
-            IO_FixCMOSCheckSum();
-            cmos_image_initialized = TRUE;
+            DWORD res = DOSVM_inport( port, size, ctx );
+            memcpy( data, &res, size );
         }
-        cmosimage[cmosaddress & 0x3f] = (BYTE)value;
-        break;
-    case 0x226:
-    case 0x22c:
-        SB_ioport_out( port, (BYTE)value );
-        break;
-    /* VGA Write registers */
-    case 0x3b4:  /* CRT Controller Register - Index (MDA) */
-    case 0x3b5:  /* CRT Controller Register - Other (MDA) */
-    case 0x3ba:  /* General Register - Feature Control */
-    case 0x3c0:  /* Attribute Controller - Address/Other */
-    case 0x3c1:
-    case 0x3c2:  /* General Register - Misc output */
-    case 0x3c3:  /* General Register - Video subsystem enable */
-    case 0x3c4:  /* Sequencer Register - Address */
-    case 0x3c5:  /* Sequencer Register - Other */
-    case 0x3c6:
-    case 0x3c7:
-    case 0x3c8:
-    case 0x3c9:
-    case 0x3ca:
-    case 0x3cb:
-    case 0x3cc:
-    case 0x3cd:
-    case 0x3ce:  /* Graphics Controller Register - Address */
-    case 0x3cf:  /* Graphics Controller Register - Other */
-    case 0x3d0:
-    case 0x3d1:
-    case 0x3d2:
-    case 0x3d3:
-    case 0x3d4:  /* CRT Controller Register - Index (CGA) */
-    case 0x3d5:  /* CRT Controller Register - Other (CGA) */
-    case 0x3d6:
-    case 0x3d7:
-    case 0x3d8:
-    case 0x3d9:
-    case 0x3da:
-    case 0x3db:
-    case 0x3dc:
-    case 0x3dd:
-    case 0x3de:
-    case 0x3df:
-        VGA_ioport_out( port, LOBYTE(value) );
-        if(size > 1) {
-            VGA_ioport_out( port+1, HIBYTE(value) );
-            if(size > 2) {
-                VGA_ioport_out( port+2, LOBYTE(HIWORD(value)) );
-                VGA_ioport_out( port+3, HIBYTE(HIWORD(value)) );
-            }
+        return;
+    }
+    for (i = 0; i < count * size; i++)
+        data[i] = device->in( port + i % size );
+}
+
+
+/**********************************************************************
+ *	    DOSVM_outport_block
+ *
+ * Write count values of size bytes from buffer to one port, as done
+ * by a REP OUTS.
+ */
+void DOSVM_outport_block( int port, int size, const void *buffer, DWORD count, CONTEXT *ctx )
+{
+    const struct io_device *device = NULL;
+    const BYTE *data = buffer;
+    DWORD i;
+
+    TRACE("IO: %u %d-byte values to port 0x%04x\n", count, size, port );
+
+    DOSMEM_InitDosMemory();
+#if !defined(HAVE_PPDEV) && !defined(DIRECT_IO_ACCESS)
+    device = IO_get_device( port, size, TRUE );
+#endif
+    if (!device)
+    {
+        for (i = 0; i < count; i++, data += size)
+        {
+            DWORD value = 0;
+            memcpy( &value, data, size );
+            DOSVM_outport( port, size, value, ctx );
         }
-        break;
-    case 0x00:
-    case 0x01:
-    case 0x02:
-    case 0x03:
-    case 0x04:
-    case 0x05:
-    case 0x06:
-    case 0x07:
-    case 0xC0:
-    case 0xC2:
-    case 0xC4:
-    case 0xC6:
-    case 0xC8:
-    case 0xCA:
-    case 0xCC:
-    case 0xCE:
-    case 0x87:
-    case 0x83:
-    case 0x81:
-    case 0x82:
-    case 0x8B:
-    case 0x89:
-    case 0x8A:
-    case 0x487:
-    case 0x483:
-    case 0x481:
-    case 0x482:
-    case 0x48B:
-    case 0x489:
-    case 0x48A:
-    case 0x08:
-    case 0xD0:
-    case 0x0B:
-    case 0xD6:
-    case 0x0A:
-    case 0xD4:
-    case 0x0F:
-    case 0xDE:
-    case 0x09:
-    case 0xD2:
-    case 0x0C:
-    case 0xD8:
-    case 0x0D:
-    case 0xDA:
-    case 0x0E:
-    case 0xDC:
-        DMA_ioport_out( port, (BYTE)value );
-        break;
-    default:
-        WARN("Direct I/O write attempted to port %x\n", port );
-        break;
+        return;
+    }
+    if (size == 1 && device->out_block)
+    {
+        device->out_block( port, data, count );
+        return;
     }
+    for (i = 0; i < count * size; i++)
+        device->out( port + i % size, data[i] );
 }
@@ -236,6 +236,7 @@ BOOL WINAPI KERNEL_DllEntryPoint( DWORD reasion, HINSTANCE16 inst, WORD ds,
     RtlAddVectoredExceptionHandler(FALSE, fflush_vectored_handler);
 
     vm_idle_event = CreateEvent(NULL, TRUE, TRUE, NULL);
+    STATS_Init();
     return TRUE;
 }
 
@@ -524,6 +524,7 @@ typedef struct _NE_MODULE
     HMODULE16 self;             /* Handle for this module */
     WORD      self_loading_sel; /* Selector used for self-loading apps. */
     LPVOID    rsrc32_map;       /* HRSRC 16->32 map (for 32-bit modules) */
+    LPVOID    rsrc_index;       /* hashed resource table index (for NE modules) */
     LPCVOID   mapping;          /* mapping of the binary file */
     SIZE_T    mapping_size;     /* size of the file mapping */
 } NE_MODULE;
@@ -671,6 +672,25 @@ extern HGLOBAL16 GLOBAL_Alloc( WORD flags, DWORD size, HGLOBAL16 hOwner, unsigne
 extern DWORD __wine_emulate_instruction( EXCEPTION_RECORD *rec, CONTEXT *context ) DECLSPEC_HIDDEN;
 extern LONG CALLBACK INSTR_vectored_handler( EXCEPTION_POINTERS *ptrs ) DECLSPEC_HIDDEN;
 
+/* local.c */
+typedef struct
+{
+    WORD  size;           /* size of the heap */
+    WORD  items;          /* number of arenas */
+    WORD  free;           /* total free bytes */
+    WORD  free_blocks;    /* number of free blocks */
+    WORD  largest_free;   /* size of the largest free block */
+    WORD  moveable;       /* number of moveable blocks */
+    WORD  locked;         /* number of locked moveable blocks */
+    WORD  discarded;      /* number of discarded moveable blocks */
+    WORD  free_handles;   /* number of unused handle table entries */
+    WORD  fragmentation;  /* percentage of free space outside the largest free block */
+    BYTE  ncompact;       /* compaction counter */
+    DWORD distotal;       /* total bytes discarded */
+} LOCALHEAPSTATS;
+
+extern BOOL CDECL LOCAL_GetHeapStats( HANDLE16 ds, LOCALHEAPSTATS *stats );
+
 /* ne_module.c */
 extern NE_MODULE *NE_GetPtr( HMODULE16 hModule ) DECLSPEC_HIDDEN;
 extern WORD NE_GetOrdinal( HMODULE16 hModule, const char *name ) DECLSPEC_HIDDEN;
@@ -689,6 +709,9 @@ extern void NE_InitializeDLLs( HMODULE16 hModule, SEGPTR cmdline ) DECLSPEC_HIDD
 extern void NE_DllProcessAttach( HMODULE16 hModule ) DECLSPEC_HIDDEN;
 extern void NE_CallUserSignalProc( HMODULE16 hModule, UINT16 code, WORD arg1, WORD arg2, WORD arg3 ) DECLSPEC_HIDDEN;
 
+/* resource.c */
+extern void NE_FreeResourceIndex( NE_MODULE *pModule ) DECLSPEC_HIDDEN;
+
 /* selector.c */
 extern WORD SELECTOR_AllocBlock( const void *base, DWORD size, unsigned char flags ) DECLSPEC_HIDDEN;
 extern WORD SELECTOR_ReallocBlock( WORD sel, const void *base, DWORD size ) DECLSPEC_HIDDEN;
@@ -705,13 +728,23 @@ extern void SNOOP16_RegisterDLL(HMODULE16,LPCSTR) DECLSPEC_HIDDEN;
 extern FARPROC16 SNOOP16_GetProcAddress16(HMODULE16,DWORD,FARPROC16) DECLSPEC_HIDDEN;
 extern BOOL SNOOP16_ShowDebugmsgSnoop(const char *dll,int ord,const char *fname) DECLSPEC_HIDDEN;
 
+/* stats.c */
+struct otvdm_stats;
+extern ULONGLONG stats_calls_from_16 DECLSPEC_HIDDEN;
+extern ULONGLONG stats_calls_to_16 DECLSPEC_HIDDEN;
+extern void STATS_Init(void) DECLSPEC_HIDDEN;
+extern void STATS_Win16LockAcquired(void) DECLSPEC_HIDDEN;
+extern void STATS_Win16LockReleased(void) DECLSPEC_HIDDEN;
+extern void GLOBAL_GetStats( struct otvdm_stats *stats ) DECLSPEC_HIDDEN;
+extern void get_wow_handle_stats(DWORD *user, DWORD *gdi, DWORD *max) DECLSPEC_HIDDEN;
+
 /* syslevel.c */
 extern VOID SYSLEVEL_CheckNotLevel( INT level ) DECLSPEC_HIDDEN;
 
 /* task.c */
 extern void TASK_CreateMainTask(void) DECLSPEC_HIDDEN;
 extern HTASK16 TASK_SpawnTask( NE_MODULE *pModule, WORD cmdShow,
-                               LPCSTR cmdline, BYTE len, HANDLE *hThread, LPCSTR curdir ) DECLSPEC_HIDDEN;
+                               LPCSTR cmdline, BYTE len, HANDLE *hThread, LPCSTR curdir, LPCSTR env ) DECLSPEC_HIDDEN;
 extern void TASK_ExitTask(void) DECLSPEC_HIDDEN;
 extern HTASK16 TASK_GetTaskFromThread( DWORD thread ) DECLSPEC_HIDDEN;
 extern TDB *TASK_GetCurrent(void) DECLSPEC_HIDDEN;
@@ -976,6 +1009,7 @@ BOOL16 WINAPI IsOldWindowsTask(HINSTANCE16);
 #define GT_BURGERMASTER 10
 void GLOBAL_SetSeg(HGLOBAL16 hg, WORD wSeg, WORD type);
 WORD GLOBAL_GetSegNum(HGLOBAL16 hg);
+WORD GLOBAL_GetSegType(HGLOBAL16 hg);
 
 __declspec(dllexport) LPCSTR RedirectDriveRoot(LPCSTR path, LPSTR to, size_t max_len, BOOL silence);
 __declspec(dllexport) LPCSTR RedirectSystemDir(LPCSTR path, LPSTR to, size_t max_len);
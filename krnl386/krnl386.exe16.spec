@@ -771,7 +771,12 @@
 @ stdcall -arch=win32 K32WOWHandle16DestroyHint(ptr long)
 @ cdecl -arch=win32 DOSVM_inport(long long)
 @ cdecl -arch=win32 DOSVM_outport(long long long)
+@ cdecl -arch=win32 DOSVM_inport_block(long long ptr long ptr)
+@ cdecl -arch=win32 DOSVM_outport_block(long long ptr long ptr)
 @ cdecl -arch=win32 DOSVM_setportcb(ptr ptr long ptr ptr)
+@ cdecl -arch=win32 VGA_PlanarRead(long)
+@ cdecl -arch=win32 VGA_PlanarWrite(long long)
+@ cdecl -arch=win32 VGA_GetPlanarBase()
 @ cdecl -arch=win32 DOSVM_SetBuiltinVector(long ptr)
 @ cdecl -arch=win32 DOSVM_GetPMHandler16(long long)
 @ cdecl -arch=win32 DOSVM_SetPMHandler16(long long)
@@ -797,6 +802,7 @@
 @ cdecl -arch=win32 GLOBAL_SetLink(long long)
 @ cdecl -arch=win32 GLOBAL_FindLink(long)
 @ cdecl -arch=win32 GLOBAL_SetSeg(long long long)
+@ cdecl -arch=win32 LOCAL_GetHeapStats(long ptr)
 @ stdcall -arch=win32 set_vm_inject_cb(long)
 @ stdcall -arch=win32 vm_inject(long long long long long)
 @ stdcall -arch=win32 get_idle_event()
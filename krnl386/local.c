@@ -146,6 +146,9 @@ typedef struct
 
 #define LOCAL_HEAP_MAGIC  0x484c  /* 'LH' */
 
+  /* Maximum number of bytes moved by the compaction done on allocation */
+#define LOCAL_COMPACT_BUDGET  0x2000
+
   /* All local heap allocations are aligned on 4-byte boundaries */
 #define LALIGN(word)          (((word) + 3) & ~3)
 
@@ -780,9 +783,14 @@ static WORD LOCAL_GetFreeSpace(WORD ds, WORD countdiscard)
 
 
 /***********************************************************************
- *           LOCAL_Compact
+ *           LOCAL_CompactBudget
+ *
+ * Move unlocked moveable blocks down into free holes until a free block
+ * of 'minfree' bytes exists. At most 'budget' bytes are moved (0 means
+ * no limit), so that an allocation doesn't stall on a large fragmented
+ * heap; discardable blocks are only discarded if the budget wasn't hit.
  */
-static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
+static UINT16 LOCAL_CompactBudget( HANDLE16 ds, UINT16 minfree, UINT16 flags, DWORD budget )
 {
     char *ptr = MapSL( MAKESEGPTR( ds, 0 ) );
     LOCALHEAPINFO *pInfo;
@@ -791,6 +799,7 @@ static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
     WORD count, movesize, size;
     WORD freespace;
     LOCALHANDLEENTRY *pEntry;
+    DWORD moved = 0;
 
     if (!(pInfo = LOCAL_GetHeap( ds )))
     {
@@ -798,8 +807,8 @@ static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
         LOCAL_PrintHeap(ds);
         return 0;
     }
-    TRACE("ds = %04x, minfree = %04x, flags = %04x\n",
-		 ds, minfree, flags);
+    TRACE("ds = %04x, minfree = %04x, flags = %04x, budget = %04x\n",
+		 ds, minfree, flags, budget);
     freespace = LOCAL_GetFreeSpace(ds, minfree ? 0 : 1);
     if(freespace >= minfree || (flags & LMEM_NOCOMPACT))
     {
@@ -807,6 +816,7 @@ static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
         return freespace;
     }
     TRACE("Compacting heap %04x.\n", ds);
+    pInfo->ncompact++;
     table = pInfo->htable;
     while(table)
     {
@@ -869,6 +879,20 @@ static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
                     /* Update handle table entry */
                     pEntry->addr = finalarena + ARENA_HEADER_SIZE + MOVEABLE_PREFIX;
                 }
+                else continue;
+
+                /* Stop as soon as there is enough room */
+                moved += movesize;
+                if ((freespace = LOCAL_GetFreeSpace(ds, 0)) >= minfree)
+                {
+                    TRACE("Returning %04x after moving %04x bytes.\n", freespace, moved);
+                    return freespace;
+                }
+                if (budget && moved >= budget)
+                {
+                    TRACE("Budget exhausted, returning %04x.\n", freespace);
+                    return freespace;
+                }
             }
         }
         table = *(WORD *)pEntry;
@@ -891,7 +915,9 @@ static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
 	    {
                 TRACE("Discarding handle %04x (block %04x).\n",
                               (char *)pEntry - ptr, pEntry->addr);
-                LOCAL_FreeArena(ds, ARENA_HEADER(pEntry->addr - MOVEABLE_PREFIX));
+                movearena = ARENA_HEADER(pEntry->addr - MOVEABLE_PREFIX);
+                pInfo->distotal += ARENA_NEXT(ptr, movearena) - movearena;
+                LOCAL_FreeArena(ds, movearena);
                 call_notify_func(pInfo->notify, LN_DISCARD, (char *)pEntry - ptr, pEntry->flags);
                 pEntry->addr = 0;
                 pEntry->flags = (LMEM_DISCARDED >> 8);
@@ -899,7 +925,17 @@ static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
         }
         table = *(WORD *)pEntry;
     }
-    return LOCAL_Compact(ds, 0xffff, LMEM_NODISCARD);
+    /* the blocks moved so far count against the budget */
+    return LOCAL_CompactBudget(ds, minfree, LMEM_NODISCARD, budget ? budget - moved : 0);
+}
+
+
+/***********************************************************************
+ *           LOCAL_Compact
+ */
+static UINT16 LOCAL_Compact( HANDLE16 ds, UINT16 minfree, UINT16 flags )
+{
+    return LOCAL_CompactBudget( ds, minfree, flags, 0 );
 }
 
 
@@ -1003,27 +1039,30 @@ notify_done:
       /* Find a suitable free block */
     arena = LOCAL_FindFreeBlock( ds, size, flags );
     if (arena == 0) {
-	/* no space: try to make some */
-	LOCAL_Compact( ds, size, flags );
+	/* no space: try to make some without moving the whole heap */
+	LOCAL_CompactBudget( ds, size, flags, LOCAL_COMPACT_BUDGET );
 	arena = LOCAL_FindFreeBlock( ds, size, flags );
     }
     if (arena == 0) {
 	/* still no space: try to grow the segment */
         DWORD new_heap_size = GlobalSize16(ds) + size + pInfo->extra - ARENA_PTR(ptr, pInfo->last)->size + 0x24 /* FIXME: It is not perfect. */;
-	if (!(LOCAL_GrowHeap( ds, min(0x10000, new_heap_size) )))
+	if (LOCAL_GrowHeap( ds, min(0x10000, new_heap_size) ))
+	{
+	    ptr = MapSL( MAKESEGPTR( ds, 0 ) );
+	    pInfo = LOCAL_GetHeap( ds );
+	    arena = LOCAL_FindFreeBlock( ds, size, flags );
+	}
+	if (arena == 0)
 	{
+	    /* can't grow, or not far enough (64k cap): compact the whole heap */
+	    LOCAL_Compact( ds, size, flags );
+	    arena = LOCAL_FindFreeBlock( ds, size, flags );
 #if 0
 	    /* FIXME: doesn't work correctly yet */
-	    if (call_notify_func(pInfo->notify, LN_OUTOFMEM, ds - 20, size)) /* FIXME: "size" correct ? (should indicate bytes needed) */
+	    if (!arena && call_notify_func(pInfo->notify, LN_OUTOFMEM, ds - 20, size)) /* FIXME: "size" correct ? (should indicate bytes needed) */
 		goto notify_done;
 #endif
-            WARN( "not enough space in %s heap %04x for %d bytes\n",
-                 get_heap_name(ds), ds, size );
-	    return 0;
 	}
-	ptr = MapSL( MAKESEGPTR( ds, 0 ) );
-	pInfo = LOCAL_GetHeap( ds );
-	arena = LOCAL_FindFreeBlock( ds, size, flags );
     }
     if (arena == 0) {
         WARN( "not enough space in %s heap %04x for %d bytes\n",
@@ -1459,6 +1498,8 @@ HLOCAL16 WINAPI LocalReAlloc16( HLOCAL16 handle, WORD size, UINT16 flags )
       blockhandle = pEntry->addr - MOVEABLE_PREFIX; /* moved the very block we are resizing */
       arena = ARENA_HEADER( blockhandle );   /* thus, we reload arena, too        */
     }
+    pArena = ARENA_PTR( ptr, arena );
+    pNext = ARENA_PTR( ptr, pArena->next );
     if (!hmem)
     {
         int blksize = oldsize;
@@ -1489,6 +1530,7 @@ HLOCAL16 WINAPI LocalReAlloc16( HLOCAL16 handle, WORD size, UINT16 flags )
             memcpy( ptr + hmem, buffer, oldsize );
             HeapFree( GetProcessHeap(), 0, buffer );
         }
+        else return 0;  /* the block stays where it is */
     }
     else
     {
@@ -1644,6 +1686,63 @@ WORD WINAPI LocalCountFree16(void)
 }
 
 
+/***********************************************************************
+ *           LOCAL_GetHeapStats
+ *
+ * Fill occupancy and fragmentation statistics of the local heap in 'ds'.
+ */
+BOOL CDECL LOCAL_GetHeapStats( HANDLE16 ds, LOCALHEAPSTATS *stats )
+{
+    char *ptr = MapSL( MAKESEGPTR( ds, 0 ) );
+    LOCALHEAPINFO *pInfo;
+    LOCALARENA *pArena;
+    WORD arena, table;
+
+    if (!(pInfo = LOCAL_GetHeap( ds ))) return FALSE;
+
+    memset( stats, 0, sizeof(*stats) );
+    stats->size     = pInfo->last - pInfo->first;
+    stats->items    = pInfo->items;
+    stats->ncompact = pInfo->ncompact;
+    stats->distotal = pInfo->distotal;
+
+    arena = pInfo->first;
+    pArena = ARENA_PTR( ptr, arena );
+    for (;;)
+    {
+        arena = pArena->free_next;
+        pArena = ARENA_PTR( ptr, arena );
+        if (arena == pArena->free_next) break;
+        stats->free += pArena->size;
+        stats->free_blocks++;
+        if (pArena->size > stats->largest_free) stats->largest_free = pArena->size;
+    }
+
+    table = pInfo->htable;
+    while (table)
+    {
+        WORD count = *(WORD *)(ptr + table);
+        LOCALHANDLEENTRY *pEntry = (LOCALHANDLEENTRY *)(ptr + table + sizeof(WORD));
+        for (; count > 0; count--, pEntry++)
+        {
+            if (pEntry->lock == 0xff) stats->free_handles++;
+            else if (pEntry->flags == (LMEM_DISCARDED >> 8)) stats->discarded++;
+            else
+            {
+                stats->moveable++;
+                if (pEntry->lock) stats->locked++;
+            }
+        }
+        table = *(WORD *)pEntry;
+    }
+
+    /* percentage of free space not usable by the largest possible allocation */
+    if (stats->free)
+        stats->fragmentation = 100 - (DWORD)stats->largest_free * 100 / stats->free;
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           LocalHandle   (KERNEL.11)
  */
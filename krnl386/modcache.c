@@ -0,0 +1,224 @@
+/*
+ * Cache of 16-bit module name resolutions
+ *
+ * Copyright 1995 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Cache of module name resolutions. Finding out that a name is a 16-bit
+ * builtin, a native NE file or nothing at all takes several directory
+ * searches, and programs that probe optional DLLs or relaunch helpers do it
+ * over and over. Lookups are keyed by the name, the search path and the
+ * current directory, so changing either of them misses the old entries.
+ *
+ * Misses expire after a while so that files copied in by an installer are
+ * found. A hit is checked to still exist before it is returned, and expires
+ * too, so that a copy put earlier in the search path is picked up.
+ *
+ * Only the file APIs are called here; ne_module.c does the resolving.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "kernel16_private.h"
+#include "modcache.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(module);
+
+struct module_res
+{
+    struct module_res *next;
+    BOOL   found;
+    DWORD  time;                /* tick count when the entry was made */
+    char  *name;                /* kind of lookup and requested name */
+    char  *search_path;
+    char  *cwd;
+    char   path[MAX_PATH];      /* resolved file if found */
+    char   data[1];
+};
+
+static struct module_res *module_res_list;
+
+static CRITICAL_SECTION module_res_section;
+static CRITICAL_SECTION_DEBUG module_res_critsect_debug =
+{
+    0, 0, &module_res_section,
+    { &module_res_critsect_debug.ProcessLocksList, &module_res_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": module_res_section") }
+};
+static CRITICAL_SECTION module_res_section = { &module_res_critsect_debug, -1, 0, 0, 0, 0 };
+
+/* find an entry, moving it to the front; must be called inside module_res_section */
+static struct module_res **module_res_find( LPCSTR name, LPCSTR search_path, LPCSTR cwd )
+{
+    struct module_res **prev, *res;
+
+    for (prev = &module_res_list; (res = *prev); prev = &res->next)
+    {
+        if (stricmp( res->name, name ) || strcmp( res->search_path, search_path ) ||
+            stricmp( res->cwd, cwd ))
+            continue;
+        if (prev != &module_res_list)
+        {
+            *prev = res->next;
+            res->next = module_res_list;
+            module_res_list = res;
+        }
+        return &module_res_list;
+    }
+    return NULL;
+}
+
+/***********************************************************************
+ *           module_res_get
+ *
+ * Look up a cached resolution. Returns TRUE if there is one; *found and
+ * the resolved path (when found) are then filled in.
+ */
+BOOL module_res_get( LPCSTR name, LPCSTR search_path, BOOL *found, LPSTR buf, DWORD size )
+{
+    char cwd[MAX_PATH];
+    struct module_res **pres, *res;
+    BOOL ret = FALSE;
+
+    if (!GetCurrentDirectoryA( sizeof(cwd), cwd )) return FALSE;
+    EnterCriticalSection( &module_res_section );
+    if ((pres = module_res_find( name, search_path, cwd )))
+    {
+        res = *pres;
+        if (GetTickCount() - res->time >= (res->found ? MODULE_RES_HIT_TIMEOUT : MODULE_RES_MISS_TIMEOUT))
+        {
+            *pres = res->next;
+            HeapFree( GetProcessHeap(), 0, res );
+        }
+        else if (!res->found || strlen( res->path ) < size)
+        {
+            *found = res->found;
+            if (res->found) strcpy( buf, res->path );
+            ret = TRUE;
+        }
+    }
+    LeaveCriticalSection( &module_res_section );
+
+    /* one look at the file is still much cheaper than the search */
+    if (ret && *found && GetFileAttributesA( buf ) == INVALID_FILE_ATTRIBUTES)
+    {
+        TRACE( "%s: %s is gone\n", debugstr_a(name), debugstr_a(buf) );
+        module_res_drop( name, search_path );
+        return FALSE;
+    }
+    if (ret) TRACE( "%s: cached %s\n", debugstr_a(name), *found ? debugstr_a(buf) : "miss" );
+    return ret;
+}
+
+/***********************************************************************
+ *           module_res_set
+ *
+ * Remember the result of a lookup, path is only used if the name was
+ * found.
+ */
+void module_res_set( LPCSTR name, LPCSTR search_path, BOOL found, LPCSTR path )
+{
+    char cwd[MAX_PATH];
+    struct module_res **pres, *res;
+    size_t name_len = strlen( name ) + 1, search_len = strlen( search_path ) + 1, cwd_len;
+    int count;
+
+    if (found && strlen( path ) >= MAX_PATH) return;
+    if (!GetCurrentDirectoryA( sizeof(cwd), cwd )) return;
+    cwd_len = strlen( cwd ) + 1;
+
+    EnterCriticalSection( &module_res_section );
+    if ((pres = module_res_find( name, search_path, cwd )))
+    {
+        res = *pres;
+        *pres = res->next;
+        HeapFree( GetProcessHeap(), 0, res );
+    }
+    if ((res = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct module_res, data[name_len + search_len + cwd_len] ) )))
+    {
+        res->found = found;
+        res->time = GetTickCount();
+        res->name = res->data;
+        res->search_path = res->name + name_len;
+        res->cwd = res->search_path + search_len;
+        memcpy( res->name, name, name_len );
+        memcpy( res->search_path, search_path, search_len );
+        memcpy( res->cwd, cwd, cwd_len );
+        strcpy( res->path, found ? path : "" );
+        res->next = module_res_list;
+        module_res_list = res;
+    }
+    /* drop the least recently used entries */
+    for (pres = &module_res_list, count = 0; *pres; count++)
+    {
+        if (count < MODULE_RES_MAX)
+        {
+            pres = &(*pres)->next;
+            continue;
+        }
+        res = *pres;
+        *pres = res->next;
+        HeapFree( GetProcessHeap(), 0, res );
+    }
+    LeaveCriticalSection( &module_res_section );
+}
+
+/***********************************************************************
+ *           module_res_drop
+ *
+ * Forget a cached resolution that turned out to be wrong.
+ */
+void module_res_drop( LPCSTR name, LPCSTR search_path )
+{
+    char cwd[MAX_PATH];
+    struct module_res **pres, *res;
+
+    if (!GetCurrentDirectoryA( sizeof(cwd), cwd )) return;
+    EnterCriticalSection( &module_res_section );
+    if ((pres = module_res_find( name, search_path, cwd )))
+    {
+        res = *pres;
+        *pres = res->next;
+        HeapFree( GetProcessHeap(), 0, res );
+    }
+    LeaveCriticalSection( &module_res_section );
+}
+
+/***********************************************************************
+ *           module_res_search_path
+ *
+ * SearchPathA through the resolution cache.
+ */
+BOOL module_res_search_path( LPCSTR search_path, LPCSTR name, LPCSTR ext, LPSTR buf, DWORD size )
+{
+    char key[MAX_PATH + 16];
+    BOOL found;
+
+    if (strlen( name ) + strlen( ext ? ext : "" ) + 8 >= sizeof(key))
+        return SearchPathA( search_path, name, ext, size, buf, NULL ) != 0;
+    sprintf( key, "search:%s|%s", name, ext ? ext : "" );
+    if (module_res_get( key, search_path, &found, buf, size )) return found;
+    found = SearchPathA( search_path, name, ext, size, buf, NULL ) != 0;
+    module_res_set( key, search_path, found, buf );
+    return found;
+}
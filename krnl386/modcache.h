@@ -0,0 +1,39 @@
+/*
+ * Cache of 16-bit module name resolutions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_MODCACHE_H
+#define __WINE_MODCACHE_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+
+/* entries kept, the least recently used ones are dropped */
+#define MODULE_RES_MAX          64
+/* a name that wasn't found is looked for again after this long (ms) */
+#define MODULE_RES_MISS_TIMEOUT 2000
+/* and one that was found, in case a file earlier in the path shadows it now */
+#define MODULE_RES_HIT_TIMEOUT  30000
+
+extern BOOL module_res_get( LPCSTR name, LPCSTR search_path, BOOL *found, LPSTR buf, DWORD size ) DECLSPEC_HIDDEN;
+extern void module_res_set( LPCSTR name, LPCSTR search_path, BOOL found, LPCSTR path ) DECLSPEC_HIDDEN;
+extern void module_res_drop( LPCSTR name, LPCSTR search_path ) DECLSPEC_HIDDEN;
+extern BOOL module_res_search_path( LPCSTR search_path, LPCSTR name, LPCSTR ext, LPSTR buf, DWORD size ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_MODCACHE_H */
@@ -0,0 +1,329 @@
+/*
+ * INT 33h mouse driver state
+ *
+ * Copyright 1999 Ove Kåven
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * What the mouse driver remembers between calls: cursor position and
+ * range, buttons, press counters, mickeys and the update region, and the
+ * contents of the callback events built from pointer input.
+ *
+ * The DOS cursor follows the host pointer at an offset, which function
+ * 04h changes so that the cursor moves where the program put it and then
+ * follows the pointer from there.
+ *
+ * Nothing here draws the cursor or calls back into DOS, so int33.c tells
+ * the display about visibility changes and queues the events.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "winuser.h"
+#include "wincon.h"
+#include "mousestate.h"
+
+static SHORT clamp( int value, SHORT min, SHORT max )
+{
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+/* keep the cursor within its range, hide it when it enters the update region */
+static void move_cursor( struct mouse_state *state, int x, int y )
+{
+    state->x = clamp( x, state->minx, state->maxx );
+    state->y = clamp( y, state->miny, state->maxy );
+
+    if (state->exclude &&
+        (SHORT)state->x >= state->exclude_left && (SHORT)state->x <= state->exclude_right &&
+        (SHORT)state->y >= state->exclude_top && (SHORT)state->y <= state->exclude_bottom)
+    {
+        /* hidden until the next show cursor call, as if by function 02h */
+        state->exclude = FALSE;
+        state->hide_count++;
+    }
+}
+
+/* convert motion in pixels to mickeys with the mickey/pixel ratio */
+static void add_motion( struct mouse_state *state, int dx, int dy )
+{
+    int mx, my;
+
+    state->fracx += dx * state->HMPratio;
+    state->fracy += dy * state->VMPratio;
+    mx = state->fracx / 8;
+    my = state->fracy / 8;
+    state->fracx -= mx * 8;
+    state->fracy -= my * 8;
+
+    state->mickeyx += mx;
+    state->mickeyy += my;
+    state->rawx += mx;
+    state->rawy += my;
+}
+
+/***********************************************************************
+ *           mouse_state_reset
+ *
+ * Functions 00h and 21h. The cursor is hidden; where the pointer is
+ * stays known so that its next motion still counts.
+ */
+void mouse_state_reset( struct mouse_state *state )
+{
+    int lastx = state->lastx, lasty = state->lasty;
+    BOOL have_last = state->have_last;
+
+    memset( state, 0, sizeof(*state) );
+    state->HMPratio = 8;
+    state->VMPratio = 16;
+    /* the cursor range defaults to the whole screen */
+    state->maxx = 0x7fff;
+    state->maxy = 0x7fff;
+    state->hide_count = 1;
+    state->lastx = lastx;
+    state->lasty = lasty;
+    state->have_last = have_last;
+}
+
+/***********************************************************************
+ *           mouse_state_show
+ *
+ * Functions 01h and 02h. Showing also ends the update region.
+ */
+void mouse_state_show( struct mouse_state *state, BOOL show )
+{
+    if (!show)
+    {
+        state->hide_count++;
+        return;
+    }
+    state->exclude = FALSE;
+    if (state->hide_count) state->hide_count--;
+}
+
+/***********************************************************************
+ *           mouse_state_set_position
+ *
+ * Function 04h. Before the first pointer event the offset is taken from
+ * that event.
+ */
+void mouse_state_set_position( struct mouse_state *state, int x, int y )
+{
+    move_cursor( state, x, y );
+    if (state->have_last)
+    {
+        state->offsetx = (SHORT)state->x - state->lastx;
+        state->offsety = (SHORT)state->y - state->lasty;
+    }
+    else state->anchor = TRUE;
+}
+
+/***********************************************************************
+ *           mouse_state_set_range
+ *
+ * Functions 07h and 08h, the limits may come in either order.
+ */
+void mouse_state_set_range( struct mouse_state *state, BOOL vertical, SHORT a, SHORT b )
+{
+    if (vertical)
+    {
+        state->miny = min( a, b );
+        state->maxy = max( a, b );
+    }
+    else
+    {
+        state->minx = min( a, b );
+        state->maxx = max( a, b );
+    }
+    move_cursor( state, state->x, state->y );
+}
+
+/***********************************************************************
+ *           mouse_state_set_exclude
+ *
+ * Function 10h.
+ */
+void mouse_state_set_exclude( struct mouse_state *state, SHORT x1, SHORT y1, SHORT x2, SHORT y2 )
+{
+    state->exclude = TRUE;
+    state->exclude_left = min( x1, x2 );
+    state->exclude_right = max( x1, x2 );
+    state->exclude_top = min( y1, y2 );
+    state->exclude_bottom = max( y1, y2 );
+    move_cursor( state, state->x, state->y );
+}
+
+/***********************************************************************
+ *           mouse_state_read_motion
+ *
+ * Function 0Bh, the counters restart from zero.
+ */
+void mouse_state_read_motion( struct mouse_state *state, SHORT *mx, SHORT *my )
+{
+    *mx = state->mickeyx;
+    *my = state->mickeyy;
+    state->mickeyx = 0;
+    state->mickeyy = 0;
+}
+
+/***********************************************************************
+ *           mouse_state_read_presses
+ *
+ * Function 05h: presses of a button since the last call, and where the
+ * last one happened.
+ */
+WORD mouse_state_read_presses( struct mouse_state *state, BOOL right, WORD *x, WORD *y )
+{
+    WORD count;
+
+    if (right)
+    {
+        count = state->rbcount;
+        state->rbcount = 0;
+        *x = state->rlastx;
+        *y = state->rlasty;
+    }
+    else
+    {
+        count = state->lbcount;
+        state->lbcount = 0;
+        *x = state->llastx;
+        *y = state->llasty;
+    }
+    return count;
+}
+
+/***********************************************************************
+ *           mouse_state_pointer
+ *
+ * Pointer input: the host pointer is at (x, y), mask says what happened.
+ */
+void mouse_state_pointer( struct mouse_state *state, int x, int y, WORD mask )
+{
+    /* mickeys follow the pointer even while the cursor is held by its range */
+    if (state->have_last)
+        add_motion( state, x - state->lastx, y - state->lasty );
+    state->lastx = x;
+    state->lasty = y;
+    state->have_last = TRUE;
+    if (state->anchor)
+    {
+        state->offsetx = (SHORT)state->x - x;
+        state->offsety = (SHORT)state->y - y;
+        state->anchor = FALSE;
+    }
+
+    move_cursor( state, x + state->offsetx, y + state->offsety );
+
+    if (mask & MOUSE_LEFT_DOWN)
+    {
+        state->but |= 0x01;
+        state->llastx = state->x;
+        state->llasty = state->y;
+        state->lbcount++;
+    }
+    if (mask & MOUSE_LEFT_UP) state->but &= ~0x01;
+    if (mask & MOUSE_RIGHT_DOWN)
+    {
+        state->but |= 0x02;
+        state->rlastx = state->x;
+        state->rlasty = state->y;
+        state->rbcount++;
+    }
+    if (mask & MOUSE_RIGHT_UP) state->but &= ~0x02;
+    if (mask & MOUSE_MIDDLE_DOWN) state->but |= 0x04;
+    if (mask & MOUSE_MIDDLE_UP) state->but &= ~0x04;
+}
+
+/***********************************************************************
+ *           mouse_message_mask
+ *
+ * The event mask of a window mouse message.
+ */
+WORD mouse_message_mask( UINT message )
+{
+    switch (message)
+    {
+    case WM_MOUSEMOVE:      return MOUSE_MOTION;
+    case WM_LBUTTONDOWN:
+    case WM_LBUTTONDBLCLK:  return MOUSE_LEFT_DOWN;
+    case WM_LBUTTONUP:      return MOUSE_LEFT_UP;
+    case WM_RBUTTONDOWN:
+    case WM_RBUTTONDBLCLK:  return MOUSE_RIGHT_DOWN;
+    case WM_RBUTTONUP:      return MOUSE_RIGHT_UP;
+    case WM_MBUTTONDOWN:
+    case WM_MBUTTONDBLCLK:  return MOUSE_MIDDLE_DOWN;
+    case WM_MBUTTONUP:      return MOUSE_MIDDLE_UP;
+    }
+    return 0;
+}
+
+/***********************************************************************
+ *           mouse_console_mask
+ *
+ * The event mask of a console mouse event, from the buttons that changed.
+ */
+WORD mouse_console_mask( const struct mouse_state *state, DWORD buttons, DWORD flags )
+{
+    WORD mask = 0;
+    BOOL left = (buttons & FROM_LEFT_1ST_BUTTON_PRESSED) != 0;
+    BOOL right = (buttons & RIGHTMOST_BUTTON_PRESSED) != 0;
+    BOOL middle = (buttons & FROM_LEFT_2ND_BUTTON_PRESSED) != 0;
+
+    if (left != ((state->but & 0x01) != 0)) mask |= left ? MOUSE_LEFT_DOWN : MOUSE_LEFT_UP;
+    if (right != ((state->but & 0x02) != 0)) mask |= right ? MOUSE_RIGHT_DOWN : MOUSE_RIGHT_UP;
+    if (middle != ((state->but & 0x04) != 0)) mask |= middle ? MOUSE_MIDDLE_DOWN : MOUSE_MIDDLE_UP;
+    if (flags & MOUSE_MOVED) mask |= MOUSE_MOTION;
+    return mask;
+}
+
+/***********************************************************************
+ *           mouse_event_fill
+ *
+ * Set a callback event from the state after input with mask.
+ */
+void mouse_event_fill( MCALLDATA *data, const struct mouse_state *state, WORD mask )
+{
+    data->proc = state->callback;
+    data->mask |= mask & state->callmask;
+    data->but = state->but;
+    data->x = state->x;
+    data->y = state->y;
+    data->mx = state->rawx;
+    data->my = state->rawy;
+}
+
+/***********************************************************************
+ *           mouse_event_merge
+ *
+ * Merge input into the last queued event while it only reports motion,
+ * so that fast motion doesn't flood the queue but every button
+ * transition still gets its own callback. FALSE if a new event is needed.
+ */
+BOOL mouse_event_merge( MCALLDATA *pending, const struct mouse_state *state, WORD mask )
+{
+    if (!pending || pending->proc != state->callback || (pending->mask & ~MOUSE_MOTION))
+        return FALSE;
+    mouse_event_fill( pending, state, mask );
+    return TRUE;
+}
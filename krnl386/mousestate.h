@@ -0,0 +1,78 @@
+/*
+ * INT 33h mouse driver state
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_MOUSESTATE_H
+#define __WINE_MOUSESTATE_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/windef16.h"
+
+struct mouse_state
+{
+    SHORT minx, maxx, miny, maxy;       /* cursor range (functions 07h/08h) */
+    WORD HMPratio, VMPratio;            /* mickeys per 8 pixels (function 0Fh) */
+    WORD x, y, but;
+    WORD lbcount, rbcount, rlastx, rlasty, llastx, llasty;
+    FARPROC16 callback;
+    WORD callmask;
+    WORD hide_count;
+    SHORT mickeyx, mickeyy;             /* motion since the last function 0Bh */
+    WORD rawx, rawy;                    /* running mickey counters for callbacks */
+    int fracx, fracy;                   /* mickey remainders, in 1/8 mickey */
+    int lastx, lasty;                   /* last pointer position, not clamped */
+    BOOL have_last;
+    int offsetx, offsety;               /* cursor position minus pointer position */
+    BOOL anchor;                        /* set the offset at the next pointer event */
+    BOOL exclude;                       /* update region (function 10h) */
+    SHORT exclude_left, exclude_top, exclude_right, exclude_bottom;
+};
+
+/* the state before the first reset, with the defaults of function 00h */
+#define MOUSE_STATE_INIT { 0, 0x7fff, 0, 0x7fff, 8, 16 }
+
+/* event masks of the callbacks (function 0Ch) */
+#define MOUSE_MOTION          0x01
+#define MOUSE_LEFT_DOWN       0x02
+#define MOUSE_LEFT_UP         0x04
+#define MOUSE_RIGHT_DOWN      0x08
+#define MOUSE_RIGHT_UP        0x10
+#define MOUSE_MIDDLE_DOWN     0x20
+#define MOUSE_MIDDLE_UP       0x40
+
+typedef struct {
+  FARPROC16 proc;
+  WORD mask,but,x,y,mx,my;
+} MCALLDATA;
+
+extern void mouse_state_reset( struct mouse_state *state ) DECLSPEC_HIDDEN;
+extern void mouse_state_show( struct mouse_state *state, BOOL show ) DECLSPEC_HIDDEN;
+extern void mouse_state_set_position( struct mouse_state *state, int x, int y ) DECLSPEC_HIDDEN;
+extern void mouse_state_set_range( struct mouse_state *state, BOOL vertical, SHORT a, SHORT b ) DECLSPEC_HIDDEN;
+extern void mouse_state_set_exclude( struct mouse_state *state, SHORT x1, SHORT y1, SHORT x2, SHORT y2 ) DECLSPEC_HIDDEN;
+extern void mouse_state_read_motion( struct mouse_state *state, SHORT *mx, SHORT *my ) DECLSPEC_HIDDEN;
+extern WORD mouse_state_read_presses( struct mouse_state *state, BOOL right, WORD *x, WORD *y ) DECLSPEC_HIDDEN;
+extern void mouse_state_pointer( struct mouse_state *state, int x, int y, WORD mask ) DECLSPEC_HIDDEN;
+extern WORD mouse_message_mask( UINT message ) DECLSPEC_HIDDEN;
+extern WORD mouse_console_mask( const struct mouse_state *state, DWORD buttons, DWORD flags ) DECLSPEC_HIDDEN;
+extern BOOL mouse_event_merge( MCALLDATA *pending, const struct mouse_state *state, WORD mask ) DECLSPEC_HIDDEN;
+extern void mouse_event_fill( MCALLDATA *data, const struct mouse_state *state, WORD mask ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_MOUSESTATE_H */
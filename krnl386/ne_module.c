@@ -37,6 +37,7 @@
 #include "windows/wownt32.h"
 #include "winternl.h"
 #include "kernel16_private.h"
+#include "modcache.h"
 #include "wine/exception.h"
 #include "wine/debug.h"
 #include "winuser.h"
@@ -978,9 +979,36 @@ static HINSTANCE16 NE_LoadModule( LPCSTR name, BOOL lib_only )
     HANDLE mapping;
     void *ptr;
     MEMORY_BASIC_INFORMATION info;
+    char key[MAX_PATH + 8], path[MAX_PATH];
+    char *search_path = NULL;
+    BOOL found;
 
-    /* Open file */
-    if ((hFile = OpenFile16( name, &ofs, OF_READ|OF_SHARE_DENY_WRITE )) == HFILE_ERROR16)
+    /* Open file, going straight to the file found last time */
+    hFile = HFILE_ERROR16;
+    if (strlen( name ) < MAX_PATH && (search_path = get_search_path()))
+    {
+        sprintf( key, "native:%s", name );
+        if (module_res_get( key, search_path, &found, path, sizeof(path) ))
+        {
+            if (!found)
+            {
+                HeapFree( GetProcessHeap(), 0, search_path );
+                return ERROR_FILE_NOT_FOUND;
+            }
+            if ((hFile = OpenFile16( path, &ofs, OF_READ|OF_SHARE_DENY_WRITE )) == HFILE_ERROR16)
+                module_res_drop( key, search_path );
+        }
+    }
+    if (hFile == HFILE_ERROR16)
+    {
+        hFile = OpenFile16( name, &ofs, OF_READ|OF_SHARE_DENY_WRITE );
+        /* only remember misses that are really about the file not being there */
+        if (search_path && (hFile != HFILE_ERROR16 || ofs.nErrCode == ERROR_FILE_NOT_FOUND ||
+                            ofs.nErrCode == ERROR_PATH_NOT_FOUND))
+            module_res_set( key, search_path, hFile != HFILE_ERROR16, ofs.szPathName );
+    }
+    HeapFree( GetProcessHeap(), 0, search_path );
+    if (hFile == HFILE_ERROR16)
         return ERROR_FILE_NOT_FOUND;
 
     mapping = CreateFileMappingW( DosFileHandleToWin32Handle(hFile), NULL, PAGE_WRITECOPY, 0, 0, NULL );
@@ -1091,6 +1119,26 @@ static BOOL builtin_override(const char *lib)
 }
 
 LPCSTR krnl386_search_executable_file(LPCSTR lpFile, LPSTR buf, SIZE_T size, BOOL search_builtin);
+
+/* look for the 32-bit file of a 16-bit builtin, through the resolution cache */
+static BOOL find_builtin_module( LPCSTR dllname, LPSTR buf, DWORD size )
+{
+    char key[48];
+    char *search_path = get_search_path();
+    BOOL found;
+
+    if (!search_path)
+        return krnl386_search_executable_file( dllname, buf, size, TRUE ) != dllname;
+    sprintf( key, "builtin:%s", dllname );
+    if (!module_res_get( key, search_path, &found, buf, size ))
+    {
+        found = krnl386_search_executable_file( dllname, buf, size, TRUE ) != dllname;
+        module_res_set( key, search_path, found, buf );
+    }
+    HeapFree( GetProcessHeap(), 0, search_path );
+    return found;
+}
+
 /**********************************************************************
  *	    MODULE_LoadModule16
  *
@@ -1129,7 +1177,7 @@ static HINSTANCE16 MODULE_LoadModule16( LPCSTR libname, BOOL implicit, BOOL lib_
         for (q = dllname; *q; q++) if (*q >= 'A' && *q <= 'Z') *q += 32;
 
         strcpy( q, "16" );
-        if (krnl386_search_executable_file(dllname, path32, sizeof(path32), TRUE) != dllname)
+        if (find_builtin_module( dllname, path32, sizeof(path32) ))
         {
             ReleaseThunkLock(&count);
             mod32 = LoadLibraryA( dllname );
@@ -1241,14 +1289,14 @@ static HINSTANCE16 MODULE_LoadModule16( LPCSTR libname, BOOL implicit, BOOL lib_
  *
  * Create the thread for a 16-bit module.
  */
-static HINSTANCE16 NE_CreateThread( NE_MODULE *pModule, WORD cmdShow, LPCSTR cmdline, LPCSTR curdir )
+static HINSTANCE16 NE_CreateThread( NE_MODULE *pModule, WORD cmdShow, LPCSTR cmdline, LPCSTR curdir, LPCSTR env )
 {
     HANDLE hThread;
     TDB *pTask;
     HTASK16 hTask;
     HINSTANCE16 instance = 0;
 
-    if (!(hTask = TASK_SpawnTask( pModule, cmdShow, cmdline + 1, *cmdline, &hThread, curdir )))
+    if (!(hTask = TASK_SpawnTask( pModule, cmdShow, cmdline + 1, *cmdline, &hThread, curdir, env )))
         return 0;
 
     /* Post event to start the task */
@@ -1372,6 +1420,32 @@ HANDLE WINAPI LoadModule_wine_implementation(LPCSTR name, LPVOID paramBlock, HAN
     return ret;
 }
 LPCSTR RedirectSystemDir(LPCSTR path, LPSTR to, size_t max_len);
+
+/**********************************************************************
+ *          get_load_params_extra
+ *
+ * Decode the private hEnvironment values used by otvdm launches and
+ * return the real environment handle.
+ */
+static HGLOBAL16 get_load_params_extra( const LOADPARAMS16 *params, LPCSTR *curdir, LPCSTR *env )
+{
+    *curdir = NULL;
+    *env = NULL;
+    if (params->hEnvironment == LOADPARAMS16_CURDIR)
+    {
+        *curdir = (LPCSTR)params->reserved;
+        return 0;
+    }
+    if (params->hEnvironment == LOADPARAMS16_EXTENDED)
+    {
+        const LOADPARAMS16_EXTRA *extra = (const LOADPARAMS16_EXTRA *)params->reserved;
+        *curdir = extra->curdir;
+        *env = extra->environment;
+        return 0;
+    }
+    return params->hEnvironment;
+}
+
 /**********************************************************************
  *          LoadModule      (KERNEL.45)
  */
@@ -1414,18 +1488,21 @@ HINSTANCE16 WINAPI LoadModule16( LPCSTR name, LPVOID paramBlock )
             if (hModule == 21/* win32 */)
             {
                 LOADPARMS32 paramBlock32;
+                HGLOBAL16 hEnvironment;
+                LPCSTR curdir, env;
                 if (lib_only)
                 {
                     return (HINSTANCE16)21;
                 }
-                paramBlock32.lpEnvAddress = GlobalLock16(params->hEnvironment);
+                hEnvironment = get_load_params_extra(params, &curdir, &env);
+                paramBlock32.lpEnvAddress = env ? (LPSTR)env : GlobalLock16(hEnvironment);
                 DWORD showCmd32[2];
                 paramBlock32.lpCmdLine = MapSL(params->cmdLine);
                 paramBlock32.lpCmdShow = MapSL(params->showCmd);
                 paramBlock32.dwReserved = 0;
                 HANDLE hProcess = 0;
                 DWORD result = LoadModule_wine_implementation(name, &paramBlock32, &hProcess);/* win32 returns 33 */
-                WIN32_GlobalUnlock16(params->hEnvironment);
+                if (!env) WIN32_GlobalUnlock16(hEnvironment);
                 if (result < 32)
                     return result;
                 char cmdlineBuf[_countof("WINOLDAP.MOD -WoAWoW32XXXXXXXX")];
@@ -1456,13 +1533,10 @@ HINSTANCE16 WINAPI LoadModule16( LPCSTR name, LPVOID paramBlock )
     if (params->showCmd)
         cmdShow = ((WORD *)MapSL( params->showCmd ))[1];
     cmdline = MapSL( params->cmdLine );
-    LPCSTR curdir = NULL;
-    /* current directory */
-    if (params->hEnvironment == 0x0bef)
-    {
-        curdir = (LPCSTR)params->reserved;
-    }
-    return NE_CreateThread( pModule, cmdShow, cmdline, curdir);
+    LPCSTR curdir, env;
+    /* current directory and environment of shared WOW launches */
+    get_load_params_extra( params, &curdir, &env );
+    return NE_CreateThread( pModule, cmdShow, cmdline, curdir, env );
 }
 
 
@@ -1683,6 +1757,7 @@ static BOOL16 NE_FreeModule( HMODULE16 hModule, BOOL call_wep, BOOL cleanup )
 
     /* Free the module storage */
 
+    NE_FreeResourceIndex( pModule );
     GlobalFreeAll16( hModule );
     
     if (owner32)
@@ -1996,13 +2071,13 @@ HINSTANCE16 WINAPI WinExec16(LPCSTR lpCmdLine, UINT16 nCmdShow)
 
         strcpy(q, "16");
     }
-    if (enough_buffer && SearchPathA(path, builtinbuffer, "", sizeof(buffer), buffer, NULL))
+    if (enough_buffer && module_res_search_path(path, builtinbuffer, "", buffer, sizeof(buffer)))
     {
         //remove 16
         buffer[strlen(buffer) - 2] = 0;
         ret = LoadModule16(buffer, &params);
     }
-    else if (SearchPathA( path, name, ".exe", sizeof(buffer), buffer, NULL ))
+    else if (module_res_search_path( path, name, ".exe", buffer, sizeof(buffer) ))
     {
         ret = LoadModule16( buffer, &params );
     }
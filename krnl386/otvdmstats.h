@@ -0,0 +1,103 @@
+/*
+ * Runtime statistics published by otvdm for external monitoring
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __OTVDM_STATS_H
+#define __OTVDM_STATS_H
+
+/*
+ * Every otvdm process publishes one otvdm_stats block in a named file
+ * mapping (OTVDM_STATS_SECTION_FORMAT with the process id). The layout
+ * only uses fixed size, naturally aligned fields so that it is the same
+ * for every compiler and can be decoded on any host.
+ *
+ * The block is written by a single thread. 'sequence' is odd while an
+ * update is in progress; a reader copies the block and retries if the
+ * sequence was odd or changed during the copy.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define OTVDM_STATS_MAGIC           0x54535644  /* 'DVST' */
+#define OTVDM_STATS_VERSION         1
+#define OTVDM_STATS_SECTION_FORMAT  "Local\\otvdm-stats-%u"
+#define OTVDM_STATS_MAX_HEAPS       16
+
+struct otvdm_stats_local_heap
+{
+    uint16_t ds;              /* selector of the segment holding the heap */
+    char     name[10];        /* owner module, not null terminated if 10 chars */
+    uint16_t size;            /* size of the heap area */
+    uint16_t free;            /* total free bytes */
+    uint16_t largest_free;    /* size of the largest free block */
+    uint16_t free_blocks;     /* number of free blocks */
+    uint16_t items;           /* number of handle table entries */
+    uint16_t free_handles;    /* number of unused handle table entries */
+};
+
+struct otvdm_stats
+{
+    uint32_t magic;           /* OTVDM_STATS_MAGIC */
+    uint16_t version;         /* OTVDM_STATS_VERSION */
+    uint16_t size;            /* sizeof(struct otvdm_stats) of the writer */
+    volatile uint32_t sequence;
+    uint32_t pid;
+    uint64_t update_tick;     /* GetTickCount() of the last update */
+    uint32_t update_count;
+    uint32_t heaps_valid;     /* the heap walks below ran in this update */
+
+    /* global heap */
+    uint32_t global_arena_used;
+    uint32_t global_arena_max;
+    uint32_t global_bytes;
+    uint32_t global_discardable_bytes;
+    uint32_t global_discarded_blocks;
+    uint32_t global_locked_blocks;
+
+    /* local descriptor table */
+    uint32_t ldt_used;
+    uint32_t ldt_max;
+    uint32_t ldt_largest_free_run;
+
+    /* 16 <-> 32-bit handle tables */
+    uint32_t user_handles;
+    uint32_t gdi_handles;
+    uint32_t handle_table_max;
+
+    uint32_t task_count;
+    uint32_t reserved1;       /* keeps the 64-bit fields 8-byte aligned */
+
+    /* call counters */
+    uint64_t calls_from_16;
+    uint64_t calls_to_16;
+
+    /* Win16Mutex, times in microseconds */
+    uint64_t win16_lock_acquisitions;
+    uint64_t win16_lock_hold_total;
+    uint32_t win16_lock_hold_max;
+    uint32_t win16_lock_held;  /* microseconds the current owner has held it, 0 if free */
+
+    uint32_t local_heap_count;
+    struct otvdm_stats_local_heap local_heaps[OTVDM_STATS_MAX_HEAPS];
+    uint32_t reserved2;
+};
+
+/* reader library (otvdmstat/statsread.c) */
+extern int otvdm_stats_snapshot( const volatile void *block, size_t block_size, struct otvdm_stats *out );
+
+#endif /* __OTVDM_STATS_H */
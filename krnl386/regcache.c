@@ -0,0 +1,318 @@
+/*
+ * Cache of 16-bit registry queries
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Bookkeeping of the registry cache of registry.c: query results by
+ * root, key path and value name, and the key paths of the handles
+ * opened through the 16-bit API. Nothing here calls the registry, so
+ * registry.c does the queries and the locking.
+ *
+ * Key paths are kept the way the registry compares them: without
+ * leading, trailing or doubled backslashes, and case insensitive.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "kernel16_private.h"
+#include "regcache.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(reg);
+
+#define REG_CACHE_BUCKETS  256
+#define REG_KEY_BUCKETS    64
+
+/* path of a key handle opened through the 16-bit API */
+struct reg_key_path
+{
+    struct reg_key_path *next;
+    HKEY  hkey;
+    HKEY  root;
+    DWORD id_size;              /* identity of the key, checked by registry.c */
+    BYTE *id;
+    char  path[1];
+};
+
+static struct reg_cache_entry *reg_cache[REG_CACHE_BUCKETS];
+static DWORD reg_cache_count;
+static struct reg_key_path *reg_key_paths[REG_KEY_BUCKETS];
+
+static int reg_path_cmp( LPCSTR a, LPCSTR b )
+{
+    for (; *a && toupper((unsigned char)*a) == toupper((unsigned char)*b); a++, b++);
+    return toupper((unsigned char)*a) - toupper((unsigned char)*b);
+}
+
+/* whether path is key or a key below it */
+static BOOL reg_path_in_subtree( LPCSTR path, LPCSTR key )
+{
+    if (!*key) return TRUE;
+    for (; *key; path++, key++)
+        if (toupper((unsigned char)*path) != toupper((unsigned char)*key)) return FALSE;
+    return !*path || *path == '\\';
+}
+
+static DWORD reg_cache_hash( HKEY root, BOOL ex, LPCSTR path, LPCSTR value )
+{
+    DWORD hash = (DWORD)(ULONG_PTR)root * 31 + ex;
+
+    for (; *path; path++) hash = hash * 31 + toupper((unsigned char)*path);
+    hash = hash * 31 + '\\';
+    for (; *value; value++) hash = hash * 31 + toupper((unsigned char)*value);
+    return hash % REG_CACHE_BUCKETS;
+}
+
+static inline DWORD reg_key_hash( HKEY hkey )
+{
+    return ((ULONG_PTR)hkey >> 2) % REG_KEY_BUCKETS;
+}
+
+/***********************************************************************
+ *           reg_cache_join_path
+ *
+ * Append the subkey name to a key path in a buffer of REG_CACHE_MAX_PATH
+ * chars. FALSE if the result doesn't fit.
+ */
+BOOL reg_cache_join_path( char *buffer, LPCSTR path, LPCSTR name )
+{
+    char *p = buffer, *end = buffer + REG_CACHE_MAX_PATH - 1;
+    LPCSTR src;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if (!(src = i ? name : path)) continue;
+        while (*src)
+        {
+            if (*src == '\\')
+            {
+                src++;
+                continue;
+            }
+            if (p > buffer)
+            {
+                if (p == end) return FALSE;
+                *p++ = '\\';
+            }
+            while (*src && *src != '\\')
+            {
+                if (p == end) return FALSE;
+                *p++ = *src++;
+            }
+        }
+    }
+    *p = 0;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           reg_cache_find
+ */
+struct reg_cache_entry *reg_cache_find( HKEY root, BOOL ex, LPCSTR path, LPCSTR value )
+{
+    struct reg_cache_entry *entry;
+
+    for (entry = reg_cache[reg_cache_hash( root, ex, path, value )]; entry; entry = entry->next)
+    {
+        if (entry->root == root && entry->ex == ex &&
+            !reg_path_cmp( entry->path, path ) && !reg_path_cmp( entry->value, value ))
+            return entry;
+    }
+    return NULL;
+}
+
+/***********************************************************************
+ *           reg_cache_insert
+ *
+ * Store a query result. The whole cache is dropped when it is full.
+ */
+struct reg_cache_entry *reg_cache_insert( HKEY root, BOOL ex, LPCSTR path, LPCSTR value, DWORD result,
+                                          DWORD type, const void *data, DWORD size )
+{
+    struct reg_cache_entry *entry;
+    size_t path_len = strlen( path ) + 1, value_len = strlen( value ) + 1;
+    DWORD bucket = reg_cache_hash( root, ex, path, value );
+
+    if (size > REG_CACHE_MAX_DATA) return NULL;
+    entry = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET(struct reg_cache_entry, data[size]) + path_len + value_len );
+    if (!entry) return NULL;
+
+    entry->root = root;
+    entry->ex = ex;
+    entry->path = (char *)entry->data + size;
+    entry->value = entry->path + path_len;
+    memcpy( entry->data, data, size );
+    memcpy( entry->path, path, path_len );
+    memcpy( entry->value, value, value_len );
+    entry->result = result;
+    entry->type = type;
+    entry->size = size;
+
+    if (reg_cache_count >= REG_CACHE_MAX_ENTRIES) reg_cache_flush();
+    entry->next = reg_cache[bucket];
+    reg_cache[bucket] = entry;
+    reg_cache_count++;
+    return entry;
+}
+
+/***********************************************************************
+ *           reg_cache_invalidate_key
+ *
+ * Drop the results cached for a key, and for the keys below it if
+ * subtree is set.
+ */
+void reg_cache_invalidate_key( HKEY root, LPCSTR path, BOOL subtree )
+{
+    struct reg_cache_entry **entry, *next;
+    DWORD i;
+
+    TRACE( "%p %s%s\n", root, debugstr_a(path), subtree ? "\\*" : "" );
+    for (i = 0; i < REG_CACHE_BUCKETS; i++)
+    {
+        for (entry = &reg_cache[i]; *entry; )
+        {
+            if ((*entry)->root == root &&
+                (subtree ? reg_path_in_subtree( (*entry)->path, path ) : !reg_path_cmp( (*entry)->path, path )))
+            {
+                next = (*entry)->next;
+                HeapFree( GetProcessHeap(), 0, *entry );
+                *entry = next;
+                reg_cache_count--;
+            }
+            else entry = &(*entry)->next;
+        }
+    }
+}
+
+/***********************************************************************
+ *           reg_cache_flush
+ */
+void reg_cache_flush(void)
+{
+    struct reg_cache_entry *entry, *next;
+    DWORD i;
+
+    for (i = 0; i < REG_CACHE_BUCKETS; i++)
+    {
+        for (entry = reg_cache[i]; entry; entry = next)
+        {
+            next = entry->next;
+            HeapFree( GetProcessHeap(), 0, entry );
+        }
+        reg_cache[i] = NULL;
+    }
+    reg_cache_count = 0;
+}
+
+DWORD reg_cache_get_count(void)
+{
+    return reg_cache_count;
+}
+
+/***********************************************************************
+ *           reg_key_map_add
+ *
+ * Remember the path of a key handle. A handle value can only come back
+ * from the registry after it was closed, so an old entry for it is stale
+ * and replaced.
+ */
+BOOL reg_key_map_add( HKEY hkey, HKEY root, LPCSTR path, const void *id, DWORD id_size )
+{
+    struct reg_key_path *key;
+    size_t len = strlen( path ) + 1;
+
+    reg_key_map_remove( hkey );
+    if (!(key = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET(struct reg_key_path, path[len]) + id_size )))
+        return FALSE;
+    key->hkey = hkey;
+    key->root = root;
+    memcpy( key->path, path, len );
+    key->id = (BYTE *)key->path + len;
+    key->id_size = id_size;
+    memcpy( key->id, id, id_size );
+    key->next = reg_key_paths[reg_key_hash( hkey )];
+    reg_key_paths[reg_key_hash( hkey )] = key;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           reg_key_map_get
+ *
+ * Path of a key handle below its root, NULL if the handle isn't known.
+ */
+LPCSTR reg_key_map_get( HKEY hkey, HKEY *root, const void **id, DWORD *id_size )
+{
+    struct reg_key_path *key;
+
+    for (key = reg_key_paths[reg_key_hash( hkey )]; key; key = key->next)
+    {
+        if (key->hkey != hkey) continue;
+        *root = key->root;
+        *id = key->id;
+        *id_size = key->id_size;
+        return key->path;
+    }
+    return NULL;
+}
+
+/***********************************************************************
+ *           reg_key_map_remove
+ */
+void reg_key_map_remove( HKEY hkey )
+{
+    struct reg_key_path **key, *next;
+
+    for (key = &reg_key_paths[reg_key_hash( hkey )]; *key; key = &(*key)->next)
+    {
+        if ((*key)->hkey != hkey) continue;
+        next = (*key)->next;
+        HeapFree( GetProcessHeap(), 0, *key );
+        *key = next;
+        break;
+    }
+}
+
+/***********************************************************************
+ *           reg_key_map_remove_subtree
+ *
+ * Forget the paths of the handles of a deleted key and its subkeys. The
+ * handles stay open, but queries on them are no longer cached.
+ */
+void reg_key_map_remove_subtree( HKEY root, LPCSTR path )
+{
+    struct reg_key_path **key, *next;
+    DWORD i;
+
+    for (i = 0; i < REG_KEY_BUCKETS; i++)
+    {
+        for (key = &reg_key_paths[i]; *key; )
+        {
+            if ((*key)->root == root && reg_path_in_subtree( (*key)->path, path ))
+            {
+                next = (*key)->next;
+                HeapFree( GetProcessHeap(), 0, *key );
+                *key = next;
+            }
+            else key = &(*key)->next;
+        }
+    }
+}
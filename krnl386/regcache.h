@@ -0,0 +1,62 @@
+/*
+ * Cache of 16-bit registry queries
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_REGCACHE_H
+#define __WINE_REGCACHE_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+
+/* longest key path the cache handles, including the value of RegQueryValue */
+#define REG_CACHE_MAX_PATH     512
+/* larger values aren't cached */
+#define REG_CACHE_MAX_DATA     1024
+/* the cache is flushed when it grows beyond this */
+#define REG_CACHE_MAX_ENTRIES  1024
+
+/* a cached RegQueryValue (default value of path) or RegQueryValueEx result */
+struct reg_cache_entry
+{
+    struct reg_cache_entry *next;
+    HKEY  root;
+    BOOL  ex;
+    char *path;                 /* key path below root */
+    char *value;                /* value name, "" for RegQueryValue */
+    DWORD result;               /* ERROR_SUCCESS or ERROR_FILE_NOT_FOUND */
+    DWORD type;
+    DWORD size;
+    BYTE  data[1];
+};
+
+/* none of these lock, the caller serializes */
+extern BOOL reg_cache_join_path( char *buffer, LPCSTR path, LPCSTR name ) DECLSPEC_HIDDEN;
+extern struct reg_cache_entry *reg_cache_find( HKEY root, BOOL ex, LPCSTR path, LPCSTR value ) DECLSPEC_HIDDEN;
+extern struct reg_cache_entry *reg_cache_insert( HKEY root, BOOL ex, LPCSTR path, LPCSTR value, DWORD result,
+                                                 DWORD type, const void *data, DWORD size ) DECLSPEC_HIDDEN;
+extern void reg_cache_invalidate_key( HKEY root, LPCSTR path, BOOL subtree ) DECLSPEC_HIDDEN;
+extern void reg_cache_flush(void) DECLSPEC_HIDDEN;
+extern DWORD reg_cache_get_count(void) DECLSPEC_HIDDEN;
+
+extern BOOL reg_key_map_add( HKEY hkey, HKEY root, LPCSTR path, const void *id, DWORD id_size ) DECLSPEC_HIDDEN;
+extern LPCSTR reg_key_map_get( HKEY hkey, HKEY *root, const void **id, DWORD *id_size ) DECLSPEC_HIDDEN;
+extern void reg_key_map_remove( HKEY hkey ) DECLSPEC_HIDDEN;
+extern void reg_key_map_remove_subtree( HKEY root, LPCSTR path ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_REGCACHE_H */
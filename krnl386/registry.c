@@ -22,6 +22,7 @@
  */
 
 #include <stdarg.h>
+#include <ctype.h>
 
 #include "windef.h"
 #include "winbase.h"
@@ -30,6 +31,7 @@
 #include "wine/winbase16.h"
 #include "wine/exception.h"
 #include "kernel16_private.h"
+#include "regcache.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(reg);
 
@@ -126,6 +128,218 @@ static BOOL is_empty(LPCSTR name)
     return name == NULL || name[0] == 0;
 }
 
+/*
+ * Read-through cache of RegQueryValue/RegQueryValueEx results below the
+ * classes root (or the redirected roots), kept by regcache.c.
+ *
+ * Keys opened through the 16-bit API are tracked by path so that queries
+ * on them can be cached too. A handle may have been closed behind our
+ * back (RegCloseKey instead of RegCloseKey16) and its value reused for
+ * another key, so the kernel name of the key is checked before its path
+ * is trusted.
+ *
+ * 16-bit writes drop the cached results of the key they touch, and of its
+ * subkeys when keys are created or deleted. Other writers are caught by
+ * change notifications on the watched roots, which flush the whole cache.
+ *
+ * Repeated RegOpenKey16 calls on the same path don't share a cached key
+ * handle: every caller closes the handle it got, and duplicating a cached
+ * handle takes a kernel call just like opening the key again.
+ */
+#define REG_CACHE_MAX_WATCH    2
+
+static BOOL reg_cache_init_done;
+static BOOL reg_cache_enabled;
+static HKEY reg_watch_key[REG_CACHE_MAX_WATCH];
+static HANDLE reg_watch_event[REG_CACHE_MAX_WATCH];
+static DWORD reg_watch_count;
+
+static CRITICAL_SECTION reg_cache_section;
+static CRITICAL_SECTION_DEBUG critsect_debug =
+{
+    0, 0, &reg_cache_section,
+    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": reg_cache_section") }
+};
+static CRITICAL_SECTION reg_cache_section = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+static BOOL reg_cache_is_root( HKEY hkey )
+{
+    if (enable_registry_redirection)
+        return hkey == registry_redirection_classes ||
+               hkey == registry_redirection_current_user ||
+               hkey == registry_redirection_local_machine;
+    return hkey == HKEY_CLASSES_ROOT;
+}
+
+static BOOL reg_cache_watch( DWORD i )
+{
+    ResetEvent( reg_watch_event[i] );
+    return RegNotifyChangeKeyValue( reg_watch_key[i], TRUE,
+                                    REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                                    reg_watch_event[i], TRUE ) == ERROR_SUCCESS;
+}
+
+static BOOL reg_cache_add_watch( HKEY root, LPCSTR name )
+{
+    DWORD i = reg_watch_count;
+
+    if (RegOpenKeyExA( root, name, 0, KEY_NOTIFY, &reg_watch_key[i] ) != ERROR_SUCCESS)
+        return FALSE;
+    if (!(reg_watch_event[i] = CreateEventA( NULL, TRUE, FALSE, NULL )))
+    {
+        RegCloseKey( reg_watch_key[i] );
+        return FALSE;
+    }
+    reg_watch_count++;
+    return reg_cache_watch( i );
+}
+
+/* must be called with reg_cache_section held */
+static BOOL reg_cache_check(void)
+{
+    DWORD i;
+
+    if (!reg_cache_init_done)
+    {
+        reg_cache_init_done = TRUE;
+        if (enable_registry_redirection)
+            reg_cache_enabled = reg_cache_add_watch( registry_redirection_root, NULL );
+        else
+            reg_cache_enabled = reg_cache_add_watch( HKEY_CLASSES_ROOT, NULL ) &&
+                                reg_cache_add_watch( HKEY_CURRENT_USER, "Software\\Classes" );
+        if (!reg_cache_enabled) WARN( "registry cache disabled\n" );
+    }
+    if (!reg_cache_enabled) return FALSE;
+
+    for (i = 0; i < reg_watch_count; i++)
+    {
+        if (WaitForSingleObject( reg_watch_event[i], 0 ) == WAIT_TIMEOUT) continue;
+        TRACE( "registry changed, flushing cache\n" );
+        reg_cache_flush();
+        if (!reg_cache_watch( i ))
+        {
+            reg_cache_enabled = FALSE;
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* kernel name of a key, which identifies it whatever handle it is opened with */
+static BOOL reg_key_get_id( HKEY hkey, KEY_NAME_INFORMATION *info, DWORD size, DWORD *id_size )
+{
+    DWORD len;
+
+    if (NtQueryKey( hkey, KeyNameInformation, info, size, &len )) return FALSE;
+    *id_size = FIELD_OFFSET(KEY_NAME_INFORMATION, Name) + info->NameLength;
+    return TRUE;
+}
+
+/* returns the path of hkey below a cached root, or NULL; must be called with reg_cache_section held */
+static LPCSTR reg_key_get_path( HKEY hkey, HKEY *root )
+{
+    BYTE buffer[FIELD_OFFSET(KEY_NAME_INFORMATION, Name[REG_CACHE_MAX_PATH * 2])];
+    const void *id;
+    DWORD id_size, size;
+    LPCSTR path;
+
+    if (reg_cache_is_root( hkey ))
+    {
+        *root = hkey;
+        return "";
+    }
+    if (!(path = reg_key_map_get( hkey, root, &id, &id_size ))) return NULL;
+    if (reg_key_get_id( hkey, (KEY_NAME_INFORMATION *)buffer, sizeof(buffer), &size ) &&
+        size == id_size && !memcmp( buffer, id, size ))
+        return path;
+    TRACE( "handle %p no longer refers to %s\n", hkey, debugstr_a(path) );
+    reg_key_map_remove( hkey );
+    return NULL;
+}
+
+/* remember the path of a key opened with RegOpenKey16/RegCreateKey16 */
+static void reg_key_add_path( HKEY parent, LPCSTR name, HKEY hkey )
+{
+    BYTE buffer[FIELD_OFFSET(KEY_NAME_INFORMATION, Name[REG_CACHE_MAX_PATH * 2])];
+    char path[REG_CACHE_MAX_PATH];
+    LPCSTR parent_path;
+    DWORD id_size;
+    HKEY root;
+
+    fix_win16_hkey( &hkey );
+    if (reg_cache_is_root( hkey ) || (ULONG_PTR)hkey >= 0x80000000) return;
+    EnterCriticalSection( &reg_cache_section );
+    if ((parent_path = reg_key_get_path( parent, &root )) &&
+        reg_cache_join_path( path, parent_path, name ) &&
+        reg_key_get_id( hkey, (KEY_NAME_INFORMATION *)buffer, sizeof(buffer), &id_size ))
+        reg_key_map_add( hkey, root, path, buffer, id_size );
+    else
+        reg_key_map_remove( hkey );  /* the handle value may have been reused */
+    LeaveCriticalSection( &reg_cache_section );
+}
+
+static void reg_key_remove_path( HKEY hkey )
+{
+    EnterCriticalSection( &reg_cache_section );
+    reg_key_map_remove( hkey );
+    LeaveCriticalSection( &reg_cache_section );
+}
+
+/*
+ * drop cached values after a 16-bit write to the key name below hkey, and
+ * below it if subtree is set; everything is dropped if the key isn't known
+ */
+static void reg_cache_invalidate( HKEY hkey, LPCSTR name, BOOL subtree, BOOL deleted )
+{
+    char path[REG_CACHE_MAX_PATH];
+    LPCSTR key_path;
+    HKEY root;
+
+    EnterCriticalSection( &reg_cache_section );
+    if ((key_path = reg_key_get_path( hkey, &root )) && reg_cache_join_path( path, key_path, name ))
+    {
+        reg_cache_invalidate_key( root, path, subtree );
+        if (deleted) reg_key_map_remove_subtree( root, path );
+    }
+    else reg_cache_flush();
+    LeaveCriticalSection( &reg_cache_section );
+}
+
+/* query a value and store the result, must be called with reg_cache_section held */
+static struct reg_cache_entry *reg_cache_fill( HKEY hkey, HKEY root, BOOL ex, LPCSTR path,
+                                               LPCSTR name, LPCSTR value )
+{
+    BYTE data[REG_CACHE_MAX_DATA];
+    DWORD result, type = 0, size = sizeof(data);
+
+    if (ex) result = pRegQueryValueExA( hkey, name, NULL, &type, data, &size );
+    else result = pRegQueryValueA( hkey, name, (LPSTR)data, (LONG *)&size );
+    if (result == ERROR_FILE_NOT_FOUND) size = 0;
+    else if (result != ERROR_SUCCESS) return NULL;  /* too large, or not worth caching */
+
+    return reg_cache_insert( root, ex, path, value, result, type, data, size );
+}
+
+/* look up a cached query, must be called with reg_cache_section held */
+static struct reg_cache_entry *reg_cache_lookup( HKEY hkey, LPCSTR name, BOOL ex )
+{
+    struct reg_cache_entry *entry;
+    char path[REG_CACHE_MAX_PATH];
+    LPCSTR key_path, value;
+    HKEY root;
+
+    if (!reg_cache_check()) return NULL;
+    if (!(key_path = reg_key_get_path( hkey, &root ))) return NULL;
+
+    /* RegQueryValue reads the default value of the subkey name */
+    if (!reg_cache_join_path( path, key_path, ex ? NULL : name )) return NULL;
+    value = ex && name ? name : "";
+
+    if ((entry = reg_cache_find( root, ex, path, value ))) return entry;
+    return reg_cache_fill( hkey, root, ex, path, name, value );
+}
+
 /******************************************************************************
  *           RegEnumKey   [KERNEL.216]
  */
@@ -164,6 +378,7 @@ DWORD WINAPI RegOpenKey16( HKEY hkey, LPCSTR name, PHKEY retkey )
     fix_win16_hkey( &hkey );
     DWORD result = pRegOpenKeyA( hkey, name, retkey );
     fix_redir_key(retkey, &result);
+    if (result == ERROR_SUCCESS) reg_key_add_path( hkey, name, *retkey );
     return result;
 }
 
@@ -229,6 +444,16 @@ DWORD WINAPI RegCreateKey16( HKEY hkey, LPCSTR name, PHKEY retkey )
     if (result != ERROR_SUCCESS)
         result = RegOpenKeyA(hkey, name, retkey);
     fix_redir_key(retkey, &result);
+    if (result == ERROR_SUCCESS)
+    {
+        char first[REG_CACHE_MAX_PATH];
+
+        /* the keys created are the first missing component of name and its subkeys */
+        if (reg_cache_join_path( first, NULL, name ) && strchr( first, '\\' )) *strchr( first, '\\' ) = 0;
+        else first[0] = 0;
+        reg_cache_invalidate( hkey, first, TRUE, FALSE );
+        reg_key_add_path( hkey, name, *retkey );
+    }
     TRACE("%x, %x\n", result, *retkey);
     return result;
 }
@@ -243,6 +468,7 @@ DWORD WINAPI RegDeleteKey16( HKEY hkey, LPCSTR name )
     if (is_redir_root_key(hkey) && is_empty(name))
         return ERROR_SUCCESS;
     DWORD result = pRegDeleteKeyA( hkey, name );
+    if (result == ERROR_SUCCESS) reg_cache_invalidate( hkey, name, TRUE, TRUE );
     return result;
 }
 
@@ -256,6 +482,7 @@ DWORD WINAPI RegCloseKey16( HKEY hkey )
     fix_win16_hkey( &hkey );
     if (is_redir_root_key(hkey))
         return ERROR_SUCCESS;
+    reg_key_remove_path( hkey );
     DWORD result = pRegCloseKey( hkey );
     return result;
 }
@@ -301,6 +528,7 @@ DWORD WINAPI RegDeleteValue16( HKEY hkey, LPSTR name )
     if (is_redir_root_key(hkey) && is_empty(name))
         return ERROR_SUCCESS;
     DWORD result = pRegDeleteValueA( hkey, name );
+    if (result == ERROR_SUCCESS) reg_cache_invalidate( hkey, NULL, FALSE, FALSE );
     return result;
 }
 
@@ -329,9 +557,37 @@ DWORD WINAPI RegEnumValue16( HKEY hkey, DWORD index, LPSTR value, LPDWORD val_co
  */
 DWORD WINAPI RegQueryValue16( HKEY hkey, LPCSTR name, LPSTR data, LPDWORD count )
 {
+    struct reg_cache_entry *entry;
+    DWORD cached = ~0u;
+
     if (!advapi32) init_func_ptrs();
     fix_win16_hkey( &hkey );
     if (count) *count &= 0xffff;
+    if (count)
+    {
+        EnterCriticalSection( &reg_cache_section );
+        __TRY
+        {
+            if ((entry = reg_cache_lookup( hkey, name, FALSE )))
+            {
+                cached = entry->result;
+                if (cached == ERROR_SUCCESS && !data) *count = entry->size;
+                else if (cached == ERROR_SUCCESS)
+                {
+                    /* truncate like the ERROR_MORE_DATA case below */
+                    if (*count >= entry->size) *count = entry->size;
+                    memcpy( data, entry->data, *count );
+                }
+            }
+        }
+        __EXCEPT_PAGE_FAULT
+        {
+            cached = ~0u;
+        }
+        __ENDTRY
+        LeaveCriticalSection( &reg_cache_section );
+        if (cached != ~0u) return cached;
+    }
     DWORD incount = *count;
     DWORD result = pRegQueryValueA( hkey, name, data, (LONG*) count );
     if (result == ERROR_MORE_DATA)
@@ -352,8 +608,36 @@ DWORD WINAPI RegQueryValue16( HKEY hkey, LPCSTR name, LPSTR data, LPDWORD count
 DWORD WINAPI RegQueryValueEx16( HKEY hkey, LPCSTR name, LPDWORD reserved, LPDWORD type,
                                 LPBYTE data, LPDWORD count )
 {
+    struct reg_cache_entry *entry;
+    DWORD cached = ~0u;
+
     if (!advapi32) init_func_ptrs();
     fix_win16_hkey( &hkey );
+    if (!reserved && (count || !data))
+    {
+        EnterCriticalSection( &reg_cache_section );
+        __TRY
+        {
+            if ((entry = reg_cache_lookup( hkey, name, TRUE )))
+            {
+                cached = entry->result;
+                if (cached == ERROR_SUCCESS)
+                {
+                    if (type) *type = entry->type;
+                    if (data && *count < entry->size) cached = ERROR_MORE_DATA;
+                    else if (data) memcpy( data, entry->data, entry->size );
+                    if (count) *count = entry->size;
+                }
+            }
+        }
+        __EXCEPT_PAGE_FAULT
+        {
+            cached = ~0u;
+        }
+        __ENDTRY
+        LeaveCriticalSection( &reg_cache_section );
+        if (cached != ~0u) return cached;
+    }
     DWORD result = pRegQueryValueExA( hkey, name, reserved, type, data, count );
     return result;
 }
@@ -367,6 +651,7 @@ DWORD WINAPI RegSetValueEx16( HKEY hkey, LPCSTR name, DWORD reserved, DWORD type
     if (!advapi32) init_func_ptrs();
     fix_win16_hkey( &hkey );
     DWORD result = pRegSetValueExA( hkey, name, reserved, type, data, count );
+    reg_cache_invalidate( hkey, NULL, FALSE, FALSE );
     return result;
 }
 
@@ -504,6 +504,7 @@ int relay_call_from_16( void *entry_point, unsigned char *args16, CONTEXT *conte
     char module[10], func[64];
     const CALLFROM16 *call;
 
+    stats_calls_from_16++;
     frame = CURRENT_STACK16;
     call = get_entry_point( frame, module, func, &ordinal );
     if (!call)
@@ -25,6 +25,7 @@
 #include "wine/port.h"
 
 #include <stdarg.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,6 +38,8 @@
 #include "wine/winuser16.h"
 #include "wine/unicode.h"
 #include "kernel16_private.h"
+#include "iconcache.h"
+#include "rsrcindex.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(resource);
@@ -55,8 +58,12 @@ static inline NE_MODULE *get_module( HMODULE16 mod )
 
 typedef struct _HRSRC_ELEM
 {
-    HRSRC hRsrc;
-    WORD  type;
+    HRSRC     hRsrc;
+    WORD      type;
+    WORD      usage;    /* load count of the converted 16-bit block */
+    HGLOBAL16 handle;   /* converted 16-bit block, shared between loads */
+    DWORD     size16;   /* size of the converted image */
+    LPVOID    data16;   /* converted image, used to refresh or recreate the block */
 } HRSRC_ELEM;
 
 typedef struct _HRSRC_MAP
@@ -64,9 +71,41 @@ typedef struct _HRSRC_MAP
     int nAlloc;
     int nUsed;
     HRSRC_ELEM *elem;
+    int nHash;          /* size of the hash table, a power of 2 */
+    WORD *hash;         /* HRSRC hash -> index + 1 into elem */
 } HRSRC_MAP;
 
 
+static inline UINT hash_hrsrc( HRSRC hRsrc )
+{
+    ULONG_PTR key = (ULONG_PTR)hRsrc;
+    return (UINT)(key ^ (key >> 4) ^ (key >> 12));
+}
+
+/**********************************************************************
+ *          MapHRsrcRehash
+ *
+ * Rebuild the hash table of the HRSRC map for its current allocation.
+ */
+static BOOL MapHRsrcRehash( HRSRC_MAP *map )
+{
+    int i, size = 32;
+    WORD *hash;
+
+    while (size < map->nAlloc * 2) size *= 2;
+    if (!(hash = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(WORD) ))) return FALSE;
+    for (i = 0; i < map->nUsed; i++)
+    {
+        UINT h = hash_hrsrc( map->elem[i].hRsrc ) & (size - 1);
+        while (hash[h]) h = (h + 1) & (size - 1);
+        hash[h] = i + 1;
+    }
+    HeapFree( GetProcessHeap(), 0, map->hash );
+    map->hash = hash;
+    map->nHash = size;
+    return TRUE;
+}
+
 /**********************************************************************
  *          MapHRsrc32To16
  */
@@ -74,7 +113,7 @@ static HRSRC16 MapHRsrc32To16( NE_MODULE *pModule, HRSRC hRsrc32, WORD type )
 {
     HRSRC_MAP *map = pModule->rsrc32_map;
     HRSRC_ELEM *newElem;
-    int i;
+    UINT h;
 
     /* On first call, initialize HRSRC map */
     if ( !map )
@@ -88,9 +127,19 @@ static HRSRC16 MapHRsrc32To16( NE_MODULE *pModule, HRSRC hRsrc32, WORD type )
     }
 
     /* Check whether HRSRC32 already in map */
-    for ( i = 0; i < map->nUsed; i++ )
-        if ( map->elem[i].hRsrc == hRsrc32 )
-            return (HRSRC16)(i + 1);
+    if ( map->hash )
+    {
+        for ( h = hash_hrsrc( hRsrc32 ) & (map->nHash - 1); map->hash[h]; h = (h + 1) & (map->nHash - 1) )
+            if ( map->elem[map->hash[h] - 1].hRsrc == hRsrc32 )
+                return (HRSRC16)map->hash[h];
+    }
+
+    /* HRSRC16 values are 1-based indices, don't overflow them */
+    if ( map->nUsed >= 0xffff )
+    {
+        ERR("HRSRC map is full\n" );
+        return 0;
+    }
 
     /* If no space left, grow table */
     if ( map->nUsed == map->nAlloc )
@@ -111,12 +160,20 @@ static HRSRC16 MapHRsrc32To16( NE_MODULE *pModule, HRSRC hRsrc32, WORD type )
         map->elem = newElem;
         map->nAlloc += HRSRC_MAP_BLOCKSIZE;
     }
+    if ( map->nHash < map->nAlloc * 2 && !MapHRsrcRehash( map ) )
+    {
+        ERR("Cannot grow HRSRC hash table\n" );
+        return 0;
+    }
 
     /* Add HRSRC32 to table */
     map->elem[map->nUsed].hRsrc = hRsrc32;
     map->elem[map->nUsed].type  = type;
     map->nUsed++;
 
+    for ( h = hash_hrsrc( hRsrc32 ) & (map->nHash - 1); map->hash[h]; h = (h + 1) & (map->nHash - 1) ) ;
+    map->hash[h] = map->nUsed;
+
     return (HRSRC16)map->nUsed;
 }
 
@@ -132,14 +189,28 @@ static HRSRC MapHRsrc16To32( NE_MODULE *pModule, HRSRC16 hRsrc16 )
 }
 
 /**********************************************************************
- *          MapHRsrc16ToType
+ *          MapHRsrc16ToElem
  */
-static WORD MapHRsrc16ToType( NE_MODULE *pModule, HRSRC16 hRsrc16 )
+static HRSRC_ELEM *MapHRsrc16ToElem( NE_MODULE *pModule, HRSRC16 hRsrc16 )
 {
     HRSRC_MAP *map = pModule->rsrc32_map;
-    if ( !map || !hRsrc16 || hRsrc16 > map->nUsed ) return 0;
+    if ( !map || !hRsrc16 || hRsrc16 > map->nUsed ) return NULL;
+
+    return &map->elem[hRsrc16-1];
+}
 
-    return map->elem[hRsrc16-1].type;
+/**********************************************************************
+ *          FreeHRsrcMap
+ */
+static void FreeHRsrcMap( HRSRC_MAP *map )
+{
+    int i;
+
+    for (i = 0; i < map->nUsed; i++)
+        HeapFree( GetProcessHeap(), 0, map->elem[i].data16 );
+    HeapFree( GetProcessHeap(), 0, map->elem );
+    HeapFree( GetProcessHeap(), 0, map->hash );
+    HeapFree( GetProcessHeap(), 0, map );
 }
 
 
@@ -156,11 +227,14 @@ static inline LPCSTR get_res_name( LPCSTR name )
 
 
 /**********************************************************************
- *          next_typeinfo
+ *          same_block
+ *
+ * Compare a handle or selector with the handle of a resource block;
+ * discardable resources are moveable, with a handle of selector - 1.
  */
-static inline NE_TYPEINFO *next_typeinfo( NE_TYPEINFO *info )
+static inline BOOL same_block( HGLOBAL16 handle, HGLOBAL16 other )
 {
-    return (NE_TYPEINFO *)((char*)(info + 1) + info->count * sizeof(NE_NAMEINFO));
+    return handle && (handle | 7) == (other | 7);
 }
 
 
@@ -329,6 +403,98 @@ static NE_NAMEINFO *NE_FindResourceFromType( LPBYTE pResTab, NE_TYPEINFO *pTypeI
 }
 
 
+/***********************************************************************
+ *           NE_GetResourceIndex
+ *
+ * Return the hashed (type, name) -> resource index of a NE module,
+ * building it on first use.
+ */
+static struct ne_rsrc_index *NE_GetResourceIndex( NE_MODULE *pModule )
+{
+    if (!pModule->rsrc_index)
+    {
+        pModule->rsrc_index = ne_rsrc_index_build( (LPBYTE)pModule + pModule->ne_rsrctab, pModule->ne_rsrctab );
+        TRACE("module=%04x index %p\n", pModule->self, pModule->rsrc_index );
+    }
+    return pModule->rsrc_index;
+}
+
+
+/***********************************************************************
+ *           NE_IsResourceBlock
+ *
+ * Check that a block is still the one allocated for hRsrc, and hasn't
+ * been freed, discarded or reallocated meanwhile. Blocks of resources
+ * are tagged with GT_RESOURCE and the hRsrc when they are allocated,
+ * and a new allocation of the same selector clears the tag.
+ */
+static BOOL NE_IsResourceBlock( NE_MODULE *pModule, HGLOBAL16 handle, HRSRC16 hRsrc, DWORD size )
+{
+    return handle && GlobalHandle16( handle ) &&
+           !(GlobalFlags16( handle ) & GMEM_DISCARDED) &&
+           FarGetOwner16( handle ) == pModule->self &&
+           (GLOBAL_GetSegType( handle ) & 0x0f) == GT_RESOURCE &&
+           GLOBAL_GetSegNum( handle ) == hRsrc &&
+           GlobalSize16( handle ) >= size;
+}
+
+
+/***********************************************************************
+ *           NE_IsCachedStringBlock
+ *
+ * Check whether a string table block is still loaded from a previous
+ * LoadResource16, so that it doesn't need to be read again.
+ */
+static BOOL NE_IsCachedStringBlock( NE_MODULE *pModule, HRSRC16 hRsrc, NE_NAMEINFO *pNameInfo )
+{
+    struct ne_rsrc_index *index = pModule->rsrc_index;
+    WORD sizeShift;
+    int i;
+
+    if (!index || !pNameInfo->handle) return FALSE;
+    if ((i = ne_rsrc_index_find_string( index, hRsrc )) < 0) return FALSE;
+
+    sizeShift = *(WORD *)((char *)pModule + pModule->ne_rsrctab);
+    if (!NE_IsResourceBlock( pModule, pNameInfo->handle, hRsrc, (DWORD)pNameInfo->length << sizeShift ))
+    {
+        index->strings[i] = 0;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           NE_AddCachedStringBlock
+ */
+static void NE_AddCachedStringBlock( NE_MODULE *pModule, HRSRC16 hRsrc )
+{
+    struct ne_rsrc_index *index = NE_GetResourceIndex( pModule );
+
+    if (index) ne_rsrc_index_add_string( index, hRsrc );
+}
+
+
+/***********************************************************************
+ *           NE_FreeResourceIndex
+ *
+ * Free the resource index and the HRSRC map when the module is unloaded.
+ */
+void NE_FreeResourceIndex( NE_MODULE *pModule )
+{
+    struct ne_rsrc_index *index = pModule->rsrc_index;
+
+    if (pModule->rsrc32_map)
+    {
+        FreeHRsrcMap( pModule->rsrc32_map );
+        pModule->rsrc32_map = NULL;
+    }
+    if (!index) return;
+    pModule->rsrc_index = NULL;
+    ne_rsrc_index_free( index );
+}
+
+
 /***********************************************************************
  *           DefResourceHandler (KERNEL.456)
  *
@@ -361,6 +527,8 @@ HGLOBAL16 WINAPI NE_DefResourceHandler( HGLOBAL16 hMemObj, HMODULE16 hModule,
             GlobalFree16( handle );
             handle = 0;
         }
+        /* GlobalLock16 locks discardable blocks, LockResource16 does it for the application */
+        else GlobalUnlock16( handle );
     }
     return handle;
 }
@@ -836,38 +1004,137 @@ static void ConvertAccelerator32To16( LPCVOID acc32, DWORD size, LPVOID acc16 )
 
 
 /**********************************************************************
- *	    NE_LoadPEResource
+ *	    ConvertString32To16
+ *
+ * Convert a block of 16 counted Unicode strings to counted ANSI strings.
+ * The 16-bit block is never larger than the 32-bit one.
  */
-static HGLOBAL16 NE_LoadPEResource( NE_MODULE *pModule, WORD type, LPCVOID bits, DWORD size )
+static DWORD ConvertString32To16( LPCVOID str32, DWORD size, LPVOID str16 )
 {
-    HGLOBAL16 handle;
+    LPCWSTR p = str32, end = (LPCWSTR)((const BYTE *)str32 + size);
+    BYTE *dst = str16;
+    int i, len;
+
+    for (i = 0; i < 16 && p < end; i++)
+    {
+        WORD count = min( *p, end - p - 1 );
+        /* at most 2 bytes per character, no more than the 32-bit string */
+        len = count ? WideCharToMultiByte( CP_ACP, 0, p + 1, count, (LPSTR)dst + 1, 2 * count, NULL, NULL ) : 0;
+        if (len > 255) len = 255;
+        *dst = len;
+        dst += len + 1;
+        p += count + 1;
+    }
+    return dst - (BYTE *)str16;
+}
 
-    TRACE("module=%04x type=%04x\n", pModule->self, type );
 
-    handle = GlobalAlloc16( 0, size );
+/**********************************************************************
+ *	    NE_ConvertPEResource
+ *
+ * Convert a 32-bit resource to its 16-bit format, in a buffer that is kept
+ * with the HRSRC mapping so that later loads don't need to convert again.
+ */
+static LPVOID NE_ConvertPEResource( WORD type, LPCVOID bits, DWORD size, DWORD *size16 )
+{
+    LPVOID data = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, max( size, 1 ) );
+
+    if (!data) return NULL;
+    *size16 = size;
 
     switch (type)
     {
     case (WORD)RT_MENU:
-        ConvertMenu32To16( bits, size, GlobalLock16( handle ) );
+        ConvertMenu32To16( bits, size, data );
         break;
     case (WORD)RT_DIALOG:
-        ConvertDialog32To16( bits, size, GlobalLock16( handle ) );
+        ConvertDialog32To16( bits, size, data );
         break;
     case (WORD)RT_ACCELERATOR:
-        ConvertAccelerator32To16( bits, size, GlobalLock16( handle ) );
+        ConvertAccelerator32To16( bits, size, data );
         break;
     case (WORD)RT_STRING:
-        FIXME("not yet implemented!\n" );
-        /* fall through */
+        ConvertString32To16( bits, size, data );
+        break;
     default:
-        memcpy( GlobalLock16( handle ), bits, size );
+        memcpy( data, bits, size );
         break;
     }
+    return data;
+}
+
+
+/**********************************************************************
+ *	    NE_LoadPEResource
+ *
+ * The converted block is shared between loads of the same resource and
+ * reference counted like the resources of NE modules. Once all users
+ * have freed it, the next load refreshes it from the converted image.
+ */
+static HGLOBAL16 NE_LoadPEResource( NE_MODULE *pModule, HRSRC16 hRsrc, HMODULE m32 )
+{
+    HRSRC_ELEM *elem = MapHRsrc16ToElem( pModule, hRsrc );
+    HGLOBAL16 handle;
+
+    if (!elem) return 0;
+
+    TRACE("module=%04x type=%04x\n", pModule->self, elem->type );
+
+    if (NE_IsResourceBlock( pModule, elem->handle, hRsrc, elem->size16 ))
+    {
+        if (!elem->usage++)
+            memcpy( GlobalLock16( elem->handle ), elem->data16, elem->size16 );
+        TRACE("  Already loaded, new count=%d\n", elem->usage );
+        return elem->handle;
+    }
+    elem->handle = 0;
+    elem->usage = 0;
+
+    if (!elem->data16)
+    {
+        HGLOBAL hMem = LoadResource( m32, elem->hRsrc );
+        DWORD size   = SizeofResource( m32, elem->hRsrc );
+        if (!hMem) return 0;
+        if (!(elem->data16 = NE_ConvertPEResource( elem->type, LockResource( hMem ), size, &elem->size16 )))
+            return 0;
+    }
+
+    if (!(handle = GlobalAlloc16( 0, elem->size16 ))) return 0;
+    FarSetOwner16( handle, pModule->self );
+    GLOBAL_SetSeg( handle, hRsrc, GT_RESOURCE );
+    memcpy( GlobalLock16( handle ), elem->data16, elem->size16 );
+    elem->handle = handle;
+    elem->usage = 1;
     return handle;
 }
 
 
+/**********************************************************************
+ *	    NE_FreePEResource
+ *
+ * Release a block loaded by NE_LoadPEResource.
+ * Returns FALSE if the handle doesn't belong to the module.
+ */
+static BOOL NE_FreePEResource( NE_MODULE *pModule, HGLOBAL16 handle, BOOL16 *ret )
+{
+    HRSRC_MAP *map = pModule->rsrc32_map;
+    int i;
+
+    if (!map) return FALSE;
+    for (i = 0; i < map->nUsed; i++)
+    {
+        HRSRC_ELEM *elem = &map->elem[i];
+        if (elem->handle != handle) continue;
+        if (elem->usage > 0 && --elem->usage)
+            *ret = handle;
+        else
+            *ret = FALSE;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
 /**********************************************************************
  *	    AllocResource    (KERNEL.66)
  */
@@ -886,8 +1153,16 @@ HGLOBAL16 WINAPI AllocResource16( HMODULE16 hModule, HRSRC16 hRsrc, DWORD size)
     pNameInfo = (NE_NAMEINFO*)((char*)pModule + hRsrc);
     if (size < (DWORD)pNameInfo->length << sizeShift)
         size = (DWORD)pNameInfo->length << sizeShift;
-    ret = GlobalAlloc16( GMEM_FIXED, size );
-    if (ret) FarSetOwner16( ret, hModule );
+    /* discardable resources are moveable, they are reloaded by LoadResource16/LockResource16 */
+    if (pNameInfo->flags & NE_SEGFLAGS_DISCARDABLE)
+        ret = GlobalAlloc16( GMEM_MOVEABLE | GMEM_DISCARDABLE, size );
+    else
+        ret = GlobalAlloc16( GMEM_FIXED, size );
+    if (ret)
+    {
+        FarSetOwner16( ret, hModule );
+        GLOBAL_SetSeg( ret, hRsrc, GT_RESOURCE );
+    }
     return ret;
 }
 
@@ -941,6 +1216,7 @@ HRSRC16 WINAPI FindResource16( HMODULE16 hModule, LPCSTR name, LPCSTR type )
 {
     NE_TYPEINFO *pTypeInfo;
     NE_NAMEINFO *pNameInfo;
+    struct ne_rsrc_index *index;
     LPBYTE pResTab;
     NE_MODULE *pModule = get_module( hModule );
 
@@ -972,6 +1248,13 @@ HRSRC16 WINAPI FindResource16( HMODULE16 hModule, LPCSTR name, LPCSTR type )
         }
     }
     pResTab = (LPBYTE)pModule + pModule->ne_rsrctab;
+    if ((index = NE_GetResourceIndex( pModule )))
+    {
+        HRSRC16 hRsrc = ne_rsrc_index_lookup( index, pResTab, type, name );
+        if (hRsrc) TRACE("    Found id %p\n", name );
+        return hRsrc;
+    }
+
     pTypeInfo = (NE_TYPEINFO *)( pResTab + 2 );
 
     for (;;)
@@ -1014,12 +1297,7 @@ HGLOBAL16 WINAPI LoadResource16( HMODULE16 hModule, HRSRC16 hRsrc )
     {
         /* load 32-bit resource and convert it */
         HMODULE m32 = (pModule->ne_flags & NE_FFLAGS_BUILTIN) ? pModule->owner32 : pModule->module32;
-        HRSRC hRsrc32 = MapHRsrc16To32( pModule, hRsrc );
-        WORD type     = MapHRsrc16ToType( pModule, hRsrc );
-        HGLOBAL hMem  = LoadResource( m32, hRsrc32 );
-        DWORD size    = SizeofResource( m32, hRsrc32 );
-        if (!hMem) return 0;
-        return NE_LoadPEResource( pModule, type, LockResource( hMem ), size );
+        return NE_LoadPEResource( pModule, hRsrc, m32 );
     }
 
     /* first, verify hRsrc (just an offset from pModule to the needed pNameInfo) */
@@ -1049,9 +1327,20 @@ HGLOBAL16 WINAPI LoadResource16( HMODULE16 hModule, HRSRC16 hRsrc )
             pNameInfo->usage++;
             TRACE("  Already loaded, new count=%d\n", pNameInfo->usage );
         }
+        else if (pTypeInfo->type_id == NE_RSCTYPE_STRING && NE_IsCachedStringBlock( pModule, hRsrc, pNameInfo ))
+        {
+            pNameInfo->usage++;
+            TRACE("  String block still loaded, new count=%d\n", pNameInfo->usage );
+        }
         else
         {
             FARPROC16 resloader;
+
+            /* a discarded block is reloaded in place, but a live one that isn't
+             * tagged for this resource was freed and its selector reused since */
+            if (pNameInfo->handle && !(GlobalFlags16( pNameInfo->handle ) & GMEM_DISCARDED) &&
+                !NE_IsResourceBlock( pModule, pNameInfo->handle, hRsrc, 0 ))
+                pNameInfo->handle = 0;
             memcpy_unaligned( &resloader, &pTypeInfo->resloader, sizeof(FARPROC16) );
             if (resloader && resloader != get_default_res_handler())
             {
@@ -1065,7 +1354,11 @@ HGLOBAL16 WINAPI LoadResource16( HMODULE16 hModule, HRSRC16 hRsrc )
                 pNameInfo->handle = LOWORD(ret);
             }
             else
+            {
                 pNameInfo->handle = NE_DefResourceHandler( pNameInfo->handle, pModule->self, hRsrc );
+                if (pNameInfo->handle && pTypeInfo->type_id == NE_RSCTYPE_STRING)
+                    NE_AddCachedStringBlock( pModule, hRsrc );
+            }
 
             if (pNameInfo->handle)
             {
@@ -1079,6 +1372,36 @@ HGLOBAL16 WINAPI LoadResource16( HMODULE16 hModule, HRSRC16 hRsrc )
 }
 
 
+/**********************************************************************
+ *          NE_ReloadResource
+ *
+ * Reload a discarded NE resource from its handle, keeping its usage count.
+ */
+static void NE_ReloadResource( HGLOBAL16 handle )
+{
+    NE_MODULE *pModule = NE_GetPtr( FarGetOwner16( handle ) );
+    NE_TYPEINFO *pTypeInfo;
+    NE_NAMEINFO *pNameInfo;
+    WORD count, usage;
+
+    if (!pModule || !pModule->ne_rsrctab) return;
+    pTypeInfo = (NE_TYPEINFO *)((char *)pModule + pModule->ne_rsrctab + 2);
+    for (; pTypeInfo->type_id; pTypeInfo = next_typeinfo(pTypeInfo))
+    {
+        pNameInfo = (NE_NAMEINFO *)(pTypeInfo + 1);
+        for (count = pTypeInfo->count; count > 0; count--, pNameInfo++)
+        {
+            if (!same_block( pNameInfo->handle, handle )) continue;
+            TRACE("reloading %04x\n", handle );
+            usage = pNameInfo->usage;
+            LoadResource16( pModule->self, (HRSRC16)((char *)pNameInfo - (char *)pModule) );
+            pNameInfo->usage = usage;
+            return;
+        }
+    }
+}
+
+
 /**********************************************************************
  *          LockResource   (KERNEL.62)
  */
@@ -1086,6 +1409,8 @@ SEGPTR WINAPI WIN16_LockResource16( HGLOBAL16 handle )
 {
     TRACE("(%04x)\n", handle );
     /* May need to reload the resource if discarded */
+    if (handle && (GlobalFlags16( handle ) & GMEM_DISCARDED))
+        NE_ReloadResource( handle );
     return WOWGlobalLock16( handle );
 }
 
@@ -1138,6 +1463,14 @@ BOOL16 WINAPI FreeResource16( HGLOBAL16 handle )
 
     TRACE("(%04x)\n", handle );
 
+    /* Try converted 32-bit resources */
+
+    if (pModule && pModule->rsrc32_map)
+    {
+        BOOL16 ret;
+        if (NE_FreePEResource( pModule, handle, &ret )) return ret;
+    }
+
     /* Try NE resource first */
 
     if (pModule && pModule->ne_rsrctab)
@@ -1149,7 +1482,7 @@ BOOL16 WINAPI FreeResource16( HGLOBAL16 handle )
             NE_NAMEINFO *pNameInfo = (NE_NAMEINFO *)(pTypeInfo + 1);
             for (count = pTypeInfo->count; count > 0; count--)
             {
-                if (pNameInfo->handle == handle)
+                if (same_block( pNameInfo->handle, handle ))
                 {
                     if (pNameInfo->usage > 0)
                     {
@@ -1186,44 +1519,15 @@ BOOL16 WINAPI FreeResource16( HGLOBAL16 handle )
     else
         return GlobalFree16( handle );
 }
-/*************************************************************************
-*			USER32_LoadResource
-*/
-static BYTE * USER32_LoadResource(LPBYTE peimage, NE_NAMEINFO* pNInfo, WORD sizeShift, ULONG *uSize)
-{
-	TRACE("%p %p 0x%08x\n", peimage, pNInfo, sizeShift);
-
-	*uSize = (DWORD)pNInfo->length << sizeShift;
-	return peimage + ((DWORD)pNInfo->offset << sizeShift);
-}
-typedef struct
-{
-	BYTE        bWidth;          /* Width, in pixels, of the image	*/
-	BYTE        bHeight;         /* Height, in pixels, of the image	*/
-	BYTE        bColorCount;     /* Number of colors in image (0 if >=8bpp) */
-	BYTE        bReserved;       /* Reserved ( must be 0)		*/
-	WORD        wPlanes;         /* Color Planes			*/
-	WORD        wBitCount;       /* Bits per pixel			*/
-	DWORD       dwBytesInRes;    /* How many bytes in this resource?	*/
-	DWORD       dwImageOffset;   /* Where in the file is this image?	*/
-} icoICONDIRENTRY, *LPicoICONDIRENTRY;
-typedef struct
-{
-	WORD            idReserved;   /* Reserved (must be 0) */
-	WORD            idType;       /* Resource Type (RES_ICON or RES_CURSOR) */
-	WORD            idCount;      /* How many images */
-	icoICONDIRENTRY idEntries[1]; /* An entry for each image (idCount of 'em) */
-} icoICONDIR, *LPicoICONDIR;
-/*************************************************************************
-*                      ICO_LoadIcon
-*/
-static BYTE * ICO_LoadIcon(LPBYTE peimage, LPicoICONDIRENTRY lpiIDE, ULONG *uSize)
+/* protects the icon directory cache of iconcache.c */
+static CRITICAL_SECTION ne_icon_section;
+static CRITICAL_SECTION_DEBUG ne_icon_critsect_debug =
 {
-	TRACE("%p %p\n", peimage, lpiIDE);
-
-	*uSize = lpiIDE->dwBytesInRes;
-	return peimage + lpiIDE->dwImageOffset;
-}
+    0, 0, &ne_icon_section,
+    { &ne_icon_critsect_debug.ProcessLocksList, &ne_icon_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": ne_icon_section") }
+};
+static CRITICAL_SECTION ne_icon_section = { &ne_icon_critsect_debug, -1, 0, 0, 0, 0 };
 
 __declspec(dllexport) HICON NE_ExtractIcon(LPCSTR lpszExeFileName,
 	HICON * RetPtr,
@@ -1238,27 +1542,40 @@ __declspec(dllexport) HICON NE_ExtractIcon(LPCSTR lpszExeFileName,
 
 	UINT		ret = 0;
 	UINT		cx1, cx2, cy1, cy2;
-	LPBYTE		pData;
-	DWORD		sig;
 	HANDLE		hFile;
-	UINT16		iconDirCount = 0, iconCount = 0;
 	LPBYTE		image;
 	HANDLE		fmapping;
-	DWORD		fsizeh, fsizel;
-	WCHAR		szExePath[MAX_PATH];
+	DWORD		fsizel;
+	char		szExePath[MAX_PATH];
 	DWORD		dwSearchReturn;
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+	struct ne_icon_dir *dir;
 
-    char *path = get_search_path();
-	dwSearchReturn = SearchPathA(NULL, lpszExeFileName, NULL, sizeof(szExePath) / sizeof(szExePath[0]), szExePath, NULL);
-    HeapFree(GetProcessHeap(), 0, path);
-	if ((dwSearchReturn == 0) || (dwSearchReturn > sizeof(szExePath) / sizeof(szExePath[0])))
+	dwSearchReturn = SearchPathA(NULL, lpszExeFileName, NULL, sizeof(szExePath), szExePath, NULL);
+	if ((dwSearchReturn == 0) || (dwSearchReturn >= sizeof(szExePath)))
 	{
 		WARN("File %s not found or path too long\n", debugstr_a(lpszExeFileName));
 		return -1;
 	}
+	if (!GetFileAttributesExA(szExePath, GetFileExInfoStandard, &attr)) return 0;
+
+	EnterCriticalSection(&ne_icon_section);
+	dir = ne_icon_dir_find(szExePath, attr.nFileSizeLow, &attr.ftLastWriteTime);
+	if (dir && (nIcons == 0 || !dir->dir_count))
+	{
+		/* counting (or a file without icons) doesn't need the file at all */
+		ret = nIcons ? 0 : dir->dir_count;
+		LeaveCriticalSection(&ne_icon_section);
+		return ret;
+	}
+
 	hFile = CreateFileA(szExePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0);
-	if (hFile == INVALID_HANDLE_VALUE) return 0;
-	fsizel = GetFileSize(hFile, &fsizeh);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		LeaveCriticalSection(&ne_icon_section);
+		return 0;
+	}
+	fsizel = GetFileSize(hFile, NULL);
 
 	/* Map the file */
 	fmapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY | SEC_COMMIT, 0, 0, NULL);
@@ -1266,6 +1583,7 @@ __declspec(dllexport) HICON NE_ExtractIcon(LPCSTR lpszExeFileName,
 	if (!fmapping)
 	{
 		WARN("CreateFileMapping error %d\n", GetLastError());
+		LeaveCriticalSection(&ne_icon_section);
 		return 0xFFFFFFFF;
 	}
 
@@ -1273,9 +1591,14 @@ __declspec(dllexport) HICON NE_ExtractIcon(LPCSTR lpszExeFileName,
 	{
 		WARN("MapViewOfFile error %d\n", GetLastError());
 		CloseHandle(fmapping);
+		LeaveCriticalSection(&ne_icon_section);
 		return 0xFFFFFFFF;
 	}
 	CloseHandle(fmapping);
+
+	if (!dir && !(dir = ne_icon_dir_parse(image, fsizel, szExePath, attr.nFileSizeLow, &attr.ftLastWriteTime)))
+		goto end;
+
 	cx1 = LOWORD(cxDesired);
 	cx2 = HIWORD(cxDesired);
 	cy1 = LOWORD(cyDesired);
@@ -1286,112 +1609,47 @@ __declspec(dllexport) HICON NE_ExtractIcon(LPCSTR lpszExeFileName,
 
 	if (!pIconId) /* if no icon identifier array present use the icon handle array as intermediate storage */
 		pIconId = (UINT*)RetPtr;
-	const IMAGE_DOS_HEADER *mz_header = image;
-	const IMAGE_OS2_HEADER *ne_header;
-
-	if (fsizel < sizeof(*mz_header)) goto end;
-	if (mz_header->e_magic != IMAGE_DOS_SIGNATURE) goto end;
-	ne_header = (const IMAGE_OS2_HEADER *)((const char *)image + mz_header->e_lfanew);
-	if (mz_header->e_lfanew + sizeof(*ne_header) > fsizel) goto end;
-	if (ne_header->ne_magic == IMAGE_NT_SIGNATURE) goto end;  /* win32 exe */
-	if (ne_header->ne_magic != IMAGE_OS2_SIGNATURE) goto end;
-
-	pData = image + mz_header->e_lfanew + ne_header->ne_rsrctab;
-	/* end ico file */
-	if (ne_header->ne_rsrctab < ne_header->ne_restab)
+
+	if (!dir->dir_count) goto end;
+	if (nIcons == 0)
+		ret = dir->dir_count;
+	else if (nIconIndex >= 0 && nIconIndex < dir->dir_count)
 	{
-		BYTE		*pCIDir = 0;
-		NE_TYPEINFO	*pTInfo = (NE_TYPEINFO*)(pData + 2);
-		NE_NAMEINFO	*pIconStorage = NULL;
-		NE_NAMEINFO	*pIconDir = NULL;
-		LPicoICONDIR	lpiID = NULL;
-		ULONG		uSize = 0;
+		BYTE     *pCIDir;
+		ULONG    uSize = 0;
+		UINT16   i, icon;
 
+		if (nIcons > dir->dir_count - nIconIndex)
+			nIcons = dir->dir_count - nIconIndex;
 
-		if (pData == (BYTE*)-1)
+		for (i = 0; i < nIcons; i++)
 		{
-			FIXME("ICO_GetIconDirectory\n");
-			/*
-		    pCIDir = ICO_GetIconDirectory(peimage, &lpiID, &uSize);	// check for .ICO file 
-			if (pCIDir)
-			{
-				iconDirCount = 1; iconCount = lpiID->idCount;
-				TRACE("-- icon found %p 0x%08x 0x%08x 0x%08x\n", pCIDir, uSize, iconDirCount, iconCount);
-			}
-			*/
-		}
-		else while (pTInfo->type_id && !(pIconStorage && pIconDir))
-		{
-			if (pTInfo->type_id == NE_RSCTYPE_GROUP_ICON)	/* find icon directory and icon repository */
-			{
-				iconDirCount = pTInfo->count;
-				pIconDir = ((NE_NAMEINFO*)(pTInfo + 1));
-				TRACE("\tfound directory - %i icon families\n", iconDirCount);
-			}
-			if (pTInfo->type_id == NE_RSCTYPE_ICON)
-			{
-				iconCount = pTInfo->count;
-				pIconStorage = ((NE_NAMEINFO*)(pTInfo + 1));
-				TRACE("\ttotal icons - %i\n", iconCount);
-			}
-			pTInfo = (NE_TYPEINFO *)((char*)(pTInfo + 1) + pTInfo->count*sizeof(NE_NAMEINFO));
+			pCIDir = ne_icon_resource(image, fsizel, dir->entries + i + nIconIndex, dir->shift, &uSize);
+			pIconId[i] = pCIDir ? LookupIconIdFromDirectoryEx(pCIDir, TRUE, cx1, cy1, flags) : 0;
+			if (cx2 && cy2) pIconId[++i] = pCIDir ? LookupIconIdFromDirectoryEx(pCIDir, TRUE, cx2, cy2, flags) : 0;
 		}
 
-		if ((pIconStorage && pIconDir) || lpiID)	  /* load resources and create icons */
+		for (icon = 0; icon < nIcons; icon++)
 		{
-			if (nIcons == 0)
-			{
-				ret = iconDirCount;
-				if (lpiID)	/* *.ico file, deallocate heap pointer*/
-					HeapFree(GetProcessHeap(), 0, pCIDir);
-			}
-			else if (nIconIndex < iconDirCount)
+			const NE_NAMEINFO *pIcon = ne_icon_dir_get_icon(dir, (WORD)pIconId[icon]);
+
+			pCIDir = pIcon ? ne_icon_resource(image, fsizel, pIcon, dir->shift, &uSize) : NULL;
+
+			if (pCIDir)
 			{
-				UINT16   i, icon;
-				if (nIcons > iconDirCount - nIconIndex)
-					nIcons = iconDirCount - nIconIndex;
-
-				for (i = 0; i < nIcons; i++)
-				{
-					/* .ICO files have only one icon directory */
-					if (lpiID == NULL)	/* not *.ico */
-						pCIDir = USER32_LoadResource(image, pIconDir + i + nIconIndex, *(WORD*)pData, &uSize);
-					pIconId[i] = LookupIconIdFromDirectoryEx(pCIDir, TRUE, cx1, cy1, flags);
-					if (cx2 && cy2) pIconId[++i] = LookupIconIdFromDirectoryEx(pCIDir, TRUE, cx2, cy2, flags);
-				}
-				if (lpiID)	/* *.ico file, deallocate heap pointer*/
-					HeapFree(GetProcessHeap(), 0, pCIDir);
-
-				for (icon = 0; icon < nIcons; icon++)
-				{
-					pCIDir = NULL;
-					if (lpiID)
-						pCIDir = ICO_LoadIcon(image, lpiID->idEntries + (int)pIconId[icon], &uSize);
-					else
-						for (i = 0; i < iconCount; i++)
-							if (pIconStorage[i].id == ((int)pIconId[icon] | 0x8000))
-								pCIDir = USER32_LoadResource(image, pIconStorage + i, *(WORD*)pData, &uSize);
-
-					if (pCIDir)
-					{
-						RetPtr[icon] = CreateIconFromResourceEx(pCIDir, uSize, TRUE, 0x00030000,
-							cx1, cy1, flags);
-						if (cx2 && cy2)
-							RetPtr[++icon] = CreateIconFromResourceEx(pCIDir, uSize, TRUE, 0x00030000,
-							cx2, cy2, flags);
-					}
-					else
-						RetPtr[icon] = 0;
-				}
-				ret = icon;	/* return number of retrieved icons */
+				RetPtr[icon] = CreateIconFromResourceEx(pCIDir, uSize, TRUE, 0x00030000,
+					cx1, cy1, flags);
+				if (cx2 && cy2)
+					RetPtr[++icon] = CreateIconFromResourceEx(pCIDir, uSize, TRUE, 0x00030000,
+					cx2, cy2, flags);
 			}
+			else
+				RetPtr[icon] = 0;
 		}
-	}
-	else
-	{
-
+		ret = icon;	/* return number of retrieved icons */
 	}
 	end:
+	LeaveCriticalSection(&ne_icon_section);
 	UnmapViewOfFile(image);	/* success */
 	return ret;
 }
@@ -0,0 +1,203 @@
+/*
+ * Hashed index of NE resource tables
+ *
+ * Copyright 1993 Robert J. Amstadt
+ * Copyright 1997 Alex Korobka
+ * Copyright 1998 Ulrich Weigand
+ * Copyright 1995, 2003 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * A (type, name) -> NE_NAMEINFO hash of a module's resource table, so
+ * that FindResource16 doesn't walk the table and compare Pascal strings
+ * on every call. The first entry for each key wins, which gives the same
+ * result as the linear search. The index also remembers the last string
+ * table blocks that were loaded.
+ *
+ * Nothing here loads resources or looks at global handles, so
+ * resource.c builds the index on first use and checks that the string
+ * blocks are still loaded.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "rsrcindex.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(resource);
+
+/***********************************************************************
+ *           hash_res_name
+ *
+ * Case-insensitive hash of a resource name, matching the strncasecmp
+ * comparisons done against the Pascal strings of the resource table.
+ */
+static DWORD hash_res_name( const char *str, BYTE len )
+{
+    DWORD hash = len;
+    BYTE i;
+
+    for (i = 0; i < len; i++) hash = hash * 31 + toupper( (BYTE)str[i] );
+    return hash;
+}
+
+/* hash of a type or name id as passed to FindResource16 */
+static inline DWORD hash_res_id( LPCSTR id )
+{
+    if (HIWORD(id)) return hash_res_name( id, strlen( id ) );
+    return LOWORD(id) | 0x8000;
+}
+
+/* hash of a type or name id as stored in the resource table */
+static inline DWORD hash_res_table_id( LPBYTE pResTab, WORD id )
+{
+    if (id & 0x8000) return id;
+    return hash_res_name( (char *)pResTab + id + 1, pResTab[id] );
+}
+
+static inline BOOL match_res_id( LPBYTE pResTab, WORD id, LPCSTR str )
+{
+    BYTE *p;
+    BYTE len;
+
+    if (!HIWORD(str)) return id == (LOWORD(str) | 0x8000);
+    if (id & 0x8000) return FALSE;
+    p = pResTab + id;
+    len = strlen( str );
+    return (*p == len) && !strncasecmp( (char *)p + 1, str, len );
+}
+
+/***********************************************************************
+ *           ne_rsrc_index_build
+ *
+ * Index the resource table at pResTab, which is at offset rsrctab in
+ * the module. NULL if out of memory.
+ */
+struct ne_rsrc_index *ne_rsrc_index_build( LPBYTE pResTab, WORD rsrctab )
+{
+    struct ne_rsrc_index *index;
+    NE_TYPEINFO *pTypeInfo;
+    NE_NAMEINFO *pNameInfo;
+    UINT total = 0, size = 16;
+    int count;
+
+    for (pTypeInfo = (NE_TYPEINFO *)(pResTab + 2); pTypeInfo->type_id; pTypeInfo = next_typeinfo( pTypeInfo ))
+        total += pTypeInfo->count;
+    while (size < total * 2) size *= 2;
+
+    if (!(index = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*index) ))) return NULL;
+    if (!(index->elem = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*index->elem) )))
+    {
+        HeapFree( GetProcessHeap(), 0, index );
+        return NULL;
+    }
+    index->mask = size - 1;
+
+    /* keep the first entry for each (type, name), as the linear search does */
+    for (pTypeInfo = (NE_TYPEINFO *)(pResTab + 2); pTypeInfo->type_id; pTypeInfo = next_typeinfo( pTypeInfo ))
+    {
+        DWORD type_hash = hash_res_table_id( pResTab, pTypeInfo->type_id );
+
+        pNameInfo = (NE_NAMEINFO *)(pTypeInfo + 1);
+        for (count = pTypeInfo->count; count > 0; count--, pNameInfo++)
+        {
+            DWORD hash = type_hash * 33 + hash_res_table_id( pResTab, pNameInfo->id );
+            struct ne_rsrc_index_elem *elem;
+            UINT i;
+
+            for (i = hash & index->mask; index->elem[i].hRsrc; i = (i + 1) & index->mask)
+            {
+                elem = &index->elem[i];
+                if (elem->hash == hash && elem->type_id == pTypeInfo->type_id && elem->name_id == pNameInfo->id)
+                    break;
+            }
+            elem = &index->elem[i];
+            if (elem->hRsrc) continue;  /* duplicate */
+            elem->hash    = hash;
+            elem->type_id = pTypeInfo->type_id;
+            elem->name_id = pNameInfo->id;
+            elem->hRsrc   = rsrctab + ((LPBYTE)pNameInfo - pResTab);
+        }
+    }
+    TRACE( "indexed %u resources\n", total );
+    return index;
+}
+
+/***********************************************************************
+ *           ne_rsrc_index_lookup
+ *
+ * The resource with the given type and name, as passed to FindResource16
+ * after "#nnn" strings were converted to ids. 0 if there is none.
+ */
+HRSRC16 ne_rsrc_index_lookup( const struct ne_rsrc_index *index, LPBYTE pResTab, LPCSTR typeId, LPCSTR resId )
+{
+    DWORD hash = hash_res_id( typeId ) * 33 + hash_res_id( resId );
+    UINT i;
+
+    for (i = hash & index->mask; index->elem[i].hRsrc; i = (i + 1) & index->mask)
+    {
+        const struct ne_rsrc_index_elem *elem = &index->elem[i];
+
+        if (elem->hash == hash &&
+            match_res_id( pResTab, elem->type_id, typeId ) &&
+            match_res_id( pResTab, elem->name_id, resId ))
+            return elem->hRsrc;
+    }
+    return 0;
+}
+
+/***********************************************************************
+ *           ne_rsrc_index_free
+ */
+void ne_rsrc_index_free( struct ne_rsrc_index *index )
+{
+    HeapFree( GetProcessHeap(), 0, index->elem );
+    HeapFree( GetProcessHeap(), 0, index );
+}
+
+/***********************************************************************
+ *           ne_rsrc_index_find_string
+ *
+ * Slot of a string table block in the recently loaded ones, -1 if it
+ * isn't one of them.
+ */
+int ne_rsrc_index_find_string( const struct ne_rsrc_index *index, HRSRC16 hRsrc )
+{
+    int i;
+
+    for (i = 0; i < NE_RSRC_STRCACHE_SIZE; i++)
+        if (index->strings[i] == hRsrc) return i;
+    return -1;
+}
+
+/***********************************************************************
+ *           ne_rsrc_index_add_string
+ *
+ * Remember a loaded string table block, replacing the oldest one.
+ */
+void ne_rsrc_index_add_string( struct ne_rsrc_index *index, HRSRC16 hRsrc )
+{
+    if (!hRsrc || ne_rsrc_index_find_string( index, hRsrc ) >= 0) return;
+    index->strings[index->next_string] = hRsrc;
+    index->next_string = (index->next_string + 1) % NE_RSRC_STRCACHE_SIZE;
+}
@@ -0,0 +1,59 @@
+/*
+ * Hashed index of NE resource tables
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_RSRCINDEX_H
+#define __WINE_RSRCINDEX_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+
+/* string table blocks kept loaded, the oldest one is dropped */
+#define NE_RSRC_STRCACHE_SIZE 8
+
+struct ne_rsrc_index_elem
+{
+    DWORD hash;     /* combined hash of type and name */
+    WORD  type_id;  /* type id as stored in the resource table */
+    WORD  name_id;  /* name id as stored in the resource table */
+    WORD  hRsrc;    /* offset of the NE_NAMEINFO in the module, 0 if unused */
+};
+
+struct ne_rsrc_index
+{
+    UINT                       mask;      /* hash table size - 1 */
+    struct ne_rsrc_index_elem *elem;
+    HRSRC16                    strings[NE_RSRC_STRCACHE_SIZE]; /* recently loaded string blocks */
+    UINT                       next_string;
+};
+
+static inline NE_TYPEINFO *next_typeinfo( NE_TYPEINFO *info )
+{
+    return (NE_TYPEINFO *)((char *)(info + 1) + info->count * sizeof(NE_NAMEINFO));
+}
+
+extern struct ne_rsrc_index *ne_rsrc_index_build( LPBYTE pResTab, WORD rsrctab ) DECLSPEC_HIDDEN;
+extern HRSRC16 ne_rsrc_index_lookup( const struct ne_rsrc_index *index, LPBYTE pResTab,
+                                     LPCSTR typeId, LPCSTR resId ) DECLSPEC_HIDDEN;
+extern void ne_rsrc_index_free( struct ne_rsrc_index *index ) DECLSPEC_HIDDEN;
+extern int ne_rsrc_index_find_string( const struct ne_rsrc_index *index, HRSRC16 hRsrc ) DECLSPEC_HIDDEN;
+extern void ne_rsrc_index_add_string( struct ne_rsrc_index *index, HRSRC16 hRsrc ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_RSRCINDEX_H */
@@ -0,0 +1,281 @@
+/*
+ * Runtime statistics for external monitoring
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * A background thread copies counters of the VM into a named shared
+ * memory block (see otvdmstats.h) once per StatsInterval milliseconds,
+ * so that a monitor can watch a running otvdm without running anything
+ * inside it. The heap walks need the Win16Mutex; the thread only tries
+ * to take it and publishes the cheap counters alone when it is busy.
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "winternl.h"
+#include "kernel16_private.h"
+#include "otvdmstats.h"
+#include "wine/exception.h"
+#include "wine/library.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(module);
+
+#define STATS_LDT_SIZE   8192
+#define STATS_MAX_TASKS  256
+
+ULONGLONG stats_calls_from_16;
+ULONGLONG stats_calls_to_16;
+
+/* Win16Mutex hold times, only written by the owner of the lock */
+static ULONGLONG win16_lock_acquisitions;
+static ULONGLONG win16_lock_hold_total;
+static DWORD win16_lock_hold_max;
+static LONGLONG win16_lock_start;
+static LONGLONG perf_frequency;
+
+static struct otvdm_stats *shared_stats;
+static DWORD stats_interval;
+
+extern HANDLE vm_idle_event;
+
+static DWORD stats_elapsed_us( LONGLONG start )
+{
+    LARGE_INTEGER now;
+    LONGLONG us;
+
+    QueryPerformanceCounter( &now );
+    us = (now.QuadPart - start) * 1000000 / perf_frequency;
+    return us > 0xffffffff ? 0xffffffff : (DWORD)us;
+}
+
+/***********************************************************************
+ *           STATS_Win16LockAcquired
+ */
+void STATS_Win16LockAcquired(void)
+{
+    LARGE_INTEGER now;
+
+    if (!shared_stats) return;
+    QueryPerformanceCounter( &now );
+    win16_lock_acquisitions++;
+    win16_lock_start = now.QuadPart;
+}
+
+/***********************************************************************
+ *           STATS_Win16LockReleased
+ */
+void STATS_Win16LockReleased(void)
+{
+    DWORD held;
+
+    if (!shared_stats || !win16_lock_start) return;
+    held = stats_elapsed_us( win16_lock_start );
+    win16_lock_start = 0;
+    win16_lock_hold_total += held;
+    if (held > win16_lock_hold_max) win16_lock_hold_max = held;
+}
+
+/* 64-bit counters may be torn when read from another thread on a 32-bit host */
+static ULONGLONG stats_read64( const volatile ULONGLONG *value )
+{
+    ULONGLONG ret;
+
+    do ret = *value; while (ret != *value);
+    return ret;
+}
+
+static void stats_get_ldt( struct otvdm_stats *stats )
+{
+    DWORD i, run = 0;
+
+    stats->ldt_max = STATS_LDT_SIZE;
+    for (i = 0; i < STATS_LDT_SIZE; i++)
+    {
+        if (wine_ldt_copy.flags[i] & WINE_LDT_FLAGS_ALLOCATED)
+        {
+            stats->ldt_used++;
+            run = 0;
+            continue;
+        }
+        if (++run > stats->ldt_largest_free_run) stats->ldt_largest_free_run = run;
+    }
+}
+
+static void stats_add_local_heap( struct otvdm_stats *stats, HANDLE16 ds, LPCSTR name, size_t name_len )
+{
+    struct otvdm_stats_local_heap *heap;
+    LOCALHEAPSTATS local;
+    DWORD i;
+
+    if (!ds || stats->local_heap_count >= OTVDM_STATS_MAX_HEAPS) return;
+    ds = GlobalHandleToSel16( ds );
+    for (i = 0; i < stats->local_heap_count; i++)
+        if (stats->local_heaps[i].ds == ds) return;
+    if (!LOCAL_GetHeapStats( ds, &local )) return;
+
+    heap = &stats->local_heaps[stats->local_heap_count++];
+    heap->ds = ds;
+    memcpy( heap->name, name, min( name_len, sizeof(heap->name) ) );
+    heap->size = local.size;
+    heap->free = local.free;
+    heap->largest_free = local.largest_free;
+    heap->free_blocks = local.free_blocks;
+    heap->items = local.items;
+    heap->free_handles = local.free_handles;
+}
+
+static HANDLE16 stats_get_dgroup( LPCSTR name )
+{
+    HMODULE16 module = GetModuleHandle16( name );
+    NE_MODULE *pModule = module ? NE_GetPtr( module ) : NULL;
+
+    if (!pModule || !pModule->ne_autodata) return 0;
+    return NE_SEG_TABLE( pModule )[pModule->ne_autodata - 1].hSeg;
+}
+
+/* walk the heaps, called with the Win16Mutex held */
+static void stats_get_heaps( struct otvdm_stats *stats )
+{
+    HTASK16 task;
+    int count = 0;
+
+    GLOBAL_GetStats( stats );
+    stats_add_local_heap( stats, stats_get_dgroup( "USER" ), "USER", 4 );
+    stats_add_local_heap( stats, stats_get_dgroup( "GDI" ), "GDI", 3 );
+    for (task = pThhook->HeadTDB; task && count < STATS_MAX_TASKS; count++)
+    {
+        TDB *pTask = MapSL( MAKESEGPTR( task, 0 ) );
+        stats_add_local_heap( stats, pTask->hInstance, pTask->module_name, sizeof(pTask->module_name) );
+        task = pTask->hNext;
+    }
+}
+
+static void stats_update( struct otvdm_stats *stats )
+{
+    SYSLEVEL *lock;
+
+    memset( stats, 0, sizeof(*stats) );
+    stats->magic = OTVDM_STATS_MAGIC;
+    stats->version = OTVDM_STATS_VERSION;
+    stats->size = sizeof(*stats);
+    stats->pid = GetCurrentProcessId();
+    stats->update_tick = GetTickCount();
+
+    stats_get_ldt( stats );
+    get_wow_handle_stats( &stats->user_handles, &stats->gdi_handles, &stats->handle_table_max );
+    stats->calls_from_16 = stats_read64( &stats_calls_from_16 );
+    stats->calls_to_16 = stats_read64( &stats_calls_to_16 );
+    stats->win16_lock_acquisitions = stats_read64( &win16_lock_acquisitions );
+    stats->win16_lock_hold_total = stats_read64( &win16_lock_hold_total );
+    stats->win16_lock_hold_max = win16_lock_hold_max;
+
+    /* only try the lock, but keep vm_idle_event in sync like _EnterSysLevel/_LeaveSysLevel do,
+     * vm_inject waits on it */
+    GetpWin16Lock( &lock );
+    if (!TryEnterCriticalSection( &lock->crst ))
+    {
+        LONGLONG start = win16_lock_start;
+        if (start) stats->win16_lock_held = stats_elapsed_us( start );
+        return;
+    }
+    ResetEvent( vm_idle_event );
+    __TRY
+    {
+        stats->task_count = GetNumTasks16();
+        stats_get_heaps( stats );
+        stats->heaps_valid = TRUE;
+    }
+    __EXCEPT_PAGE_FAULT
+    {
+        WARN( "fault while walking the heaps\n" );
+    }
+    __ENDTRY
+    LeaveCriticalSection( &lock->crst );
+    if (!lock->crst.OwningThread) SetEvent( vm_idle_event );
+}
+
+static DWORD CALLBACK stats_thread( LPVOID arg )
+{
+    struct otvdm_stats stats;
+    DWORD update_count = 0;
+
+    for (;;)
+    {
+        stats_update( &stats );
+        stats.update_count = ++update_count;
+
+        /* the sequence is odd while the block is being written */
+        stats.sequence = InterlockedIncrement( (LONG volatile *)&shared_stats->sequence );
+        MemoryBarrier();
+        memcpy( shared_stats, &stats, sizeof(stats) );
+        MemoryBarrier();
+        InterlockedIncrement( (LONG volatile *)&shared_stats->sequence );
+
+        Sleep( stats_interval );
+    }
+    return 0;
+}
+
+/***********************************************************************
+ *           STATS_Init
+ *
+ * Create the shared statistics block and start the thread updating it.
+ */
+void STATS_Init(void)
+{
+    LARGE_INTEGER frequency;
+    char name[64];
+    HANDLE mapping, thread;
+
+    stats_interval = krnl386_get_config_int( "otvdm", "StatsInterval", 1000 );
+    if (!stats_interval) return;
+    if (!QueryPerformanceFrequency( &frequency ) || !frequency.QuadPart) return;
+    perf_frequency = frequency.QuadPart;
+
+    sprintf( name, OTVDM_STATS_SECTION_FORMAT, (unsigned int)GetCurrentProcessId() );
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(struct otvdm_stats), name );
+    if (!mapping)
+    {
+        WARN( "could not create %s: %u\n", name, GetLastError() );
+        return;
+    }
+    shared_stats = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, sizeof(struct otvdm_stats) );
+    if (!shared_stats)
+    {
+        CloseHandle( mapping );
+        return;
+    }
+    /* the mapping stays open for the life of the process */
+    thread = CreateThread( NULL, 0, stats_thread, NULL, 0, NULL );
+    if (!thread)
+    {
+        UnmapViewOfFile( shared_stats );
+        shared_stats = NULL;
+        CloseHandle( mapping );
+        return;
+    }
+    SetThreadPriority( thread, THREAD_PRIORITY_BELOW_NORMAL );
+    CloseHandle( thread );
+}
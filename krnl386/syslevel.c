@@ -146,6 +146,7 @@ VOID WINAPI _EnterSysLevel(SYSLEVEL *lock)
     {
         CallTo16_TebSelector = wine_get_fs();
         ResetEvent(vm_idle_event);
+        if (lock->crst.RecursionCount == 1) STATS_Win16LockAcquired();
     }
 }
 
@@ -172,6 +173,7 @@ VOID WINAPI _LeaveSysLevel(SYSLEVEL *lock)
             thread_data->sys_mutex[lock->level] = NULL;
     }
 
+    if (lock == &Win16Mutex && lock->crst.RecursionCount == 1) STATS_Win16LockReleased();
     RtlLeaveCriticalSection( &lock->crst );
     
     if ((lock == &Win16Mutex) && !Win16Mutex.crst.OwningThread) SetEvent(vm_idle_event);
@@ -149,6 +149,7 @@ LPVOID WINAPI TebTlsGetValue(TEB *teb, DWORD index)
     return ret;
 }
 static DWORD curdir_tls_index = -1;
+static HGLOBAL16 TASK_BuildEnvironment( LPCSTR env );
 
 static HTASK16 task_old = NULL;
 static struct kernel_thread_data *task_old_data = NULL;
@@ -320,7 +321,7 @@ static BOOL TASK_FreeThunk( SEGPTR thunk )
  *       by entering the Win16Lock while linking the task into the
  *       global task list.
  */
-static TDB *TASK_Create( NE_MODULE *pModule, UINT16 cmdShow, LPCSTR cmdline, BYTE len )
+static TDB *TASK_Create( NE_MODULE *pModule, UINT16 cmdShow, LPCSTR cmdline, BYTE len, LPCSTR env )
 {
     HTASK16 hTask;
     TDB *pTask;
@@ -386,7 +387,19 @@ static TDB *TASK_Create( NE_MODULE *pModule, UINT16 cmdShow, LPCSTR cmdline, BYT
     pTask->pdb.hFileHandles = 0;
     memset( pTask->pdb.fileHandles, 0xff, sizeof(pTask->pdb.fileHandles) );
     /* FIXME: should we make a copy of the environment? */
-    pTask->pdb.environment    = SELECTOROF(GetDOSEnvironment16());
+    pTask->pdb.environment    = 0;
+    if (env)
+    {
+        /* freed along with the other blocks owned by the PDB */
+        HGLOBAL16 hEnv = TASK_BuildEnvironment( env );
+        if (hEnv)
+        {
+            FarSetOwner16( hEnv, pTask->hPDB );
+            pTask->pdb.environment = GlobalHandleToSel16( hEnv );
+        }
+    }
+    if (!pTask->pdb.environment)
+        pTask->pdb.environment = SELECTOROF(GetDOSEnvironment16());
     pTask->pdb.nbFiles        = 20;
 
     /* Fill the command line */
@@ -509,7 +522,7 @@ void TASK_CreateMainTask(void)
 
     GetStartupInfoA( &startup_info );
     if (startup_info.dwFlags & STARTF_USESHOWWINDOW) cmdShow = startup_info.wShowWindow;
-    pTask = TASK_Create( NULL, cmdShow, NULL, 0 );
+    pTask = TASK_Create( NULL, cmdShow, NULL, 0, NULL );
     if (!pTask)
     {
         ERR("could not create task for main process\n");
@@ -716,13 +729,13 @@ static DWORD CALLBACK task_start( LPVOID p )
  * Spawn a new 16-bit task.
  */
 HTASK16 TASK_SpawnTask( NE_MODULE *pModule, WORD cmdShow,
-                        LPCSTR cmdline, BYTE len, HANDLE *hThread, LPCSTR curdir )
+                        LPCSTR cmdline, BYTE len, HANDLE *hThread, LPCSTR curdir, LPCSTR env )
 {
     struct create_data *data = NULL;
     WIN16_SUBSYSTEM_TIB *tib;
     TDB *pTask;
 
-    if (!(pTask = TASK_Create( pModule, cmdShow, cmdline, len ))) return 0;
+    if (!(pTask = TASK_Create( pModule, cmdShow, cmdline, len, env ))) return 0;
     if (!(tib = allocate_win16_tib( pTask ))) goto failed;
     if (!(data = HeapAlloc( GetProcessHeap(), 0, sizeof(*data)))) goto failed;
     data->task = pTask;
@@ -821,6 +834,7 @@ void TASK_ExitTask(void)
     SetEvent(kernel_get_thread_data()->idle_event);
     CloseHandle(kernel_get_thread_data()->idle_event);
     FILE_CloseAll();
+    WriteOutProfiles16();
 
     if (!nTaskCount || (nTaskCount == 1 && hFirstTask == initial_task))
     {
@@ -2040,10 +2054,9 @@ static void parse_autoexec()
 }
 
 /***********************************************************************
- *           GetDOSEnvironment     (KERNEL.131)
+ *           TASK_BuildEnvironment
  *
- * Note: the environment is allocated once, it doesn't track changes
- * made using the Win32 API. This shouldn't matter.
+ * Build a 16-bit environment block from a Win32 environment block.
  *
  * Format of a 16-bit environment block:
  * ASCIIZ   string 1 (xx=yy format)
@@ -2053,66 +2066,82 @@ static void parse_autoexec()
  * WORD     1
  * ASCIIZ   program name (e.g. C:\WINDOWS\SYSTEM\KRNL386.EXE)
  */
-SEGPTR WINAPI GetDOSEnvironment16(void)
+static HGLOBAL16 TASK_BuildEnvironment( LPCSTR env )
 {
     static const char ENV_program_name[] = "C:\\WINDOWS\\SYSTEM\\KRNL386.EXE";
-    static HGLOBAL16 handle;  /* handle to the 16 bit environment */
+    HGLOBAL16 handle;
+    DWORD size = 0;
+    LPCSTR p;
 
-    if (!handle)
+    p = env;
+    while (*p)
     {
-        DWORD size = 0;
-        LPSTR p, env;
-
-        parse_autoexec();
-
-        p = env = GetEnvironmentStringsA();
-        while (*p)
+        if (env_var_limit(p))
         {
-            if (env_var_limit(p))
-            {
-                size += strlen(p) + 1;
-            }
-            p += strlen(p) + 1;
+            size += strlen(p) + 1;
         }
-        size++;  /* skip last null */
-        size += sizeof(WORD) + sizeof(ENV_program_name) + 1;
-        handle = GlobalAlloc16( GMEM_FIXED, size );
-        if (handle)
+        p += strlen(p) + 1;
+    }
+    size++;  /* skip last null */
+    size += sizeof(WORD) + sizeof(ENV_program_name) + 1;
+    handle = GlobalAlloc16( GMEM_FIXED, size );
+    if (handle)
+    {
+        WORD one = 1;
+        LPSTR env16 = GlobalLock16( handle );
+        LPSTR env16p = env16;
+        p = env;
+        while (*p)
         {
-            WORD one = 1;
-            LPSTR env16 = GlobalLock16( handle );
-            LPSTR env16p = env16;
-            p = env;
-            while (*p)
+            if (env_var_limit(p))
             {
-                if (env_var_limit(p))
+                int i;
+                for (i = 0; i < strlen(p) + 1; i++)
                 {
-                    int i;
-                    for (i = 0; i < strlen(p) + 1; i++)
+                    if (p[i] == '=')
                     {
-                        if (p[i] == '=')
+                        if (i && (p[i - 1] == '\x16'))
                         {
-                            if (i && (p[i - 1] == '\x16'))
-                            {
-                                i--;
-                                p++;
-                            }
-                            break;
+                            i--;
+                            p++;
                         }
-                        env16p[i] = toupper(p[i]);
+                        break;
                     }
-                    memcpy(env16p + i, p + i, strlen(p + i) + 1);
-                    env16p += strlen(p) + 1;
+                    env16p[i] = toupper(p[i]);
                 }
-                p += strlen(p) + 1;
+                memcpy(env16p + i, p + i, strlen(p + i) + 1);
+                env16p += strlen(p) + 1;
             }
-            *env16p = 0;
-            env16p++;
-            memcpy( env16p, &one, sizeof(one));
-            env16p += sizeof(one);
-            memcpy( env16p, ENV_program_name, sizeof(ENV_program_name));
-            GlobalUnlock16( handle );
+            p += strlen(p) + 1;
         }
+        *env16p = 0;
+        env16p++;
+        memcpy( env16p, &one, sizeof(one));
+        env16p += sizeof(one);
+        memcpy( env16p, ENV_program_name, sizeof(ENV_program_name));
+        GlobalUnlock16( handle );
+    }
+    return handle;
+}
+
+/***********************************************************************
+ *           GetDOSEnvironment     (KERNEL.131)
+ *
+ * Note: the environment is allocated once, it doesn't track changes
+ * made using the Win32 API. This shouldn't matter.
+ */
+SEGPTR WINAPI GetDOSEnvironment16(void)
+{
+    static HGLOBAL16 handle;  /* handle to the 16 bit environment */
+
+    if (!handle)
+    {
+        LPSTR env;
+
+        parse_autoexec();
+
+        env = GetEnvironmentStringsA();
+        handle = TASK_BuildEnvironment( env );
         FreeEnvironmentStringsA( env );
     }
     return WOWGlobalLock16( handle );
@@ -637,6 +637,23 @@ BOOL vdd_io_write(int port, int size, WORD val, CONTEXT *ctx)
     return FALSE;
 }
 
+/* TRUE if an installed VDD claims the port */
+BOOL vdd_io_hooked(int port)
+{
+    for (int i = 0; i < 5; i++)
+    {
+        if (vdd_io[i].hvdd)
+        {
+            for (int j = 0; j < vdd_io[i].io_range_len; j++)
+            {
+                if ((vdd_io[i].io_range[j].First <= port) && (vdd_io[i].io_range[j].Last >= port))
+                    return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
 BYTE *WINAPI MGetVdmPointer(DWORD addr, DWORD size, BOOL protmode)
 {
     return (BYTE *)K32WOWGetVDMPointer(addr, size, protmode);
@@ -31,6 +31,7 @@
 #include "winnls.h"
 #include "dosexe.h"
 #include "vga.h"
+#include "vgahw.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(ddraw);
@@ -56,45 +57,15 @@ static BOOL vga_retrace_horizontal;
 #define CGA_WINDOW_START ((char *)0xb8000)
 
 /*
- * VGA controller memory is emulated using linear framebuffer.
- * This frambuffer also acts as an interface
- * between VGA controller emulation and DirectDraw.
+ * VGA controller memory is emulated using linear framebuffer, see
+ * vgahw.c for its geometry and the planar memory.
  *
- * vga_fb_width: Display width in pixels. Can be modified when
- *               display mode is changed.
- * vga_fb_height: Display height in pixels. Can be modified when
- *                display mode is changed.
- * vga_fb_depth: Number of bits used to store single pixel color information.
- *               Each pixel uses (vga_fb_depth+7)/8 bytes because
- *               1-16 color modes are mapped to 256 color mode.
- *               Can be modified when display mode is changed.
- * vga_fb_pitch: How many bytes to add to pointer in order to move
- *               from one row to another. This is fixed in VGA modes,
- *               but can be modified in SVGA modes.
  * vga_fb_offset: Offset added to framebuffer start address in order
  *                to find the display origin. Programs use this to do
  *                double buffering and to scroll display. The value can
  *                be modified in VGA and SVGA modes.
- * vga_fb_size: How many bytes are allocated to framebuffer.
- *              VGA framebuffers are always larger than display size and
- *              SVGA framebuffers may also be.
- * vga_fb_data: Pointer to framebuffer start.
- * vga_fb_window: Offset of 64k window 0xa0000 in bytes from framebuffer start.
- *                This value is >= 0, if mode uses linear framebuffer and
- *                -1, if mode uses color planes. This value is fixed
- *                in all modes except 0x13 (256 color VGA) where
- *                0 means normal mode and -1 means Mode-X (unchained mode).
  */
-static int   vga_fb_width;
-static int   vga_fb_height;
-static int   vga_fb_depth;
-static int   vga_fb_pitch;
 static int   vga_fb_offset;
-int   vga_fb_size = 0;
-char *vga_fb_data = 0;
-static int   vga_fb_window = 0;
-static int   vga_fb_window_size;
-static char *vga_fb_window_data;
 static PALETTEENTRY *vga_fb_palette;
 static unsigned vga_fb_palette_index;
 static unsigned vga_fb_palette_size;
@@ -743,30 +714,6 @@ typedef struct {
 } ModeSet;
 
 
-/**********************************************************************
- *         VGA_SyncWindow
- *
- * Copy VGA window into framebuffer (if argument is TRUE) or
- * part of framebuffer into VGA window (if argument is FALSE).
- */
-static void VGA_SyncWindow( BOOL target_is_fb )
-{
-    int size = vga_fb_window_size;
-
-    /* Window does not overlap framebuffer. */
-    if (vga_fb_window >= vga_fb_size)
-        return;
-
-    /* Check if window overlaps framebuffer only partially. */
-    if (vga_fb_size - vga_fb_window < vga_fb_window_size)
-        size = vga_fb_size - vga_fb_window;
-
-    if (target_is_fb)
-        memmove( vga_fb_data + vga_fb_window, vga_fb_window_data, size );
-    else
-        memmove( vga_fb_window_data, vga_fb_data + vga_fb_window, size );
-}
-
 
 static void WINAPI VGA_DoExit(ULONG_PTR arg)
 {
@@ -828,6 +775,7 @@ static BOOL VGA_SetGraphicMode(WORD mode)
 {
     ModeSet par;
     int     newSize;
+    BOOL    planar;
 
     /* get info on VGA mode & set appropriately */
     const VGA_MODE *ModeInfo = VGA_GetModeInfo(VGA_CurrentMode);
@@ -846,6 +794,7 @@ static BOOL VGA_SetGraphicMode(WORD mode)
     }
     vga_fb_offset = 0;
     vga_fb_pitch = vga_fb_width * ((vga_fb_depth + 7) / 8);
+    vga_planar_redraw = TRUE;
 
     newSize = vga_fb_width * vga_fb_height * ((vga_fb_depth + 7) / 8);
     if(newSize < 256 * 1024)
@@ -859,13 +808,17 @@ static BOOL VGA_SetGraphicMode(WORD mode)
       par.Yres = vga_fb_height;
     }
 
+    /* 16 color EGA/VGA modes keep their pixels in four planes at 0xa0000 */
+    planar = vga_fb_depth == 4 && vga_fb_width != 160 &&
+             vga_fb_width * vga_fb_height / 8 <= VGA_PLANE_SIZE;
+
     /* Setup window */
-    if(vga_fb_depth >= 8)
+    if(vga_fb_depth >= 8 || planar)
     {
       vga_fb_window_data = (SIZE_T)DOSMEM_dosmem + VGA_WINDOW_START;
       vga_fb_window_size = VGA_WINDOW_SIZE;
       vga_fb_palette = vga_def_palette;
-      vga_fb_palette_size = 256;
+      vga_fb_palette_size = planar ? 16 : 256;
     }
     else
     {
@@ -888,11 +841,10 @@ static BOOL VGA_SetGraphicMode(WORD mode)
       vga_fb_bright = 0;
     }
 
-    /* Clean the HW buffer */
-    memset(vga_fb_window_data, 0x00, vga_fb_window_size);
-
-    /* Reset window start */
-    VGA_SetWindowStart(0);
+    /* Reset window start and clean the HW buffer */
+    EnterCriticalSection(&vga_lock);
+    VGA_SwitchWindow(planar ? -1 : 0, TRUE);
+    LeaveCriticalSection(&vga_lock);
 
     par.Depth = (vga_fb_depth < 8) ? 8 : vga_fb_depth;
 
@@ -910,6 +862,7 @@ BOOL VGA_SetMode(WORD mode)
     BIOSDATA *bda = DOSVM_BiosData();
     /* get info on VGA mode & set appropriately */
     VGA_CurrentMode = mode;
+    vga_fb_linear = (mode & 0x4000) != 0;
     ModeInfo = VGA_GetModeInfo(VGA_CurrentMode);
     /*
      *  xxxxxxx1 = 80x25 text
@@ -979,6 +932,7 @@ void VGA_SetPalette(PALETTEENTRY *pal, int start, int len)
         return NULL;
     }
     memcpy(vga_palette + start, pal, len * sizeof(*pal));
+    vga_planar_redraw = TRUE;
 }
 
 /* set a single [char wide] color in 16 color mode. */
@@ -1101,6 +1055,41 @@ static void paint_bitmap()
     StretchBlt(dc, (width - new_width) / 2, (height - new_height) / 2, new_width, new_height, vga_dc, 0, 0, vga_mode.Xres, vga_mode.Yres, SRCCOPY);
 }
 
+/*** PLANAR MEMORY ***/
+
+static inline void VGA_PutPixels( BYTE *surf, const BYTE *index, unsigned int count )
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        PALETTEENTRY e = vga_palette[index[i]];
+        surf[i * 3 + 0] = e.peBlue;
+        surf[i * 3 + 1] = e.peGreen;
+        surf[i * 3 + 2] = e.peRed;
+    }
+}
+
+/**********************************************************************
+ *         VGA_Poll_Planar
+ *
+ * Convert the scanlines of plane memory written since the last update
+ * to the 24 bit bottom-up surface.
+ */
+static void VGA_Poll_Planar( BYTE *surf, unsigned int Pitch, unsigned int Height, unsigned int Width,
+                             const BYTE *dirty, BOOL redraw )
+{
+    BYTE line[1024];
+    unsigned int Y;
+
+    if (Width > sizeof(line)) Width = sizeof(line);
+    for (Y = 0; Y < Height; Y++)
+    {
+        if (VGA_GetPlanarLine( Y, Width, redraw ? NULL : dirty, line ))
+            VGA_PutPixels( surf + (Height - 1 - Y) * Pitch, line, Width );
+    }
+}
+
 /*
  * Set start of 64k window at 0xa0000 in bytes.
  * If value is -1, initialize color plane support.
@@ -1112,19 +1101,7 @@ void VGA_SetWindowStart(int start)
         return;
 
     EnterCriticalSection(&vga_lock);
-
-    if(vga_fb_window == -1)
-        FIXME("Remove VGA memory emulation.\n");
-    else
-        VGA_SyncWindow( TRUE );
-
-    vga_fb_window = start;
-
-    if(vga_fb_window == -1)
-        FIXME("Install VGA memory emulation.\n");
-    else
-        VGA_SyncWindow( FALSE );
-
+    VGA_SwitchWindow( start, FALSE );
     LeaveCriticalSection(&vga_lock);
 }
 
@@ -1256,35 +1233,116 @@ void VGA_SetPaletteIndex(unsigned index)
   vga_fb_palette_index = index;
 }
 
+/* Height of a character cell in graphics modes, VESA modes have none listed. */
+static unsigned VGA_GetCharHeight(void)
+{
+    const VGA_MODE *ModeInfo = VGA_GetModeInfo(VGA_CurrentMode);
+
+    if (ModeInfo && ModeInfo->CharHeight)
+        return ModeInfo->CharHeight;
+    return vga_fb_height > 200 ? 16 : 8;
+}
+
+/**********************************************************************
+ *         VGA_GetTextGrid
+ *
+ * Number of character cells on the screen of the current mode.
+ */
+void VGA_GetTextGrid(unsigned *cols, unsigned *rows)
+{
+    const VGA_MODE *ModeInfo = VGA_GetModeInfo(VGA_CurrentMode);
+
+    if (ModeInfo && ModeInfo->ModeType == TEXT)
+    {
+        *cols = vga_text_width;
+        *rows = vga_text_height;
+    }
+    else
+    {
+        *cols = vga_fb_width / 8;
+        *rows = vga_fb_height / VGA_GetCharHeight();
+    }
+}
+
 /**********************************************************************
  *         VGA_WritePixel
  *
- * Write data to the framebuffer
- * This is a property of the CGA controller, but might be supported
- * later by other framebuffer types
+ * Write a pixel of the current graphics mode (INT 10h AH=0Ch).
  */
 void VGA_WritePixel(unsigned color, unsigned page, unsigned col, unsigned row)
 {
-  int off;
-  int bits;
-  int pos;
+    if (VGA_GetModeInfo(VGA_CurrentMode)->ModeType == TEXT)
+        return;
 
-  /* Calculate CGA byte offset */
-  char *data = vga_fb_window_data;
-  off = row & 1 ? (8 * 1024) : 0;
-  off += (80 * (row/2));
-  off += col/4;
+    EnterCriticalSection(&vga_lock);
+    VGA_PutPixel(color, page, col, row);
+    LeaveCriticalSection(&vga_lock);
+}
 
-  /* Calculate bits offset */
-  pos = 6 - (col%4 * 2);
+/**********************************************************************
+ *         VGA_ReadPixel
+ *
+ * Read a pixel of the current graphics mode (INT 10h AH=0Dh).
+ */
+BYTE VGA_ReadPixel(unsigned page, unsigned col, unsigned row)
+{
+    BYTE color;
 
-  /* Clear current data */
-  bits = 0x03 << pos;
-  data[off] &= ~bits;
+    if (VGA_GetModeInfo(VGA_CurrentMode)->ModeType == TEXT)
+        return 0;
 
-  /* Set new data */
-  bits = color << pos;
-  data[off] |= bits;
+    EnterCriticalSection(&vga_lock);
+    color = VGA_GetPixel(page, col, row);
+    LeaveCriticalSection(&vga_lock);
+    return color;
+}
+
+/*
+ * Glyphs for text in graphics modes. There is no ROM font, so a fixed
+ * pitch OEM font as tall as the character cell is rasterized once per
+ * cell height.
+ */
+static BYTE     vga_glyphs[256][16];
+static unsigned vga_glyph_height;
+
+static void VGA_LoadGlyphs(unsigned height)
+{
+    HDC dc;
+    HBITMAP bitmap;
+    HFONT font;
+    HGDIOBJ old_bitmap, old_font;
+    BYTE bits[16 * 2]; /* monochrome scanlines are WORD aligned */
+    unsigned c, y;
+
+    if (vga_glyph_height == height)
+        return;
+
+    memset( vga_glyphs, 0, sizeof(vga_glyphs) );
+    dc = CreateCompatibleDC(NULL);
+    bitmap = CreateBitmap(8, height, 1, 1, NULL);
+    old_bitmap = SelectObject(dc, bitmap);
+    font = CreateFontA(height, 8, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, OEM_CHARSET,
+                       OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, NONANTIALIASED_QUALITY,
+                       FIXED_PITCH | FF_MODERN, "Terminal");
+    old_font = SelectObject(dc, font ? font : GetStockObject(OEM_FIXED_FONT));
+    SetTextColor(dc, RGB(255, 255, 255));
+    SetBkColor(dc, RGB(0, 0, 0));
+    for (c = 0; c < 256; c++)
+    {
+        char ch = c;
+
+        PatBlt(dc, 0, 0, 8, height, BLACKNESS);
+        TextOutA(dc, 0, 0, &ch, 1);
+        GetBitmapBits(bitmap, height * 2, bits);
+        for (y = 0; y < height; y++)
+            vga_glyphs[c][y] = bits[y * 2];
+    }
+    SelectObject(dc, old_font);
+    SelectObject(dc, old_bitmap);
+    if (font) DeleteObject(font);
+    DeleteObject(bitmap);
+    DeleteDC(dc);
+    vga_glyph_height = height;
 }
 
 /*** TEXT MODE ***/
@@ -1429,7 +1487,10 @@ static void VGA_PutCharAt(unsigned x, unsigned y, BYTE ascii, int attr)
     }
     else
     {
-       FIXME("Write %c at (%i,%i) - not yet supported in graphic modes.\n", (char)ascii, x, y);
+       unsigned height = min(VGA_GetCharHeight(), 16);
+
+       VGA_LoadGlyphs(height);
+       VGA_DrawGlyph(x * 8, y * height, vga_glyphs[ascii], height, attr >= 0 ? attr : 0x0f);
     }
 }
 
@@ -1446,8 +1507,10 @@ void VGA_WriteChars(unsigned X,unsigned Y,unsigned ch,int attr,int count)
 void VGA_PutChar(BYTE ascii)
 {
     DWORD w;
+    unsigned cols, rows;
 
     EnterCriticalSection(&vga_lock);
+    VGA_GetTextGrid(&cols, &rows);
 
     switch(ascii) {
     case '\b':
@@ -1479,17 +1542,17 @@ void VGA_PutChar(BYTE ascii)
         vga_text_x++;
     }
 
-    if (vga_text_x >= vga_text_width)
+    if (vga_text_x >= cols)
     {
         vga_text_x = 0;
         vga_text_y++;
     }
 
-    if (vga_text_y >= vga_text_height)
+    if (vga_text_y >= rows)
     {
-        vga_text_y = vga_text_height - 1;
+        vga_text_y = rows - 1;
         VGA_ScrollUpText( 0, 0, 
-                          vga_text_height - 1, vga_text_width - 1, 
+                          rows - 1, cols - 1, 
                           1, vga_text_attr );
     }
 
@@ -1513,7 +1576,7 @@ void VGA_ClearText(unsigned row1, unsigned col1,
     ModeInfo = VGA_GetModeInfo(VGA_CurrentMode);
     if (ModeInfo->ModeType != TEXT)
     {
-        FIXME("not yet supported in graphic modes.\n");
+        VGA_ScrollGraphics(row1, col1, row2, col2, 0, TRUE, attr, VGA_GetCharHeight());
         LeaveCriticalSection(&vga_lock);
         return;
     }
@@ -1534,6 +1597,13 @@ void VGA_ScrollUpText(unsigned row1,  unsigned col1,
 
     EnterCriticalSection(&vga_lock);
 
+    if (VGA_GetModeInfo(VGA_CurrentMode)->ModeType != TEXT)
+    {
+        VGA_ScrollGraphics(row1, col1, row2, col2, lines, TRUE, attr, VGA_GetCharHeight());
+        LeaveCriticalSection(&vga_lock);
+        return;
+    }
+
     /*
      * Scroll buffer.
      */
@@ -1560,6 +1630,13 @@ void VGA_ScrollDownText(unsigned row1,  unsigned col1,
 
     EnterCriticalSection(&vga_lock);
 
+    if (VGA_GetModeInfo(VGA_CurrentMode)->ModeType != TEXT)
+    {
+        VGA_ScrollGraphics(row1, col1, row2, col2, lines, FALSE, attr, VGA_GetCharHeight());
+        LeaveCriticalSection(&vga_lock);
+        return;
+    }
+
     /*
      * Scroll buffer.
      */
@@ -1590,8 +1667,85 @@ void VGA_GetCharacterAtCursor(BYTE *ascii, BYTE *attr)
 
 /*** CONTROL ***/
 
-/* FIXME: optimize by doing this only if the data has actually changed
- *        (in a way similar to DIBSection, perhaps) */
+/*
+ * Linear 256 color framebuffer, including mode 19.
+ *
+ * vga_fb_shadow: Scanlines last sent to the display. Only the band of
+ *                scanlines that differ from it is converted, and the
+ *                bitmap is left alone while nothing changed.
+ */
+static BYTE    *vga_fb_shadow;
+static unsigned vga_fb_shadow_size;
+
+static void VGA_Poll_Linear(void)
+{
+    unsigned int Pitch, Height, Width, X, Y, size = vga_fb_pitch * vga_fb_height;
+    const BYTE *dat = (const BYTE *)vga_fb_data + vga_fb_offset;
+    BOOL redraw = vga_planar_redraw;
+    unsigned int first = vga_fb_height, last = 0;
+    char *surf;
+
+    if (!vga_fb_data || vga_fb_offset + size > vga_fb_size)
+        return;
+
+    if (!vga_fb_linear)
+        VGA_SyncWindow( TRUE );
+
+    if (vga_fb_shadow_size != size)
+    {
+        HeapFree( GetProcessHeap(), 0, vga_fb_shadow );
+        vga_fb_shadow = HeapAlloc( GetProcessHeap(), 0, size );
+        vga_fb_shadow_size = vga_fb_shadow ? size : 0;
+        redraw = TRUE;
+    }
+    if (redraw || !vga_fb_shadow)
+    {
+        first = 0;
+        last = vga_fb_height - 1;
+    }
+    else
+    {
+        for (Y = 0; Y < vga_fb_height; Y++)
+        {
+            if (!memcmp( vga_fb_shadow + Y * vga_fb_pitch, dat + Y * vga_fb_pitch, vga_fb_width ))
+                continue;
+            if (first > Y) first = Y;
+            last = Y;
+        }
+        if (first > last) return;
+    }
+    vga_planar_redraw = FALSE;
+
+    surf = VGA_Lock(&Pitch,&Height,&Width,NULL);
+    if (!surf)
+    {
+        vga_planar_redraw = TRUE;
+        return;
+    }
+    if (last >= Height) last = Height - 1;
+    if (Width > vga_fb_width) Width = vga_fb_width;
+
+    for (Y = first; Y <= last; Y++)
+    {
+        const BYTE *line = dat + Y * vga_fb_pitch;
+        char *row = surf + Pitch * (Height - 1 - Y);
+
+        if (vga_fb_shadow)
+        {
+            memcpy( vga_fb_shadow + Y * vga_fb_pitch, line, vga_fb_pitch );
+            line = vga_fb_shadow + Y * vga_fb_pitch;
+        }
+        for (X = 0; X < Width; X++)
+        {
+            PALETTEENTRY e = vga_palette[line[X]];
+            row[X * 3 + 0] = e.peBlue;
+            row[X * 3 + 1] = e.peGreen;
+            row[X * 3 + 2] = e.peRed;
+        }
+    }
+    VGA_Unlock();
+}
+
 static void VGA_Poll_Graphics(void)
 {
   unsigned int Pitch, Height, Width, X, Y;
@@ -1599,13 +1753,49 @@ static void VGA_Poll_Graphics(void)
   BYTE *dat = vga_fb_data + vga_fb_offset;
   int   bpp = (vga_fb_depth + 7) / 8;
 
+  if (vga_fb_window == -1)
+  {
+      BYTE dirty[VGA_PLANE_SIZE >> VGA_DIRTY_SHIFT];
+      BOOL redraw = vga_planar_redraw, any = redraw;
+      unsigned int i;
+
+      /* take the dirty flags before reading the planes, a write racing
+       * with this is either seen below or flags its block again */
+      for (i = 0; i < sizeof(dirty); i++)
+      {
+          if ((dirty[i] = vga_planar_dirty[i]))
+          {
+              vga_planar_dirty[i] = 0;
+              any = TRUE;
+          }
+      }
+      if (!any) return;
+      vga_planar_redraw = FALSE;
+
+      surf = VGA_Lock(&Pitch,&Height,&Width,NULL);
+      if (!surf)
+      {
+          vga_planar_redraw = TRUE;
+          return;
+      }
+      VGA_Poll_Planar((BYTE *)surf, Pitch, Height, Width, dirty, redraw);
+      VGA_Unlock();
+      return;
+  }
+
+  if (vga_fb_depth == 8)
+  {
+      VGA_Poll_Linear();
+      return;
+  }
+
   surf = VGA_Lock(&Pitch,&Height,&Width,NULL);
   if (!surf) return;
 
   /*
    * Synchronize framebuffer contents.
    */
-  if (!(VGA_CurrentMode & 0x4000) && (vga_fb_window != -1))
+  if (!vga_fb_linear && (vga_fb_window != -1))
       VGA_SyncWindow( TRUE );
 
   /*
@@ -1977,9 +2167,6 @@ static void CALLBACK VGA_Poll( LPVOID arg, DWORD low, DWORD high )
     LeaveCriticalSection(&vga_lock);
 }
 
-static BYTE palreg,palcnt;
-static PALETTEENTRY paldat;
-
 void VGA_ioport_out( WORD port, BYTE val )
 {
     switch (port) {
@@ -2011,11 +2198,15 @@ void VGA_ioport_out( WORD port, BYTE val )
         /* Sequencer Register - Other */
         case 0x3c5:
           switch(vga_index_3c4) {
+               case 0x02: /* Sequencer: Map Mask Register */
+                  vga_seq_regs[2] = val;
+                  break;
                case 0x04: /* Sequencer: Memory Mode Register */
                   if(vga_fb_depth == 8)
                       VGA_SetWindowStart((val & 8) ? 0 : -1);
-                  else
+                  else if(vga_fb_window != -1)
                       FIXME("Memory Mode Register not supported in this mode.\n");
+                  vga_seq_regs[4] = val;
                   break;
                default:
                   FIXME("Unsupported index, VGA sequencer register 0x3c4: 0x%02x (value 0x%02x)\n",
@@ -2023,13 +2214,10 @@ void VGA_ioport_out( WORD port, BYTE val )
            }
            break;
         case 0x3c8:
-            palreg=val; palcnt=0; break;
+            VGA_DacSetWriteIndex(val);
+            break;
         case 0x3c9:
-            ((BYTE*)&paldat)[palcnt++]=val << 2;
-            if (palcnt==3) {
-                VGA_SetPalette(&paldat,palreg++,1);
-                palcnt=0;
-            }
+            VGA_DacWrite(val);
             break;
         /* Graphics Controller Register - Address */
         case 0x3ce:
@@ -2037,8 +2225,11 @@ void VGA_ioport_out( WORD port, BYTE val )
            break;
         /* Graphics Controller Register - Other */
         case 0x3cf:
-           FIXME("Unsupported index, VGA graphics controller register - other 0x3ce: 0x%02x (value 0x%02x)\n",
-                 vga_index_3ce, val);
+           if (vga_index_3ce < sizeof(vga_gc_regs))
+               vga_gc_regs[vga_index_3ce] = val;
+           else
+               FIXME("Unsupported index, VGA graphics controller register - other 0x3ce: 0x%02x (value 0x%02x)\n",
+                     vga_index_3ce, val);
            break;
         /* CRT Controller Register - Index (MDA) */
         case 0x3b4:
@@ -2050,8 +2241,21 @@ void VGA_ioport_out( WORD port, BYTE val )
         case 0x3b5:
         /* CRT Controller Register - Other (CGA) */
         case 0x3d5:
-           FIXME("Unsupported index, VGA crt controller register 0x3b4/0x3d4: 0x%02x (value 0x%02x)\n",
-                 vga_index_3d4, val);
+           switch(vga_index_3d4) {
+               case 0x0c: /* CRTC: Start Address High */
+               case 0x0d: /* CRTC: Start Address Low */
+                  vga_crtc_regs[vga_index_3d4] = val;
+                  vga_planar_redraw = TRUE;
+                  break;
+               case 0x13: /* CRTC: Offset, scanline pitch in words */
+                  vga_crtc_regs[0x13] = val;
+                  vga_planar_pitch = val * 2;
+                  vga_planar_redraw = TRUE;
+                  break;
+               default:
+                  FIXME("Unsupported index, VGA crt controller register 0x3b4/0x3d4: 0x%02x (value 0x%02x)\n",
+                        vga_index_3d4, val);
+           }
            break;
         /* Mode control register - 6845 Motorola (MDA) */
         case 0x3b8:
@@ -2154,6 +2358,15 @@ void VGA_ioport_out( WORD port, BYTE val )
     }
 }
 
+/* A string of DAC data writes (REP OUTSB to 0x3c9) goes to the DAC as a whole. */
+void VGA_ioport_out_block( WORD port, const BYTE *data, DWORD count )
+{
+    if (port == 0x3c9)
+        VGA_DacWriteBlock( data, count );
+    else
+        while (count--) VGA_ioport_out( port, *data++ );
+}
+
 BYTE VGA_ioport_in( WORD port )
 {
     BYTE ret;
@@ -2177,6 +2390,8 @@ BYTE VGA_ioport_in( WORD port )
         /* Sequencer Register - Other */
         case 0x3c5:
            switch(vga_index_3c4) {
+               case 0x02: /* Sequencer: Map Mask Register */
+                    return vga_seq_regs[2];
                case 0x04: /* Sequencer: Memory Mode Register */
                     return (VGA_GetWindowStart() == -1) ? 0xf7 : 0xff;
                default:
@@ -2201,6 +2416,8 @@ BYTE VGA_ioport_in( WORD port )
            break;
         /* Graphics Controller Register - Other */
         case 0x3cf:
+           if (vga_index_3ce < sizeof(vga_gc_regs))
+               return vga_gc_regs[vga_index_3ce];
            FIXME("Unsupported index, register 0x3ce: 0x%02x\n",
                  vga_index_3ce);
            return 0xff;
@@ -2208,6 +2425,8 @@ BYTE VGA_ioport_in( WORD port )
         case 0x3b5:
         /* CRT Controller Register - Other (CGA) */
         case 0x3d5:
+           if (vga_index_3d4 == 0x0c || vga_index_3d4 == 0x0d || vga_index_3d4 == 0x13)
+               return vga_crtc_regs[vga_index_3d4];
            FIXME("Unsupported index, VGA crt controller register 0x3b4/0x3d4: 0x%02x\n",
                  vga_index_3d4);
            return 0xff;
@@ -68,6 +68,8 @@ void VGA_UpdatePalette(void) DECLSPEC_HIDDEN;
 void VGA_SetPaletteIndex(unsigned index) DECLSPEC_HIDDEN;
 void VGA_SetBright(BOOL bright) DECLSPEC_HIDDEN;
 void VGA_WritePixel(unsigned color, unsigned page, unsigned col, unsigned row) DECLSPEC_HIDDEN;
+BYTE VGA_ReadPixel(unsigned page, unsigned col, unsigned row) DECLSPEC_HIDDEN;
+void VGA_GetTextGrid(unsigned *cols, unsigned *rows) DECLSPEC_HIDDEN;
 
 /* text mode */
 void VGA_InitAlphaMode(unsigned*Xres,unsigned*Yres) DECLSPEC_HIDDEN;
@@ -92,6 +94,12 @@ void VGA_GetCharacterAtCursor(BYTE *ascii, BYTE *attr) DECLSPEC_HIDDEN;
 /* control */
 void VGA_ioport_out(WORD port, BYTE val) DECLSPEC_HIDDEN;
 BYTE VGA_ioport_in(WORD port) DECLSPEC_HIDDEN;
+void VGA_ioport_out_block(WORD port, const BYTE *data, DWORD count) DECLSPEC_HIDDEN;
 void VGA_Clean(void) DECLSPEC_HIDDEN;
 
+/* planar memory, called by the CPU core */
+BYTE VGA_PlanarRead(DWORD offset);
+void VGA_PlanarWrite(DWORD offset, BYTE value);
+const volatile DWORD *VGA_GetPlanarBase(void);
+
 #endif /* __WINE_VGA_H */
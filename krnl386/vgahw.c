@@ -0,0 +1,731 @@
+/*
+ * VGA adapter state
+ *
+ * Copyright 1998 Ove Kåven (with some help from Marcus Meissner)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The parts of the VGA adapter emulation in vga.c that only keep
+ * adapter state and don't talk to the display, so they can be tested
+ * on their own: the DAC, the framebuffer window, the planar memory and
+ * the pixel services of the BIOS. vga.c decodes the ports, serializes
+ * the calls, rasterizes the font and draws the result.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "kernel16_private.h"
+#include "vga.h"
+#include "vgahw.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(ddraw);
+
+/*
+ * DAC write state: the palette entry written next and the components
+ * of it received so far. Components are 6 bit, red first.
+ */
+static BYTE vga_dac_index;
+static BYTE vga_dac_count;
+static PALETTEENTRY vga_dac_entry;
+
+/**********************************************************************
+ *         VGA_DacSetWriteIndex
+ *
+ * Port 0x3c8: select the palette entry written next.
+ */
+void VGA_DacSetWriteIndex( BYTE index )
+{
+    vga_dac_index = index;
+    vga_dac_count = 0;
+}
+
+/**********************************************************************
+ *         VGA_DacWrite
+ *
+ * Port 0x3c9: one color component. The entry is stored when its blue
+ * component arrives, then the index moves to the next entry.
+ */
+void VGA_DacWrite( BYTE value )
+{
+    ((BYTE *)&vga_dac_entry)[vga_dac_count++] = value << 2;
+    if (vga_dac_count == 3)
+    {
+        VGA_SetPalette( &vga_dac_entry, vga_dac_index++, 1 );
+        vga_dac_count = 0;
+    }
+}
+
+/**********************************************************************
+ *         VGA_DacWriteBlock
+ *
+ * A string of writes to port 0x3c9 (REP OUTSB). Each run of complete
+ * entries up to the end of the palette is stored with one
+ * VGA_SetPalette call.
+ */
+void VGA_DacWriteBlock( const BYTE *data, DWORD count )
+{
+    PALETTEENTRY pal[256];
+    unsigned int n;
+    BYTE start;
+
+    /* complete an entry left partially written */
+    while (count && vga_dac_count)
+    {
+        VGA_DacWrite( *data++ );
+        count--;
+    }
+    while (count >= 3)
+    {
+        start = vga_dac_index;
+        for (n = 0; count >= 3 && start + n < 256; n++, count -= 3, data += 3)
+        {
+            pal[n].peRed = data[0] << 2;
+            pal[n].peGreen = data[1] << 2;
+            pal[n].peBlue = data[2] << 2;
+            pal[n].peFlags = vga_dac_entry.peFlags;
+        }
+        VGA_SetPalette( pal, start, n );
+        vga_dac_index = start + n;
+    }
+    while (count--) VGA_DacWrite( *data++ );
+}
+
+/*
+ * VGA controller memory is emulated using linear framebuffer.
+ * This frambuffer also acts as an interface
+ * between VGA controller emulation and DirectDraw.
+ *
+ * vga_fb_width: Display width in pixels. Can be modified when
+ *               display mode is changed.
+ * vga_fb_height: Display height in pixels. Can be modified when
+ *                display mode is changed.
+ * vga_fb_depth: Number of bits used to store single pixel color information.
+ *               Each pixel uses (vga_fb_depth+7)/8 bytes because
+ *               1-16 color modes are mapped to 256 color mode.
+ *               Can be modified when display mode is changed.
+ * vga_fb_pitch: How many bytes to add to pointer in order to move
+ *               from one row to another. This is fixed in VGA modes,
+ *               but can be modified in SVGA modes.
+ * vga_fb_size: How many bytes are allocated to framebuffer.
+ *              VGA framebuffers are always larger than display size and
+ *              SVGA framebuffers may also be.
+ * vga_fb_data: Pointer to framebuffer start.
+ * vga_fb_window: Offset of 64k window 0xa0000 in bytes from framebuffer start.
+ *                This value is >= 0, if mode uses linear framebuffer and
+ *                -1, if mode uses color planes. This value is fixed
+ *                in all modes except 0x13 (256 color VGA) where
+ *                0 means normal mode and -1 means Mode-X (unchained mode).
+ * vga_fb_window_size, vga_fb_window_data: Size and linear address of the
+ *                window in DOS memory.
+ * vga_fb_linear: The mode is a VESA mode with a linear framebuffer, which
+ *                the program accesses directly instead of the window.
+ */
+int   vga_fb_width;
+int   vga_fb_height;
+int   vga_fb_depth;
+int   vga_fb_pitch;
+int   vga_fb_size = 0;
+char *vga_fb_data = 0;
+int   vga_fb_window = 0;
+int   vga_fb_window_size;
+char *vga_fb_window_data;
+BOOL  vga_fb_linear;
+
+/*
+ * VGA planar memory, used while vga_fb_window is -1 (16 color modes and
+ * unchained 256 color Mode X).
+ *
+ * vga_planes: 64k addresses of four planes. Byte N of each DWORD holds
+ *             plane N, so latch loads and masked writes are DWORD ops.
+ * vga_latch: Planes of the last address read by the CPU.
+ * vga_seq_regs, vga_gc_regs, vga_crtc_regs: Sequencer, graphics
+ *             controller and CRT controller registers used by the
+ *             planar memory model and the display.
+ * vga_planar_pitch: Bytes per scanline in each plane.
+ * vga_planar_dirty: One flag per 64 bytes of plane memory written since
+ *             the last screen update; only dirty scanlines are redrawn.
+ * vga_planar_redraw: Palette, start address, pitch or mode changed, the
+ *             next update redraws every scanline. Also used by the
+ *             linear 256 color modes.
+ * vga_planar_base: Linear address of the 64k window the CPU core sends
+ *             to VGA_PlanarRead and VGA_PlanarWrite, 0 if not planar.
+ */
+DWORD   *vga_planes;
+static DWORD vga_latch;
+BYTE     vga_seq_regs[5];
+BYTE     vga_gc_regs[9];
+BYTE     vga_crtc_regs[0x19];
+unsigned vga_planar_pitch;
+BYTE     vga_planar_dirty[VGA_PLANE_SIZE >> VGA_DIRTY_SHIFT];
+BOOL     vga_planar_redraw;
+static DWORD vga_planar_base;
+
+/* bit N of a 4 bit plane mask to 0xff in byte N */
+const DWORD vga_plane_expand[16] =
+{
+    0x00000000, 0x000000ff, 0x0000ff00, 0x0000ffff,
+    0x00ff0000, 0x00ff00ff, 0x00ffff00, 0x00ffffff,
+    0xff000000, 0xff0000ff, 0xff00ff00, 0xff00ffff,
+    0xffff0000, 0xffff00ff, 0xffffff00, 0xffffffff
+};
+
+/* 8 pixels of one plane byte, leftmost pixel (bit 7) in the lowest byte */
+static UINT64 vga_bit_spread[256];
+
+/**********************************************************************
+ *         VGA_SyncWindow
+ *
+ * Copy VGA window into framebuffer (if argument is TRUE) or
+ * part of framebuffer into VGA window (if argument is FALSE).
+ */
+void VGA_SyncWindow( BOOL target_is_fb )
+{
+    int size = vga_fb_window_size;
+
+    /* Window does not overlap framebuffer. */
+    if (vga_fb_window >= vga_fb_size)
+        return;
+
+    /* Check if window overlaps framebuffer only partially. */
+    if (vga_fb_size - vga_fb_window < vga_fb_window_size)
+        size = vga_fb_size - vga_fb_window;
+
+    if (target_is_fb)
+        memmove( vga_fb_data + vga_fb_window, vga_fb_window_data, size );
+    else
+        memmove( vga_fb_window_data, vga_fb_data + vga_fb_window, size );
+}
+
+void VGA_ResetPlanarRegisters(void)
+{
+    memset( vga_seq_regs, 0, sizeof(vga_seq_regs) );
+    memset( vga_gc_regs, 0, sizeof(vga_gc_regs) );
+    memset( vga_crtc_regs, 0, sizeof(vga_crtc_regs) );
+    vga_seq_regs[2] = 0x0f;   /* map mask: all planes */
+    vga_gc_regs[8] = 0xff;    /* bit mask: all bits */
+    vga_planar_pitch = vga_fb_depth == 8 ? vga_fb_width / 4 : vga_fb_width / 8;
+    vga_crtc_regs[0x13] = vga_planar_pitch / 2;
+    vga_planar_redraw = TRUE;
+}
+
+/* copy between the chained 256 color framebuffer and the planes */
+static void VGA_SyncPlanes( BOOL target_is_planes )
+{
+    BYTE *fb = (BYTE *)vga_fb_data;
+    unsigned int i, size = min( vga_fb_size, VGA_PLANE_SIZE * 4 );
+
+    if (vga_fb_depth != 8) return;
+    for (i = 0; i < size; i++)
+    {
+        if (target_is_planes)
+            ((BYTE *)&vga_planes[i >> 2])[i & 3] = fb[i];
+        else
+            fb[i] = ((BYTE *)&vga_planes[i >> 2])[i & 3];
+    }
+}
+
+/**********************************************************************
+ *         VGA_SwitchWindow
+ *
+ * Move the 64k window at 0xa0000 to start bytes into the framebuffer,
+ * or to the planes if start is -1. Called with the VGA lock held.
+ *
+ * When the program switches between chained and unchained 256 color
+ * memory the contents move along. A mode set clears video memory
+ * instead: what the old mode left in the planes or the framebuffer is
+ * not a picture in the new one.
+ */
+void VGA_SwitchWindow( int start, BOOL mode_set )
+{
+    if (mode_set)
+    {
+        vga_planar_base = 0;
+        vga_fb_window = start;
+        if (vga_fb_data) memset( vga_fb_data, 0, vga_fb_size );
+        memset( vga_fb_window_data, 0, vga_fb_window_size );
+    }
+    else
+    {
+        if (start == vga_fb_window) return;
+
+        if (vga_fb_window == -1)
+        {
+            vga_planar_base = 0;
+            VGA_SyncPlanes( FALSE );
+        }
+        else
+            VGA_SyncWindow( TRUE );
+
+        vga_fb_window = start;
+    }
+
+    if (vga_fb_window == -1)
+    {
+        if (!vga_planes)
+            vga_planes = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, VGA_PLANE_SIZE * sizeof(DWORD) );
+        if (!vga_planes)
+        {
+            ERR( "no memory for the planes\n" );
+            return;
+        }
+        VGA_ResetPlanarRegisters();
+        if (mode_set)
+            memset( vga_planes, 0, VGA_PLANE_SIZE * sizeof(DWORD) );
+        else
+            VGA_SyncPlanes( TRUE );
+        vga_planar_base = (DWORD)(SIZE_T)vga_fb_window_data;
+    }
+    else if (!mode_set)
+        VGA_SyncWindow( FALSE );
+}
+
+/**********************************************************************
+ *         VGA_PlanarRead
+ *
+ * CPU read from the 64k window in a planar mode.
+ */
+BYTE VGA_PlanarRead( DWORD offset )
+{
+    BYTE color, care, ret;
+    int plane;
+
+    offset &= VGA_PLANE_SIZE - 1;
+    vga_latch = vga_planes[offset];
+
+    if (!(vga_gc_regs[5] & 0x08))
+        return ((BYTE *)&vga_latch)[vga_gc_regs[4] & 3];
+
+    /* read mode 1: bits whose color matches the color compare register */
+    color = vga_gc_regs[2];
+    care = vga_gc_regs[7];
+    ret = 0xff;
+    for (plane = 0; plane < 4; plane++)
+    {
+        if (!(care & (1 << plane))) continue;
+        ret &= ~(((BYTE *)&vga_latch)[plane] ^ ((color & (1 << plane)) ? 0xff : 0x00));
+    }
+    return ret;
+}
+
+/**********************************************************************
+ *         VGA_PlanarWrite
+ *
+ * CPU write to the 64k window in a planar mode: write modes 0-3
+ * combine the value, set/reset and the latches, then the bit mask
+ * and the map mask select what reaches the planes.
+ */
+void VGA_PlanarWrite( DWORD offset, BYTE value )
+{
+    BYTE rotate = vga_gc_regs[3] & 7;
+    DWORD set_reset = vga_plane_expand[vga_gc_regs[0] & 0x0f];
+    DWORD bit_mask = vga_gc_regs[8] * 0x01010101;
+    DWORD plane_mask = vga_plane_expand[vga_seq_regs[2] & 0x0f];
+    DWORD data, enable;
+
+    offset &= VGA_PLANE_SIZE - 1;
+    if (rotate) value = (value >> rotate) | (value << (8 - rotate));
+
+    switch (vga_gc_regs[5] & 3)
+    {
+    case 0:
+        enable = vga_plane_expand[vga_gc_regs[1] & 0x0f];
+        data = (value * 0x01010101 & ~enable) | (set_reset & enable);
+        break;
+    case 1:
+        /* latches are written as they are */
+        vga_planes[offset] = (vga_planes[offset] & ~plane_mask) | (vga_latch & plane_mask);
+        vga_planar_dirty[offset >> VGA_DIRTY_SHIFT] = 1;
+        return;
+    case 2:
+        data = vga_plane_expand[value & 0x0f];
+        break;
+    default:
+        bit_mask &= value * 0x01010101;
+        data = set_reset;
+        break;
+    }
+
+    switch ((vga_gc_regs[3] >> 3) & 3)
+    {
+    case 1: data &= vga_latch; break;
+    case 2: data |= vga_latch; break;
+    case 3: data ^= vga_latch; break;
+    }
+    data = (data & bit_mask) | (vga_latch & ~bit_mask);
+
+    vga_planes[offset] = (vga_planes[offset] & ~plane_mask) | (data & plane_mask);
+    vga_planar_dirty[offset >> VGA_DIRTY_SHIFT] = 1;
+}
+
+/**********************************************************************
+ *         VGA_GetPlanarBase
+ *
+ * Returns where the CPU core finds the linear address of the window it
+ * has to send to VGA_PlanarRead/VGA_PlanarWrite (0 when no planar mode
+ * is active). The value changes with the video mode.
+ */
+const volatile DWORD *VGA_GetPlanarBase(void)
+{
+    return &vga_planar_base;
+}
+
+static void VGA_InitBitSpread(void)
+{
+    unsigned int i, bit;
+
+    if (vga_bit_spread[0xff]) return;
+    for (i = 0; i < 256; i++)
+        for (bit = 0; bit < 8; bit++)
+            if (i & (0x80 >> bit)) vga_bit_spread[i] |= (UINT64)1 << (bit * 8);
+}
+
+/**********************************************************************
+ *         VGA_GetPlanarLine
+ *
+ * Pixel indices of the first width pixels of displayed scanline y. In
+ * 16 color modes the four plane bytes of an address are spread to 8
+ * pixel indices at once with 64-bit table lookups; in Mode X the four
+ * plane bytes of an address already are 4 consecutive pixels.
+ *
+ * With the dirty flags taken from vga_planar_dirty, FALSE is returned
+ * for a scanline that wasn't written to; NULL converts every scanline.
+ */
+BOOL VGA_GetPlanarLine( unsigned y, unsigned width, const BYTE *dirty, BYTE *line )
+{
+    unsigned int start = (vga_crtc_regs[0x0c] << 8) | vga_crtc_regs[0x0d];
+    unsigned int bytes = vga_fb_depth == 8 ? (width + 3) / 4 : (width + 7) / 8;
+    unsigned int offset = start + y * vga_planar_pitch;
+    unsigned int x, i;
+    BYTE pixels[8];
+
+    if (dirty)
+    {
+        for (i = offset >> VGA_DIRTY_SHIFT; i <= (offset + bytes - 1) >> VGA_DIRTY_SHIFT; i++)
+            if (dirty[i & ((VGA_PLANE_SIZE >> VGA_DIRTY_SHIFT) - 1)]) break;
+        if (i > (offset + bytes - 1) >> VGA_DIRTY_SHIFT) return FALSE;
+    }
+
+    VGA_InitBitSpread();
+    for (x = 0; x < bytes; x++)
+    {
+        DWORD planes = vga_planes[(offset + x) & (VGA_PLANE_SIZE - 1)];
+
+        if (vga_fb_depth == 8)
+        {
+            memcpy( line + x * 4, &planes, min( 4, width - x * 4 ) );
+        }
+        else
+        {
+            UINT64 spread = vga_bit_spread[planes & 0xff]
+                          | vga_bit_spread[(planes >> 8) & 0xff] << 1
+                          | vga_bit_spread[(planes >> 16) & 0xff] << 2
+                          | vga_bit_spread[planes >> 24] << 3;
+            memcpy( pixels, &spread, sizeof(pixels) );
+            memcpy( line + x * 8, pixels, min( 8, width - x * 8 ) );
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * BIOS graphics services.
+ *
+ * Pixels are addressed in the memory model of the current mode: packed
+ * CGA pixels in the window at 0xb8000 (odd scanlines 8k higher), the
+ * planes in 16 color and unchained 256 color modes, or the chained
+ * framebuffer. Chained pixels inside the 64k window are accessed there,
+ * as the window is copied over the framebuffer on every update.
+ */
+
+/**********************************************************************
+ *         VGA_GetPlanarPage
+ *
+ * Offset of a display page in the planes, pages start on a power of two.
+ * FALSE if the page doesn't fit.
+ */
+BOOL VGA_GetPlanarPage( unsigned page, DWORD *base )
+{
+    unsigned size = vga_planar_pitch * vga_fb_height, stride = 0x800;
+
+    while (stride < size) stride <<= 1;
+    *base = page * stride;
+    return *base + size <= VGA_PLANE_SIZE;
+}
+
+/**********************************************************************
+ *         VGA_MarkPlanarDirty
+ *
+ * Flag count plane addresses from offset for the next screen update.
+ */
+void VGA_MarkPlanarDirty( DWORD offset, unsigned count )
+{
+    memset( vga_planar_dirty + (offset >> VGA_DIRTY_SHIFT), 1,
+            ((offset + count - 1) >> VGA_DIRTY_SHIFT) - (offset >> VGA_DIRTY_SHIFT) + 1 );
+}
+
+/* Byte holding a CGA pixel or the start of scanline y in the chained framebuffer. */
+static BYTE *VGA_GetPackedLine( unsigned y )
+{
+    if (vga_fb_depth < 8)
+        return (BYTE *)vga_fb_window_data + (y & 1) * (8 * 1024) + 80 * (y / 2);
+    return (BYTE *)vga_fb_data + y * vga_fb_pitch;
+}
+
+static BYTE *VGA_GetChainedPixel( DWORD offset )
+{
+    if (!vga_fb_linear && offset - vga_fb_window < (DWORD)vga_fb_window_size)
+        return (BYTE *)vga_fb_window_data + (offset - vga_fb_window);
+    if (!vga_fb_data || offset >= vga_fb_size)
+        return NULL;
+    return (BYTE *)vga_fb_data + offset;
+}
+
+/**********************************************************************
+ *         VGA_PutPixel
+ *
+ * Write one pixel; bit 7 of color XORs it in modes with less than 256
+ * colors.
+ */
+void VGA_PutPixel( unsigned color, unsigned page, unsigned col, unsigned row )
+{
+    BYTE *p;
+
+    if (col >= vga_fb_width || row >= vga_fb_height)
+        return;
+
+    if (vga_fb_window == -1)
+    {
+        DWORD base, offset;
+
+        if (!VGA_GetPlanarPage( page, &base ))
+            return;
+        if (vga_fb_depth == 8)
+        {
+            offset = base + row * vga_planar_pitch + col / 4;
+            ((BYTE *)&vga_planes[offset])[col & 3] = color;
+        }
+        else
+        {
+            DWORD mask = (0x80 >> (col & 7)) * 0x01010101;
+            DWORD bits = vga_plane_expand[color & 15] & mask;
+
+            offset = base + row * vga_planar_pitch + col / 8;
+            if (color & 0x80)
+                vga_planes[offset] ^= bits;
+            else
+                vga_planes[offset] = (vga_planes[offset] & ~mask) | bits;
+        }
+        vga_planar_dirty[offset >> VGA_DIRTY_SHIFT] = 1;
+    }
+    else if (vga_fb_depth < 8)
+    {
+        unsigned ppb = 8 / vga_fb_depth;
+        unsigned shift = (ppb - 1 - col % ppb) * vga_fb_depth;
+        BYTE mask = ((1 << vga_fb_depth) - 1) << shift;
+        BYTE bits = (color << shift) & mask;
+
+        p = VGA_GetPackedLine( row ) + col / ppb;
+        if (color & 0x80)
+            *p ^= bits;
+        else
+            *p = (*p & ~mask) | bits;
+    }
+    else if (vga_fb_depth == 8)
+    {
+        if ((p = VGA_GetChainedPixel( row * vga_fb_pitch + col )))
+            *p = color;
+    }
+    else
+        FIXME( "pixel services not supported in %u bit modes\n", vga_fb_depth );
+}
+
+/**********************************************************************
+ *         VGA_GetPixel
+ */
+BYTE VGA_GetPixel( unsigned page, unsigned col, unsigned row )
+{
+    BYTE *p;
+
+    if (col >= vga_fb_width || row >= vga_fb_height)
+        return 0;
+
+    if (vga_fb_window == -1)
+    {
+        DWORD base, planes;
+        BYTE color = 0;
+        unsigned i;
+
+        if (!VGA_GetPlanarPage( page, &base ))
+            return 0;
+        if (vga_fb_depth == 8)
+            return ((BYTE *)&vga_planes[base + row * vga_planar_pitch + col / 4])[col & 3];
+        planes = vga_planes[base + row * vga_planar_pitch + col / 8] >> (7 - (col & 7));
+        for (i = 0; i < 4; i++)
+            color |= ((planes >> (i * 8)) & 1) << i;
+        return color;
+    }
+    if (vga_fb_depth < 8)
+    {
+        unsigned ppb = 8 / vga_fb_depth;
+        unsigned shift = (ppb - 1 - col % ppb) * vga_fb_depth;
+
+        return (VGA_GetPackedLine( row )[col / ppb] >> shift) & ((1 << vga_fb_depth) - 1);
+    }
+    if (vga_fb_depth == 8 && (p = VGA_GetChainedPixel( row * vga_fb_pitch + col )))
+        return *p;
+    return 0;
+}
+
+/*
+ * Spans of whole character cells, x and width are multiples of 8 pixels
+ * and therefore start and end on byte boundaries in every memory model.
+ * Chained framebuffer spans expect the window to be flushed to it.
+ */
+
+/**********************************************************************
+ *         VGA_CopySpan
+ *
+ * Copy width pixels from x on scanline src to scanline dst.
+ */
+void VGA_CopySpan( unsigned dst, unsigned src, unsigned x, unsigned width )
+{
+    if (vga_fb_window == -1)
+    {
+        unsigned ppa = vga_fb_depth == 8 ? 4 : 8;
+        DWORD to = dst * vga_planar_pitch + x / ppa;
+
+        memmove( vga_planes + to, vga_planes + src * vga_planar_pitch + x / ppa,
+                 width / ppa * sizeof(DWORD) );
+        VGA_MarkPlanarDirty( to, width / ppa );
+    }
+    else if (vga_fb_depth < 8 || vga_fb_data)
+    {
+        unsigned bits = vga_fb_depth == 15 ? 16 : vga_fb_depth;
+
+        memmove( VGA_GetPackedLine( dst ) + x * bits / 8,
+                 VGA_GetPackedLine( src ) + x * bits / 8, width * bits / 8 );
+    }
+}
+
+/**********************************************************************
+ *         VGA_FillSpan
+ *
+ * Fill a span with the color of a scroll attribute, direct color modes
+ * get black.
+ */
+void VGA_FillSpan( unsigned y, unsigned x, unsigned width, BYTE color )
+{
+    if (vga_fb_window == -1)
+    {
+        unsigned ppa = vga_fb_depth == 8 ? 4 : 8, i;
+        DWORD offset = y * vga_planar_pitch + x / ppa;
+        DWORD value = vga_fb_depth == 8 ? color * 0x01010101 : vga_plane_expand[color & 15];
+
+        for (i = 0; i < width / ppa; i++)
+            vga_planes[offset + i] = value;
+        VGA_MarkPlanarDirty( offset, width / ppa );
+    }
+    else if (vga_fb_depth < 8)
+    {
+        BYTE value = vga_fb_depth == 1 ? ((color & 1) ? 0xff : 0x00) :
+                     vga_fb_depth == 2 ? (color & 3) * 0x55 : (color & 15) * 0x11;
+
+        memset( VGA_GetPackedLine( y ) + x * vga_fb_depth / 8, value, width * vga_fb_depth / 8 );
+    }
+    else if (vga_fb_data)
+    {
+        unsigned bits = vga_fb_depth == 15 ? 16 : vga_fb_depth;
+
+        memset( VGA_GetPackedLine( y ) + x * bits / 8, vga_fb_depth == 8 ? color : 0,
+                width * bits / 8 );
+    }
+}
+
+/**********************************************************************
+ *         VGA_ScrollGraphics
+ *
+ * Scroll a window of character cells height scanlines tall up or down,
+ * clearing it if lines is 0. Moves go a scanline span at a time.
+ */
+void VGA_ScrollGraphics( unsigned row1, unsigned col1, unsigned row2, unsigned col2,
+                         unsigned lines, BOOL up, BYTE attr, unsigned height )
+{
+    unsigned cols = vga_fb_width / 8, rows = vga_fb_height / height;
+    unsigned x, width, top, bottom, shift, y;
+    BOOL chained = vga_fb_window != -1 && vga_fb_depth >= 8 && !vga_fb_linear;
+
+    if (col2 >= cols) col2 = cols - 1;
+    if (row2 >= rows) row2 = rows - 1;
+    if (row1 > row2 || col1 > col2)
+        return;
+
+    x = col1 * 8;
+    width = (col2 - col1 + 1) * 8;
+    top = row1 * height;
+    bottom = (row2 + 1) * height;
+    shift = (!lines || lines > row2 - row1) ? bottom - top : lines * height;
+
+    if (chained)
+        VGA_SyncWindow( TRUE );
+
+    if (up)
+    {
+        for (y = top; y + shift < bottom; y++)
+            VGA_CopySpan( y, y + shift, x, width );
+        for (; y < bottom; y++)
+            VGA_FillSpan( y, x, width, attr );
+    }
+    else
+    {
+        for (y = bottom; y > top + shift; y--)
+            VGA_CopySpan( y - 1, y - 1 - shift, x, width );
+        for (; y > top; y--)
+            VGA_FillSpan( y - 1, x, width, attr );
+    }
+
+    if (chained)
+        VGA_SyncWindow( FALSE );
+}
+
+/**********************************************************************
+ *         VGA_DrawGlyph
+ *
+ * Draw a glyph of height rows of 8 pixels at pixel x, y. The attribute
+ * is the foreground color on a background of color 0, with bit 7 set
+ * the glyph is XORed onto the screen instead in modes below 256 colors.
+ */
+void VGA_DrawGlyph( unsigned x, unsigned y, const BYTE *glyph, unsigned height, BYTE attr )
+{
+    BOOL xor_glyph = (attr & 0x80) && vga_fb_depth < 8;
+    unsigned i, j;
+
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < 8; j++)
+        {
+            if (glyph[i] & (0x80 >> j))
+                VGA_PutPixel( attr, 0, x + j, y + i );
+            else if (!xor_glyph)
+                VGA_PutPixel( 0, 0, x + j, y + i );
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * VGA adapter state
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_VGAHW_H
+#define __WINE_VGAHW_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+
+/* framebuffer of the current mode, see vgahw.c */
+extern int   vga_fb_width DECLSPEC_HIDDEN;
+extern int   vga_fb_height DECLSPEC_HIDDEN;
+extern int   vga_fb_depth DECLSPEC_HIDDEN;
+extern int   vga_fb_pitch DECLSPEC_HIDDEN;
+extern int   vga_fb_size DECLSPEC_HIDDEN;
+extern char *vga_fb_data DECLSPEC_HIDDEN;
+extern int   vga_fb_window DECLSPEC_HIDDEN;
+extern int   vga_fb_window_size DECLSPEC_HIDDEN;
+extern char *vga_fb_window_data DECLSPEC_HIDDEN;
+extern BOOL  vga_fb_linear DECLSPEC_HIDDEN;
+
+/* planar memory */
+#define VGA_PLANE_SIZE    0x10000
+#define VGA_DIRTY_SHIFT   6
+
+extern DWORD   *vga_planes DECLSPEC_HIDDEN;
+extern BYTE     vga_seq_regs[5] DECLSPEC_HIDDEN;
+extern BYTE     vga_gc_regs[9] DECLSPEC_HIDDEN;
+extern BYTE     vga_crtc_regs[0x19] DECLSPEC_HIDDEN;
+extern unsigned vga_planar_pitch DECLSPEC_HIDDEN;
+extern BYTE     vga_planar_dirty[VGA_PLANE_SIZE >> VGA_DIRTY_SHIFT] DECLSPEC_HIDDEN;
+extern BOOL     vga_planar_redraw DECLSPEC_HIDDEN;
+extern const DWORD vga_plane_expand[16] DECLSPEC_HIDDEN;
+
+extern void VGA_SyncWindow( BOOL target_is_fb ) DECLSPEC_HIDDEN;
+extern void VGA_SwitchWindow( int start, BOOL mode_set ) DECLSPEC_HIDDEN;
+extern void VGA_ResetPlanarRegisters(void) DECLSPEC_HIDDEN;
+extern BOOL VGA_GetPlanarLine( unsigned y, unsigned width, const BYTE *dirty, BYTE *line ) DECLSPEC_HIDDEN;
+
+/* BIOS pixel services, called with the VGA lock held */
+extern BOOL VGA_GetPlanarPage( unsigned page, DWORD *base ) DECLSPEC_HIDDEN;
+extern void VGA_MarkPlanarDirty( DWORD offset, unsigned count ) DECLSPEC_HIDDEN;
+extern void VGA_PutPixel( unsigned color, unsigned page, unsigned col, unsigned row ) DECLSPEC_HIDDEN;
+extern BYTE VGA_GetPixel( unsigned page, unsigned col, unsigned row ) DECLSPEC_HIDDEN;
+extern void VGA_CopySpan( unsigned dst, unsigned src, unsigned x, unsigned width ) DECLSPEC_HIDDEN;
+extern void VGA_FillSpan( unsigned y, unsigned x, unsigned width, BYTE color ) DECLSPEC_HIDDEN;
+extern void VGA_ScrollGraphics( unsigned row1, unsigned col1, unsigned row2, unsigned col2,
+                                unsigned lines, BOOL up, BYTE attr, unsigned height ) DECLSPEC_HIDDEN;
+extern void VGA_DrawGlyph( unsigned x, unsigned y, const BYTE *glyph, unsigned height, BYTE attr ) DECLSPEC_HIDDEN;
+
+/* DAC, the palette goes to VGA_SetPalette */
+extern void VGA_DacSetWriteIndex( BYTE index ) DECLSPEC_HIDDEN;
+extern void VGA_DacWrite( BYTE value ) DECLSPEC_HIDDEN;
+extern void VGA_DacWriteBlock( const BYTE *data, DWORD count ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_VGAHW_H */
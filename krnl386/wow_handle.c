@@ -214,6 +214,28 @@ HANDLE get_handle32(WORD h, HANDLE_STORAGE *hs)
     return (HANDLE)h;
 }
 
+/* count the live handles of both tables for the runtime statistics */
+void get_wow_handle_stats(DWORD *user, DWORD *gdi, DWORD *max)
+{
+    DWORD i, count[HANDLE_TYPE_MAX] = { 0 };
+    int type;
+
+    for (type = 0; type < HANDLE_TYPE_MAX; type++)
+    {
+        HANDLE_DATA *handles = handle_list[type].handles;
+        if (!handles)
+            continue;
+        for (i = HANDLE_RESERVED; i < 0x10000 - HANDLE_RESERVED; i++)
+        {
+            /* freed HGDI entries keep only the object type in the high word */
+            if ((DWORD_PTR)handles[i].handle32 & 0xffff)
+                count[type]++;
+        }
+    }
+    *user = count[HANDLE_TYPE_HANDLE];
+    *gdi = count[HANDLE_TYPE_HGDI];
+    *max = 0x10000 - 2 * HANDLE_RESERVED;
+}
 static void enter_handle_lock()
 {
     EnterCriticalSection(&handle_lock);
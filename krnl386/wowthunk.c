@@ -624,6 +624,7 @@ BOOL WINAPI K32WOWCallback16Ex( DWORD vpfn16, DWORD dwFlags,
     char *stack = (char *)CURRENT_STACK16 - cbArgs;
     LPVOID old = getWOW32Reserved();
 
+    stats_calls_to_16++;
     memcpy( stack, pArgs, cbArgs );
 
     if (dwFlags & (WCB16_REGS|WCB16_REGS_LONG))
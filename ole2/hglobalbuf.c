@@ -0,0 +1,150 @@
+/*
+ * Growable buffer in a 16-bit global block
+ *
+ * Copyright 1999 Francis Beaudet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The contents of an HGLOBAL-backed stream. Writes past the end grow the
+ * block geometrically, so that a stream written in small chunks doesn't
+ * reallocate and copy it every time; the spare capacity is trimmed again
+ * before anybody looks at the block itself.
+ *
+ * Nothing here knows about IStream16, hglobalstream.c keeps the cursor
+ * and the interface.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winerror.h"
+#include "wine/winbase16.h"
+#include "hglobalbuf.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(storage);
+
+/* reallocate the block to hold at least size bytes, exactly or with room to grow */
+static HRESULT reserve( struct hglobal_buffer *buffer, ULONG size, BOOL exact )
+{
+    HGLOBAL16 handle;
+    ULONG capacity = size;
+
+    if (!exact)
+    {
+        if (size <= buffer->capacity) return S_OK;
+        capacity = max( buffer->capacity, HGLOBAL_BUFFER_MIN_CAPACITY );
+        while (capacity < size && capacity <= HGLOBAL_BUFFER_MAX_CAPACITY / 2)
+            capacity *= 2;
+        if (capacity < size) capacity = max( size, HGLOBAL_BUFFER_MAX_CAPACITY );
+    }
+    if (capacity == buffer->capacity) return S_OK;
+
+    if (!(handle = GlobalReAlloc16( buffer->handle, capacity, 0 ))) return E_OUTOFMEMORY;
+    buffer->handle = handle;
+    buffer->capacity = capacity;
+    return S_OK;
+}
+
+/***********************************************************************
+ *           hglobal_buffer_init
+ *
+ * The buffer starts with the contents of the whole block.
+ */
+void hglobal_buffer_init( struct hglobal_buffer *buffer, HGLOBAL16 handle )
+{
+    buffer->handle = handle;
+    buffer->size = buffer->capacity = GlobalSize16( handle );
+}
+
+/***********************************************************************
+ *           hglobal_buffer_set_size
+ *
+ * Reallocate the block to exactly size bytes.
+ */
+HRESULT hglobal_buffer_set_size( struct hglobal_buffer *buffer, ULONG size )
+{
+    HRESULT hr;
+
+    if (buffer->size == size && buffer->capacity == size) return S_OK;
+    if (FAILED(hr = reserve( buffer, size, TRUE ))) return hr;
+    buffer->size = size;
+    return S_OK;
+}
+
+/***********************************************************************
+ *           hglobal_buffer_trim
+ *
+ * Give the block back the size of the contents, callers that look at the
+ * HGLOBAL directly expect GlobalSize16 to match it.
+ */
+void hglobal_buffer_trim( struct hglobal_buffer *buffer )
+{
+    if (buffer->capacity > buffer->size && buffer->size)
+        reserve( buffer, buffer->size, TRUE );
+}
+
+/***********************************************************************
+ *           hglobal_buffer_read
+ *
+ * Returns the number of bytes read, which stops at the end of the contents.
+ */
+ULONG hglobal_buffer_read( struct hglobal_buffer *buffer, ULONG pos, void *data, ULONG count )
+{
+    void *ptr;
+
+    if (pos >= buffer->size) return 0;
+    count = min( buffer->size - pos, count );
+    if (!(ptr = GlobalLock16( buffer->handle )))
+    {
+        WARN( "read from invalid hglobal %04x\n", buffer->handle );
+        return 0;
+    }
+    memcpy( data, (char *)ptr + pos, count );
+    GlobalUnlock16( buffer->handle );
+    return count;
+}
+
+/***********************************************************************
+ *           hglobal_buffer_write
+ *
+ * Writing past the end grows the contents. S_FALSE if the block is
+ * invalid and nothing was written.
+ */
+HRESULT hglobal_buffer_write( struct hglobal_buffer *buffer, ULONG pos, const void *data, ULONG count )
+{
+    void *ptr;
+    HRESULT hr;
+
+    if (!count) return S_OK;
+    if (pos + count < pos) return E_OUTOFMEMORY;
+    if (pos + count > buffer->size)
+    {
+        if (FAILED(hr = reserve( buffer, pos + count, FALSE ))) return hr;
+        buffer->size = pos + count;
+    }
+    if (!(ptr = GlobalLock16( buffer->handle )))
+    {
+        WARN( "write to invalid hglobal %04x\n", buffer->handle );
+        return S_FALSE;
+    }
+    memcpy( (char *)ptr + pos, data, count );
+    GlobalUnlock16( buffer->handle );
+    return S_OK;
+}
@@ -0,0 +1,45 @@
+/*
+ * Growable buffer in a 16-bit global block
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_HGLOBALBUF_H
+#define __WINE_HGLOBALBUF_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+
+/* largest 16-bit global block, 16M - 64K */
+#define HGLOBAL_BUFFER_MAX_CAPACITY 0x00ff0000
+#define HGLOBAL_BUFFER_MIN_CAPACITY 0x100
+
+struct hglobal_buffer
+{
+    HGLOBAL16 handle;
+    ULONG     size;       /* bytes in use */
+    ULONG     capacity;   /* allocated size of handle, may exceed size */
+};
+
+extern void hglobal_buffer_init( struct hglobal_buffer *buffer, HGLOBAL16 handle ) DECLSPEC_HIDDEN;
+extern HRESULT hglobal_buffer_set_size( struct hglobal_buffer *buffer, ULONG size ) DECLSPEC_HIDDEN;
+extern void hglobal_buffer_trim( struct hglobal_buffer *buffer ) DECLSPEC_HIDDEN;
+extern ULONG hglobal_buffer_read( struct hglobal_buffer *buffer, ULONG pos, void *data, ULONG count ) DECLSPEC_HIDDEN;
+extern HRESULT hglobal_buffer_write( struct hglobal_buffer *buffer, ULONG pos, const void *data, ULONG count ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_HGLOBALBUF_H */
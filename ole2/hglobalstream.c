@@ -45,6 +45,7 @@
 #include "wine/debug.h"
 #include "wine/winbase16.h"
 #include "ifs.h"
+#include "hglobalbuf.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(storage);
 
@@ -71,15 +72,12 @@ typedef struct
   IStream16 IStream16_iface;
   LONG ref;
 
-  /* support for the stream */
-  HGLOBAL16 supportHandle;
+  /* support for the stream, and its size */
+  struct hglobal_buffer buffer;
 
   /* if TRUE the HGLOBAL is destroyed when the stream is finally released */
   BOOL deleteOnRelease;
 
-  /* size of the stream */
-  ULARGE_INTEGER streamSize;
-
   /* current position of the cursor */
   ULARGE_INTEGER currentPosition;
 } HGLOBALStreamImpl;
@@ -132,9 +130,11 @@ ULONG CDECL HGLOBALStreamImpl16_Release(
   {
     if (This->deleteOnRelease)
     {
-      GlobalFree16(This->supportHandle);
-      This->supportHandle = NULL;
+      GlobalFree16(This->buffer.handle);
+      This->buffer.handle = 0;
     }
+    else
+      hglobal_buffer_trim(&This->buffer);
 
     HeapFree(GetProcessHeap(), 0, This);
   }
@@ -159,9 +159,7 @@ HRESULT CDECL HGLOBALStreamImpl16_Read(
 {
   HGLOBALStreamImpl* This = impl_from_IStream16(iface);
 
-  void* supportBuffer;
   ULONG bytesReadBuffer;
-  ULONG bytesToReadFromBuffer;
 
   TRACE("(%p, %p, %d, %p)\n", iface,
 	pv, cb, pcbRead);
@@ -174,38 +172,10 @@ HRESULT CDECL HGLOBALStreamImpl16_Read(
     pcbRead = &bytesReadBuffer;
 
   /*
-   * Using the known size of the stream, calculate the number of bytes
-   * to read from the block chain
+   * Copy what the stream holds from the current position and move past it.
    */
-  bytesToReadFromBuffer = min( This->streamSize.u.LowPart - This->currentPosition.u.LowPart, cb);
-
-  /*
-   * Lock the buffer in position and copy the data.
-   */
-  supportBuffer = GlobalLock16(This->supportHandle);
-  if (!supportBuffer)
-  {
-      WARN("read from invalid hglobal %p\n", This->supportHandle);
-      *pcbRead = 0;
-      return S_OK;
-  }
-
-  memcpy(pv, (char *) supportBuffer+This->currentPosition.u.LowPart, bytesToReadFromBuffer);
-
-  /*
-   * Move the current position to the new position
-   */
-  This->currentPosition.u.LowPart+=bytesToReadFromBuffer;
-
-  /*
-   * Return the number of bytes read.
-   */
-  *pcbRead = bytesToReadFromBuffer;
-
-  /*
-   * Cleanup
-   */
-  GlobalUnlock16(This->supportHandle);
+  *pcbRead = hglobal_buffer_read(&This->buffer, This->currentPosition.u.LowPart, pv, cb);
+  This->currentPosition.u.LowPart += *pcbRead;
 
   /*
    * Always returns S_OK even if the end of the stream is reached before the
@@ -233,9 +203,8 @@ HRESULT CDECL HGLOBALStreamImpl16_Write(
 {
   HGLOBALStreamImpl* This = impl_from_IStream16(iface);
 
-  void*          supportBuffer;
-  ULARGE_INTEGER newSize;
   ULONG          bytesWritten = 0;
+  HRESULT        hr;
 
   TRACE("(%p, %p, %d, %p)\n", iface, pv, cb, pcbWritten);
 
@@ -251,45 +220,23 @@ HRESULT CDECL HGLOBALStreamImpl16_Write(
 
   *pcbWritten = 0;
 
-  newSize.u.HighPart = 0;
-  newSize.u.LowPart = This->currentPosition.u.LowPart + cb;
-
   /*
-   * Verify if we need to grow the stream
+   * Copy the data, the stream grows if it is too small.
    */
-  if (newSize.u.LowPart > This->streamSize.u.LowPart)
+  hr = hglobal_buffer_write(&This->buffer, This->currentPosition.u.LowPart, pv, cb);
+  if (FAILED(hr))
   {
-    /* grow stream */
-    HRESULT hr = HGLOBALStreamImpl16_SetSize(iface, newSize);
-    if (FAILED(hr))
-    {
-      ERR("IStream16_SetSize failed with error 0x%08x\n", hr);
-      return hr;
-    }
-  }
-
-  /*
-   * Lock the buffer in position and copy the data.
-   */
-  supportBuffer = GlobalLock16(This->supportHandle);
-  if (!supportBuffer)
-  {
-      WARN("write to invalid hglobal %p\n", This->supportHandle);
-      return S_OK;
+    ERR("growing the stream failed with error 0x%08x\n", hr);
+    return hr;
   }
-
-  memcpy((char *) supportBuffer+This->currentPosition.u.LowPart, pv, cb);
+  if (hr == S_FALSE)
+    return S_OK;
 
   /*
    * Move the current position to the new position
    */
   This->currentPosition.u.LowPart+=cb;
 
-  /*
-   * Cleanup
-   */
-  GlobalUnlock16(This->supportHandle);
-
 out:
   /*
    * Return the number of bytes read.
@@ -334,7 +281,8 @@ HRESULT CDECL HGLOBALStreamImpl16_Seek(
     case STREAM_SEEK_CUR:
       break;
     case STREAM_SEEK_END:
-      newPosition = This->streamSize;
+      newPosition.u.HighPart = 0;
+      newPosition.u.LowPart = This->buffer.size;
       break;
     default:
       hr = STG_E_SEEKERROR;
@@ -379,7 +327,6 @@ HRESULT CDECL HGLOBALStreamImpl16_SetSize(
 				     ULARGE_INTEGER  libNewSize)   /* [in] */
 {
   HGLOBALStreamImpl* This = impl_from_IStream16(iface);
-  HGLOBAL16 supportHandle;
 
   TRACE("(%p, %d)\n", iface, libNewSize.u.LowPart);
 
@@ -387,21 +334,10 @@ HRESULT CDECL HGLOBALStreamImpl16_SetSize(
    * HighPart is ignored as shown in tests
    */
 
-  if (This->streamSize.u.LowPart == libNewSize.u.LowPart)
-    return S_OK;
-
   /*
    * Re allocate the HGlobal to fit the new size of the stream.
    */
-  supportHandle = GlobalReAlloc16(This->supportHandle, libNewSize.u.LowPart, 0);
-
-  if (supportHandle == 0)
-    return E_OUTOFMEMORY;
-
-  This->supportHandle = supportHandle;
-  This->streamSize.u.LowPart = libNewSize.u.LowPart;
-
-  return S_OK;
+  return hglobal_buffer_set_size(&This->buffer, libNewSize.u.LowPart);
 }
 
 /***
@@ -470,8 +406,8 @@ HRESULT CDECL HGLOBALStreamImpl16_CopyTo(
 /***
  * This method is part of the IStream16 interface.
  *
- * For streams supported by HGLOBALS, this function does nothing.
- * This is what the documentation tells us.
+ * For streams supported by HGLOBALS, this function only trims the
+ * spare capacity left by Write.
  *
  * See the documentation of IStream16 for more info.
  */
@@ -479,6 +415,7 @@ HRESULT CDECL HGLOBALStreamImpl16_Commit(
 		  IStream16*      iface,
 		  DWORD         grfCommitFlags)  /* [in] */
 {
+  hglobal_buffer_trim(&impl_from_IStream16(iface)->buffer);
   return S_OK;
 }
 
@@ -549,7 +486,8 @@ HRESULT CDECL HGLOBALStreamImpl16_Stat(
 
   pstatstg->pwcsName = NULL;
   pstatstg->type     = STGTY_STREAM;
-  pstatstg->cbSize   = This->streamSize;
+  pstatstg->cbSize.u.HighPart = 0;
+  pstatstg->cbSize.u.LowPart  = This->buffer.size;
 
   return S_OK;
 }
@@ -564,7 +502,9 @@ HRESULT CDECL HGLOBALStreamImpl16_Clone(
   HRESULT hr;
 
   TRACE(" Cloning %p (deleteOnRelease=%d seek position=%ld)\n",iface,This->deleteOnRelease,(long)This->currentPosition.QuadPart);
-  hr = CreateStreamOnHGlobal16(This->supportHandle, FALSE, ppstm);
+  /* the clone takes its size from the handle */
+  hglobal_buffer_trim(&This->buffer);
+  hr = CreateStreamOnHGlobal16(This->buffer.handle, FALSE, ppstm);
   if(FAILED(hr))
     return hr;
   offset.QuadPart = (LONGLONG)This->currentPosition.QuadPart;
@@ -614,22 +554,19 @@ HRESULT WINAPI CreateStreamOnHGlobal16(
   This->IStream16_iface.lpVtbl = SegHGLOBALStreamImplVtbl;
   This->ref = 1;
 
-  /* initialize the support */
-  This->supportHandle = hGlobal;
   This->deleteOnRelease = fDeleteOnRelease;
 
   /* allocate a handle if one is not supplied */
-  if (!This->supportHandle)
-    This->supportHandle = GlobalAlloc16(GMEM_MOVEABLE|GMEM_NODISCARD|GMEM_SHARE, 0);
+  if (!hGlobal)
+    hGlobal = GlobalAlloc16(GMEM_MOVEABLE|GMEM_NODISCARD|GMEM_SHARE, 0);
+
+  /* initialize the size of the stream to the size of the handle */
+  hglobal_buffer_init(&This->buffer, hGlobal);
 
   /* start at the beginning */
   This->currentPosition.u.HighPart = 0;
   This->currentPosition.u.LowPart = 0;
 
-  /* initialize the size of the stream to the size of the handle */
-  This->streamSize.u.HighPart = 0;
-  This->streamSize.u.LowPart = GlobalSize16(This->supportHandle);
-
   *ppstm = MapLS(&This->IStream16_iface);
 
   return S_OK;
@@ -651,7 +588,10 @@ HRESULT WINAPI GetHGlobalFromStream16(IStream16* pstm, HGLOBAL16* phglobal)
    * Verify that the stream object was created with CreateStreamOnHGlobal.
    */
   if (pStream->IStream16_iface.lpVtbl == SegHGLOBALStreamImplVtbl)
-    *phglobal = pStream->supportHandle;
+  {
+    hglobal_buffer_trim(&pStream->buffer);
+    *phglobal = pStream->buffer.handle;
+  }
   else
   {
     *phglobal = 0;
@@ -1035,7 +1035,7 @@ end:
     HeapFree(GetProcessHeap(), 0, tlibPath);
     HeapFree(GetProcessHeap(), 0, tlibPathW);
     if (typeLib) ITypeLib_Release(typeLib);
-    if (key) RegCloseKey(key);
+    if (key) RegCloseKey16(key);
     return result;
 }
 
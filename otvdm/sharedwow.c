@@ -0,0 +1,165 @@
+/*
+ * Shared WOW launch protocol
+ *
+ * Copyright 2003 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * A client launching a program in the shared WOW writes a shared_wow_exec
+ * block to \\.\pipe\otvdmpipe. Version 0 clients only send the program and
+ * command line, version 1 clients add curdir, and both close the pipe
+ * without reading. Version 2 clients append the environment block and wait
+ * for a shared_wow_reply carrying the HINSTANCE16 or error code.
+ *
+ * Servers that understand version 2 say so with a shared_wow_hello as soon
+ * as a client connects. Older servers read a single version 1 block and
+ * never write, so a client that gets no hello sends a version 1 request
+ * and assumes the launch succeeded.
+ *
+ * Nothing here knows about pipes; winevdm.c connects the clients and runs
+ * the launches.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "sharedwow.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(winevdm);
+
+/* the transport may return short reads */
+static BOOL shared_wow_read( struct shared_wow_transport *transport, LPVOID buf, DWORD size, DWORD timeout )
+{
+    DWORD total = 0, done;
+
+    while (total < size && (done = transport->read( transport, (LPBYTE)buf + total, size - total, timeout )))
+        total += done;
+    return total == size;
+}
+
+/***********************************************************************
+ *           shared_wow_write_hello
+ *
+ * Tell a client that just connected which version the server reads.
+ */
+BOOL shared_wow_write_hello( struct shared_wow_transport *transport )
+{
+    shared_wow_hello hello;
+
+    hello.header = SHARED_WOW_HELLO;
+    hello.version = SHARED_WOW_VERSION;
+    return transport->write( transport, &hello, sizeof(hello) );
+}
+
+/***********************************************************************
+ *           shared_wow_read_request
+ *
+ * Read a request of any version; exec_data->header receives the version.
+ * FALSE if it is malformed or truncated. The environment block of version
+ * 2 requests goes to environment, which has room for
+ * SHARED_WOW_MAX_ENVIRONMENT + 2 bytes; it is empty for older versions.
+ */
+BOOL shared_wow_read_request( struct shared_wow_transport *transport, shared_wow_exec *exec_data, LPSTR environment )
+{
+    memset( exec_data, 0, sizeof(*exec_data) );
+    environment[0] = environment[1] = 0;
+    if (!shared_wow_read( transport, exec_data, SHARED_WOW_EXEC_V1_SIZE, SHARED_WOW_IO_TIMEOUT ))
+        return FALSE;
+    exec_data->appname[MAX_PATH - 1] = 0;
+    exec_data->cmdline[MAX_PATH - 1] = 0;
+    exec_data->curdir[MAX_PATH - 1] = 0;
+    if (exec_data->header > SHARED_WOW_VERSION)
+    {
+        WARN( "unknown version %u\n", exec_data->header );
+        return FALSE;
+    }
+    /* version 0 clients leave curdir uninitialized */
+    if (exec_data->header < SHARED_WOW_CURDIR_SUPPORTED)
+        exec_data->curdir[0] = 0;
+    if (exec_data->header < SHARED_WOW_REPLY_SUPPORTED)
+        return TRUE;
+
+    if (!shared_wow_read( transport, &exec_data->environment_size, sizeof(exec_data->environment_size), SHARED_WOW_IO_TIMEOUT ) ||
+        exec_data->environment_size > SHARED_WOW_MAX_ENVIRONMENT ||
+        !shared_wow_read( transport, environment, exec_data->environment_size, SHARED_WOW_IO_TIMEOUT ))
+    {
+        environment[0] = environment[1] = 0;
+        return FALSE;
+    }
+    /* two extra nulls terminate a truncated block */
+    environment[exec_data->environment_size] = environment[exec_data->environment_size + 1] = 0;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           shared_wow_write_reply
+ *
+ * Send the result of a version 2 request.
+ */
+BOOL shared_wow_write_reply( struct shared_wow_transport *transport, HINSTANCE16 instance )
+{
+    shared_wow_reply reply;
+
+    reply.header = SHARED_WOW_REPLY_SUPPORTED;
+    reply.instance = instance;
+    return transport->write( transport, &reply, sizeof(reply) );
+}
+
+/***********************************************************************
+ *           shared_wow_send_request
+ *
+ * Send a request in the highest version the server reads. exec_data
+ * holds everything but the header and environment. *result receives the
+ * launch result, or 33 when the server doesn't report it. FALSE if the
+ * request couldn't be sent.
+ */
+BOOL shared_wow_send_request( struct shared_wow_transport *transport, const shared_wow_exec *exec_data,
+                              LPCSTR environment, DWORD environment_size, HINSTANCE16 *result )
+{
+    shared_wow_exec request = *exec_data;
+    shared_wow_hello hello;
+    shared_wow_reply reply;
+
+    *result = 33;
+    if (!shared_wow_read( transport, &hello, sizeof(hello), SHARED_WOW_HELLO_TIMEOUT ) ||
+        hello.header != SHARED_WOW_HELLO || hello.version < SHARED_WOW_REPLY_SUPPORTED)
+    {
+        TRACE( "no hello, sending a version 1 request\n" );
+        request.header = SHARED_WOW_CURDIR_SUPPORTED;
+        return transport->write( transport, &request, SHARED_WOW_EXEC_V1_SIZE );
+    }
+
+    if (environment_size > SHARED_WOW_MAX_ENVIRONMENT)
+        environment_size = 0;
+    request.header = SHARED_WOW_REPLY_SUPPORTED;
+    request.environment_size = environment_size;
+    if (!transport->write( transport, &request, sizeof(request) ) ||
+        (environment_size && !transport->write( transport, environment, environment_size )))
+        return FALSE;
+
+    /* the server replies once the program is loaded, which takes as long as it takes */
+    if (shared_wow_read( transport, &reply, sizeof(reply), INFINITE ) &&
+        reply.header == SHARED_WOW_REPLY_SUPPORTED)
+        *result = reply.instance;
+    else
+        WARN( "no reply to the request\n" );
+    return TRUE;
+}
@@ -0,0 +1,77 @@
+/*
+ * Shared WOW launch protocol
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_SHAREDWOW_H
+#define __WINE_SHAREDWOW_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+
+#define SHARED_WOW_CURDIR_SUPPORTED 1
+#define SHARED_WOW_REPLY_SUPPORTED 2
+#define SHARED_WOW_VERSION SHARED_WOW_REPLY_SUPPORTED
+#define SHARED_WOW_HELLO 0x574f     /* 'OW' */
+#define SHARED_WOW_MAX_ENVIRONMENT 0x10000
+#define SHARED_WOW_IO_TIMEOUT 5000
+/* how long a client waits for the server to say which version it speaks */
+#define SHARED_WOW_HELLO_TIMEOUT 1000
+
+#include <pshpack1.h>
+typedef struct {
+    WORD header;    /* version of the request, 0 before SHARED_WOW_CURDIR_SUPPORTED */
+    WORD showCmd;
+    CHAR appname[MAX_PATH];
+    CHAR cmdline[MAX_PATH];
+    CHAR curdir[MAX_PATH];
+    /* SHARED_WOW_REPLY_SUPPORTED */
+    DWORD environment_size;
+    /* followed by environment_size bytes of environment variables */
+} shared_wow_exec;
+
+typedef struct {
+    WORD header;    /* SHARED_WOW_HELLO */
+    WORD version;   /* highest request version the server reads */
+} shared_wow_hello;
+
+typedef struct {
+    WORD header;
+    WORD instance;  /* HINSTANCE16, error code if < 32 */
+} shared_wow_reply;
+#include <poppack.h>
+#define SHARED_WOW_EXEC_V1_SIZE FIELD_OFFSET(shared_wow_exec, environment_size)
+
+/* A connection to the other side. read returns the number of bytes read,
+ * 0 on timeout or when the connection is closed; write returns FALSE if
+ * not all of buf could be written. */
+struct shared_wow_transport
+{
+    DWORD (*read)( struct shared_wow_transport *transport, LPVOID buf, DWORD size, DWORD timeout );
+    BOOL (*write)( struct shared_wow_transport *transport, LPCVOID buf, DWORD size );
+};
+
+extern BOOL shared_wow_write_hello( struct shared_wow_transport *transport ) DECLSPEC_HIDDEN;
+extern BOOL shared_wow_read_request( struct shared_wow_transport *transport, shared_wow_exec *exec_data,
+                                     LPSTR environment ) DECLSPEC_HIDDEN;
+extern BOOL shared_wow_write_reply( struct shared_wow_transport *transport, HINSTANCE16 instance ) DECLSPEC_HIDDEN;
+extern BOOL shared_wow_send_request( struct shared_wow_transport *transport, const shared_wow_exec *exec_data,
+                                     LPCSTR environment, DWORD environment_size, HINSTANCE16 *result ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_SHAREDWOW_H */
@@ -33,6 +33,7 @@
 #include "wine/debug.h"
 #include "resource.h"
 #include "windows.h"
+#include "sharedwow.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(winevdm);
 
@@ -511,7 +512,18 @@ static BOOL is_win32_exe(LPCSTR appname)
     CloseHandle(file);
     return FALSE;
 }
-static void exec16(LOADPARAMS16 params, LPCSTR appname, LPCSTR cmdline, BOOL exit)
+static void report_exec_error(LPCSTR appname, HINSTANCE16 instance)
+{
+    WINE_MESSAGE("winevdm: can't exec '%s': ", appname);
+    switch (instance)
+    {
+    case  2: WINE_MESSAGE("file not found\n"); break;
+    case 11: WINE_MESSAGE("invalid program file\n"); break;
+    default: WINE_MESSAGE("error=%d\n", instance); break;
+    }
+}
+
+static HINSTANCE16 exec16(LOADPARAMS16 params, LPCSTR appname, LPCSTR cmdline, BOOL exit)
 {
     char *p;
     HINSTANCE16 instance;
@@ -532,51 +544,31 @@ static void exec16(LOADPARAMS16 params, LPCSTR appname, LPCSTR cmdline, BOOL exi
             instance = GetLastError();
         }
 
-        WINE_MESSAGE("winevdm: can't exec '%s': ", appname);
-        switch (instance)
-        {
-        case  2: WINE_MESSAGE("file not found\n"); break;
-        case 11: WINE_MESSAGE("invalid program file\n"); break;
-        default: WINE_MESSAGE("error=%d\n", instance); break;
-        }
+        report_exec_error(appname, instance);
         if (exit)
             ExitProcess(instance);
     }
-
+    return instance;
 }
 
-#include <pshpack1.h>
-#define SHARED_WOW_CURDIR_SUPPORTED 1
-typedef struct {
-    WORD header;
-    WORD showCmd;
-    CHAR appname[MAX_PATH];
-    CHAR cmdline[MAX_PATH];
-    CHAR curdir[MAX_PATH];
-    /* environment variables... */
-} shared_wow_exec;
-#include <poppack.h>
-DWORD exec16_thread(LPVOID args)
+/* Shared WOW server, sharedwow.c has the protocol */
+#define SHARED_WOW_PIPE_NAME "\\\\.\\pipe\\otvdmpipe"
+#define SHARED_WOW_MAX_INSTANCES 8
+#define SHARED_WOW_MAX_LAUNCHERS 4
+
+struct shared_wow_pipe
 {
-    shared_wow_exec exec_data = *(shared_wow_exec*)args;
-    HeapFree(GetProcessHeap(), 0, args);
-    LOADPARAMS16 params;
-    WORD showCmd[2];
-    params.hEnvironment = 0;
-    params.reserved = 0;
-    if (exec_data.header == SHARED_WOW_CURDIR_SUPPORTED)
-    {
-        params.hEnvironment = 0x0bef;
-        params.reserved = &exec_data.curdir;
-    }
-    showCmd[0] = 2;
-    showCmd[1] = SW_SHOW;
+    HANDLE pipe;
+    OVERLAPPED connect;
+    BOOL pending;
+};
 
-    params.cmdLine = MapLS(exec_data.cmdline);
-    params.showCmd = MapLS(showCmd);
-    exec16(params, exec_data.appname, exec_data.cmdline, FALSE);
-    return 0;
-}
+static struct shared_wow_pipe shared_wow_pipes[SHARED_WOW_MAX_INSTANCES];
+/* connected instances waiting for a launcher */
+static struct shared_wow_pipe *shared_wow_queue[SHARED_WOW_MAX_INSTANCES];
+static int shared_wow_queue_head, shared_wow_queue_count;
+static HANDLE shared_wow_queue_sem;
+static CRITICAL_SECTION shared_wow_queue_cs;
 
 /* Returns TRUE if the pipe is pending. */
 static BOOL connect_new_client(HANDLE handle, LPOVERLAPPED lpov)
@@ -598,69 +590,240 @@ static BOOL connect_new_client(HANDLE handle, LPOVERLAPPED lpov)
     return FALSE;
 }
 
+static void shared_wow_listen(struct shared_wow_pipe *instance)
+{
+    DisconnectNamedPipe(instance->pipe);
+    instance->pending = connect_new_client(instance->pipe, &instance->connect);
+}
+
+/* overlapped read or write that gives up after timeout */
+static BOOL shared_wow_io(HANDLE pipe, HANDLE event, BOOL write, LPVOID buf, DWORD size, DWORD *done, DWORD timeout)
+{
+    OVERLAPPED ov = { 0 };
+    BOOL r;
+
+    *done = 0;
+    ov.hEvent = event;
+    r = write ? WriteFile(pipe, buf, size, NULL, &ov) : ReadFile(pipe, buf, size, NULL, &ov);
+    if (!r && GetLastError() != ERROR_IO_PENDING)
+        return FALSE;
+    if (WaitForSingleObject(event, timeout) != WAIT_OBJECT_0)
+    {
+        CancelIo(pipe);
+        GetOverlappedResult(pipe, &ov, done, TRUE);
+        return FALSE;
+    }
+    return GetOverlappedResult(pipe, &ov, done, TRUE);
+}
+
+/* shared_wow_transport over an overlapped pipe handle */
+struct shared_wow_pipe_transport
+{
+    struct shared_wow_transport transport;
+    HANDLE pipe;
+    HANDLE event;
+};
+
+static DWORD shared_wow_pipe_read(struct shared_wow_transport *transport, LPVOID buf, DWORD size, DWORD timeout)
+{
+    struct shared_wow_pipe_transport *p = CONTAINING_RECORD(transport, struct shared_wow_pipe_transport, transport);
+    DWORD done;
+
+    return shared_wow_io(p->pipe, p->event, FALSE, buf, size, &done, timeout) ? done : 0;
+}
+
+static BOOL shared_wow_pipe_write(struct shared_wow_transport *transport, LPCVOID buf, DWORD size)
+{
+    struct shared_wow_pipe_transport *p = CONTAINING_RECORD(transport, struct shared_wow_pipe_transport, transport);
+    DWORD done;
+
+    return shared_wow_io(p->pipe, p->event, TRUE, (LPVOID)buf, size, &done, SHARED_WOW_IO_TIMEOUT) && done == size;
+}
+
+static void shared_wow_pipe_transport_init(struct shared_wow_pipe_transport *p, HANDLE pipe, HANDLE event)
+{
+    p->transport.read = shared_wow_pipe_read;
+    p->transport.write = shared_wow_pipe_write;
+    p->pipe = pipe;
+    p->event = event;
+}
+
+static HINSTANCE16 shared_wow_launch(shared_wow_exec *exec_data, LPCSTR environment)
+{
+    LOADPARAMS16 params;
+    LOADPARAMS16_EXTRA extra;
+    WORD showCmd[2];
+    HINSTANCE16 instance;
+
+    params.hEnvironment = 0;
+    params.reserved = 0;
+    if (exec_data->header == SHARED_WOW_CURDIR_SUPPORTED)
+    {
+        params.hEnvironment = LOADPARAMS16_CURDIR;
+        params.reserved = (SEGPTR)exec_data->curdir;
+    }
+    else if (exec_data->header >= SHARED_WOW_REPLY_SUPPORTED)
+    {
+        extra.curdir = exec_data->curdir;
+        extra.environment = exec_data->environment_size ? environment : NULL;
+        params.hEnvironment = LOADPARAMS16_EXTENDED;
+        params.reserved = (SEGPTR)&extra;
+    }
+    showCmd[0] = 2;
+    showCmd[1] = SW_SHOW;
+
+    WINE_TRACE("%s %s\n", exec_data->appname, exec_data->cmdline);
+    params.cmdLine = MapLS(exec_data->cmdline);
+    params.showCmd = MapLS(showCmd);
+    instance = exec16(params, exec_data->appname, exec_data->cmdline, FALSE);
+    UnMapLS(params.cmdLine);
+    UnMapLS(params.showCmd);
+    return instance;
+}
+
+static DWORD WINAPI shared_wow_launcher(LPVOID args)
+{
+    HANDLE event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    LPSTR environment = HeapAlloc(GetProcessHeap(), 0, SHARED_WOW_MAX_ENVIRONMENT + 2);
+
+    if (!event || !environment)
+        return 1;
+    while (TRUE)
+    {
+        struct shared_wow_pipe *instance;
+        struct shared_wow_pipe_transport transport;
+        shared_wow_exec exec_data;
+
+        WaitForSingleObject(shared_wow_queue_sem, INFINITE);
+        EnterCriticalSection(&shared_wow_queue_cs);
+        instance = shared_wow_queue[shared_wow_queue_head];
+        shared_wow_queue_head = (shared_wow_queue_head + 1) % SHARED_WOW_MAX_INSTANCES;
+        shared_wow_queue_count--;
+        LeaveCriticalSection(&shared_wow_queue_cs);
+
+        shared_wow_pipe_transport_init(&transport, instance->pipe, event);
+        /* clients that predate the hello never read it, the pipe buffers it */
+        shared_wow_write_hello(&transport.transport);
+        if (shared_wow_read_request(&transport.transport, &exec_data, environment))
+        {
+            /* LoadModule16 blocks thread */
+            HINSTANCE16 result = shared_wow_launch(&exec_data, environment);
+            if (exec_data.header >= SHARED_WOW_REPLY_SUPPORTED)
+                shared_wow_write_reply(&transport.transport, result);
+        }
+        else
+        {
+            WINE_WARN("malformed shared WOW request\n");
+        }
+        shared_wow_listen(instance);
+    }
+    return 0;
+}
+
 /* \\.\pipe\otvdmpipe */
 HANDLE run_shared_wow_server()
 {
-    OVERLAPPED overlapped = { 0 };
-    BOOL pending;
-    HANDLE server = CreateNamedPipeA("\\\\.\\pipe\\otvdmpipe", PIPE_ACCESS_INBOUND | PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED, PIPE_TYPE_BYTE | PIPE_WAIT, 10, 0, 0, 1000, NULL);
-    HANDLE event = CreateEventA(NULL, TRUE, TRUE, NULL);
-    overlapped.hEvent = event;
-    pending = connect_new_client(server, &overlapped);
+    HANDLE handles[SHARED_WOW_MAX_INSTANCES];
+    DWORD count = 0;
+    int i;
+
+    InitializeCriticalSection(&shared_wow_queue_cs);
+    shared_wow_queue_sem = CreateSemaphoreA(NULL, 0, SHARED_WOW_MAX_INSTANCES, NULL);
+    for (i = 0; i < SHARED_WOW_MAX_INSTANCES; i++)
+    {
+        struct shared_wow_pipe *instance = &shared_wow_pipes[count];
+        instance->pipe = CreateNamedPipeA(SHARED_WOW_PIPE_NAME, PIPE_ACCESS_INBOUND | PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED, PIPE_TYPE_BYTE | PIPE_WAIT, SHARED_WOW_MAX_INSTANCES, 0x100, 0, 1000, NULL);
+        if (instance->pipe == INVALID_HANDLE_VALUE)
+            break;
+        instance->connect.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+        instance->pending = connect_new_client(instance->pipe, &instance->connect);
+        handles[count++] = instance->connect.hEvent;
+    }
+    for (i = 0; count && i < SHARED_WOW_MAX_LAUNCHERS; i++)
+    {
+        HANDLE hThread = CreateThread(NULL, 0, shared_wow_launcher, NULL, 0, NULL);
+        CloseHandle(hThread);
+    }
     while (TRUE)
     {
-        HANDLE handles[1] = { overlapped.hEvent };
         MSG msg;
-        DWORD ret = MsgWaitForMultipleObjects(1, handles, FALSE, INFINITE, QS_ALLINPUT);
+        DWORD ret = MsgWaitForMultipleObjects(count, handles, FALSE, INFINITE, QS_ALLINPUT);
 
-        if (ret == WAIT_OBJECT_0 + 1 && PeekMessageA(&msg, NULL, 0, 0, TRUE))
+        if (ret == WAIT_OBJECT_0 + count)
         {
-            TranslateMessage(&msg);
-            DispatchMessageA(&msg);
+            while (PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&msg);
+                DispatchMessageA(&msg);
+            }
         }
-        else if (pending)
+        else if (ret < WAIT_OBJECT_0 + count)
         {
-            DWORD read;
-            shared_wow_exec exec_data = { 0 };
-            BOOL r = ReadFile(server, &exec_data, sizeof(exec_data), &read, NULL);
-            DisconnectNamedPipe(server);
-            if (r)
+            struct shared_wow_pipe *instance = &shared_wow_pipes[ret - WAIT_OBJECT_0];
+            DWORD dummy;
+
+            /* the launcher rearms the instance once it is done with the client */
+            ResetEvent(instance->connect.hEvent);
+            if (instance->pending && !GetOverlappedResult(instance->pipe, &instance->connect, &dummy, FALSE))
             {
-                WINE_TRACE("%s %s\n", exec_data.appname, exec_data.cmdline);
-                LPVOID data = HeapAlloc(GetProcessHeap(), 0, sizeof(exec_data));
-                memcpy(data, &exec_data, sizeof(exec_data));
-                /* LoadModule16 blocks thread */
-                HANDLE hThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)exec16_thread, data, 0, NULL);
-                CloseHandle(hThread);
+                shared_wow_listen(instance);
+                continue;
             }
-            pending = connect_new_client(server, &overlapped);
+            EnterCriticalSection(&shared_wow_queue_cs);
+            shared_wow_queue[(shared_wow_queue_head + shared_wow_queue_count) % SHARED_WOW_MAX_INSTANCES] = instance;
+            shared_wow_queue_count++;
+            LeaveCriticalSection(&shared_wow_queue_cs);
+            ReleaseSemaphore(shared_wow_queue_sem, 1, NULL);
         }
     }
 }
 
-BOOL run_shared_wow(LPCSTR appname, WORD showCmd, LPCSTR cmdline)
+/* Returns TRUE if the shared WOW server handled the request, *result receives the launch result. */
+BOOL run_shared_wow(LPCSTR appname, WORD showCmd, LPCSTR cmdline, HINSTANCE16 *result)
 {
     ULONG pid;
-    HANDLE client = CreateFileA("\\\\.\\pipe\\otvdmpipe", GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    HANDLE client, event;
     BOOL (WINAPI *pGetNamedPipeServerProcessId)(HANDLE, PULONG) = (BOOL(WINAPI *)(HANDLE, PULONG))GetProcAddress(GetModuleHandleA("kernel32"), "GetNamedPipeServerProcessId");
-    if (client == INVALID_HANDLE_VALUE)
+    struct shared_wow_pipe_transport transport;
+    shared_wow_exec exec_data = { 0 };
+    LPSTR env, p;
+    DWORD env_size = 0;
+    BOOL ret;
+
+    while (TRUE)
     {
-        return FALSE;
+        client = CreateFileA(SHARED_WOW_PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+        if (client != INVALID_HANDLE_VALUE)
+            break;
+        /* all instances are connected to other launches */
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(SHARED_WOW_PIPE_NAME, SHARED_WOW_IO_TIMEOUT))
+            return FALSE;
     }
     if (pGetNamedPipeServerProcessId && pGetNamedPipeServerProcessId(client, &pid))
     {
         AllowSetForegroundWindow(pid);
     }
-    shared_wow_exec exec_data = { 0 };
-    exec_data.header = SHARED_WOW_CURDIR_SUPPORTED;
+    if (!(event = CreateEventA(NULL, TRUE, FALSE, NULL)))
+    {
+        CloseHandle(client);
+        return FALSE;
+    }
+
     exec_data.showCmd = showCmd;
     lstrcpynA(exec_data.cmdline, cmdline, MAX_PATH);
     lstrcpynA(exec_data.appname, appname, MAX_PATH);
     GetCurrentDirectoryA(MAX_PATH, exec_data.curdir);
-    WriteFile(client, &exec_data, sizeof(exec_data), NULL, NULL);
+    env = GetEnvironmentStringsA();
+    for (p = env; p && *p; p += strlen(p) + 1);
+    if (p)
+        env_size = p - env + 1;
+
+    shared_wow_pipe_transport_init(&transport, client, event);
+    ret = shared_wow_send_request(&transport.transport, &exec_data, env, env_size, result);
+    FreeEnvironmentStringsA(env);
+    CloseHandle(event);
     CloseHandle(client);
-    return TRUE;
-
+    return ret;
 }
 
 /***********************************************************************
@@ -683,6 +846,7 @@ int entry_point( int argc, char *argv[] )
     char **argv_copy = HeapAlloc(GetProcessHeap(), 0, sizeof(*argv) * (argc + 1));
     BOOL compat_success = set_peb_compatible_flag();
     BOOL use_shared_wow_server;
+    HINSTANCE16 shared_result;
 #ifdef __CI_VERSION
 #define STR(x) #x
 #define STRSTR(x) STR(x)
@@ -870,8 +1034,13 @@ int entry_point( int argc, char *argv[] )
     params.hEnvironment = 0;
 
     use_shared_wow_server = !krnl386_get_config_int("otvdm", "SeparateWOWVDM", TRUE);
-    if (use_shared_wow_server && run_shared_wow(appname, showCmd[1], cmdline))
+    if (use_shared_wow_server && run_shared_wow(appname, showCmd[1], cmdline, &shared_result))
     {
+        if (shared_result < 32)
+        {
+            report_exec_error(appname, shared_result);
+            return shared_result;
+        }
         return 0;
     }
 
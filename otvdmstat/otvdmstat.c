@@ -0,0 +1,152 @@
+/*
+ * otvdmstat - print the runtime statistics of a running otvdm
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * usage: otvdmstat <pid> [interval]   read the live block of a process (Windows)
+ *        otvdmstat <pid> -o <file>    save a copy of the live block (Windows)
+ *        otvdmstat -f <file>          decode a saved block (any host)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "otvdmstats.h"
+
+static void print_stats( const struct otvdm_stats *stats )
+{
+    unsigned int i;
+
+    printf( "pid %u, version %u, update %u at tick %llu\n", stats->pid, stats->version,
+            stats->update_count, (unsigned long long)stats->update_tick );
+    printf( "ldt:      %u/%u selectors used, largest free run %u\n",
+            stats->ldt_used, stats->ldt_max, stats->ldt_largest_free_run );
+    printf( "handles:  %u user, %u gdi of %u\n",
+            stats->user_handles, stats->gdi_handles, stats->handle_table_max );
+    printf( "calls:    %llu from 16-bit, %llu to 16-bit\n",
+            (unsigned long long)stats->calls_from_16, (unsigned long long)stats->calls_to_16 );
+    printf( "win16lock: %llu acquisitions, %llu us held, max %u us, held now %u us\n",
+            (unsigned long long)stats->win16_lock_acquisitions,
+            (unsigned long long)stats->win16_lock_hold_total,
+            stats->win16_lock_hold_max, stats->win16_lock_held );
+    if (!stats->heaps_valid)
+    {
+        printf( "heaps:    not sampled, the Win16Mutex was busy\n" );
+        return;
+    }
+    printf( "tasks:    %u\n", stats->task_count );
+    printf( "global:   %u/%u arena entries, %u bytes, %u bytes discardable, %u discarded, %u locked\n",
+            stats->global_arena_used, stats->global_arena_max, stats->global_bytes,
+            stats->global_discardable_bytes, stats->global_discarded_blocks, stats->global_locked_blocks );
+    for (i = 0; i < stats->local_heap_count; i++)
+    {
+        const struct otvdm_stats_local_heap *heap = &stats->local_heaps[i];
+        printf( "local:    %-8.*s ds %04x size %5u free %5u largest %5u in %u blocks, handles %u/%u free\n",
+                (int)sizeof(heap->name), heap->name, heap->ds, heap->size, heap->free,
+                heap->largest_free, heap->free_blocks, heap->free_handles, heap->items );
+    }
+}
+
+static int read_file( const char *path )
+{
+    struct otvdm_stats block, stats;
+    size_t size;
+    FILE *file = fopen( path, "rb" );
+
+    if (!file)
+    {
+        perror( path );
+        return 1;
+    }
+    size = fread( &block, 1, sizeof(block), file );
+    fclose( file );
+    if (!otvdm_stats_snapshot( &block, size, &stats ))
+    {
+        fprintf( stderr, "%s: not an otvdm statistics block\n", path );
+        return 1;
+    }
+    print_stats( &stats );
+    return 0;
+}
+
+#ifdef _WIN32
+static int read_process( unsigned int pid, unsigned int interval, const char *output )
+{
+    struct otvdm_stats stats;
+    char name[64];
+    HANDLE mapping;
+    const void *block;
+
+    sprintf( name, OTVDM_STATS_SECTION_FORMAT, pid );
+    mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, name );
+    if (!mapping)
+    {
+        fprintf( stderr, "%s: not found (%lu), is StatsInterval 0?\n", name, GetLastError() );
+        return 1;
+    }
+    block = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( mapping );
+    if (!block)
+    {
+        fprintf( stderr, "%s: cannot map (%lu)\n", name, GetLastError() );
+        return 1;
+    }
+
+    for (;;)
+    {
+        if (!otvdm_stats_snapshot( block, sizeof(stats), &stats ))
+        {
+            fprintf( stderr, "%s: no consistent snapshot\n", name );
+            return 1;
+        }
+        if (output)
+        {
+            FILE *file = fopen( output, "wb" );
+            if (!file || fwrite( &stats, sizeof(stats), 1, file ) != 1)
+            {
+                perror( output );
+                return 1;
+            }
+            fclose( file );
+            return 0;
+        }
+        print_stats( &stats );
+        if (!interval) return 0;
+        printf( "\n" );
+        fflush( stdout );
+        Sleep( interval * 1000 );
+    }
+}
+#endif
+
+int main( int argc, char *argv[] )
+{
+    if (argc == 3 && !strcmp( argv[1], "-f" )) return read_file( argv[2] );
+#ifdef _WIN32
+    if (argc == 4 && !strcmp( argv[2], "-o" )) return read_process( strtoul( argv[1], NULL, 0 ), 0, argv[3] );
+    if (argc == 2 || argc == 3)
+        return read_process( strtoul( argv[1], NULL, 0 ), argc == 3 ? strtoul( argv[2], NULL, 0 ) : 0, NULL );
+    fprintf( stderr, "usage: otvdmstat <pid> [interval] | <pid> -o <file> | -f <file>\n" );
+#else
+    fprintf( stderr, "usage: otvdmstat -f <file>\n" );
+#endif
+    return 2;
+}
@@ -0,0 +1,68 @@
+/*
+ * Reader of the otvdm runtime statistics block
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <string.h>
+
+#include "otvdmstats.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define read_barrier() _ReadWriteBarrier()
+#else
+#define read_barrier() __sync_synchronize()
+#endif
+
+#define SNAPSHOT_RETRIES 100
+
+/***********************************************************************
+ *           otvdm_stats_snapshot
+ *
+ * Copy a consistent snapshot of the statistics block at 'block', which
+ * may be written concurrently by otvdm. Fields that the writer does not
+ * know about are returned as zero. Returns 0 if the block is not valid
+ * or no consistent copy could be made.
+ */
+int otvdm_stats_snapshot( const volatile void *block, size_t block_size, struct otvdm_stats *out )
+{
+    const volatile struct otvdm_stats *stats = block;
+    uint32_t sequence;
+    size_t size;
+    int i;
+
+    if (block_size < offsetof(struct otvdm_stats, update_tick)) return 0;
+
+    for (i = 0; i < SNAPSHOT_RETRIES; i++)
+    {
+        sequence = stats->sequence;
+        if (sequence & 1) continue;
+        read_barrier();
+        size = stats->size;
+        if (size > block_size) size = block_size;
+        if (size > sizeof(*out)) size = sizeof(*out);
+        memset( out, 0, sizeof(*out) );
+        memcpy( out, (const void *)stats, size );
+        read_barrier();
+        if (stats->sequence != sequence) continue;
+
+        if (out->magic != OTVDM_STATS_MAGIC || !out->version || size < offsetof(struct otvdm_stats, update_tick))
+            return 0;
+        if (out->local_heap_count > OTVDM_STATS_MAX_HEAPS) out->local_heap_count = OTVDM_STATS_MAX_HEAPS;
+        return 1;
+    }
+    return 0;
+}
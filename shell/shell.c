@@ -271,7 +271,82 @@ __declspec(dllimport) HICON NE_ExtractIcon(LPCSTR lpszExeFileName,
 	UINT cyDesired,
 	UINT *pIconId,
 	UINT flags);
-static inline UINT PrivateExtractIconsNE(
+/* Remembers which extractor handles an icon file and how many icons it has,
+ * keyed by path, size and write time: the PE extractor fails every time on
+ * NE files, and Progman counts the icons of every item before extracting
+ * them. Callers hold the Win16 lock. */
+enum icon_file_format
+{
+    ICON_FILE_UNKNOWN,
+    ICON_FILE_PE,
+    ICON_FILE_NE
+};
+
+struct icon_file
+{
+    struct icon_file *next;
+    char      path[MAX_PATH];
+    DWORD     size;
+    FILETIME  mtime;
+    enum icon_file_format format;
+    UINT      count;            /* number of icons, ~0u if not known yet */
+};
+
+#define ICON_FILE_CACHE_SIZE 32
+
+static struct icon_file *icon_files;
+
+static struct icon_file *get_icon_file(LPCSTR name)
+{
+    char path[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    struct icon_file **prev, *file;
+    DWORD len;
+    int count;
+
+    len = SearchPathA(NULL, name, NULL, sizeof(path), path, NULL);
+    if (!len || len >= sizeof(path)) return NULL;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attr)) return NULL;
+
+    for (prev = &icon_files; (file = *prev); prev = &file->next)
+    {
+        if (lstrcmpiA(file->path, path)) continue;
+        *prev = file->next;
+        if (file->size != attr.nFileSizeLow || CompareFileTime(&file->mtime, &attr.ftLastWriteTime))
+        {
+            file->format = ICON_FILE_UNKNOWN;
+            file->count = ~0u;
+        }
+        break;
+    }
+    if (!file)
+    {
+        if (!(file = HeapAlloc(GetProcessHeap(), 0, sizeof(*file)))) return NULL;
+        strcpy(file->path, path);
+        file->format = ICON_FILE_UNKNOWN;
+        file->count = ~0u;
+    }
+    file->size = attr.nFileSizeLow;
+    file->mtime = attr.ftLastWriteTime;
+    file->next = icon_files;
+    icon_files = file;
+
+    for (prev = &icon_files, count = 0; *prev; count++)
+    {
+        struct icon_file *old = *prev;
+
+        if (count < ICON_FILE_CACHE_SIZE)
+        {
+            prev = &old->next;
+            continue;
+        }
+        *prev = old->next;
+        HeapFree(GetProcessHeap(), 0, old);
+    }
+    return file;
+}
+
+static UINT PrivateExtractIconsNE(
 	LPCSTR lpwstrFile,
 	int nIndex,
 	int sizeX,
@@ -281,9 +356,24 @@ static inline UINT PrivateExtractIconsNE(
 	UINT nIcons,    /* [in] number of icons to retrieve */
 	UINT flags)    /* [in] LR_* flags used by LoadImage */
 {
-	HICON ret;
-	return (ret = PrivateExtractIconsA(lpwstrFile, nIndex, sizeX, sizeY, phicon, pIconId, nIcons, flags))
-		? ret : NE_ExtractIcon(lpwstrFile, phicon, nIndex, nIcons, sizeX, sizeY, pIconId, flags);
+	struct icon_file *file = get_icon_file(lpwstrFile);
+	UINT ret = 0;
+
+	if (file && !nIcons && file->count != ~0u)
+		return file->count;
+	if (!file || file->format != ICON_FILE_NE)
+	{
+		ret = PrivateExtractIconsA(lpwstrFile, nIndex, sizeX, sizeY, phicon, pIconId, nIcons, flags);
+		if (file && ret && ret != ~0u) file->format = ICON_FILE_PE;
+	}
+	if (!ret && (!file || file->format != ICON_FILE_PE))
+	{
+		ret = (UINT)NE_ExtractIcon(lpwstrFile, phicon, nIndex, nIcons, sizeX, sizeY, pIconId, flags);
+		if (file && ret && ret != ~0u) file->format = ICON_FILE_NE;
+	}
+	if (file && !nIcons && ret != ~0u)
+		file->count = ret;
+	return ret;
 }
 /*************************************************************************
  *			InternalExtractIcon		[SHELL.39]
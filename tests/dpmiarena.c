@@ -0,0 +1,331 @@
+/*
+ * Stress test of the DPMI memory arena (krnl386/dpmimem.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "dosexe.h"
+#include "test.h"
+
+/*
+ * Fake address space: one inaccessible mapping that VirtualAlloc hands
+ * out in 16MB reservations. Committed pages are made accessible, so
+ * using memory that isn't committed crashes the test.
+ */
+#define PAGE_SIZE    0x1000
+#define CHUNK_SIZE   (16 * 1024 * 1024)
+#define POOL_CHUNKS  4
+#define POOL_SIZE    (POOL_CHUNKS * CHUNK_SIZE)
+#define ARENA_MB     48
+
+static BYTE *pool;
+static BOOL reserved[POOL_CHUNKS];
+static BYTE committed[POOL_SIZE / PAGE_SIZE];
+static unsigned int committed_pages;
+
+HANDLE test_process_heap = (HANDLE)1;
+
+static void init_pool(void)
+{
+    BYTE *map = mmap( NULL, POOL_SIZE + 0x10000, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+    ok( map != MAP_FAILED, "mmap failed\n" );
+    if (map == MAP_FAILED) exit( 1 );
+    pool = (BYTE *)(((ULONG_PTR)map + 0xffff) & ~(ULONG_PTR)0xffff);
+}
+
+/* index of the chunk holding [addr, addr + size), -1 if it straddles chunks */
+static int chunk_of( const BYTE *addr, SIZE_T size )
+{
+    SIZE_T first = (addr - pool) / CHUNK_SIZE, last = (addr + size - 1 - pool) / CHUNK_SIZE;
+
+    if (addr < pool || addr + size > pool + POOL_SIZE || first != last) return -1;
+    return first;
+}
+
+LPVOID WINAPI VirtualAlloc( LPVOID addr, SIZE_T size, DWORD type, DWORD protect )
+{
+    BYTE *ptr = addr;
+    int chunk;
+    SIZE_T i;
+
+    if (type & MEM_RESERVE)
+    {
+        if (!ptr) ptr = pool;
+        chunk = chunk_of( ptr, size );
+        ok( size == CHUNK_SIZE && (ptr - pool) % CHUNK_SIZE == 0, "reserve of %lx bytes at %p\n", (unsigned long)size, ptr );
+        if (chunk < 0 || reserved[chunk]) return NULL;
+        reserved[chunk] = TRUE;
+        return ptr;
+    }
+
+    chunk = chunk_of( ptr, size );
+    ok( chunk >= 0 && reserved[chunk], "commit of %lx bytes at %p outside of a reservation\n", (unsigned long)size, ptr );
+    ok( (ptr - pool) % PAGE_SIZE == 0 && size % PAGE_SIZE == 0, "unaligned commit %p %lx\n", ptr, (unsigned long)size );
+    if (chunk < 0 || !reserved[chunk]) return NULL;
+    mprotect( ptr, size, PROT_READ | PROT_WRITE );
+    for (i = 0; i < size / PAGE_SIZE; i++)
+    {
+        BYTE *page = &committed[(ptr - pool) / PAGE_SIZE + i];
+        if (!*page) committed_pages++;
+        *page = 1;
+    }
+    return ptr;
+}
+
+BOOL WINAPI VirtualFree( LPVOID addr, SIZE_T size, DWORD type )
+{
+    BYTE *ptr = addr;
+    int chunk;
+    SIZE_T i;
+
+    if (type == MEM_RELEASE)
+    {
+        ok( chunk_of( ptr, CHUNK_SIZE ) >= 0, "release of %p\n", ptr );
+        reserved[chunk_of( ptr, CHUNK_SIZE )] = FALSE;
+        return TRUE;
+    }
+    chunk = chunk_of( ptr, size );
+    ok( chunk >= 0 && reserved[chunk], "decommit of %lx bytes at %p outside of a reservation\n", (unsigned long)size, ptr );
+    if (chunk < 0) return FALSE;
+    mprotect( ptr, size, PROT_NONE );
+    madvise( ptr, size, MADV_DONTNEED );
+    for (i = 0; i < size / PAGE_SIZE; i++)
+    {
+        BYTE *page = &committed[(ptr - pool) / PAGE_SIZE + i];
+        if (*page) committed_pages--;
+        *page = 0;
+    }
+    return TRUE;
+}
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size ) { return malloc( size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+DWORD WINAPI krnl386_get_config_int( LPCSTR appname, LPCSTR keyname, INT def ) { return ARENA_MB; }
+
+
+/*
+ * Blocks the test owns. Each page starts with a tag derived from the
+ * block, so that moves and resizes that lose data are noticed.
+ */
+#define MAX_BLOCKS 64
+
+static struct
+{
+    BYTE *ptr;
+    DWORD size;
+    DWORD tag;
+} blocks[MAX_BLOCKS];
+
+static DWORD page_count( DWORD size )
+{
+    return (size + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+static void tag_block( unsigned int i )
+{
+    DWORD page;
+
+    for (page = 0; page < page_count( blocks[i].size ); page++)
+        *(DWORD *)(blocks[i].ptr + page * PAGE_SIZE) = blocks[i].tag + page;
+}
+
+static void check_block( unsigned int i, DWORD size, const char *when )
+{
+    DWORD page;
+
+    for (page = 0; page < page_count( size ); page++)
+        if (*(DWORD *)(blocks[i].ptr + page * PAGE_SIZE) != blocks[i].tag + page) break;
+    ok( page == page_count( size ), "%s: block %u lost page %u\n", when, i, page );
+}
+
+static void check_arena( const char *when )
+{
+    DWORD largest, free, total, used = 0;
+    unsigned int i;
+
+    for (i = 0; i < MAX_BLOCKS; i++)
+    {
+        if (!blocks[i].ptr) continue;
+        used += page_count( blocks[i].size ) * PAGE_SIZE;
+        ok( DPMI_ArenaBlockSize( blocks[i].ptr ) == page_count( blocks[i].size ) * PAGE_SIZE,
+            "%s: block %u has size %x, expected %x\n", when, i, DPMI_ArenaBlockSize( blocks[i].ptr ), blocks[i].size );
+        check_block( i, blocks[i].size, when );
+    }
+    ok( committed_pages * PAGE_SIZE == used, "%s: %x bytes committed, %x used\n", when, committed_pages * PAGE_SIZE, used );
+    ok( DPMI_ArenaGetFreeInfo( &largest, &free, &total ), "%s: no free info\n", when );
+    ok( total == ARENA_MB * 1024 * 1024, "%s: total %x\n", when, total );
+    ok( free + used == total, "%s: free %x + used %x != total %x\n", when, free, used, total );
+    ok( largest <= free, "%s: largest %x > free %x\n", when, largest, free );
+}
+
+static void alloc_block( unsigned int i, DWORD size )
+{
+    blocks[i].ptr = DPMI_ArenaAlloc( size );
+    blocks[i].size = size;
+    blocks[i].tag = test_rand() << 16;
+    if (blocks[i].ptr) tag_block( i );
+}
+
+static void free_block( unsigned int i )
+{
+    ok( DPMI_ArenaFree( blocks[i].ptr ), "block %u not freed\n", i );
+    blocks[i].ptr = NULL;
+}
+
+static void free_all_blocks(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_BLOCKS; i++)
+        if (blocks[i].ptr) free_block( i );
+}
+
+/* blocks start on 64k boundaries at growing addresses, freed holes are skipped */
+static void test_monotonic(void)
+{
+    BYTE *last = NULL;
+    unsigned int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        alloc_block( i, 1 + test_rand() % 0x30000 );
+        ok( blocks[i].ptr != NULL, "block %u not allocated\n", i );
+        ok( ((blocks[i].ptr - pool) & 0xffff) == 0, "block %u at %p isn't 64k aligned\n", i, blocks[i].ptr );
+        ok( blocks[i].ptr > last, "block %u at %p below %p\n", i, blocks[i].ptr, last );
+        last = blocks[i].ptr;
+    }
+    for (i = 0; i < 16; i += 2) free_block( i );
+    alloc_block( 16, 0x1000 );
+    ok( blocks[16].ptr > last, "block reused a hole at %p below %p\n", blocks[16].ptr, last );
+    check_arena( "monotonic" );
+    free_all_blocks();
+    check_arena( "monotonic freed" );
+}
+
+/* a block grows into the free space behind it without moving */
+static void test_resize_in_place(void)
+{
+    BYTE *ptr;
+
+    alloc_block( 0, 0x10000 );
+    alloc_block( 1, 0x40000 );
+    alloc_block( 2, 0x10000 );
+    free_block( 1 );
+
+    ptr = DPMI_ArenaReAlloc( blocks[0].ptr, 0x50000 );
+    ok( ptr == blocks[0].ptr, "block moved from %p to %p\n", blocks[0].ptr, ptr );
+    check_block( 0, blocks[0].size, "grown" );
+    blocks[0].size = 0x50000;
+    tag_block( 0 );
+    check_arena( "grown" );
+
+    ptr = DPMI_ArenaReAlloc( blocks[0].ptr, 0x60000 );
+    ok( ptr != NULL && ptr != blocks[0].ptr, "block didn't move: %p\n", ptr );
+    blocks[0].ptr = ptr;
+    check_block( 0, 0x50000, "moved" );
+    blocks[0].size = 0x60000;
+    tag_block( 0 );
+
+    ptr = DPMI_ArenaReAlloc( blocks[0].ptr, 0x2000 );
+    ok( ptr == blocks[0].ptr, "block moved from %p to %p on shrink\n", blocks[0].ptr, ptr );
+    blocks[0].size = 0x2000;
+    check_arena( "shrunk" );
+
+    /* the moved block is the topmost one, it grows with the arena */
+    ptr = DPMI_ArenaReAlloc( blocks[0].ptr, 2 * CHUNK_SIZE );
+    ok( ptr == blocks[0].ptr, "top block moved from %p to %p\n", blocks[0].ptr, ptr );
+    check_block( 0, blocks[0].size, "top grown" );
+    blocks[0].size = 2 * CHUNK_SIZE;
+    tag_block( 0 );
+    check_arena( "top grown" );
+
+    free_all_blocks();
+    check_arena( "resize freed" );
+}
+
+/* the arena doesn't grow past DPMIArenaSize; once its top is used up old holes are reused */
+static void test_limit(void)
+{
+    DWORD largest, free, total;
+    unsigned int count;
+
+    ok( DPMI_ArenaAlloc( ARENA_MB * 1024 * 1024 + 1 ) == NULL, "allocated more than the arena\n" );
+    for (count = 0; count < MAX_BLOCKS; count++)
+    {
+        alloc_block( count, 0x100000 );
+        if (!blocks[count].ptr) break;
+    }
+    /* the space below where the previous tests left the cursor may not fit a whole block */
+    ok( count == ARENA_MB || count == ARENA_MB - 1, "%u 1MB blocks allocated\n", count );
+    DPMI_ArenaGetFreeInfo( &largest, &free, &total );
+    ok( largest < 0x100000, "full arena reports %x largest free block\n", largest );
+
+    free_block( 3 );
+    DPMI_ArenaGetFreeInfo( &largest, &free, &total );
+    ok( largest >= 0x100000 && free >= 0x100000, "%x free, %x largest\n", free, largest );
+    alloc_block( count, 0x100000 );
+    ok( blocks[count].ptr != NULL, "hole not reused\n" );
+    check_arena( "limit" );
+
+    free_all_blocks();
+    check_arena( "limit freed" );
+    DPMI_ArenaGetFreeInfo( &largest, &free, &total );
+    ok( largest == total, "largest free block %x of %x\n", largest, total );
+}
+
+/* random allocations, resizes and frees */
+static void test_random_operations(void)
+{
+    unsigned int op;
+
+    for (op = 0; op < 20000; op++)
+    {
+        unsigned int i = test_rand() % MAX_BLOCKS;
+        DWORD size = 1 + (test_rand() << 4 | test_rand() % 16) % ((test_rand() % 8) ? 0x20000 : 0x200000);
+
+        if (!blocks[i].ptr) alloc_block( i, size );
+        else if (test_rand() % 2)
+        {
+            BYTE *ptr = DPMI_ArenaReAlloc( blocks[i].ptr, size );
+            if (!ptr) continue;
+            blocks[i].ptr = ptr;
+            check_block( i, min( blocks[i].size, size ), "realloc" );
+            blocks[i].size = size;
+            tag_block( i );
+        }
+        else free_block( i );
+        if (op % 101 == 0) check_arena( "random" );
+    }
+    check_arena( "random end" );
+    free_all_blocks();
+    check_arena( "random freed" );
+}
+
+int main(void)
+{
+    init_pool();
+    test_monotonic();
+    test_resize_in_place();
+    test_limit();
+    test_random_operations();
+    ok( !DPMI_IsArenaPtr( pool + ARENA_MB * 1024 * 1024 ), "pointer above the arena\n" );
+    return test_summary( "dpmiarena" );
+}
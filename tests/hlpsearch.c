@@ -0,0 +1,797 @@
+/*
+ * Tests of the WinHelp full text search (winhlp32/search.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <wctype.h>
+#include "windows.h"
+#include "windef.h"
+#include "winbase.h"
+#include "winhelp.h"
+#include "test.h"
+
+/*
+ * Fake host: an in-memory file system holding the help files and the
+ * index cache files, with counters of the handles and mapped views the
+ * code leaves open.
+ */
+#define MAX_FILES    8
+#define MAX_HANDLES  16
+
+static const char sample_path[] = "C:\\HELP\\SAMPLE.HLP";
+static const char temp_dir[] = "C:\\TEMP\\";
+
+static struct fake_file
+{
+    char  path[MAX_PATH];
+    BYTE *data;
+    DWORD size;
+} files[MAX_FILES];
+
+static struct fake_handle
+{
+    struct fake_file *file;     /* NULL for a mapping */
+    DWORD pos;
+    BYTE *view;                 /* mapping: copy of the file when it was mapped */
+} handles[MAX_HANDLES];
+
+static unsigned int open_handles, mapped_views;
+static BOOL no_temp_path;
+static DWORD tick;
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return (flags & HEAP_ZERO_MEMORY) ? calloc( 1, size ) : malloc( size );
+}
+
+LPVOID WINAPI HeapReAlloc( HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size )
+{
+    return realloc( ptr, size );
+}
+
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+static struct fake_file *get_fake_file( LPCSTR path )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_FILES; i++) if (files[i].data && !strcasecmp( files[i].path, path )) return &files[i];
+    return NULL;
+}
+
+static struct fake_file *set_fake_file( LPCSTR path, const void *data, DWORD size )
+{
+    struct fake_file *file = get_fake_file( path );
+    unsigned int i;
+
+    for (i = 0; !file && i < MAX_FILES; i++) if (!files[i].data) file = &files[i];
+    strcpy( file->path, path );
+    free( file->data );
+    file->data = malloc( size + 1 );
+    memcpy( file->data, data, size );
+    file->size = size;
+    return file;
+}
+
+static void delete_fake_file( LPCSTR path )
+{
+    struct fake_file *file = get_fake_file( path );
+
+    if (!file) return;
+    free( file->data );
+    file->data = NULL;
+}
+
+static unsigned int fake_file_count(void)
+{
+    unsigned int i, count = 0;
+
+    for (i = 0; i < MAX_FILES; i++) if (files[i].data) count++;
+    return count;
+}
+
+static struct fake_handle *alloc_handle( struct fake_file *file )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_HANDLES; i++)
+    {
+        if (handles[i].file || handles[i].view) continue;
+        handles[i].file = file;
+        handles[i].pos = 0;
+        open_handles++;
+        return &handles[i];
+    }
+    return NULL;
+}
+
+static struct fake_handle *get_handle( HANDLE handle )
+{
+    ULONG_PTR i = (ULONG_PTR)handle - 1;
+
+    return i < MAX_HANDLES && (handles[i].file || handles[i].view) ? &handles[i] : NULL;
+}
+
+#define HANDLE_OF(h) ((HANDLE)(ULONG_PTR)((h) - handles + 1))
+
+HANDLE WINAPI CreateFileA( LPCSTR name, DWORD access, DWORD sharing, LPSECURITY_ATTRIBUTES sa,
+                           DWORD creation, DWORD attributes, HANDLE template )
+{
+    struct fake_file *file = get_fake_file( name );
+    struct fake_handle *h;
+
+    if (creation == CREATE_ALWAYS) file = set_fake_file( name, "", 0 );
+    if (!file || !(h = alloc_handle( file ))) return INVALID_HANDLE_VALUE;
+    return HANDLE_OF(h);
+}
+
+DWORD WINAPI GetFileSize( HANDLE handle, LPDWORD high )
+{
+    struct fake_handle *h = get_handle( handle );
+
+    if (!h || !h->file) return INVALID_FILE_SIZE;
+    if (high) *high = 0;
+    return h->file->size;
+}
+
+BOOL WINAPI ReadFile( HANDLE handle, LPVOID buffer, DWORD count, LPDWORD read, LPOVERLAPPED overlapped )
+{
+    struct fake_handle *h = get_handle( handle );
+
+    if (!h || !h->file) return FALSE;
+    count = min( count, h->file->size - h->pos );
+    memcpy( buffer, h->file->data + h->pos, count );
+    h->pos += count;
+    *read = count;
+    return TRUE;
+}
+
+BOOL WINAPI WriteFile( HANDLE handle, LPCVOID buffer, DWORD count, LPDWORD written, LPOVERLAPPED overlapped )
+{
+    struct fake_handle *h = get_handle( handle );
+    struct fake_file *file;
+
+    if (!h || !(file = h->file)) return FALSE;
+    if (h->pos + count > file->size)
+    {
+        file->data = realloc( file->data, h->pos + count + 1 );
+        file->size = h->pos + count;
+    }
+    memcpy( file->data + h->pos, buffer, count );
+    h->pos += count;
+    *written = count;
+    return TRUE;
+}
+
+HANDLE WINAPI CreateFileMappingA( HANDLE handle, LPSECURITY_ATTRIBUTES sa, DWORD protect,
+                                  DWORD high, DWORD low, LPCSTR name )
+{
+    struct fake_handle *h = get_handle( handle ), *mapping;
+
+    if (!h || !h->file || !h->file->size || !(mapping = alloc_handle( NULL ))) return NULL;
+    mapping->view = malloc( h->file->size );
+    memcpy( mapping->view, h->file->data, h->file->size );
+    return HANDLE_OF(mapping);
+}
+
+LPVOID WINAPI MapViewOfFile( HANDLE handle, DWORD access, DWORD high, DWORD low, SIZE_T count )
+{
+    struct fake_handle *h = get_handle( handle );
+
+    if (!h || !h->view) return NULL;
+    mapped_views++;
+    return h->view;
+}
+
+BOOL WINAPI UnmapViewOfFile( LPCVOID addr )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_HANDLES; i++)
+    {
+        if (handles[i].view != addr) continue;
+        mapped_views--;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+BOOL WINAPI CloseHandle( HANDLE handle )
+{
+    struct fake_handle *h = get_handle( handle );
+
+    if (!h) return FALSE;
+    free( h->view );
+    h->view = NULL;
+    h->file = NULL;
+    open_handles--;
+    return TRUE;
+}
+
+BOOL WINAPI DeleteFileA( LPCSTR name )
+{
+    if (!get_fake_file( name )) return FALSE;
+    delete_fake_file( name );
+    return TRUE;
+}
+
+HFILE WINAPI OpenFile( LPCSTR name, OFSTRUCT *ofs, UINT mode )
+{
+    struct fake_file *file = get_fake_file( name );
+    struct fake_handle *h;
+
+    if (!file || !(h = alloc_handle( file ))) return HFILE_ERROR;
+    return (HFILE)(ULONG_PTR)HANDLE_OF(h);
+}
+
+LONG WINAPI _hread( HFILE hfile, LPVOID buffer, LONG count )
+{
+    DWORD read;
+
+    if (!ReadFile( (HANDLE)(ULONG_PTR)hfile, buffer, count, &read, NULL )) return HFILE_ERROR;
+    return read;
+}
+
+HFILE WINAPI _lclose( HFILE hfile )
+{
+    return CloseHandle( (HANDLE)(ULONG_PTR)hfile ) ? 0 : HFILE_ERROR;
+}
+
+DWORD WINAPI GetTempPathA( DWORD len, LPSTR buffer )
+{
+    if (no_temp_path || len <= strlen( temp_dir )) return 0;
+    strcpy( buffer, temp_dir );
+    return strlen( temp_dir );
+}
+
+DWORD WINAPI GetTickCount(void) { return tick++; }
+UINT WINAPI GetACP(void) { return 1252; }
+
+INT WINAPI MultiByteToWideChar( UINT cp, DWORD flags, LPCSTR src, INT srclen, LPWSTR dst, INT dstlen )
+{
+    INT i;
+
+    if (srclen < 0) srclen = strlen( src ) + 1;
+    if (!dstlen) return srclen;
+    srclen = min( srclen, dstlen );
+    for (i = 0; i < srclen; i++) dst[i] = (BYTE)src[i];
+    return srclen;
+}
+
+INT WINAPI WideCharToMultiByte( UINT cp, DWORD flags, LPCWSTR src, INT srclen, LPSTR dst, INT dstlen,
+                                LPCSTR defchar, BOOL *used )
+{
+    INT i;
+
+    if (srclen < 0) srclen = lstrlenW( src ) + 1;
+    if (!dstlen) return srclen;
+    srclen = min( srclen, dstlen );
+    for (i = 0; i < srclen; i++) dst[i] = src[i] < 0x100 ? src[i] : '?';
+    return srclen;
+}
+
+BOOL WINAPI IsCharAlphaNumericW( WCHAR ch ) { return iswalnum( ch ) != 0; }
+
+DWORD WINAPI CharLowerBuffW( LPWSTR str, DWORD len )
+{
+    DWORD i;
+
+    for (i = 0; i < len; i++) str[i] = towlower( str[i] );
+    return len;
+}
+
+int test_wcsncmp( const WCHAR *a, const WCHAR *b, size_t n )
+{
+    for (; n; n--, a++, b++)
+    {
+        if (*a != *b) return *a < *b ? -1 : 1;
+        if (!*a) break;
+    }
+    return 0;
+}
+
+int test_wcscmp( const WCHAR *a, const WCHAR *b )
+{
+    return test_wcsncmp( a, b, (size_t)-1 );
+}
+
+/* pictures, fonts without a size, icons and the contents file: not in the sample */
+BOOL WINAPI BitBlt( HDC dst, INT x, INT y, INT width, INT height, HDC src, INT xsrc, INT ysrc, DWORD rop ) { return FALSE; }
+HENHMETAFILE WINAPI CloseEnhMetaFile( HDC hdc ) { return 0; }
+HBITMAP WINAPI CreateBitmap( INT width, INT height, UINT planes, UINT bpp, LPCVOID bits ) { return 0; }
+HDC WINAPI CreateCompatibleDC( HDC hdc ) { return 0; }
+HBITMAP WINAPI CreateDIBitmap( HDC hdc, const BITMAPINFOHEADER *header, DWORD init, LPCVOID bits,
+                               const BITMAPINFO *info, UINT usage ) { return 0; }
+HDC WINAPI CreateEnhMetaFileW( HDC hdc, LPCWSTR name, const RECT *rect, LPCWSTR desc ) { return 0; }
+HFONT WINAPI CreateFontIndirectA( const LOGFONTA *lf ) { return 0; }
+HICON WINAPI CreateIconFromResourceEx( PBYTE bits, UINT size, BOOL icon, DWORD version,
+                                       INT width, INT height, UINT flags ) { return 0; }
+BOOL WINAPI DeleteDC( HDC hdc ) { return FALSE; }
+BOOL WINAPI DeleteEnhMetaFile( HENHMETAFILE hemf ) { return FALSE; }
+BOOL WINAPI DeleteObject( HGDIOBJ obj ) { return FALSE; }
+BOOL WINAPI DestroyIcon( HICON icon ) { return FALSE; }
+HDC WINAPI GetDC( HWND hwnd ) { return 0; }
+INT WINAPI GetDeviceCaps( HDC hdc, INT cap ) { return 0; }
+UINT WINAPI GetEnhMetaFileBits( HENHMETAFILE hemf, UINT size, LPBYTE buf ) { return 0; }
+BOOL WINAPI GetTextMetricsA( HDC hdc, LPTEXTMETRICA tm ) { return FALSE; }
+INT WINAPI MulDiv( INT a, INT b, INT c ) { return c ? (INT)((LONGLONG)a * b / c) : -1; }
+INT WINAPI ReleaseDC( HWND hwnd, HDC hdc ) { return 0; }
+HGDIOBJ WINAPI SelectObject( HDC hdc, HGDIOBJ obj ) { return 0; }
+COLORREF WINAPI SetBkColor( HDC hdc, COLORREF color ) { return 0; }
+COLORREF WINAPI SetTextColor( HDC hdc, COLORREF color ) { return 0; }
+BOOL WINAPI TranslateCharsetInfo( LPDWORD src, LPCHARSETINFO cs, DWORD flags ) { return FALSE; }
+
+/*
+ * The sample help file: an uncompressed WinHelp 3.1 file with the
+ * subfiles the viewer needs, |SYSTEM, |FONT, |TOPIC and |CONTEXT. The
+ * paragraphs of a topic are displayable text records, '|' separates the
+ * strings of a paragraph.
+ */
+struct sample_topic
+{
+    const char *title;
+    const char *text[3];
+};
+
+static const struct sample_topic sample_topics[] =
+{
+    { "Contents",  { "Welcome to the sample help file." } },
+    { "Searching", { "Search the index for a topic.", "Type a word|prefix and press Enter." } },
+    { "Printing",  { "Print the current topic on the default printer." } },
+    { "Seaside",   { "A day at the beach." } },
+};
+
+/* the same file after the author replaced a word */
+static const struct sample_topic edited_topics[] =
+{
+    { "Contents",  { "Welcome to the sample help file." } },
+    { "Searching", { "Search the index for a topic.", "Type a word|prefix and press Enter." } },
+    { "Printing",  { "Print the current topic on the default plotter." } },
+    { "Seaside",   { "A day at the beach." } },
+};
+
+#define TOPIC_BLOCK_SIZE  0x1000
+#define BTREE_PAGE_SIZE   0x400
+
+struct buffer
+{
+    BYTE  data[0x4000];
+    DWORD size;
+};
+
+static void put_bytes( struct buffer *buf, const void *data, DWORD size )
+{
+    memcpy( buf->data + buf->size, data, size );
+    buf->size += size;
+}
+
+static void put_byte( struct buffer *buf, BYTE val ) { put_bytes( buf, &val, 1 ); }
+static void put_word( struct buffer *buf, WORD val ) { put_byte( buf, val ); put_byte( buf, val >> 8 ); }
+static void put_dword( struct buffer *buf, DWORD val ) { put_word( buf, val ); put_word( buf, val >> 16 ); }
+static void put_zeros( struct buffer *buf, DWORD size ) { memset( buf->data + buf->size, 0, size ); buf->size += size; }
+
+static void set_dword( struct buffer *buf, DWORD pos, DWORD val )
+{
+    buf->data[pos] = val;
+    buf->data[pos + 1] = val >> 8;
+    buf->data[pos + 2] = val >> 16;
+    buf->data[pos + 3] = val >> 24;
+}
+
+/* subfiles start with their reserved and used sizes */
+static DWORD begin_subfile( struct buffer *buf )
+{
+    DWORD start = buf->size;
+
+    put_zeros( buf, 9 );
+    return start;
+}
+
+static void end_subfile( struct buffer *buf, DWORD start )
+{
+    set_dword( buf, start, buf->size - start );
+    set_dword( buf, start + 4, buf->size - start - 9 );
+}
+
+/* single leaf page B+ tree of (name, offset) entries, names in strcmp order */
+static void put_btree( struct buffer *buf, const char *format, const char **names, const DWORD *offsets, WORD count )
+{
+    char structure[16] = {0};
+    DWORD page, i;
+
+    strcpy( structure, format );
+    put_word( buf, 0x293B );
+    put_word( buf, 0x0402 );
+    put_word( buf, BTREE_PAGE_SIZE );
+    put_bytes( buf, structure, sizeof(structure) );
+    put_word( buf, 0 );
+    put_word( buf, 0 );
+    put_word( buf, 0 );         /* root page */
+    put_word( buf, 0xFFFF );
+    put_word( buf, 1 );         /* pages */
+    put_word( buf, 1 );         /* levels */
+    put_dword( buf, count );
+
+    page = buf->size;
+    put_word( buf, 0 );
+    put_word( buf, count );
+    put_word( buf, 0xFFFF );    /* previous page */
+    put_word( buf, 0xFFFF );    /* next page */
+    for (i = 0; i < count; i++)
+    {
+        put_bytes( buf, names[i], strlen( names[i] ) + 1 );
+        put_dword( buf, offsets[i] );
+    }
+    put_zeros( buf, page + BTREE_PAGE_SIZE - buf->size );
+}
+
+/* topic link record, returns its reference */
+static DWORD put_record( struct buffer *buf, DWORD block, DWORD *last, BYTE type,
+                         const void *data1, DWORD len1, const char *data2 )
+{
+    DWORD start = buf->size, len2 = strlen( data2 ), i;
+
+    put_dword( buf, 0x15 + len1 + len2 );
+    put_dword( buf, len2 );
+    put_dword( buf, *last ? *last : 0xFFFFFFFF );
+    put_dword( buf, 0xFFFFFFFF );
+    put_dword( buf, 0x15 + len1 );
+    put_byte( buf, type );
+    put_bytes( buf, data1, len1 );
+    for (i = 0; i < len2; i++) put_byte( buf, data2[i] == '|' ? 0 : data2[i] );
+
+    /* references count from the start of the block, the data follows its header */
+    if (*last) set_dword( buf, block + *last + 0x0C, start - block );
+    *last = start - block;
+    return *last;
+}
+
+static void build_help_file( struct buffer *buf, const struct sample_topic *topics, unsigned int count )
+{
+    static const char *names[] = { "|CONTEXT", "|FONT", "|SYSTEM", "|TOPIC" };
+    static const char title[] = "Sample Help";
+    static const BYTE display[] = { 0x00, 0x80, 0x00, 0x00 };  /* no spacing, no format */
+    DWORD offsets[4], start, block, last = 0, dir;
+    BYTE header[28];
+    unsigned int i, j;
+
+    buf->size = 0;
+    put_dword( buf, 0x00035F3F );
+    put_dword( buf, 0 );        /* directory */
+    put_dword( buf, 0xFFFFFFFF );
+    put_dword( buf, 0 );        /* file size */
+
+    offsets[0] = start = begin_subfile( buf );
+    put_btree( buf, "L4", NULL, NULL, 0 );
+    end_subfile( buf, start );
+
+    /* one face, one 10 point Helv descriptor */
+    offsets[1] = start = begin_subfile( buf );
+    put_word( buf, 1 );
+    put_word( buf, 1 );
+    put_word( buf, 8 );
+    put_word( buf, 8 + 20 );
+    put_bytes( buf, "Helv", 4 );
+    put_zeros( buf, 16 );
+    put_byte( buf, 0 );
+    put_byte( buf, 20 );
+    put_byte( buf, 2 );
+    put_word( buf, 0 );
+    put_zeros( buf, 6 );
+    end_subfile( buf, start );
+
+    /* version 1.21, uncompressed 4k topic blocks */
+    offsets[2] = start = begin_subfile( buf );
+    put_word( buf, 0x036C );
+    put_word( buf, 21 );
+    put_word( buf, 1 );
+    put_dword( buf, 0 );
+    put_word( buf, 0 );
+    put_word( buf, 1 );
+    put_word( buf, sizeof(title) );
+    put_bytes( buf, title, sizeof(title) );
+    end_subfile( buf, start );
+
+    offsets[3] = start = begin_subfile( buf );
+    block = buf->size;
+    put_dword( buf, 0 );
+    put_dword( buf, 0x0C );
+    put_dword( buf, 0 );
+    for (i = 0; i < count; i++)
+    {
+        memset( header, 0xFF, sizeof(header) );
+        header[0] = header[1] = header[2] = header[3] = 0;
+        header[12] = i;
+        header[13] = header[14] = header[15] = 0;
+        put_record( buf, block, &last, HLP_TOPICHDR, header, sizeof(header), topics[i].title );
+        for (j = 0; j < ARRAY_SIZE(topics[i].text) && topics[i].text[j]; j++)
+            put_record( buf, block, &last, HLP_DISPLAY, display, sizeof(display), topics[i].text[j] );
+    }
+    put_zeros( buf, block + TOPIC_BLOCK_SIZE - buf->size );
+    end_subfile( buf, start );
+
+    dir = start = begin_subfile( buf );
+    put_btree( buf, "z4", names, offsets, ARRAY_SIZE(names) );
+    end_subfile( buf, start );
+
+    set_dword( buf, 4, dir );
+    set_dword( buf, 12, buf->size );
+}
+
+static void write_help_file( const struct sample_topic *topics, unsigned int count, char *sidecar )
+{
+    struct buffer buf;
+    DWORD hash = 2166136261u, i;
+
+    build_help_file( &buf, topics, count );
+    set_fake_file( sample_path, buf.data, buf.size );
+    for (i = 0; i < buf.size; i++) hash = (hash ^ buf.data[i]) * 16777619u;
+    sprintf( sidecar, "%swhfts%08x%08x.idx", temp_dir, hash, buf.size );
+}
+
+static void query_callback( HLPFILE_PAGE *page, void *cookie )
+{
+    char *result = cookie;
+    const WCHAR *p;
+
+    if (*result) strcat( result, "," );
+    result += strlen( result );
+    for (p = page->lpszTitle; *p; p++) *result++ = *p;
+    *result = 0;
+}
+
+/* pages matching the query as a list of titles, NULL when the query failed */
+static const char *query( HLPFILE *hlpfile, const char *text )
+{
+    static char result[256];
+    WCHAR textW[64];
+    unsigned int i;
+
+    for (i = 0; i <= strlen( text ); i++) textW[i] = (BYTE)text[i];
+    result[0] = 0;
+    return SEARCH_Query( hlpfile, textW, query_callback, result ) ? result : NULL;
+}
+
+/* opens the sample file and builds its index a page at a time */
+static HLPFILE *load_index( unsigned int *pending )
+{
+    HLPFILE *hlpfile = HLPFILE_ReadHlpFile( sample_path );
+    enum search_state state;
+
+    *pending = 0;
+    if (!hlpfile) return NULL;
+    while ((state = SEARCH_BuildIndex( hlpfile, 0 )) == SEARCH_PENDING)
+    {
+        ok( !query( hlpfile, "sea" ), "queried a pending index\n" );
+        if (++*pending > 100) break;
+    }
+    ok( state == SEARCH_READY, "state %u\n", state );
+    return hlpfile;
+}
+
+static void check_query( HLPFILE *hlpfile, const char *text, const char *expect, int line )
+{
+    const char *result = query( hlpfile, text );
+
+    if (!expect) test_ok( __FILE__, line, !result, "%s: got %s\n", text, result );
+    else test_ok( __FILE__, line, result && !strcmp( result, expect ), "%s: got %s, expected %s\n",
+                  text, result ? result : "failure", expect );
+}
+#define check_query(hlpfile, text, expect) check_query( hlpfile, text, expect, __LINE__ )
+
+static void check_sample_queries( HLPFILE *hlpfile, int line )
+{
+    static const struct { const char *text, *expect; } tests[] =
+    {
+        { "sea", "Searching,Seaside" },
+        { "SEARCH", "Searching" },
+        { "topic", "Searching,Printing" },
+        { "print topic", "Printing" },
+        { "pr", "Searching,Printing" },
+        { "printer", "Printing" },
+        { "index prefix", "Searching" },    /* words of two paragraphs */
+        { "word enter", "Searching" },      /* strings of one paragraph */
+        { "contents", "Contents" },         /* title */
+        { "the", "Contents,Searching,Printing,Seaside" },
+        { "sample, help!", "Contents" },
+        { "beach printer", "" },
+        { "zebra", "" },
+        { " ?! ", NULL },
+    };
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++) (check_query)( hlpfile, tests[i].text, tests[i].expect, line );
+}
+#define check_sample_queries(hlpfile) check_sample_queries( hlpfile, __LINE__ )
+
+static void free_help_file( HLPFILE *hlpfile )
+{
+    HLPFILE_FreeHlpFile( hlpfile );
+    ok( !open_handles, "%u handles left open\n", open_handles );
+    ok( !mapped_views, "%u views left mapped\n", mapped_views );
+}
+
+static BYTE good_index[0x1000];
+static DWORD good_index_size;
+
+/* the index is written to the temp directory and used again */
+static void test_index(void)
+{
+    struct fake_file *cache;
+    char sidecar[MAX_PATH];
+    unsigned int pending;
+    HLPFILE *hlpfile;
+
+    write_help_file( sample_topics, ARRAY_SIZE(sample_topics), sidecar );
+    hlpfile = HLPFILE_ReadHlpFile( sample_path );
+    ok( hlpfile != NULL, "couldn't read the sample file\n" );
+    if (!hlpfile) return;
+    ok( !query( hlpfile, "sea" ), "queried before building\n" );
+    HLPFILE_FreeHlpFile( hlpfile );
+
+    hlpfile = load_index( &pending );
+    ok( pending == ARRAY_SIZE(sample_topics) - 1, "%u pending calls\n", pending );
+    check_sample_queries( hlpfile );
+    cache = get_fake_file( sidecar );
+    ok( cache != NULL, "no index file %s\n", sidecar );
+    ok( mapped_views == 1, "index not mapped back\n" );
+    if (cache && cache->size <= sizeof(good_index))
+    {
+        memcpy( good_index, cache->data, cache->size );
+        good_index_size = cache->size;
+    }
+    free_help_file( hlpfile );
+
+    hlpfile = load_index( &pending );
+    ok( !pending, "index built again\n" );
+    ok( mapped_views == 1, "index not mapped\n" );
+    check_sample_queries( hlpfile );
+    free_help_file( hlpfile );
+
+    /* at once */
+    delete_fake_file( sidecar );
+    hlpfile = HLPFILE_ReadHlpFile( sample_path );
+    ok( SEARCH_BuildIndex( hlpfile, INFINITE ) == SEARCH_READY, "not built\n" );
+    check_sample_queries( hlpfile );
+    free_help_file( hlpfile );
+    cache = get_fake_file( sidecar );
+    ok( cache && cache->size == good_index_size && !memcmp( cache->data, good_index, good_index_size ),
+        "different index\n" );
+
+    /* without a temp directory, the index stays in memory */
+    no_temp_path = TRUE;
+    delete_fake_file( sidecar );
+    hlpfile = load_index( &pending );
+    ok( pending == ARRAY_SIZE(sample_topics) - 1, "%u pending calls\n", pending );
+    ok( !mapped_views, "index mapped\n" );
+    check_sample_queries( hlpfile );
+    free_help_file( hlpfile );
+    ok( fake_file_count() == 1, "%u files\n", fake_file_count() );
+    no_temp_path = FALSE;
+}
+
+/* a cache file that doesn't match the help file is rebuilt */
+static void test_stale_index(void)
+{
+    struct fake_file *cache;
+    char sidecar[MAX_PATH], edited_sidecar[MAX_PATH];
+    BYTE data[sizeof(good_index)];
+    unsigned int pending;
+    HLPFILE *hlpfile;
+
+    write_help_file( edited_topics, ARRAY_SIZE(edited_topics), edited_sidecar );
+    write_help_file( sample_topics, ARRAY_SIZE(sample_topics), sidecar );
+    ok( strcmp( sidecar, edited_sidecar ), "same index file\n" );
+
+    /* the index of the original file under the name of the edited one */
+    write_help_file( edited_topics, ARRAY_SIZE(edited_topics), edited_sidecar );
+    set_fake_file( edited_sidecar, good_index, good_index_size );
+    hlpfile = load_index( &pending );
+    ok( pending == ARRAY_SIZE(edited_topics) - 1, "stale index used\n" );
+    check_query( hlpfile, "printer", "" );
+    check_query( hlpfile, "plotter", "Printing" );
+    free_help_file( hlpfile );
+    cache = get_fake_file( edited_sidecar );
+    ok( cache && (cache->size != good_index_size || memcmp( cache->data, good_index, good_index_size )),
+        "stale index kept\n" );
+
+    /* other version, page count */
+    write_help_file( sample_topics, ARRAY_SIZE(sample_topics), sidecar );
+    memcpy( data, good_index, good_index_size );
+    data[4]++;
+    set_fake_file( sidecar, data, good_index_size );
+    hlpfile = load_index( &pending );
+    ok( pending == ARRAY_SIZE(sample_topics) - 1, "index of another version used\n" );
+    check_sample_queries( hlpfile );
+    free_help_file( hlpfile );
+
+    memcpy( data, good_index, good_index_size );
+    data[16]--;
+    set_fake_file( sidecar, data, good_index_size );
+    hlpfile = load_index( &pending );
+    ok( pending == ARRAY_SIZE(sample_topics) - 1, "index with other pages used\n" );
+    check_sample_queries( hlpfile );
+    free_help_file( hlpfile );
+
+    cache = get_fake_file( sidecar );
+    ok( cache && cache->size == good_index_size && !memcmp( cache->data, good_index, good_index_size ),
+        "index not rewritten\n" );
+}
+
+static DWORD get_dword( const BYTE *data, DWORD pos )
+{
+    return data[pos] | data[pos + 1] << 8 | data[pos + 2] << 16 | (DWORD)data[pos + 3] << 24;
+}
+
+/* a cache file whose tables don't hold together is rebuilt */
+static void test_corrupt_index(void)
+{
+    enum { HDR = 32 };
+    DWORD num_words = get_dword( good_index, 20 ), num_refs = get_dword( good_index, 24 );
+    DWORD text_size = get_dword( good_index, 28 );
+    DWORD word_text = HDR, word_refs = word_text + num_words * 4, refs = word_refs + (num_words + 1) * 4;
+    DWORD text = refs + num_refs * 4;
+    struct { const char *name; DWORD size; DWORD pos; DWORD val; } tests[] =
+    {
+        { "truncated", good_index_size - 2 },
+        { "shorter than a header", HDR - 1 },
+        { "word count", good_index_size, 20, num_words + 1 },
+        { "huge word count", good_index_size, 20, 0x40000000 },
+        { "text size", good_index_size, 28, text_size + 2 },
+        { "word text", good_index_size, word_text + 4, text_size },
+        { "first word refs", good_index_size, word_refs, 1 },
+        { "last word refs", good_index_size, word_refs + num_words * 4, num_refs - 1 },
+        { "unsorted word refs", good_index_size, word_refs + 4, num_refs },
+        { "page ref", good_index_size, refs + 4, ARRAY_SIZE(sample_topics) },
+        { "unterminated text", good_index_size, text + text_size * 2 - 4, 0x00650065 },
+    };
+    struct buffer data;
+    char sidecar[MAX_PATH];
+    struct fake_file *cache;
+    unsigned int i, pending;
+    HLPFILE *hlpfile;
+
+    ok( text + text_size * 2 == good_index_size, "index layout: %u bytes, %u expected\n",
+        good_index_size, text + text_size * 2 );
+    write_help_file( sample_topics, ARRAY_SIZE(sample_topics), sidecar );
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        memcpy( data.data, good_index, good_index_size );
+        if (tests[i].pos) set_dword( &data, tests[i].pos, tests[i].val );
+        set_fake_file( sidecar, data.data, tests[i].size );
+
+        hlpfile = load_index( &pending );
+        ok( pending == ARRAY_SIZE(sample_topics) - 1, "%s: index used\n", tests[i].name );
+        check_sample_queries( hlpfile );
+        free_help_file( hlpfile );
+        cache = get_fake_file( sidecar );
+        ok( cache && cache->size == good_index_size && !memcmp( cache->data, good_index, good_index_size ),
+            "%s: index not rewritten\n", tests[i].name );
+    }
+}
+
+int main(void)
+{
+    test_index();
+    test_stale_index();
+    test_corrupt_index();
+    return test_summary( "hlpsearch" );
+}
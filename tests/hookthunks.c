@@ -0,0 +1,204 @@
+/*
+ * Tests of the COMMDLG hook thunk pool (commdlg/thunkpool.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "thunkpool.h"
+#include "test.h"
+
+/* the size of a COMMDLGTHUNK, which doesn't divide the page */
+#define THUNK_SIZE 100
+#define PER_PAGE   (THUNK_PAGE_SIZE / THUNK_SIZE)
+
+/*
+ * Fake host: pages are plain memory, and page or heap allocations can be
+ * made to fail.
+ */
+static BOOL fail_pages, fail_heap;
+static unsigned int page_allocs;
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI VirtualAlloc( LPVOID addr, SIZE_T size, DWORD type, DWORD protect )
+{
+    ok( !addr && size == THUNK_PAGE_SIZE, "allocated %lx at %p\n", (ULONG)size, addr );
+    ok( type == MEM_COMMIT && protect == PAGE_EXECUTE_READWRITE, "type %x protect %x\n", type, protect );
+    if (fail_pages) return NULL;
+    page_allocs++;
+    return calloc( 1, size );
+}
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return fail_heap ? NULL : malloc( size );
+}
+
+LPVOID WINAPI HeapReAlloc( HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size )
+{
+    return fail_heap ? NULL : realloc( ptr, size );
+}
+
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+static void check_usage( struct thunk_pool *pool, UINT used, UINT capacity, int line )
+{
+    UINT got_used, got_capacity;
+
+    thunk_pool_usage( pool, &got_used, &got_capacity );
+    ok( got_used == used && got_capacity == capacity, "line %d: %u of %u in use, expected %u of %u\n",
+        line, got_used, got_capacity, used, capacity );
+}
+#define check_usage(pool, used, capacity) check_usage( pool, used, capacity, __LINE__ )
+
+static void test_growth(void)
+{
+    struct thunk_pool pool = { THUNK_SIZE };
+    BYTE *thunks[PER_PAGE * 2 + 1];
+    unsigned int i, j;
+    BOOL distinct = TRUE;
+
+    check_usage( &pool, 0, 0 );
+
+    /* pages are added as the pool runs dry, thunks are handed out in order */
+    for (i = 0; i < PER_PAGE; i++) thunks[i] = thunk_pool_alloc( &pool );
+    ok( page_allocs == 1, "%u pages\n", page_allocs );
+    check_usage( &pool, PER_PAGE, PER_PAGE );
+    for (i = 1; i < PER_PAGE; i++)
+        ok( thunks[i] == thunks[0] + i * THUNK_SIZE, "thunk %u at %p\n", i, thunks[i] );
+
+    for (; i < ARRAY_SIZE(thunks); i++) thunks[i] = thunk_pool_alloc( &pool );
+    ok( page_allocs == 3, "%u pages\n", page_allocs );
+    check_usage( &pool, ARRAY_SIZE(thunks), PER_PAGE * 3 );
+    for (i = 0; i < ARRAY_SIZE(thunks); i++)
+        for (j = 0; j < i; j++)
+            distinct &= thunks[i] + THUNK_SIZE <= thunks[j] || thunks[j] + THUNK_SIZE <= thunks[i];
+    ok( distinct, "thunks overlap\n" );
+
+    /* the whole thunk is the caller's */
+    for (i = 0; i < ARRAY_SIZE(thunks); i++) memset( thunks[i], 0xcc, THUNK_SIZE );
+    for (i = 0; i < ARRAY_SIZE(thunks); i++) ok( thunk_pool_free( &pool, thunks[i] ), "free %u failed\n", i );
+    check_usage( &pool, 0, PER_PAGE * 3 );
+
+    /* pages are kept, the last freed thunk is reused first */
+    ok( thunk_pool_alloc( &pool ) == thunks[ARRAY_SIZE(thunks) - 1], "not reused\n" );
+    for (i = 1; i < PER_PAGE * 3; i++) thunk_pool_alloc( &pool );
+    ok( page_allocs == 3, "%u pages\n", page_allocs );
+    check_usage( &pool, PER_PAGE * 3, PER_PAGE * 3 );
+}
+
+/* hooks that aren't thunks of the pool are passed to delete_thunk too */
+static void test_free(void)
+{
+    struct thunk_pool pool = { THUNK_SIZE }, other = { THUNK_SIZE };
+    BYTE *thunk, *next, local;
+
+    ok( !thunk_pool_free( &pool, NULL ), "freed NULL\n" );
+    thunk = thunk_pool_alloc( &pool );
+    next = thunk_pool_alloc( &pool );
+    ok( !thunk_pool_free( &pool, NULL ), "freed NULL\n" );
+    ok( !thunk_pool_free( &pool, &local ), "freed a stack address\n" );
+    ok( !thunk_pool_free( &pool, thunk + 1 ), "freed inside a thunk\n" );
+    ok( !thunk_pool_free( &pool, thunk + THUNK_SIZE * PER_PAGE ), "freed past the page\n" );
+    ok( !thunk_pool_free( &pool, thunk + THUNK_SIZE * 2 ), "freed a free thunk\n" );
+    ok( !thunk_pool_free( &other, thunk ), "freed a thunk of another pool\n" );
+    check_usage( &pool, 2, PER_PAGE );
+
+    ok( thunk_pool_free( &pool, thunk ), "free failed\n" );
+    ok( !thunk_pool_free( &pool, thunk ), "freed twice\n" );
+    check_usage( &pool, 1, PER_PAGE );
+    ok( thunk_pool_free( &pool, next ), "free failed\n" );
+    check_usage( &pool, 0, PER_PAGE );
+}
+
+/* a pool that can't grow stays usable */
+static void test_out_of_memory(void)
+{
+    struct thunk_pool pool = { THUNK_SIZE };
+    void *thunks[PER_PAGE], *thunk;
+    unsigned int i;
+
+    fail_pages = TRUE;
+    ok( !thunk_pool_alloc( &pool ), "allocated without pages\n" );
+    check_usage( &pool, 0, 0 );
+    fail_pages = FALSE;
+
+    for (i = 0; i < PER_PAGE; i++) thunks[i] = thunk_pool_alloc( &pool );
+    fail_heap = TRUE;
+    ok( !thunk_pool_alloc( &pool ), "allocated without heap\n" );
+    fail_heap = FALSE;
+    fail_pages = TRUE;
+    ok( !thunk_pool_alloc( &pool ), "allocated without pages\n" );
+    fail_pages = FALSE;
+    check_usage( &pool, PER_PAGE, PER_PAGE );
+
+    /* freed thunks don't need memory */
+    fail_heap = fail_pages = TRUE;
+    ok( thunk_pool_free( &pool, thunks[3] ), "free failed\n" );
+    ok( thunk_pool_alloc( &pool ) == thunks[3], "not reused\n" );
+    fail_heap = fail_pages = FALSE;
+
+    thunk = thunk_pool_alloc( &pool );
+    ok( thunk != NULL, "pool didn't recover\n" );
+    check_usage( &pool, PER_PAGE + 1, PER_PAGE * 2 );
+    for (i = 0; i < PER_PAGE; i++) ok( thunk_pool_free( &pool, thunks[i] ), "free %u failed\n", i );
+    ok( thunk_pool_free( &pool, thunk ), "free failed\n" );
+    check_usage( &pool, 0, PER_PAGE * 2 );
+}
+
+/* dialogs open and close in any order */
+static void test_random(void)
+{
+    struct thunk_pool pool = { THUNK_SIZE };
+    void *live[500];
+    unsigned int i, count = 0, max = 0;
+    UINT used, capacity;
+
+    for (i = 0; i < 20000; i++)
+    {
+        if (count < ARRAY_SIZE(live) && (!count || test_rand() % 3))
+        {
+            live[count] = thunk_pool_alloc( &pool );
+            ok( live[count] != NULL, "alloc failed\n" );
+            count++;
+            if (count > max) max = count;
+        }
+        else
+        {
+            unsigned int n = test_rand() % count;
+
+            ok( thunk_pool_free( &pool, live[n] ), "free failed\n" );
+            live[n] = live[--count];
+        }
+        thunk_pool_usage( &pool, &used, &capacity );
+        if (used != count) break;
+    }
+    ok( used == count, "%u in use, expected %u\n", used, count );
+    ok( capacity == (max + PER_PAGE - 1) / PER_PAGE * PER_PAGE, "capacity %u for %u thunks\n", capacity, max );
+}
+
+int main(void)
+{
+    test_growth();
+    test_free();
+    test_out_of_memory();
+    test_random();
+    return test_summary( "hookthunks" );
+}
@@ -0,0 +1,112 @@
+/*
+ * Host socket helpers for the socketpair test
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The Windows headers and the host socket headers can't be mixed, so the
+ * driver reaches the host sockets through these. Sends and receives return
+ * -1 when they would block and -2 on other errors.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+
+int host_socketpair( int fds[2] )
+{
+    int size = 4096;
+
+    if (socketpair( AF_UNIX, SOCK_STREAM, 0, fds )) return -1;
+    /* small buffers so that the tests fill them quickly */
+    setsockopt( fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size) );
+    setsockopt( fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size) );
+    return 0;
+}
+
+int host_set_nonblocking( int fd, int nonblocking )
+{
+    int flags = fcntl( fd, F_GETFL );
+
+    if (flags == -1) return -1;
+    flags = nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK;
+    return fcntl( fd, F_SETFL, flags );
+}
+
+int host_send( int fd, const void *buf, int len )
+{
+    int ret = send( fd, buf, len, MSG_NOSIGNAL );
+
+    if (ret >= 0) return ret;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? -1 : -2;
+}
+
+int host_recv( int fd, void *buf, int len )
+{
+    int ret = recv( fd, buf, len, MSG_DONTWAIT );
+
+    if (ret >= 0) return ret;
+    return errno == EAGAIN || errno == EWOULDBLOCK ? -1 : -2;
+}
+
+/* 1 if fd is ready for what is asked, 0 on timeout */
+int host_poll( int fd, int read, int write, int timeout )
+{
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = (read ? POLLIN : 0) | (write ? POLLOUT : 0);
+    pfd.revents = 0;
+    return poll( &pfd, 1, timeout ) > 0;
+}
+
+/* bytes sent that the peer hasn't read yet */
+int host_unsent( int fd )
+{
+    int count;
+
+    if (ioctl( fd, SIOCOUTQ, &count )) return -1;
+    return count;
+}
+
+int host_close( int fd )
+{
+    return close( fd );
+}
+
+int host_is_open( int fd )
+{
+    return fcntl( fd, F_GETFD ) != -1;
+}
+
+void host_sleep( unsigned int ms )
+{
+    usleep( ms * 1000 );
+}
+
+unsigned int host_ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
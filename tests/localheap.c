@@ -0,0 +1,351 @@
+/*
+ * Torture test of the 16-bit local heap (krnl386/local.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "wine/winbase16.h"
+#include "windows/wownt32.h"
+#include "kernel16_private.h"
+#include "test.h"
+
+/*
+ * Fake global heap: a few 64k segments whose selector is also their
+ * handle. GlobalReAlloc16 only changes the size, blocks never move.
+ */
+#define MAX_SEGMENTS 4
+#define SEGMENT_SEL(i) ((WORD)(((i) + 1) << 3 | 7))
+#define SEGMENT_INDEX(sel) (((sel) >> 3) - 1)
+
+static struct
+{
+    BYTE *base;
+    DWORD size;
+} segments[MAX_SEGMENTS];
+
+WORD test_current_ds;
+STACK16FRAME test_stack16;
+HANDLE test_process_heap = (HANDLE)1;
+
+static BOOL valid_sel( WORD sel )
+{
+    unsigned int i = SEGMENT_INDEX(sel);
+    return (sel & 7) == 7 && i < MAX_SEGMENTS && segments[i].base;
+}
+
+static WORD alloc_segment( DWORD size )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_SEGMENTS; i++)
+    {
+        if (segments[i].base) continue;
+        segments[i].base = calloc( 1, 0x10000 );
+        segments[i].size = size;
+        return SEGMENT_SEL(i);
+    }
+    return 0;
+}
+
+static void free_segment( WORD sel )
+{
+    free( segments[SEGMENT_INDEX(sel)].base );
+    segments[SEGMENT_INDEX(sel)].base = NULL;
+}
+
+LPVOID WINAPI MapSL( SEGPTR segptr )
+{
+    WORD sel = HIWORD(segptr);
+    if (!valid_sel( sel )) return NULL;
+    return segments[SEGMENT_INDEX(sel)].base + LOWORD(segptr);
+}
+
+DWORD WINAPI GlobalHandle16( WORD sel )
+{
+    return valid_sel( sel ) ? MAKELONG( sel, sel ) : 0;
+}
+
+WORD WINAPI GlobalHandleToSel16( HGLOBAL16 handle )
+{
+    return handle;
+}
+
+DWORD WINAPI GlobalSize16( HGLOBAL16 handle )
+{
+    return valid_sel( handle ) ? segments[SEGMENT_INDEX(handle)].size : 0;
+}
+
+HGLOBAL16 WINAPI GlobalReAlloc16( HGLOBAL16 handle, DWORD size, UINT16 flags )
+{
+    if (!valid_sel( handle ) || size > 0x10000) return 0;
+    segments[SEGMENT_INDEX(handle)].size = size;
+    return handle;
+}
+
+BOOL16 WINAPI GlobalUnlock16( HGLOBAL16 handle ) { return TRUE; }
+SEGPTR WINAPI K32WOWGlobalLock16( HGLOBAL16 handle ) { return MAKESEGPTR( handle, 0 ); }
+BOOL16 WINAPI IsBadReadPtr16( SEGPTR ptr, UINT16 size ) { return !MapSL( ptr ); }
+DWORD WINAPI GetSelectorLimit16( WORD sel ) { return GlobalSize16( sel ) - 1; }
+DWORD WINAPI GetSelectorBase( WORD sel ) { return 0; }
+HINSTANCE16 WINAPI LoadLibrary16( LPCSTR name ) { return 0; }
+VOID WINAPI FreeLibrary16( HINSTANCE16 handle ) { }
+BOOL WINAPI WOWCallback16Ex( DWORD proc, DWORD flags, DWORD size, LPVOID args, LPDWORD ret ) { return FALSE; }
+NE_MODULE *NE_GetPtr( HMODULE16 hModule ) { return NULL; }
+WORD SELECTOR_AllocBlock( const void *base, DWORD size, unsigned char flags ) { return 0; }
+void SELECTOR_FreeBlock( WORD sel ) { }
+BOOL16 GLOBAL_MoveBlock( HGLOBAL16 handle, void *ptr, DWORD size ) { return FALSE; }
+HANDLE WINAPI RtlCreateHeap( ULONG flags, PVOID addr, SIZE_T total, SIZE_T commit, PVOID unknown, PVOID def ) { return NULL; }
+LPVOID WINAPI VirtualAlloc( LPVOID addr, SIZE_T size, DWORD type, DWORD protect ) { return NULL; }
+BOOL WINAPI VirtualFree( LPVOID addr, SIZE_T size, DWORD type ) { return FALSE; }
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return (flags & HEAP_ZERO_MEMORY) ? calloc( 1, size ) : malloc( size );
+}
+
+LPVOID WINAPI HeapReAlloc( HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size )
+{
+    return realloc( ptr, size );
+}
+
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr )
+{
+    free( ptr );
+    return TRUE;
+}
+
+SIZE_T WINAPI HeapSize( HANDLE heap, DWORD flags, LPCVOID ptr ) { return 0; }
+BOOL WINAPI HeapWalk( HANDLE heap, LPPROCESS_HEAP_ENTRY entry ) { return FALSE; }
+BOOL WINAPI HeapDestroy( HANDLE heap ) { return TRUE; }
+
+
+/*
+ * Blocks the test owns, each filled with a pattern derived from its
+ * slot so that moves that corrupt data are noticed.
+ */
+#define MAX_BLOCKS 400
+
+static struct
+{
+    HLOCAL16 handle;
+    WORD     size;
+    BYTE     fill;
+} blocks[MAX_BLOCKS];
+
+static BYTE *lock_block( HLOCAL16 handle )
+{
+    SEGPTR ptr = LocalLock16( handle );
+    return ptr ? MapSL( ptr ) : NULL;
+}
+
+static void fill_block( unsigned int i )
+{
+    BYTE *data = lock_block( blocks[i].handle );
+
+    ok( data != NULL, "block %u (%04x) can't be locked\n", i, blocks[i].handle );
+    if (data) memset( data, blocks[i].fill, blocks[i].size );
+    LocalUnlock16( blocks[i].handle );
+}
+
+static void check_blocks( const char *when )
+{
+    unsigned int i, j;
+
+    for (i = 0; i < MAX_BLOCKS; i++)
+    {
+        BYTE *data;
+
+        if (!blocks[i].handle) continue;
+        ok( LocalSize16( blocks[i].handle ) >= blocks[i].size, "%s: block %u size %u < %u\n",
+            when, i, LocalSize16( blocks[i].handle ), blocks[i].size );
+        if (!(data = lock_block( blocks[i].handle ))) continue;
+        for (j = 0; j < blocks[i].size; j++)
+            if (data[j] != blocks[i].fill) break;
+        ok( j == blocks[i].size, "%s: block %u (%04x) corrupted at %u\n", when, i, blocks[i].handle, j );
+        LocalUnlock16( blocks[i].handle );
+    }
+}
+
+static void check_stats( WORD ds, const char *when )
+{
+    LOCALHEAPSTATS stats;
+
+    ok( LOCAL_GetHeapStats( ds, &stats ), "%s: no stats\n", when );
+    ok( stats.largest_free <= stats.free, "%s: largest free %u > free %u\n", when, stats.largest_free, stats.free );
+    ok( stats.free <= stats.size, "%s: free %u > size %u\n", when, stats.free, stats.size );
+    ok( stats.fragmentation <= 100, "%s: fragmentation %u\n", when, stats.fragmentation );
+    ok( stats.locked == 0, "%s: %u blocks left locked\n", when, stats.locked );
+}
+
+static void free_all_blocks(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_BLOCKS; i++)
+    {
+        if (!blocks[i].handle) continue;
+        ok( !LocalFree16( blocks[i].handle ), "block %u not freed\n", i );
+        blocks[i].handle = 0;
+    }
+}
+
+/* random allocations, reallocations and frees of fixed and moveable blocks */
+static void test_random_operations(void)
+{
+    WORD ds = alloc_segment( 0x5000 );
+    unsigned int op, failed = 0;
+
+    test_current_ds = ds;
+    ok( LocalInit16( ds, sizeof(INSTANCEDATA), 0x1fff ), "LocalInit16 failed\n" );
+
+    for (op = 0; op < 20000; op++)
+    {
+        unsigned int i = test_rand() % MAX_BLOCKS;
+        WORD size = 1 + test_rand() % ((test_rand() % 8) ? 64 : 2048);
+
+        if (!blocks[i].handle)
+        {
+            UINT16 flags = (test_rand() % 4) ? LMEM_MOVEABLE : LMEM_FIXED;
+            if (!(blocks[i].handle = LocalAlloc16( flags, size )))
+            {
+                failed++;
+                continue;
+            }
+            blocks[i].size = size;
+            blocks[i].fill = (BYTE)(op + 1);
+            fill_block( i );
+        }
+        else if (test_rand() % 2)
+        {
+            HLOCAL16 handle = LocalReAlloc16( blocks[i].handle, size, LMEM_MOVEABLE );
+            if (!handle)
+            {
+                failed++;
+                continue;
+            }
+            blocks[i].handle = handle;
+            if (size < blocks[i].size) blocks[i].size = size;
+            check_blocks( "realloc" );
+            blocks[i].size = size;
+            fill_block( i );
+        }
+        else
+        {
+            ok( !LocalFree16( blocks[i].handle ), "LocalFree16 of block %u failed\n", i );
+            blocks[i].handle = 0;
+        }
+        if (op % 97 == 0)
+        {
+            check_blocks( "random" );
+            check_stats( ds, "random" );
+        }
+    }
+    check_blocks( "end" );
+    check_stats( ds, "end" );
+    ok( failed < 20000 / 2, "%u of 20000 operations failed\n", failed );
+    free_all_blocks();
+    free_segment( ds );
+}
+
+/*
+ * A heap near the 64k limit with free space scattered in holes that are
+ * each too small: growing the segment isn't enough and the allocation
+ * has to compact the whole heap.
+ */
+static void test_compact_after_grow(void)
+{
+    WORD ds = alloc_segment( 0xf000 );
+    LOCALHEAPSTATS stats;
+    unsigned int i, count;
+    HLOCAL16 handle;
+
+    test_current_ds = ds;
+    ok( LocalInit16( ds, sizeof(INSTANCEDATA), 0xefff ), "LocalInit16 failed\n" );
+
+    for (count = 0; count < 200; count++)
+    {
+        if (!(blocks[count].handle = LocalAlloc16( LMEM_MOVEABLE, 0x100 ))) break;
+        blocks[count].size = 0x100;
+        blocks[count].fill = (BYTE)(count + 1);
+        fill_block( count );
+    }
+    ok( count == 200, "only %u blocks fit\n", count );
+    ok( GlobalSize16( ds ) == 0xf000, "segment grown to %04x\n", GlobalSize16( ds ) );
+    for (i = 0; i < count; i += 2)
+    {
+        LocalFree16( blocks[i].handle );
+        blocks[i].handle = 0;
+    }
+
+    LOCAL_GetHeapStats( ds, &stats );
+    ok( stats.largest_free < 0x3000, "largest free block %04x\n", stats.largest_free );
+
+    handle = LocalAlloc16( LMEM_MOVEABLE, 0x3000 );
+    ok( handle != 0, "0x3000 bytes not allocated from %04x free bytes\n", stats.free );
+    ok( GlobalSize16( ds ) == 0x10000, "segment size %04x\n", GlobalSize16( ds ) );
+    check_blocks( "compacted" );
+    check_stats( ds, "compacted" );
+    LOCAL_GetHeapStats( ds, &stats );
+    ok( stats.ncompact > 0, "no compaction counted\n" );
+
+    LocalFree16( handle );
+    free_all_blocks();
+    free_segment( ds );
+}
+
+/*
+ * LocalCompact16 must fill the holes of an unlocked heap and keep the
+ * contents of the blocks it moves; the fixed handle tables may still keep
+ * a few holes apart.
+ */
+static void test_local_compact(void)
+{
+    WORD ds = alloc_segment( 0x5000 );
+    LOCALHEAPSTATS before, stats;
+    unsigned int i;
+
+    test_current_ds = ds;
+    ok( LocalInit16( ds, sizeof(INSTANCEDATA), 0x3fff ), "LocalInit16 failed\n" );
+    for (i = 0; i < 40; i++)
+    {
+        blocks[i].handle = LocalAlloc16( LMEM_MOVEABLE, 0x40 + i );
+        blocks[i].size = 0x40 + i;
+        blocks[i].fill = (BYTE)(0x80 + i);
+        fill_block( i );
+    }
+    for (i = 0; i < 40; i += 3)
+    {
+        LocalFree16( blocks[i].handle );
+        blocks[i].handle = 0;
+    }
+    LOCAL_GetHeapStats( ds, &before );
+    LocalCompact16( 0xffff );
+    LOCAL_GetHeapStats( ds, &stats );
+    ok( stats.free_blocks < before.free_blocks, "%u free blocks before compaction, %u after\n",
+        before.free_blocks, stats.free_blocks );
+    check_blocks( "LocalCompact16" );
+    free_all_blocks();
+    free_segment( ds );
+}
+
+int main(void)
+{
+    test_random_operations();
+    test_compact_after_grow();
+    test_local_compact();
+    return test_summary( "localheap" );
+}
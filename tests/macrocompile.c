@@ -0,0 +1,523 @@
+/*
+ * Tests of the WinHelp macro compiler (winhlp32/macrocomp.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "windef.h"
+#include "winbase.h"
+#include "macrocomp.h"
+#include "test.h"
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return (flags & HEAP_ZERO_MEMORY) ? calloc( 1, size ) : malloc( size );
+}
+
+LPVOID WINAPI HeapReAlloc( HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size )
+{
+    return realloc( ptr, size );
+}
+
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+/*
+ * The routines log their calls, so that the interpreted and compiled
+ * runs of a macro can be compared. IfThen and IfThenElse run their macro
+ * the same way as the macro that called them.
+ */
+static char call_log[1024];
+static BOOL compiled_mode;
+static unsigned int fallbacks;
+
+static LONG hwnd_app = 0x1234;
+static BOOL late_loaded;
+
+static BOOL execute( const char *macro );
+
+static void log_call( const char *name, const char *proto, void *args[] )
+{
+    char *p = call_log + strlen( call_log );
+    unsigned int i;
+
+    p += sprintf( p, "%s(", name );
+    for (i = 0; proto[i]; i++)
+    {
+        if (i) *p++ = ',';
+        if (proto[i] != 'S') p += sprintf( p, "%ld", (long)(LONG_PTR)args[i] );
+        else if (args[i]) p += sprintf( p, "\"%s\"", (const char *)args[i] );
+        else p += sprintf( p, "NULL" );
+    }
+    strcpy( p, ");" );
+}
+
+static void CALLBACK About(void) { log_call( "About", "", NULL ); }
+
+static void CALLBACK CreateButton( LPCSTR id, LPCSTR name, LPCSTR macro )
+{
+    void *args[] = { (void *)id, (void *)name, (void *)macro };
+    log_call( "CreateButton", "SSS", args );
+}
+
+static void CALLBACK ExecProgram( LPCSTR cmd, LONG show )
+{
+    void *args[] = { (void *)cmd, LongToPtr(show) };
+    log_call( "ExecProgram", "SU", args );
+}
+
+static void CALLBACK JumpContext( LPCSTR path, LPCSTR window, LONG context )
+{
+    void *args[] = { (void *)path, (void *)window, LongToPtr(context) };
+    log_call( "JumpContext", "SSU", args );
+}
+
+static void CALLBACK PositionWindow( LONG x, LONG y, LONG dx, LONG dy, LONG show, LPCSTR window )
+{
+    void *args[] = { LongToPtr(x), LongToPtr(y), LongToPtr(dx), LongToPtr(dy), LongToPtr(show), (void *)window };
+    log_call( "PositionWindow", "IIUUUS", args );
+}
+
+static void CALLBACK SetContents( LPCSTR path, LONG context )
+{
+    void *args[] = { (void *)path, LongToPtr(context) };
+    log_call( "SetContents", "SU", args );
+}
+
+static void CALLBACK LateRoutine( LPCSTR str )
+{
+    void *args[] = { (void *)str };
+    log_call( "LateRoutine", "S", args );
+}
+
+static void CALLBACK IfThen( BOOL b, LPCSTR macro )
+{
+    void *args[] = { LongToPtr(b), (void *)macro };
+    log_call( "IfThen", "US", args );
+    if (b) execute( macro );
+}
+
+static void CALLBACK IfThenElse( BOOL b, LPCSTR mac1, LPCSTR mac2 )
+{
+    void *args[] = { LongToPtr(b), (void *)mac1, (void *)mac2 };
+    log_call( "IfThenElse", "USS", args );
+    execute( b ? mac1 : mac2 );
+}
+
+static BOOL CALLBACK IsBook(void)
+{
+    log_call( "IsBook", "", NULL );
+    return TRUE;
+}
+
+static BOOL CALLBACK IsMark( LPCSTR mark )
+{
+    void *args[] = { (void *)mark };
+    log_call( "IsMark", "S", args );
+    return !strcmp( mark, "intro" );
+}
+
+static BOOL CALLBACK IsNotMark( LPCSTR mark )
+{
+    void *args[] = { (void *)mark };
+    log_call( "IsNotMark", "S", args );
+    return strcmp( mark, "intro" ) != 0;
+}
+
+/* the macro table of macro.c, for the routines above */
+static const struct
+{
+    const char *name;
+    const char *alias;
+    BOOL        isBool;
+    const char *arguments;
+    void       *fn;
+} routines[] =
+{
+    {"About",          NULL, 0, "",       About},
+    {"CreateButton",   "CB", 0, "SSS",    CreateButton},
+    {"ExecProgram",    "EP", 0, "SU",     ExecProgram},
+    {"IfThen",         "IF", 0, "BS",     IfThen},
+    {"IfThenElse",     "IE", 0, "BSS",    IfThenElse},
+    {"IsBook",         NULL, 1, "",       IsBook},
+    {"IsMark",         NULL, 1, "S",      IsMark},
+    {"IsNotMark",      "NM", 1, "S",      IsNotMark},
+    {"JumpContext",    "JC", 0, "SSU",    JumpContext},
+    {"PositionWindow", "PW", 0, "IIUUUS", PositionWindow},
+    {"SetContents",    NULL, 0, "SU",     SetContents},
+    {"LateRoutine",    NULL, 0, "S",      LateRoutine},
+};
+
+/* same results as macro.c, LateRoutine is a routine from a DLL which
+ * is loaded by its first lookup */
+int MACRO_Lookup( const char *name, struct lexret *lr )
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(routines); i++)
+    {
+        if (strcasecmp( routines[i].name, name ) && (!routines[i].alias || strcasecmp( routines[i].alias, name )))
+            continue;
+        lr->proto = routines[i].arguments;
+        lr->function = routines[i].fn;
+        if (routines[i].fn == LateRoutine)
+        {
+            if (!late_loaded) lr->function = NULL;
+            late_loaded = TRUE;
+        }
+        return routines[i].isBool ? BOOL_FUNCTION : VOID_FUNCTION;
+    }
+    if (!strcmp( name, "hwndApp" ))
+    {
+        lr->integer = hwnd_app;
+        return INTEGER;
+    }
+    if (!strcmp( name, "qchPath" ))
+    {
+        lr->string = "C:\\HELP\\TEST.HLP";
+        return STRING;
+    }
+    if (!strcmp( name, "qError" )) return EMPTY;
+    lr->string = name;
+    return IDENTIFIER;
+}
+
+/*
+ * Tokenizer following the rules of macro.lex.l: integers, identifiers
+ * looked up with MACRO_Lookup, strings which nest `...' and "..." quotes
+ * and unescape \x, single characters. Strings live until the macro is
+ * done, as in the lex_data cache.
+ */
+struct test_lexer
+{
+    const char        *ptr;
+    char              *strings[32];
+    unsigned int       num_strings;
+    char               text[64];
+    struct test_lexer *prev;
+};
+
+static struct test_lexer *lexer;
+
+static void begin_lex( struct test_lexer *lx, const char *macro )
+{
+    memset( lx, 0, sizeof(*lx) );
+    lx->ptr = macro;
+    lx->prev = lexer;
+    lexer = lx;
+}
+
+static void end_lex(void)
+{
+    while (lexer->num_strings) free( lexer->strings[--lexer->num_strings] );
+    lexer = lexer->prev;
+}
+
+static int test_lex( struct lexret *lr, LPCSTR *text )
+{
+    const char *p = lexer->ptr, *start;
+    int quote_stack[32], quote_idx = 0;
+    char *dst;
+
+    while (*p == ' ') p++;
+    start = p;
+    *text = lexer->text;
+    lexer->text[0] = 0;
+
+    if (!*p)
+    {
+        lexer->ptr = p;
+        return EMPTY;
+    }
+    if (isdigit( (BYTE)*p ) || ((*p == '-' || *p == '+') && isdigit( (BYTE)p[1] )))
+    {
+        if (*p == '-' || *p == '+') p++;
+        if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && (isdigit( (BYTE)p[2] ) || (p[2] >= 'a' && p[2] <= 'f')))
+        {
+            for (p += 2; isdigit( (BYTE)*p ) || (*p >= 'a' && *p <= 'f'); p++);
+            lr->integer = strtol( start, NULL, 16 );
+        }
+        else
+        {
+            while (isdigit( (BYTE)*p )) p++;
+            lr->integer = strtol( start, NULL, 10 );
+        }
+        memcpy( lexer->text, start, p - start );
+        lexer->text[p - start] = 0;
+        lexer->ptr = p;
+        return INTEGER;
+    }
+    if (isalpha( (BYTE)*p ))
+    {
+        while (isalnum( (BYTE)*p ) || *p == '_') p++;
+        memcpy( lexer->text, start, p - start );
+        lexer->text[p - start] = 0;
+        lexer->ptr = p;
+        return MACRO_Lookup( lexer->text, lr );
+    }
+    if (*p != '`' && *p != '"' && *p != '\'')
+    {
+        lexer->ptr = p + 1;
+        lexer->text[0] = *p;
+        lexer->text[1] = 0;
+        return *p;
+    }
+
+    dst = lexer->strings[lexer->num_strings++] = malloc( strlen( p ) + 1 );
+    lr->string = dst;
+    for (;;)
+    {
+        char c = *p++;
+
+        if (!c)
+        {
+            lexer->ptr = p - 1;
+            return EMPTY;
+        }
+        if (c == '`' || c == '"' || c == '\'')
+        {
+            if (!quote_idx || (c == '"' && quote_stack[quote_idx - 1] != '"') || c == '`')
+            {
+                if (quote_idx) *dst++ = c;
+                quote_stack[quote_idx++] = c;
+            }
+            else if (--quote_idx) *dst++ = c;
+            else
+            {
+                *dst = 0;
+                lexer->text[0] = c;
+                lexer->text[1] = 0;
+                lexer->ptr = p;
+                return STRING;
+            }
+        }
+        else if (c == '\\' && *p) *dst++ = *p++;
+        else *dst++ = c;
+    }
+}
+
+/* run macro as MACRO_ExecuteMacro does, or only interpret it */
+static BOOL execute( const char *macro )
+{
+    struct test_lexer lx;
+    struct macro_program *prog = NULL;
+    BOOL ret;
+
+    if (compiled_mode)
+    {
+        begin_lex( &lx, macro );
+        prog = MACRO_CompileTokens( macro, test_lex );
+        end_lex();
+    }
+    if (prog)
+    {
+        ret = MACRO_RunProgram( prog );
+        MACRO_FreeProgram( prog );
+        return ret;
+    }
+    if (compiled_mode) fallbacks++;
+    begin_lex( &lx, macro );
+    ret = MACRO_InterpretTokens( test_lex );
+    end_lex();
+    return ret;
+}
+
+static void test_macros(void)
+{
+    static const struct
+    {
+        const char *macro;
+        BOOL        compiles;
+        BOOL        ret;
+        const char *log;
+    } tests[] =
+    {
+        { "", TRUE, TRUE, "" },
+        { "About()", TRUE, TRUE, "About();" },
+        { "About();", TRUE, TRUE, "About();" },
+        { "About(); SetContents(\"x.hlp\", 3);CB(\"a\",\"b\",\"c\")", TRUE, TRUE,
+          "About();SetContents(\"x.hlp\",3);CreateButton(\"a\",\"b\",\"c\");" },
+        /* aliases are not case sensitive, missing arguments are 0 */
+        { "jc(\"a.hlp\", \"main\", 12)", TRUE, TRUE, "JumpContext(\"a.hlp\",\"main\",12);" },
+        { "JumpContext(\"a.hlp\")", TRUE, TRUE, "JumpContext(\"a.hlp\",NULL,0);" },
+        { "PositionWindow(-1, +2, 100, 0x1f, 0X10, `main')", TRUE, TRUE,
+          "PositionWindow(-1,2,100,31,16,\"main\");" },
+        /* nested quotes and escapes */
+        { "CB(\"btn_up\", \"&Up\", \"JC(`main.hlp', `idh_up', 0)\")", TRUE, TRUE,
+          "CreateButton(\"btn_up\",\"&Up\",\"JC(`main.hlp', `idh_up', 0)\");" },
+        { "SetContents(\"a\\\"b\\\\c\", 7)", TRUE, TRUE, "SetContents(\"a\"b\\c\",7);" },
+        { "SetContents('it\\'s', 1); ExecProgram(`say \"hi\"', 2)", TRUE, TRUE,
+          "SetContents(\"it's\",1);ExecProgram(\"say \"hi\"\",2);" },
+        /* keywords */
+        { "ExecProgram(qchPath, hwndApp)", TRUE, TRUE, "ExecProgram(\"C:\\HELP\\TEST.HLP\",4660);" },
+        /* bool routines as arguments, and macros run from routines */
+        { "IfThen(IsMark(\"intro\"), \"About()\")", TRUE, TRUE,
+          "IsMark(\"intro\");IfThen(1,\"About()\");About();" },
+        { "IE(NM(`intro'), \"JC(`a.hlp', `x', 1)\", \"EP(`b', 2)\")", TRUE, TRUE,
+          "IsNotMark(\"intro\");IfThenElse(0,\"JC(`a.hlp', `x', 1)\",\"EP(`b', 2)\");ExecProgram(\"b\",2);" },
+        { "IfThen(IsBook(), \"IfThen(IsMark(`intro'), `About()')\"); About()", TRUE, TRUE,
+          "IsBook();IfThen(1,\"IfThen(IsMark(`intro'), `About()')\");"
+          "IsMark(\"intro\");IfThen(1,\"About()\");About();About();" },
+        /* not compiled, the interpreter stops at the error */
+        { "About(); Unknown(1); SetContents(\"x\", 1)", FALSE, FALSE, "About();" },
+        { "SetContents(\"x\", 1); JC(\"a\" \"b\")", FALSE, FALSE, "SetContents(\"x\",1);" },
+        { "SetContents(qError, 1)", FALSE, FALSE, "" },
+        { "SetContents(\"x\", \"y\")", FALSE, FALSE, "" },
+        { "IsMark(\"intro\")", FALSE, FALSE, "" },
+        { "IfThen(About(), \"About()\")", FALSE, FALSE, "" },
+        { "About() About()", FALSE, FALSE, "About();" },
+        /* the interpreter doesn't report strings cut short */
+        { "CB(\"a\", \"b", FALSE, TRUE, "" },
+    };
+    char interpreted[ARRAY_SIZE(call_log)];
+    struct test_lexer lx;
+    struct macro_program *prog;
+    unsigned int i;
+    BOOL ret;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        begin_lex( &lx, tests[i].macro );
+        prog = MACRO_CompileTokens( tests[i].macro, test_lex );
+        end_lex();
+        ok( !prog == !tests[i].compiles, "%u: compiled %p\n", i, prog );
+        if (prog) MACRO_FreeProgram( prog );
+
+        call_log[0] = 0;
+        compiled_mode = FALSE;
+        ret = execute( tests[i].macro );
+        ok( ret == tests[i].ret, "%u: interpreted returned %d\n", i, ret );
+        ok( !strcmp( call_log, tests[i].log ), "%u: interpreted %s\n", i, call_log );
+        strcpy( interpreted, call_log );
+
+        call_log[0] = 0;
+        compiled_mode = TRUE;
+        ret = execute( tests[i].macro );
+        ok( ret == tests[i].ret, "%u: compiled returned %d\n", i, ret );
+        ok( !strcmp( call_log, interpreted ), "%u: compiled %s, interpreted %s\n", i, call_log, interpreted );
+    }
+}
+
+/* keywords are evaluated when the program runs, not when it's compiled */
+static void test_keywords(void)
+{
+    static const char macro[] = "ExecProgram(qchPath, hwndApp)";
+    struct test_lexer lx;
+    struct macro_program *prog;
+    BOOL ret;
+
+    begin_lex( &lx, macro );
+    prog = MACRO_CompileTokens( macro, test_lex );
+    end_lex();
+    ok( prog != NULL, "not compiled\n" );
+
+    hwnd_app = 99;
+    call_log[0] = 0;
+    ret = MACRO_RunProgram( prog );
+    ok( ret, "failed\n" );
+    ok( !strcmp( call_log, "ExecProgram(\"C:\\HELP\\TEST.HLP\",99);" ), "got %s\n", call_log );
+    hwnd_app = 0x1234;
+    MACRO_FreeProgram( prog );
+}
+
+/* a routine whose DLL gets loaded while compiling is bound when it runs */
+static void test_late_binding(void)
+{
+    static const char macro[] = "LateRoutine(\"x\")";
+    struct test_lexer lx;
+    struct macro_program *prog;
+
+    late_loaded = FALSE;
+    call_log[0] = 0;
+    compiled_mode = FALSE;
+    ok( execute( macro ), "failed\n" );
+    ok( !call_log[0], "interpreted %s\n", call_log );
+
+    late_loaded = FALSE;
+    begin_lex( &lx, macro );
+    prog = MACRO_CompileTokens( macro, test_lex );
+    end_lex();
+    ok( prog != NULL, "not compiled\n" );
+    ok( prog->ops[prog->num_ops - 1].u.call.function == NULL, "bound while compiling\n" );
+    ok( MACRO_RunProgram( prog ), "failed\n" );
+    ok( !strcmp( call_log, "LateRoutine(\"x\");" ), "got %s\n", call_log );
+    ok( prog->ops[prog->num_ops - 1].u.call.function == LateRoutine, "not bound\n" );
+    MACRO_FreeProgram( prog );
+}
+
+static struct macro_program *compile( const char *macro )
+{
+    struct test_lexer lx;
+    struct macro_program *prog;
+
+    begin_lex( &lx, macro );
+    prog = MACRO_CompileTokens( macro, test_lex );
+    end_lex();
+    return prog;
+}
+
+/* programs are found by their source, running ones are never evicted */
+static void test_cache(void)
+{
+    struct macro_program *prog, *other;
+    char macro[64];
+    unsigned int i, cached = 0;
+
+    ok( MACRO_FindProgram( "About()" ) == NULL, "found before caching\n" );
+    prog = compile( "About()" );
+    ok( MACRO_CacheProgram( prog ), "not cached\n" );
+    ok( MACRO_FindProgram( "About()" ) == prog, "not found\n" );
+    ok( MACRO_FindProgram( "About() " ) == NULL, "found other source\n" );
+
+    /* fill the other slots until one maps to the running program */
+    prog->busy++;
+    for (i = 0; i < 10 * MACRO_CACHE_SIZE; i++)
+    {
+        sprintf( macro, "SetContents(\"x\", %u)", i );
+        other = compile( macro );
+        if (!MACRO_CacheProgram( other ))
+        {
+            ok( MACRO_FindProgram( macro ) == NULL, "running program evicted\n" );
+            MACRO_FreeProgram( other );
+            break;
+        }
+        ok( MACRO_FindProgram( macro ) == other, "%s not found\n", macro );
+        cached++;
+    }
+    ok( i < 10 * MACRO_CACHE_SIZE, "no collision\n" );
+    ok( MACRO_FindProgram( "About()" ) == prog, "running program evicted\n" );
+    prog->busy--;
+
+    /* once it's done, it can be replaced */
+    ok( MACRO_CacheProgram( other = compile( macro ) ), "not cached\n" );
+    ok( MACRO_FindProgram( macro ) == other, "not found\n" );
+    ok( MACRO_FindProgram( "About()" ) == NULL, "not evicted\n" );
+    ok( cached > 0, "nothing cached\n" );
+}
+
+int main(void)
+{
+    test_macros();
+    ok( fallbacks == 8, "%u macros interpreted\n", fallbacks );
+    test_keywords();
+    test_late_binding();
+    test_cache();
+    return test_summary( "macrocomp" );
+}
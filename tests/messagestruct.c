@@ -0,0 +1,201 @@
+/*
+ * Tests of the message structure conversions (user/msgstruct.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "winuser.h"
+#include "wownt32.h"
+#include "user_private.h"
+#include "msgstruct.h"
+#include "test.h"
+
+/* fake handle tables: 32-bit handles are the 16-bit ones shifted left */
+WORD WINAPI WOWHandle16( HANDLE handle, WOW_HANDLE_TYPE type )
+{
+    if (type == WOW_TYPE_HMENU && ((ULONG_PTR)handle & 0xf)) return 0;
+    return (WORD)((ULONG_PTR)handle >> 4);
+}
+
+HWND test_handle32( HWND16 hwnd16 )
+{
+    return (HWND)(ULONG_PTR)(hwnd16 << 4);
+}
+
+#define H32(h16) ((HWND)(ULONG_PTR)((h16) << 4))
+
+static INT16 rand16(void)
+{
+    return (INT16)(test_rand() * 2 - 0x7fff);
+}
+
+/* convert a structure to 16-bit and back the way call_struct_message_32to16 does */
+static void round_trip( UINT msg, const void *from32, void *to32, void *to16 )
+{
+    const struct winproc_struct_desc *desc = find_struct_desc( msg );
+
+    memset( to16, 0, WINPROC_STRUCT_MAX_SIZE );
+    if (desc->to16) desc->to16( H32(0x123), from32, to16 );
+    if (desc->to32) desc->to32( to16, to32 );
+}
+
+static void test_descs(void)
+{
+    static const UINT msgs[] = { WM_GETMINMAXINFO, WM_WINDOWPOSCHANGING, WM_WINDOWPOSCHANGED,
+                                 WM_COMPAREITEM, WM_DELETEITEM, WM_DRAWITEM, WM_MEASUREITEM,
+                                 LB_GETITEMRECT, CB_GETDROPPEDCONTROLRECT };
+    const struct winproc_struct_desc *desc;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(msgs) / sizeof(msgs[0]); i++)
+    {
+        desc = find_struct_desc( msgs[i] );
+        ok( desc != NULL, "no descriptor for %04x\n", msgs[i] );
+        if (!desc) continue;
+        ok( desc->msg == msgs[i], "%04x: got %04x\n", msgs[i], desc->msg );
+        ok( desc->size16 && desc->size16 <= WINPROC_STRUCT_MAX_SIZE, "%04x: size %u\n",
+            msgs[i], (unsigned)desc->size16 );
+        ok( desc->to16 || desc->to32, "%04x: no conversion\n", msgs[i] );
+    }
+    ok( find_struct_desc( LB_GETITEMRECT )->msg16 == LB_GETITEMRECT16, "wrong 16-bit message\n" );
+    ok( find_struct_desc( CB_GETDROPPEDCONTROLRECT )->msg16 == CB_GETDROPPEDCONTROLRECT16, "wrong 16-bit message\n" );
+    ok( !find_struct_desc( WM_NULL ), "descriptor for WM_NULL\n" );
+    ok( !find_struct_desc( WM_NCCALCSIZE ), "descriptor for WM_NCCALCSIZE\n" );
+}
+
+static void test_minmaxinfo(void)
+{
+    BYTE buffer[WINPROC_STRUCT_MAX_SIZE];
+    MINMAXINFO16 *mmi16 = (MINMAXINFO16 *)buffer;
+    MINMAXINFO mmi, out;
+    int i, j;
+
+    for (i = 0; i < 100; i++)
+    {
+        POINT *pt = &mmi.ptReserved;
+        for (j = 0; j < 5; j++)
+        {
+            pt[j].x = rand16();
+            pt[j].y = rand16();
+        }
+        memset( &out, 0xcc, sizeof(out) );
+        round_trip( WM_GETMINMAXINFO, &mmi, &out, buffer );
+        ok( mmi16->ptMaxSize.x == mmi.ptMaxSize.x && mmi16->ptMaxTrackSize.y == mmi.ptMaxTrackSize.y,
+            "wrong 16-bit copy\n" );
+        ok( !memcmp( &mmi, &out, sizeof(mmi) ), "%d: round trip changed the structure\n", i );
+    }
+}
+
+static void test_windowpos(void)
+{
+    BYTE buffer[WINPROC_STRUCT_MAX_SIZE];
+    WINDOWPOS16 *wp16 = (WINDOWPOS16 *)buffer;
+    WINDOWPOS wp, out;
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        wp.hwnd = H32( test_rand() & 0xfffc );
+        wp.hwndInsertAfter = (i & 1) ? HWND_TOPMOST : H32( test_rand() & 0xfffc );
+        wp.x = rand16();
+        wp.y = rand16();
+        wp.cx = rand16();
+        wp.cy = rand16();
+        wp.flags = test_rand() & 0xffff;
+        memset( &out, 0xcc, sizeof(out) );
+        round_trip( (i & 2) ? WM_WINDOWPOSCHANGED : WM_WINDOWPOSCHANGING, &wp, &out, buffer );
+        ok( wp16->hwnd == (HWND16)((ULONG_PTR)wp.hwnd >> 4), "wrong 16-bit handle %04x\n", wp16->hwnd );
+        ok( out.hwnd == wp.hwnd, "%d: hwnd %p, expected %p\n", i, out.hwnd, wp.hwnd );
+        ok( out.hwndInsertAfter == wp.hwndInsertAfter, "%d: insert after %p, expected %p\n",
+            i, out.hwndInsertAfter, wp.hwndInsertAfter );
+        ok( out.x == wp.x && out.y == wp.y && out.cx == wp.cx && out.cy == wp.cy && out.flags == wp.flags,
+            "%d: round trip changed the position\n", i );
+    }
+}
+
+static void test_items(void)
+{
+    BYTE buffer[WINPROC_STRUCT_MAX_SIZE];
+    COMPAREITEMSTRUCT cis = { ODT_LISTBOX, 12, H32(0x456), 3, 0x11223344, 4, 0x55667788 };
+    DELETEITEMSTRUCT dis = { ODT_MENU, 0, 7, (HWND)0x12345678, 0xdeadbeef };
+    DRAWITEMSTRUCT drw = { ODT_MENU, 0, 0x45670, ODA_SELECT, ODS_SELECTED, H32(0x222), (HDC)0x3330,
+                           { -5, -6, 300, 400 }, 0xcafe };
+    MEASUREITEMSTRUCT mis = { ODT_MENU, 0, 0x12340, 120, 16, 0xbeef }, mis_out;
+    COMPAREITEMSTRUCT16 *cis16 = (COMPAREITEMSTRUCT16 *)buffer;
+    DELETEITEMSTRUCT16 *dis16 = (DELETEITEMSTRUCT16 *)buffer;
+    DRAWITEMSTRUCT16 *drw16 = (DRAWITEMSTRUCT16 *)buffer;
+    MEASUREITEMSTRUCT16 *mis16 = (MEASUREITEMSTRUCT16 *)buffer;
+    RECT16 *rect16 = (RECT16 *)buffer;
+    RECT rect;
+
+    round_trip( WM_COMPAREITEM, &cis, NULL, buffer );
+    ok( cis16->CtlType == ODT_LISTBOX && cis16->CtlID == 12 && cis16->hwndItem == 0x456, "wrong compare item\n" );
+    ok( cis16->itemID1 == 3 && cis16->itemData1 == 0x11223344 && cis16->itemID2 == 4 &&
+        cis16->itemData2 == 0x55667788, "wrong compare item data\n" );
+
+    /* the hwndItem of a menu item is the menu handle, passed as is */
+    round_trip( WM_DELETEITEM, &dis, NULL, buffer );
+    ok( dis16->hwndItem == 0x5678 && dis16->itemID == 7 && dis16->itemData == 0xdeadbeef,
+        "wrong delete item %04x\n", dis16->hwndItem );
+    dis.CtlType = ODT_LISTBOX;
+    dis.hwndItem = H32(0x789);
+    round_trip( WM_DELETEITEM, &dis, NULL, buffer );
+    ok( dis16->hwndItem == 0x789, "wrong delete item %04x\n", dis16->hwndItem );
+
+    /* menu item ids above 0xffff are popup menu handles */
+    round_trip( WM_DRAWITEM, &drw, NULL, buffer );
+    ok( drw16->itemID == 0x4567, "wrong item id %04x\n", drw16->itemID );
+    ok( drw16->hwndItem == 0x222 && drw16->hDC == 0x333 && drw16->itemData == 0xcafe, "wrong draw item\n" );
+    ok( drw16->rcItem.left == -5 && drw16->rcItem.top == -6 && drw16->rcItem.right == 300 &&
+        drw16->rcItem.bottom == 400, "wrong item rect\n" );
+    drw.itemID = 0x45671;
+    round_trip( WM_DRAWITEM, &drw, NULL, buffer );
+    ok( drw16->itemID == 0x5671, "wrong item id %04x\n", drw16->itemID );
+
+    mis_out = mis;
+    round_trip( WM_MEASUREITEM, &mis, &mis_out, buffer );
+    ok( mis16->itemID == 0x1234 && mis16->itemWidth == 120 && mis16->itemHeight == 16 &&
+        mis16->itemData == 0xbeef, "wrong measure item\n" );
+    ok( !memcmp( &mis, &mis_out, sizeof(mis) ), "round trip changed the measure item\n" );
+    /* the width the 16-bit code returns is signed */
+    mis16->itemWidth = 0xfff0;
+    mis16->itemHeight = 20;
+    find_struct_desc( WM_MEASUREITEM )->to32( mis16, &mis_out );
+    ok( mis_out.itemWidth == (UINT)-16 && mis_out.itemHeight == 20, "got %d %u\n",
+        mis_out.itemWidth, mis_out.itemHeight );
+
+    rect16->left = -1;
+    rect16->top = -32768;
+    rect16->right = 32767;
+    rect16->bottom = 5;
+    find_struct_desc( LB_GETITEMRECT )->to32( rect16, &rect );
+    ok( rect.left == -1 && rect.top == -32768 && rect.right == 32767 && rect.bottom == 5,
+        "wrong rect %d,%d-%d,%d\n", rect.left, rect.top, rect.right, rect.bottom );
+}
+
+int main(void)
+{
+    test_descs();
+    test_minmaxinfo();
+    test_windowpos();
+    test_items();
+    return test_summary( "msgstruct" );
+}
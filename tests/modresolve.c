@@ -0,0 +1,272 @@
+/*
+ * Tests of the module name resolution cache (krnl386/modcache.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "modcache.h"
+#include "test.h"
+
+/*
+ * Fake file system: a list of full paths that exist, the current
+ * directory, and counters of the host calls the cache makes.
+ */
+#define MAX_FILES 8
+
+static char files[MAX_FILES][MAX_PATH];
+static char cwd[MAX_PATH] = "C:\\APP";
+static unsigned int host_searches, host_stats;
+static DWORD tick = 1000;
+
+HANDLE test_process_heap = (HANDLE)1;
+
+static void add_file( LPCSTR path )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_FILES; i++)
+    {
+        if (files[i][0]) continue;
+        strcpy( files[i], path );
+        return;
+    }
+}
+
+static void remove_file( LPCSTR path )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_FILES; i++) if (!strcasecmp( files[i], path )) files[i][0] = 0;
+}
+
+static BOOL file_exists( LPCSTR path )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_FILES; i++) if (files[i][0] && !strcasecmp( files[i], path )) return TRUE;
+    return FALSE;
+}
+
+DWORD WINAPI GetFileAttributesA( LPCSTR path )
+{
+    host_stats++;
+    return file_exists( path ) ? FILE_ATTRIBUTE_NORMAL : INVALID_FILE_ATTRIBUTES;
+}
+
+DWORD WINAPI GetCurrentDirectoryA( DWORD len, LPSTR buffer )
+{
+    if (strlen( cwd ) >= len) return strlen( cwd ) + 1;
+    strcpy( buffer, cwd );
+    return strlen( cwd );
+}
+
+/* the directories of path are searched in order, "." is the current directory */
+DWORD WINAPI SearchPathA( LPCSTR path, LPCSTR name, LPCSTR ext, DWORD len, LPSTR buffer, LPSTR *file_part )
+{
+    char dir[MAX_PATH], full[MAX_PATH * 3];
+    const char *p = path, *end;
+
+    host_searches++;
+    while (*p)
+    {
+        if (!(end = strchr( p, ';' ))) end = p + strlen( p );
+        memcpy( dir, p, end - p );
+        dir[end - p] = 0;
+        snprintf( full, sizeof(full), "%s\\%s%s", strcmp( dir, "." ) ? dir : cwd, name,
+                  strchr( name, '.' ) || !ext ? "" : ext );
+        if (file_exists( full ))
+        {
+            if (strlen( full ) >= len) return strlen( full ) + 1;
+            strcpy( buffer, full );
+            return strlen( full );
+        }
+        p = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
+DWORD WINAPI GetTickCount(void) { return tick; }
+void WINAPI EnterCriticalSection( CRITICAL_SECTION *cs ) {}
+void WINAPI LeaveCriticalSection( CRITICAL_SECTION *cs ) {}
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return flags & HEAP_ZERO_MEMORY ? calloc( 1, size ) : malloc( size );
+}
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+static const char search_path[] = ".;C:\\OTVDM;C:\\WINDOWS\\SYSTEM;C:\\WINDOWS";
+
+static BOOL search( LPCSTR name, LPSTR buf )
+{
+    return module_res_search_path( search_path, name, ".dll", buf, MAX_PATH );
+}
+
+static void test_hit(void)
+{
+    char buf[MAX_PATH];
+
+    add_file( "C:\\WINDOWS\\SYSTEM\\VBRUN300.DLL" );
+    host_searches = host_stats = 0;
+    ok( search( "vbrun300", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\WINDOWS\\SYSTEM\\vbrun300.dll" ), "got %s\n", buf );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+
+    /* found again with one look at the file and no search */
+    buf[0] = 0;
+    host_searches = host_stats = 0;
+    ok( search( "vbrun300", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\WINDOWS\\SYSTEM\\vbrun300.dll" ), "got %s\n", buf );
+    ok( host_searches == 0, "%u searches\n", host_searches );
+    ok( host_stats == 1, "%u stats\n", host_stats );
+
+    /* names are case insensitive */
+    host_searches = 0;
+    ok( search( "VBRUN300", buf ), "not found\n" );
+    ok( host_searches == 0, "%u searches\n", host_searches );
+}
+
+static void test_deleted(void)
+{
+    char buf[MAX_PATH];
+
+    add_file( "C:\\OTVDM\\THREED.DLL" );
+    ok( search( "threed", buf ), "not found\n" );
+
+    /* a cached hit whose file is gone is searched for again */
+    remove_file( "C:\\OTVDM\\THREED.DLL" );
+    add_file( "C:\\WINDOWS\\THREED.DLL" );
+    host_searches = 0;
+    ok( search( "threed", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\WINDOWS\\threed.dll" ), "got %s\n", buf );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+    remove_file( "C:\\WINDOWS\\THREED.DLL" );
+}
+
+static void test_miss(void)
+{
+    char buf[MAX_PATH];
+
+    host_searches = 0;
+    ok( !search( "ctl3d", buf ), "found %s\n", buf );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+
+    /* a miss is cached for a while, even when the file turns up */
+    add_file( "C:\\WINDOWS\\SYSTEM\\CTL3D.DLL" );
+    tick += MODULE_RES_MISS_TIMEOUT - 1;
+    host_searches = host_stats = 0;
+    ok( !search( "ctl3d", buf ), "found %s\n", buf );
+    ok( host_searches == 0, "%u searches\n", host_searches );
+    ok( host_stats == 0, "%u stats\n", host_stats );
+
+    /* and then it is looked for again */
+    tick++;
+    ok( search( "ctl3d", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\WINDOWS\\SYSTEM\\ctl3d.dll" ), "got %s\n", buf );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+}
+
+static void test_shadowed(void)
+{
+    char buf[MAX_PATH];
+
+    add_file( "C:\\WINDOWS\\COMMDLG.DLL" );
+    ok( search( "commdlg", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\WINDOWS\\commdlg.dll" ), "got %s\n", buf );
+
+    /* a copy earlier in the path isn't seen until the hit expires */
+    add_file( "C:\\APP\\COMMDLG.DLL" );
+    tick += MODULE_RES_HIT_TIMEOUT - 1;
+    ok( search( "commdlg", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\WINDOWS\\commdlg.dll" ), "got %s\n", buf );
+    tick++;
+    ok( search( "commdlg", buf ), "not found\n" );
+    ok( !strcmp( buf, "C:\\APP\\commdlg.dll" ), "got %s\n", buf );
+    remove_file( "C:\\APP\\COMMDLG.DLL" );
+    remove_file( "C:\\WINDOWS\\COMMDLG.DLL" );
+}
+
+static void test_keys(void)
+{
+    char buf[MAX_PATH];
+    BOOL found;
+
+    add_file( "C:\\APP\\HELPER.DLL" );
+    ok( search( "helper", buf ), "not found\n" );
+
+    /* other current directory */
+    strcpy( cwd, "C:\\OTHER" );
+    host_searches = 0;
+    ok( !search( "helper", buf ), "found %s\n", buf );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+    strcpy( cwd, "C:\\APP" );
+
+    /* other search path */
+    host_searches = 0;
+    ok( module_res_search_path( ".;C:\\WINDOWS", "helper", ".dll", buf, MAX_PATH ), "not found\n" );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+
+    /* other extension */
+    host_searches = 0;
+    ok( !module_res_search_path( search_path, "helper", ".exe", buf, MAX_PATH ), "found %s\n", buf );
+    ok( host_searches == 1, "%u searches\n", host_searches );
+
+    /* resolutions stored by the loader itself */
+    module_res_set( "ne:HELPER", search_path, TRUE, "C:\\APP\\HELPER.DLL" );
+    ok( module_res_get( "ne:helper", search_path, &found, buf, sizeof(buf) ), "not cached\n" );
+    ok( found && !strcmp( buf, "C:\\APP\\HELPER.DLL" ), "got %d %s\n", found, buf );
+    ok( !module_res_get( "ne:helper", search_path, &found, buf, 4 ), "cached in a short buffer\n" );
+    module_res_drop( "ne:helper", search_path );
+    ok( !module_res_get( "ne:helper", search_path, &found, buf, sizeof(buf) ), "still cached\n" );
+    remove_file( "C:\\APP\\HELPER.DLL" );
+}
+
+static void test_limit(void)
+{
+    char name[16], buf[MAX_PATH];
+    BOOL found;
+    int i;
+
+    for (i = 0; i < MODULE_RES_MAX + 1; i++)
+    {
+        sprintf( name, "miss%d", i );
+        module_res_set( name, search_path, FALSE, NULL );
+    }
+    /* the oldest entry was dropped */
+    ok( !module_res_get( "miss0", search_path, &found, buf, sizeof(buf) ), "miss0 still cached\n" );
+    ok( module_res_get( "miss1", search_path, &found, buf, sizeof(buf) ), "miss1 not cached\n" );
+
+    /* miss1 was used last, so miss2 goes next */
+    module_res_set( "another", search_path, FALSE, NULL );
+    ok( module_res_get( "miss1", search_path, &found, buf, sizeof(buf) ), "miss1 not cached\n" );
+    ok( !module_res_get( "miss2", search_path, &found, buf, sizeof(buf) ), "miss2 still cached\n" );
+}
+
+int main(void)
+{
+    test_hit();
+    test_deleted();
+    test_miss();
+    test_shadowed();
+    test_keys();
+    test_limit();
+    return test_summary( "modresolve" );
+}
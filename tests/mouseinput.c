@@ -0,0 +1,353 @@
+/*
+ * Tests of the INT 33h mouse driver state (krnl386/mousestate.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "winuser.h"
+#include "wincon.h"
+#include "mousestate.h"
+#include "test.h"
+
+#define CALLBACK_A ((FARPROC16)0x12340010)
+#define CALLBACK_B ((FARPROC16)0x12340020)
+
+/*
+ * The event queue of the DOS VM: events are delivered in order, and the
+ * last one queued can take more motion until it is delivered, as in
+ * int33.c.
+ */
+static MCALLDATA queue[64];
+static unsigned int queued, delivered;
+static MCALLDATA *pending;
+
+static void input( struct mouse_state *state, int x, int y, WORD mask )
+{
+    mouse_state_pointer( state, x, y, mask );
+    if (!(mask & state->callmask) || !state->callback) return;
+    if (mouse_event_merge( pending, state, mask )) return;
+    pending = &queue[queued++];
+    memset( pending, 0, sizeof(*pending) );
+    mouse_event_fill( pending, state, mask );
+}
+
+static void message( struct mouse_state *state, UINT msg, int x, int y )
+{
+    input( state, x, y, mouse_message_mask( msg ) );
+}
+
+static const MCALLDATA *deliver(void)
+{
+    if (delivered == queued) return NULL;
+    if (pending == &queue[delivered]) pending = NULL;
+    return &queue[delivered++];
+}
+
+static void reset_queue(void)
+{
+    queued = delivered = 0;
+    pending = NULL;
+}
+
+static void test_before_reset(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    SHORT mx, my;
+
+    /* programs that never reset the driver still see the pointer move */
+    message( &state, WM_MOUSEMOVE, 100, 50 );
+    ok( state.x == 100 && state.y == 50, "cursor at %d,%d\n", state.x, state.y );
+    message( &state, WM_MOUSEMOVE, 108, 58 );
+    ok( state.x == 108 && state.y == 58, "cursor at %d,%d\n", state.x, state.y );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( mx == 8 && my == 16, "motion %d,%d\n", mx, my );
+    ok( !state.hide_count, "hide count %u\n", state.hide_count );
+}
+
+static void test_reset(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    SHORT mx, my;
+
+    message( &state, WM_MOUSEMOVE, 100, 50 );
+    message( &state, WM_LBUTTONDOWN, 100, 50 );
+    mouse_state_set_range( &state, FALSE, 10, 20 );
+    mouse_state_reset( &state );
+    ok( state.x == 0 && state.y == 0 && !state.but && !state.lbcount, "state kept\n" );
+    ok( state.minx == 0 && state.maxx == 0x7fff, "range %d..%d\n", state.minx, state.maxx );
+    ok( state.HMPratio == 8 && state.VMPratio == 16, "ratio %u %u\n", state.HMPratio, state.VMPratio );
+    ok( state.hide_count == 1, "hide count %u\n", state.hide_count );
+
+    /* motion since the last pointer event still counts */
+    message( &state, WM_MOUSEMOVE, 104, 50 );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( mx == 4 && my == 0, "motion %d,%d\n", mx, my );
+    ok( state.x == 104 && state.y == 50, "cursor at %d,%d\n", state.x, state.y );
+}
+
+static void test_range(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    SHORT mx, my;
+
+    mouse_state_reset( &state );
+    mouse_state_set_range( &state, FALSE, 639, 0 );
+    mouse_state_set_range( &state, TRUE, 0, 199 );
+    ok( state.minx == 0 && state.maxx == 639 && state.miny == 0 && state.maxy == 199,
+        "range %d..%d %d..%d\n", state.minx, state.maxx, state.miny, state.maxy );
+
+    message( &state, WM_MOUSEMOVE, 600, 100 );
+    message( &state, WM_MOUSEMOVE, 700, 300 );
+    ok( state.x == 639 && state.y == 199, "cursor at %d,%d\n", state.x, state.y );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( mx == 100 && my == 400, "motion %d,%d\n", mx, my );
+
+    /* captured pointers go negative */
+    message( &state, WM_MOUSEMOVE, -5, -5 );
+    ok( state.x == 0 && state.y == 0, "cursor at %d,%d\n", state.x, state.y );
+
+    /* a new range moves the cursor into it */
+    message( &state, WM_MOUSEMOVE, 300, 150 );
+    mouse_state_set_range( &state, FALSE, 320, 400 );
+    mouse_state_set_range( &state, TRUE, 10, 100 );
+    ok( state.x == 320 && state.y == 100, "cursor at %d,%d\n", state.x, state.y );
+}
+
+static void test_set_position(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    SHORT mx, my;
+
+    mouse_state_reset( &state );
+
+    /* before any pointer event, the first one doesn't move the cursor */
+    mouse_state_set_position( &state, 50, 60 );
+    ok( state.x == 50 && state.y == 60, "cursor at %d,%d\n", state.x, state.y );
+    message( &state, WM_MOUSEMOVE, 300, 200 );
+    ok( state.x == 50 && state.y == 60, "cursor at %d,%d\n", state.x, state.y );
+    message( &state, WM_MOUSEMOVE, 310, 195 );
+    ok( state.x == 60 && state.y == 55, "cursor at %d,%d\n", state.x, state.y );
+
+    /* the cursor follows the pointer from where the program put it */
+    mouse_state_set_position( &state, 320, 100 );
+    ok( state.x == 320 && state.y == 100, "cursor at %d,%d\n", state.x, state.y );
+    message( &state, WM_MOUSEMOVE, 312, 197 );
+    ok( state.x == 322 && state.y == 102, "cursor at %d,%d\n", state.x, state.y );
+    message( &state, WM_LBUTTONDOWN, 312, 197 );
+    ok( state.llastx == 322 && state.llasty == 102, "press at %d,%d\n", state.llastx, state.llasty );
+
+    /* games that recenter every frame read the motion */
+    mouse_state_read_motion( &state, &mx, &my );
+    mouse_state_set_position( &state, 160, 100 );
+    message( &state, WM_MOUSEMOVE, 322, 197 );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( mx == 10 && my == 0, "motion %d,%d\n", mx, my );
+    ok( state.x == 170 && state.y == 100, "cursor at %d,%d\n", state.x, state.y );
+
+    /* within the range */
+    mouse_state_set_range( &state, FALSE, 0, 199 );
+    mouse_state_set_position( &state, 500, 100 );
+    ok( state.x == 199, "cursor at %d\n", state.x );
+    message( &state, WM_MOUSEMOVE, 312, 197 );
+    ok( state.x == 189, "cursor at %d\n", state.x );
+
+    /* a reset ends the offset */
+    mouse_state_reset( &state );
+    message( &state, WM_MOUSEMOVE, 312, 197 );
+    ok( state.x == 312 && state.y == 197, "cursor at %d,%d\n", state.x, state.y );
+}
+
+static void test_mickeys(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    SHORT mx, my;
+    int i;
+
+    mouse_state_reset( &state );
+    message( &state, WM_MOUSEMOVE, 0, 0 );
+
+    /* fractions are kept between events */
+    state.HMPratio = 3;
+    state.VMPratio = 5;
+    for (i = 1; i <= 8; i++) message( &state, WM_MOUSEMOVE, i, i );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( mx == 3 && my == 5, "motion %d,%d\n", mx, my );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( !mx && !my, "motion %d,%d after reading\n", mx, my );
+
+    for (i = 7; i >= -8; i--) message( &state, WM_MOUSEMOVE, i, 8 );
+    mouse_state_read_motion( &state, &mx, &my );
+    ok( mx == -6 && my == 0, "motion %d,%d\n", mx, my );
+    ok( (SHORT)state.rawx == -3 && state.rawy == 5, "counters %d,%d\n", (SHORT)state.rawx, state.rawy );
+}
+
+static void test_buttons(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    WORD x, y;
+
+    mouse_state_reset( &state );
+    message( &state, WM_LBUTTONDOWN, 10, 20 );
+    message( &state, WM_LBUTTONUP, 11, 21 );
+    message( &state, WM_LBUTTONDBLCLK, 12, 22 );
+    message( &state, WM_RBUTTONDOWN, 30, 40 );
+    message( &state, WM_MBUTTONDOWN, 30, 40 );
+    ok( state.but == 0x07, "buttons %x\n", state.but );
+
+    ok( mouse_state_read_presses( &state, FALSE, &x, &y ) == 2, "wrong left count\n" );
+    ok( x == 12 && y == 22, "left press at %d,%d\n", x, y );
+    ok( mouse_state_read_presses( &state, FALSE, &x, &y ) == 0, "count not reset\n" );
+    ok( x == 12 && y == 22, "left press at %d,%d\n", x, y );
+    ok( mouse_state_read_presses( &state, TRUE, &x, &y ) == 1, "wrong right count\n" );
+    ok( x == 30 && y == 40, "right press at %d,%d\n", x, y );
+
+    message( &state, WM_RBUTTONUP, 30, 40 );
+    message( &state, WM_MBUTTONUP, 30, 40 );
+    message( &state, WM_LBUTTONUP, 30, 40 );
+    ok( !state.but, "buttons %x\n", state.but );
+
+    ok( mouse_message_mask( WM_MOUSEWHEEL ) == 0, "wheel has a mask\n" );
+}
+
+static void test_console(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+
+    mouse_state_reset( &state );
+    ok( mouse_console_mask( &state, 0, MOUSE_MOVED ) == MOUSE_MOTION, "wrong move mask\n" );
+    ok( mouse_console_mask( &state, FROM_LEFT_1ST_BUTTON_PRESSED | RIGHTMOST_BUTTON_PRESSED, 0 ) ==
+        (MOUSE_LEFT_DOWN | MOUSE_RIGHT_DOWN), "wrong press mask\n" );
+    input( &state, 0, 0, MOUSE_LEFT_DOWN | MOUSE_RIGHT_DOWN );
+    /* a held button doesn't press again */
+    ok( mouse_console_mask( &state, FROM_LEFT_1ST_BUTTON_PRESSED | RIGHTMOST_BUTTON_PRESSED, MOUSE_MOVED ) ==
+        MOUSE_MOTION, "held buttons reported\n" );
+    ok( mouse_console_mask( &state, FROM_LEFT_2ND_BUTTON_PRESSED, 0 ) ==
+        (MOUSE_LEFT_UP | MOUSE_RIGHT_UP | MOUSE_MIDDLE_DOWN), "wrong transition mask\n" );
+}
+
+static void test_exclude(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+
+    mouse_state_reset( &state );
+    mouse_state_show( &state, TRUE );
+    ok( !state.hide_count, "hide count %u\n", state.hide_count );
+    mouse_state_show( &state, TRUE );
+    ok( !state.hide_count, "hide count %u\n", state.hide_count );
+
+    message( &state, WM_MOUSEMOVE, 5, 5 );
+    mouse_state_set_exclude( &state, 100, 80, 50, 40 );
+    ok( !state.hide_count, "hidden outside the region\n" );
+    message( &state, WM_MOUSEMOVE, 50, 80 );
+    ok( state.hide_count == 1, "not hidden in the region\n" );
+    ok( !state.exclude, "region kept\n" );
+    message( &state, WM_MOUSEMOVE, 60, 60 );
+    ok( state.hide_count == 1, "hidden again\n" );
+    mouse_state_show( &state, TRUE );
+    ok( !state.hide_count, "not shown\n" );
+
+    /* a region around the cursor hides it at once */
+    mouse_state_set_exclude( &state, 0, 0, 100, 100 );
+    ok( state.hide_count == 1, "not hidden\n" );
+
+    /* showing ends the region */
+    mouse_state_show( &state, TRUE );
+    mouse_state_set_exclude( &state, 200, 200, 300, 300 );
+    mouse_state_show( &state, FALSE );
+    mouse_state_show( &state, TRUE );
+    message( &state, WM_MOUSEMOVE, 250, 250 );
+    ok( !state.hide_count, "hidden by an ended region\n" );
+}
+
+static void test_events(void)
+{
+    struct mouse_state state = MOUSE_STATE_INIT;
+    const MCALLDATA *event;
+    int i;
+
+    mouse_state_reset( &state );
+    reset_queue();
+    state.callback = CALLBACK_A;
+    state.callmask = 0x7f;
+
+    /* motion is merged into one event */
+    for (i = 0; i < 10; i++) message( &state, WM_MOUSEMOVE, i * 8, i * 4 );
+    ok( queued == 1, "%u events\n", queued );
+    /* and the next press too */
+    message( &state, WM_LBUTTONDOWN, 80, 40 );
+    ok( queued == 1, "%u events\n", queued );
+    /* but nothing after that, the next motion starts an event */
+    message( &state, WM_MOUSEMOVE, 88, 40 );
+    message( &state, WM_LBUTTONUP, 88, 40 );
+    message( &state, WM_LBUTTONDOWN, 88, 40 );
+    ok( queued == 3, "%u events\n", queued );
+
+    event = deliver();
+    ok( event->proc == CALLBACK_A, "proc %p\n", event->proc );
+    ok( event->mask == (MOUSE_MOTION | MOUSE_LEFT_DOWN), "mask %x\n", event->mask );
+    ok( event->x == 80 && event->y == 40 && event->but == 1, "event %d,%d %x\n", event->x, event->y, event->but );
+    ok( event->mx == 80 && event->my == 80, "mickeys %d,%d\n", event->mx, event->my );
+    event = deliver();
+    ok( event->mask == (MOUSE_MOTION | MOUSE_LEFT_UP) && event->x == 88 && !event->but,
+        "mask %x at %d buttons %x\n", event->mask, event->x, event->but );
+    event = deliver();
+    ok( event->mask == MOUSE_LEFT_DOWN && event->but == 1, "mask %x buttons %x\n", event->mask, event->but );
+    ok( !deliver(), "more events\n" );
+
+    /* a delivered event takes nothing more */
+    message( &state, WM_MOUSEMOVE, 96, 40 );
+    ok( deliver() != NULL, "no event\n" );
+    message( &state, WM_MOUSEMOVE, 104, 40 );
+    event = deliver();
+    ok( event && event->x == 104, "motion lost\n" );
+
+    /* a new callback gets its own events */
+    message( &state, WM_MOUSEMOVE, 112, 40 );
+    state.callback = CALLBACK_B;
+    message( &state, WM_MOUSEMOVE, 120, 40 );
+    ok( deliver()->proc == CALLBACK_A, "wrong proc\n" );
+    event = deliver();
+    ok( event->proc == CALLBACK_B && event->x == 120, "wrong event\n" );
+
+    /* only what the program asked for */
+    state.callmask = MOUSE_LEFT_DOWN;
+    message( &state, WM_MOUSEMOVE, 128, 40 );
+    message( &state, WM_RBUTTONDOWN, 128, 40 );
+    ok( !deliver(), "unwanted event\n" );
+    message( &state, WM_LBUTTONUP, 128, 40 );
+    message( &state, WM_LBUTTONDOWN, 136, 40 );
+    event = deliver();
+    ok( event && event->mask == MOUSE_LEFT_DOWN && event->x == 136 && event->but == 3, "wrong event\n" );
+}
+
+int main(void)
+{
+    test_before_reset();
+    test_reset();
+    test_range();
+    test_set_position();
+    test_mickeys();
+    test_buttons();
+    test_console();
+    test_exclude();
+    test_events();
+    return test_summary( "mouseinput" );
+}
@@ -0,0 +1,295 @@
+/*
+ * Tests of the NE icon directory cache (krnl386/iconcache.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "iconcache.h"
+#include "test.h"
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return flags & HEAP_ZERO_MEMORY ? calloc( 1, size ) : malloc( size );
+}
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+LONG WINAPI CompareFileTime( const FILETIME *a, const FILETIME *b )
+{
+    if (a->dwHighDateTime != b->dwHighDateTime) return a->dwHighDateTime < b->dwHighDateTime ? -1 : 1;
+    if (a->dwLowDateTime != b->dwLowDateTime) return a->dwLowDateTime < b->dwLowDateTime ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Sample NE files, laid out the way the resource compiler does it: the
+ * resource table right after the NE header, then the resources, each
+ * aligned to 1 << shift bytes. Every group icon has one entry, and the
+ * icon it refers to holds 32 bytes of its own id.
+ */
+#define NE_OFFSET    0x80
+#define RES_ID_BASE  100
+
+struct sample
+{
+    BYTE  *image;
+    DWORD  size;
+    DWORD  rsrctab;             /* file offset of the resource table */
+};
+
+static void put_word( BYTE *p, WORD val ) { p[0] = (BYTE)val; p[1] = val >> 8; }
+
+static struct sample build_sample( unsigned int groups, unsigned int icons, WORD shift, BOOL other_types )
+{
+    struct sample s;
+    IMAGE_DOS_HEADER *mz;
+    IMAGE_OS2_HEADER *ne;
+    BYTE *p;
+    DWORD rsrc_size, data, align = 1 << shift;
+    unsigned int i, j;
+
+    rsrc_size = 2 + (other_types ? 8 + 12 : 0) + 8 + groups * 12 + 8 + icons * 12 + 2;
+    data = (NE_OFFSET + sizeof(*ne) + rsrc_size + 2 + align - 1) & ~(align - 1);
+    s.size = data + (groups + icons) * ((32 + align - 1) & ~(align - 1));
+    s.image = calloc( 1, s.size );
+    s.rsrctab = NE_OFFSET + sizeof(*ne);
+
+    mz = (IMAGE_DOS_HEADER *)s.image;
+    mz->e_magic = IMAGE_DOS_SIGNATURE;
+    mz->e_lfanew = NE_OFFSET;
+    ne = (IMAGE_OS2_HEADER *)(s.image + NE_OFFSET);
+    ne->ne_magic = IMAGE_OS2_SIGNATURE;
+    ne->ne_rsrctab = sizeof(*ne);
+    ne->ne_restab = sizeof(*ne) + rsrc_size;
+
+    p = s.image + s.rsrctab;
+    put_word( p, shift );
+    p += 2;
+    if (other_types)
+    {
+        /* a string table first, so that the walk has to skip it */
+        put_word( p, NE_RSCTYPE_STRING );
+        put_word( p + 2, 1 );
+        p += 8;
+        put_word( p + 6, 0x8001 );
+        p += 12;
+    }
+    for (j = 0; j < 2; j++)
+    {
+        unsigned int count = j ? icons : groups;
+
+        put_word( p, j ? NE_RSCTYPE_ICON : NE_RSCTYPE_GROUP_ICON );
+        put_word( p + 2, count );
+        p += 8;
+        for (i = 0; i < count; i++, p += 12)
+        {
+            put_word( p, data >> shift );
+            put_word( p + 2, (32 + align - 1) >> shift );
+            put_word( p + 6, 0x8000 | (j ? RES_ID_BASE + i : i + 1) );
+            if (j) memset( s.image + data, RES_ID_BASE + i, 32 );
+            else
+            {
+                /* GRPICONDIR with one entry, nID is the last word */
+                put_word( s.image + data + 2, 1 );
+                put_word( s.image + data + 4, 1 );
+                put_word( s.image + data + 6 + 12, RES_ID_BASE + (icons ? i % icons : 0) );
+            }
+            data += (32 + align - 1) & ~(align - 1);
+        }
+    }
+    return s;
+}
+
+static FILETIME mtime = { 0x12345678, 0x01d00000 };
+
+static struct ne_icon_dir *parse( const struct sample *s, LPCSTR path )
+{
+    return ne_icon_dir_parse( s->image, s->size, path, s->size, &mtime );
+}
+
+/* the group icon of index and the icon it refers to */
+static BOOL check_icon( struct ne_icon_dir *dir, struct sample *s, unsigned int index, unsigned int expect )
+{
+    const NE_NAMEINFO *info;
+    BYTE *res;
+    ULONG size;
+
+    if (index >= dir->dir_count) return FALSE;
+    if (!(res = ne_icon_resource( s->image, s->size, dir->entries + index, dir->shift, &size ))) return FALSE;
+    if (!(info = ne_icon_dir_get_icon( dir, *(WORD *)(res + 6 + 12) ))) return FALSE;
+    if (!(res = ne_icon_resource( s->image, s->size, info, dir->shift, &size ))) return FALSE;
+    return size >= 32 && res[0] == RES_ID_BASE + expect && res[31] == RES_ID_BASE + expect;
+}
+
+static void test_samples(void)
+{
+    static const WORD shifts[] = { 0, 4, 9 };
+    struct ne_icon_dir *dir;
+    struct sample s;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(shifts); i++)
+    {
+        s = build_sample( 3, 5, shifts[i], i == 1 );
+        dir = parse( &s, "C:\\APPS\\SAMPLE.EXE" );
+        ok( dir != NULL, "shift %u: not parsed\n", shifts[i] );
+        ok( dir->shift == shifts[i], "shift %u: got %u\n", shifts[i], dir->shift );
+        ok( dir->dir_count == 3, "shift %u: %u groups\n", shifts[i], dir->dir_count );
+        ok( dir->icon_count == 5, "shift %u: %u icons\n", shifts[i], dir->icon_count );
+        ok( check_icon( dir, &s, 0, 0 ), "shift %u: wrong icon 0\n", shifts[i] );
+        ok( check_icon( dir, &s, 2, 2 ), "shift %u: wrong icon 2\n", shifts[i] );
+        ok( !check_icon( dir, &s, 3, 3 ), "shift %u: icon 3 found\n", shifts[i] );
+        ok( !ne_icon_dir_get_icon( dir, RES_ID_BASE + 5 ), "shift %u: unknown id found\n", shifts[i] );
+        free( s.image );
+    }
+}
+
+/* dummydll/dummydll.dll, a real NE file without resources */
+static void test_dummydll(void)
+{
+    struct ne_icon_dir *dir;
+    struct sample s;
+    FILE *f;
+
+    if (!(f = fopen( DUMMYDLL_PATH, "rb" )))
+    {
+        ok( 0, "can't open %s\n", DUMMYDLL_PATH );
+        return;
+    }
+    fseek( f, 0, SEEK_END );
+    s.size = ftell( f );
+    fseek( f, 0, SEEK_SET );
+    s.image = malloc( s.size );
+    ok( fread( s.image, 1, s.size, f ) == s.size, "short read\n" );
+    fclose( f );
+
+    ok( ((IMAGE_OS2_HEADER *)(s.image + ((IMAGE_DOS_HEADER *)s.image)->e_lfanew))->ne_magic == IMAGE_OS2_SIGNATURE,
+        "not an NE file\n" );
+    dir = parse( &s, "C:\\WINDOWS\\SYSTEM\\DUMMY.DLL" );
+    ok( dir != NULL, "not parsed\n" );
+    ok( !dir->dir_count && !dir->icon_count, "%u groups %u icons\n", dir->dir_count, dir->icon_count );
+    free( s.image );
+}
+
+static void test_broken(void)
+{
+    struct ne_icon_dir *dir;
+    struct sample s;
+    NE_NAMEINFO info;
+    ULONG size;
+    DWORD full;
+    BYTE *res;
+
+    /* truncated in the middle of the icon table: no icons */
+    s = build_sample( 2, 2, 4, FALSE );
+    full = s.size;
+    s.size = s.rsrctab + 2 + 8 + 2 * 12 + 8 + 12;
+    dir = parse( &s, "C:\\TRUNC1.EXE" );
+    ok( dir && !dir->dir_count, "%u groups\n", dir ? dir->dir_count : 0 );
+
+    /* truncated before the resource data: the table is fine, the data isn't */
+    s.size = full - 8;
+    dir = parse( &s, "C:\\TRUNC2.EXE" );
+    ok( dir && dir->dir_count == 2, "%u groups\n", dir ? dir->dir_count : 0 );
+    ok( ne_icon_resource( s.image, s.size, dir->entries, dir->shift, &size ) != NULL, "first group not found\n" );
+    ok( !ne_icon_resource( s.image, s.size, dir->entries + dir->dir_count + 1, dir->shift, &size ),
+        "last icon past the end found\n" );
+
+    /* offsets and shifts that point anywhere */
+    memset( &info, 0, sizeof(info) );
+    info.offset = 0xffff;
+    info.length = 0xffff;
+    ok( !ne_icon_resource( s.image, s.size, &info, 15, &size ), "huge resource found\n" );
+    info.offset = 1;
+    info.length = 1;
+    ok( !ne_icon_resource( s.image, s.size, &info, 40, &size ), "huge shift found\n" );
+    res = ne_icon_resource( s.image, s.size, &info, 4, &size );
+    ok( res == s.image + 16 && size == 16, "got %p %u\n", res, size );
+
+    /* resource table offset past the end of the file */
+    ((IMAGE_OS2_HEADER *)(s.image + NE_OFFSET))->ne_rsrctab = 0x7ff0;
+    ((IMAGE_OS2_HEADER *)(s.image + NE_OFFSET))->ne_restab = 0x7ff8;
+    dir = parse( &s, "C:\\RSRCTAB.EXE" );
+    ok( dir && !dir->dir_count, "%u groups\n", dir ? dir->dir_count : 0 );
+
+    /* e_lfanew past the end, and a PE file */
+    ((IMAGE_DOS_HEADER *)s.image)->e_lfanew = full;
+    dir = parse( &s, "C:\\LFANEW.EXE" );
+    ok( dir && !dir->dir_count, "%u groups\n", dir ? dir->dir_count : 0 );
+    ((IMAGE_DOS_HEADER *)s.image)->e_lfanew = NE_OFFSET;
+    ((IMAGE_OS2_HEADER *)(s.image + NE_OFFSET))->ne_magic = IMAGE_NT_SIGNATURE & 0xffff;
+    dir = parse( &s, "C:\\PE.EXE" );
+    ok( dir && !dir->dir_count, "%u groups\n", dir ? dir->dir_count : 0 );
+
+    /* group icons with an empty icon table are counted, but have no images */
+    free( s.image );
+    s = build_sample( 2, 0, 4, FALSE );
+    dir = parse( &s, "C:\\NOICONS.EXE" );
+    ok( dir && dir->dir_count == 2 && !dir->icon_count, "%u groups\n", dir ? dir->dir_count : 0 );
+    ok( !check_icon( dir, &s, 0, 0 ), "icon found\n" );
+    free( s.image );
+}
+
+static void test_cache(void)
+{
+    FILETIME newer = { mtime.dwLowDateTime + 1, mtime.dwHighDateTime };
+    struct ne_icon_dir *dir;
+    struct sample s;
+    char path[32];
+    int i;
+
+    s = build_sample( 4, 4, 4, FALSE );
+    dir = parse( &s, "C:\\PROGS\\WINFILE.EXE" );
+
+    /* found by path, case insensitive, as long as size and time match */
+    ok( ne_icon_dir_find( "c:\\progs\\winfile.exe", s.size, &mtime ) == dir, "not found\n" );
+    ok( ne_icon_dir_find( "C:\\PROGS\\WINFILE.EX", s.size, &mtime ) == NULL, "other path found\n" );
+    ok( ne_icon_dir_find( "C:\\PROGS\\WINFILE.EXE", s.size, &newer ) == NULL, "newer file found\n" );
+    /* and the stale entry is gone */
+    ok( ne_icon_dir_find( "C:\\PROGS\\WINFILE.EXE", s.size, &mtime ) == NULL, "stale entry found\n" );
+
+    dir = parse( &s, "C:\\PROGS\\WINFILE.EXE" );
+    ok( ne_icon_dir_find( "C:\\PROGS\\WINFILE.EXE", s.size + 1, &mtime ) == NULL, "bigger file found\n" );
+
+    /* the least recently used entries are dropped */
+    parse( &s, "C:\\FIRST.EXE" );
+    parse( &s, "C:\\SECOND.EXE" );
+    for (i = 0; i < NE_ICON_DIR_CACHE_SIZE - 2; i++)
+    {
+        sprintf( path, "C:\\FILE%d.EXE", i );
+        parse( &s, path );
+    }
+    ok( ne_icon_dir_find( "C:\\FIRST.EXE", s.size, &mtime ) != NULL, "first entry dropped\n" );
+    parse( &s, "C:\\ONE_MORE.EXE" );
+    ok( ne_icon_dir_find( "C:\\SECOND.EXE", s.size, &mtime ) == NULL, "second entry kept\n" );
+    ok( ne_icon_dir_find( "C:\\FIRST.EXE", s.size, &mtime ) != NULL, "first entry dropped\n" );
+    free( s.image );
+}
+
+int main(void)
+{
+    test_samples();
+    test_dummydll();
+    test_broken();
+    test_cache();
+    return test_summary( "neicons" );
+}
@@ -0,0 +1,347 @@
+/*
+ * Tests of the NE resource table index (krnl386/rsrcindex.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "rsrcindex.h"
+#include "test.h"
+
+static BOOL fail_heap;
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    if (fail_heap) return NULL;
+    return flags & HEAP_ZERO_MEMORY ? calloc( 1, size ) : malloc( size );
+}
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+#define ID(n) ((LPCSTR)(ULONG_PTR)(n))
+
+/* where the resource table is in the fake module */
+#define RSRCTAB 0x40
+
+/*
+ * Synthetic resource tables, laid out as in a loaded NE module: the
+ * alignment shift, the type sections, the terminating 0 and then the
+ * Pascal strings of the named types and resources. Consecutive entries
+ * of the same type share a section.
+ */
+struct entry
+{
+    LPCSTR type;
+    LPCSTR name;
+};
+
+struct table
+{
+    BYTE    data[0x8000];
+    HRSRC16 hRsrc[1024];        /* expected handle of each entry */
+};
+
+static BOOL same_id( LPCSTR a, LPCSTR b )
+{
+    if (!HIWORD(a) || !HIWORD(b)) return a == b;
+    return !strcasecmp( a, b );
+}
+
+static WORD table_id( struct table *table, WORD *strings, LPCSTR id )
+{
+    WORD ret = *strings;
+    BYTE len;
+
+    if (!HIWORD(id)) return LOWORD(id) | 0x8000;
+    len = strlen( id );
+    table->data[(*strings)++] = len;
+    memcpy( table->data + *strings, id, len );
+    *strings += len;
+    return ret;
+}
+
+static void build_table( struct table *table, const struct entry *entries, unsigned int count )
+{
+    NE_TYPEINFO *info = NULL;
+    WORD pos = 2, strings = 2;
+    unsigned int i, sections = 0;
+
+    for (i = 0; i < count; i++)
+        if (!i || !same_id( entries[i].type, entries[i - 1].type )) sections++;
+    strings = 2 + sections * sizeof(NE_TYPEINFO) + count * sizeof(NE_NAMEINFO) + 2;
+
+    memset( table->data, 0, sizeof(table->data) );
+    table->data[0] = 4;
+    for (i = 0; i < count; i++)
+    {
+        NE_NAMEINFO *name;
+
+        if (!info || !same_id( entries[i].type, entries[i - 1].type ))
+        {
+            info = (NE_TYPEINFO *)(table->data + pos);
+            info->type_id = table_id( table, &strings, entries[i].type );
+            pos += sizeof(*info);
+        }
+        info->count++;
+        name = (NE_NAMEINFO *)(table->data + pos);
+        name->id = table_id( table, &strings, entries[i].name );
+        name->offset = i;
+        table->hRsrc[i] = RSRCTAB + pos;
+        pos += sizeof(*name);
+    }
+    ok( strings <= sizeof(table->data), "table overflow\n" );
+}
+
+/* the linear search of FindResource16 */
+static HRSRC16 find_entry( const struct table *table, const struct entry *entries, unsigned int count,
+                           LPCSTR type, LPCSTR name )
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        if (same_id( entries[i].type, type ) && same_id( entries[i].name, name )) return table->hRsrc[i];
+    return 0;
+}
+
+static struct table table;
+
+static void check_lookup( struct ne_rsrc_index *index, const struct entry *entries, unsigned int count,
+                          LPCSTR type, LPCSTR name, int line )
+{
+    HRSRC16 expect = find_entry( &table, entries, count, type, name );
+    HRSRC16 got = ne_rsrc_index_lookup( index, table.data, type, name );
+
+    ok( got == expect, "line %d: %s %s found %04x, expected %04x\n", line,
+        HIWORD(type) ? type : "ordinal", HIWORD(name) ? name : "ordinal", got, expect );
+}
+#define check_lookup(type, name) check_lookup( index, entries, ARRAY_SIZE(entries), type, name, __LINE__ )
+
+static void test_lookup(void)
+{
+    static const struct entry entries[] =
+    {
+        { ID(3), ID(1) }, { ID(3), ID(2) }, { ID(3), "Logo" },
+        { ID(6), ID(1) }, { ID(6), ID(2) }, { ID(6), "12" },
+        { "BITMAPS", ID(12) }, { "BITMAPS", "Splash" },
+        { ID(14), "APPICON" },
+    };
+    struct ne_rsrc_index *index;
+
+    build_table( &table, entries, ARRAY_SIZE(entries) );
+    index = ne_rsrc_index_build( table.data, RSRCTAB );
+    ok( index != NULL, "build failed\n" );
+    ok( index->mask == 31, "mask %x\n", index->mask );
+
+    /* every entry by type and name */
+    ok( ne_rsrc_index_lookup( index, table.data, ID(3), ID(1) ) == RSRCTAB + 2 + sizeof(NE_TYPEINFO), "wrong handle\n" );
+    check_lookup( ID(3), ID(2) );
+    check_lookup( ID(3), "Logo" );
+    check_lookup( ID(6), ID(1) );
+    check_lookup( ID(6), ID(2) );
+    check_lookup( ID(6), "12" );
+    check_lookup( "BITMAPS", ID(12) );
+    check_lookup( "BITMAPS", "Splash" );
+    check_lookup( ID(14), "APPICON" );
+
+    /* names are compared case-insensitively */
+    check_lookup( "bitmaps", "SPLASH" );
+    check_lookup( ID(3), "lOGO" );
+    ok( ne_rsrc_index_lookup( index, table.data, "Bitmaps", "splash" ) != 0, "not found\n" );
+
+    /* an ordinal never matches a string of its digits, "#12" is converted by the caller */
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(6), ID(12) ), "found ordinal 12\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "BITMAPS", "12" ), "found string 12\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "14", "APPICON" ), "found type string 14\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(3), "1" ), "found string 1\n" );
+
+    /* missing types and names */
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(4), ID(1) ), "found type 4\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(3), ID(3) ), "found name 3\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(14), ID(1) ), "found name 1\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "BITMAP", "Splash" ), "found prefix of type\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "BITMAPS", "Splash2" ), "found longer name\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "BITMAPS", "" ), "found empty name\n" );
+    ne_rsrc_index_free( index );
+}
+
+static void test_duplicates(void)
+{
+    /* the same resource twice, and again in a later section of its type */
+    static const struct entry entries[] =
+    {
+        { ID(6), ID(1) }, { ID(6), "Help" }, { ID(6), ID(1) }, { ID(6), "HELP" },
+        { ID(3), ID(1) },
+        { ID(6), ID(1) }, { ID(6), ID(2) },
+        { "DATA", ID(1) }, { "data", ID(1) },
+    };
+    struct ne_rsrc_index *index;
+
+    build_table( &table, entries, ARRAY_SIZE(entries) );
+    index = ne_rsrc_index_build( table.data, RSRCTAB );
+
+    /* the first one wins */
+    ok( ne_rsrc_index_lookup( index, table.data, ID(6), ID(1) ) == table.hRsrc[0], "not the first\n" );
+    ok( ne_rsrc_index_lookup( index, table.data, ID(6), "help" ) == table.hRsrc[1], "not the first\n" );
+    ok( ne_rsrc_index_lookup( index, table.data, ID(6), ID(2) ) == table.hRsrc[6], "not found\n" );
+    check_lookup( ID(3), ID(1) );
+    check_lookup( "Data", ID(1) );
+    ne_rsrc_index_free( index );
+}
+
+static void test_collisions(void)
+{
+    /*
+     * Types 1 and 2 with names 0x21 and 0 have the same hash, as have
+     * the names "B!" and "A@".
+     */
+    static const struct entry entries[] =
+    {
+        { ID(1), ID(0x21) }, { ID(2), ID(0) },
+        { "T", "B!" }, { "T", "A@" }, { "T", "" },
+    };
+    static const struct entry absent[] =
+    {
+        { ID(1), ID(0x21) },
+        { "T", "B!" },
+    };
+    struct ne_rsrc_index *index;
+    unsigned int i, j, used = 0, same = 0;
+
+    build_table( &table, entries, ARRAY_SIZE(entries) );
+    index = ne_rsrc_index_build( table.data, RSRCTAB );
+    for (i = 0; i <= index->mask; i++)
+    {
+        if (!index->elem[i].hRsrc) continue;
+        used++;
+        for (j = 0; j < i; j++)
+            if (index->elem[j].hRsrc && index->elem[j].hash == index->elem[i].hash) same++;
+    }
+    ok( used == ARRAY_SIZE(entries), "%u entries indexed\n", used );
+    ok( same == 2, "%u colliding pairs\n", same );
+
+    check_lookup( ID(1), ID(0x21) );
+    check_lookup( ID(2), ID(0) );
+    check_lookup( "T", "B!" );
+    check_lookup( "T", "A@" );
+    check_lookup( "t", "a@" );
+    check_lookup( "T", "" );
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(1), ID(0) ), "found type 1 name 0\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "T", "C" ), "found C\n" );
+    ne_rsrc_index_free( index );
+
+    /* a colliding key that isn't in the table */
+    build_table( &table, absent, ARRAY_SIZE(absent) );
+    index = ne_rsrc_index_build( table.data, RSRCTAB );
+    ok( ne_rsrc_index_lookup( index, table.data, ID(1), ID(0x21) ) == table.hRsrc[0], "not found\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(2), ID(0) ), "found type 2 name 0\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "T", "A@" ), "found A@\n" );
+    ne_rsrc_index_free( index );
+}
+
+/* a full table probes around the end of the hash table */
+static void test_random(void)
+{
+    static const char *names[] = { "A", "b", "B", "AB", "ab", "B!", "A@", "Icon", "ICON", "1", "12" };
+    static struct entry entries[1000];
+    struct ne_rsrc_index *index;
+    unsigned int round, count, i, bad;
+
+    for (round = 0; round < 50; round++)
+    {
+        count = 1 + test_rand() % ARRAY_SIZE(entries);
+        for (i = 0; i < count; i++)
+        {
+            entries[i].type = test_rand() % 4 ? ID(1 + test_rand() % 8) : names[test_rand() % ARRAY_SIZE(names)];
+            entries[i].name = test_rand() % 4 ? ID(test_rand() % 300) : names[test_rand() % ARRAY_SIZE(names)];
+        }
+        build_table( &table, entries, count );
+        index = ne_rsrc_index_build( table.data, RSRCTAB );
+        ok( index->mask + 1 >= count * 2, "%u slots for %u resources\n", index->mask + 1, count );
+
+        bad = 0;
+        for (i = 0; i < count; i++)
+            if (ne_rsrc_index_lookup( index, table.data, entries[i].type, entries[i].name ) !=
+                find_entry( &table, entries, count, entries[i].type, entries[i].name )) bad++;
+        for (i = 0; i < 1000; i++)
+        {
+            LPCSTR type = test_rand() % 2 ? ID(test_rand() % 10) : names[test_rand() % ARRAY_SIZE(names)];
+            LPCSTR name = test_rand() % 2 ? ID(test_rand() % 400) : names[test_rand() % ARRAY_SIZE(names)];
+
+            if (ne_rsrc_index_lookup( index, table.data, type, name ) !=
+                find_entry( &table, entries, count, type, name )) bad++;
+        }
+        ok( !bad, "round %u: %u lookups differ from the linear search\n", round, bad );
+        ne_rsrc_index_free( index );
+    }
+}
+
+static void test_empty(void)
+{
+    struct ne_rsrc_index *index;
+
+    build_table( &table, NULL, 0 );
+    index = ne_rsrc_index_build( table.data, RSRCTAB );
+    ok( index != NULL && index->mask == 15, "empty index %p\n", index );
+    ok( !ne_rsrc_index_lookup( index, table.data, ID(1), ID(1) ), "found a resource\n" );
+    ok( !ne_rsrc_index_lookup( index, table.data, "A", "B" ), "found a resource\n" );
+    ne_rsrc_index_free( index );
+
+    fail_heap = TRUE;
+    ok( !ne_rsrc_index_build( table.data, RSRCTAB ), "built without memory\n" );
+    fail_heap = FALSE;
+}
+
+static void test_strings(void)
+{
+    struct ne_rsrc_index *index;
+    HRSRC16 i;
+
+    build_table( &table, NULL, 0 );
+    index = ne_rsrc_index_build( table.data, RSRCTAB );
+    ok( ne_rsrc_index_find_string( index, 0x100 ) < 0, "found a block\n" );
+
+    ne_rsrc_index_add_string( index, 0 );
+    ok( index->next_string == 0, "added handle 0\n" );
+    ne_rsrc_index_add_string( index, 0x100 );
+    ne_rsrc_index_add_string( index, 0x100 );
+    ok( index->next_string == 1, "added twice\n" );
+    ok( ne_rsrc_index_find_string( index, 0x100 ) == 0, "not found\n" );
+
+    /* the oldest block is dropped */
+    for (i = 1; i <= NE_RSRC_STRCACHE_SIZE; i++) ne_rsrc_index_add_string( index, 0x100 + i * 12 );
+    ok( ne_rsrc_index_find_string( index, 0x100 ) < 0, "oldest block kept\n" );
+    for (i = 1; i <= NE_RSRC_STRCACHE_SIZE; i++)
+        ok( ne_rsrc_index_find_string( index, 0x100 + i * 12 ) >= 0, "block %u dropped\n", i );
+    ne_rsrc_index_free( index );
+}
+
+int main(void)
+{
+    test_lookup();
+    test_duplicates();
+    test_collisions();
+    test_random();
+    test_empty();
+    test_strings();
+    return test_summary( "rsrcindex" );
+}
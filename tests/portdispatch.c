@@ -0,0 +1,313 @@
+/*
+ * Tests of the I/O port dispatch (krnl386/ioports.c) with the PIT, PIC
+ * and VGA DAC (krnl386/vgahw.c) behind it
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "dosexe.h"
+#include "vga.h"
+#include "vgahw.h"
+#include "test.h"
+
+HANDLE test_process_heap = (HANDLE)1;
+
+/* devices and services the ports lead to, recording what reaches them */
+
+static LONGLONG clock_ticks;
+static UINT timer_ticks;
+static int timer_calls;
+static DWORD beep_freq;
+static BYTE pic_writes[16][2];
+static int pic_count;
+static BYTE other_vga_writes[16][2];
+static int other_vga_count;
+static PALETTEENTRY palette[256];
+static int palette_calls;
+static int hooked_port = -1;
+
+BOOL DOSMEM_InitDosMemory(void) { return TRUE; }
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size ) { return calloc( 1, size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+BOOL WINAPI QueryPerformanceCounter( LARGE_INTEGER *counter )
+{
+    counter->QuadPart = clock_ticks;
+    return TRUE;
+}
+
+BOOL WINAPI Beep( DWORD freq, DWORD duration )
+{
+    beep_freq = freq;
+    return TRUE;
+}
+
+void DOSVM_SetTimer( UINT ticks )
+{
+    timer_ticks = ticks;
+    timer_calls++;
+}
+
+void DOSVM_PIC_ioport_out( WORD port, BYTE val )
+{
+    if (pic_count < 16)
+    {
+        pic_writes[pic_count][0] = port;
+        pic_writes[pic_count][1] = val;
+    }
+    pic_count++;
+}
+
+void DMA_ioport_out( WORD port, BYTE val ) { }
+BYTE DMA_ioport_in( WORD port ) { return 0; }
+void SB_ioport_out( WORD port, BYTE val ) { }
+BYTE SB_ioport_in( WORD port ) { return 0; }
+BYTE DOSVM_Int09ReadScan( BYTE *ascii ) { return 0x1c; }
+
+BOOL vdd_io_hooked( int port ) { return port == hooked_port; }
+BOOL vdd_io_read( int port, int size, WORD *val, CONTEXT *ctx ) { return FALSE; }
+
+BOOL vdd_io_write( int port, int size, WORD val, CONTEXT *ctx )
+{
+    return port == hooked_port;
+}
+
+/* the DAC ports as decoded by vga.c */
+void VGA_ioport_out( WORD port, BYTE val )
+{
+    if (port == 0x3c8) VGA_DacSetWriteIndex( val );
+    else if (port == 0x3c9) VGA_DacWrite( val );
+    else if (other_vga_count < 16)
+    {
+        other_vga_writes[other_vga_count][0] = port & 0xff;
+        other_vga_writes[other_vga_count++][1] = val;
+    }
+}
+
+void VGA_ioport_out_block( WORD port, const BYTE *data, DWORD count )
+{
+    if (port == 0x3c9)
+        VGA_DacWriteBlock( data, count );
+    else
+        while (count--) VGA_ioport_out( port, *data++ );
+}
+
+BYTE VGA_ioport_in( WORD port ) { return 0; }
+
+void VGA_SetPalette( PALETTEENTRY *pal, int start, int len )
+{
+    ok( start >= 0 && len > 0 && start + len <= 256, "palette range %d+%d\n", start, len );
+    if (start >= 0 && len > 0 && start + len <= 256)
+        memcpy( palette + start, pal, len * sizeof(*pal) );
+    palette_calls++;
+}
+
+static void outb( int port, BYTE value )
+{
+    DOSVM_outport( port, 1, value, NULL );
+}
+
+static BYTE inb( int port )
+{
+    return DOSVM_inport( port, 1, NULL );
+}
+
+static void test_pit(void)
+{
+    WORD count;
+    BYTE status;
+
+    /* channel 0, lo/hi, mode 3: the divisor is set once both bytes arrived */
+    timer_calls = 0;
+    outb( 0x43, 0x36 );
+    outb( 0x40, 0x9c );
+    ok( timer_calls == 0, "timer set after the low byte\n" );
+    outb( 0x40, 0x2e );
+    ok( timer_calls == 1 && timer_ticks == 0x2e9c, "got %d calls, %x ticks\n", timer_calls, timer_ticks );
+
+    /* a running count in mode 2, latched and read back lo/hi */
+    clock_ticks = 1000;
+    outb( 0x43, 0x34 );
+    outb( 0x40, 0x00 );
+    outb( 0x40, 0x10 );
+    ok( timer_ticks == 0x1000, "got %x ticks\n", timer_ticks );
+    clock_ticks += 0x123;
+    outb( 0x43, 0x00 );
+    clock_ticks += 0x100; /* the latch holds the old count */
+    count = inb( 0x40 );
+    count |= inb( 0x40 ) << 8;
+    ok( count == 0x1000 - 0x123, "latched count %x\n", count );
+    count = inb( 0x40 );
+    count |= inb( 0x40 ) << 8;
+    ok( count == 0x1000 - 0x223, "running count %x\n", count );
+
+    /* read-back of the channel 0 status without latching the count */
+    outb( 0x43, 0xe2 );
+    status = inb( 0x40 );
+    ok( status == 0x34, "status %02x\n", status );
+
+    /* low byte only in BCD: 0x50 is 50 ticks */
+    outb( 0x43, 0x11 );
+    outb( 0x40, 0x50 );
+    ok( timer_ticks == 50, "got %u ticks\n", timer_ticks );
+
+    /* channel 2 drives the speaker once it is gated on */
+    beep_freq = 0;
+    outb( 0x61, 0x03 );
+    outb( 0x43, 0xb6 );
+    outb( 0x42, 0xa9 );
+    outb( 0x42, 0x04 );
+    ok( beep_freq == 1193180 / 0x4a9, "beep %u\n", beep_freq );
+    ok( inb( 0x61 ) == 0x03, "port 61 %02x\n", inb( 0x61 ) );
+    outb( 0x61, 0x00 );
+}
+
+static DWORD callback_value;
+
+static void WINAPI port_callback( int port, int size, DWORD value )
+{
+    callback_value = value;
+}
+
+static void test_pic(void)
+{
+    OUTPROC old_out;
+    INPROC old_in;
+
+    /* non specific and specific EOI */
+    pic_count = 0;
+    outb( 0x20, 0x20 );
+    outb( 0x20, 0x61 );
+    ok( pic_count == 2, "got %d writes\n", pic_count );
+    ok( pic_writes[0][0] == 0x20 && pic_writes[0][1] == 0x20, "got %02x to %02x\n", pic_writes[0][1], pic_writes[0][0] );
+    ok( pic_writes[1][0] == 0x20 && pic_writes[1][1] == 0x61, "got %02x to %02x\n", pic_writes[1][1], pic_writes[1][0] );
+
+    /* the mask register isn't emulated, a word write reaches the command port only */
+    pic_count = 0;
+    DOSVM_outport( 0x20, 2, 0xff20, NULL );
+    ok( pic_count == 1 && pic_writes[0][1] == 0x20, "got %d writes\n", pic_count );
+    outb( 0x21, 0xfe );
+    ok( pic_count == 1, "got %d writes\n", pic_count );
+
+    /* a string of EOIs goes one by one */
+    pic_count = 0;
+    DOSVM_outport_block( 0x20, 1, "\x20\x20\x20", 3, NULL );
+    ok( pic_count == 3, "got %d writes\n", pic_count );
+
+    /* VDD hooks and port callbacks come before the built-in device */
+    pic_count = 0;
+    hooked_port = 0x20;
+    outb( 0x20, 0x20 );
+    hooked_port = -1;
+    ok( pic_count == 0, "hooked write reached the PIC\n" );
+    DOSVM_setportcb( port_callback, NULL, 0x20, &old_out, &old_in );
+    outb( 0x20, 0x20 );
+    ok( pic_count == 0 && callback_value == 0x20, "callback not called\n" );
+    DOSVM_setportcb( old_out, old_in, 0x20, &old_out, &old_in );
+    outb( 0x20, 0x20 );
+    ok( pic_count == 1, "got %d writes\n", pic_count );
+}
+
+/* write the palette as byte writes and as one string, the results must match */
+static void test_dac(void)
+{
+    static BYTE data[3 * 300 + 1];
+    PALETTEENTRY expect[256];
+    unsigned int i;
+    int calls;
+
+    for (i = 0; i < sizeof(data); i++) data[i] = test_rand() & 0x3f;
+
+    /* one entry */
+    palette_calls = 0;
+    outb( 0x3c8, 5 );
+    outb( 0x3c9, 0x3f );
+    outb( 0x3c9, 0x20 );
+    ok( palette_calls == 0, "entry stored before its blue component\n" );
+    outb( 0x3c9, 0x01 );
+    ok( palette_calls == 1, "got %d calls\n", palette_calls );
+    ok( palette[5].peRed == 0xfc && palette[5].peGreen == 0x80 && palette[5].peBlue == 0x04,
+        "got %02x %02x %02x\n", palette[5].peRed, palette[5].peGreen, palette[5].peBlue );
+    outb( 0x3c9, 1 );
+    outb( 0x3c9, 2 );
+    outb( 0x3c9, 3 );
+    ok( palette[6].peRed == 4 && palette[6].peGreen == 8 && palette[6].peBlue == 12, "next entry not written\n" );
+
+    /* a word write sets the index and the first component */
+    DOSVM_outport( 0x3c8, 2, 0x2a00 | 7, NULL );
+    outb( 0x3c9, 0 );
+    outb( 0x3c9, 0 );
+    ok( palette[7].peRed == 0xa8, "got %02x\n", palette[7].peRed );
+
+    /* byte by byte, starting with a partial entry and wrapping past 255 */
+    outb( 0x3c8, 0x10 );
+    outb( 0x3c9, 0x11 );
+    for (i = 0; i < sizeof(data); i++) outb( 0x3c9, data[i] );
+    memcpy( expect, palette, sizeof(expect) );
+
+    memset( palette, 0, sizeof(palette) );
+    outb( 0x3c8, 0x10 );
+    outb( 0x3c9, 0x11 );
+    palette_calls = 0;
+    DOSVM_outport_block( 0x3c9, 1, data, sizeof(data), NULL );
+    calls = palette_calls;
+    ok( !memcmp( palette + 0x10, expect + 0x10, (256 - 0x10) * sizeof(*palette) ), "string write differs\n" );
+    ok( !memcmp( palette, expect, 60 * sizeof(*palette) ), "wrapped entries differ\n" );
+    ok( calls <= 4, "string write took %d palette calls\n", calls );
+
+    /* the two leftover components belong to the next entry */
+    palette_calls = 0;
+    outb( 0x3c9, 0x3f );
+    ok( palette_calls == 1, "got %d calls\n", palette_calls );
+
+    /* other VGA ports in a string still go one by one */
+    other_vga_count = 0;
+    DOSVM_outport_block( 0x3c4, 1, "\x02\x0f", 2, NULL );
+    ok( other_vga_count == 2 && other_vga_writes[1][1] == 0x0f, "got %d writes\n", other_vga_count );
+}
+
+static void test_cmos(void)
+{
+    outb( 0x70, 0x0e );
+    outb( 0x71, 0x55 );
+    outb( 0x70, 0x0f );
+    outb( 0x71, 0xaa );
+    outb( 0x70, 0x0e );
+    ok( inb( 0x71 ) == 0x55, "wrong CMOS byte\n" );
+    ok( inb( 0x70 ) == 0x0e, "wrong CMOS address\n" );
+    /* a word read covers the address and data port */
+    ok( DOSVM_inport( 0x70, 2, NULL ) == 0x550e, "got %x\n", DOSVM_inport( 0x70, 2, NULL ) );
+    /* ports nobody claims read as all ones */
+    ok( inb( 0x300 ) == 0xff, "got %02x\n", inb( 0x300 ) );
+    ok( DOSVM_inport( 0x300, 2, NULL ) == 0xffff, "got %x\n", DOSVM_inport( 0x300, 2, NULL ) );
+}
+
+int main(void)
+{
+    test_pit();
+    test_pic();
+    test_dac();
+    test_cmos();
+    return test_summary( "ioports" );
+}
@@ -0,0 +1,340 @@
+/*
+ * Tests of the profile cache (krnl386/inicache.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "winreg.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "inicache.h"
+#include "test.h"
+
+#include <shlwapi.h>
+
+/*
+ * Fake host: a few .INI files held as lists of entries, and counters of
+ * the host calls the cache makes.
+ */
+#define MAX_FILES    2
+#define MAX_ENTRIES  128
+
+static const char file_a[] = "C:\\WINDOWS\\A.INI", file_b[] = "C:\\WINDOWS\\B.INI";
+
+struct fake_entry
+{
+    char section[32];
+    char entry[32];
+    char value[64];
+};
+
+static struct fake_file
+{
+    const char *path;
+    BOOL  exists;
+    BOOL  readonly;
+    DWORD mtime;
+    struct fake_entry entries[MAX_ENTRIES];
+    unsigned int count;
+} files[MAX_FILES] = { { file_a }, { file_b } };
+
+static unsigned int host_reads, host_writes, host_stats;
+static DWORD tick = 1000;
+static BOOL dir_changed;
+static char write_log[1024];
+
+HANDLE test_process_heap = (HANDLE)1;
+
+static struct fake_file *get_fake_file( LPCSTR path )
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_FILES; i++) if (!strcasecmp( files[i].path, path )) return &files[i];
+    return NULL;
+}
+
+static struct fake_entry *get_fake_entry( struct fake_file *file, LPCSTR section, LPCSTR entry )
+{
+    unsigned int i;
+
+    for (i = 0; i < file->count; i++)
+        if (!strcasecmp( file->entries[i].section, section ) && !strcasecmp( file->entries[i].entry, entry ))
+            return &file->entries[i];
+    return NULL;
+}
+
+/* change a file behind the cache's back */
+static void set_value( const char *path, LPCSTR section, LPCSTR entry, LPCSTR value )
+{
+    struct fake_file *file = get_fake_file( path );
+    struct fake_entry *e = get_fake_entry( file, section, entry );
+
+    if (!e)
+    {
+        e = &file->entries[file->count++];
+        strcpy( e->section, section );
+        strcpy( e->entry, entry );
+    }
+    strcpy( e->value, value );
+    file->exists = TRUE;
+    file->mtime++;
+}
+
+INT WINAPI GetPrivateProfileStringA( LPCSTR section, LPCSTR entry, LPCSTR def, LPSTR buffer, UINT len, LPCSTR path )
+{
+    struct fake_file *file = get_fake_file( path );
+    struct fake_entry *e = file ? get_fake_entry( file, section, entry ) : NULL;
+    LPCSTR value = e ? e->value : def;
+    DWORD size = min( strlen( value ), len - 1 );
+
+    host_reads++;
+    memcpy( buffer, value, size );
+    buffer[size] = 0;
+    return size;
+}
+
+UINT WINAPI GetPrivateProfileIntA( LPCSTR section, LPCSTR entry, INT def, LPCSTR path )
+{
+    struct fake_file *file = get_fake_file( path );
+    struct fake_entry *e = file ? get_fake_entry( file, section, entry ) : NULL;
+
+    host_reads++;
+    return e ? atoi( e->value ) : def;
+}
+
+BOOL WINAPI WritePrivateProfileStringA( LPCSTR section, LPCSTR entry, LPCSTR string, LPCSTR path )
+{
+    struct fake_file *file = get_fake_file( path );
+    struct fake_entry *e;
+
+    host_writes++;
+    sprintf( write_log + strlen( write_log ), "%s=%s;", entry, string ? string : "(null)" );
+    if (string) set_value( path, section, entry, string );
+    else if ((e = get_fake_entry( file, section, entry )))
+    {
+        *e = file->entries[--file->count];
+        file->mtime++;
+    }
+    return TRUE;
+}
+
+BOOL WINAPI GetFileAttributesExA( LPCSTR path, GET_FILEEX_INFO_LEVELS level, void *info )
+{
+    struct fake_file *file = get_fake_file( path );
+    WIN32_FILE_ATTRIBUTE_DATA *data = info;
+
+    host_stats++;
+    if (!file || !file->exists) return FALSE;
+    memset( data, 0, sizeof(*data) );
+    data->dwFileAttributes = file->readonly ? FILE_ATTRIBUTE_READONLY : FILE_ATTRIBUTE_ARCHIVE;
+    data->ftLastWriteTime.dwLowDateTime = file->mtime;
+    data->nFileSizeLow = file->count;
+    return TRUE;
+}
+
+LONG WINAPI CompareFileTime( const FILETIME *a, const FILETIME *b )
+{
+    if (a->dwLowDateTime == b->dwLowDateTime) return 0;
+    return a->dwLowDateTime < b->dwLowDateTime ? -1 : 1;
+}
+
+DWORD WINAPI GetFullPathNameA( LPCSTR name, DWORD len, LPSTR buffer, LPSTR *file_part )
+{
+    strcpy( buffer, name );
+    *file_part = strrchr( buffer, '\\' ) ? strrchr( buffer, '\\' ) + 1 : NULL;
+    return strlen( buffer );
+}
+
+BOOL WINAPI PathIsRelativeA( LPCSTR path ) { return !path[0] || path[1] != ':'; }
+
+LPSTR WINAPI PathFindFileNameA( LPCSTR path )
+{
+    return (LPSTR)(strrchr( path, '\\' ) ? strrchr( path, '\\' ) + 1 : path);
+}
+
+HANDLE WINAPI FindFirstChangeNotificationA( LPCSTR path, BOOL subtree, DWORD filter ) { return (HANDLE)0x10; }
+BOOL WINAPI FindNextChangeNotification( HANDLE handle ) { dir_changed = FALSE; return TRUE; }
+BOOL WINAPI FindCloseChangeNotification( HANDLE handle ) { return TRUE; }
+
+DWORD WINAPI WaitForSingleObject( HANDLE handle, DWORD timeout )
+{
+    return dir_changed ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+
+LSTATUS WINAPI RegOpenKeyExA( HKEY hkey, LPCSTR name, DWORD options, REGSAM access, PHKEY result )
+{
+    return ERROR_FILE_NOT_FOUND;
+}
+LSTATUS WINAPI RegEnumValueA( HKEY hkey, DWORD index, LPSTR name, LPDWORD name_len, LPDWORD reserved,
+                              LPDWORD type, LPBYTE data, LPDWORD count ) { return ERROR_NO_MORE_ITEMS; }
+LSTATUS WINAPI RegCloseKey( HKEY hkey ) { return ERROR_SUCCESS; }
+
+DWORD WINAPI GetTickCount(void) { return tick; }
+void WINAPI EnterCriticalSection( CRITICAL_SECTION *cs ) {}
+void WINAPI LeaveCriticalSection( CRITICAL_SECTION *cs ) {}
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return flags & HEAP_ZERO_MEMORY ? calloc( 1, size ) : malloc( size );
+}
+LPVOID WINAPI HeapReAlloc( HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size ) { return realloc( ptr, size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+static void get_string( const char *path, LPCSTR section, LPCSTR entry, const char *expect )
+{
+    char buffer[64];
+
+    ini_cache_get_string( section, entry, "def", buffer, sizeof(buffer), path );
+    ok( !strcmp( buffer, expect ), "[%s] %s: got %s, expected %s\n", section, entry, buffer, expect );
+}
+
+static void reset_counters(void)
+{
+    host_reads = host_writes = host_stats = 0;
+    write_log[0] = 0;
+}
+
+static void test_lookup(void)
+{
+    set_value( file_a, "Sec", "Key", "value" );
+    set_value( file_a, "Sec", "Num", "42" );
+
+    reset_counters();
+    get_string( file_a, "Sec", "Key", "value" );
+    get_string( file_a, "SEC", "key", "value" );
+    ok( host_reads == 1, "got %u host reads\n", host_reads );
+    get_string( file_a, "Sec", "Missing", "def" );
+    get_string( file_a, "Sec", "Missing", "def" );
+    ok( ini_cache_get_int( "Sec", "Num", 0, file_a ) == 42, "wrong int\n" );
+    ok( ini_cache_get_int( "Sec", "Num", 0, file_a ) == 42, "wrong int\n" );
+    ok( host_reads == 3, "got %u host reads\n", host_reads );
+}
+
+static void test_stat_interval(void)
+{
+    reset_counters();
+    get_string( file_a, "Sec", "Key", "value" );
+    get_string( file_a, "Sec", "Key", "value" );
+    ok( !host_stats, "file checked %u times within the interval\n", host_stats );
+
+    /* changed without a notification: found when the interval expires */
+    set_value( file_a, "Sec", "Key", "other" );
+    get_string( file_a, "Sec", "Key", "value" );
+    tick += INI_CACHE_STAT_INTERVAL;
+    get_string( file_a, "Sec", "Key", "other" );
+    ok( host_stats == 1, "got %u stats\n", host_stats );
+
+    /* a notification is seen at once */
+    set_value( file_a, "Sec", "Key", "third" );
+    dir_changed = TRUE;
+    get_string( file_a, "Sec", "Key", "third" );
+    ok( !dir_changed, "notification not rearmed\n" );
+}
+
+static void test_write_back(void)
+{
+    char name[16];
+    unsigned int i;
+
+    reset_counters();
+    get_string( file_a, "Sec", "Key", "third" );
+    ok( ini_cache_write_string( "Sec", "New1", "1", file_a ), "write not held back\n" );
+    ok( ini_cache_write_string( "Sec", "New2", "2", file_a ), "write not held back\n" );
+    ok( ini_cache_write_string( "Sec", "New1", "one", file_a ), "write not held back\n" );
+    ok( ini_cache_write_string( "Sec", "Num", NULL, file_a ), "delete not held back\n" );
+    ok( !host_writes, "got %u host writes\n", host_writes );
+
+    /* other entries still come from the cache */
+    get_string( file_a, "Sec", "Key", "third" );
+    ok( !host_writes && !host_reads, "got %u writes, %u reads\n", host_writes, host_reads );
+
+    /* reading back a pending entry writes the file, merged and in order */
+    get_string( file_a, "Sec", "new1", "one" );
+    ok( host_writes == 3, "got %u host writes\n", host_writes );
+    ok( !strcmp( write_log, "New1=one;New2=2;Num=(null);" ), "got %s\n", write_log );
+    ok( ini_cache_get_int( "Sec", "Num", -1, file_a ) == -1, "entry not deleted\n" );
+
+    /* explicit flush */
+    reset_counters();
+    ok( ini_cache_write_string( "Sec", "New2", "two", file_a ), "write not held back\n" );
+    ok( ini_cache_write_back( file_b ) && !host_writes, "flushing another file wrote %u\n", host_writes );
+    ok( ini_cache_write_back( file_a ) && host_writes == 1, "got %u host writes\n", host_writes );
+    ok( ini_cache_write_back( file_a ) && host_writes == 1, "got %u host writes\n", host_writes );
+
+    /* old writes go out at the next call */
+    reset_counters();
+    ok( ini_cache_write_string( "Sec", "New2", "2", file_a ), "write not held back\n" );
+    tick += INI_CACHE_WRITE_DELAY - 1;
+    get_string( file_a, "Sec", "Key", "third" );
+    ok( !host_writes, "written too early\n" );
+    tick++;
+    get_string( file_a, "Sec", "Key", "third" );
+    ok( host_writes == 1, "got %u host writes\n", host_writes );
+
+    /* and so do many writes */
+    reset_counters();
+    for (i = 0; i < INI_CACHE_MAX_WRITES; i++)
+    {
+        sprintf( name, "Many%u", i );
+        ini_cache_write_string( "Many", name, "x", file_a );
+    }
+    ok( host_writes == INI_CACHE_MAX_WRITES, "got %u host writes\n", host_writes );
+
+    /* files that can't be written are written through */
+    ok( !ini_cache_write_string( "Sec", "Key", "x", file_b ), "write to a missing file held back\n" );
+    set_value( file_b, "Sec", "Key", "b" );
+    files[1].readonly = TRUE;
+    tick += INI_CACHE_STAT_INTERVAL;
+    ok( !ini_cache_write_string( "Sec", "Key", "x", file_b ), "write to a read-only file held back\n" );
+    files[1].readonly = FALSE;
+    tick += INI_CACHE_STAT_INTERVAL;
+}
+
+static void test_invalidate(void)
+{
+    get_string( file_a, "Sec", "Key", "third" );
+    get_string( file_b, "Sec", "Key", "b" );
+    ok( ini_cache_write_string( "Sec", "Key", "pending", file_a ), "write not held back\n" );
+
+    /* the invalidated file is written first, the other one stays cached */
+    reset_counters();
+    ini_cache_invalidate( file_a );
+    ok( host_writes == 1, "pending write lost, %u host writes\n", host_writes );
+    get_string( file_b, "Sec", "Key", "b" );
+    ok( !host_reads, "other file invalidated\n" );
+    get_string( file_a, "Sec", "Key", "pending" );
+    ok( host_reads == 1, "got %u host reads\n", host_reads );
+
+    reset_counters();
+    ok( ini_cache_write_string( "Sec", "Key", "last", file_b ), "write not held back\n" );
+    ini_cache_invalidate( NULL );
+    ok( host_writes == 1, "pending write lost, %u host writes\n", host_writes );
+    get_string( file_a, "Sec", "Key", "pending" );
+    get_string( file_b, "Sec", "Key", "last" );
+    ok( host_reads == 2, "got %u host reads\n", host_reads );
+}
+
+int main(void)
+{
+    test_lookup();
+    test_stat_interval();
+    test_write_back();
+    test_invalidate();
+    return test_summary( "profilecache" );
+}
@@ -0,0 +1,194 @@
+/*
+ * Tests of the registry cache bookkeeping (krnl386/regcache.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "regcache.h"
+#include "test.h"
+
+#define ROOT  ((HKEY)0x80000000)
+#define ROOT2 ((HKEY)0x80000001)
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size ) { return malloc( size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+static void insert_string( HKEY root, LPCSTR path, LPCSTR value, LPCSTR data )
+{
+    ok( reg_cache_insert( root, FALSE, path, value, ERROR_SUCCESS, REG_SZ, data, strlen( data ) + 1 ) != NULL,
+        "insert %s failed\n", path );
+}
+
+static BOOL cached( HKEY root, LPCSTR path )
+{
+    return reg_cache_find( root, FALSE, path, "" ) != NULL;
+}
+
+static void test_join_path(void)
+{
+    static const struct
+    {
+        LPCSTR path, name, result;
+    }
+    tests[] =
+    {
+        { "", NULL, "" },
+        { NULL, "CLSID", "CLSID" },
+        { "", "\\CLSID\\", "CLSID" },
+        { "CLSID", "{0000}", "CLSID\\{0000}" },
+        { "CLSID\\", "\\\\{0000}\\\\InprocServer", "CLSID\\{0000}\\InprocServer" },
+        { "a", "", "a" },
+    };
+    char buffer[REG_CACHE_MAX_PATH], name[REG_CACHE_MAX_PATH + 1];
+    unsigned int i;
+
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        ok( reg_cache_join_path( buffer, tests[i].path, tests[i].name ), "%u: join failed\n", i );
+        ok( !strcmp( buffer, tests[i].result ), "%u: got %s\n", i, buffer );
+    }
+
+    memset( name, 'x', REG_CACHE_MAX_PATH - 1 );
+    name[REG_CACHE_MAX_PATH - 1] = 0;
+    ok( reg_cache_join_path( buffer, NULL, name ), "longest path rejected\n" );
+    ok( !reg_cache_join_path( buffer, "a", name ), "too long path accepted\n" );
+}
+
+static void test_find(void)
+{
+    struct reg_cache_entry *entry;
+
+    insert_string( ROOT, "CLSID\\{0000}", "", "Class" );
+    ok( reg_cache_insert( ROOT, TRUE, "CLSID\\{0000}", "AppID", ERROR_FILE_NOT_FOUND, 0, NULL, 0 ) != NULL,
+        "insert failed\n" );
+
+    entry = reg_cache_find( ROOT, FALSE, "clsid\\{0000}", "" );
+    ok( entry && !strcmp( (char *)entry->data, "Class" ), "case insensitive lookup failed\n" );
+    ok( entry && entry->size == 6 && entry->type == REG_SZ, "wrong entry\n" );
+    entry = reg_cache_find( ROOT, TRUE, "CLSID\\{0000}", "appid" );
+    ok( entry && entry->result == ERROR_FILE_NOT_FOUND, "negative entry not found\n" );
+
+    ok( !reg_cache_find( ROOT, TRUE, "CLSID\\{0000}", "" ), "RegQueryValueEx found RegQueryValue result\n" );
+    ok( !reg_cache_find( ROOT2, FALSE, "CLSID\\{0000}", "" ), "found entry of another root\n" );
+    ok( !reg_cache_find( ROOT, FALSE, "CLSID\\{00000}", "" ), "found entry of another key\n" );
+    ok( !reg_cache_insert( ROOT, FALSE, "big", "", ERROR_SUCCESS, REG_BINARY, NULL, REG_CACHE_MAX_DATA + 1 ),
+        "large value cached\n" );
+    ok( reg_cache_get_count() == 2, "got %u entries\n", reg_cache_get_count() );
+
+    reg_cache_flush();
+    ok( !reg_cache_get_count() && !cached( ROOT, "CLSID\\{0000}" ), "flush left entries\n" );
+}
+
+static void test_invalidate(void)
+{
+    insert_string( ROOT, "ab", "", "1" );
+    insert_string( ROOT, "abc", "", "2" );
+    insert_string( ROOT, "ab\\c", "", "3" );
+    insert_string( ROOT, "ab\\c\\d", "", "4" );
+    insert_string( ROOT2, "ab", "", "5" );
+    insert_string( ROOT, "x", "", "6" );
+
+    reg_cache_invalidate_key( ROOT, "AB", FALSE );
+    ok( !cached( ROOT, "ab" ), "key not invalidated\n" );
+    ok( cached( ROOT, "ab\\c" ) && cached( ROOT, "abc" ), "other keys invalidated\n" );
+    ok( cached( ROOT2, "ab" ), "key of other root invalidated\n" );
+
+    reg_cache_invalidate_key( ROOT, "ab", TRUE );
+    ok( !cached( ROOT, "ab\\c" ) && !cached( ROOT, "ab\\c\\d" ), "subkeys not invalidated\n" );
+    ok( cached( ROOT, "abc" ), "sibling with the same prefix invalidated\n" );
+    ok( cached( ROOT, "x" ) && cached( ROOT2, "ab" ), "unrelated keys invalidated\n" );
+    ok( reg_cache_get_count() == 3, "got %u entries\n", reg_cache_get_count() );
+
+    reg_cache_invalidate_key( ROOT, "", TRUE );
+    ok( reg_cache_get_count() == 1 && cached( ROOT2, "ab" ), "root not invalidated\n" );
+    reg_cache_flush();
+}
+
+static void test_limit(void)
+{
+    char path[32];
+    unsigned int i;
+
+    for (i = 0; i < REG_CACHE_MAX_ENTRIES; i++)
+    {
+        sprintf( path, "key%u", i );
+        insert_string( ROOT, path, "", "x" );
+    }
+    ok( reg_cache_get_count() == REG_CACHE_MAX_ENTRIES, "got %u entries\n", reg_cache_get_count() );
+    insert_string( ROOT, "last", "", "x" );
+    ok( reg_cache_get_count() == 1, "cache not flushed when full, %u entries\n", reg_cache_get_count() );
+    ok( cached( ROOT, "last" ) && !cached( ROOT, "key0" ), "wrong entries kept\n" );
+    reg_cache_flush();
+}
+
+static void test_key_map(void)
+{
+    static const char id1[] = "\\REGISTRY\\A", id2[] = "\\REGISTRY\\B";
+    HKEY root, hkey = (HKEY)0x1234;
+    const void *id;
+    DWORD id_size;
+    LPCSTR path;
+    unsigned int i;
+
+    ok( !reg_key_map_get( hkey, &root, &id, &id_size ), "unknown handle found\n" );
+    ok( reg_key_map_add( hkey, ROOT, "CLSID\\{0000}", id1, sizeof(id1) ), "add failed\n" );
+    path = reg_key_map_get( hkey, &root, &id, &id_size );
+    ok( path && !strcmp( path, "CLSID\\{0000}" ) && root == ROOT, "wrong path %s\n", path );
+    ok( id_size == sizeof(id1) && !memcmp( id, id1, id_size ), "wrong id\n" );
+
+    /* a handle value that comes back replaces the stale entry */
+    ok( reg_key_map_add( hkey, ROOT2, "Software", id2, sizeof(id2) ), "add failed\n" );
+    path = reg_key_map_get( hkey, &root, &id, &id_size );
+    ok( path && !strcmp( path, "Software" ) && root == ROOT2, "wrong path %s\n", path );
+    ok( id_size == sizeof(id2) && !memcmp( id, id2, id_size ), "wrong id\n" );
+    reg_key_map_remove( hkey );
+    ok( !reg_key_map_get( hkey, &root, &id, &id_size ), "removed handle found\n" );
+
+    /* handles in the same bucket */
+    for (i = 0; i < 256; i++)
+        reg_key_map_add( (HKEY)(ULONG_PTR)(0x100 + i * 4), ROOT, i % 2 ? "ab\\c" : "abc", id1, sizeof(id1) );
+    reg_key_map_add( (HKEY)0x4000, ROOT, "ab", id1, sizeof(id1) );
+    reg_key_map_add( (HKEY)0x4004, ROOT2, "ab", id1, sizeof(id1) );
+    reg_key_map_remove_subtree( ROOT, "Ab" );
+    ok( !reg_key_map_get( (HKEY)0x4000, &root, &id, &id_size ), "deleted key still mapped\n" );
+    ok( reg_key_map_get( (HKEY)0x4004, &root, &id, &id_size ) != NULL, "key of other root removed\n" );
+    for (i = 0; i < 256; i++)
+    {
+        path = reg_key_map_get( (HKEY)(ULONG_PTR)(0x100 + i * 4), &root, &id, &id_size );
+        if (i % 2) ok( !path, "%u: subkey of deleted key still mapped\n", i );
+        else ok( path && !strcmp( path, "abc" ), "%u: sibling removed\n", i );
+        reg_key_map_remove( (HKEY)(ULONG_PTR)(0x100 + i * 4) );
+    }
+    reg_key_map_remove( (HKEY)0x4004 );
+}
+
+int main(void)
+{
+    test_join_path();
+    test_find();
+    test_invalidate();
+    test_limit();
+    test_key_map();
+    return test_summary( "regcache" );
+}
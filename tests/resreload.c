@@ -0,0 +1,422 @@
+/*
+ * Tests of discarding and reloading NE resources (krnl386/resource.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wine/winbase16.h"
+#include "windows/wownt32.h"
+#include "kernel16_private.h"
+#include "test.h"
+
+extern SEGPTR WINAPI WIN16_LockResource16( HGLOBAL16 handle );
+
+#define GlobalDiscard16(h) GlobalReAlloc16( (h), 0, GMEM_MOVEABLE )
+
+/*
+ * Fake global heap. Block i has selector (i + 1) << 3 | 7, moveable blocks
+ * have a handle of selector - 1, and the lowest free selector is reused
+ * first. Only unlocked moveable discardable blocks can be discarded, as
+ * in global.c.
+ */
+#define MAX_BLOCKS 16
+
+static struct
+{
+    BOOL      used;
+    BOOL      moveable;
+    BOOL      discardable;
+    BYTE     *base;     /* NULL if discarded */
+    DWORD     size;
+    BYTE      lock;
+    HANDLE16  owner;
+    WORD      seg;
+    WORD      type;
+} blocks[MAX_BLOCKS];
+
+#define BLOCK_SEL(i) ((WORD)(((i) + 1) << 3 | 7))
+
+static int get_block( HGLOBAL16 handle )
+{
+    int i = (handle >> 3) - 1;
+
+    if (!handle || i < 0 || i >= MAX_BLOCKS || !blocks[i].used) return -1;
+    return i;
+}
+
+HGLOBAL16 WINAPI GlobalAlloc16( UINT16 flags, DWORD size )
+{
+    int i;
+
+    for (i = 0; i < MAX_BLOCKS; i++)
+    {
+        if (blocks[i].used) continue;
+        memset( &blocks[i], 0, sizeof(blocks[i]) );
+        blocks[i].used = TRUE;
+        blocks[i].moveable = !!(flags & GMEM_MOVEABLE);
+        blocks[i].discardable = !!(flags & GMEM_DISCARDABLE);
+        blocks[i].base = calloc( 1, size );
+        blocks[i].size = size;
+        return blocks[i].moveable ? BLOCK_SEL(i) - 1 : BLOCK_SEL(i);
+    }
+    return 0;
+}
+
+HGLOBAL16 WINAPI GlobalFree16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+
+    if (i < 0) return handle;
+    free( blocks[i].base );
+    blocks[i].used = FALSE;
+    return 0;
+}
+
+HGLOBAL16 WINAPI GlobalReAlloc16( HGLOBAL16 handle, DWORD size, UINT16 flags )
+{
+    int i = get_block( handle );
+
+    if (i < 0) return 0;
+    if (!size && (flags & GMEM_MOVEABLE))
+    {
+        if (!blocks[i].moveable || !blocks[i].discardable || blocks[i].lock) return 0;
+        free( blocks[i].base );
+        blocks[i].base = NULL;
+        return handle;
+    }
+    blocks[i].base = realloc( blocks[i].base, size );
+    blocks[i].size = size;
+    return handle;
+}
+
+UINT16 WINAPI GlobalFlags16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+
+    if (i < 0) return 0;
+    return blocks[i].lock | (blocks[i].discardable ? GMEM_DISCARDABLE : 0) | (blocks[i].base ? 0 : GMEM_DISCARDED);
+}
+
+DWORD WINAPI GlobalHandle16( WORD sel )
+{
+    int i = get_block( sel );
+
+    if (i < 0) return 0;
+    return MAKELONG( blocks[i].moveable ? BLOCK_SEL(i) - 1 : BLOCK_SEL(i), BLOCK_SEL(i) );
+}
+
+WORD WINAPI GlobalHandleToSel16( HGLOBAL16 handle )
+{
+    return handle ? handle | 7 : 0;
+}
+
+DWORD WINAPI GlobalSize16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+
+    return (i < 0 || !blocks[i].base) ? 0 : blocks[i].size;
+}
+
+LPVOID WINAPI GlobalLock16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+
+    if (i < 0) return NULL;
+    if (blocks[i].discardable) blocks[i].lock++;
+    return blocks[i].base;
+}
+
+SEGPTR WINAPI K32WOWGlobalLock16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+
+    if (i < 0 || !blocks[i].base) return 0;
+    blocks[i].lock++;
+    return MAKESEGPTR( BLOCK_SEL(i), 0 );
+}
+
+BOOL16 WINAPI GlobalUnlock16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+
+    if (i < 0) return FALSE;
+    if (blocks[i].lock) blocks[i].lock--;
+    return blocks[i].lock;
+}
+
+LPVOID WINAPI MapSL( SEGPTR segptr )
+{
+    int i = get_block( HIWORD(segptr) );
+
+    return (i < 0 || !blocks[i].base) ? NULL : blocks[i].base + LOWORD(segptr);
+}
+
+HANDLE16 WINAPI FarGetOwner16( HGLOBAL16 handle )
+{
+    int i = get_block( handle );
+    return i < 0 ? 0 : blocks[i].owner;
+}
+
+VOID WINAPI FarSetOwner16( HGLOBAL16 handle, HANDLE16 owner )
+{
+    int i = get_block( handle );
+    if (i >= 0) blocks[i].owner = owner;
+}
+
+void GLOBAL_SetSeg( HGLOBAL16 handle, WORD seg, WORD type )
+{
+    int i = get_block( handle );
+
+    blocks[i].seg = seg;
+    blocks[i].type = type;
+}
+
+WORD GLOBAL_GetSegNum( HGLOBAL16 handle ) { return blocks[get_block( handle )].seg; }
+WORD GLOBAL_GetSegType( HGLOBAL16 handle ) { return blocks[get_block( handle )].type; }
+
+/*
+ * A module with a resource table of three RCDATA resources, one of them
+ * fixed, and a string table block. Resource n is 32 bytes of n + 1 at
+ * 16 * (2n + 1) in the file.
+ */
+#define MODULE      0x1237
+#define SHIFT       4
+#define RES_COUNT   4
+
+static BYTE module_data[0x200];
+static NE_MODULE *module = (NE_MODULE *)module_data;
+static BYTE image[16 * (2 * RES_COUNT + 1)];
+static HRSRC16 res_discardable, res_other, res_fixed, res_string;
+static TDB current_task = { .hModule = MODULE };
+
+static HRSRC16 add_resource( BYTE **pos, WORD id, WORD flags )
+{
+    static WORD count;
+    NE_NAMEINFO *info = (NE_NAMEINFO *)*pos;
+
+    info->offset = 2 * count + 1;
+    info->length = 2;
+    info->flags  = flags;
+    info->id     = id;
+    memset( image + (info->offset << SHIFT), count + 1, info->length << SHIFT );
+    count++;
+    *pos += sizeof(*info);
+    return (BYTE *)info - module_data;
+}
+
+static void init_module(void)
+{
+    BYTE *pos;
+    NE_TYPEINFO *type;
+
+    module->ne_magic = IMAGE_OS2_SIGNATURE;
+    module->self = MODULE;
+    module->ne_rsrctab = sizeof(*module);
+    module->mapping = image;
+    module->mapping_size = sizeof(image);
+
+    pos = module_data + module->ne_rsrctab;
+    *(WORD *)pos = SHIFT;
+    pos += sizeof(WORD);
+    type = (NE_TYPEINFO *)pos;
+    type->type_id = 0x800a;  /* RT_RCDATA */
+    type->count = 3;
+    pos += sizeof(*type);
+    res_discardable = add_resource( &pos, 0x8001, NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_DISCARDABLE );
+    res_other = add_resource( &pos, 0x8002, NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_DISCARDABLE );
+    res_fixed = add_resource( &pos, 0x8003, 0 );
+    type = (NE_TYPEINFO *)pos;
+    type->type_id = NE_RSCTYPE_STRING;
+    type->count = 1;
+    pos += sizeof(*type);
+    res_string = add_resource( &pos, 0x8001, NE_SEGFLAGS_MOVEABLE | NE_SEGFLAGS_DISCARDABLE );
+}
+
+NE_MODULE *NE_GetPtr( HMODULE16 hModule ) { return hModule == MODULE ? module : NULL; }
+TDB *TASK_GetCurrent(void) { return &current_task; }
+HTASK16 WINAPI GetCurrentTask(void) { return 0; }
+BOOL16 WINAPI IsOldWindowsTask( HINSTANCE16 task ) { return FALSE; }
+HMODULE16 WINAPI GetModuleHandle16( LPCSTR name ) { return 0; }
+FARPROC16 WINAPI GetProcAddress16( HMODULE16 module, LPCSTR name ) { return 0; }
+HMODULE16 WINAPI GetExePtr( HANDLE16 handle ) { return 0; }
+BOOL WINAPI K32WOWCallback16Ex( DWORD proc, DWORD flags, DWORD size, LPVOID args, LPDWORD ret ) { return FALSE; }
+HFILE16 WINAPI _lopen16( LPCSTR name, INT16 mode ) { return HFILE_ERROR16; }
+LONG WINAPI _llseek16( HFILE16 file, LONG offset, INT16 origin ) { return -1; }
+
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    return (flags & HEAP_ZERO_MEMORY) ? calloc( 1, size ) : malloc( size );
+}
+LPVOID WINAPI HeapReAlloc( HANDLE heap, DWORD flags, LPVOID ptr, SIZE_T size ) { return realloc( ptr, size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+/* only used for PE modules and NE_ExtractIcon */
+HRSRC WINAPI FindResourceA( HMODULE module, LPCSTR name, LPCSTR type ) { return 0; }
+HGLOBAL WINAPI LoadResource( HMODULE module, HRSRC res ) { return 0; }
+LPVOID WINAPI LockResource( HGLOBAL handle ) { return NULL; }
+DWORD WINAPI SizeofResource( HMODULE module, HRSRC res ) { return 0; }
+INT WINAPI WideCharToMultiByte( UINT cp, DWORD flags, LPCWSTR src, INT srclen, LPSTR dst, INT dstlen,
+                                LPCSTR defchar, BOOL *used ) { return 0; }
+HANDLE WINAPI CreateFileA( LPCSTR name, DWORD access, DWORD sharing, LPSECURITY_ATTRIBUTES sa,
+                           DWORD creation, DWORD attributes, HANDLE template ) { return INVALID_HANDLE_VALUE; }
+HANDLE WINAPI CreateFileMappingA( HANDLE file, LPSECURITY_ATTRIBUTES sa, DWORD protect,
+                                  DWORD high, DWORD low, LPCSTR name ) { return 0; }
+LPVOID WINAPI MapViewOfFile( HANDLE mapping, DWORD access, DWORD high, DWORD low, SIZE_T count ) { return NULL; }
+BOOL WINAPI UnmapViewOfFile( LPCVOID addr ) { return FALSE; }
+DWORD WINAPI GetFileSize( HANDLE file, LPDWORD high ) { return INVALID_FILE_SIZE; }
+BOOL WINAPI GetFileAttributesExA( LPCSTR name, GET_FILEEX_INFO_LEVELS level, LPVOID info ) { return FALSE; }
+DWORD WINAPI SearchPathA( LPCSTR path, LPCSTR name, LPCSTR ext, DWORD buflen, LPSTR buffer, LPSTR *lastpart ) { return 0; }
+BOOL WINAPI CloseHandle( HANDLE handle ) { return FALSE; }
+LONG WINAPI CompareFileTime( const FILETIME *a, const FILETIME *b ) { return 0; }
+void WINAPI EnterCriticalSection( CRITICAL_SECTION *cs ) { }
+void WINAPI LeaveCriticalSection( CRITICAL_SECTION *cs ) { }
+HICON WINAPI CreateIconFromResourceEx( PBYTE bits, DWORD size, BOOL icon, DWORD version,
+                                       INT width, INT height, UINT flags ) { return 0; }
+INT WINAPI LookupIconIdFromDirectoryEx( PBYTE dir, BOOL icon, INT width, INT height, UINT flags ) { return 0; }
+
+static NE_NAMEINFO *name_info( HRSRC16 hRsrc )
+{
+    return (NE_NAMEINFO *)(module_data + hRsrc);
+}
+
+static BOOL check_data( const BYTE *data, HRSRC16 hRsrc )
+{
+    NE_NAMEINFO *info = name_info( hRsrc );
+    DWORD i;
+
+    if (!data) return FALSE;
+    for (i = 0; i < info->length << SHIFT; i++)
+        if (data[i] != image[(info->offset << SHIFT) + i]) return FALSE;
+    return TRUE;
+}
+
+static void test_discard_reload(void)
+{
+    HGLOBAL16 handle;
+    SEGPTR ptr;
+
+    /* discardable resources are moveable and stay unlocked until LockResource16 */
+    handle = LoadResource16( MODULE, res_discardable );
+    ok( handle != 0, "not loaded\n" );
+    ok( (handle & 7) != 7, "handle %04x is a selector\n", handle );
+    ok( GlobalFlags16( handle ) == GMEM_DISCARDABLE, "flags %04x\n", GlobalFlags16( handle ) );
+    ok( GLOBAL_GetSegType( handle ) == GT_RESOURCE && GLOBAL_GetSegNum( handle ) == res_discardable,
+        "tagged %x %04x\n", GLOBAL_GetSegType( handle ), GLOBAL_GetSegNum( handle ) );
+
+    ptr = WIN16_LockResource16( handle );
+    ok( HIWORD(ptr) == (handle | 7), "locked at %08x\n", ptr );
+    ok( check_data( MapSL( ptr ), res_discardable ), "wrong data\n" );
+    ok( !GlobalDiscard16( handle ), "discarded a locked resource\n" );
+    GlobalUnlock16( handle );
+
+    /* LockResource16 reloads it in place, keeping the load count */
+    ok( GlobalDiscard16( handle ) == handle, "not discarded\n" );
+    ok( GlobalFlags16( handle ) & GMEM_DISCARDED, "flags %04x\n", GlobalFlags16( handle ) );
+    ptr = WIN16_LockResource16( handle );
+    ok( HIWORD(ptr) == (handle | 7), "reloaded at %08x\n", ptr );
+    ok( check_data( MapSL( ptr ), res_discardable ), "wrong data after reload\n" );
+    ok( name_info( res_discardable )->usage == 1, "usage %u\n", name_info( res_discardable )->usage );
+    ok( name_info( res_discardable )->handle == handle, "handle changed to %04x\n", name_info( res_discardable )->handle );
+    GlobalUnlock16( handle );
+
+    /* also through the selector */
+    ok( GlobalDiscard16( handle ) == handle, "not discarded\n" );
+    ok( check_data( LockResource16( handle | 7 ), res_discardable ), "wrong data after reload\n" );
+    GlobalUnlock16( handle );
+
+    /* and by LoadResource16 */
+    ok( GlobalDiscard16( handle ) == handle, "not discarded\n" );
+    ok( LoadResource16( MODULE, res_discardable ) == handle, "loaded elsewhere\n" );
+    ok( check_data( GlobalLock16( handle ), res_discardable ), "wrong data after reload\n" );
+    GlobalUnlock16( handle );
+    ok( name_info( res_discardable )->usage == 2, "usage %u\n", name_info( res_discardable )->usage );
+
+    /* the moveable handle and its selector are both freed */
+    ok( FreeResource16( handle | 7 ) != 0, "freed while still loaded\n" );
+    ok( FreeResource16( handle ) == 0, "not freed\n" );
+    ok( name_info( res_discardable )->usage == 0, "usage %u\n", name_info( res_discardable )->usage );
+}
+
+/* fixed resources keep their address, they are never discarded */
+static void test_fixed(void)
+{
+    HGLOBAL16 handle = LoadResource16( MODULE, res_fixed );
+
+    ok( handle != 0 && (handle & 7) == 7, "handle %04x\n", handle );
+    ok( GlobalFlags16( handle ) == 0, "flags %04x\n", GlobalFlags16( handle ) );
+    ok( !GlobalDiscard16( handle ), "discarded a fixed resource\n" );
+    ok( check_data( LockResource16( handle ), res_fixed ), "wrong data\n" );
+    ok( FreeResource16( handle ) == 0, "not freed\n" );
+}
+
+/* a block the application freed isn't reused once its selector is given out again */
+static void test_freed_block(void)
+{
+    HGLOBAL16 handle, other, reloaded;
+    BYTE *data;
+
+    handle = LoadResource16( MODULE, res_string );
+    ok( check_data( GlobalLock16( handle ), res_string ), "wrong data\n" );
+    GlobalUnlock16( handle );
+    ok( FreeResource16( handle ) == 0, "not freed\n" );
+
+    /* the string block stays loaded */
+    ok( LoadResource16( MODULE, res_string ) == handle, "not reused\n" );
+    ok( FreeResource16( handle ) == 0, "not freed\n" );
+
+    GlobalFree16( handle );
+    other = GlobalAlloc16( GMEM_MOVEABLE | GMEM_DISCARDABLE, 32 );
+    ok( other == handle, "handle %04x not reused\n", handle );
+    FarSetOwner16( other, MODULE );
+    data = GlobalLock16( other );
+    memset( data, 0xee, 32 );
+
+    reloaded = LoadResource16( MODULE, res_string );
+    ok( reloaded != 0 && reloaded != other, "loaded into %04x\n", reloaded );
+    ok( data[0] == 0xee && data[31] == 0xee, "other block overwritten\n" );
+    ok( check_data( GlobalLock16( reloaded ), res_string ), "wrong data\n" );
+    GlobalUnlock16( reloaded );
+    GlobalUnlock16( other );
+    GlobalFree16( other );
+
+    /* the same for other resources */
+    handle = LoadResource16( MODULE, res_other );
+    ok( FreeResource16( handle ) == 0, "not freed\n" );
+    GlobalFree16( handle );
+    other = GlobalAlloc16( GMEM_MOVEABLE | GMEM_DISCARDABLE, 32 );
+    FarSetOwner16( other, MODULE );
+    data = GlobalLock16( other );
+    memset( data, 0xee, 32 );
+    reloaded = LoadResource16( MODULE, res_other );
+    ok( reloaded != 0 && reloaded != other, "loaded into %04x\n", reloaded );
+    ok( data[0] == 0xee, "other block overwritten\n" );
+    GlobalUnlock16( other );
+}
+
+int main(void)
+{
+    init_module();
+    test_discard_reload();
+    test_fixed();
+    test_freed_block();
+    return test_summary( "resreload" );
+}
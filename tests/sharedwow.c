@@ -0,0 +1,365 @@
+/*
+ * Tests of the shared WOW launch protocol (otvdm/sharedwow.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "winuser.h"
+#include "sharedwow.h"
+#include "test.h"
+
+static char env[SHARED_WOW_MAX_ENVIRONMENT + 2];
+
+/*
+ * In-memory transport: reads come from a prepared buffer, at most chunk
+ * bytes at a time, and end like a closed pipe when it runs out; writes
+ * are collected.
+ */
+struct mem_transport
+{
+    struct shared_wow_transport transport;
+    BYTE in[0x20000];
+    DWORD in_size, in_pos, chunk;
+    BYTE out[0x20000];
+    DWORD out_size;
+    unsigned int writes;
+    BOOL fail_write;
+    DWORD first_timeout;
+};
+
+static DWORD mem_read( struct shared_wow_transport *transport, LPVOID buf, DWORD size, DWORD timeout )
+{
+    struct mem_transport *t = (struct mem_transport *)transport;
+
+    if (!t->first_timeout) t->first_timeout = timeout;
+    if (size > t->in_size - t->in_pos) size = t->in_size - t->in_pos;
+    if (t->chunk && size > t->chunk) size = t->chunk;
+    memcpy( buf, t->in + t->in_pos, size );
+    t->in_pos += size;
+    return size;
+}
+
+static BOOL mem_write( struct shared_wow_transport *transport, LPCVOID buf, DWORD size )
+{
+    struct mem_transport *t = (struct mem_transport *)transport;
+
+    if (t->fail_write || t->out_size + size > sizeof(t->out)) return FALSE;
+    memcpy( t->out + t->out_size, buf, size );
+    t->out_size += size;
+    t->writes++;
+    return TRUE;
+}
+
+static struct mem_transport *mem_transport_create(void)
+{
+    struct mem_transport *t = calloc( 1, sizeof(*t) );
+
+    t->transport.read = mem_read;
+    t->transport.write = mem_write;
+    return t;
+}
+
+static void mem_push( struct mem_transport *t, const void *data, DWORD size )
+{
+    memcpy( t->in + t->in_size, data, size );
+    t->in_size += size;
+}
+
+static void fill_exec( shared_wow_exec *exec, WORD header )
+{
+    memset( exec, 0, sizeof(*exec) );
+    exec->header = header;
+    exec->showCmd = SW_SHOWMINIMIZED;
+    strcpy( exec->appname, "C:\\WINDOWS\\NOTEPAD.EXE" );
+    strcpy( exec->cmdline, " readme.txt" );
+    strcpy( exec->curdir, "C:\\DOCS" );
+}
+
+static const char test_env[] = "PATH=C:\\WINDOWS\0TEMP=C:\\TEMP\0";
+
+static void push_v2( struct mem_transport *t, DWORD env_size, const char *block, DWORD env_sent )
+{
+    shared_wow_exec exec;
+
+    fill_exec( &exec, SHARED_WOW_REPLY_SUPPORTED );
+    exec.environment_size = env_size;
+    mem_push( t, &exec, sizeof(exec) );
+    mem_push( t, block, env_sent );
+}
+
+static void test_old_requests(void)
+{
+    struct mem_transport *t;
+    shared_wow_exec exec, got;
+
+    /* version 0, from before curdir was sent */
+    t = mem_transport_create();
+    fill_exec( &exec, 0 );
+    memset( exec.curdir, 'x', sizeof(exec.curdir) );
+    mem_push( t, &exec, SHARED_WOW_EXEC_V1_SIZE );
+    ok( shared_wow_read_request( &t->transport, &got, env ), "version 0 refused\n" );
+    ok( got.header == 0, "version %u\n", got.header );
+    ok( got.showCmd == SW_SHOWMINIMIZED, "showCmd %u\n", got.showCmd );
+    ok( !strcmp( got.appname, exec.appname ), "appname %s\n", got.appname );
+    ok( !strcmp( got.cmdline, exec.cmdline ), "cmdline %s\n", got.cmdline );
+    ok( !got.curdir[0], "curdir %.8s\n", got.curdir );
+    ok( !env[0] && !env[1], "environment %s\n", env );
+    ok( t->in_pos == SHARED_WOW_EXEC_V1_SIZE, "read %u\n", t->in_pos );
+    free( t );
+
+    /* version 1 */
+    t = mem_transport_create();
+    fill_exec( &exec, SHARED_WOW_CURDIR_SUPPORTED );
+    mem_push( t, &exec, SHARED_WOW_EXEC_V1_SIZE );
+    ok( shared_wow_read_request( &t->transport, &got, env ), "version 1 refused\n" );
+    ok( got.header == SHARED_WOW_CURDIR_SUPPORTED, "version %u\n", got.header );
+    ok( !strcmp( got.curdir, "C:\\DOCS" ), "curdir %s\n", got.curdir );
+    ok( !env[0] && !env[1], "environment %s\n", env );
+    free( t );
+
+    /* strings are terminated */
+    t = mem_transport_create();
+    fill_exec( &exec, SHARED_WOW_CURDIR_SUPPORTED );
+    memset( exec.appname, 'a', MAX_PATH );
+    memset( exec.cmdline, 'c', MAX_PATH );
+    memset( exec.curdir, 'd', MAX_PATH );
+    mem_push( t, &exec, SHARED_WOW_EXEC_V1_SIZE );
+    ok( shared_wow_read_request( &t->transport, &got, env ), "request refused\n" );
+    ok( strlen( got.appname ) == MAX_PATH - 1 && strlen( got.cmdline ) == MAX_PATH - 1 &&
+        strlen( got.curdir ) == MAX_PATH - 1, "strings not terminated\n" );
+    free( t );
+}
+
+static void test_v2_request(void)
+{
+    struct mem_transport *t;
+    shared_wow_exec got;
+    char *big;
+    DWORD chunk;
+
+    /* the pipe may hand the request over in any pieces */
+    for (chunk = 0; chunk <= 9; chunk++)
+    {
+        t = mem_transport_create();
+        t->chunk = chunk;
+        push_v2( t, sizeof(test_env), test_env, sizeof(test_env) );
+        ok( shared_wow_read_request( &t->transport, &got, env ), "chunk %u: refused\n", chunk );
+        ok( got.header == SHARED_WOW_REPLY_SUPPORTED, "chunk %u: version %u\n", chunk, got.header );
+        ok( !strcmp( got.curdir, "C:\\DOCS" ), "chunk %u: curdir %s\n", chunk, got.curdir );
+        ok( got.environment_size == sizeof(test_env), "chunk %u: size %u\n", chunk, got.environment_size );
+        ok( !memcmp( env, test_env, sizeof(test_env) ), "chunk %u: wrong environment\n", chunk );
+        ok( t->first_timeout == SHARED_WOW_IO_TIMEOUT, "chunk %u: timeout %u\n", chunk, t->first_timeout );
+        free( t );
+    }
+
+    /* no environment */
+    t = mem_transport_create();
+    push_v2( t, 0, NULL, 0 );
+    ok( shared_wow_read_request( &t->transport, &got, env ), "refused\n" );
+    ok( !env[0] && !env[1], "environment %s\n", env );
+    free( t );
+
+    /* an unterminated block gets its terminating nulls */
+    t = mem_transport_create();
+    push_v2( t, 5, "A=B\0C", 5 );
+    ok( shared_wow_read_request( &t->transport, &got, env ), "refused\n" );
+    ok( !memcmp( env, "A=B\0C\0\0", 7 ), "wrong environment\n" );
+    free( t );
+
+    /* largest block */
+    t = mem_transport_create();
+    t->chunk = 0x1000;
+    big = malloc( SHARED_WOW_MAX_ENVIRONMENT );
+    memset( big, 'e', SHARED_WOW_MAX_ENVIRONMENT );
+    push_v2( t, SHARED_WOW_MAX_ENVIRONMENT, big, SHARED_WOW_MAX_ENVIRONMENT );
+    free( big );
+    ok( shared_wow_read_request( &t->transport, &got, env ), "largest block refused\n" );
+    ok( env[SHARED_WOW_MAX_ENVIRONMENT - 1] == 'e' && !env[SHARED_WOW_MAX_ENVIRONMENT] && !env[SHARED_WOW_MAX_ENVIRONMENT + 1], "wrong environment\n" );
+    free( t );
+}
+
+static void test_malformed_requests(void)
+{
+    struct mem_transport *t;
+    shared_wow_exec exec, got;
+    DWORD size;
+
+    /* truncated anywhere */
+    for (size = 0; size < sizeof(exec) + sizeof(test_env); size++)
+    {
+        t = mem_transport_create();
+        t->chunk = 100;
+        push_v2( t, sizeof(test_env), test_env, sizeof(test_env) );
+        t->in_size = size;
+        ok( !shared_wow_read_request( &t->transport, &got, env ), "accepted %u bytes\n", size );
+        ok( !env[0] && !env[1], "%u bytes: environment %s\n", size, env );
+        free( t );
+    }
+
+    /* too much environment */
+    t = mem_transport_create();
+    push_v2( t, SHARED_WOW_MAX_ENVIRONMENT + 1, test_env, sizeof(test_env) );
+    ok( !shared_wow_read_request( &t->transport, &got, env ), "oversized environment accepted\n" );
+    ok( !env[0] && !env[1], "environment %s\n", env );
+    ok( t->in_pos == sizeof(exec), "read %u\n", t->in_pos );
+    free( t );
+    t = mem_transport_create();
+    push_v2( t, ~0u, test_env, sizeof(test_env) );
+    ok( !shared_wow_read_request( &t->transport, &got, env ), "oversized environment accepted\n" );
+    free( t );
+
+    /* versions from the future */
+    t = mem_transport_create();
+    fill_exec( &exec, SHARED_WOW_VERSION + 1 );
+    mem_push( t, &exec, sizeof(exec) );
+    ok( !shared_wow_read_request( &t->transport, &got, env ), "version %u accepted\n", SHARED_WOW_VERSION + 1 );
+    free( t );
+}
+
+static void test_server_writes(void)
+{
+    struct mem_transport *t = mem_transport_create();
+    shared_wow_hello hello;
+    shared_wow_reply reply;
+
+    ok( shared_wow_write_hello( &t->transport ), "hello not written\n" );
+    ok( shared_wow_write_reply( &t->transport, 0x1237 ), "reply not written\n" );
+    ok( t->out_size == sizeof(hello) + sizeof(reply), "wrote %u\n", t->out_size );
+    memcpy( &hello, t->out, sizeof(hello) );
+    memcpy( &reply, t->out + sizeof(hello), sizeof(reply) );
+    ok( hello.header == SHARED_WOW_HELLO && hello.version == SHARED_WOW_VERSION,
+        "hello %04x %u\n", hello.header, hello.version );
+    ok( reply.header == SHARED_WOW_REPLY_SUPPORTED && reply.instance == 0x1237,
+        "reply %u %04x\n", reply.header, reply.instance );
+    t->fail_write = TRUE;
+    ok( !shared_wow_write_reply( &t->transport, 0x1237 ), "write failure not reported\n" );
+    free( t );
+}
+
+static void push_hello( struct mem_transport *t, WORD version )
+{
+    shared_wow_hello hello;
+
+    hello.header = SHARED_WOW_HELLO;
+    hello.version = version;
+    mem_push( t, &hello, sizeof(hello) );
+}
+
+static void push_reply( struct mem_transport *t, WORD instance )
+{
+    shared_wow_reply reply;
+
+    reply.header = SHARED_WOW_REPLY_SUPPORTED;
+    reply.instance = instance;
+    mem_push( t, &reply, sizeof(reply) );
+}
+
+static void test_client(void)
+{
+    struct mem_transport *t, *server;
+    shared_wow_exec exec, got;
+    HINSTANCE16 result;
+
+    fill_exec( &exec, 0 );
+
+    /* a server that says hello gets a version 2 request and replies */
+    t = mem_transport_create();
+    t->chunk = 1;
+    push_hello( t, SHARED_WOW_REPLY_SUPPORTED );
+    push_reply( t, 0x1237 );
+    result = 0;
+    ok( shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "not sent\n" );
+    ok( result == 0x1237, "result %04x\n", result );
+    ok( t->first_timeout == SHARED_WOW_HELLO_TIMEOUT, "timeout %u\n", t->first_timeout );
+    ok( t->out_size == sizeof(exec) + sizeof(test_env), "wrote %u\n", t->out_size );
+
+    /* which the server reads back */
+    server = mem_transport_create();
+    mem_push( server, t->out, t->out_size );
+    ok( shared_wow_read_request( &server->transport, &got, env ), "refused\n" );
+    ok( got.header == SHARED_WOW_REPLY_SUPPORTED, "version %u\n", got.header );
+    ok( got.showCmd == exec.showCmd, "showCmd %u\n", got.showCmd );
+    ok( !strcmp( got.appname, exec.appname ) && !strcmp( got.cmdline, exec.cmdline ) &&
+        !strcmp( got.curdir, exec.curdir ), "wrong strings\n" );
+    ok( !memcmp( env, test_env, sizeof(test_env) ), "wrong environment\n" );
+    free( server );
+    free( t );
+
+    /* a server that predates the hello gets a version 1 request */
+    t = mem_transport_create();
+    result = 0;
+    ok( shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "not sent\n" );
+    ok( result == 33, "result %04x\n", result );
+    ok( t->writes == 1, "%u writes\n", t->writes );
+    ok( t->out_size == SHARED_WOW_EXEC_V1_SIZE, "wrote %u\n", t->out_size );
+    memcpy( &got, t->out, SHARED_WOW_EXEC_V1_SIZE );
+    ok( got.header == SHARED_WOW_CURDIR_SUPPORTED, "version %u\n", got.header );
+    ok( !strcmp( got.curdir, exec.curdir ), "curdir %s\n", got.curdir );
+    free( t );
+
+    /* so does one that says something else */
+    t = mem_transport_create();
+    push_hello( t, SHARED_WOW_CURDIR_SUPPORTED );
+    ok( shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "not sent\n" );
+    ok( t->out_size == SHARED_WOW_EXEC_V1_SIZE, "wrote %u\n", t->out_size );
+    free( t );
+    t = mem_transport_create();
+    mem_push( t, "junk", 4 );
+    ok( shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "not sent\n" );
+    ok( t->out_size == SHARED_WOW_EXEC_V1_SIZE, "wrote %u\n", t->out_size );
+    free( t );
+
+    /* no reply, the launch is assumed to have worked */
+    t = mem_transport_create();
+    push_hello( t, SHARED_WOW_REPLY_SUPPORTED );
+    mem_push( t, "\2", 1 );
+    result = 0;
+    ok( shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "not sent\n" );
+    ok( result == 33, "result %04x\n", result );
+    free( t );
+
+    /* too much environment is left out */
+    t = mem_transport_create();
+    push_hello( t, SHARED_WOW_REPLY_SUPPORTED );
+    push_reply( t, 2 );
+    ok( shared_wow_send_request( &t->transport, &exec, test_env, SHARED_WOW_MAX_ENVIRONMENT + 1, &result ), "not sent\n" );
+    ok( result == 2, "result %04x\n", result );
+    memcpy( &got, t->out, sizeof(got) );
+    ok( t->out_size == sizeof(exec) && !got.environment_size, "environment of %u sent\n", got.environment_size );
+    free( t );
+
+    /* nothing could be sent, the caller launches the program itself */
+    t = mem_transport_create();
+    t->fail_write = TRUE;
+    ok( !shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "sent\n" );
+    push_hello( t, SHARED_WOW_REPLY_SUPPORTED );
+    ok( !shared_wow_send_request( &t->transport, &exec, test_env, sizeof(test_env), &result ), "sent\n" );
+    free( t );
+}
+
+int main(void)
+{
+    test_old_requests();
+    test_v2_request();
+    test_malformed_requests();
+    test_server_writes();
+    test_client();
+    return test_summary( "sharedwow" );
+}
@@ -0,0 +1,17 @@
+/*
+ * Stand-in for winbase.h in the host unit tests
+ *
+ * The real header is used, but the process heap comes from the test
+ * driver, which implements test_process_heap.
+ */
+
+#ifndef __WINE_TEST_WINBASE_H
+#define __WINE_TEST_WINBASE_H
+
+#include_next <winbase.h>
+
+/* the inline version reads the TEB */
+extern HANDLE test_process_heap;
+#define GetProcessHeap() test_process_heap
+
+#endif /* __WINE_TEST_WINBASE_H */
@@ -0,0 +1,37 @@
+/*
+ * Stand-in for krnl386/dosexe.h in the host unit tests
+ *
+ * Only the declarations of the krnl386 sources built by the tests.
+ */
+
+#ifndef __WINE_DOSEXE_H
+#define __WINE_DOSEXE_H
+
+/* dpmimem.c */
+extern BOOL DPMI_IsArenaPtr(LPCVOID);
+extern LPVOID DPMI_ArenaAlloc(DWORD);
+extern BOOL DPMI_ArenaFree(LPVOID);
+extern LPVOID DPMI_ArenaReAlloc(LPVOID,DWORD);
+extern DWORD DPMI_ArenaBlockSize(LPCVOID);
+extern BOOL DPMI_ArenaGetFreeInfo(DWORD*,DWORD*,DWORD*);
+
+/* ioports.c */
+typedef void (WINAPI *OUTPROC)(int port, int size, DWORD value);
+typedef DWORD (WINAPI *INPROC)(int port, int size);
+
+extern DWORD DOSVM_inport( int port, int size, CONTEXT *ctx );
+extern void DOSVM_outport( int port, int size, DWORD value, CONTEXT *ctx );
+extern void DOSVM_inport_block( int port, int size, void *buffer, DWORD count, CONTEXT *ctx );
+extern void DOSVM_outport_block( int port, int size, const void *buffer, DWORD count, CONTEXT *ctx );
+extern void DOSVM_setportcb(OUTPROC outproc, INPROC inproc, int port, OUTPROC *oldout, INPROC* oldin);
+
+/* the devices behind the ports */
+extern void DOSVM_PIC_ioport_out( WORD port, BYTE val );
+extern void DOSVM_SetTimer( UINT ticks );
+extern void DMA_ioport_out( WORD port, BYTE val );
+extern BYTE DMA_ioport_in( WORD port );
+extern BYTE DOSVM_Int09ReadScan(BYTE*ascii);
+extern void SB_ioport_out( WORD port, BYTE val );
+extern BYTE SB_ioport_in( WORD port );
+
+#endif /* __WINE_DOSEXE_H */
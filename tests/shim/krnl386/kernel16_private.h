@@ -0,0 +1,147 @@
+/*
+ * Stand-in for krnl386/kernel16_private.h in the host unit tests
+ *
+ * The real header needs the Windows SDK. This one has the parts used by
+ * the krnl386 sources that are built by the tests; structures must keep
+ * the layout of the real definitions. The test driver implements the
+ * functions declared here and CURRENT_DS.
+ */
+
+#ifndef __WINE_KERNEL16_PRIVATE_H
+#define __WINE_KERNEL16_PRIVATE_H
+
+#include "wine/winbase16.h"
+
+#include "pshpack1.h"
+
+/* this structure is always located at offset 0 of the DGROUP segment */
+typedef struct
+{
+    WORD null;        /* Always 0 */
+    DWORD old_ss_sp;  /* Stack pointer; used by SwitchTaskTo() */
+    WORD heap;        /* Pointer to the local heap information (if any) */
+    WORD atomtable;   /* Pointer to the local atom table (if any) */
+    WORD stacktop;    /* Top of the stack */
+    WORD stackmin;    /* Lowest stack address used so far */
+    WORD stackbottom; /* Bottom of the stack */
+} INSTANCEDATA;
+
+typedef struct
+{
+    WORD      filepos;
+    WORD      size;
+    WORD      flags;
+    WORD      minsize;
+    HANDLE16  hSeg;
+} SEGTABLEENTRY;
+
+/* In-memory module structure */
+typedef struct _NE_MODULE
+{
+    WORD      ne_magic;         /* 00 'NE' signature */
+    WORD      count;            /* 02 Usage count (ne_ver/ne_rev on disk) */
+    WORD      ne_enttab;        /* 04 Near ptr to entry table */
+    HMODULE16 next;             /* 06 Selector to next module (ne_cbenttab on disk) */
+    WORD      dgroup_entry;     /* 08 Near ptr to segment entry for DGROUP (ne_crc on disk) */
+    WORD      fileinfo;         /* 0a Near ptr to file info (OFSTRUCT) (ne_crc on disk) */
+    WORD      ne_flags;         /* 0c Module flags */
+    WORD      ne_autodata;      /* 0e Logical segment for DGROUP */
+    WORD      ne_heap;          /* 10 Initial heap size */
+    WORD      ne_stack;         /* 12 Initial stack size */
+    DWORD     ne_csip;          /* 14 Initial cs:ip */
+    DWORD     ne_sssp;          /* 18 Initial ss:sp */
+    WORD      ne_cseg;          /* 1c Number of segments in segment table */
+    WORD      ne_cmod;          /* 1e Number of module references */
+    WORD      ne_cbnrestab;     /* 20 Size of non-resident names table */
+    WORD      ne_segtab;        /* 22 Near ptr to segment table */
+    WORD      ne_rsrctab;       /* 24 Near ptr to resource table */
+    WORD      ne_restab;        /* 26 Near ptr to resident names table */
+    WORD      ne_modtab;        /* 28 Near ptr to module reference table */
+    WORD      ne_imptab;        /* 2a Near ptr to imported names table */
+    DWORD     ne_nrestab;       /* 2c File offset of non-resident names table */
+    WORD      ne_cmovent;       /* 30 Number of moveable entries in entry table*/
+    WORD      ne_align;         /* 32 Alignment shift count */
+    WORD      ne_cres;          /* 34 # of resource segments */
+    BYTE      ne_exetyp;        /* 36 Operating system flags */
+    BYTE      ne_flagsothers;   /* 37 Misc. flags */
+    HANDLE16  dlls_to_init;     /* 38 List of DLLs to initialize (ne_pretthunks on disk) */
+    HANDLE16  nrname_handle;    /* 3a Handle to non-resident name table (ne_psegrefbytes on disk) */
+    WORD      ne_swaparea;      /* 3c Min. swap area size */
+    WORD      ne_expver;        /* 3e Expected Windows version */
+    /* From here, these are extra fields not present in normal Windows */
+    HMODULE   module32;         /* PE module handle for Win32 modules */
+    HMODULE   owner32;          /* PE module containing this one for 16-bit builtins */
+    HMODULE16 self;             /* Handle for this module */
+    WORD      self_loading_sel; /* Selector used for self-loading apps. */
+    LPVOID    rsrc32_map;       /* HRSRC 16->32 map (for 32-bit modules) */
+    LPVOID    rsrc_index;       /* hashed resource table index (for NE modules) */
+    LPCVOID   mapping;          /* mapping of the binary file */
+    SIZE_T    mapping_size;     /* size of the file mapping */
+} NE_MODULE;
+
+#include "poppack.h"
+
+#define NE_READ_DATA(pModule,buffer,offset,size) \
+    (((offset)+(size) <= pModule->mapping_size) ? \
+     (memcpy( buffer, (const char *)pModule->mapping + (offset), (size) ), TRUE) : FALSE)
+
+#define NE_MODULE_NAME(pModule) \
+    (((OFSTRUCT *)((char*)(pModule) + (pModule)->fileinfo))->szPathName)
+
+extern TDB *TASK_GetCurrent(void);
+BOOL16 WINAPI IsOldWindowsTask(HINSTANCE16);
+
+/* wType values */
+#define GT_UNKNOWN      0
+#define GT_RESOURCE     5
+#define GT_INTERNAL     8
+void GLOBAL_SetSeg(HGLOBAL16 hg, WORD wSeg, WORD type);
+WORD GLOBAL_GetSegNum(HGLOBAL16 hg);
+WORD GLOBAL_GetSegType(HGLOBAL16 hg);
+
+#define NE_SEG_TABLE(pModule) \
+    ((SEGTABLEENTRY *)((char *)(pModule) + (pModule)->ne_segtab))
+
+extern WORD test_current_ds;
+extern STACK16FRAME test_stack16;
+#define CURRENT_DS      test_current_ds
+#define CURRENT_STACK16 (&test_stack16)
+
+/* the inline version reads the TEB */
+extern HANDLE test_process_heap;
+#define GetProcessHeap() test_process_heap
+
+#define WINE_LDT_FLAGS_DATA 0x13
+
+/* __declspec is rejected outside winelib; resource.c exports NE_ExtractIcon */
+#undef __declspec
+#define __declspec(x)
+
+extern BOOL DOSMEM_InitDosMemory(void);
+
+extern NE_MODULE *NE_GetPtr( HMODULE16 hModule );
+extern WORD SELECTOR_AllocBlock( const void *base, DWORD size, unsigned char flags );
+extern void SELECTOR_FreeBlock( WORD sel );
+extern BOOL16 GLOBAL_MoveBlock( HGLOBAL16 handle, void *ptr, DWORD size );
+extern HANDLE WINAPI RtlCreateHeap( ULONG flags, PVOID addr, SIZE_T totalSize, SIZE_T commitSize, PVOID unknown, PVOID definition );
+
+/* local.c */
+typedef struct
+{
+    WORD  size;           /* size of the heap */
+    WORD  items;          /* number of arenas */
+    WORD  free;           /* total free bytes */
+    WORD  free_blocks;    /* number of free blocks */
+    WORD  largest_free;   /* size of the largest free block */
+    WORD  moveable;       /* number of moveable blocks */
+    WORD  locked;         /* number of locked moveable blocks */
+    WORD  discarded;      /* number of discarded moveable blocks */
+    WORD  free_handles;   /* number of unused handle table entries */
+    WORD  fragmentation;  /* percentage of free space outside the largest free block */
+    BYTE  ncompact;       /* compaction counter */
+    DWORD distotal;       /* total bytes discarded */
+} LOCALHEAPSTATS;
+
+extern BOOL CDECL LOCAL_GetHeapStats( HANDLE16 ds, LOCALHEAPSTATS *stats );
+
+#endif /* __WINE_KERNEL16_PRIVATE_H */
@@ -0,0 +1,15 @@
+/*
+ * Stand-in for shlwapi.h in the host unit tests
+ *
+ * The real header pulls in COM. This one declares the path functions
+ * used by the krnl386 sources that are built by the tests; the test
+ * driver implements them.
+ */
+
+#ifndef __WINE_SHLWAPI_H
+#define __WINE_SHLWAPI_H
+
+BOOL  WINAPI PathIsRelativeA( LPCSTR path );
+LPSTR WINAPI PathFindFileNameA( LPCSTR path );
+
+#endif /* __WINE_SHLWAPI_H */
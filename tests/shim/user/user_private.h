@@ -0,0 +1,25 @@
+/*
+ * Stand-in for user/user_private.h in the host unit tests
+ *
+ * The real header pulls in the USER glue. This one has the handle
+ * conversion the tested sources use; the test driver implements it and
+ * test_process_heap.
+ */
+
+#ifndef __WINE_USER_PRIVATE_H
+#define __WINE_USER_PRIVATE_H
+
+#include "wine/windef16.h"
+
+extern HWND test_handle32( HWND16 hwnd16 );
+
+static inline HWND WIN_Handle32( HWND16 hwnd16 )
+{
+    return test_handle32( hwnd16 );
+}
+
+/* the inline version reads the TEB */
+extern HANDLE test_process_heap;
+#define GetProcessHeap() test_process_heap
+
+#endif /* __WINE_USER_PRIVATE_H */
@@ -0,0 +1,25 @@
+/*
+ * Debug channel macros for the host unit tests; output is discarded
+ */
+
+#ifndef __WINE_WINE_DEBUG_H
+#define __WINE_WINE_DEBUG_H
+
+#define WINE_DEFAULT_DEBUG_CHANNEL(ch) static const int __wine_dbch_##ch = 0
+#define WINE_DECLARE_DEBUG_CHANNEL(ch) static const int __wine_dbch_##ch = 0
+#define TRACE_ON(ch)   0
+#define WARN_ON(ch)    0
+#define ERR_ON(ch)     0
+#define TRACE(...)     do { } while (0)
+#define WARN(...)      do { } while (0)
+#define FIXME(...)     do { } while (0)
+#define ERR(...)       do { } while (0)
+#define MESSAGE(...)   do { } while (0)
+#define TRACE_(ch)     TRACE
+#define WARN_(ch)      WARN
+#define FIXME_(ch)     FIXME
+#define ERR_(ch)       ERR
+#define debugstr_a(s)  (s)
+#define debugstr_an(s,n) (s)
+
+#endif  /* __WINE_WINE_DEBUG_H */
@@ -0,0 +1,16 @@
+/*
+ * Stand-in for wine/port.h in the host unit tests; the sources built by
+ * the tests need none of its portability wrappers but memcpy_unaligned.
+ */
+
+#ifndef __WINE_WINE_PORT_H
+#define __WINE_WINE_PORT_H
+
+#include <string.h>
+
+static inline void *memcpy_unaligned( void *dst, const void *src, size_t size )
+{
+    return memcpy( dst, src, size );
+}
+
+#endif  /* __WINE_WINE_PORT_H */
@@ -0,0 +1,24 @@
+/*
+ * Stand-in for winbase.h in the host unit tests
+ *
+ * The real header is used, but the process heap comes from the test
+ * driver, which implements test_process_heap. The wide string functions
+ * of the host C library take a wider wchar_t than WCHAR, the driver
+ * provides WCHAR versions.
+ */
+
+#ifndef __WINE_TEST_WINBASE_H
+#define __WINE_TEST_WINBASE_H
+
+#include_next <winbase.h>
+
+/* the inline version reads the TEB */
+extern HANDLE test_process_heap;
+#define GetProcessHeap() test_process_heap
+
+#define wcscmp test_wcscmp
+#define wcsncmp test_wcsncmp
+int test_wcscmp( const WCHAR *a, const WCHAR *b );
+int test_wcsncmp( const WCHAR *a, const WCHAR *b, size_t n );
+
+#endif /* __WINE_TEST_WINBASE_H */
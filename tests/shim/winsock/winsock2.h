@@ -0,0 +1,35 @@
+/*
+ * Stand-in for winsock2.h in the host unit tests
+ *
+ * The real header is used, but the calls that share their names with the
+ * host socket API are renamed so that the test driver can implement them
+ * over host sockets. The driver also implements test_process_heap.
+ */
+
+#ifndef __WINE_TEST_WINSOCK2_H
+#define __WINE_TEST_WINSOCK2_H
+
+#include_next <winsock2.h>
+
+extern int WINAPI test_recv( SOCKET s, char *buf, int len, int flags );
+extern int WINAPI test_send( SOCKET s, const char *buf, int len, int flags );
+extern int WINAPI test_select( int nfds, fd_set *read_set, fd_set *write_set, fd_set *except_set,
+                               const struct timeval *timeout );
+extern int WINAPI test_getsockopt( SOCKET s, int level, int optname, char *optval, int *optlen );
+extern int WINAPI test_setsockopt( SOCKET s, int level, int optname, const char *optval, int optlen );
+
+#define recv test_recv
+#define send test_send
+#define select test_select
+#define getsockopt test_getsockopt
+#define setsockopt test_setsockopt
+
+/* __declspec(thread) is rejected outside winelib; the tests use one thread */
+#undef __declspec
+#define __declspec(x)
+
+/* the inline version reads the TEB */
+extern HANDLE test_process_heap;
+#define GetProcessHeap() test_process_heap
+
+#endif /* __WINE_TEST_WINSOCK2_H */
@@ -0,0 +1,447 @@
+/*
+ * Tests of the Winsock 1.1 blocking calls (winsock/blocking.c) over
+ * host socketpairs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include "winsock2.h"
+#include <stdlib.h>
+#include "wine/winbase16.h"
+#include "winsock16.h"
+#include "blocking.h"
+#include <string.h>
+#include "test.h"
+
+/* hostsocket.c */
+extern int host_socketpair( int fds[2] );
+extern int host_set_nonblocking( int fd, int nonblocking );
+extern int host_send( int fd, const void *buf, int len );
+extern int host_recv( int fd, void *buf, int len );
+extern int host_poll( int fd, int read, int write, int timeout );
+extern int host_unsent( int fd );
+extern int host_close( int fd );
+extern int host_is_open( int fd );
+extern void host_sleep( unsigned int ms );
+extern unsigned int host_ticks(void);
+
+/*
+ * The Winsock calls blocking.c makes, with the Windows behavior it relies
+ * on: closing a non-blocking socket that lingers with a timeout fails with
+ * WSAEWOULDBLOCK while the peer hasn't read everything.
+ */
+#define MAX_FDS 1024
+
+static int last_error;
+static struct linger lingers[MAX_FDS];
+static BOOL host_nonblocking[MAX_FDS];
+static int resets;
+
+int WINAPI WSAGetLastError(void) { return last_error; }
+void WINAPI WSASetLastError( int error ) { last_error = error; }
+
+int WINAPI ioctlsocket( SOCKET s, LONG cmd, u_long *argp )
+{
+    if (cmd != FIONBIO || s >= MAX_FDS || host_set_nonblocking( s, *argp != 0 ))
+    {
+        last_error = WSAENOTSOCK;
+        return SOCKET_ERROR;
+    }
+    host_nonblocking[s] = *argp != 0;
+    return 0;
+}
+
+static int host_result( int ret )
+{
+    if (ret >= 0) return ret;
+    last_error = ret == -1 ? WSAEWOULDBLOCK : WSAECONNRESET;
+    return SOCKET_ERROR;
+}
+
+int WINAPI test_recv( SOCKET s, char *buf, int len, int flags )
+{
+    return host_result( host_recv( s, buf, len ) );
+}
+
+int WINAPI test_send( SOCKET s, const char *buf, int len, int flags )
+{
+    return host_result( host_send( s, buf, len ) );
+}
+
+static void ready_set( fd_set *set, BOOL read, BOOL write, int *count )
+{
+    fd_set ready;
+    UINT i;
+
+    if (!set) return;
+    FD_ZERO( &ready );
+    for (i = 0; i < set->fd_count; i++)
+        if (host_poll( set->fd_array[i], read, write, 0 )) FD_SET( set->fd_array[i], &ready );
+    *count += ready.fd_count;
+    *set = ready;
+}
+
+int WINAPI test_select( int nfds, fd_set *read_set, fd_set *write_set, fd_set *except_set,
+                        const struct timeval *timeout )
+{
+    fd_set r, w;
+    unsigned int start = host_ticks(), wait = timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
+    int count;
+
+    for (;;)
+    {
+        count = 0;
+        if (read_set) r = *read_set;
+        if (write_set) w = *write_set;
+        ready_set( read_set ? &r : NULL, TRUE, FALSE, &count );
+        ready_set( write_set ? &w : NULL, FALSE, TRUE, &count );
+        if (count || host_ticks() - start >= wait) break;
+        host_sleep( 5 );
+    }
+    if (read_set) *read_set = r;
+    if (write_set) *write_set = w;
+    if (except_set) FD_ZERO( except_set );
+    return count;
+}
+
+int WINAPI test_getsockopt( SOCKET s, int level, int optname, char *optval, int *optlen )
+{
+    if (s >= MAX_FDS || level != SOL_SOCKET || optname != SO_LINGER || *optlen < sizeof(struct linger))
+    {
+        last_error = WSAENOPROTOOPT;
+        return SOCKET_ERROR;
+    }
+    memcpy( optval, &lingers[s], sizeof(struct linger) );
+    *optlen = sizeof(struct linger);
+    return 0;
+}
+
+int WINAPI test_setsockopt( SOCKET s, int level, int optname, const char *optval, int optlen )
+{
+    if (s >= MAX_FDS || level != SOL_SOCKET || optname != SO_LINGER || optlen < sizeof(struct linger))
+    {
+        last_error = WSAENOPROTOOPT;
+        return SOCKET_ERROR;
+    }
+    memcpy( &lingers[s], optval, sizeof(struct linger) );
+    return 0;
+}
+
+int WINAPI closesocket( SOCKET s )
+{
+    if (s >= MAX_FDS || !host_is_open( s ))
+    {
+        last_error = WSAENOTSOCK;
+        return SOCKET_ERROR;
+    }
+    if (lingers[s].l_onoff)
+    {
+        if (lingers[s].l_linger && host_nonblocking[s] && host_unsent( s ) > 0)
+        {
+            last_error = WSAEWOULDBLOCK;
+            return SOCKET_ERROR;
+        }
+        if (!lingers[s].l_linger) resets++;
+    }
+    memset( &lingers[s], 0, sizeof(lingers[s]) );
+    host_nonblocking[s] = FALSE;
+    host_close( s );
+    return 0;
+}
+
+/* the services the rest of blocking.c uses */
+HANDLE test_process_heap = (HANDLE)1;
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size ) { return calloc( 1, size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+void WINAPI EnterCriticalSection( CRITICAL_SECTION *crit ) { }
+void WINAPI LeaveCriticalSection( CRITICAL_SECTION *crit ) { }
+void WINAPI Sleep( DWORD ms ) { host_sleep( ms ); }
+DWORD WINAPI GetTickCount(void) { return host_ticks(); }
+
+static int thunk_lock = 1, lock_releases;
+
+VOID WINAPI ReleaseThunkLock( DWORD *count )
+{
+    *count = thunk_lock;
+    thunk_lock = 0;
+    lock_releases++;
+}
+
+VOID WINAPI RestoreThunkLock( DWORD count )
+{
+    thunk_lock = count;
+}
+
+/*
+ * The blocking hook, run once per wait. The tests play the peer from it,
+ * so they run on a single thread.
+ */
+static void (*hook)(void);
+static int hook_calls;
+static int peer, drain_size;
+static char received[0x40000];
+static int received_size;
+static int hook_cancel_at, hook_write_at;
+static int nested_fd, nested_error;
+
+BOOL call_blocking_hook(void)
+{
+    hook_calls++;
+    if (hook) hook();
+    return FALSE;
+}
+
+static void set_hook( void (*proc)(void) )
+{
+    hook = proc;
+    hook_calls = 0;
+    lock_releases = 0;
+}
+
+static void drain_peer( int max )
+{
+    int ret;
+
+    while (max > 0 && (ret = host_recv( peer, received + received_size,
+                                        min( max, (int)sizeof(received) - received_size ) )) > 0)
+    {
+        received_size += ret;
+        max -= ret;
+    }
+}
+
+static void drain_hook(void)
+{
+    drain_peer( drain_size );
+}
+
+static void write_hook(void)
+{
+    if (hook_calls == hook_write_at) host_send( peer, "hello", 5 );
+}
+
+static void cancel_hook(void)
+{
+    if (hook_calls == hook_cancel_at) cancel_blocking_call();
+}
+
+static void nested_hook(void)
+{
+    char buf[4];
+
+    last_error = 0;
+    if (blocking_recv( nested_fd, buf, sizeof(buf), 0 ) == SOCKET_ERROR) nested_error = last_error;
+    host_send( peer, "hello", 5 );
+}
+
+static void new_pair( int fds[2] )
+{
+    ok( !host_socketpair( fds ), "socketpair failed\n" );
+    ok( socket_state_add( fds[0] ), "socket_state_add failed\n" );
+    peer = fds[1];
+    received_size = 0;
+}
+
+static void fill_pattern( char *buf, int size )
+{
+    int i;
+
+    for (i = 0; i < size; i++) buf[i] = i * 7 + i / 251;
+}
+
+static void test_sends(void)
+{
+    static char buf[0x10000];
+    int fds[2], ret;
+
+    new_pair( fds );
+    fill_pattern( buf, sizeof(buf) );
+
+    /* the buffers are far smaller, so the hook has to drain the peer */
+    drain_size = 8192;
+    set_hook( drain_hook );
+    ret = blocking_send( fds[0], buf, sizeof(buf), 0 );
+    ok( ret == sizeof(buf), "sent %d\n", ret );
+    ok( hook_calls > 0, "hook not called\n" );
+    ok( lock_releases == hook_calls, "lock released %d times for %d hook calls\n", lock_releases, hook_calls );
+    ok( thunk_lock == 1, "lock not restored\n" );
+    ok( !in_blocking_call(), "still in a blocking call\n" );
+    drain_size = sizeof(buf);
+    while (received_size < sizeof(buf) && host_poll( peer, TRUE, FALSE, 1000 )) drain_peer( drain_size );
+    ok( received_size == sizeof(buf), "received %d\n", received_size );
+    ok( !memcmp( received, buf, sizeof(buf) ), "data differs\n" );
+
+    /* a non-blocking socket sends what fits and then fails */
+    ok( socket_state_set_nonblocking( fds[0], TRUE ), "FIONBIO failed\n" );
+    set_hook( drain_hook );
+    ret = blocking_send( fds[0], buf, sizeof(buf), 0 );
+    ok( ret > 0 && ret < sizeof(buf), "sent %d\n", ret );
+    last_error = 0;
+    ret = blocking_send( fds[0], buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && last_error == WSAEWOULDBLOCK, "got %d error %d\n", ret, last_error );
+    ok( !hook_calls, "hook called %d times\n", hook_calls );
+
+    host_close( fds[1] );
+    ok( !blocking_close( fds[0] ), "close failed\n" );
+}
+
+static void test_receives(void)
+{
+    char buf[16];
+    int fds[2], other[2], ret;
+
+    new_pair( fds );
+
+    /* waits until the peer writes */
+    hook_write_at = 3;
+    set_hook( write_hook );
+    memset( buf, 0, sizeof(buf) );
+    ret = blocking_recv( fds[0], buf, sizeof(buf), 0 );
+    ok( ret == 5 && !memcmp( buf, "hello", 5 ), "got %d %s\n", ret, buf );
+    ok( hook_calls == 3, "hook called %d times\n", hook_calls );
+
+    /* cancelled from the hook */
+    hook_cancel_at = 2;
+    set_hook( cancel_hook );
+    last_error = 0;
+    ret = blocking_recv( fds[0], buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && last_error == WSAEINTR, "got %d error %d\n", ret, last_error );
+    ok( hook_calls == 2, "hook called %d times\n", hook_calls );
+    ok( !in_blocking_call(), "still in a blocking call\n" );
+    ok( !cancel_blocking_call() && last_error == WSAEINVAL, "cancelled outside a call, error %d\n", last_error );
+
+    /* no blocking call from the hook */
+    new_pair( other );
+    peer = fds[1];
+    nested_fd = other[0];
+    nested_error = 0;
+    set_hook( nested_hook );
+    ret = blocking_recv( fds[0], buf, sizeof(buf), 0 );
+    ok( ret == 5, "got %d\n", ret );
+    ok( nested_error == WSAEINPROGRESS, "nested call error %d\n", nested_error );
+
+    /* WSAAsyncSelect makes it non-blocking for good */
+    socket_state_set_async( fds[0], TRUE );
+    last_error = 0;
+    ok( !socket_state_set_nonblocking( fds[0], FALSE ) && last_error == WSAEINVAL,
+        "cleared FIONBIO, error %d\n", last_error );
+    set_hook( NULL );
+    ret = blocking_recv( fds[0], buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && last_error == WSAEWOULDBLOCK, "got %d error %d\n", ret, last_error );
+    ok( !hook_calls, "hook called %d times\n", hook_calls );
+
+    /* accepted sockets get the view of the listener */
+    socket_state_inherit( other[0], fds[0] );
+    set_hook( NULL );
+    ret = blocking_recv( other[0], buf, sizeof(buf), 0 );
+    ok( ret == SOCKET_ERROR && last_error == WSAEWOULDBLOCK, "got %d error %d\n", ret, last_error );
+    ok( !hook_calls, "hook called %d times\n", hook_calls );
+    socket_state_set_async( fds[0], FALSE );
+    ok( socket_state_set_nonblocking( fds[0], FALSE ), "FIONBIO failed\n" );
+
+    ok( !blocking_close( fds[0] ), "close failed\n" );
+    ok( !blocking_close( other[0] ), "close failed\n" );
+    host_close( fds[1] );
+    host_close( other[1] );
+}
+
+static void fill_socket( int fd )
+{
+    static char buf[0x1000];
+
+    while (host_send( fd, buf, sizeof(buf) ) > 0);
+}
+
+static void test_closes(void)
+{
+    struct linger linger = { 1, 5 };
+    unsigned int start;
+    int fds[2], again[2], ret;
+    BOOL blocking;
+
+    /* waits for the peer to read everything */
+    new_pair( fds );
+    fill_socket( fds[0] );
+    ok( host_unsent( fds[0] ) > 0, "nothing unsent\n" );
+    test_setsockopt( fds[0], SOL_SOCKET, SO_LINGER, (char *)&linger, sizeof(linger) );
+    drain_size = 8192;
+    set_hook( drain_hook );
+    ret = blocking_close( fds[0] );
+    ok( !ret, "close failed, error %d\n", last_error );
+    ok( hook_calls > 0, "hook not called\n" );
+    ok( !host_is_open( fds[0] ), "socket still open\n" );
+    ok( !resets, "connection reset\n" );
+    drain_peer( sizeof(received) );
+    ok( !host_recv( peer, received, 1 ), "no end of stream\n" );
+    host_close( fds[1] );
+
+    /* a cancelled close leaves the socket open */
+    new_pair( fds );
+    fill_socket( fds[0] );
+    test_setsockopt( fds[0], SOL_SOCKET, SO_LINGER, (char *)&linger, sizeof(linger) );
+    hook_cancel_at = 2;
+    set_hook( cancel_hook );
+    last_error = 0;
+    ret = blocking_close( fds[0] );
+    ok( ret == SOCKET_ERROR && last_error == WSAEINTR, "got %d error %d\n", ret, last_error );
+    ok( host_is_open( fds[0] ), "socket closed\n" );
+
+    /* a non-blocking one fails at once and keeps its state */
+    ok( socket_state_set_nonblocking( fds[0], TRUE ), "FIONBIO failed\n" );
+    set_hook( NULL );
+    last_error = 0;
+    ret = blocking_close( fds[0] );
+    ok( ret == SOCKET_ERROR && last_error == WSAEWOULDBLOCK, "got %d error %d\n", ret, last_error );
+    ok( !hook_calls, "hook called %d times\n", hook_calls );
+    ok( begin_blocking_call( fds[0], &blocking ) && !blocking, "state lost\n" );
+    end_blocking_call( blocking );
+
+    /* the state goes with a successful close */
+    drain_peer( sizeof(received) );
+    ok( !blocking_close( fds[0] ), "close failed, error %d\n", last_error );
+    host_close( fds[1] );
+    ok( !host_socketpair( again ), "socketpair failed\n" );
+    if (again[0] == fds[0])
+    {
+        ok( begin_blocking_call( again[0], &blocking ) && blocking, "stale state\n" );
+        end_blocking_call( blocking );
+    }
+    ok( !blocking_close( again[0] ), "close failed\n" );
+    host_close( again[1] );
+
+    /* the connection is reset when the peer doesn't read in time */
+    new_pair( fds );
+    fill_socket( fds[0] );
+    linger.l_linger = 1;
+    test_setsockopt( fds[0], SOL_SOCKET, SO_LINGER, (char *)&linger, sizeof(linger) );
+    set_hook( NULL );
+    start = host_ticks();
+    ret = blocking_close( fds[0] );
+    ok( !ret, "close failed, error %d\n", last_error );
+    ok( host_ticks() - start >= 1000, "returned after %u ms\n", host_ticks() - start );
+    ok( resets == 1, "%d resets\n", resets );
+    ok( hook_calls > 0, "hook not called\n" );
+    host_close( fds[1] );
+}
+
+int main(void)
+{
+    test_sends();
+    test_receives();
+    test_closes();
+    return test_summary( "socketpair" );
+}
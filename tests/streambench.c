@@ -0,0 +1,214 @@
+/*
+ * Benchmark of the HGLOBAL-backed stream buffer (ole2/hglobalbuf.c)
+ *
+ * Writes multi-megabyte streams in 16- and 512-byte chunks, the way OLE
+ * objects and clipboard data get streamed, and reports the time taken
+ * along with how often the block was reallocated and how many bytes the
+ * reallocations copied. Growing the block to the exact size on every
+ * write, as SetSize does, is measured on a smaller stream for comparison.
+ * The counts are checked, the times are only printed.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "windef.h"
+#include "winbase.h"
+#include "winerror.h"
+#include "wine/winbase16.h"
+#include "hglobalbuf.h"
+#include "test.h"
+
+/*
+ * A global heap that moves every block it resizes, like a full 16-bit
+ * heap does, and refuses blocks over the 16-bit limit.
+ */
+#define MAX_BLOCKS 16
+
+static struct
+{
+    char *ptr;
+    DWORD size;
+} blocks[MAX_BLOCKS];
+
+static unsigned int reallocs;
+static unsigned long long copied;
+
+HGLOBAL16 WINAPI GlobalAlloc16( UINT16 flags, DWORD size )
+{
+    HGLOBAL16 handle;
+
+    for (handle = 1; handle < MAX_BLOCKS; handle++)
+    {
+        if (blocks[handle].ptr) continue;
+        blocks[handle].ptr = calloc( 1, size ? size : 1 );
+        blocks[handle].size = size;
+        return handle;
+    }
+    return 0;
+}
+
+HGLOBAL16 WINAPI GlobalReAlloc16( HGLOBAL16 handle, DWORD size, UINT16 flags )
+{
+    char *ptr;
+
+    if (!handle || handle >= MAX_BLOCKS || !blocks[handle].ptr) return 0;
+    if (size > HGLOBAL_BUFFER_MAX_CAPACITY) return 0;
+    if (!(ptr = malloc( size ? size : 1 ))) return 0;
+    memcpy( ptr, blocks[handle].ptr, min( size, blocks[handle].size ) );
+    copied += min( size, blocks[handle].size );
+    reallocs++;
+    free( blocks[handle].ptr );
+    blocks[handle].ptr = ptr;
+    blocks[handle].size = size;
+    return handle;
+}
+
+HGLOBAL16 WINAPI GlobalFree16( HGLOBAL16 handle )
+{
+    if (!handle || handle >= MAX_BLOCKS || !blocks[handle].ptr) return handle;
+    free( blocks[handle].ptr );
+    blocks[handle].ptr = NULL;
+    return 0;
+}
+
+DWORD WINAPI GlobalSize16( HGLOBAL16 handle )
+{
+    return handle < MAX_BLOCKS ? blocks[handle].size : 0;
+}
+
+LPVOID WINAPI GlobalLock16( HGLOBAL16 handle )
+{
+    return handle < MAX_BLOCKS ? blocks[handle].ptr : NULL;
+}
+
+BOOL16 WINAPI GlobalUnlock16( HGLOBAL16 handle )
+{
+    return FALSE;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_pattern( BYTE *data, ULONG size )
+{
+    ULONG i;
+
+    for (i = 0; i < size; i++) data[i] = i * 13 + i / 509;
+}
+
+/* write size bytes of data in chunks, growing exactly or geometrically */
+static void write_stream( const BYTE *data, ULONG size, ULONG chunk, BOOL exact )
+{
+    struct hglobal_buffer buffer;
+    static BYTE check[8 * 1024 * 1024];
+    double start, elapsed;
+    ULONG pos, count;
+    HRESULT hr = S_OK;
+
+    hglobal_buffer_init( &buffer, GlobalAlloc16( GMEM_MOVEABLE, 0 ) );
+    reallocs = 0;
+    copied = 0;
+
+    start = now();
+    for (pos = 0; pos < size && SUCCEEDED(hr); pos += chunk)
+    {
+        count = min( chunk, size - pos );
+        if (exact && FAILED(hr = hglobal_buffer_set_size( &buffer, pos + count ))) break;
+        hr = hglobal_buffer_write( &buffer, pos, data + pos, count );
+    }
+    hglobal_buffer_trim( &buffer );
+    elapsed = now() - start;
+
+    printf( "%4u-byte chunks, %5u KB, %-9s %8.3f ms %8.1f MB/s %7u reallocs %10llu KB copied\n",
+            chunk, size / 1024, exact ? "exact:" : "doubling:", elapsed * 1000,
+            size / 1048576.0 / elapsed, reallocs, copied / 1024 );
+
+    ok( hr == S_OK, "write failed %08x\n", hr );
+    ok( buffer.size == size, "size %u\n", buffer.size );
+    ok( buffer.capacity == size && GlobalSize16( buffer.handle ) == size,
+        "capacity %u block %u after trimming\n", buffer.capacity, GlobalSize16( buffer.handle ) );
+    if (!exact)
+    {
+        /* one reallocation per doubling from the minimum, plus the trim */
+        ok( reallocs <= 17, "%u reallocs\n", reallocs );
+        ok( copied < 2ull * size, "%llu bytes copied\n", copied );
+    }
+    ok( hglobal_buffer_read( &buffer, 0, check, sizeof(check) ) == size, "short read\n" );
+    ok( !memcmp( check, data, size ), "contents differ\n" );
+    GlobalFree16( buffer.handle );
+}
+
+static void test_limits(void)
+{
+    struct hglobal_buffer buffer;
+    BYTE data[16] = { 1, 2, 3 }, out[16];
+    HRESULT hr;
+
+    hglobal_buffer_init( &buffer, GlobalAlloc16( GMEM_MOVEABLE, 0 ) );
+    ok( buffer.size == 0 && buffer.capacity == 0, "size %u capacity %u\n", buffer.size, buffer.capacity );
+
+    /* the first write allocates the minimum capacity */
+    hr = hglobal_buffer_write( &buffer, 0, data, 3 );
+    ok( hr == S_OK && buffer.size == 3, "hr %08x size %u\n", hr, buffer.size );
+    ok( buffer.capacity == HGLOBAL_BUFFER_MIN_CAPACITY, "capacity %u\n", buffer.capacity );
+    ok( hglobal_buffer_read( &buffer, 3, out, sizeof(out) ) == 0, "read past the end\n" );
+    ok( hglobal_buffer_read( &buffer, 100, out, sizeof(out) ) == 0, "read past the end\n" );
+    ok( hglobal_buffer_read( &buffer, 1, out, sizeof(out) ) == 2 && out[0] == 2, "read failed\n" );
+
+    /* growth stops at the largest block */
+    hr = hglobal_buffer_write( &buffer, HGLOBAL_BUFFER_MAX_CAPACITY - sizeof(data), data, sizeof(data) );
+    ok( hr == S_OK && buffer.size == HGLOBAL_BUFFER_MAX_CAPACITY, "hr %08x size %u\n", hr, buffer.size );
+    ok( buffer.capacity == HGLOBAL_BUFFER_MAX_CAPACITY, "capacity %u\n", buffer.capacity );
+    hr = hglobal_buffer_write( &buffer, HGLOBAL_BUFFER_MAX_CAPACITY, data, 1 );
+    ok( hr == E_OUTOFMEMORY && buffer.size == HGLOBAL_BUFFER_MAX_CAPACITY, "hr %08x size %u\n", hr, buffer.size );
+    hr = hglobal_buffer_write( &buffer, ~0u, data, 2 );
+    ok( hr == E_OUTOFMEMORY, "hr %08x\n", hr );
+
+    /* SetSize is exact */
+    ok( hglobal_buffer_set_size( &buffer, 1000 ) == S_OK, "set_size failed\n" );
+    ok( buffer.size == 1000 && buffer.capacity == 1000 && GlobalSize16( buffer.handle ) == 1000,
+        "size %u capacity %u\n", buffer.size, buffer.capacity );
+    hglobal_buffer_write( &buffer, 1000, data, 1 );
+    ok( buffer.capacity == 2000, "capacity %u\n", buffer.capacity );
+    reallocs = 0;
+    hglobal_buffer_trim( &buffer );
+    hglobal_buffer_trim( &buffer );
+    ok( buffer.capacity == 1001 && reallocs == 1, "capacity %u, %u reallocs\n", buffer.capacity, reallocs );
+    GlobalFree16( buffer.handle );
+}
+
+int main(void)
+{
+    static BYTE data[8 * 1024 * 1024];
+
+    fill_pattern( data, sizeof(data) );
+    test_limits();
+    write_stream( data, sizeof(data), 16, FALSE );
+    write_stream( data, sizeof(data), 512, FALSE );
+    write_stream( data, 256 * 1024, 16, FALSE );
+    write_stream( data, 256 * 1024, 16, TRUE );
+    write_stream( data, 256 * 1024, 512, FALSE );
+    write_stream( data, 256 * 1024, 512, TRUE );
+    return test_summary( "streambench" );
+}
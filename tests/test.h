@@ -0,0 +1,61 @@
+/*
+ * Minimal test helpers for the host unit tests, after wine/test.h
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __OTVDM_TEST_H
+#define __OTVDM_TEST_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static int test_successes, test_failures;
+
+static void test_ok( const char *file, int line, int condition, const char *msg, ... )
+{
+    va_list args;
+
+    if (condition)
+    {
+        test_successes++;
+        return;
+    }
+    test_failures++;
+    fprintf( stderr, "%s:%d: Test failed: ", file, line );
+    va_start( args, msg );
+    vfprintf( stderr, msg, args );
+    va_end( args );
+}
+
+#define ok(cond, ...) test_ok( __FILE__, __LINE__, (cond), __VA_ARGS__ )
+
+/* return value of main */
+static int test_summary( const char *name )
+{
+    printf( "%s: %d tests executed, %d failures\n", name, test_successes + test_failures, test_failures );
+    return test_failures ? 1 : 0;
+}
+
+/* deterministic pseudo random numbers, so that failures can be replayed */
+static unsigned int test_seed = 12345;
+
+static unsigned int test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return (test_seed >> 16) & 0x7fff;
+}
+
+#endif /* __OTVDM_TEST_H */
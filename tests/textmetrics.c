@@ -0,0 +1,215 @@
+/*
+ * Tests of the text metrics cache (gdi/textcache.c) over a mock GDI
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "textcache.h"
+#include "test.h"
+
+/* the mock GDI: DCs are 1..16, fonts 0x100 and up, a font's char widths
+ * depend on the font, the char and the map mode */
+#define MAX_DCS 16
+
+static struct
+{
+    HFONT font;
+    INT   map_mode;
+} dcs[MAX_DCS + 1];
+
+static int metrics_calls, width_calls;
+static BOOL widths_fail;
+
+static HDC dc( int i ) { return (HDC)(ULONG_PTR)i; }
+static HFONT font( int i ) { return (HFONT)(ULONG_PTR)(0x100 + i); }
+
+static int dc_index( HDC hdc )
+{
+    ULONG_PTR i = (ULONG_PTR)hdc;
+    return i >= 1 && i <= MAX_DCS ? i : 0;
+}
+
+static INT overhang_of( HFONT hfont ) { return (ULONG_PTR)hfont & 3; }
+
+static INT width_of( HFONT hfont, INT map_mode, UINT ch )
+{
+    return ((ULONG_PTR)hfont & 0xff) + ch % 7 + (map_mode == MM_TEXT ? 0 : 100);
+}
+
+HGDIOBJ WINAPI GetCurrentObject( HDC hdc, UINT type )
+{
+    ok( type == OBJ_FONT, "type %u\n", type );
+    return dcs[dc_index( hdc )].font;
+}
+
+INT WINAPI GetMapMode( HDC hdc )
+{
+    return dcs[dc_index( hdc )].map_mode;
+}
+
+BOOL WINAPI GetTextMetricsA( HDC hdc, TEXTMETRICA *tm )
+{
+    HFONT hfont = dcs[dc_index( hdc )].font;
+
+    metrics_calls++;
+    if (!hfont) return FALSE;
+    memset( tm, 0, sizeof(*tm) );
+    tm->tmOverhang = overhang_of( hfont );
+    return TRUE;
+}
+
+BOOL WINAPI GetCharWidth32A( HDC hdc, UINT first, UINT last, INT *buffer )
+{
+    int i = dc_index( hdc );
+
+    width_calls++;
+    ok( first <= last && last - first < 256, "range %x-%x\n", first, last );
+    if (widths_fail || !i) return FALSE;
+    for (; first <= last; first++) *buffer++ = width_of( dcs[i].font, dcs[i].map_mode, first );
+    return TRUE;
+}
+
+static void select_font( int i, HFONT hfont )
+{
+    dcs[i].font = hfont;
+    dcs[i].map_mode = MM_TEXT;
+}
+
+/* compare get_char_widths16 with the mock */
+static BOOL check_widths( int i, UINT first, UINT last )
+{
+    static INT16 buffer[0x10000];
+    HFONT hfont = dcs[i].font;
+    UINT ch;
+
+    if (!get_char_widths16( dc( i ), first, last, buffer )) return FALSE;
+    for (ch = first; ch <= last; ch++)
+    {
+        INT expect = width_of( hfont, dcs[i].map_mode, ch ) + (hfont ? overhang_of( hfont ) : 0);
+        if (buffer[ch - first] != expect) return FALSE;
+    }
+    return TRUE;
+}
+
+static void test_hits(void)
+{
+    select_font( 1, font( 1 ) );
+    metrics_calls = width_calls = 0;
+    ok( check_widths( 1, 'A', 'Z' ), "wrong widths\n" );
+    ok( metrics_calls == 1 && width_calls == 1, "%d/%d calls\n", metrics_calls, width_calls );
+
+    /* everything else in 0-255 comes from the cache */
+    ok( check_widths( 1, 0, 255 ), "wrong widths\n" );
+    ok( check_widths( 1, 'x', 'x' ), "wrong width\n" );
+    ok( get_text_overhang( dc( 1 ) ) == 1, "overhang %d\n", get_text_overhang( dc( 1 ) ) );
+    ok( metrics_calls == 1 && width_calls == 1, "%d/%d calls\n", metrics_calls, width_calls );
+}
+
+static void test_changes(void)
+{
+    select_font( 1, font( 1 ) );
+    check_widths( 1, 0, 10 );
+
+    /* a font selected by 32-bit code, without a flush */
+    metrics_calls = 0;
+    dcs[1].font = font( 2 );
+    ok( check_widths( 1, 0, 10 ), "old font used\n" );
+    ok( get_text_overhang( dc( 1 ) ) == 2, "overhang %d\n", get_text_overhang( dc( 1 ) ) );
+    ok( metrics_calls == 1, "%d calls\n", metrics_calls );
+
+    /* map mode */
+    dcs[1].map_mode = MM_ANISOTROPIC;
+    ok( check_widths( 1, 0, 10 ), "old map mode used\n" );
+
+    /* the extents change with the same font and map mode: flushed by gdi.c */
+    metrics_calls = 0;
+    flush_text_metrics_cache( dc( 1 ), 0 );
+    ok( check_widths( 1, 0, 10 ), "wrong widths\n" );
+    ok( metrics_calls == 1, "%d calls\n", metrics_calls );
+
+    /* a deleted font whose handle comes back for another font */
+    metrics_calls = 0;
+    flush_text_metrics_cache( 0, font( 2 ) );
+    ok( check_widths( 1, 0, 10 ), "wrong widths\n" );
+    ok( metrics_calls == 1, "%d calls\n", metrics_calls );
+
+    /* flushing another DC or font leaves the entry alone */
+    metrics_calls = 0;
+    flush_text_metrics_cache( dc( 2 ), font( 3 ) );
+    ok( check_widths( 1, 0, 10 ), "wrong widths\n" );
+    ok( metrics_calls == 0, "%d calls\n", metrics_calls );
+}
+
+static void test_ranges(void)
+{
+    select_font( 3, font( 5 ) );
+
+    width_calls = 0;
+    ok( check_widths( 3, 0x100, 0x3ff ), "wrong widths\n" );
+    ok( width_calls == 3, "%d calls\n", width_calls );
+    ok( check_widths( 3, 0xf0, 0x110 ), "wrong widths across 0xff\n" );
+    ok( check_widths( 3, 0x1234, 0x1234 ), "wrong width\n" );
+    ok( check_widths( 3, 0, 0xffff ), "wrong widths of the whole range\n" );
+    ok( !check_widths( 3, 10, 9 ), "reversed range succeeded\n" );
+
+    /* a DC without a font still gets its widths, without overhang */
+    dcs[4].font = 0;
+    ok( check_widths( 4, 'a', 'c' ), "wrong widths\n" );
+    ok( get_text_overhang( dc( 4 ) ) == 0, "overhang %d\n", get_text_overhang( dc( 4 ) ) );
+
+    /* GDI failures are passed on and nothing bad is cached */
+    select_font( 5, font( 6 ) );
+    widths_fail = TRUE;
+    ok( !check_widths( 5, 0, 10 ), "failure not returned\n" );
+    ok( !check_widths( 5, 0x300, 0x310 ), "failure not returned\n" );
+    widths_fail = FALSE;
+    ok( check_widths( 5, 0, 10 ), "failure cached\n" );
+}
+
+static void test_eviction(void)
+{
+    int i, round, bad = 0;
+
+    for (i = 1; i <= MAX_DCS; i++) select_font( i, font( i ) );
+    metrics_calls = 0;
+    for (round = 0; round < 3; round++)
+        for (i = 1; i <= MAX_DCS; i++)
+            bad += !check_widths( i, 0, 255 );
+    ok( !bad, "%d wrong results\n", bad );
+    /* twice the DCs the cache holds, each one was evicted before it came back */
+    ok( metrics_calls == 3 * MAX_DCS, "%d calls\n", metrics_calls );
+
+    metrics_calls = 0;
+    for (round = 0; round < 3; round++)
+        for (i = 1; i <= TEXT_METRICS_CACHE_SIZE; i++)
+            bad += !check_widths( i, 0, 255 );
+    ok( !bad, "%d wrong results\n", bad );
+    ok( metrics_calls <= TEXT_METRICS_CACHE_SIZE, "%d calls\n", metrics_calls );
+}
+
+int main(void)
+{
+    test_hits();
+    test_changes();
+    test_ranges();
+    test_eviction();
+    return test_summary( "textmetrics" );
+}
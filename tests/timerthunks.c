@@ -0,0 +1,244 @@
+/*
+ * Tests of the 16-bit timer proc thunks (user/timerthunk.c)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "winuser.h"
+#include "wownt32.h"
+#include "user_private.h"
+#include "timerthunk.h"
+#include "test.h"
+
+/*
+ * Fake host: the reserved area is plain memory that only counts as
+ * committed up to the last commit, windows are numbers below a limit,
+ * and heap allocations can be made to fail.
+ */
+static BYTE *reserved;
+static SIZE_T committed;
+static BOOL fail_alloc;
+static UINT_PTR dead_windows_below;
+static unsigned int window_checks;
+
+HANDLE test_process_heap = (HANDLE)1;
+
+HWND test_handle32( HWND16 hwnd16 ) { return (HWND)(ULONG_PTR)hwnd16; }
+
+LPVOID WINAPI VirtualAlloc( LPVOID addr, SIZE_T size, DWORD type, DWORD protect )
+{
+    if (type == MEM_RESERVE)
+    {
+        ok( !reserved, "reserved twice\n" );
+        ok( size == TIMER_THUNK_AREA_SIZE, "reserved %lx\n", (ULONG)size );
+        return reserved = calloc( 1, size );
+    }
+    ok( type == MEM_COMMIT, "type %x\n", type );
+    ok( (BYTE *)addr == reserved + committed, "commit at %p, expected %p\n", addr, reserved + committed );
+    if ((BYTE *)addr + size > reserved + TIMER_THUNK_AREA_SIZE) return NULL;
+    committed += size;
+    return addr;
+}
+
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size )
+{
+    if (fail_alloc) return NULL;
+    return flags & HEAP_ZERO_MEMORY ? calloc( 1, size ) : malloc( size );
+}
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+
+static BOOL WINAPI window_exists( HWND hwnd )
+{
+    window_checks++;
+    return (UINT_PTR)hwnd >= dead_windows_below;
+}
+
+static void CALLBACK thunk_target(void) {}
+
+#define PROC(n)  ((LPVOID)(UINT_PTR)MAKELONG(0x1234, (n)))
+#define WND(n)   ((HWND)(UINT_PTR)(n))
+
+static TIMERTHUNK *set_timer( HWND hwnd, UINT_PTR id, BOOL system, LPVOID proc )
+{
+    TIMERTHUNK *thunk = get_timer_thunk( proc, thunk_target, window_exists );
+
+    if (thunk && !set_timer_use( hwnd, id, system, thunk ))
+    {
+        release_timer_thunk( thunk );
+        return NULL;
+    }
+    return thunk;
+}
+
+static void kill_timer( HWND hwnd, UINT_PTR id, BOOL system )
+{
+    set_timer_use( hwnd, id, system, NULL );
+}
+
+static void test_code(void)
+{
+    TIMERTHUNK *thunk = set_timer( WND(1), 1, FALSE, PROC(1) );
+
+    ok( thunk != NULL, "no thunk\n" );
+    ok( thunk->pop_eax == 0x58 && thunk->push_imm == 0x68 && thunk->push_eax == 0x50 && thunk->jmp == 0xe9,
+        "wrong code\n" );
+    ok( thunk->this_ == thunk, "this %p\n", thunk->this_ );
+    ok( (UINT_PTR)(&thunk->func + 1) + thunk->func == (UINT_PTR)thunk_target, "wrong jump\n" );
+    ok( thunk->param == PROC(1), "param %p\n", thunk->param );
+    ok( is_timer_thunk( (TIMERPROC)thunk ), "not a thunk\n" );
+    ok( !is_timer_thunk( (TIMERPROC)thunk_target ), "target is a thunk\n" );
+    kill_timer( WND(1), 1, FALSE );
+}
+
+static void test_sharing(void)
+{
+    TIMERTHUNK *a, *b, *c;
+
+    /* one thunk per proc, with a reference per timer */
+    a = set_timer( WND(1), 1, FALSE, PROC(1) );
+    b = set_timer( WND(1), 2, FALSE, PROC(1) );
+    c = set_timer( WND(2), 1, FALSE, PROC(2) );
+    ok( a == b, "thunk not shared\n" );
+    ok( a != c, "thunk shared between procs\n" );
+    ok( a->refs == 2, "refs %d\n", a->refs );
+
+    ok( check_timer_use( a, WND(1), 1, FALSE ), "timer 1 not set\n" );
+    ok( check_timer_use( a, WND(1), 2, FALSE ), "timer 2 not set\n" );
+    ok( !check_timer_use( a, WND(1), 1, TRUE ), "system timer 1 set\n" );
+    ok( !check_timer_use( a, WND(2), 1, FALSE ), "timer of another proc accepted\n" );
+    ok( !check_timer_use( a, WND(1), 3, FALSE ), "unknown timer accepted\n" );
+
+    /* killing a timer drops its reference only */
+    kill_timer( WND(1), 1, FALSE );
+    ok( !check_timer_use( a, WND(1), 1, FALSE ), "killed timer accepted\n" );
+    ok( check_timer_use( a, WND(1), 2, FALSE ), "timer 2 not set\n" );
+    ok( a->refs == 1, "refs %d\n", a->refs );
+    kill_timer( WND(1), 1, FALSE );
+    ok( a->refs == 1, "refs %d after killing twice\n", a->refs );
+
+    /* setting another proc moves the timer to its thunk */
+    b = set_timer( WND(1), 2, FALSE, PROC(2) );
+    ok( b == c, "thunk not shared\n" );
+    ok( !a->refs, "refs %d\n", a->refs );
+    ok( !check_timer_use( a, WND(1), 2, FALSE ), "old thunk accepted\n" );
+    ok( check_timer_use( c, WND(1), 2, FALSE ), "new thunk refused\n" );
+
+    /* system timers are separate */
+    b = set_timer( WND(1), 2, TRUE, PROC(3) );
+    ok( check_timer_use( c, WND(1), 2, FALSE ), "timer replaced by system timer\n" );
+    ok( check_timer_use( b, WND(1), 2, TRUE ), "system timer not set\n" );
+    kill_timer( WND(1), 2, TRUE );
+    kill_timer( WND(1), 2, FALSE );
+    kill_timer( WND(2), 1, FALSE );
+    ok( !c->refs && !b->refs, "refs %d %d\n", c->refs, b->refs );
+}
+
+static void test_reuse(void)
+{
+    TIMERTHUNK *first, *thunk;
+    UINT i, count = get_timer_thunk_count();
+
+    /* freed thunks are reused last */
+    first = set_timer( WND(1), 1, FALSE, PROC(10) );
+    kill_timer( WND(1), 1, FALSE );
+    for (i = 0; i < count - 1; i++)
+    {
+        thunk = set_timer( WND(2), 100 + i, FALSE, PROC(100 + i) );
+        ok( thunk != first, "freed thunk reused after %u\n", i );
+    }
+    thunk = set_timer( WND(3), 1, FALSE, PROC(11) );
+    ok( thunk == first, "freed thunk not reused\n" );
+    ok( get_timer_thunk_count() == count, "grew to %u\n", get_timer_thunk_count() );
+
+    /* a message of the killed timer doesn't reach the new proc */
+    ok( !check_timer_use( thunk, WND(1), 1, FALSE ), "stale timer accepted\n" );
+    ok( check_timer_use( thunk, WND(3), 1, FALSE ), "new timer refused\n" );
+    ok( thunk->param == PROC(11), "param %p\n", thunk->param );
+
+    kill_timer( WND(3), 1, FALSE );
+    for (i = 0; i < count - 1; i++) kill_timer( WND(2), 100 + i, FALSE );
+}
+
+static void test_growth(void)
+{
+    TIMERTHUNK *thunk, *last = NULL;
+    UINT i, count = get_timer_thunk_count();
+
+    ok( committed == 0x1000, "committed %lx\n", (ULONG)committed );
+    for (i = 0; i < count + 1; i++) last = set_timer( WND(1000), i, FALSE, PROC(1000 + i) );
+    ok( last != NULL, "no thunk\n" );
+    ok( committed == 0x2000, "committed %lx\n", (ULONG)committed );
+    ok( get_timer_thunk_count() == 0x2000 / sizeof(TIMERTHUNK), "%u thunks\n", get_timer_thunk_count() );
+    ok( is_timer_thunk( (TIMERPROC)last ), "not a thunk\n" );
+
+    /* timers of destroyed windows are collected before the area grows */
+    for (i = count + 1; i < get_timer_thunk_count(); i++)
+        set_timer( WND(2000), i, FALSE, PROC(1000 + i) );
+    dead_windows_below = 1001;
+    window_checks = 0;
+    thunk = set_timer( WND(3000), 1, FALSE, PROC(5000) );
+    ok( thunk != NULL, "no thunk\n" );
+    ok( window_checks > 0, "windows not checked\n" );
+    ok( committed == 0x2000, "committed %lx\n", (ULONG)committed );
+    ok( !check_timer_use( last, WND(1000), count, FALSE ), "timer of a destroyed window kept\n" );
+    dead_windows_below = 0;
+
+    kill_timer( WND(3000), 1, FALSE );
+    for (i = count + 1; i < get_timer_thunk_count(); i++) kill_timer( WND(2000), i, FALSE );
+
+    /* the area grows until the reserved area is full */
+    thunk = set_timer( NULL, 7, FALSE, PROC(6000) );
+    for (i = 0; set_timer( WND(4000), i, FALSE, PROC(7000 + i) ); i++);
+    ok( committed == TIMER_THUNK_AREA_SIZE, "committed %lx\n", (ULONG)committed );
+    ok( get_timer_thunk_count() == TIMER_THUNK_MAX, "%u thunks\n", get_timer_thunk_count() );
+    ok( !get_timer_thunk( PROC(0xffff), thunk_target, window_exists ), "got a thunk\n" );
+    /* but a proc that has one still gets it */
+    ok( get_timer_thunk( PROC(6000), thunk_target, window_exists ) == thunk, "thunk not shared\n" );
+    release_timer_thunk( thunk );
+
+    /* thread timers are never collected */
+    dead_windows_below = ~(UINT_PTR)0;
+    ok( set_timer( WND(5000), 1, FALSE, PROC(0xffff) ) != NULL, "no thunk\n" );
+    ok( check_timer_use( thunk, NULL, 7, FALSE ), "thread timer collected\n" );
+    dead_windows_below = 0;
+}
+
+static void test_no_memory(void)
+{
+    TIMERTHUNK *thunk = get_timer_thunk( PROC(6000), thunk_target, window_exists );
+
+    fail_alloc = TRUE;
+    ok( !set_timer_use( WND(6000), 1, FALSE, thunk ), "timer recorded\n" );
+    ok( !check_timer_use( thunk, WND(6000), 1, FALSE ), "timer accepted\n" );
+    /* changing a recorded timer doesn't allocate */
+    ok( set_timer_use( NULL, 7, FALSE, thunk ), "timer not changed\n" );
+    ok( thunk->refs == 1, "refs %d\n", thunk->refs );
+    fail_alloc = FALSE;
+}
+
+int main(void)
+{
+    test_code();
+    test_sharing();
+    test_reuse();
+    test_growth();
+    test_no_memory();
+    return test_summary( "timerthunks" );
+}
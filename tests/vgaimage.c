@@ -0,0 +1,303 @@
+/*
+ * Golden image tests of the VGA planar memory (krnl386/vgahw.c)
+ *
+ * Scenes are drawn through the CPU side of the planar memory and the
+ * displayed scanlines are compared with checksums of known good frames
+ * and a few pixels worked out by hand. With VGA_IMAGE_DIR set in the
+ * environment the frames are also written there as PGM files, which is
+ * how the checksums were checked when they changed.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "vga.h"
+#include "vgahw.h"
+#include "test.h"
+
+HANDLE test_process_heap = (HANDLE)1;
+
+/* DOS memory at 0xa0000 and the framebuffer int10.c allocates */
+static BYTE window[0x10000];
+static BYTE framebuffer[256 * 1024];
+static BYTE image[640 * 480];
+
+BOOL DOSMEM_InitDosMemory(void) { return TRUE; }
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size ) { return calloc( 1, size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+void VGA_SetPalette( PALETTEENTRY *pal, int start, int len ) { }
+
+/* the geometry VGA_SetGraphicMode sets up before it switches the window */
+static void set_mode( int width, int height, int depth, int start )
+{
+    vga_fb_width = width;
+    vga_fb_height = height;
+    vga_fb_depth = depth;
+    vga_fb_pitch = width * ((depth + 7) / 8);
+    vga_fb_data = (char *)framebuffer;
+    vga_fb_size = sizeof(framebuffer);
+    vga_fb_window_data = (char *)window;
+    vga_fb_window_size = sizeof(window);
+    VGA_SwitchWindow( start, TRUE );
+}
+
+static void render(void)
+{
+    int y;
+
+    for (y = 0; y < vga_fb_height; y++)
+        VGA_GetPlanarLine( y, vga_fb_width, NULL, image + y * vga_fb_width );
+}
+
+/* FNV-1a of the displayed pixel indices */
+static DWORD image_hash(void)
+{
+    DWORD hash = 0x811c9dc5;
+    int i;
+
+    for (i = 0; i < vga_fb_width * vga_fb_height; i++)
+        hash = (hash ^ image[i]) * 0x01000193;
+    return hash;
+}
+
+static void dump_image( const char *name, int scale )
+{
+    const char *dir = getenv( "VGA_IMAGE_DIR" );
+    char path[MAX_PATH];
+    FILE *file;
+    int i;
+
+    if (!dir) return;
+    snprintf( path, sizeof(path), "%s/%s.pgm", dir, name );
+    if (!(file = fopen( path, "wb" ))) return;
+    fprintf( file, "P5\n%d %d\n255\n", vga_fb_width, vga_fb_height );
+    for (i = 0; i < vga_fb_width * vga_fb_height; i++) fputc( image[i] * scale, file );
+    fclose( file );
+}
+
+static BYTE pixel( int x, int y )
+{
+    return image[y * vga_fb_width + x];
+}
+
+static void set_gc( int index, BYTE value )
+{
+    vga_gc_regs[index] = value;
+}
+
+/* mode 12h, drawn the way EGA programs do */
+static void test_mode12(void)
+{
+    DWORD offset, hash;
+    int x, y, color;
+
+    set_mode( 640, 480, 4, -1 );
+    ok( vga_planar_pitch == 80, "pitch %u\n", vga_planar_pitch );
+    ok( *VGA_GetPlanarBase() == (DWORD)(SIZE_T)window, "planar window not mapped\n" );
+
+    /* write mode 2: 16 vertical bars of 40 pixels */
+    set_gc( 5, 2 );
+    for (y = 0; y < 480; y++)
+        for (x = 0; x < 80; x++)
+            VGA_PlanarWrite( y * 80 + x, x / 5 );
+
+    /* write mode 0 with set/reset: a white line on the top and bottom
+     * scanlines, the bit mask limits it to the left half of each byte */
+    set_gc( 5, 0 );
+    set_gc( 0, 0x0f );
+    set_gc( 1, 0x0f );
+    set_gc( 8, 0xf0 );
+    for (x = 0; x < 80; x++)
+    {
+        VGA_PlanarRead( x );
+        VGA_PlanarWrite( x, 0 );
+        VGA_PlanarRead( 479 * 80 + x );
+        VGA_PlanarWrite( 479 * 80 + x, 0 );
+    }
+    set_gc( 1, 0 );
+    set_gc( 8, 0xff );
+
+    /* XOR a band with all planes set, rotated by 4 so 0x0f becomes 0xf0 */
+    set_gc( 3, 0x18 | 4 );
+    for (y = 200; y < 240; y++)
+        for (x = 0; x < 80; x++)
+        {
+            VGA_PlanarRead( y * 80 + x );
+            VGA_PlanarWrite( y * 80 + x, 0x0f );
+        }
+    set_gc( 3, 0 );
+
+    /* write mode 1 copies the latches: rows 100-109 to 400-409 */
+    set_gc( 5, 1 );
+    for (y = 0; y < 10; y++)
+        for (x = 0; x < 80; x++)
+        {
+            VGA_PlanarRead( (100 + y) * 80 + x );
+            VGA_PlanarWrite( (400 + y) * 80 + x, 0 );
+        }
+
+    /* write mode 3 through the map mask: the value masks the bits, color 9
+     * reaches plane 0 and 3 only and turns the dots on bar 3 into 11 */
+    set_gc( 5, 3 );
+    set_gc( 0, 9 );
+    vga_seq_regs[2] = 0x09;
+    for (y = 300; y < 310; y++)
+        for (x = 0; x < 80; x++)
+        {
+            VGA_PlanarRead( y * 80 + x );
+            VGA_PlanarWrite( y * 80 + x, 0x81 );
+        }
+    vga_seq_regs[2] = 0x0f;
+    set_gc( 0, 0 );
+    set_gc( 5, 0 );
+
+    render();
+    dump_image( "mode12", 16 );
+
+    ok( pixel( 0, 50 ) == 0 && pixel( 39, 50 ) == 0, "bar 0 is %u\n", pixel( 0, 50 ) );
+    ok( pixel( 40, 50 ) == 1 && pixel( 639, 50 ) == 15, "bars %u %u\n", pixel( 40, 50 ), pixel( 639, 50 ) );
+    ok( pixel( 0, 0 ) == 15 && pixel( 3, 0 ) == 15 && pixel( 4, 0 ) == 0, "top line %u %u %u\n",
+        pixel( 0, 0 ), pixel( 3, 0 ), pixel( 4, 0 ) );
+    ok( pixel( 80, 479 ) == 15 && pixel( 84, 479 ) == 2, "bottom line %u %u\n", pixel( 80, 479 ), pixel( 84, 479 ) );
+    ok( pixel( 40, 220 ) == 14 && pixel( 44, 220 ) == 1, "XOR band %u %u\n", pixel( 40, 220 ), pixel( 44, 220 ) );
+    ok( pixel( 120, 300 ) == 11 && pixel( 121, 300 ) == 3 && pixel( 127, 300 ) == 11,
+        "masked dots %u %u %u\n", pixel( 120, 300 ), pixel( 121, 300 ), pixel( 127, 300 ) );
+    for (color = 0, x = 0; x < 640; x++) color |= pixel( x, 405 ) != pixel( x, 105 );
+    ok( !color, "latch copy differs\n" );
+
+    hash = image_hash();
+    ok( hash == 0xe69a8505, "mode 12h frame hash %08x\n", hash );
+
+    /* read mode 1 finds the bar of color 5 */
+    set_gc( 5, 0x08 );
+    set_gc( 2, 5 );
+    set_gc( 7, 0x0f );
+    ok( VGA_PlanarRead( 50 * 80 + 25 ) == 0xff, "color compare %02x\n", VGA_PlanarRead( 50 * 80 + 25 ) );
+    ok( VGA_PlanarRead( 50 * 80 + 30 ) == 0x00, "color compare %02x\n", VGA_PlanarRead( 50 * 80 + 30 ) );
+    set_gc( 5, 0 );
+
+    /* the start address scrolls the display */
+    offset = 100 * 80;
+    vga_crtc_regs[0x0c] = offset >> 8;
+    vga_crtc_regs[0x0d] = offset & 0xff;
+    render();
+    ok( pixel( 0, 0 ) == 0 && pixel( 40, 120 ) == 14, "scrolled %u %u\n", pixel( 0, 0 ), pixel( 40, 120 ) );
+    vga_crtc_regs[0x0c] = vga_crtc_regs[0x0d] = 0;
+
+    /* only the written scanlines are converted with dirty flags */
+    memset( vga_planar_dirty, 0, sizeof(vga_planar_dirty) );
+    VGA_PlanarWrite( 250 * 80 + 79, 0 );
+    ok( !VGA_GetPlanarLine( 249, 640, vga_planar_dirty, image ), "clean line converted\n" );
+    ok( VGA_GetPlanarLine( 250, 640, vga_planar_dirty, image ), "dirty line skipped\n" );
+}
+
+/* unchained 320x240 256 color Mode X */
+static void test_modex(void)
+{
+    DWORD hash;
+    int x, y, bad = 0;
+
+    set_mode( 320, 240, 8, -1 );
+    ok( vga_planar_pitch == 80, "pitch %u\n", vga_planar_pitch );
+
+    for (x = 0; x < 320; x++)
+    {
+        vga_seq_regs[2] = 1 << (x & 3);
+        for (y = 0; y < 240; y++)
+            VGA_PlanarWrite( y * 80 + x / 4, (x ^ y) & 0xff );
+    }
+    vga_seq_regs[2] = 0x0f;
+
+    render();
+    dump_image( "modex", 1 );
+    for (y = 0; y < 240; y++)
+        for (x = 0; x < 320; x++)
+            bad += pixel( x, y ) != ((x ^ y) & 0xff);
+    ok( !bad, "%d pixels differ\n", bad );
+
+    hash = image_hash();
+    ok( hash == 0x696da4c5, "Mode X frame hash %08x\n", hash );
+}
+
+/* a mode set must not carry the old mode's memory over */
+static void test_mode_set(void)
+{
+    int i, bad = 0;
+
+    set_mode( 640, 480, 4, -1 );
+    for (i = 0; i < 0x8000; i++) VGA_PlanarWrite( i, 0xa5 );
+
+    /* 12h to 13h */
+    set_mode( 320, 200, 8, 0 );
+    ok( *VGA_GetPlanarBase() == 0, "planar window still mapped\n" );
+    for (i = 0; i < sizeof(window); i++) bad += window[i] != 0;
+    for (i = 0; i < sizeof(framebuffer); i++) bad += framebuffer[i] != 0;
+    ok( !bad, "%d bytes of the old mode left\n", bad );
+
+    /* 13h to 12h */
+    for (i = 0; i < sizeof(window); i++) window[i] = i;
+    set_mode( 640, 480, 4, -1 );
+    render();
+    for (i = 0, bad = 0; i < 640 * 480; i++) bad += image[i] != 0;
+    ok( !bad, "%d pixels of the old mode left\n", bad );
+
+    /* same window, still cleared */
+    for (i = 0; i < sizeof(window); i++) window[i] = i;
+    set_mode( 320, 200, 8, 0 );
+    set_mode( 320, 200, 8, 0 );
+    for (i = 0, bad = 0; i < sizeof(window); i++) bad += window[i] != 0;
+    ok( !bad, "%d bytes of the old mode left\n", bad );
+}
+
+/* switching a 256 color mode between chained and unchained keeps the pixels */
+static void test_chain4(void)
+{
+    int i, bad = 0;
+
+    set_mode( 320, 200, 8, 0 );
+    for (i = 0; i < 64000; i++) window[i] = i * 7;
+
+    VGA_SwitchWindow( -1, FALSE );
+    ok( vga_fb_window == -1, "window %d\n", vga_fb_window );
+    render();
+    for (i = 0; i < 64000; i++) bad += image[i] != (BYTE)(i * 7);
+    ok( !bad, "%d pixels lost going unchained\n", bad );
+
+    vga_seq_regs[2] = 0x02;
+    VGA_PlanarWrite( 0, 0x55 );
+    vga_seq_regs[2] = 0x0f;
+
+    VGA_SwitchWindow( 0, FALSE );
+    ok( *VGA_GetPlanarBase() == 0, "planar window still mapped\n" );
+    ok( window[1] == 0x55, "got %02x\n", window[1] );
+    for (i = 2, bad = 0; i < 64000; i++) bad += window[i] != (BYTE)(i * 7);
+    ok( !bad, "%d pixels lost going chained\n", bad );
+}
+
+int main(void)
+{
+    test_mode12();
+    test_modex();
+    test_mode_set();
+    test_chain4();
+    return test_summary( "vgaimage" );
+}
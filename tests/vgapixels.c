@@ -0,0 +1,293 @@
+/*
+ * Tests of the BIOS pixel services of the VGA emulation (krnl386/vgahw.c)
+ *
+ * Pixels, spans, scrolls and glyphs are drawn in the memory model of
+ * each kind of mode, CGA, planar, Mode X, chained and VESA, and checked
+ * in the window, the planes and the framebuffer where the display code
+ * picks them up.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "wine/winbase16.h"
+#include "kernel16_private.h"
+#include "vga.h"
+#include "vgahw.h"
+#include "test.h"
+
+HANDLE test_process_heap = (HANDLE)1;
+
+/* DOS memory at 0xa0000 or 0xb8000 and the framebuffer int10.c allocates */
+static BYTE window[0x10000];
+static BYTE framebuffer[640 * 480];
+
+BOOL DOSMEM_InitDosMemory(void) { return TRUE; }
+LPVOID WINAPI HeapAlloc( HANDLE heap, DWORD flags, SIZE_T size ) { return calloc( 1, size ); }
+BOOL WINAPI HeapFree( HANDLE heap, DWORD flags, LPVOID ptr ) { free( ptr ); return TRUE; }
+void VGA_SetPalette( PALETTEENTRY *pal, int start, int len ) { }
+
+/* the geometry VGA_SetGraphicMode sets up before it switches the window */
+static void set_mode( int width, int height, int depth, int start, BOOL linear )
+{
+    vga_fb_width = width;
+    vga_fb_height = height;
+    vga_fb_depth = depth;
+    vga_fb_pitch = width * ((depth + 7) / 8);
+    vga_fb_data = (char *)framebuffer;
+    vga_fb_size = sizeof(framebuffer);
+    vga_fb_window_data = (char *)window;
+    vga_fb_window_size = sizeof(window);
+    vga_fb_linear = linear;
+    VGA_SwitchWindow( start, TRUE );
+    memset( vga_planar_dirty, 0, sizeof(vga_planar_dirty) );
+}
+
+static BYTE plane_byte( DWORD offset, int plane )
+{
+    return ((BYTE *)&vga_planes[offset])[plane];
+}
+
+static unsigned count_dirty(void)
+{
+    unsigned i, count = 0;
+
+    for (i = 0; i < sizeof(vga_planar_dirty); i++) count += vga_planar_dirty[i];
+    return count;
+}
+
+/* modes 4 and 6: packed pixels, odd scanlines 8k up */
+static void test_cga(void)
+{
+    set_mode( 320, 200, 2, 0, FALSE );
+    VGA_PutPixel( 3, 0, 1, 1 );
+    ok( window[0x2000] == 0x30, "got %02x\n", window[0x2000] );
+    VGA_PutPixel( 2, 0, 4, 2 );
+    ok( window[80 + 1] == 0x80, "got %02x\n", window[80 + 1] );
+    ok( VGA_GetPixel( 0, 1, 1 ) == 3 && VGA_GetPixel( 0, 4, 2 ) == 2, "wrong pixels\n" );
+    ok( VGA_GetPixel( 0, 0, 1 ) == 0, "neighbour changed\n" );
+
+    /* bit 7 XORs */
+    VGA_PutPixel( 0x81, 0, 1, 1 );
+    ok( VGA_GetPixel( 0, 1, 1 ) == 2, "got %u\n", VGA_GetPixel( 0, 1, 1 ) );
+    VGA_PutPixel( 0x82, 0, 1, 1 );
+    ok( window[0x2000] == 0, "got %02x\n", window[0x2000] );
+
+    /* out of range pixels are ignored */
+    VGA_PutPixel( 3, 0, 320, 0 );
+    VGA_PutPixel( 3, 0, 0, 200 );
+    ok( VGA_GetPixel( 0, 320, 0 ) == 0, "read outside the screen\n" );
+    ok( !framebuffer[0], "framebuffer written\n" );
+
+    /* spans cover whole bytes, attribute colors repeat */
+    VGA_FillSpan( 3, 8, 16, 1 );
+    ok( window[0x2000 + 80 + 2] == 0x55 && window[0x2000 + 80 + 5] == 0x55, "wrong fill\n" );
+    ok( !window[0x2000 + 80 + 1] && !window[0x2000 + 80 + 6], "fill too wide\n" );
+    VGA_CopySpan( 0, 3, 8, 16 );
+    ok( window[2] == 0x55 && window[5] == 0x55 && !window[6], "wrong copy\n" );
+
+    set_mode( 640, 200, 1, 0, FALSE );
+    VGA_PutPixel( 1, 0, 9, 2 );
+    ok( window[81] == 0x40, "got %02x\n", window[81] );
+    ok( VGA_GetPixel( 0, 9, 2 ) == 1 && VGA_GetPixel( 0, 8, 2 ) == 0, "wrong pixels\n" );
+    VGA_FillSpan( 1, 0, 8, 3 );
+    ok( window[0x2000] == 0xff, "got %02x\n", window[0x2000] );
+}
+
+/* modes 0Dh and 12h: four planes, one bit per pixel in each */
+static void test_planar(void)
+{
+    DWORD base;
+
+    set_mode( 640, 480, 4, -1, FALSE );
+    ok( VGA_GetPlanarPage( 0, &base ) && base == 0, "page 0 at %x\n", base );
+    ok( !VGA_GetPlanarPage( 1, &base ), "mode 12h has a second page\n" );
+
+    VGA_PutPixel( 5, 0, 3, 2 );
+    ok( plane_byte( 160, 0 ) == 0x10 && plane_byte( 160, 1 ) == 0 &&
+        plane_byte( 160, 2 ) == 0x10 && plane_byte( 160, 3 ) == 0, "wrong planes %08x\n", vga_planes[160] );
+    ok( vga_planar_dirty[160 >> VGA_DIRTY_SHIFT] && count_dirty() == 1, "dirty flags not set\n" );
+    ok( VGA_GetPixel( 0, 3, 2 ) == 5, "got %u\n", VGA_GetPixel( 0, 3, 2 ) );
+    VGA_PutPixel( 0x8f, 0, 3, 2 );
+    ok( VGA_GetPixel( 0, 3, 2 ) == 10, "got %u\n", VGA_GetPixel( 0, 3, 2 ) );
+    VGA_PutPixel( 9, 0, 3, 2 );
+    ok( VGA_GetPixel( 0, 3, 2 ) == 9 && vga_planes[160] == 0x10000010, "got %08x\n", vga_planes[160] );
+
+    /* spans mark what they touch */
+    memset( vga_planar_dirty, 0, sizeof(vga_planar_dirty) );
+    VGA_FillSpan( 100, 64, 128, 12 );
+    ok( vga_planes[8008] == 0xffff0000 && vga_planes[8023] == 0xffff0000, "wrong fill\n" );
+    ok( !vga_planes[8007] && !vga_planes[8024], "fill too wide\n" );
+    ok( vga_planar_dirty[8008 >> VGA_DIRTY_SHIFT] && vga_planar_dirty[8023 >> VGA_DIRTY_SHIFT] &&
+        count_dirty() == 1, "%u dirty flags\n", count_dirty() );
+    VGA_CopySpan( 479, 100, 64, 128 );
+    ok( VGA_GetPixel( 0, 64, 479 ) == 12 && VGA_GetPixel( 0, 191, 479 ) == 12 &&
+        VGA_GetPixel( 0, 192, 479 ) == 0, "wrong copy\n" );
+    ok( vga_planar_dirty[(479 * 80 + 8) >> VGA_DIRTY_SHIFT], "copy not marked\n" );
+
+    /* mode 0Dh has 8 pages of 8k */
+    set_mode( 320, 200, 4, -1, FALSE );
+    ok( VGA_GetPlanarPage( 7, &base ) && base == 7 * 0x2000, "page 7 at %x\n", base );
+    ok( !VGA_GetPlanarPage( 8, &base ), "page 8 exists\n" );
+    VGA_PutPixel( 7, 1, 0, 0 );
+    ok( vga_planes[0x2000] == 0x00808080 && !vga_planes[0], "got %08x\n", vga_planes[0x2000] );
+    ok( VGA_GetPixel( 1, 0, 0 ) == 7 && VGA_GetPixel( 0, 0, 0 ) == 0, "wrong page\n" );
+    VGA_PutPixel( 7, 8, 0, 0 );
+    ok( VGA_GetPixel( 8, 0, 0 ) == 0, "page 8 written\n" );
+}
+
+/* unchained 256 colors: a byte per pixel, consecutive pixels in consecutive planes */
+static void test_mode_x(void)
+{
+    set_mode( 320, 240, 8, -1, FALSE );
+    ok( vga_planar_pitch == 80, "pitch %u\n", vga_planar_pitch );
+    VGA_PutPixel( 0x42, 0, 5, 1 );
+    ok( plane_byte( 81, 1 ) == 0x42 && vga_planes[81] == 0x4200, "got %08x\n", vga_planes[81] );
+    ok( VGA_GetPixel( 0, 5, 1 ) == 0x42, "got %02x\n", VGA_GetPixel( 0, 5, 1 ) );
+    VGA_PutPixel( 0xc3, 0, 5, 1 );
+    ok( VGA_GetPixel( 0, 5, 1 ) == 0xc3, "256 color pixels aren't XORed\n" );
+
+    VGA_FillSpan( 2, 8, 8, 0x17 );
+    ok( vga_planes[162] == 0x17171717 && vga_planes[163] == 0x17171717 && !vga_planes[164], "wrong fill\n" );
+}
+
+/* chained 256 colors: the window at 0xa0000, then the framebuffer */
+static void test_chained(void)
+{
+    set_mode( 320, 200, 8, 0, FALSE );
+    VGA_PutPixel( 0x23, 0, 10, 5 );
+    ok( window[5 * 320 + 10] == 0x23, "got %02x\n", window[5 * 320 + 10] );
+    ok( !framebuffer[5 * 320 + 10], "framebuffer written\n" );
+    ok( VGA_GetPixel( 0, 10, 5 ) == 0x23, "got %02x\n", VGA_GetPixel( 0, 10, 5 ) );
+
+    /* banked VESA modes reach outside the window */
+    set_mode( 640, 480, 8, 0, FALSE );
+    VGA_PutPixel( 0x99, 0, 7, 300 );
+    ok( framebuffer[300 * 640 + 7] == 0x99, "got %02x\n", framebuffer[300 * 640 + 7] );
+    ok( VGA_GetPixel( 0, 7, 300 ) == 0x99, "got %02x\n", VGA_GetPixel( 0, 7, 300 ) );
+
+    /* linear VESA modes don't use the window at all */
+    set_mode( 640, 480, 8, 0, TRUE );
+    VGA_PutPixel( 0x55, 0, 1, 0 );
+    ok( framebuffer[1] == 0x55 && !window[1], "window written\n" );
+    ok( VGA_GetPixel( 0, 1, 0 ) == 0x55, "got %02x\n", VGA_GetPixel( 0, 1, 0 ) );
+
+    /* direct color modes fill black */
+    set_mode( 320, 200, 16, 0, TRUE );
+    memset( framebuffer, 0xaa, sizeof(framebuffer) );
+    VGA_FillSpan( 1, 8, 8, 0x0f );
+    ok( !framebuffer[640 + 16] && !framebuffer[640 + 31] && framebuffer[640 + 32] == 0xaa, "wrong fill\n" );
+    VGA_CopySpan( 0, 1, 8, 8 );
+    ok( !framebuffer[16] && !framebuffer[31] && framebuffer[32] == 0xaa, "wrong copy\n" );
+    memset( framebuffer, 0, sizeof(framebuffer) );
+}
+
+/* scrolls move whole cells, clamped to the screen */
+static void test_scroll(void)
+{
+    unsigned x;
+
+    /* mode 13h: the window is flushed to the framebuffer and back */
+    set_mode( 320, 200, 8, 0, FALSE );
+    VGA_PutPixel( 1, 0, 8, 8 );
+    VGA_PutPixel( 2, 0, 15, 23 );
+    VGA_PutPixel( 3, 0, 0, 8 );
+    VGA_ScrollGraphics( 0, 1, 24, 1, 1, TRUE, 0x0e, 8 );
+    ok( VGA_GetPixel( 0, 8, 0 ) == 1 && VGA_GetPixel( 0, 15, 15 ) == 2, "not scrolled up\n" );
+    ok( VGA_GetPixel( 0, 0, 8 ) == 3, "column 0 scrolled\n" );
+    ok( VGA_GetPixel( 0, 8, 199 ) == 0x0e && VGA_GetPixel( 0, 15, 192 ) == 0x0e, "bottom not filled\n" );
+    ok( VGA_GetPixel( 0, 16, 199 ) == 0, "fill too wide\n" );
+    VGA_ScrollGraphics( 0, 1, 24, 1, 2, FALSE, 0x04, 8 );
+    ok( VGA_GetPixel( 0, 8, 16 ) == 1 && VGA_GetPixel( 0, 15, 31 ) == 2, "not scrolled down\n" );
+    ok( VGA_GetPixel( 0, 8, 0 ) == 4 && VGA_GetPixel( 0, 15, 15 ) == 4, "top not filled\n" );
+
+    /* lines of 0 or more than the window clears it */
+    VGA_ScrollGraphics( 2, 1, 3, 1, 0, TRUE, 0x07, 8 );
+    for (x = 8; x < 16; x++)
+        ok( VGA_GetPixel( 0, x, 16 ) == 7 && VGA_GetPixel( 0, x, 31 ) == 7, "not cleared at %u\n", x );
+    VGA_ScrollGraphics( 0, 0, 0, 0, 5, FALSE, 0x06, 8 );
+    ok( VGA_GetPixel( 0, 0, 0 ) == 6 && VGA_GetPixel( 0, 7, 7 ) == 6, "not cleared\n" );
+
+    /* columns and rows past the screen are clamped, backwards windows ignored */
+    VGA_ScrollGraphics( 24, 39, 99, 99, 0, TRUE, 0x08, 8 );
+    ok( VGA_GetPixel( 0, 319, 199 ) == 8 && VGA_GetPixel( 0, 312, 192 ) == 8, "not clamped\n" );
+    VGA_ScrollGraphics( 3, 0, 2, 0, 0, TRUE, 0x09, 8 );
+    ok( VGA_GetPixel( 0, 0, 16 ) == 0, "backwards window cleared\n" );
+
+    /* mode 12h: 16 scanline cells in the planes */
+    set_mode( 640, 480, 4, -1, FALSE );
+    VGA_PutPixel( 9, 0, 0, 16 );
+    VGA_PutPixel( 9, 0, 639, 479 );
+    memset( vga_planar_dirty, 0, sizeof(vga_planar_dirty) );
+    VGA_ScrollGraphics( 0, 0, 29, 79, 1, TRUE, 0x01, 16 );
+    ok( VGA_GetPixel( 0, 0, 0 ) == 9 && VGA_GetPixel( 0, 0, 16 ) == 0, "not scrolled up\n" );
+    ok( VGA_GetPixel( 0, 639, 463 ) == 9 && VGA_GetPixel( 0, 639, 479 ) == 1, "bottom not filled\n" );
+    ok( count_dirty() == (480 * 80) >> VGA_DIRTY_SHIFT, "%u dirty flags\n", count_dirty() );
+}
+
+/* glyphs as vga.c rasterizes them, 8 pixels a row */
+static void test_glyph(void)
+{
+    static const BYTE glyph[8] = { 0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81 };
+    unsigned x, y;
+    BOOL match = TRUE;
+
+    set_mode( 320, 200, 8, 0, FALSE );
+    memset( window, 0x33, 320 * 200 );
+    VGA_DrawGlyph( 8, 16, glyph, 8, 0x0f );
+    for (y = 0; y < 8; y++)
+        for (x = 0; x < 8; x++)
+            match &= VGA_GetPixel( 0, 8 + x, 16 + y ) == ((glyph[y] & (0x80 >> x)) ? 0x0f : 0);
+    ok( match, "wrong glyph\n" );
+    ok( VGA_GetPixel( 0, 7, 16 ) == 0x33 && VGA_GetPixel( 0, 16, 16 ) == 0x33 &&
+        VGA_GetPixel( 0, 8, 24 ) == 0x33, "drawn outside the cell\n" );
+
+    /* XORed glyphs leave the background alone and undo themselves */
+    set_mode( 320, 200, 2, 0, FALSE );
+    VGA_PutPixel( 2, 0, 1, 0 );
+    VGA_PutPixel( 2, 0, 0, 0 );
+    VGA_DrawGlyph( 0, 0, glyph, 8, 0x83 );
+    ok( VGA_GetPixel( 0, 0, 0 ) == 1 && VGA_GetPixel( 0, 1, 0 ) == 2, "wrong XOR\n" );
+    ok( VGA_GetPixel( 0, 1, 1 ) == 3 && VGA_GetPixel( 0, 0, 1 ) == 0, "wrong XOR\n" );
+    VGA_DrawGlyph( 0, 0, glyph, 8, 0x83 );
+    ok( VGA_GetPixel( 0, 0, 0 ) == 2 && VGA_GetPixel( 0, 1, 1 ) == 0, "XOR not undone\n" );
+
+    /* without bit 7 the background is cleared */
+    VGA_DrawGlyph( 0, 0, glyph, 8, 0x01 );
+    ok( VGA_GetPixel( 0, 0, 0 ) == 1 && VGA_GetPixel( 0, 1, 0 ) == 0, "background not cleared\n" );
+
+    /* in the planes */
+    set_mode( 640, 480, 4, -1, FALSE );
+    VGA_DrawGlyph( 632, 472, glyph, 8, 0x0c );
+    ok( vga_planes[479 * 80 + 79] == 0x81810000 && vga_planes[472 * 80 + 79] == 0x81810000,
+        "got %08x\n", vga_planes[472 * 80 + 79] );
+    ok( vga_planes[475 * 80 + 79] == 0x18180000, "got %08x\n", vga_planes[475 * 80 + 79] );
+}
+
+int main(void)
+{
+    test_cga();
+    test_planar();
+    test_mode_x();
+    test_chained();
+    test_scroll();
+    test_glyph();
+    return test_summary( "vgapixels" );
+}
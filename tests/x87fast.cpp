@@ -0,0 +1,305 @@
+/*
+ * Tests of the x87 double precision fast path (vm86/mame/emu/cpu/i386/x87fast.h)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* the types and macros msdos.cpp defines before including SoftFloat */
+typedef uint8_t  UINT8;
+typedef int8_t   INT8;
+typedef uint16_t UINT16;
+typedef int16_t  INT16;
+typedef uint32_t UINT32;
+typedef int32_t  INT32;
+typedef uint64_t UINT64;
+typedef int64_t  INT64;
+#define LSB_FIRST
+#define INLINE static inline
+#define U64(v) v##ULL
+#define ARRAY_LENGTH(x) (sizeof(x) / sizeof(x[0]))
+
+#include "softfloat.c"
+#include "x87fast.h"
+#include "test.h"
+
+enum { OP_ADD, OP_SUB, OP_MUL, OP_DIV };
+
+static const char * const op_names[] = { "add", "sub", "mul", "div" };
+
+static unsigned int fast_count, checked_count;
+
+/* a normal or special x87 value, exp is the biased exponent */
+static floatx80 make_x80( int sign, int exp, UINT64 mant )
+{
+    floatx80 fx;
+
+    fx.high = (sign ? 0x8000 : 0) | exp;
+    fx.low = mant;
+    return fx;
+}
+
+/* a double precision value 2^e * (1 + frac / 2^52) */
+static floatx80 make_double( int sign, int e, UINT64 frac )
+{
+    return make_x80( sign, e + 0x3fff, U64(0x8000000000000000) | (frac << 11) );
+}
+
+static UINT64 rand64(void)
+{
+    UINT64 r = 0;
+    int i;
+
+    for (i = 0; i < 5; i++) r = (r << 15) | test_rand();
+    return r;
+}
+
+static int run_fast( int op, floatx80 a, floatx80 b, floatx80 *result )
+{
+    switch (op)
+    {
+    case OP_ADD: return x87_fast_add( a, b, 0, result );
+    case OP_SUB: return x87_fast_add( a, b, 1, result );
+    case OP_MUL: return x87_fast_mul( a, b, result );
+    default:     return x87_fast_div( a, b, result );
+    }
+}
+
+/* the X87_CW_PC_DOUBLE branches of x87_add, x87_sub, x87_mul and x87_div */
+static floatx80 run_softfloat( int op, floatx80 a, floatx80 b )
+{
+    float64 a64 = floatx80_to_float64( a );
+    float64 b64 = floatx80_to_float64( b );
+
+    switch (op)
+    {
+    case OP_ADD: return float64_to_floatx80( float64_add( a64, b64 ) );
+    case OP_SUB: return float64_to_floatx80( float64_sub( a64, b64 ) );
+    case OP_MUL: return float64_to_floatx80( float64_mul( a64, b64 ) );
+    default:     return float64_to_floatx80( float64_div( a64, b64 ) );
+    }
+}
+
+/*
+ * Run a and b through both paths. When the fast path takes the operands,
+ * the result and flags must be the same bits as SoftFloat's; when it
+ * doesn't, it must not have raised anything. expect_fast is -1 if either
+ * is fine.
+ */
+static int check_op( int op, floatx80 a, floatx80 b, int expect_fast, int line )
+{
+    floatx80 fast = { 0 }, soft;
+    int taken, fast_flags, soft_flags;
+
+    float_exception_flags = 0;
+    taken = run_fast( op, a, b, &fast );
+    fast_flags = float_exception_flags;
+
+    float_exception_flags = 0;
+    soft = run_softfloat( op, a, b );
+    soft_flags = float_exception_flags;
+
+    checked_count++;
+    if (expect_fast != -1)
+        ok( taken == expect_fast, "line %d: %s %04x:%016llx %04x:%016llx %s\n", line, op_names[op],
+            a.high, (unsigned long long)a.low, b.high, (unsigned long long)b.low,
+            taken ? "taken" : "declined" );
+    if (!taken)
+    {
+        ok( !fast_flags, "line %d: declined %s raised %x\n", line, op_names[op], fast_flags );
+        return 0;
+    }
+    fast_count++;
+    ok( fast.high == soft.high && fast.low == soft.low && fast_flags == soft_flags,
+        "line %d: %s %04x:%016llx %04x:%016llx: fast %04x:%016llx flags %x, softfloat %04x:%016llx flags %x\n",
+        line, op_names[op], a.high, (unsigned long long)a.low, b.high, (unsigned long long)b.low,
+        fast.high, (unsigned long long)fast.low, fast_flags,
+        soft.high, (unsigned long long)soft.low, soft_flags );
+    return 1;
+}
+#define check_op(op, a, b, expect_fast) check_op( op, a, b, expect_fast, __LINE__ )
+
+static void check_all_ops( floatx80 a, floatx80 b, int expect_fast, int line )
+{
+    int op;
+
+    for (op = OP_ADD; op <= OP_DIV; op++) (check_op)( op, a, b, expect_fast, line );
+}
+#define check_all_ops(a, b, expect_fast) check_all_ops( a, b, expect_fast, __LINE__ )
+
+/* operands are taken up to 2^+-450, the results stay normal doubles */
+static void test_exponent_window(void)
+{
+    static const int exps[] = { -451, -450, -449, -1, 0, 1, 449, 450, 451 };
+    static const UINT64 fracs[] = { 0, U64(0xfffffffffffff), U64(0x8000000000001), U64(0x5555555555555) };
+    unsigned int i, j, k, l;
+
+    for (i = 0; i < ARRAY_LENGTH(exps); i++)
+        for (j = 0; j < ARRAY_LENGTH(exps); j++)
+            for (k = 0; k < ARRAY_LENGTH(fracs); k++)
+                for (l = 0; l < 4; l++)
+                {
+                    floatx80 a = make_double( l & 1, exps[i], fracs[k] );
+                    floatx80 b = make_double( l & 2, exps[j], fracs[ARRAY_LENGTH(fracs) - 1 - k] );
+                    int inside = abs( exps[i] ) <= 450 && abs( exps[j] ) <= 450;
+
+                    check_all_ops( a, b, inside );
+                }
+
+    /* the extremes of the results */
+    check_op( OP_MUL, make_double( 0, 450, U64(0xfffffffffffff) ), make_double( 1, 450, U64(0xfffffffffffff) ), 1 );
+    check_op( OP_MUL, make_double( 0, -450, 0 ), make_double( 0, -450, 0 ), 1 );
+    check_op( OP_MUL, make_double( 0, -450, 1 ), make_double( 0, -450, 3 ), 1 );
+    check_op( OP_DIV, make_double( 0, -450, 0 ), make_double( 0, 450, U64(0xfffffffffffff) ), 1 );
+    check_op( OP_DIV, make_double( 1, 450, U64(0xfffffffffffff) ), make_double( 0, -450, 0 ), 1 );
+    check_op( OP_DIV, make_double( 0, -450, 1 ), make_double( 0, 450, 1 ), 1 );
+    check_op( OP_ADD, make_double( 0, 450, U64(0xfffffffffffff) ), make_double( 0, 450, U64(0xfffffffffffff) ), 1 );
+    check_op( OP_SUB, make_double( 0, -450, 1 ), make_double( 0, -450, 0 ), 1 );
+}
+
+/* zeros, denormals and values a double can't hold exactly go to SoftFloat */
+static void test_special_operands(void)
+{
+    static const struct { int exp; UINT64 mant; } specials[] =
+    {
+        { 0,      0 },                              /* zero */
+        { 0,      1 },                              /* denormal */
+        { 0,      U64(0x8000000000000000) },        /* pseudo-denormal */
+        { 0x3fff, U64(0x4000000000000000) },        /* unnormal */
+        { 0x3fff - 1022, U64(0x8000000000000000) }, /* smallest normal double */
+        { 0x3fff - 1023, U64(0xc000000000000000) }, /* double denormal */
+        { 0x3fff - 1074, U64(0x8000000000000000) }, /* smallest double denormal */
+        { 0x3fff + 1023, U64(0xfffffffffffff800) }, /* largest double */
+        { 0x3fff, U64(0x8000000000000400) },        /* more than 53 bits */
+        { 0x3fff, U64(0xffffffffffffffff) },
+        { 0x7fff, U64(0x8000000000000000) },        /* infinity */
+        { 0x7fff, U64(0xc000000000000000) },        /* quiet NaN */
+        { 0x7fff, U64(0xa000000000000000) },        /* signaling NaN */
+    };
+    floatx80 one = make_double( 0, 0, 0 ), three = make_double( 1, 1, U64(0x8000000000000) );
+    unsigned int i, j;
+    int s;
+
+    for (i = 0; i < ARRAY_LENGTH(specials); i++)
+        for (s = 0; s < 2; s++)
+        {
+            floatx80 x = make_x80( s, specials[i].exp, specials[i].mant );
+
+            check_all_ops( x, one, 0 );
+            check_all_ops( three, x, 0 );
+            for (j = 0; j < ARRAY_LENGTH(specials); j++)
+                check_all_ops( x, make_x80( !s, specials[j].exp, specials[j].mant ), 0 );
+        }
+}
+
+/* exact cancellation gives +0 when rounding to nearest */
+static void test_signed_zero(void)
+{
+    floatx80 a = make_double( 0, 17, U64(0x123456789abcd) ), na = make_double( 1, 17, U64(0x123456789abcd) );
+    floatx80 result;
+
+    check_op( OP_SUB, a, a, 1 );
+    check_op( OP_SUB, na, na, 1 );
+    check_op( OP_ADD, a, na, 1 );
+    check_op( OP_ADD, na, a, 1 );
+    ok( x87_fast_add( na, a, 0, &result ) && !result.high && !result.low,
+        "got %04x:%016llx\n", result.high, (unsigned long long)result.low );
+
+    /* zeros themselves are left to SoftFloat */
+    check_all_ops( make_x80( 1, 0, 0 ), make_x80( 1, 0, 0 ), 0 );
+    check_all_ops( make_x80( 1, 0, 0 ), a, 0 );
+}
+
+/* only round to nearest is taken, ties go to even */
+static void test_rounding(void)
+{
+    static const int modes[] = { float_round_to_zero, float_round_down, float_round_up };
+    floatx80 one = make_double( 0, 0, 0 ), half_ulp = make_double( 0, -53, 0 );
+    floatx80 odd = make_double( 0, 0, 1 ), three = make_double( 0, 1, U64(0x8000000000000) );
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_LENGTH(modes); i++)
+    {
+        float_rounding_mode = modes[i];
+        check_all_ops( one, three, 0 );
+        check_all_ops( odd, half_ulp, 0 );
+        check_all_ops( make_double( 1, 3, 5 ), make_double( 0, -7, 9 ), 0 );
+    }
+    float_rounding_mode = float_round_nearest_even;
+
+    check_op( OP_ADD, one, half_ulp, 1 );                           /* tie, down to even */
+    check_op( OP_ADD, odd, half_ulp, 1 );                           /* tie, up to even */
+    check_op( OP_SUB, one, make_double( 0, -54, 0 ), 1 );           /* exact below 1 */
+    check_op( OP_SUB, one, make_double( 0, -55, 0 ), 1 );
+    check_op( OP_ADD, one, make_double( 0, -53, 1 ), 1 );           /* just above the tie */
+    check_op( OP_MUL, three, make_double( 0, 2, U64(0x4000000000000) ), 1 );    /* 3 * 5 exact */
+    check_op( OP_MUL, odd, odd, 1 );                                /* low bits lost */
+    check_op( OP_DIV, one, three, 1 );                              /* 1 / 3 inexact */
+    check_op( OP_DIV, make_double( 0, 2, U64(0x8000000000000) ), three, 1 );    /* 6 / 3 exact */
+    check_op( OP_DIV, odd, odd, 1 );
+    check_op( OP_DIV, make_double( 0, 0, U64(0xfffffffffffff) ), make_double( 0, 0, U64(0xffffffffffffe) ), 1 );
+}
+
+static floatx80 random_operand( int spread )
+{
+    UINT64 frac = rand64() & U64(0xfffffffffffff);
+    int e = (int)(test_rand() % (2 * spread + 1)) - spread;
+
+    /* few significant bits make exact results likely */
+    if (test_rand() & 1) frac &= ~(U64(0xfffffffffffff) >> (test_rand() % 12));
+    return make_double( test_rand() & 1, e, frac );
+}
+
+static void test_random(void)
+{
+    unsigned int i, errors_before;
+    int op;
+
+    for (i = 0; i < 200000; i++)
+    {
+        floatx80 a = random_operand( i & 1 ? 460 : 60 ), b;
+
+        op = test_rand() & 3;
+        switch (test_rand() % 3)
+        {
+        case 0: b = random_operand( i & 1 ? 460 : 60 ); break;
+        /* close values, for cancellation and Sterbenz */
+        case 1: b = make_x80( test_rand() & 1, a.high & 0x7fff, a.low ^ ((rand64() & 0xffff) << 11) ); break;
+        /* a multiple of a, for exact quotients */
+        default:
+            b = a;
+            b.high = (b.high & 0x8000) | ((b.high & 0x7fff) + (int)(test_rand() % 5) - 2);
+            break;
+        }
+        errors_before = test_failures;
+        check_op( op, a, b, -1 );
+        if (test_failures != errors_before) break;
+    }
+}
+
+int main(void)
+{
+    test_exponent_window();
+    test_special_operands();
+    test_signed_zero();
+    test_rounding();
+    test_random();
+    ok( fast_count > checked_count / 2, "only %u of %u operations took the fast path\n", fast_count, checked_count );
+    return test_summary( "x87fast" );
+}
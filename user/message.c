@@ -32,6 +32,8 @@
 #include "user_private.h"
 #include "wine/debug.h"
 #include "message_table.h"
+#include "msgstruct.h"
+#include "timerthunk.h"
 #include "../krnl386/kernel16_private.h"
 #include "commctrl.h"
 #include "wine/exception.h"
@@ -521,71 +523,155 @@ static inline void free_buffer( void *static_buffer, void *buffer )
     if (buffer != static_buffer) HeapFree( GetProcessHeap(), 0, buffer );
 }
 
-static void RECT16to32( const RECT16 *from, RECT *to )
+/*
+ * Temporary 16-bit copies of message parameters are placed in a per-thread
+ * scratch area that is mapped to a selector once, instead of going through
+ * MapLS/UnMapLS for every structure and string. Nested messages allocate
+ * above their caller, so the area is used like a stack. When it is full,
+ * the parameters are mapped with MapLS as before. If a parameter can't be
+ * mapped at all, the map is marked as failed and the message isn't passed
+ * to 16-bit code.
+ */
+#define WINPROC_SCRATCH_SIZE  0x4000
+#define WINPROC_MAP_MAX       8
+
+struct winproc_scratch
+{
+    SEGPTR segptr;
+    WORD   used;
+    BYTE   data[WINPROC_SCRATCH_SIZE];
+};
+
+struct winproc_map
+{
+    struct winproc_scratch *scratch;
+    WORD   mark;
+    BOOL   failed;
+    int    count;
+    struct
+    {
+        void  *copy_back;   /* original buffer to update after the call, or NULL */
+        void  *data;        /* copy in the scratch area, NULL if mapped with MapLS */
+        size_t size;
+        SEGPTR segptr;
+    } entries[WINPROC_MAP_MAX];
+};
+
+static DWORD winproc_scratch_tls = TLS_OUT_OF_INDEXES;
+
+static struct winproc_scratch *get_winproc_scratch(void)
+{
+    struct winproc_scratch *scratch;
+
+    if (winproc_scratch_tls == TLS_OUT_OF_INDEXES) return NULL;
+    if (!(scratch = TlsGetValue( winproc_scratch_tls )))
+    {
+        if (!(scratch = HeapAlloc( GetProcessHeap(), 0, sizeof(*scratch) ))) return NULL;
+        scratch->used = 0;
+        if (!(scratch->segptr = MapLS( scratch->data )))
+        {
+            WARN( "no selector for the scratch area\n" );
+            HeapFree( GetProcessHeap(), 0, scratch );
+            return NULL;
+        }
+        TlsSetValue( winproc_scratch_tls, scratch );
+    }
+    return scratch;
+}
+
+static void free_winproc_scratch(void)
 {
-    to->left   = from->left;
-    to->top    = from->top;
-    to->right  = from->right;
-    to->bottom = from->bottom;
+    struct winproc_scratch *scratch;
+
+    if (winproc_scratch_tls == TLS_OUT_OF_INDEXES) return;
+    if (!(scratch = TlsGetValue( winproc_scratch_tls ))) return;
+    UnMapLS( scratch->segptr );
+    HeapFree( GetProcessHeap(), 0, scratch );
+    TlsSetValue( winproc_scratch_tls, NULL );
 }
 
-static void RECT32to16( const RECT *from, RECT16 *to )
+static void winproc_map_init( struct winproc_map *map )
 {
-    to->left   = from->left;
-    to->top    = from->top;
-    to->right  = from->right;
-    to->bottom = from->bottom;
+    map->scratch = get_winproc_scratch();
+    map->mark = map->scratch ? map->scratch->used : 0;
+    map->failed = FALSE;
+    map->count = 0;
 }
 
-static void MINMAXINFO32to16( const MINMAXINFO *from, MINMAXINFO16 *to )
+/* make 'size' bytes at 'data' visible to 16-bit code, copying them back on unmap if 'out' */
+static SEGPTR winproc_map_data( struct winproc_map *map, void *data, size_t size, BOOL out )
 {
-    to->ptReserved.x     = from->ptReserved.x;
-    to->ptReserved.y     = from->ptReserved.y;
-    to->ptMaxSize.x      = from->ptMaxSize.x;
-    to->ptMaxSize.y      = from->ptMaxSize.y;
-    to->ptMaxPosition.x  = from->ptMaxPosition.x;
-    to->ptMaxPosition.y  = from->ptMaxPosition.y;
-    to->ptMinTrackSize.x = from->ptMinTrackSize.x;
-    to->ptMinTrackSize.y = from->ptMinTrackSize.y;
-    to->ptMaxTrackSize.x = from->ptMaxTrackSize.x;
-    to->ptMaxTrackSize.y = from->ptMaxTrackSize.y;
+    struct winproc_scratch *scratch = map->scratch;
+    WORD offset;
+
+    if (!HIWORD(data)) return (SEGPTR)LOWORD(data);
+    if (map->count >= WINPROC_MAP_MAX)
+    {
+        ERR( "too many mapped parameters\n" );
+        map->failed = TRUE;
+        return 0;
+    }
+
+    map->entries[map->count].copy_back = out ? data : NULL;
+    map->entries[map->count].size = size;
+    offset = scratch ? (scratch->used + 3) & ~3 : 0;
+    if (scratch && offset + size <= WINPROC_SCRATCH_SIZE)
+    {
+        scratch->used = offset + size;
+        memcpy( scratch->data + offset, data, size );
+        map->entries[map->count].data = scratch->data + offset;
+        map->entries[map->count].segptr = scratch->segptr + offset;
+    }
+    else
+    {
+        map->entries[map->count].data = NULL;
+        if (!(map->entries[map->count].segptr = MapLS( data )))
+        {
+            ERR( "failed to map %p\n", data );
+            map->failed = TRUE;
+            return 0;
+        }
+    }
+    return map->entries[map->count++].segptr;
 }
 
-static void MINMAXINFO16to32( const MINMAXINFO16 *from, MINMAXINFO *to )
+static SEGPTR winproc_map_string( struct winproc_map *map, LPCSTR str )
 {
-    to->ptReserved.x     = from->ptReserved.x;
-    to->ptReserved.y     = from->ptReserved.y;
-    to->ptMaxSize.x      = from->ptMaxSize.x;
-    to->ptMaxSize.y      = from->ptMaxSize.y;
-    to->ptMaxPosition.x  = from->ptMaxPosition.x;
-    to->ptMaxPosition.y  = from->ptMaxPosition.y;
-    to->ptMinTrackSize.x = from->ptMinTrackSize.x;
-    to->ptMinTrackSize.y = from->ptMinTrackSize.y;
-    to->ptMaxTrackSize.x = from->ptMaxTrackSize.x;
-    to->ptMaxTrackSize.y = from->ptMaxTrackSize.y;
+    size_t len;
+
+    if (!HIWORD(str)) return (SEGPTR)LOWORD(str);
+    len = strlen( str ) + 1;
+    /* resource ordinals (0xff followed by the id) may contain a null byte */
+    if ((BYTE)str[0] == 0xff && len < 4) len = 4;
+    return winproc_map_data( map, (void *)str, len, FALSE );
 }
 
-static void WINDOWPOS32to16( const WINDOWPOS* from, WINDOWPOS16* to )
+/* call the 16-bit callback unless a parameter couldn't be mapped */
+static LRESULT winproc_map_call( struct winproc_map *map, winproc_callback16_t callback, HWND16 hwnd, UINT16 msg,
+                                 WPARAM16 wParam, LPARAM lParam, LRESULT *result, void *arg )
 {
-    to->hwnd            = HWND_16(from->hwnd);
-    to->hwndInsertAfter = HWND_16(from->hwndInsertAfter);
-    to->x               = from->x;
-    to->y               = from->y;
-    to->cx              = from->cx;
-    to->cy              = from->cy;
-    to->flags           = from->flags;
+    if (map->failed)
+    {
+        WARN( "not passing message %04x to %04x\n", msg, hwnd );
+        *result = 0;
+        return 0;
+    }
+    return callback( hwnd, msg, wParam, lParam, result, arg );
 }
 
-static void WINDOWPOS16to32( const WINDOWPOS16* from, WINDOWPOS* to )
+/* copy the output parameters back and release everything mapped since winproc_map_init */
+static void winproc_unmap( struct winproc_map *map )
 {
-    to->hwnd            = WIN_Handle32(from->hwnd);
-    to->hwndInsertAfter = (from->hwndInsertAfter == (HWND16)-1) ?
-                           HWND_TOPMOST : WIN_Handle32(from->hwndInsertAfter);
-    to->x               = from->x;
-    to->y               = from->y;
-    to->cx              = from->cx;
-    to->cy              = from->cy;
-    to->flags           = from->flags;
+    while (map->count > 0)
+    {
+        map->count--;
+        if (!map->entries[map->count].data)
+            UnMapLS( map->entries[map->count].segptr );
+        else if (map->entries[map->count].copy_back)
+            memcpy( map->entries[map->count].copy_back, map->entries[map->count].data,
+                    map->entries[map->count].size );
+    }
+    if (map->scratch) map->scratch->used = map->mark;
 }
 
 /* The strings are not copied */
@@ -659,6 +745,25 @@ static void MDICREATESTRUCT16to32A( const MDICREATESTRUCT16* from, MDICREATESTRU
     to->szClass = win32classname(from->hOwner, MapSL(from->szClass));
 }
 
+/* convert the structure at lParam as described by 'desc' and pass it through the scratch area */
+static LRESULT call_struct_message_32to16( const struct winproc_struct_desc *desc, winproc_callback16_t callback,
+                                           HWND hwnd, WPARAM wParam, LPARAM lParam, LRESULT *result, void *arg )
+{
+    struct winproc_map map;
+    BYTE buffer[WINPROC_STRUCT_MAX_SIZE];
+    LRESULT ret;
+    SEGPTR segptr;
+
+    memset( buffer, 0, desc->size16 );
+    if (desc->to16) desc->to16( hwnd, (const void *)lParam, buffer );
+    winproc_map_init( &map );
+    segptr = winproc_map_data( &map, buffer, desc->size16, desc->to32 != NULL );
+    ret = winproc_map_call( &map, callback, HWND_16(hwnd), desc->msg16, wParam, segptr, result, arg );
+    winproc_unmap( &map );
+    if (desc->to32 && !map.failed) desc->to32( buffer, (void *)lParam );
+    return ret;
+}
+
 HGLOBAL GLOBAL_GetLink(HGLOBAL16 hg);
 void GLOBAL_SetLink(HGLOBAL16 hg16, HGLOBAL hg);
 HGLOBAL16 GLOBAL_FindLink(HGLOBAL hg);
@@ -2189,17 +2294,19 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
             CREATESTRUCT16 cs;
             MDICREATESTRUCT16 mdi_cs16;
             BOOL mdi_child = (GetWindowLongW(hwnd, GWL_EXSTYLE) & WS_EX_MDICHILD);
+            struct winproc_map map;
 
+            winproc_map_init( &map );
             CREATESTRUCT32Ato16( hwnd, cs32, &cs );
-            cs.lpszName  = MapLS( cs32->lpszName );
-            cs.lpszClass = MapLS( win16classname(cs32->lpszClass) );
+            cs.lpszName  = winproc_map_string( &map, cs32->lpszName );
+            cs.lpszClass = winproc_map_string( &map, win16classname(cs32->lpszClass) );
             if (mdi_child)
             {
                 MDICREATESTRUCTA *mdi_cs = cs32->lpCreateParams;
                 MDICREATESTRUCT32Ato16( mdi_cs, &mdi_cs16 );
-                mdi_cs16.szTitle = MapLS( mdi_cs->szTitle );
-                mdi_cs16.szClass = MapLS( win16classname(mdi_cs->szClass) );
-                cs.lpCreateParams = MapLS( &mdi_cs16 );
+                mdi_cs16.szTitle = winproc_map_string( &map, mdi_cs->szTitle );
+                mdi_cs16.szClass = winproc_map_string( &map, win16classname(mdi_cs->szClass) );
+                cs.lpCreateParams = winproc_map_data( &map, &mdi_cs16, sizeof(mdi_cs16), FALSE );
             }
             else if (cs32->lpCreateParams)
             {
@@ -2229,32 +2336,24 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
                     cs.lpCreateParams = *(SEGPTR *)((BYTE *)cs32->lpCreateParams + 2);
                 }
             }
-            lParam = MapLS( &cs );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-            UnMapLS( cs.lpszName );
-            UnMapLS( cs.lpszClass );
-            if (mdi_child)
-            {
-                UnMapLS( cs.lpCreateParams );
-                UnMapLS( mdi_cs16.szTitle );
-                UnMapLS( mdi_cs16.szClass );
-            }
+            lParam = winproc_map_data( &map, &cs, sizeof(cs), FALSE );
+            ret = winproc_map_call( &map, callback, HWND_16(hwnd), msg, wParam, lParam, result, arg );
+            winproc_unmap( &map );
         }
         break;
     case WM_MDICREATE:
         {
             MDICREATESTRUCTA *cs32 = (MDICREATESTRUCTA *)lParam;
             MDICREATESTRUCT16 cs;
+            struct winproc_map map;
 
+            winproc_map_init( &map );
             MDICREATESTRUCT32Ato16( cs32, &cs );
-            cs.szTitle = MapLS( cs32->szTitle );
-            cs.szClass = MapLS( win16classname(cs32->szClass) );
-            lParam = MapLS( &cs );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-            UnMapLS( cs.szTitle );
-            UnMapLS( cs.szClass );
+            cs.szTitle = winproc_map_string( &map, cs32->szTitle );
+            cs.szClass = winproc_map_string( &map, win16classname(cs32->szClass) );
+            lParam = winproc_map_data( &map, &cs, sizeof(cs), FALSE );
+            ret = winproc_map_call( &map, callback, HWND_16(hwnd), msg, wParam, lParam, result, arg );
+            winproc_unmap( &map );
         }
         break;
     case WM_MDIACTIVATE:
@@ -2278,16 +2377,13 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
         ret = callback(HWND_16(hwnd), msg, HWND_16(wParam), lParam, result, arg);
         break;
     case WM_GETMINMAXINFO:
-        {
-            MINMAXINFO *mmi32 = (MINMAXINFO *)lParam;
-            MINMAXINFO16 mmi;
-
-            MINMAXINFO32to16( mmi32, &mmi );
-            lParam = MapLS( &mmi );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-            MINMAXINFO16to32( &mmi, mmi32 );
-        }
+    case WM_COMPAREITEM:
+    case WM_DELETEITEM:
+    case WM_DRAWITEM:
+    case WM_MEASUREITEM:
+    case LB_GETITEMRECT:
+    case CB_GETDROPPEDCONTROLRECT:
+        ret = call_struct_message_32to16( find_struct_desc( msg ), callback, hwnd, wParam, lParam, result, arg );
         break;
     case WM_NCCALCSIZE:
         {
@@ -2295,6 +2391,7 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
             NCCALCSIZE_PARAMS16 nc;
             WINDOWPOS16 winpos;
             BOOL fixborder = FALSE;
+            struct winproc_map map;
             if (get_windows_build() >= 26100)
             {
                 DWORD exstyle = GetWindowLong(hwnd, GWL_EXSTYLE);
@@ -2306,17 +2403,18 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
                 }
             }
 
+            winproc_map_init( &map );
             RECT32to16( &nc32->rgrc[0], &nc.rgrc[0] );
             if (wParam)
             {
                 RECT32to16( &nc32->rgrc[1], &nc.rgrc[1] );
                 RECT32to16( &nc32->rgrc[2], &nc.rgrc[2] );
                 WINDOWPOS32to16( nc32->lppos, &winpos );
-                nc.lppos = MapLS( &winpos );
+                nc.lppos = winproc_map_data( &map, &winpos, sizeof(winpos), TRUE );
             }
-            lParam = MapLS( &nc );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
+            lParam = winproc_map_data( &map, &nc, sizeof(nc), TRUE );
+            ret = winproc_map_call( &map, callback, HWND_16(hwnd), msg, wParam, lParam, result, arg );
+            winproc_unmap( &map );
             if (fixborder)
             {
                 nc.rgrc[0].top--;
@@ -2330,7 +2428,6 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
                 RECT16to32( &nc.rgrc[1], &nc32->rgrc[1] );
                 RECT16to32( &nc.rgrc[2], &nc32->rgrc[2] );
                 WINDOWPOS16to32( &winpos, nc32->lppos );
-                UnMapLS( nc.lppos );
             }
         }
         break;
@@ -2338,113 +2435,28 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
     case WM_WINDOWPOSCHANGED:
         {
             WINDOWPOS *winpos32 = (WINDOWPOS *)lParam;
-            WINDOWPOS16 winpos;
             // before windows 10 not set swp_statechanged on a window being maximized if wm_windowposchanging is sent twice
             if ((msg == WM_WINDOWPOSCHANGED) && GetPropA(hwnd, "WindowMaximized") && (callback == call_window_proc16))
             {
                 RemovePropA(hwnd, "WindowMaximized");
                 winpos32->flags &= ~0x8000; //SWP_STATECHANGED
             }
-
-            WINDOWPOS32to16( winpos32, &winpos );
-            lParam = MapLS( &winpos );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-            WINDOWPOS16to32( &winpos, winpos32 );
-        }
-        break;
-    case WM_COMPAREITEM:
-        {
-            COMPAREITEMSTRUCT *cis32 = (COMPAREITEMSTRUCT *)lParam;
-            COMPAREITEMSTRUCT16 cis;
-            cis.CtlType    = cis32->CtlType;
-            cis.CtlID      = cis32->CtlID;
-            cis.hwndItem   = HWND_16( cis32->hwndItem );
-            cis.itemID1    = cis32->itemID1;
-            cis.itemData1  = cis32->itemData1;
-            cis.itemID2    = cis32->itemID2;
-            cis.itemData2  = cis32->itemData2;
-            lParam = MapLS( &cis );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-        }
-        break;
-    case WM_DELETEITEM:
-        {
-            DELETEITEMSTRUCT *dis32 = (DELETEITEMSTRUCT *)lParam;
-            DELETEITEMSTRUCT16 dis;
-            dis.CtlType  = dis32->CtlType;
-            dis.CtlID    = dis32->CtlID;
-            dis.itemID   = dis32->itemID;
-            dis.hwndItem = (dis.CtlType == ODT_MENU) ? (HWND16)LOWORD(dis32->hwndItem)
-                                                     : HWND_16( dis32->hwndItem );
-            dis.itemData = dis32->itemData;
-            lParam = MapLS( &dis );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-        }
-        break;
-    case WM_DRAWITEM:
-        {
-            DRAWITEMSTRUCT *dis32 = (DRAWITEMSTRUCT *)lParam;
-            DRAWITEMSTRUCT16 dis;
-            dis.CtlType       = dis32->CtlType;
-            dis.CtlID         = dis32->CtlID;
-            if ((dis32->CtlType == ODT_MENU) && (dis32->itemID > 0xffff))
-            {
-                HMENU16 menu = HMENU_16(dis32->itemID);
-                if (menu) dis.itemID = menu;
-                else dis.itemID = dis32->itemID;
-            }
-            else dis.itemID   = dis32->itemID;
-            dis.itemAction    = dis32->itemAction;
-            dis.itemState     = dis32->itemState;
-            dis.hwndItem      = HWND_16( dis32->hwndItem );
-            dis.hDC           = HDC_16(dis32->hDC);
-            dis.itemData      = dis32->itemData;
-            dis.rcItem.left   = dis32->rcItem.left;
-            dis.rcItem.top    = dis32->rcItem.top;
-            dis.rcItem.right  = dis32->rcItem.right;
-            dis.rcItem.bottom = dis32->rcItem.bottom;
-            lParam = MapLS( &dis );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-        }
-        break;
-    case WM_MEASUREITEM:
-        {
-            MEASUREITEMSTRUCT *mis32 = (MEASUREITEMSTRUCT *)lParam;
-            MEASUREITEMSTRUCT16 mis;
-            mis.CtlType    = mis32->CtlType;
-            mis.CtlID      = mis32->CtlID;
-            if ((mis32->CtlType == ODT_MENU) && (mis32->itemID > 0xffff))
-            {
-                HMENU16 menu = HMENU_16(mis32->itemID);
-                if (menu) mis.itemID = menu;
-                else mis.itemID = mis32->itemID;
-            }
-            else mis.itemID = mis32->itemID;
-            mis.itemWidth  = mis32->itemWidth;
-            mis.itemHeight = mis32->itemHeight;
-            mis.itemData   = mis32->itemData;
-            lParam = MapLS( &mis );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
-            mis32->itemWidth  = (INT16)mis.itemWidth;
-            mis32->itemHeight = mis.itemHeight;
+            ret = call_struct_message_32to16( find_struct_desc( msg ), callback, hwnd, wParam, lParam, result, arg );
         }
         break;
     case WM_COPYDATA:
         {
             COPYDATASTRUCT *cds32 = (COPYDATASTRUCT *)lParam;
             COPYDATASTRUCT16 cds;
+            struct winproc_map map;
 
+            winproc_map_init( &map );
             cds.dwData = cds32->dwData;
             cds.cbData = cds32->cbData;
             cds.lpData = MapLS( cds32->lpData );
-            lParam = MapLS( &cds );
-            ret = callback( HWND_16(hwnd), msg, HWND_16(wParam), lParam, result, arg );
-            UnMapLS( lParam );
+            lParam = winproc_map_data( &map, &cds, sizeof(cds), FALSE );
+            ret = winproc_map_call( &map, callback, HWND_16(hwnd), msg, HWND_16(wParam), lParam, result, arg );
+            winproc_unmap( &map );
             UnMapLS( cds.lpData );
         }
         break;
@@ -2453,7 +2465,9 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
         {
             MSG *msg32 = (MSG *)lParam;
             MSG16 msg16;
+            struct winproc_map map;
 
+            winproc_map_init( &map );
             msg16.hwnd    = HWND_16( msg32->hwnd );
             msg16.message = msg32->message;
             msg16.wParam  = msg32->wParam;
@@ -2461,9 +2475,9 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
             msg16.time    = msg32->time;
             msg16.pt.x    = msg32->pt.x;
             msg16.pt.y    = msg32->pt.y;
-            lParam = MapLS( &msg16 );
-            ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
-            UnMapLS( lParam );
+            lParam = winproc_map_data( &map, &msg16, sizeof(msg16), FALSE );
+            ret = winproc_map_call( &map, callback, HWND_16(hwnd), msg, wParam, lParam, result, arg );
+            winproc_unmap( &map );
         }
         else
             ret = callback( HWND_16(hwnd), msg, wParam, lParam, result, arg );
@@ -2843,19 +2857,6 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
         ret = callback( HWND_16(hwnd), msg + CB_GETEDITSEL16 - CB_GETEDITSEL, wParam, lParam, result, arg );
         UnMapLS( lParam );
         break;
-    case LB_GETITEMRECT:
-    case CB_GETDROPPEDCONTROLRECT:
-        {
-            RECT *r32 = (RECT *)lParam;
-            RECT16 rect;
-            lParam = MapLS( &rect );
-            ret = callback( HWND_16(hwnd),
-                            (msg == LB_GETITEMRECT) ? LB_GETITEMRECT16 : CB_GETDROPPEDCONTROLRECT16,
-                            wParam, lParam, result, arg );
-            UnMapLS( lParam );
-            RECT16to32( &rect, r32 );
-        }
-        break;
     case WM_PAINTCLIPBOARD:
     case WM_SIZECLIPBOARD:
         FIXME_(msg)( "message %04x needs translation\n", msg );
@@ -2996,13 +2997,15 @@ LRESULT WINPROC_CallProc32ATo16( winproc_callback16_t callback, HWND hwnd, UINT
         {
             LPDRAGLISTINFO di = (LPDRAGLISTINFO)lParam;
             DRAGLISTINFO16 di16;
+            struct winproc_map map;
+            winproc_map_init(&map);
             di16.hWnd = HWND_16(di->hWnd);
             di16.uNotification = di->uNotification;
             di16.ptCursor.x = di->ptCursor.x;
             di16.ptCursor.y = di->ptCursor.y;
-            lParam = MapLS(&di16);
-            ret = callback(HWND_16(hwnd), msg, wParam, lParam, result, arg);
-            UnMapLS(lParam);
+            lParam = winproc_map_data(&map, &di16, sizeof(di16), FALSE);
+            ret = winproc_map_call(&map, callback, HWND_16(hwnd), msg, wParam, lParam, result, arg);
+            winproc_unmap(&map);
             break;
         }
     }
@@ -3277,7 +3280,6 @@ void WINAPI ReplyMessage16( LRESULT result )
     ReplyMessage( result );
 }
 
-BOOL is_timer_thunk(TIMERPROC proc);
 static ATOM atom_UserAdapterWindowClass;
 /***********************************************************************
  *		PeekMessage32 (USER.819)
@@ -5265,12 +5267,16 @@ BOOL WINAPI DllMain(
             aero_diasble = FALSE;
         }
         drag_list_message = RegisterWindowMessage(DRAGLISTMSGSTRING);
+        winproc_scratch_tls = TlsAlloc();
         separate_taskbar = krnl386_get_config_int("otvdm", "SeparateTaskbar", SEPARATE_TASKBAR_SEPARATE);
         ShellDDEInit(TRUE);
         dialogmsgthunk = GlobalAddAtomA("dialogmsgthunk");
     }
+    if (fdwReason == DLL_THREAD_DETACH)
+        free_winproc_scratch();
     if (fdwReason == DLL_PROCESS_DETACH)
     {
+        free_winproc_scratch();
         ShellDDEInit(FALSE);
         GlobalDeleteAtom(dialogmsgthunk);
     }
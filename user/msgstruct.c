@@ -0,0 +1,233 @@
+/*
+ * 16/32-bit conversion of message structures
+ *
+ * Copyright 2001 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * The structures passed by pointer in lParam that message.c converts
+ * field by field. Nothing here maps memory for 16-bit code, so the
+ * conversions can be checked on their own.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "winuser.h"
+#include "wownt32.h"
+#include "user_private.h"
+#include "msgstruct.h"
+
+void RECT16to32( const RECT16 *from, RECT *to )
+{
+    to->left   = from->left;
+    to->top    = from->top;
+    to->right  = from->right;
+    to->bottom = from->bottom;
+}
+
+void RECT32to16( const RECT *from, RECT16 *to )
+{
+    to->left   = from->left;
+    to->top    = from->top;
+    to->right  = from->right;
+    to->bottom = from->bottom;
+}
+
+void MINMAXINFO32to16( const MINMAXINFO *from, MINMAXINFO16 *to )
+{
+    to->ptReserved.x     = from->ptReserved.x;
+    to->ptReserved.y     = from->ptReserved.y;
+    to->ptMaxSize.x      = from->ptMaxSize.x;
+    to->ptMaxSize.y      = from->ptMaxSize.y;
+    to->ptMaxPosition.x  = from->ptMaxPosition.x;
+    to->ptMaxPosition.y  = from->ptMaxPosition.y;
+    to->ptMinTrackSize.x = from->ptMinTrackSize.x;
+    to->ptMinTrackSize.y = from->ptMinTrackSize.y;
+    to->ptMaxTrackSize.x = from->ptMaxTrackSize.x;
+    to->ptMaxTrackSize.y = from->ptMaxTrackSize.y;
+}
+
+void MINMAXINFO16to32( const MINMAXINFO16 *from, MINMAXINFO *to )
+{
+    to->ptReserved.x     = from->ptReserved.x;
+    to->ptReserved.y     = from->ptReserved.y;
+    to->ptMaxSize.x      = from->ptMaxSize.x;
+    to->ptMaxSize.y      = from->ptMaxSize.y;
+    to->ptMaxPosition.x  = from->ptMaxPosition.x;
+    to->ptMaxPosition.y  = from->ptMaxPosition.y;
+    to->ptMinTrackSize.x = from->ptMinTrackSize.x;
+    to->ptMinTrackSize.y = from->ptMinTrackSize.y;
+    to->ptMaxTrackSize.x = from->ptMaxTrackSize.x;
+    to->ptMaxTrackSize.y = from->ptMaxTrackSize.y;
+}
+
+void WINDOWPOS32to16( const WINDOWPOS* from, WINDOWPOS16* to )
+{
+    to->hwnd            = HWND_16(from->hwnd);
+    to->hwndInsertAfter = HWND_16(from->hwndInsertAfter);
+    to->x               = from->x;
+    to->y               = from->y;
+    to->cx              = from->cx;
+    to->cy              = from->cy;
+    to->flags           = from->flags;
+}
+
+void WINDOWPOS16to32( const WINDOWPOS16* from, WINDOWPOS* to )
+{
+    to->hwnd            = WIN_Handle32(from->hwnd);
+    to->hwndInsertAfter = (from->hwndInsertAfter == (HWND16)-1) ?
+                           HWND_TOPMOST : WIN_Handle32(from->hwndInsertAfter);
+    to->x               = from->x;
+    to->y               = from->y;
+    to->cx              = from->cx;
+    to->cy              = from->cy;
+    to->flags           = from->flags;
+}
+
+static void minmaxinfo_32to16( HWND hwnd, const void *from, void *to )
+{
+    MINMAXINFO32to16( from, to );
+}
+
+static void minmaxinfo_16to32( const void *from, void *to )
+{
+    MINMAXINFO16to32( from, to );
+}
+
+static void windowpos_32to16( HWND hwnd, const void *from, void *to )
+{
+    WINDOWPOS32to16( from, to );
+}
+
+static void windowpos_16to32( const void *from, void *to )
+{
+    WINDOWPOS16to32( from, to );
+}
+
+static void compareitem_32to16( HWND hwnd, const void *from, void *to )
+{
+    const COMPAREITEMSTRUCT *cis32 = from;
+    COMPAREITEMSTRUCT16 *cis = to;
+
+    cis->CtlType    = cis32->CtlType;
+    cis->CtlID      = cis32->CtlID;
+    cis->hwndItem   = HWND_16( cis32->hwndItem );
+    cis->itemID1    = cis32->itemID1;
+    cis->itemData1  = cis32->itemData1;
+    cis->itemID2    = cis32->itemID2;
+    cis->itemData2  = cis32->itemData2;
+}
+
+static void deleteitem_32to16( HWND hwnd, const void *from, void *to )
+{
+    const DELETEITEMSTRUCT *dis32 = from;
+    DELETEITEMSTRUCT16 *dis = to;
+
+    dis->CtlType  = dis32->CtlType;
+    dis->CtlID    = dis32->CtlID;
+    dis->itemID   = dis32->itemID;
+    dis->hwndItem = (dis->CtlType == ODT_MENU) ? (HWND16)LOWORD(dis32->hwndItem)
+                                               : HWND_16( dis32->hwndItem );
+    dis->itemData = dis32->itemData;
+}
+
+static void drawitem_32to16( HWND hwnd, const void *from, void *to )
+{
+    const DRAWITEMSTRUCT *dis32 = from;
+    DRAWITEMSTRUCT16 *dis = to;
+
+    dis->CtlType       = dis32->CtlType;
+    dis->CtlID         = dis32->CtlID;
+    if ((dis32->CtlType == ODT_MENU) && (dis32->itemID > 0xffff))
+    {
+        HMENU16 menu = HMENU_16((HMENU)(ULONG_PTR)dis32->itemID);
+        if (menu) dis->itemID = menu;
+        else dis->itemID = dis32->itemID;
+    }
+    else dis->itemID   = dis32->itemID;
+    dis->itemAction    = dis32->itemAction;
+    dis->itemState     = dis32->itemState;
+    dis->hwndItem      = HWND_16( dis32->hwndItem );
+    dis->hDC           = HDC_16(dis32->hDC);
+    dis->itemData      = dis32->itemData;
+    dis->rcItem.left   = dis32->rcItem.left;
+    dis->rcItem.top    = dis32->rcItem.top;
+    dis->rcItem.right  = dis32->rcItem.right;
+    dis->rcItem.bottom = dis32->rcItem.bottom;
+}
+
+static void measureitem_32to16( HWND hwnd, const void *from, void *to )
+{
+    const MEASUREITEMSTRUCT *mis32 = from;
+    MEASUREITEMSTRUCT16 *mis = to;
+
+    mis->CtlType    = mis32->CtlType;
+    mis->CtlID      = mis32->CtlID;
+    if ((mis32->CtlType == ODT_MENU) && (mis32->itemID > 0xffff))
+    {
+        HMENU16 menu = HMENU_16((HMENU)(ULONG_PTR)mis32->itemID);
+        if (menu) mis->itemID = menu;
+        else mis->itemID = mis32->itemID;
+    }
+    else mis->itemID = mis32->itemID;
+    mis->itemWidth  = mis32->itemWidth;
+    mis->itemHeight = mis32->itemHeight;
+    mis->itemData   = mis32->itemData;
+}
+
+static void measureitem_16to32( const void *from, void *to )
+{
+    const MEASUREITEMSTRUCT16 *mis = from;
+    MEASUREITEMSTRUCT *mis32 = to;
+
+    mis32->itemWidth  = (INT16)mis->itemWidth;
+    mis32->itemHeight = mis->itemHeight;
+}
+
+static void getitemrect_16to32( const void *from, void *to )
+{
+    RECT16to32( from, to );
+}
+
+static const struct winproc_struct_desc winproc_struct_descs[] =
+{
+    { WM_GETMINMAXINFO,         WM_GETMINMAXINFO,           sizeof(MINMAXINFO16),        minmaxinfo_32to16,  minmaxinfo_16to32 },
+    { WM_WINDOWPOSCHANGING,     WM_WINDOWPOSCHANGING,       sizeof(WINDOWPOS16),         windowpos_32to16,   windowpos_16to32 },
+    { WM_WINDOWPOSCHANGED,      WM_WINDOWPOSCHANGED,        sizeof(WINDOWPOS16),         windowpos_32to16,   windowpos_16to32 },
+    { WM_COMPAREITEM,           WM_COMPAREITEM,             sizeof(COMPAREITEMSTRUCT16), compareitem_32to16, NULL },
+    { WM_DELETEITEM,            WM_DELETEITEM,              sizeof(DELETEITEMSTRUCT16),  deleteitem_32to16,  NULL },
+    { WM_DRAWITEM,              WM_DRAWITEM,                sizeof(DRAWITEMSTRUCT16),    drawitem_32to16,    NULL },
+    { WM_MEASUREITEM,           WM_MEASUREITEM,             sizeof(MEASUREITEMSTRUCT16), measureitem_32to16, measureitem_16to32 },
+    { LB_GETITEMRECT,           LB_GETITEMRECT16,           sizeof(RECT16),              NULL,               getitemrect_16to32 },
+    { CB_GETDROPPEDCONTROLRECT, CB_GETDROPPEDCONTROLRECT16, sizeof(RECT16),              NULL,               getitemrect_16to32 },
+};
+
+/***********************************************************************
+ *           find_struct_desc
+ */
+const struct winproc_struct_desc *find_struct_desc( UINT msg )
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(winproc_struct_descs); i++)
+        if (winproc_struct_descs[i].msg == msg) return &winproc_struct_descs[i];
+    return NULL;
+}
@@ -0,0 +1,52 @@
+/*
+ * 16/32-bit conversion of message structures
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_MSGSTRUCT_H
+#define __WINE_MSGSTRUCT_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "wingdi.h"
+#include "winuser.h"
+#include "wine/winuser16.h"
+
+/* largest 16-bit structure described by winproc_struct_desc */
+#define WINPROC_STRUCT_MAX_SIZE  64
+
+/* a message whose lParam points to a structure that is converted as a whole */
+struct winproc_struct_desc
+{
+    UINT   msg;
+    UINT   msg16;
+    size_t size16;
+    void (*to16)( HWND hwnd, const void *from32, void *to16 );   /* NULL for output only structures */
+    void (*to32)( const void *from16, void *to32 );              /* NULL for input only structures */
+};
+
+extern const struct winproc_struct_desc *find_struct_desc( UINT msg ) DECLSPEC_HIDDEN;
+
+extern void RECT16to32( const RECT16 *from, RECT *to ) DECLSPEC_HIDDEN;
+extern void RECT32to16( const RECT *from, RECT16 *to ) DECLSPEC_HIDDEN;
+extern void MINMAXINFO32to16( const MINMAXINFO *from, MINMAXINFO16 *to ) DECLSPEC_HIDDEN;
+extern void MINMAXINFO16to32( const MINMAXINFO16 *from, MINMAXINFO *to ) DECLSPEC_HIDDEN;
+extern void WINDOWPOS32to16( const WINDOWPOS *from, WINDOWPOS16 *to ) DECLSPEC_HIDDEN;
+extern void WINDOWPOS16to32( const WINDOWPOS16 *from, WINDOWPOS *to ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_MSGSTRUCT_H */
@@ -0,0 +1,255 @@
+/*
+ * Thunks for 16-bit timer procs
+ *
+ * Copyright 2001 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Timer thunks live in a reserved area that is committed a page at a time
+ * as more are needed. A thunk is shared by all the timers of a 16-bit proc
+ * (found through a hash on the proc) and goes back to the free list when
+ * the last (hwnd, id) using it is killed.
+ *
+ * A WM_TIMER fetched before its timer was killed or given another proc
+ * still carries the old thunk, which may have been reused for another proc
+ * by then. The dispatcher checks with check_timer_use that the timer of
+ * the message is still set with the thunk before calling its proc. The
+ * free list is FIFO so that reuse is rare to begin with.
+ *
+ * Nothing here calls USER, so window.c sets the timers and does the
+ * locking.
+ */
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winuser.h"
+#include "wownt32.h"
+#include "user_private.h"
+#include "timerthunk.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(win);
+
+#define TIMER_THUNK_HASH_SIZE   64
+
+struct timer_use
+{
+    struct timer_use *next;
+    HWND hwnd;
+    UINT_PTR id;
+    BOOL system;
+    TIMERTHUNK *thunk;
+};
+
+static TIMERTHUNK *timer_thunk_area;
+static UINT timer_thunk_count;      /* thunks in the committed pages */
+static SIZE_T timer_thunk_committed;
+static TIMERTHUNK *timer_thunk_hash[TIMER_THUNK_HASH_SIZE];
+static TIMERTHUNK *timer_thunk_free, *timer_thunk_free_tail;
+static struct timer_use *timer_uses[TIMER_THUNK_HASH_SIZE];
+
+static inline UINT timer_thunk_hash_proc(LPVOID param)
+{
+    return ((UINT_PTR)param ^ ((UINT_PTR)param >> 16)) % TIMER_THUNK_HASH_SIZE;
+}
+
+static inline UINT timer_use_hash(HWND hwnd, UINT_PTR id)
+{
+    return ((UINT_PTR)hwnd ^ id) % TIMER_THUNK_HASH_SIZE;
+}
+
+static struct timer_use **find_timer_use(HWND hwnd, UINT_PTR id, BOOL system)
+{
+    struct timer_use **prev;
+
+    for (prev = &timer_uses[timer_use_hash(hwnd, id)]; *prev; prev = &(*prev)->next)
+        if ((*prev)->hwnd == hwnd && (*prev)->id == id && (*prev)->system == system) break;
+    return prev;
+}
+
+/* commit one more page of thunks and put them on the free list */
+static BOOL grow_timer_thunks(void)
+{
+    UINT count;
+
+    if (!timer_thunk_area &&
+        !(timer_thunk_area = VirtualAlloc(NULL, TIMER_THUNK_AREA_SIZE, MEM_RESERVE, PAGE_EXECUTE_READWRITE)))
+        return FALSE;
+    if (timer_thunk_committed >= TIMER_THUNK_AREA_SIZE) return FALSE;
+    if (!VirtualAlloc((BYTE *)timer_thunk_area + timer_thunk_committed, 0x1000, MEM_COMMIT, PAGE_EXECUTE_READWRITE))
+        return FALSE;
+    timer_thunk_committed += 0x1000;
+    count = timer_thunk_committed / sizeof(TIMERTHUNK);
+    for (; timer_thunk_count < count; timer_thunk_count++)
+    {
+        TIMERTHUNK *thunk = timer_thunk_area + timer_thunk_count;
+
+        thunk->refs = 0;
+        thunk->param = NULL;
+        thunk->next = NULL;
+        if (timer_thunk_free_tail) timer_thunk_free_tail->next = thunk;
+        else timer_thunk_free = thunk;
+        timer_thunk_free_tail = thunk;
+    }
+    TRACE("%u timer thunks\n", timer_thunk_count);
+    return TRUE;
+}
+
+/***********************************************************************
+ *           release_timer_thunk
+ *
+ * Drop a reference; the last one puts the thunk on the free list.
+ */
+void release_timer_thunk(TIMERTHUNK *thunk)
+{
+    TIMERTHUNK **prev;
+
+    if (--thunk->refs) return;
+    for (prev = &timer_thunk_hash[timer_thunk_hash_proc(thunk->param)]; *prev; prev = &(*prev)->next)
+    {
+        if (*prev != thunk) continue;
+        *prev = thunk->next;
+        break;
+    }
+    thunk->next = NULL;
+    if (timer_thunk_free_tail) timer_thunk_free_tail->next = thunk;
+    else timer_thunk_free = thunk;
+    timer_thunk_free_tail = thunk;
+}
+
+/* release the thunks of timers whose window is gone */
+static void collect_timer_uses(BOOL (WINAPI *window_exists)(HWND))
+{
+    struct timer_use **prev, *use;
+    UINT i;
+
+    for (i = 0; i < TIMER_THUNK_HASH_SIZE; i++)
+    {
+        for (prev = &timer_uses[i]; (use = *prev);)
+        {
+            if (!use->hwnd || window_exists(use->hwnd))
+            {
+                prev = &use->next;
+                continue;
+            }
+            *prev = use->next;
+            release_timer_thunk(use->thunk);
+            HeapFree(GetProcessHeap(), 0, use);
+        }
+    }
+}
+
+/***********************************************************************
+ *           get_timer_thunk
+ *
+ * Get a reference on the thunk of a proc. When there is no free thunk,
+ * the timers of windows that no longer exist are collected first.
+ */
+TIMERTHUNK *get_timer_thunk(LPVOID param, LPVOID func, BOOL (WINAPI *window_exists)(HWND))
+{
+    UINT h = timer_thunk_hash_proc(param);
+    TIMERTHUNK *thunk;
+
+    for (thunk = timer_thunk_hash[h]; thunk; thunk = thunk->next)
+    {
+        if (thunk->param != param) continue;
+        thunk->refs++;
+        return thunk;
+    }
+    if (!timer_thunk_free) collect_timer_uses(window_exists);
+    if (!timer_thunk_free && !grow_timer_thunks())
+    {
+        ERR("could not allocate timer thunk!\n");
+        return NULL;
+    }
+    thunk = timer_thunk_free;
+    if (!(timer_thunk_free = thunk->next)) timer_thunk_free_tail = NULL;
+
+    thunk->pop_eax = 0x58;
+    thunk->push_imm = 0x68;
+    thunk->this_ = thunk;
+    thunk->push_eax = 0x50;
+    thunk->jmp = 0xE9;
+    thunk->func = (UINT_PTR)func - (UINT_PTR)(&thunk->func + 1);
+    thunk->refs = 1;
+    thunk->param = param;
+    thunk->next = timer_thunk_hash[h];
+    timer_thunk_hash[h] = thunk;
+    return thunk;
+}
+
+/***********************************************************************
+ *           set_timer_use
+ *
+ * Record the thunk used by a timer (NULL when it is killed or has no
+ * proc), releasing the one it used before. The reference on thunk is
+ * handed over to the timer. FALSE if there was no memory to record it;
+ * the caller keeps the reference then, and must not leave the timer set
+ * since its messages wouldn't be dispatched.
+ */
+BOOL set_timer_use(HWND hwnd, UINT_PTR id, BOOL system, TIMERTHUNK *thunk)
+{
+    struct timer_use **prev = find_timer_use(hwnd, id, system), *use = *prev;
+
+    if (use)
+    {
+        release_timer_thunk(use->thunk);
+        if (thunk)
+        {
+            use->thunk = thunk;
+            return TRUE;
+        }
+        *prev = use->next;
+        HeapFree(GetProcessHeap(), 0, use);
+        return TRUE;
+    }
+    if (!thunk) return TRUE;
+    if (!(use = HeapAlloc(GetProcessHeap(), 0, sizeof(*use)))) return FALSE;
+    use->hwnd = hwnd;
+    use->id = id;
+    use->system = system;
+    use->thunk = thunk;
+    use->next = timer_uses[timer_use_hash(hwnd, id)];
+    timer_uses[timer_use_hash(hwnd, id)] = use;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           check_timer_use
+ *
+ * Whether a timer message carrying thunk belongs to a timer that is
+ * still set with it.
+ */
+BOOL check_timer_use(const TIMERTHUNK *thunk, HWND hwnd, UINT_PTR id, BOOL system)
+{
+    const struct timer_use *use = *find_timer_use(hwnd, id, system);
+
+    return use && use->thunk == thunk;
+}
+
+UINT get_timer_thunk_count(void)
+{
+    return timer_thunk_count;
+}
+
+BOOL is_timer_thunk(TIMERPROC proc)
+{
+    return timer_thunk_area && (TIMERTHUNK *)proc >= timer_thunk_area &&
+           (TIMERTHUNK *)proc < timer_thunk_area + TIMER_THUNK_MAX;
+}
@@ -0,0 +1,54 @@
+/*
+ * Thunks for 16-bit timer procs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_TIMERTHUNK_H
+#define __WINE_TIMERTHUNK_H
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "winuser.h"
+
+#include <pshpack1.h>
+typedef struct tagTIMERTHUNK
+{
+    BYTE pop_eax; /* 58 */
+    BYTE push_imm; /* 68 */
+    LPVOID this_;
+    BYTE push_eax; /* 50 */
+    BYTE jmp; /* E9 */
+    UINT_PTR func;
+    LONG refs;                      /* number of timers using the thunk */
+    LPVOID param;
+    struct tagTIMERTHUNK *next;     /* hash chain, or free list */
+} TIMERTHUNK;
+#include <poppack.h>
+
+/* reserved for thunks, committed a page at a time */
+#define TIMER_THUNK_AREA_SIZE   0x40000
+#define TIMER_THUNK_MAX         (TIMER_THUNK_AREA_SIZE / sizeof(TIMERTHUNK))
+
+extern TIMERTHUNK *get_timer_thunk( LPVOID param, LPVOID func, BOOL (WINAPI *window_exists)(HWND) ) DECLSPEC_HIDDEN;
+extern void release_timer_thunk( TIMERTHUNK *thunk ) DECLSPEC_HIDDEN;
+extern BOOL set_timer_use( HWND hwnd, UINT_PTR id, BOOL system, TIMERTHUNK *thunk ) DECLSPEC_HIDDEN;
+extern BOOL check_timer_use( const TIMERTHUNK *thunk, HWND hwnd, UINT_PTR id, BOOL system ) DECLSPEC_HIDDEN;
+extern UINT get_timer_thunk_count(void) DECLSPEC_HIDDEN;
+extern BOOL is_timer_thunk( TIMERPROC proc ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_TIMERTHUNK_H */
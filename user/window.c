@@ -21,6 +21,7 @@
 #include "wine/winuser16.h"
 #include "wownt32.h"
 #include "user_private.h"
+#include "timerthunk.h"
 #include "wine/debug.h"
 #include "wine/exception.h"
 #include "../krnl386/kernel16_private.h"
@@ -292,74 +293,32 @@ INT16 WINAPI MessageBox16( HWND16 hwnd, LPCSTR text, LPCSTR title, UINT16 type )
     return ret;
 }
 
-#include <pshpack1.h>
-typedef struct
-{
-    BYTE pop_eax; /* 58 */
-    BYTE push_imm; /* 68 */
-    LPVOID this_;
-    BYTE push_eax; /* 50 */
-    BYTE jmp; /* E9 */
-    UINT_PTR func;
-    BOOL used;
-    LPVOID param;
-} TIMERTHUNK;
-#include <poppack.h>
-static TIMERTHUNK *timer_thunk_array;
-static int MAX_TIMER_THUNK;
-static void init_timer_thunk()
-{
-    if (timer_thunk_array)
-        return;
-    MAX_TIMER_THUNK = 4096 / sizeof(TIMERTHUNK);
-    timer_thunk_array = VirtualAlloc(NULL, MAX_TIMER_THUNK * sizeof(TIMERTHUNK), MEM_COMMIT, PAGE_EXECUTE_READWRITE);
-}
-static TIMERTHUNK *init_timer_thunk_data(LPVOID param, int i, LPVOID func)
+/* protects the timer thunks of timerthunk.c */
+static CRITICAL_SECTION timer_thunk_cs;
+static CRITICAL_SECTION_DEBUG timer_thunk_critsect_debug =
 {
-    timer_thunk_array[i].pop_eax = 0x58;
-    timer_thunk_array[i].push_imm = 0x68;
-    timer_thunk_array[i].this_ = timer_thunk_array + i;
-    timer_thunk_array[i].push_eax = 0x50;
-    timer_thunk_array[i].jmp = 0xE9;
-    timer_thunk_array[i].func = (UINT_PTR)func - (UINT_PTR)(&timer_thunk_array[i].func + 1);
-    timer_thunk_array[i].used = TRUE;
-    timer_thunk_array[i].param = param;
-    return timer_thunk_array + i;
-}
-
-static TIMERPROC allocate_timer_thunk(LPVOID param, LPVOID func, BOOL re)
-{
-    init_timer_thunk();
-    if (re)
-    {
-        for (int i = 0; i < MAX_TIMER_THUNK; i++)
-        {
-            if (timer_thunk_array[i].used && timer_thunk_array[i].param == param)
-            {
-                return (TIMERPROC)(timer_thunk_array + i);
-            }
-        }
-    }
-    for (int i = 0; i < MAX_TIMER_THUNK; i++)
-    {
-        if (!timer_thunk_array[i].used)
-        {
-            return (TIMERPROC)init_timer_thunk_data(param, i, func);
-        }
-    }
-    ERR("could not allocate timer thunk!\n");
-    return NULL;
-}
+    0, 0, &timer_thunk_cs,
+    { &timer_thunk_critsect_debug.ProcessLocksList, &timer_thunk_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": timer_thunk_cs") }
+};
+static CRITICAL_SECTION timer_thunk_cs = { &timer_thunk_critsect_debug, -1, 0, 0, 0, 0 };
 
 VOID CALLBACK TimerProc_Thunk(TIMERTHUNK *data, HWND hWnd, UINT msg, UINT_PTR wp, DWORD lp)
 {
-    CallWindowProc16(data->param, HWND_16(hWnd), msg, wp, lp);
-    return;
-}
+    LPVOID proc;
+    BOOL valid;
 
-BOOL is_timer_thunk(TIMERPROC proc)
-{
-    return timer_thunk_array <= proc && proc < timer_thunk_array + MAX_TIMER_THUNK;
+    EnterCriticalSection(&timer_thunk_cs);
+    valid = check_timer_use(data, hWnd, wp, msg == WM_SYSTIMER);
+    proc = data->param;
+    LeaveCriticalSection(&timer_thunk_cs);
+    if (!valid)
+    {
+        /* the timer was killed or set again after the message was posted */
+        WARN("dropping stale timer message %04x for %p %lx\n", msg, hWnd, (ULONG_PTR)wp);
+        return;
+    }
+    CallWindowProc16(proc, HWND_16(hWnd), msg, wp, lp);
 }
 
 /***********************************************************************
@@ -367,15 +326,26 @@ BOOL is_timer_thunk(TIMERPROC proc)
  */
 UINT16 WINAPI SetTimer16( HWND16 hwnd, UINT16 id, UINT16 timeout, TIMERPROC16 proc )
 {
-    TIMERPROC proc32;
+    HWND hwnd32 = WIN_Handle32(hwnd);
+    TIMERTHUNK *thunk = NULL;
     UINT ret;
     timeout = timeout < 55 ? 55 : timeout;
-    if (proc == NULL)
+
+    EnterCriticalSection(&timer_thunk_cs);
+    if (proc && !(thunk = get_timer_thunk(proc, TimerProc_Thunk, IsWindow)))
     {
-        return SetTimer(WIN_Handle32(hwnd), id, timeout, NULL);
+        LeaveCriticalSection(&timer_thunk_cs);
+        return 0;
+    }
+    ret = SetTimer( hwnd32, id, timeout, (TIMERPROC)thunk );
+    /* thread timers get a new id from SetTimer */
+    if (ret && !set_timer_use(hwnd32, hwnd32 ? id : ret, FALSE, thunk))
+    {
+        KillTimer( hwnd32, hwnd32 ? id : ret );
+        ret = 0;
     }
-    proc32 = allocate_timer_thunk(proc, TimerProc_Thunk, TRUE);
-    ret = SetTimer( WIN_Handle32(hwnd), id, timeout, proc32 );
+    if (!ret && thunk) release_timer_thunk(thunk);
+    LeaveCriticalSection(&timer_thunk_cs);
     return ret;
 }
 
@@ -385,13 +355,30 @@ UINT16 WINAPI SetTimer16( HWND16 hwnd, UINT16 id, UINT16 timeout, TIMERPROC16 pr
  */
 UINT16 WINAPI SetSystemTimer16( HWND16 hwnd, UINT16 id, UINT16 timeout, TIMERPROC16 proc )
 {
-    TIMERPROC proc32 = proc == NULL ? NULL : allocate_timer_thunk(proc, TimerProc_Thunk, TRUE);
+    HWND hwnd32 = WIN_Handle32(hwnd);
+    TIMERTHUNK *thunk = NULL;
+    UINT ret;
+
     if (!SetSystemTimer)
     {
         ERR("SetSystemTimer NULL\n");
         return 0;
     }
-    return SetSystemTimer( WIN_Handle32(hwnd), id, timeout, proc32 );
+    EnterCriticalSection(&timer_thunk_cs);
+    if (proc && !(thunk = get_timer_thunk(proc, TimerProc_Thunk, IsWindow)))
+    {
+        LeaveCriticalSection(&timer_thunk_cs);
+        return 0;
+    }
+    ret = SetSystemTimer( hwnd32, id, timeout, (TIMERPROC)thunk );
+    if (ret && !set_timer_use(hwnd32, hwnd32 ? id : ret, TRUE, thunk))
+    {
+        KillSystemTimer( hwnd32, hwnd32 ? id : ret );
+        ret = 0;
+    }
+    if (!ret && thunk) release_timer_thunk(thunk);
+    LeaveCriticalSection(&timer_thunk_cs);
+    return ret;
 }
 
 
@@ -400,7 +387,16 @@ UINT16 WINAPI SetSystemTimer16( HWND16 hwnd, UINT16 id, UINT16 timeout, TIMERPRO
  */
 BOOL16 WINAPI KillTimer16( HWND16 hwnd, UINT16 id )
 {
-    return KillTimer( WIN_Handle32(hwnd), id );
+    HWND hwnd32 = WIN_Handle32(hwnd);
+    BOOL ret = KillTimer( hwnd32, id );
+
+    if (ret)
+    {
+        EnterCriticalSection(&timer_thunk_cs);
+        set_timer_use(hwnd32, id, FALSE, NULL);
+        LeaveCriticalSection(&timer_thunk_cs);
+    }
+    return ret;
 }
 
 
@@ -1997,12 +1993,22 @@ void WINAPI SwitchToThisWindow16( HWND16 hwnd, BOOL16 restore )
  */
 BOOL16 WINAPI KillSystemTimer16( HWND16 hwnd, UINT16 id )
 {
+    HWND hwnd32 = WIN_Handle32(hwnd);
+    BOOL ret;
+
     if (!KillSystemTimer)
     {
         ERR("KillSystemTimer NULL\n");
         return 0;
     }
-    return KillSystemTimer( WIN_Handle32(hwnd), id );
+    ret = KillSystemTimer( hwnd32, id );
+    if (ret)
+    {
+        EnterCriticalSection(&timer_thunk_cs);
+        set_timer_use(hwnd32, id, TRUE, NULL);
+        LeaveCriticalSection(&timer_thunk_cs);
+    }
+    return ret;
 }
 
 
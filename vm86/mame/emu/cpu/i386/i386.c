@@ -44,11 +44,61 @@ static void pentium_smi();
 
 /*************************************************************************/
 
+/* Decoded LDT descriptors, so reloading a segment register with a selector
+   that was already used doesn't read and decode the descriptor again.
+   Entries are invalidated by libwine whenever it modifies an LDT entry.
+
+   Only the thread running the CPU, which holds the Win16 lock, reads and
+   fills the cache. LDT entries are also written by threads that don't hold
+   it (32-bit code allocating or changing selectors through krnl386), so
+   i386_invalidate_descriptor can run in the middle of a segment load:
+   - a hit returns the descriptor as it was before the write, as if the
+     load had come first;
+   - a miss may have read the old descriptor, so it only keeps the entry
+     if no invalidation happened since it started reading. The invalidation
+     counter is bumped before valid is cleared, and the fill sets valid
+     before it checks the counter, so one of the two sides always sees the
+     other. */
+struct I386_DESC_CACHE
+{
+	UINT32 v1, v2;
+	UINT32 base;
+	UINT32 limit;
+	UINT16 flags;
+	UINT8 d;
+	volatile UINT8 valid;
+};
+
+static I386_DESC_CACHE m_desc_cache[8192];
+static UINT32 m_desc_cache_base;
+static volatile LONG m_desc_cache_gen;
+
+static void i386_flush_descriptor_cache(void)
+{
+	memset(m_desc_cache, 0, sizeof(m_desc_cache));
+	m_desc_cache_base = m_ldtr.base;
+}
+
+static void i386_invalidate_descriptor(unsigned short selector)
+{
+	InterlockedIncrement(&m_desc_cache_gen);
+	m_desc_cache[selector >> 3].valid = 0;
+}
+
+static I386_DESC_CACHE *i386_get_descriptor_cache(UINT16 selector, UINT32 base)
+{
+	if (!(selector & 0x4) || base != m_desc_cache_base)
+		return NULL;
+	return &m_desc_cache[selector >> 3];
+}
+
 static UINT32 i386_load_protected_mode_segment(I386_SREG *seg, UINT64 *desc )
 {
 	UINT32 v1,v2;
 	UINT32 base, limit;
 	int entry;
+	I386_DESC_CACHE *cache;
+	LONG gen;
 
 	if(!seg->selector)
 	{
@@ -73,6 +123,21 @@ static UINT32 i386_load_protected_mode_segment(I386_SREG *seg, UINT64 *desc )
 	if (limit == 0 || entry + 7 > limit)
 		return 0;
 
+	cache = i386_get_descriptor_cache(seg->selector, base);
+	if (cache && cache->valid)
+	{
+		seg->flags = cache->flags;
+		seg->base = cache->base;
+		seg->limit = cache->limit;
+		seg->d = cache->d;
+		seg->valid = true;
+		if(desc)
+			*desc = ((UINT64)cache->v2<<32)|cache->v1;
+		return 1;
+	}
+
+	gen = m_desc_cache_gen;
+	MemoryBarrier();
 	v1 = READ32PL0(base + entry );
 	v2 = READ32PL0(base + entry + 4 );
 
@@ -84,6 +149,20 @@ static UINT32 i386_load_protected_mode_segment(I386_SREG *seg, UINT64 *desc )
 	seg->d = (seg->flags & 0x4000) ? 1 : 0;
 	seg->valid = true;
 
+	if (cache)
+	{
+		cache->v1 = v1;
+		cache->v2 = v2;
+		cache->flags = seg->flags;
+		cache->base = seg->base;
+		cache->limit = seg->limit;
+		cache->d = seg->d;
+		cache->valid = 1;
+		MemoryBarrier();
+		if (m_desc_cache_gen != gen)
+			cache->valid = 0;
+	}
+
 	if(desc)
 		*desc = ((UINT64)v2<<32)|v1;
 	return 1;
@@ -125,6 +204,7 @@ static void i386_set_descriptor_accessed(UINT16 selector)
 	// assume the selector is valid, we don't need to check it again
 	UINT32 base, addr;
 	UINT8 rights;
+	I386_DESC_CACHE *cache;
 	if(!(selector & ~3))
 		return;
 
@@ -133,11 +213,21 @@ static void i386_set_descriptor_accessed(UINT16 selector)
 	else
 		base = m_gdtr.base;
 
+	// the accessed bit is sticky, only write it once per descriptor
+	cache = i386_get_descriptor_cache(selector, base);
+	if (cache && cache->valid && (cache->flags & 1))
+		return;
+
 	addr = base + (selector & ~7) + 5;
 	i386_translate_address(TRANSLATE_READ, &addr, NULL);
 	rights = read_byte(addr);
 	// Should a fault be thrown if the table is read only?
 	write_byte(addr, rights | 1);
+	if (cache && cache->valid)
+	{
+		cache->v2 |= 0x100;
+		cache->flags |= 1;
+	}
 }
 //
 void load_segment_descriptor_wine(int sreg);
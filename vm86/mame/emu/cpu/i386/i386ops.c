@@ -1089,6 +1089,68 @@ static void I386OP(outsd)()             // Opcode 0x6f
 	I386OP(outs_generic)(4);
 }
 
+// REP INS/OUTS over a forward range that needs no paging and does not wrap:
+// move the whole string through the port with block transfers
+static bool I386OP(rep_port_block)(UINT8 opcode)
+{
+	int size = (opcode & 1) ? (m_operand_size ? 4 : 2) : 1;
+	bool out = opcode >= 0x6e;
+	int segment = out ? (m_segment_prefix ? m_segment_override : DS) : ES;
+	UINT32 count = m_address_size ? REG32(ECX) : REG16(CX);
+	UINT32 offset;
+	UINT16 port = REG16(DX);
+	UINT8 buffer[4096];
+	UINT32 ea, chunk, i;
+
+	if (out)
+		offset = m_address_size ? REG32(ESI) : REG16(SI);
+	else
+		offset = m_address_size ? REG32(EDI) : REG16(DI);
+
+	if (m_DF || (m_cr[0] & 0x80000000) || count < 2 || (port & (size - 1)))
+		return false;
+	if ((UINT64)offset + (UINT64)count * size > (m_address_size ? 0x100000000ULL : 0x10000ULL))
+		return false;
+	if (i386_limit_check(segment, offset) || i386_limit_check(segment, offset + count * size - 1))
+		return false;
+
+	ea = i386_translate(segment, offset, out ? 0 : 1);
+	check_ioperm(port, size == 1 ? 1 : (size == 2 ? 3 : 0xf));
+
+	while (count)
+	{
+		chunk = count < sizeof(buffer) / size ? count : sizeof(buffer) / size;
+		if (out)
+		{
+			for (i = 0; i < chunk * size; i++)
+				buffer[i] = READ8(ea + i);
+			write_io_block(port, size, buffer, chunk);
+			if (m_address_size)
+				REG32(ESI) += chunk * size;
+			else
+				REG16(SI) += chunk * size;
+		}
+		else
+		{
+			read_io_block(port, size, buffer, chunk);
+			for (i = 0; i < chunk * size; i++)
+				WRITE8(ea + i, buffer[i]);
+			if (m_address_size)
+				REG32(EDI) += chunk * size;
+			else
+				REG16(DI) += chunk * size;
+		}
+		ea += chunk * size;
+		count -= chunk;
+		if (m_address_size)
+			REG32(ECX) = count;
+		else
+			REG16(CX) = count;
+		CYCLES_NUM(chunk * 4);
+	}
+	return true;
+}
+
 static void I386OP(repeat)(int invert_flag)
 {
 	UINT32 repeated_eip = m_eip;
@@ -1250,6 +1312,8 @@ static void I386OP(repeat)(int invert_flag)
 
 	/* now actually perform the repeat */
 	CYCLES_NUM(cycle_base);
+	if (opcode >= 0x6c && opcode <= 0x6f && I386OP(rep_port_block)(opcode))
+		return;
 	do
 	{
 		m_eip = repeated_eip;
@@ -0,0 +1,112 @@
+// license:BSD-3-Clause
+// copyright-holders:Phil Bennett
+
+#pragma once
+
+#ifndef __X87FAST_H__
+#define __X87FAST_H__
+
+/*
+    Fast path for double precision with round to nearest, the usual setting
+    of Win16 compilers. Operands are only taken when they are normal numbers
+    that a double holds exactly, with exponents small enough that neither the
+    result nor the error terms below can overflow or become denormal. The
+    only flag such an operation can raise is inexact, which is derived
+    exactly from the rounding error. Everything else goes through SoftFloat.
+
+    The functions only look at the SoftFloat rounding mode, so x87ops.c
+    calls them when the precision control selects double precision.
+*/
+#define X87_FAST_EXP_LIMIT 450
+
+INLINE int x87_to_host_double(floatx80 fx, double *d)
+{
+	int exp = (fx.high & 0x7fff) - 0x3fff;
+	UINT64 bits;
+
+	if (exp < -X87_FAST_EXP_LIMIT || exp > X87_FAST_EXP_LIMIT)
+		return 0;
+	if (!(fx.low & U64(0x8000000000000000)) || (fx.low & 0x7ff))
+		return 0;
+
+	bits = ((UINT64)(fx.high & 0x8000) << 48) | ((UINT64)(exp + 1023) << 52) |
+		((fx.low >> 11) & U64(0x000fffffffffffff));
+	memcpy(d, &bits, sizeof(bits));
+	return 1;
+}
+
+INLINE floatx80 x87_from_host_double(double d, int inexact)
+{
+	float64 bits;
+
+	memcpy(&bits, &d, sizeof(bits));
+	if (inexact)
+		float_exception_flags |= float_flag_inexact;
+	return float64_to_floatx80(bits);
+}
+
+/* Veltkamp split, exact for the exponent range accepted above */
+INLINE void x87_split_double(double a, double *hi, double *lo)
+{
+	double c = 134217729.0 * a;
+
+	*hi = c - (c - a);
+	*lo = a - *hi;
+}
+
+/* Dekker's product, returns the exact rounding error of a * b = p */
+INLINE double x87_mul_error(double a, double b, double p)
+{
+	double ah, al, bh, bl;
+
+	x87_split_double(a, &ah, &al);
+	x87_split_double(b, &bh, &bl);
+	return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+}
+
+INLINE int x87_fast_add(floatx80 a, floatx80 b, int negate_b, floatx80 *result)
+{
+	double da, db, s, bb;
+
+	if (float_rounding_mode != float_round_nearest_even ||
+		!x87_to_host_double(a, &da) || !x87_to_host_double(b, &db))
+		return 0;
+	if (negate_b)
+		db = -db;
+
+	s = da + db;
+	/* Knuth's two-sum, the rounding error is zero iff the sum is exact */
+	bb = s - da;
+	*result = x87_from_host_double(s, ((da - (s - bb)) + (db - bb)) != 0.0);
+	return 1;
+}
+
+INLINE int x87_fast_mul(floatx80 a, floatx80 b, floatx80 *result)
+{
+	double da, db, p;
+
+	if (float_rounding_mode != float_round_nearest_even ||
+		!x87_to_host_double(a, &da) || !x87_to_host_double(b, &db))
+		return 0;
+
+	p = da * db;
+	*result = x87_from_host_double(p, x87_mul_error(da, db, p) != 0.0);
+	return 1;
+}
+
+INLINE int x87_fast_div(floatx80 a, floatx80 b, floatx80 *result)
+{
+	double da, db, q, p;
+
+	if (float_rounding_mode != float_round_nearest_even ||
+		!x87_to_host_double(a, &da) || !x87_to_host_double(b, &db))
+		return 0;
+
+	q = da / db;
+	/* the quotient is exact iff q * b == a; a - p is exact (Sterbenz) */
+	p = q * db;
+	*result = x87_from_host_double(q, (da - p) != x87_mul_error(q, db, p));
+	return 1;
+}
+
+#endif /* __X87FAST_H__ */
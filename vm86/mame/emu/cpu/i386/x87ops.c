@@ -20,6 +20,8 @@
 
 #include <math.h>
 
+#include "x87fast.h"
+
 
 /*************************************
  *
@@ -398,6 +400,9 @@ static floatx80 x87_add(floatx80 a, floatx80 b)
 		}
 		case X87_CW_PC_DOUBLE:
 		{
+			if (x87_fast_add(a, b, 0, &result))
+				break;
+
 			float64 a64 = floatx80_to_float64(a);
 			float64 b64 = floatx80_to_float64(b);
 			result = float64_to_floatx80(float64_add(a64, b64));
@@ -428,6 +433,9 @@ static floatx80 x87_sub(floatx80 a, floatx80 b)
 		}
 		case X87_CW_PC_DOUBLE:
 		{
+			if (x87_fast_add(a, b, 1, &result))
+				break;
+
 			float64 a64 = floatx80_to_float64(a);
 			float64 b64 = floatx80_to_float64(b);
 			result = float64_to_floatx80(float64_sub(a64, b64));
@@ -458,6 +466,9 @@ static floatx80 x87_mul(floatx80 a, floatx80 b)
 		}
 		case X87_CW_PC_DOUBLE:
 		{
+			if (x87_fast_mul(a, b, &val))
+				break;
+
 			float64 a64 = floatx80_to_float64(a);
 			float64 b64 = floatx80_to_float64(b);
 			val = float64_to_floatx80(float64_mul(a64, b64));
@@ -489,6 +500,9 @@ static floatx80 x87_div(floatx80 a, floatx80 b)
 		}
 		case X87_CW_PC_DOUBLE:
 		{
+			if (x87_fast_div(a, b, &val))
+				break;
+
 			float64 a64 = floatx80_to_float64(a);
 			float64 b64 = floatx80_to_float64(b);
 			val = float64_to_floatx80(float64_div(a64, b64));
@@ -225,9 +225,27 @@ void *read_ptr(offs_t byteaddress)
 {
 	return nullptr;
 }
+// planar vga memory, set up by init_vm86 from krnl386
+typedef UINT8 (*VGA_PlanarRead_t)(DWORD offset);
+typedef void (*VGA_PlanarWrite_t)(DWORD offset, UINT8 value);
+typedef const volatile DWORD *(*VGA_GetPlanarBase_t)(void);
+static VGA_PlanarRead_t VGA_PlanarRead;
+static VGA_PlanarWrite_t VGA_PlanarWrite;
+static const DWORD vga_planar_none = 0;
+static const volatile DWORD *vga_planar_base = &vga_planar_none;
+
+// true if the access touches the 64k window of a planar vga mode
+static inline bool vga_planar(offs_t byteaddress, int size)
+{
+	DWORD base = *vga_planar_base;
+	return base && byteaddress + size > base && byteaddress < base + 0x10000;
+}
+
 // read accessors
 UINT8 read_byte(offs_t byteaddress)
 {
+	if(vga_planar(byteaddress, 1))
+		return VGA_PlanarRead(byteaddress - *vga_planar_base);
 #if 0// defined(HAS_I386)
 	if(byteaddress < MAX_MEM) {
 		return mem[byteaddress];
@@ -242,6 +260,8 @@ UINT8 read_byte(offs_t byteaddress)
 
 UINT16 read_word(offs_t byteaddress)
 {
+	if(vga_planar(byteaddress, 2))
+		return read_byte(byteaddress) | (read_byte(byteaddress + 1) << 8);
 #if 0// defined(HAS_I386)
 	if(byteaddress < MAX_MEM - 1) {
 		return *(UINT16 *)(mem + byteaddress);
@@ -256,6 +276,8 @@ UINT16 read_word(offs_t byteaddress)
 
 UINT32 read_dword(offs_t byteaddress)
 {
+	if(vga_planar(byteaddress, 4))
+		return read_word(byteaddress) | (read_word(byteaddress + 2) << 16);
 #if 0// defined(HAS_I386)
 	if(byteaddress < MAX_MEM - 3) {
 		return *(UINT32 *)(mem + byteaddress);
@@ -270,6 +292,11 @@ UINT32 read_dword(offs_t byteaddress)
 
 void write_byte(offs_t byteaddress, UINT8 data)
 {
+	if(vga_planar(byteaddress, 1))
+	{
+		VGA_PlanarWrite(byteaddress - *vga_planar_base, data);
+		return;
+	}
 	/*
 	if(byteaddress < MEMORY_END) {
 		mem[byteaddress] = data;
@@ -298,6 +325,12 @@ void write_byte(offs_t byteaddress, UINT8 data)
 
 void write_word(offs_t byteaddress, UINT16 data)
 {
+	if(vga_planar(byteaddress, 2))
+	{
+		write_byte(byteaddress, data & 0xff);
+		write_byte(byteaddress + 1, data >> 8);
+		return;
+	}
 	*(UINT16 *)(mem + byteaddress) = data;
 	/*
 	if(byteaddress < MEMORY_END) {
@@ -325,6 +358,12 @@ void write_word(offs_t byteaddress, UINT16 data)
 
 void write_dword(offs_t byteaddress, UINT32 data)
 {
+	if(vga_planar(byteaddress, 4))
+	{
+		write_word(byteaddress, data & 0xffff);
+		write_word(byteaddress + 2, data >> 16);
+		return;
+	}
 	*(UINT32 *)(mem + byteaddress) = data;
 	/*
 	if(byteaddress < MEMORY_END) {
@@ -372,6 +411,9 @@ void write_io_byte(offs_t byteaddress, UINT8 data);
 void write_io_word(offs_t byteaddress, UINT16 data);
 void write_io_dword(offs_t byteaddress, UINT32 data);
 
+void read_io_block(offs_t byteaddress, int size, UINT8 *buffer, UINT32 count);
+void write_io_block(offs_t byteaddress, int size, const UINT8 *buffer, UINT32 count);
+
 /*****************************************************************************/
 /* src/osd/osdcomm.h */
 
@@ -478,8 +520,12 @@ int pic_ack()
 
 typedef DWORD (*DOSVM_inport_t)(int port, int size, CONTEXT *ctx);
 typedef void (*DOSVM_outport_t)(int port, int size, DWORD value, CONTEXT *ctx);
+typedef void (*DOSVM_inport_block_t)(int port, int size, void *buffer, DWORD count, CONTEXT *ctx);
+typedef void (*DOSVM_outport_block_t)(int port, int size, const void *buffer, DWORD count, CONTEXT *ctx);
 DOSVM_inport_t DOSVM_inport;
 DOSVM_outport_t DOSVM_outport;
+DOSVM_inport_block_t DOSVM_inport_block;
+DOSVM_outport_block_t DOSVM_outport_block;
 extern "C" void save_context(CONTEXT *context);
 extern "C" void load_context(CONTEXT *context);
 
@@ -534,6 +580,42 @@ void write_io_dword(offs_t addr, UINT32 val)
     DOSVM_outport(addr, 4, val, &ctx);
     load_context(&ctx);
 }
+
+// string i/o to one port, the context is saved once for the whole block
+void read_io_block(offs_t addr, int size, UINT8 *buffer, UINT32 count)
+{
+    CONTEXT ctx;
+    save_context(&ctx);
+    if (DOSVM_inport_block)
+        DOSVM_inport_block(addr, size, buffer, count, &ctx);
+    else
+    {
+        for (UINT32 i = 0; i < count; i++, buffer += size)
+        {
+            DWORD val = DOSVM_inport(addr, size, &ctx);
+            memcpy(buffer, &val, size);
+        }
+    }
+    load_context(&ctx);
+}
+
+void write_io_block(offs_t addr, int size, const UINT8 *buffer, UINT32 count)
+{
+    CONTEXT ctx;
+    save_context(&ctx);
+    if (DOSVM_outport_block)
+        DOSVM_outport_block(addr, size, buffer, count, &ctx);
+    else
+    {
+        for (UINT32 i = 0; i < count; i++, buffer += size)
+        {
+            DWORD val = 0;
+            memcpy(&val, buffer, size);
+            DOSVM_outport(addr, size, val, &ctx);
+        }
+    }
+    load_context(&ctx);
+}
 #undef min
 #undef max
 
@@ -1014,6 +1096,13 @@ extern "C"
             krnl386 = LoadLibraryA(KRNL386);
         DOSVM_inport = (DOSVM_inport_t)GetProcAddress(krnl386, "DOSVM_inport");
         DOSVM_outport = (DOSVM_outport_t)GetProcAddress(krnl386, "DOSVM_outport");
+        DOSVM_inport_block = (DOSVM_inport_block_t)GetProcAddress(krnl386, "DOSVM_inport_block");
+        DOSVM_outport_block = (DOSVM_outport_block_t)GetProcAddress(krnl386, "DOSVM_outport_block");
+        VGA_PlanarRead = (VGA_PlanarRead_t)GetProcAddress(krnl386, "VGA_PlanarRead");
+        VGA_PlanarWrite = (VGA_PlanarWrite_t)GetProcAddress(krnl386, "VGA_PlanarWrite");
+        VGA_GetPlanarBase_t get_planar_base = (VGA_GetPlanarBase_t)GetProcAddress(krnl386, "VGA_GetPlanarBase");
+        if (VGA_PlanarRead && VGA_PlanarWrite && get_planar_base)
+            vga_planar_base = get_planar_base();
         void(WINAPI *set_vm_inject_cb)(vm_inject_t) = (void(WINAPI *)(vm_inject_t))GetProcAddress(krnl386, "set_vm_inject_cb");
         set_vm_inject_cb(vm_inject);
         inject_event = CreateEventW(NULL, TRUE, FALSE, NULL);
@@ -1127,6 +1216,9 @@ extern "C"
         m_task.limit = sizeof(tss);
         *(WORD*)((char*)tss + 0x66) = sizeof(tss) - 65536 / 8;
         memset((char*)tss + sizeof(tss) - 65536 / 8, 0x00, 65536 / 8);
+        /* the LDT entries above were written directly */
+        i386_flush_descriptor_cache();
+        wine_ldt_set_notify(i386_invalidate_descriptor);
         return TRUE;
 	}
     DWORD mergeReg(DWORD a1, DWORD a2)
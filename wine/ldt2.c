@@ -46,6 +46,19 @@ void *wine_ldt_get_ptr(unsigned short sel, unsigned long offset)
 	if (!(wine_ldt_copy.flags[index] & WINE_LDT_FLAGS_32BIT)) offset &= 0xffff;
 	return (char *)wine_ldt_copy.base[index] + offset;
 }
+static void (*ldt_notify)(unsigned short sel);
+/***********************************************************************
+*           wine_ldt_set_notify
+*
+* Register a function called whenever an LDT entry is modified, so that
+* CPU emulators can drop their cached copy of the descriptor. The function
+* runs on the thread that modified the entry, after the new descriptor is
+* written, and that thread doesn't necessarily hold the Win16 lock.
+*/
+void wine_ldt_set_notify(void (*func)(unsigned short sel))
+{
+    ldt_notify = func;
+}
 static BOOL intel_vt_x_workaround = FALSE;
 static void (*intel_vt_x_workaround_update_entry)(int seg, const LDT_ENTRY *entry);
 void set_intel_vt_x_workaround(void(*func)(int seg, const LDT_ENTRY *entry))
@@ -79,6 +92,7 @@ int wine_ldt_set_entry(unsigned short sel, const LDT_ENTRY *entry)
 		wine_ldt_copy.flags[index] = (entry->HighWord.Bits.Type |
 			(entry->HighWord.Bits.Default_Big ? WINE_LDT_FLAGS_32BIT : 0) |
 			(wine_ldt_copy.flags[index] & WINE_LDT_FLAGS_ALLOCATED));
+		if (ldt_notify) ldt_notify(sel);
 	}
 
 	TRACE("wine_ldt_set_entry(0x%04X, %p)\n", sel, entry);
@@ -222,6 +236,7 @@ static int internal_set_entry(unsigned short sel, const LDT_ENTRY *entry)
 		wine_ldt_copy.flags[index] = (entry->HighWord.Bits.Type |
 			(entry->HighWord.Bits.Default_Big ? WINE_LDT_FLAGS_32BIT : 0) |
 			(wine_ldt_copy.flags[index] & WINE_LDT_FLAGS_ALLOCATED));
+		if (ldt_notify) ldt_notify(sel);
 	}
 	return ret;
 }
@@ -154,6 +154,16 @@ typedef struct
     SEGPTR    reserved;
 } LOADPARAMS16;
 
+/* otvdm private hEnvironment values, reserved then holds a flat pointer */
+#define LOADPARAMS16_CURDIR    0x0bef  /* LPCSTR current directory */
+#define LOADPARAMS16_EXTENDED  0x0bf0  /* LOADPARAMS16_EXTRA * */
+
+typedef struct
+{
+    LPCSTR    curdir;       /* current directory of the new task, or NULL */
+    LPCSTR    environment;  /* Win32 environment block of the new task, or NULL */
+} LOADPARAMS16_EXTRA;
+
 /* Debugging support (DEBUG SYSTEM ONLY) */
 typedef struct
 {
@@ -1274,6 +1274,44 @@ static unsigned HLPFILE_HalfPointsScale(HLPFILE_PAGE* page, unsigned pts)
     return pts * page->file->scale - page->file->rounderr;
 }
 
+/***********************************************************************
+ *
+ *           HLPFILE_GetParagraphText
+ *
+ * Returns the (phrase decompressed) text part of a paragraph record in a
+ * newly allocated buffer. Strings in it are separated by NUL characters.
+ */
+static char* HLPFILE_GetParagraphText(HLPFILE* hlpfile, const BYTE* buf, const BYTE* end, LONG* psize)
+{
+    char*       text;
+    LONG        size, blocksize, datalen;
+
+    blocksize = GET_UINT(buf, 0);
+    size = GET_UINT(buf, 0x4);
+    datalen = GET_UINT(buf, 0x10);
+    text = HeapAlloc(GetProcessHeap(), 0, size);
+    if (!text) return NULL;
+    if (size > blocksize - datalen)
+    {
+        /* need to decompress */
+        if (hlpfile->hasPhrases)
+            HLPFILE_Uncompress2(hlpfile, buf + datalen, end, (BYTE*)text, (BYTE*)text + size);
+        else if (hlpfile->hasPhrases40)
+            HLPFILE_Uncompress3(hlpfile, text, text + size, buf + datalen, end);
+        else
+        {
+            WINE_FIXME("Text size is too long, splitting\n");
+            size = blocksize - datalen;
+            memcpy(text, buf + datalen, size);
+        }
+    }
+    else
+        memcpy(text, buf + datalen, size);
+
+    *psize = size;
+    return text;
+}
+
 /***********************************************************************
  *
  *           HLPFILE_BrowseParagraph
@@ -1284,7 +1322,7 @@ static BOOL HLPFILE_BrowseParagraph(HLPFILE_PAGE* page, struct RtfData* rd,
     UINT               textsize;
     const BYTE        *format, *format_end;
     char              *text, *text_base, *text_end;
-    LONG               size, blocksize, datalen;
+    LONG               size;
     unsigned short     bits;
     unsigned           ncol = 1;
     short              nc, lastcol, table_width, lastfont = 0;
@@ -1295,27 +1333,8 @@ static BOOL HLPFILE_BrowseParagraph(HLPFILE_PAGE* page, struct RtfData* rd,
     if (buf + 0x19 > end) {WINE_WARN("header too small\n"); return FALSE;};
 
     *parlen = 0;
-    blocksize = GET_UINT(buf, 0);
-    size = GET_UINT(buf, 0x4);
-    datalen = GET_UINT(buf, 0x10);
-    text = text_base = HeapAlloc(GetProcessHeap(), 0, size);
+    text = text_base = HLPFILE_GetParagraphText(page->file, buf, end, &size);
     if (!text) return FALSE;
-    if (size > blocksize - datalen)
-    {
-        /* need to decompress */
-        if (page->file->hasPhrases)
-            HLPFILE_Uncompress2(page->file, buf + datalen, end, (BYTE*)text, (BYTE*)text + size);
-        else if (page->file->hasPhrases40)
-            HLPFILE_Uncompress3(page->file, text, text + size, buf + datalen, end);
-        else
-        {
-            WINE_FIXME("Text size is too long, splitting\n");
-            size = blocksize - datalen;
-            memcpy(text, buf + datalen, size);
-        }
-    }
-    else
-        memcpy(text, buf + datalen, size);
 
     text_end = text + size;
 
@@ -2026,6 +2045,80 @@ done:
     return HLPFILE_RtfAddControl(rd, "}");
 }
 
+/***********************************************************************
+ *
+ *           HLPFILE_EnumPageText
+ *
+ * Calls cb for the text of every paragraph of a page, without building
+ * the RTF stream (used for full text indexing).
+ */
+BOOL    HLPFILE_EnumPageText(HLPFILE_PAGE* page, HLPFILE_TextCallback cb, void* cookie)
+{
+    HLPFILE     *hlpfile = page->file;
+    BYTE        *buf, *end;
+    DWORD       ref = page->reference;
+    unsigned    index, old_index = hlpfile->version <= 16 ? -1 : page->offset >> 15;
+    unsigned    offset, count = 0;
+    char*       text;
+    LONG        size;
+
+    if (page == hlpfile->cnt_page) return TRUE;
+
+    do
+    {
+        if (hlpfile->version <= 16)
+        {
+            index  = (ref - 0x0C) / hlpfile->dsize;
+            offset = (ref - 0x0C) % hlpfile->dsize;
+        }
+        else
+        {
+            index  = (ref - 0x0C) >> 14;
+            offset = (ref - 0x0C) & 0x3FFF;
+        }
+
+        if (hlpfile->version <= 16 && index != old_index && old_index != -1)
+        {
+            /* we jumped to the next block, adjust pointers */
+            ref -= 12;
+            offset -= 12;
+        }
+
+        if (index >= hlpfile->topic_maplen) {WINE_WARN("maplen\n"); break;}
+        buf = hlpfile->topic_map[index] + offset;
+        if (buf + 0x15 >= hlpfile->topic_end) {WINE_WARN("extra\n"); break;}
+        end = min(buf + GET_UINT(buf, 0), hlpfile->topic_end);
+        old_index = index;
+
+        switch (buf[0x14])
+        {
+        case HLP_TOPICHDR:
+            if (count++) return TRUE;
+            break;
+        case HLP_DISPLAY30:
+        case HLP_DISPLAY:
+        case HLP_TABLE:
+            if (buf + 0x19 > end) {WINE_WARN("header too small\n"); return FALSE;};
+            text = HLPFILE_GetParagraphText(hlpfile, buf, end, &size);
+            if (!text) return FALSE;
+            cb(cookie, text, size);
+            HeapFree(GetProcessHeap(), 0, text);
+            break;
+        default:
+            WINE_ERR("buf[0x14] = %x\n", buf[0x14]);
+        }
+        if (hlpfile->version <= 16)
+        {
+            ref += GET_UINT(buf, 0xc);
+            if (GET_UINT(buf, 0xc) == 0)
+                break;
+        }
+        else
+            ref = GET_UINT(buf, 0xc);
+    } while (ref != 0xffffffff);
+    return TRUE;
+}
+
 /******************************************************************
  *		HLPFILE_ReadFont
  *
@@ -2698,6 +2791,7 @@ void HLPFILE_FreeHlpFile(HLPFILE* hlpfile)
         HeapFree(GetProcessHeap(), 0, hlpfile->bmps);
     }
 
+    SEARCH_FreeIndex(hlpfile);
     HLPFILE_DeletePage(hlpfile->first_page);
     HLPFILE_DeleteMacro(hlpfile->first_macro);
 
@@ -181,6 +181,8 @@ typedef struct tagHlpFileFile
 
     int                         scale;
     int                         rounderr;
+
+    struct search_index*        search;     /* full text index, built on demand */
 } HLPFILE;
 
 /*
@@ -205,6 +207,16 @@ typedef int (*HLPFILE_BPTreeCompare)(void *p, const void *key,
  */
 typedef void (*HLPFILE_BPTreeCallback)(void *p, void **next, void *cookie);
 
+/*
+ * Callback function type for HLPFILE_EnumPageText function.
+ *
+ * PARAMS
+ *     cookie  [IO] cookie data
+ *     text    [I]  paragraph text, strings are separated by NUL characters
+ *     len     [I]  size of text in bytes
+ */
+typedef void (*HLPFILE_TextCallback)(void *cookie, const char *text, LONG len);
+
 HLPFILE*      HLPFILE_ReadHlpFile(LPCSTR lpszPath);
 HLPFILE_PAGE* HLPFILE_PageByHash(HLPFILE* hlpfile, LONG lHash, ULONG* relative);
 HLPFILE_PAGE* HLPFILE_PageByMap(HLPFILE* hlpfile, LONG lMap, ULONG* relative);
@@ -235,6 +247,24 @@ struct RtfData {
 BOOL          HLPFILE_BrowsePage(HLPFILE_PAGE*, struct RtfData* rd,
                                  unsigned font_scale, unsigned relative,
 				 HLPFILE_WINDOWINFO* info);
+BOOL          HLPFILE_EnumPageText(HLPFILE_PAGE*, HLPFILE_TextCallback cb, void *cookie);
+
+/*
+ * Callback function type for SEARCH_Query function, called once for every
+ * matching page, in file order.
+ */
+typedef void (*SEARCH_Callback)(HLPFILE_PAGE *page, void *cookie);
+
+enum search_state
+{
+    SEARCH_READY,       /* the index can be queried */
+    SEARCH_PENDING,     /* pages are left to index */
+    SEARCH_FAILED
+};
+
+enum search_state SEARCH_BuildIndex(HLPFILE* hlpfile, DWORD timeout);
+BOOL          SEARCH_Query(HLPFILE* hlpfile, LPCWSTR query, SEARCH_Callback cb, void *cookie);
+void          SEARCH_FreeIndex(HLPFILE* hlpfile);
 
 #define HLP_DISPLAY30 0x01     /* version 3.0 displayable information */
 #define HLP_TOPICHDR  0x02     /* topic header information */
@@ -19,6 +19,9 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#ifndef __WINE_MACRO_H
+#define __WINE_MACRO_H
+
 #include <stdarg.h>
 
 #include "windef.h"
@@ -59,6 +62,8 @@ void CALLBACK MACRO_Print(void);
 void CALLBACK MACRO_PrinterSetup(void);
 void CALLBACK MACRO_SetContents(LPCSTR, LONG);
 
+#endif /* __WINE_MACRO_H */
+
 /* Local Variables:    */
 /* c-file-style: "GNU" */
 /* End:                */
@@ -0,0 +1,598 @@
+/*
+ * Help Viewer - macro compiler and interpreter
+ *
+ * Copyright 1996 Ulrich Schmid
+ * Copyright 2002,2008 Eric Pouech
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Macro strings are compiled once into a small stack based program:
+ * arguments are pushed in order, then a call pops them (and pushes the
+ * result for bool functions). Programs are cached by their source string.
+ * Strings which cannot be compiled (unknown routines, syntax errors...)
+ * are run through MACRO_InterpretTokens, which keeps its error semantics.
+ *
+ * Nothing here reads the macro text, so macro.lex.l tokenizes it and
+ * keeps track of the window the macro runs in.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "macrocomp.h"
+
+#ifdef _DEBUG
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(winhelp);
+#else
+#define WINE_TRACE(...)
+#define WINE_WARN(...)
+#define WINE_FIXME(...)
+#define WINE_ERR(...)
+#define debugstr_a(...)
+#endif
+
+static struct macro_program* macro_cache[MACRO_CACHE_SIZE];
+
+/* small helper function for debug messages */
+static const char* ts(int t)
+{
+    static char c[2] = {0,0};
+
+    switch (t)
+    {
+    case EMPTY: return "EMPTY";
+    case VOID_FUNCTION: return "VOID_FUNCTION";
+    case BOOL_FUNCTION: return "BOOL_FUNCTION";
+    case INTEGER: return "INTEGER";
+    case STRING: return "STRING";
+    case IDENTIFIER: return "IDENTIFIER";
+    default: c[0] = (char)t; return c;
+    }
+}
+
+static int MACRO_CallBoolFunc(macro_lexer lex, void *fn, const char* args, void** ret);
+
+/******************************************************************
+ *		MACRO_InvokeBoolFunc
+ *
+ * Calls boolean function fn with nargs parameters from pa
+ * stores bool result into ret
+ */
+static void MACRO_InvokeBoolFunc(void *fn, unsigned nargs, void* pa[], void** ret)
+{
+    switch (nargs)
+    {
+    case 0:
+    {
+        BOOL (WINAPI *func)(void) = fn;
+        *ret = (void *)(ULONG_PTR)func();
+        break;
+    }
+    case 1:
+    {
+        BOOL (WINAPI *func)(void *) = fn;
+        *ret = (void *)(ULONG_PTR)func( pa[0]);
+        break;
+    }
+    default: WINE_FIXME("NIY\n");
+    }
+}
+
+/******************************************************************
+ *		MACRO_InvokeVoidFunc
+ *
+ * Calls void function fn with nargs parameters from pa
+ */
+static void MACRO_InvokeVoidFunc(void *fn, unsigned nargs, void* pa[])
+{
+    switch (nargs)
+    {
+    case 0:
+    {
+        void (WINAPI *func)(void) = fn;
+        func();
+        break;
+    }
+    case 1:
+    {
+        void (WINAPI *func)(void*) = fn;
+        func( pa[0] );
+        break;
+    }
+    case 2:
+    {
+        void (WINAPI *func)(void*,void*) = fn;
+        func( pa[0], pa[1] );
+        break;
+    }
+    case 3:
+    {
+        void (WINAPI *func)(void*,void*,void*) = fn;
+        func( pa[0], pa[1], pa[2] );
+        break;
+    }
+    case 4:
+    {
+        void (WINAPI *func)(void*,void*,void*,void*) = fn;
+        func( pa[0], pa[1], pa[2], pa[3] );
+        break;
+    }
+    case 5:
+    {
+        void (WINAPI *func)(void*,void*,void*,void*,void*) = fn;
+        func( pa[0], pa[1], pa[2], pa[3], pa[4] );
+        break;
+    }
+    case 6:
+    {
+        void (WINAPI *func)(void*,void*,void*,void*,void*,void*) = fn;
+        func( pa[0], pa[1], pa[2], pa[3], pa[4], pa[5] );
+        break;
+    }
+    default: WINE_FIXME("NIY\n");
+    }
+}
+
+/******************************************************************
+ *		MACRO_CheckArgs
+ *
+ * checks number of arguments against prototype, and stores arguments on
+ * stack pa for later call
+ * returns -1 on error, otherwise the number of pushed parameters
+ */
+static int MACRO_CheckArgs(macro_lexer lex, void* pa[], unsigned max, const char* args)
+{
+    struct lexret lr;
+    LPCSTR text;
+    int t;
+    unsigned int len = 0, idx = 0;
+
+    WINE_TRACE("Checking %s\n", debugstr_a(args));
+
+    if (lex(&lr, &text) != '(') {WINE_WARN("missing (\n");return -1;}
+
+    if (*args)
+    {
+        len = strlen(args);
+        for (;;)
+        {
+            t = lex(&lr, &text);
+            WINE_TRACE("Got %s <=> %c\n", debugstr_a(ts(t)), *args);
+
+            switch (*args)
+            {
+            case 'S':
+                if (t != STRING)
+                {WINE_WARN("missing S\n");return -1;}
+                pa[idx] = (void*)lr.string;
+                break;
+            case 'U':
+            case 'I':
+                if (t != INTEGER)
+                {WINE_WARN("missing U\n");return -1;}
+                pa[idx] = LongToPtr(lr.integer);
+                break;
+            case 'B':
+                if (t != BOOL_FUNCTION)
+                {WINE_WARN("missing B\n");return -1;}
+                if (MACRO_CallBoolFunc(lex, lr.function, lr.proto, &pa[idx]) == 0)
+                    return -1;
+                break;
+            default:
+                WINE_WARN("unexpected %s while args is %c\n", debugstr_a(ts(t)), *args);
+                return -1;
+            }
+            idx++;
+            if (*++args == '\0') break;
+            t = lex(&lr, &text);
+            if (t == ')') goto CheckArgs_end;
+            if (t != ',') {WINE_WARN("missing ,\n");return -1;}
+            if (idx >= max) {WINE_FIXME("stack overflow (%d)\n", max);return -1;}
+        }
+    }
+    if (lex(&lr, &text) != ')') {WINE_WARN("missing )\n");return -1;}
+
+CheckArgs_end:
+    while (len > idx) pa[--len] = NULL;
+    return idx;
+}
+
+/******************************************************************
+ *		MACRO_CallBoolFunc
+ *
+ * Invokes boolean function fn, which arguments are defined by args
+ * stores bool result into ret
+ */
+static int MACRO_CallBoolFunc(macro_lexer lex, void *fn, const char* args, void** ret)
+{
+    void*       pa[2];
+    int         idx = MACRO_CheckArgs(lex, pa, ARRAY_SIZE(pa), args);
+
+    if (idx < 0) return 0;
+    if (!fn)     return 1;
+
+    WINE_TRACE("calling with %u pmts\n", idx);
+
+    MACRO_InvokeBoolFunc(fn, strlen(args), pa, ret);
+    return 1;
+}
+
+/******************************************************************
+ *		MACRO_CallVoidFunc
+ *
+ *
+ */
+static int MACRO_CallVoidFunc(macro_lexer lex, void *fn, const char* args)
+{
+    void*       pa[6];
+    int         idx = MACRO_CheckArgs(lex, pa, ARRAY_SIZE(pa), args);
+
+    if (idx < 0) return 0;
+    if (!fn)     return 1;
+
+    WINE_TRACE("calling %p with %u pmts\n", fn, idx);
+
+    MACRO_InvokeVoidFunc(fn, strlen(args), pa);
+    return 1;
+}
+
+/******************************************************************
+ *		MACRO_InterpretTokens
+ *
+ * Runs the macro read from lex, calling each function as soon as it
+ * is parsed
+ */
+BOOL MACRO_InterpretTokens(macro_lexer lex)
+{
+    struct lexret lr;
+    LPCSTR text;
+    int t;
+
+    while ((t = lex(&lr, &text)) != EMPTY)
+    {
+        switch (t)
+        {
+        case VOID_FUNCTION:
+            WINE_TRACE("got type void func(%s)\n", debugstr_a(lr.proto));
+            MACRO_CallVoidFunc(lex, lr.function, lr.proto);
+            break;
+        case BOOL_FUNCTION:
+            WINE_WARN("got type bool func(%s)\n", debugstr_a(lr.proto));
+            break;
+        default:
+            WINE_WARN("got unexpected type %s\n", debugstr_a(ts(t)));
+            return FALSE;
+        }
+        switch (t = lex(&lr, &text))
+        {
+        case EMPTY:     return TRUE;
+        case ';':       break;
+        default:        return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**************************************************/
+/*               Compiled macros                  */
+/**************************************************/
+
+static unsigned MACRO_HashString(LPCSTR str)
+{
+    unsigned hash = 2166136261u;
+
+    while (*str) hash = (hash ^ (BYTE)*str++) * 16777619u;
+    return hash;
+}
+
+static LPSTR MACRO_StrDup(LPCSTR str)
+{
+    LPSTR dst = HeapAlloc(GetProcessHeap(), 0, strlen(str) + 1);
+
+    if (dst) strcpy(dst, str);
+    return dst;
+}
+
+void MACRO_FreeProgram(struct macro_program* prog)
+{
+    unsigned i;
+
+    for (i = 0; i < prog->num_ops; i++)
+    {
+        switch (prog->ops[i].opcode)
+        {
+        case MOP_STRING:
+        case MOP_VARIABLE:
+            HeapFree(GetProcessHeap(), 0, prog->ops[i].u.string);
+            break;
+        case MOP_CALL_VOID:
+        case MOP_CALL_BOOL:
+            HeapFree(GetProcessHeap(), 0, prog->ops[i].u.call.name);
+            break;
+        default:
+            break;
+        }
+    }
+    HeapFree(GetProcessHeap(), 0, prog->ops);
+    HeapFree(GetProcessHeap(), 0, prog->source);
+    HeapFree(GetProcessHeap(), 0, prog);
+}
+
+static struct macro_op* MACRO_AddOp(struct macro_program* prog, enum macro_opcode opcode)
+{
+    struct macro_op* op;
+
+    if (prog->num_ops >= prog->max_ops)
+    {
+        unsigned max = prog->max_ops ? prog->max_ops * 2 : 8;
+
+        if (prog->ops)
+            op = HeapReAlloc(GetProcessHeap(), 0, prog->ops, max * sizeof(*op));
+        else
+            op = HeapAlloc(GetProcessHeap(), 0, max * sizeof(*op));
+        if (!op) return NULL;
+        prog->ops = op;
+        prog->max_ops = max;
+    }
+    op = &prog->ops[prog->num_ops++];
+    memset(op, 0, sizeof(*op));
+    op->opcode = opcode;
+    return op;
+}
+
+static BOOL MACRO_CompilePush(struct macro_program* prog, enum macro_opcode opcode, LONG integer, LPCSTR string)
+{
+    struct macro_op* op;
+
+    if (prog->depth >= MACRO_STACK_SIZE) {WINE_FIXME("stack overflow\n");return FALSE;}
+    if (!(op = MACRO_AddOp(prog, opcode))) return FALSE;
+    if (opcode == MOP_INTEGER) op->u.integer = integer;
+    else if (!(op->u.string = MACRO_StrDup(string))) {prog->num_ops--;return FALSE;}
+    prog->depth++;
+    return TRUE;
+}
+
+/******************************************************************
+ *		MACRO_CompileValue
+ *
+ * compiles the INTEGER or STRING token t just returned by the lexer
+ * keywords (hwndApp, qchPath...) are evaluated each time the macro runs
+ */
+static BOOL MACRO_CompileValue(struct macro_program* prog, int t, const struct lexret* lr, LPCSTR text)
+{
+    if (isalpha((unsigned char)text[0]))
+        return MACRO_CompilePush(prog, MOP_VARIABLE, 0, text);
+    if (t == STRING)
+        return MACRO_CompilePush(prog, MOP_STRING, 0, lr->string);
+    return MACRO_CompilePush(prog, MOP_INTEGER, lr->integer, NULL);
+}
+
+/******************************************************************
+ *		MACRO_CompileCall
+ *
+ * compiles the call of the function token t just returned by the lexer,
+ * with the same argument checking as MACRO_CheckArgs
+ */
+static BOOL MACRO_CompileCall(struct macro_program* prog, macro_lexer lex, int t,
+                              const struct lexret* func, LPCSTR text)
+{
+    struct macro_op*    op;
+    struct lexret       lr;
+    LPSTR               name;
+    LPCSTR              proto = func->proto;
+    void*               function = func->function;
+    BOOL                is_bool = (t == BOOL_FUNCTION);
+    const char*         args = proto;
+    unsigned            len = strlen(proto), idx = 0;
+
+    if (len > (is_bool ? 1 : 6)) return FALSE;
+    if (is_bool && prog->depth >= MACRO_STACK_SIZE) return FALSE;
+    if (!(name = MACRO_StrDup(text))) return FALSE;
+
+    if (lex(&lr, &text) != '(') goto error;
+    if (*args)
+    {
+        for (;;)
+        {
+            t = lex(&lr, &text);
+            switch (*args)
+            {
+            case 'S':
+                if (t != STRING || !MACRO_CompileValue(prog, t, &lr, text)) goto error;
+                break;
+            case 'U':
+            case 'I':
+                if (t != INTEGER || !MACRO_CompileValue(prog, t, &lr, text)) goto error;
+                break;
+            case 'B':
+                if (t != BOOL_FUNCTION || !MACRO_CompileCall(prog, lex, t, &lr, text)) goto error;
+                break;
+            default:
+                goto error;
+            }
+            idx++;
+            if (*++args == '\0') break;
+            t = lex(&lr, &text);
+            if (t == ')') goto args_end;
+            if (t != ',') goto error;
+        }
+    }
+    if (lex(&lr, &text) != ')') goto error;
+
+args_end:
+    for (; idx < len; idx++)
+        if (!MACRO_CompilePush(prog, MOP_INTEGER, 0, NULL)) goto error;
+    if (!(op = MACRO_AddOp(prog, is_bool ? MOP_CALL_BOOL : MOP_CALL_VOID))) goto error;
+    op->u.call.name = name;
+    op->u.call.proto = proto;
+    op->u.call.function = function;
+    prog->depth -= len;
+    if (is_bool) prog->depth++;
+    return TRUE;
+
+error:
+    WINE_TRACE("cannot compile call to %s\n", debugstr_a(name));
+    HeapFree(GetProcessHeap(), 0, name);
+    return FALSE;
+}
+
+/******************************************************************
+ *		MACRO_CompileTokens
+ *
+ * compiles the macro read from lex, returns NULL if it cannot be compiled
+ */
+struct macro_program* MACRO_CompileTokens(LPCSTR macro, macro_lexer lex)
+{
+    struct macro_program* prog;
+    struct lexret lr;
+    LPCSTR text;
+    int t;
+
+    if (!(prog = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*prog)))) return NULL;
+    if (!(prog->source = MACRO_StrDup(macro)))
+    {
+        HeapFree(GetProcessHeap(), 0, prog);
+        return NULL;
+    }
+
+    while ((t = lex(&lr, &text)) != EMPTY)
+    {
+        if (t != VOID_FUNCTION || !MACRO_CompileCall(prog, lex, t, &lr, text)) goto error;
+        switch (t = lex(&lr, &text))
+        {
+        case EMPTY:     return prog;
+        case ';':       break;
+        default:        goto error;
+        }
+    }
+    return prog;
+
+error:
+    WINE_TRACE("interpreting %s\n", debugstr_a(macro));
+    MACRO_FreeProgram(prog);
+    return NULL;
+}
+
+/******************************************************************
+ *		MACRO_BindFunction
+ *
+ * looks up a routine which had no address when its call was compiled
+ */
+static void* MACRO_BindFunction(struct macro_op* op)
+{
+    struct lexret   lr;
+    int             t = MACRO_Lookup(op->u.call.name, &lr);
+
+    /* the first lookup of a routine from a DLL only loads it */
+    if ((t == VOID_FUNCTION || t == BOOL_FUNCTION) && !lr.function)
+        t = MACRO_Lookup(op->u.call.name, &lr);
+    if (t != VOID_FUNCTION && t != BOOL_FUNCTION) return NULL;
+    return op->u.call.function = lr.function;
+}
+
+/******************************************************************
+ *		MACRO_RunProgram
+ *
+ * runs a compiled macro
+ */
+BOOL MACRO_RunProgram(struct macro_program* prog)
+{
+    void*               stack[MACRO_STACK_SIZE];
+    unsigned            sp = 0, i, nargs;
+    struct macro_op*    op;
+    struct lexret       lr;
+    void*               fn;
+    BOOL                ret = TRUE;
+
+    prog->busy++;
+    for (i = 0; i < prog->num_ops; i++)
+    {
+        op = &prog->ops[i];
+        switch (op->opcode)
+        {
+        case MOP_INTEGER:
+            stack[sp++] = LongToPtr(op->u.integer);
+            break;
+        case MOP_STRING:
+            stack[sp++] = op->u.string;
+            break;
+        case MOP_VARIABLE:
+            switch (MACRO_Lookup(op->u.string, &lr))
+            {
+            case INTEGER:   stack[sp++] = LongToPtr(lr.integer); break;
+            case STRING:    stack[sp++] = (void*)lr.string; break;
+            default:
+                WINE_WARN("cannot evaluate %s\n", debugstr_a(op->u.string));
+                ret = FALSE;
+                goto done;
+            }
+            break;
+        case MOP_CALL_VOID:
+        case MOP_CALL_BOOL:
+            nargs = strlen(op->u.call.proto);
+            sp -= nargs;
+            if (!(fn = op->u.call.function)) fn = MACRO_BindFunction(op);
+            WINE_TRACE("calling %s (%p) with %u pmts\n", debugstr_a(op->u.call.name), fn, nargs);
+            if (op->opcode == MOP_CALL_BOOL)
+            {
+                void* result = NULL;
+                if (fn) MACRO_InvokeBoolFunc(fn, nargs, &stack[sp], &result);
+                stack[sp++] = result;
+            }
+            else if (fn) MACRO_InvokeVoidFunc(fn, nargs, &stack[sp]);
+            break;
+        }
+    }
+done:
+    prog->busy--;
+    return ret;
+}
+
+/******************************************************************
+ *		MACRO_FindProgram
+ *
+ * returns the cached compiled form of macro, NULL if there is none
+ */
+struct macro_program* MACRO_FindProgram(LPCSTR macro)
+{
+    struct macro_program*   prog = macro_cache[MACRO_HashString(macro) & (MACRO_CACHE_SIZE - 1)];
+
+    if (prog && !strcmp(prog->source, macro)) return prog;
+    return NULL;
+}
+
+/******************************************************************
+ *		MACRO_CacheProgram
+ *
+ * stores a newly compiled program in the cache
+ * returns FALSE if the caller still owns the program
+ */
+BOOL MACRO_CacheProgram(struct macro_program* prog)
+{
+    struct macro_program**  slot = &macro_cache[MACRO_HashString(prog->source) & (MACRO_CACHE_SIZE - 1)];
+
+    /* don't evict a program which is still running */
+    if (*slot && (*slot)->busy) return FALSE;
+    if (*slot) MACRO_FreeProgram(*slot);
+    *slot = prog;
+    return TRUE;
+}
@@ -0,0 +1,64 @@
+/*
+ * Help Viewer - macro compiler and interpreter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_MACROCOMP_H
+#define __WINE_MACROCOMP_H
+
+#include "macro.h"
+
+/* returns the next token of the macro being parsed, with its value in
+ * *lr and its text in *text (both valid until the next call)
+ */
+typedef int (*macro_lexer)(struct lexret* lr, LPCSTR* text);
+
+enum macro_opcode {MOP_INTEGER, MOP_STRING, MOP_VARIABLE, MOP_CALL_VOID, MOP_CALL_BOOL};
+
+struct macro_op {
+    enum macro_opcode   opcode;
+    union {
+        LONG            integer;        /* MOP_INTEGER */
+        LPSTR           string;         /* MOP_STRING, MOP_VARIABLE (name) */
+        struct {
+            LPSTR       name;
+            LPCSTR      proto;
+            void*       function;
+        } call;                         /* MOP_CALL_VOID, MOP_CALL_BOOL */
+    } u;
+};
+
+#define MACRO_STACK_SIZE 16
+
+struct macro_program {
+    LPSTR               source;
+    unsigned            busy;           /* number of running instances */
+    unsigned            num_ops;
+    unsigned            max_ops;
+    unsigned            depth;          /* stack depth while compiling */
+    struct macro_op*    ops;
+};
+
+#define MACRO_CACHE_SIZE 64             /* must be a power of 2 */
+
+BOOL                    MACRO_InterpretTokens(macro_lexer lex);
+struct macro_program*   MACRO_CompileTokens(LPCSTR macro, macro_lexer lex);
+BOOL                    MACRO_RunProgram(struct macro_program* prog);
+void                    MACRO_FreeProgram(struct macro_program* prog);
+struct macro_program*   MACRO_FindProgram(LPCSTR macro);
+BOOL                    MACRO_CacheProgram(struct macro_program* prog);
+
+#endif /* __WINE_MACROCOMP_H */
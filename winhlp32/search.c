@@ -0,0 +1,671 @@
+/*
+ * Help Viewer - full text search
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "windows.h"
+#include "windef.h"
+#include "winbase.h"
+#include "winuser.h"
+#include "winhelp.h"
+
+#ifdef _DEBUG
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(winhelp);
+#else
+#define WINE_TRACE(...)
+#define WINE_WARN(...)
+#define WINE_FIXME(...)
+#define WINE_ERR(...)
+#define debugstr_a(...)
+#endif
+
+/* The index is a sorted word table with a list of page ordinals per word.
+ * It is laid out as a single block so that it can be written as is to a
+ * cache file in the temp directory and mapped back the next time the same
+ * help file (same size and contents hash) is searched:
+ *
+ *      struct search_header
+ *      DWORD   word_text[num_words]        offset of each word in text[]
+ *      DWORD   word_refs[num_words + 1]    first entry in refs[] of each word
+ *      DWORD   refs[num_refs]              page ordinals, ascending per word
+ *      WCHAR   text[text_size]             NUL terminated, lower case words
+ */
+#define SEARCH_MAGIC    0x54464857      /* "WHFT" */
+#define SEARCH_VERSION  1
+#define SEARCH_MAX_WORD 32
+
+struct search_header
+{
+    DWORD       magic;
+    DWORD       version;
+    DWORD       file_size;
+    DWORD       file_hash;
+    DWORD       num_pages;
+    DWORD       num_words;
+    DWORD       num_refs;
+    DWORD       text_size;
+};
+
+struct search_index
+{
+    const struct search_header* header;
+    const DWORD*        word_text;
+    const DWORD*        word_refs;
+    const DWORD*        refs;
+    const WCHAR*        text;
+    HLPFILE_PAGE**      pages;
+    HANDLE              mapping;        /* NULL when the index lives in the heap */
+    struct search_header key;           /* identifies the help file, header until the index is built */
+    struct search_builder* builder;     /* pages indexed so far while the index is being built */
+    char                path[MAX_PATH]; /* cache file, empty if there is none */
+};
+
+struct search_word
+{
+    DWORD       text;           /* offset in the builder's text pool */
+    DWORD       last_page;      /* last page ordinal + 1 the word was seen in */
+    DWORD       count;          /* number of pages the word appears in */
+};
+
+struct search_builder
+{
+    HLPFILE*            hlpfile;
+    DWORD               page;
+    struct search_word* words;
+    DWORD*              hash;           /* word index + 1, 0 for a free slot */
+    DWORD               hash_size;
+    DWORD               num_words;
+    DWORD               words_alloc;
+    WCHAR*              pool;
+    DWORD               pool_size;
+    DWORD               pool_alloc;
+    DWORD*              pairs;          /* (word index, page ordinal) pairs */
+    DWORD               num_pairs;
+    DWORD               pairs_alloc;
+    BOOL                failed;
+};
+
+struct search_sort
+{
+    const WCHAR*        text;
+    DWORD               word;
+};
+
+static DWORD SEARCH_HashWord(const WCHAR* word, unsigned len)
+{
+    DWORD       h = 2166136261u;
+
+    while (len--) h = (h ^ *word++) * 16777619u;
+    return h;
+}
+
+static BOOL SEARCH_Grow(void** ptr, DWORD* alloc, DWORD needed, DWORD elem)
+{
+    DWORD       size = *alloc ? *alloc : 1024;
+    void*       mem;
+
+    if (needed <= *alloc) return TRUE;
+    while (size < needed) size *= 2;
+    mem = *ptr ? HeapReAlloc(GetProcessHeap(), 0, *ptr, size * elem)
+               : HeapAlloc(GetProcessHeap(), 0, size * elem);
+    if (!mem) return FALSE;
+    *ptr = mem;
+    *alloc = size;
+    return TRUE;
+}
+
+static BOOL SEARCH_Rehash(struct search_builder* sb)
+{
+    DWORD       size = sb->hash_size ? sb->hash_size * 2 : 4096;
+    DWORD*      hash;
+    DWORD       i, h;
+
+    hash = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(DWORD));
+    if (!hash) return FALSE;
+    for (i = 0; i < sb->num_words; i++)
+    {
+        const WCHAR* word = sb->pool + sb->words[i].text;
+
+        h = SEARCH_HashWord(word, lstrlenW(word)) & (size - 1);
+        while (hash[h]) h = (h + 1) & (size - 1);
+        hash[h] = i + 1;
+    }
+    HeapFree(GetProcessHeap(), 0, sb->hash);
+    sb->hash = hash;
+    sb->hash_size = size;
+    return TRUE;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_AddWord
+ *
+ * Records that the (lower cased) word appears in the current page.
+ */
+static void SEARCH_AddWord(struct search_builder* sb, const WCHAR* word, unsigned len)
+{
+    DWORD       h, idx;
+
+    if (sb->failed) return;
+    if (sb->num_words * 2 >= sb->hash_size && !SEARCH_Rehash(sb)) goto fail;
+
+    h = SEARCH_HashWord(word, len) & (sb->hash_size - 1);
+    while ((idx = sb->hash[h]))
+    {
+        const WCHAR* w = sb->pool + sb->words[idx - 1].text;
+        if (!memcmp(w, word, len * sizeof(WCHAR)) && !w[len]) break;
+        h = (h + 1) & (sb->hash_size - 1);
+    }
+    if (!idx)
+    {
+        if (!SEARCH_Grow((void**)&sb->words, &sb->words_alloc, sb->num_words + 1, sizeof(*sb->words)))
+            goto fail;
+        if (!SEARCH_Grow((void**)&sb->pool, &sb->pool_alloc, sb->pool_size + len + 1, sizeof(WCHAR)))
+            goto fail;
+        memcpy(sb->pool + sb->pool_size, word, len * sizeof(WCHAR));
+        sb->pool[sb->pool_size + len] = 0;
+        sb->words[sb->num_words].text = sb->pool_size;
+        sb->words[sb->num_words].last_page = 0;
+        sb->words[sb->num_words].count = 0;
+        sb->pool_size += len + 1;
+        sb->hash[h] = idx = ++sb->num_words;
+    }
+    idx--;
+    if (sb->words[idx].last_page == sb->page + 1) return;
+    if (!SEARCH_Grow((void**)&sb->pairs, &sb->pairs_alloc, sb->num_pairs + 1, sizeof(DWORD) * 2))
+        goto fail;
+    sb->pairs[sb->num_pairs * 2] = idx;
+    sb->pairs[sb->num_pairs * 2 + 1] = sb->page;
+    sb->num_pairs++;
+    sb->words[idx].last_page = sb->page + 1;
+    sb->words[idx].count++;
+    return;
+fail:
+    sb->failed = TRUE;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_Tokenize
+ *
+ * Splits a string in words made of alphanumeric characters, lower cases
+ * them and passes them to cb. Words are truncated to SEARCH_MAX_WORD
+ * characters.
+ */
+static void SEARCH_Tokenize(const WCHAR* str, unsigned len,
+                            void (*cb)(void*, const WCHAR*, unsigned), void* cookie)
+{
+    WCHAR       word[SEARCH_MAX_WORD];
+    unsigned    i, wlen = 0;
+
+    for (i = 0; i <= len; i++)
+    {
+        if (i < len && IsCharAlphaNumericW(str[i]))
+        {
+            if (wlen < SEARCH_MAX_WORD) word[wlen++] = str[i];
+            continue;
+        }
+        if (wlen)
+        {
+            CharLowerBuffW(word, wlen);
+            cb(cookie, word, wlen);
+            wlen = 0;
+        }
+    }
+}
+
+static void SEARCH_AddWordCB(void* cookie, const WCHAR* word, unsigned len)
+{
+    SEARCH_AddWord(cookie, word, len);
+}
+
+static void SEARCH_AddText(void* cookie, const char* text, LONG len)
+{
+    struct search_builder* sb = cookie;
+    WCHAR*      textW;
+    int         lenW;
+
+    if (sb->failed || len <= 0) return;
+    textW = HeapAlloc(GetProcessHeap(), 0, len * sizeof(WCHAR));
+    if (!textW) {sb->failed = TRUE; return;}
+    lenW = MultiByteToWideChar(sb->hlpfile->codepage, 0, text, len, textW, len);
+    SEARCH_Tokenize(textW, lenW, SEARCH_AddWordCB, sb);
+    HeapFree(GetProcessHeap(), 0, textW);
+}
+
+static int SEARCH_CompareWords(const void* a, const void* b)
+{
+    return wcscmp(((const struct search_sort*)a)->text, ((const struct search_sort*)b)->text);
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_Setup
+ *
+ * Sets the table pointers of an index from its header. Returns FALSE if
+ * the block is too small for the tables it claims to hold, or if an
+ * offset in them points outside of its table: a cache file is no more
+ * trusted than the help file itself.
+ */
+static BOOL SEARCH_Setup(struct search_index* si, const void* base, DWORD size)
+{
+    const struct search_header* hdr = base;
+    const DWORD* word_text;
+    const DWORD* word_refs;
+    const DWORD* refs;
+    const WCHAR* text;
+    ULONGLONG   needed;
+    DWORD       i;
+
+    if (size < sizeof(*hdr)) return FALSE;
+    needed = sizeof(*hdr) + ((ULONGLONG)hdr->num_words * 2 + 1 + hdr->num_refs) * sizeof(DWORD) +
+        (ULONGLONG)hdr->text_size * sizeof(WCHAR);
+    if (needed > size) return FALSE;
+
+    word_text = (const DWORD*)(hdr + 1);
+    word_refs = word_text + hdr->num_words;
+    refs = word_refs + hdr->num_words + 1;
+    text = (const WCHAR*)(refs + hdr->num_refs);
+
+    /* words are looked up with wcscmp, the last one must be terminated */
+    if (hdr->text_size && text[hdr->text_size - 1]) return FALSE;
+    if (word_refs[0] || word_refs[hdr->num_words] != hdr->num_refs) return FALSE;
+    for (i = 0; i < hdr->num_words; i++)
+    {
+        if (word_text[i] >= hdr->text_size) return FALSE;
+        if (word_refs[i] > word_refs[i + 1]) return FALSE;
+    }
+    for (i = 0; i < hdr->num_refs; i++)
+        if (refs[i] >= hdr->num_pages) return FALSE;
+
+    si->header = hdr;
+    si->word_text = word_text;
+    si->word_refs = word_refs;
+    si->refs = refs;
+    si->text = text;
+    return TRUE;
+}
+
+static void SEARCH_FreeBuilder(struct search_builder* sb)
+{
+    HeapFree(GetProcessHeap(), 0, sb->words);
+    HeapFree(GetProcessHeap(), 0, sb->hash);
+    HeapFree(GetProcessHeap(), 0, sb->pool);
+    HeapFree(GetProcessHeap(), 0, sb->pairs);
+    HeapFree(GetProcessHeap(), 0, sb);
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_AddPages
+ *
+ * Indexes the next pages of the file, until all are done or timeout ms
+ * have passed. At least one page is indexed by each call.
+ */
+static void SEARCH_AddPages(struct search_index* si, DWORD timeout)
+{
+    struct search_builder*      sb = si->builder;
+    DWORD                       start = GetTickCount();
+
+    do
+    {
+        HLPFILE_PAGE* page = si->pages[sb->page];
+
+        SEARCH_Tokenize(page->lpszTitle, lstrlenW(page->lpszTitle), SEARCH_AddWordCB, sb);
+        if (!HLPFILE_EnumPageText(page, SEARCH_AddText, sb))
+            WINE_WARN("couldn't index page %u\n", sb->page);
+        sb->page++;
+    } while (sb->page < si->key.num_pages && !sb->failed &&
+             (timeout == INFINITE || GetTickCount() - start < timeout));
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_Build
+ *
+ * Returns the index of the pages the builder went through as one heap
+ * block.
+ */
+static struct search_header* SEARCH_Build(struct search_index* si, DWORD* psize)
+{
+    struct search_builder       sb = *si->builder;
+    struct search_header*       hdr = NULL;
+    struct search_sort*         sorted = NULL;
+    DWORD*                      rank = NULL;
+    DWORD*                      word_text;
+    DWORD*                      word_refs;
+    DWORD*                      refs;
+    WCHAR*                      text;
+    DWORD                       i, pos, size;
+
+    if (sb.failed) return NULL;
+
+    sorted = HeapAlloc(GetProcessHeap(), 0, (sb.num_words + 1) * sizeof(*sorted));
+    rank = HeapAlloc(GetProcessHeap(), 0, (sb.num_words + 1) * sizeof(DWORD));
+    if (!sorted || !rank) goto done;
+    for (i = 0; i < sb.num_words; i++)
+    {
+        sorted[i].text = sb.pool + sb.words[i].text;
+        sorted[i].word = i;
+    }
+    qsort(sorted, sb.num_words, sizeof(*sorted), SEARCH_CompareWords);
+
+    size = sizeof(*hdr) + (sb.num_words * 2 + 1 + sb.num_pairs) * sizeof(DWORD) + sb.pool_size * sizeof(WCHAR);
+    hdr = HeapAlloc(GetProcessHeap(), 0, size);
+    if (!hdr) goto done;
+    hdr->magic = SEARCH_MAGIC;
+    hdr->version = SEARCH_VERSION;
+    hdr->file_size = si->key.file_size;
+    hdr->file_hash = si->key.file_hash;
+    hdr->num_pages = si->key.num_pages;
+    hdr->num_words = sb.num_words;
+    hdr->num_refs = sb.num_pairs;
+    hdr->text_size = sb.pool_size;
+    word_text = (DWORD*)(hdr + 1);
+    word_refs = word_text + sb.num_words;
+    refs = word_refs + sb.num_words + 1;
+    text = (WCHAR*)(refs + sb.num_pairs);
+
+    /* the pairs were recorded in page order, so distributing them in sorted
+     * word order leaves each word's page list sorted */
+    for (i = pos = 0; i < sb.num_words; i++)
+    {
+        DWORD len = lstrlenW(sorted[i].text) + 1;
+
+        rank[sorted[i].word] = i;
+        word_text[i] = pos;
+        memcpy(text + pos, sorted[i].text, len * sizeof(WCHAR));
+        pos += len;
+    }
+    for (i = pos = 0; i < sb.num_words; i++)
+    {
+        word_refs[i] = pos;
+        pos += sb.words[sorted[i].word].count;
+    }
+    word_refs[sb.num_words] = pos;
+    for (i = 0; i < sb.num_pairs; i++)
+        refs[word_refs[rank[sb.pairs[i * 2]]]++] = sb.pairs[i * 2 + 1];
+    for (i = sb.num_words; i > 0; i--)
+        word_refs[i] = word_refs[i - 1];
+    word_refs[0] = 0;
+    *psize = size;
+
+done:
+    HeapFree(GetProcessHeap(), 0, sorted);
+    HeapFree(GetProcessHeap(), 0, rank);
+    return hdr;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_MapCache
+ *
+ * Maps a cache file and checks it matches the help file.
+ */
+static BOOL SEARCH_MapCache(struct search_index* si, const char* path, const struct search_header* key)
+{
+    HANDLE      hFile, mapping;
+    const struct search_header* hdr;
+    DWORD       size;
+
+    hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+    size = GetFileSize(hFile, NULL);
+    mapping = size >= sizeof(*hdr) && size != INVALID_FILE_SIZE
+        ? CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    CloseHandle(hFile);
+    if (!mapping) return FALSE;
+
+    hdr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (hdr && hdr->magic == SEARCH_MAGIC && hdr->version == SEARCH_VERSION &&
+        hdr->file_size == key->file_size && hdr->file_hash == key->file_hash &&
+        hdr->num_pages == key->num_pages && SEARCH_Setup(si, hdr, size))
+    {
+        si->mapping = mapping;
+        return TRUE;
+    }
+    WINE_WARN("stale search index %s\n", debugstr_a(path));
+    if (hdr) UnmapViewOfFile(hdr);
+    CloseHandle(mapping);
+    return FALSE;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_StartIndex
+ *
+ * Loads the index of a help file from its cache, or sets up the builder
+ * when there is no usable cache file.
+ */
+static BOOL SEARCH_StartIndex(HLPFILE* hlpfile)
+{
+    struct search_index*        si;
+    HLPFILE_PAGE*               page;
+    DWORD                       i;
+
+    si = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*si));
+    if (!si) return FALSE;
+    si->key.file_size = hlpfile->file_buffer_size;
+    si->key.file_hash = 2166136261u;
+    for (i = 0; i < hlpfile->file_buffer_size; i++)
+        si->key.file_hash = (si->key.file_hash ^ hlpfile->file_buffer[i]) * 16777619u;
+    for (page = hlpfile->first_page; page; page = page->next) si->key.num_pages++;
+    si->header = &si->key;
+
+    si->pages = HeapAlloc(GetProcessHeap(), 0, (si->key.num_pages + 1) * sizeof(HLPFILE_PAGE*));
+    if (!si->pages)
+    {
+        HeapFree(GetProcessHeap(), 0, si);
+        return FALSE;
+    }
+    for (i = 0, page = hlpfile->first_page; page; page = page->next) si->pages[i++] = page;
+    hlpfile->search = si;
+
+    i = GetTempPathA(MAX_PATH - 32, si->path);
+    if (i && i < MAX_PATH - 32)
+    {
+        sprintf(si->path + i, "whfts%08x%08x.idx", si->key.file_hash, si->key.file_size);
+        if (SEARCH_MapCache(si, si->path, &si->key)) return TRUE;
+    }
+    else
+        si->path[0] = 0;
+
+    si->builder = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*si->builder));
+    if (!si->builder)
+    {
+        SEARCH_FreeIndex(hlpfile);
+        return FALSE;
+    }
+    si->builder->hlpfile = hlpfile;
+    return TRUE;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_FinishIndex
+ *
+ * Turns what the builder collected into the index and writes it to the
+ * cache file.
+ */
+static BOOL SEARCH_FinishIndex(struct search_index* si)
+{
+    struct search_header*       hdr;
+    DWORD                       size = 0, written;
+    HANDLE                      hFile;
+
+    hdr = SEARCH_Build(si, &size);
+    if (!hdr) return FALSE;
+    SEARCH_FreeBuilder(si->builder);
+    si->builder = NULL;
+    SEARCH_Setup(si, hdr, size);
+    if (si->path[0])
+    {
+        hFile = CreateFileA(si->path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+        if (hFile != INVALID_HANDLE_VALUE)
+        {
+            BOOL ok = WriteFile(hFile, hdr, size, &written, NULL) && written == size;
+
+            CloseHandle(hFile);
+            if (!ok) DeleteFileA(si->path);
+            else if (SEARCH_MapCache(si, si->path, &si->key))
+                HeapFree(GetProcessHeap(), 0, hdr);
+        }
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_BuildIndex
+ *
+ * Builds (or loads from the cache) the full text index of a help file.
+ * Building stops after timeout ms with SEARCH_PENDING and goes on with
+ * the next call, so that a dialog can build the index a part at a time
+ * without blocking; INFINITE builds the whole index at once.
+ */
+enum search_state SEARCH_BuildIndex(HLPFILE* hlpfile, DWORD timeout)
+{
+    struct search_index*        si;
+
+    if (!hlpfile->search && !SEARCH_StartIndex(hlpfile)) return SEARCH_FAILED;
+    si = hlpfile->search;
+    if (!si->builder) return SEARCH_READY;
+
+    if (si->builder->page < si->key.num_pages)
+        SEARCH_AddPages(si, timeout);
+    if (si->builder->page < si->key.num_pages && !si->builder->failed)
+        return SEARCH_PENDING;
+
+    if (!SEARCH_FinishIndex(si))
+    {
+        WINE_WARN("%s: couldn't build the index\n", debugstr_a(hlpfile->lpszPath));
+        SEARCH_FreeIndex(hlpfile);
+        return SEARCH_FAILED;
+    }
+    WINE_TRACE("%s: %u pages, %u words, %u refs%s\n", debugstr_a(hlpfile->lpszPath),
+               si->header->num_pages, si->header->num_words, si->header->num_refs,
+               si->mapping ? " (mapped)" : "");
+    return SEARCH_READY;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_FindPrefix
+ *
+ * Returns the first word of the (sorted) table not below the given prefix.
+ */
+static DWORD SEARCH_FindPrefix(const struct search_index* si, const WCHAR* prefix)
+{
+    DWORD       lo = 0, hi = si->header->num_words, mid;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (wcscmp(si->text + si->word_text[mid], prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+struct search_query
+{
+    const struct search_index*  si;
+    BYTE*                       match;  /* pages matching all words so far */
+    BYTE*                       word;   /* pages matching the current word */
+    BOOL                        first;
+};
+
+static void SEARCH_QueryWord(void* cookie, const WCHAR* word, unsigned len)
+{
+    struct search_query* sq = cookie;
+    const struct search_index* si = sq->si;
+    WCHAR       prefix[SEARCH_MAX_WORD + 1];
+    DWORD       i, j, num_pages = si->header->num_pages;
+
+    memcpy(prefix, word, len * sizeof(WCHAR));
+    prefix[len] = 0;
+    memset(sq->word, 0, num_pages);
+    for (i = SEARCH_FindPrefix(si, prefix); i < si->header->num_words; i++)
+    {
+        if (wcsncmp(si->text + si->word_text[i], prefix, len)) break;
+        for (j = si->word_refs[i]; j < si->word_refs[i + 1]; j++)
+            sq->word[si->refs[j]] = 1;
+    }
+    for (i = 0; i < num_pages; i++)
+        sq->match[i] = (sq->first || sq->match[i]) && sq->word[i];
+    sq->first = FALSE;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_Query
+ *
+ * Calls cb for every page containing all the words of the query. Every
+ * word of the query is matched as a prefix, so the result can be updated
+ * while the user types. Returns FALSE if the query has no word or the
+ * index isn't built yet (see SEARCH_BuildIndex).
+ */
+BOOL SEARCH_Query(HLPFILE* hlpfile, LPCWSTR query, SEARCH_Callback cb, void* cookie)
+{
+    struct search_query sq;
+    DWORD               i, num_pages;
+
+    if (!hlpfile->search || hlpfile->search->builder) return FALSE;
+
+    sq.si = hlpfile->search;
+    num_pages = sq.si->header->num_pages;
+    sq.match = HeapAlloc(GetProcessHeap(), 0, num_pages * 2 + 2);
+    if (!sq.match) return FALSE;
+    sq.word = sq.match + num_pages + 1;
+    sq.first = TRUE;
+    SEARCH_Tokenize(query, lstrlenW(query), SEARCH_QueryWord, &sq);
+    if (!sq.first)
+    {
+        for (i = 0; i < num_pages; i++)
+            if (sq.match[i]) cb(sq.si->pages[i], cookie);
+    }
+    HeapFree(GetProcessHeap(), 0, sq.match);
+    return !sq.first;
+}
+
+/***********************************************************************
+ *
+ *           SEARCH_FreeIndex
+ */
+void SEARCH_FreeIndex(HLPFILE* hlpfile)
+{
+    struct search_index* si = hlpfile->search;
+
+    if (!si) return;
+    if (si->builder) SEARCH_FreeBuilder(si->builder);
+    if (si->mapping)
+    {
+        UnmapViewOfFile(si->header);
+        CloseHandle(si->mapping);
+    }
+    else if (si->header != &si->key)
+        HeapFree(GetProcessHeap(), 0, (void*)si->header);
+    HeapFree(GetProcessHeap(), 0, si->pages);
+    HeapFree(GetProcessHeap(), 0, si);
+    hlpfile->search = NULL;
+}
@@ -1705,6 +1705,12 @@ static INT_PTR CALLBACK WINHELP_IndexDlgProc(HWND hWnd, UINT msg, WPARAM wParam,
 	switch (((NMHDR*)lParam)->code)
 	{
 	case PSN_APPLY:
+            /* let the search page decide when it is the one shown */
+            if ((HWND)SendMessageW(GetParent(hWnd), PSM_GETCURRENTPAGEHWND, 0, 0) != hWnd)
+            {
+                SetWindowLongPtrW(hWnd, DWLP_MSGRESULT, PSNRET_NOERROR);
+                return TRUE;
+            }
             sel = SendDlgItemMessageW(hWnd, IDC_INDEXLIST, LB_GETCURSEL, 0, 0);
             if (sel != LB_ERR)
             {
@@ -1752,20 +1758,116 @@ static INT_PTR CALLBACK WINHELP_IndexDlgProc(HWND hWnd, UINT msg, WPARAM wParam,
     return FALSE;
 }
 
+/**************************************************************************
+ * cb_SearchResult
+ *
+ * SEARCH_Query callback, adds a matching topic to the result list.
+ */
+static void cb_SearchResult(HLPFILE_PAGE *page, void *cookie)
+{
+    HWND hListWnd = cookie;
+    LRESULT idx;
+
+    idx = SendMessageW(hListWnd, LB_ADDSTRING, 0,
+                       (LPARAM)(*page->lpszTitle ? page->lpszTitle : L"(untitled)"));
+    if (idx >= 0)
+        SendMessageW(hListWnd, LB_SETITEMDATA, idx, (LPARAM)page);
+}
+
+/**************************************************************************
+ * WINHELP_SearchUpdate
+ *
+ * Fills the result list of the search page, or shows that the index is
+ * still being built.
+ */
+static void WINHELP_SearchUpdate(HWND hWnd, HLPFILE *hlpfile, BOOL building)
+{
+    HWND hListWnd = GetDlgItem(hWnd, IDC_SEARCHLIST);
+    WCHAR query[256];
+
+    SendMessageW(hListWnd, WM_SETREDRAW, FALSE, 0);
+    SendMessageW(hListWnd, LB_RESETCONTENT, 0, 0);
+    if (building)
+    {
+        LoadStringW(Globals.hInstance, STID_SEARCH_BUILDING, query, ARRAY_SIZE(query));
+        SendMessageW(hListWnd, LB_ADDSTRING, 0, (LPARAM)query);
+    }
+    else
+    {
+        GetDlgItemTextW(hWnd, IDC_SEARCHTEXT, query, ARRAY_SIZE(query));
+        SEARCH_Query(hlpfile, query, cb_SearchResult, hListWnd);
+        SendMessageW(hListWnd, LB_SETCURSEL, 0, 0);
+    }
+    SendMessageW(hListWnd, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(hListWnd, NULL, TRUE);
+}
+
+/* the index is built in slices of this many ms between the messages of the dialog */
+#define SEARCH_BUILD_SLICE      50
+
 /**************************************************************************
  * WINHELP_SearchDlgProc
  *
  */
 static INT_PTR CALLBACK WINHELP_SearchDlgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
+    static struct index_data* id;
+    static BOOL building;
+    HLPFILE_PAGE *page;
+    int sel;
+
     switch (msg)
     {
     case WM_INITDIALOG:
+        id = (struct index_data*)((PROPSHEETPAGEA*)lParam)->lParam;
+        SendDlgItemMessageW(hWnd, IDC_SEARCHTEXT, EM_LIMITTEXT, 255, 0);
+        /* the index is loaded from its cache, or built from a timer the
+         * first time the page is shown, so the dialog stays responsive */
+        building = SEARCH_BuildIndex(id->hlpfile, SEARCH_BUILD_SLICE) == SEARCH_PENDING;
+        if (building)
+        {
+            SetTimer(hWnd, 1, USER_TIMER_MINIMUM, NULL);
+            WINHELP_SearchUpdate(hWnd, id->hlpfile, TRUE);
+        }
         return TRUE;
+    case WM_TIMER:
+        if (wParam == 1 && SEARCH_BuildIndex(id->hlpfile, SEARCH_BUILD_SLICE) != SEARCH_PENDING)
+        {
+            KillTimer(hWnd, 1);
+            building = FALSE;
+            WINHELP_SearchUpdate(hWnd, id->hlpfile, FALSE);
+        }
+        return TRUE;
+    case WM_DESTROY:
+        /* what was indexed so far stays with the file for the next time */
+        if (building) KillTimer(hWnd, 1);
+        building = FALSE;
+        break;
+    case WM_COMMAND:
+        switch (HIWORD(wParam))
+        {
+        case EN_CHANGE:
+            if (LOWORD(wParam) == IDC_SEARCHTEXT && !building)
+                WINHELP_SearchUpdate(hWnd, id->hlpfile, FALSE);
+            break;
+        case LBN_DBLCLK:
+            if (LOWORD(wParam) == IDC_SEARCHLIST)
+                SendMessageW(GetParent(hWnd), PSM_PRESSBUTTON, PSBTN_OK, 0);
+            break;
+        }
+        break;
     case WM_NOTIFY:
 	switch (((NMHDR*)lParam)->code)
 	{
 	case PSN_APPLY:
+            if ((HWND)SendMessageW(GetParent(hWnd), PSM_GETCURRENTPAGEHWND, 0, 0) == hWnd)
+            {
+                sel = SendDlgItemMessageW(hWnd, IDC_SEARCHLIST, LB_GETCURSEL, 0, 0);
+                page = sel != LB_ERR ?
+                    (HLPFILE_PAGE*)SendDlgItemMessageW(hWnd, IDC_SEARCHLIST, LB_GETITEMDATA, sel, 0) : NULL;
+                id->jump = page != NULL;
+                if (page) id->offset = page->offset;
+            }
             SetWindowLongPtrW(hWnd, DWLP_MSGRESULT, PSNRET_NOERROR);
             return TRUE;
         default:
@@ -2051,12 +2153,16 @@ BOOL WINHELP_CreateIndexWindow(BOOL is_search)
     struct index_data   id;
     char                buf[256];
     WCHAR               u16buf[256];
+    UINT                nPages = 0;
+    BOOL                has_index;
     if (Globals.active_win && Globals.active_win->page && Globals.active_win->page->file)
         id.hlpfile = Globals.active_win->page->file;
     else
         return FALSE;
 
-    if (id.hlpfile->xw[0].id != 'K')
+    /* the full text search page doesn't need the keyword file */
+    has_index = id.hlpfile->xw[0].id == 'K';
+    if (!has_index && !is_search)
     {
         WINE_TRACE("Missing Keyword File\n");
         return FALSE;
@@ -2070,15 +2176,18 @@ BOOL WINHELP_CreateIndexWindow(BOOL is_search)
     psp.dwFlags = 0;
     psp.hInstance = Globals.hInstance;
 
-    psp.u.pszTemplate = MAKEINTRESOURCEA(IDD_INDEX);
-    psp.lParam = (LPARAM)&id;
-    psp.pfnDlgProc = WINHELP_IndexDlgProc;
-    psPage[0] = CreatePropertySheetPageW(&psp);
+    if (has_index)
+    {
+        psp.u.pszTemplate = MAKEINTRESOURCEA(IDD_INDEX);
+        psp.lParam = (LPARAM)&id;
+        psp.pfnDlgProc = WINHELP_IndexDlgProc;
+        psPage[nPages++] = CreatePropertySheetPageW(&psp);
+    }
 
     psp.u.pszTemplate = MAKEINTRESOURCEA(IDD_SEARCH);
     psp.lParam = (LPARAM)&id;
     psp.pfnDlgProc = WINHELP_SearchDlgProc;
-    psPage[1] = CreatePropertySheetPageW(&psp);
+    psPage[nPages++] = CreatePropertySheetPageW(&psp);
 
     memset(&psHead, 0, sizeof(psHead));
     psHead.dwSize = sizeof(psHead);
@@ -2088,8 +2197,8 @@ BOOL WINHELP_CreateIndexWindow(BOOL is_search)
     MultiByteToWideChar(id.hlpfile->codepage, 0, buf, -1, u16buf, 256);
 
     psHead.pszCaption = u16buf;
-    psHead.nPages = 2;
-    psHead.u2.nStartPage = is_search ? 1 : 0;
+    psHead.nPages = nPages;
+    psHead.u2.nStartPage = is_search ? nPages - 1 : 0;
     psHead.hwndParent = Globals.active_win->hMainWnd;
     psHead.u3.phpage = psPage;
     psHead.dwFlags = PSH_NOAPPLYNOW;
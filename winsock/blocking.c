@@ -0,0 +1,361 @@
+/*
+ * Winsock 1.1 blocking calls
+ *
+ * Copyright (C) 2003 Alexandre Julliard
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Host sockets are kept non-blocking. A call on a socket that the task
+ * sees as blocking waits for readiness with the Win16 lock released and
+ * runs the task's blocking hook between waits, so other tasks keep running.
+ *
+ * A small table remembers how the task sees each socket: FIONBIO and
+ * WSAAsyncSelect change that view, never the host socket.
+ *
+ * Nothing here calls 16-bit code, so socket.c keeps the blocking hook and
+ * runs it for us.
+ */
+
+#include <stdarg.h>
+
+#include "winsock2.h"
+#include "wine/winbase16.h"
+#include "winsock16.h"
+#include "blocking.h"
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(winsock);
+
+struct socket_state
+{
+    struct socket_state *next;
+    SOCKET16 s;
+    BOOL     nonblocking;   /* FIONBIO as seen by the task */
+    BOOL     async;         /* WSAAsyncSelect is active */
+};
+
+static struct socket_state *socket_states;
+static CRITICAL_SECTION socket_cs;
+static CRITICAL_SECTION_DEBUG socket_cs_debug =
+{
+    0, 0, &socket_cs,
+    { &socket_cs_debug.ProcessLocksList, &socket_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": socket_cs") }
+};
+static CRITICAL_SECTION socket_cs = { &socket_cs_debug, -1, 0, 0, 0, 0 };
+
+__declspec(thread) static BOOL blocking_call;
+__declspec(thread) static BOOL blocking_cancelled;
+
+/* socket_cs must be held; the host socket is switched to non-blocking on first use */
+static struct socket_state *get_socket_state( SOCKET16 s )
+{
+    struct socket_state *state;
+    u_long one = 1;
+
+    for (state = socket_states; state; state = state->next)
+        if (state->s == s) return state;
+    if (ioctlsocket( s, FIONBIO, &one )) return NULL;
+    if (!(state = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*state) ))) return NULL;
+    state->s = s;
+    state->next = socket_states;
+    socket_states = state;
+    return state;
+}
+
+/* the state goes with the socket, under socket_cs so that the handle isn't reused in between */
+static INT close_socket( SOCKET16 s )
+{
+    struct socket_state **prev, *state;
+    INT ret;
+
+    EnterCriticalSection( &socket_cs );
+    if (!(ret = closesocket( s )))
+    {
+        for (prev = &socket_states; (state = *prev); prev = &state->next)
+        {
+            if (state->s != s) continue;
+            *prev = state->next;
+            HeapFree( GetProcessHeap(), 0, state );
+            break;
+        }
+    }
+    LeaveCriticalSection( &socket_cs );
+    return ret;
+}
+
+static BOOL is_blocking_socket( SOCKET16 s )
+{
+    struct socket_state *state;
+    BOOL ret;
+
+    EnterCriticalSection( &socket_cs );
+    state = get_socket_state( s );
+    ret = state && !state->nonblocking;
+    LeaveCriticalSection( &socket_cs );
+    return ret;
+}
+
+/***********************************************************************
+ *           socket_state_add
+ *
+ * Start tracking a new socket, which makes the host socket non-blocking.
+ */
+BOOL socket_state_add( SOCKET16 s )
+{
+    BOOL ret;
+
+    EnterCriticalSection( &socket_cs );
+    ret = get_socket_state( s ) != NULL;
+    LeaveCriticalSection( &socket_cs );
+    return ret;
+}
+
+/***********************************************************************
+ *           socket_state_inherit
+ *
+ * A socket returned by accept shares the properties of the listening one.
+ */
+void socket_state_inherit( SOCKET16 s, SOCKET16 listener )
+{
+    struct socket_state *from, *state;
+
+    EnterCriticalSection( &socket_cs );
+    if ((from = get_socket_state( listener )) && (state = get_socket_state( s )))
+    {
+        state->nonblocking = from->nonblocking;
+        state->async = from->async;
+    }
+    LeaveCriticalSection( &socket_cs );
+}
+
+/***********************************************************************
+ *           socket_state_set_nonblocking
+ *
+ * FIONBIO. Fails with WSAEINVAL when clearing it while WSAAsyncSelect is
+ * active.
+ */
+BOOL socket_state_set_nonblocking( SOCKET16 s, BOOL nonblocking )
+{
+    struct socket_state *state;
+    BOOL ret = FALSE;
+
+    EnterCriticalSection( &socket_cs );
+    if (!(state = get_socket_state( s )))
+        ;
+    else if (!nonblocking && state->async)
+        WSASetLastError( WSAEINVAL );
+    else
+    {
+        state->nonblocking = nonblocking;
+        ret = TRUE;
+    }
+    LeaveCriticalSection( &socket_cs );
+    return ret;
+}
+
+/***********************************************************************
+ *           socket_state_set_async
+ *
+ * WSAAsyncSelect makes the socket non-blocking.
+ */
+void socket_state_set_async( SOCKET16 s, BOOL async )
+{
+    struct socket_state *state;
+
+    EnterCriticalSection( &socket_cs );
+    if ((state = get_socket_state( s )))
+    {
+        state->async = async;
+        if (async) state->nonblocking = TRUE;
+    }
+    LeaveCriticalSection( &socket_cs );
+}
+
+/***********************************************************************
+ *           begin_blocking_call
+ *
+ * Returns FALSE with WSAEINPROGRESS if the task is already in a blocking
+ * call. *blocking tells whether the call on s may wait; INVALID_SOCKET16
+ * always may.
+ */
+BOOL begin_blocking_call( SOCKET16 s, BOOL *blocking )
+{
+    if (blocking_call)
+    {
+        WSASetLastError( WSAEINPROGRESS );
+        return FALSE;
+    }
+    *blocking = s == INVALID_SOCKET16 || is_blocking_socket( s );
+    if (*blocking)
+    {
+        blocking_call = TRUE;
+        blocking_cancelled = FALSE;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           end_blocking_call
+ */
+void end_blocking_call( BOOL blocking )
+{
+    if (blocking) blocking_call = FALSE;
+}
+
+/***********************************************************************
+ *           run_blocking_hook
+ *
+ * Run the hook until it has nothing left to do. FALSE with WSAEINTR if
+ * the hook cancelled the call.
+ */
+BOOL run_blocking_hook(void)
+{
+    while (!blocking_cancelled && call_blocking_hook());
+    if (blocking_cancelled)
+    {
+        WSASetLastError( WSAEINTR );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           wait_blocking_call
+ *
+ * Called after a failed call, returns TRUE if it should be retried.
+ * Without events there is nothing to select on, the call is retried after
+ * the poll interval.
+ */
+BOOL wait_blocking_call( SOCKET16 s, LONG events, BOOL blocking )
+{
+    fd_set read_set, write_set, except_set;
+    struct timeval timeout = { 0, BLOCKING_POLL_INTERVAL * 1000 };
+    DWORD count;
+
+    if (!blocking || WSAGetLastError() != WSAEWOULDBLOCK) return FALSE;
+
+    FD_ZERO( &read_set );
+    FD_ZERO( &write_set );
+    FD_ZERO( &except_set );
+    if (events & (FD_READ | FD_ACCEPT | FD_CLOSE)) FD_SET( s, &read_set );
+    if (events & (FD_WRITE | FD_CONNECT)) FD_SET( s, &write_set );
+    if (events & FD_CONNECT) FD_SET( s, &except_set );
+
+    ReleaseThunkLock( &count );
+    if (events) select( 0, &read_set, &write_set, &except_set, &timeout );
+    else Sleep( BLOCKING_POLL_INTERVAL );
+    RestoreThunkLock( count );
+
+    return run_blocking_hook();
+}
+
+/***********************************************************************
+ *           cancel_blocking_call
+ *
+ * WSACancelBlockingCall. The call fails with WSAEINTR once the hook
+ * returns.
+ */
+BOOL cancel_blocking_call(void)
+{
+    if (!blocking_call)
+    {
+        WSASetLastError( WSAEINVAL );
+        return FALSE;
+    }
+    blocking_cancelled = TRUE;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           in_blocking_call
+ */
+BOOL in_blocking_call(void)
+{
+    return blocking_call;
+}
+
+/***********************************************************************
+ *           blocking_recv
+ */
+INT blocking_recv( SOCKET16 s, char *buf, INT len, INT flags )
+{
+    BOOL blocking;
+    INT ret;
+
+    if (!begin_blocking_call( s, &blocking )) return SOCKET_ERROR;
+    while ((ret = recv( s, buf, len, flags )) == SOCKET_ERROR &&
+           wait_blocking_call( s, FD_READ, blocking ));
+    end_blocking_call( blocking );
+    return ret;
+}
+
+/***********************************************************************
+ *           blocking_send
+ *
+ * A blocking send returns once all the data is buffered.
+ */
+INT blocking_send( SOCKET16 s, const char *buf, INT len, INT flags )
+{
+    BOOL blocking;
+    INT ret, sent = 0;
+
+    if (!begin_blocking_call( s, &blocking )) return SOCKET_ERROR;
+    do
+    {
+        ret = send( s, buf + sent, len - sent, flags );
+        if (ret != SOCKET_ERROR) sent += ret;
+        else if (!wait_blocking_call( s, FD_WRITE, blocking )) break;
+    } while (blocking && sent < len);
+    end_blocking_call( blocking );
+    return sent || ret != SOCKET_ERROR ? sent : SOCKET_ERROR;
+}
+
+/***********************************************************************
+ *           blocking_close
+ *
+ * With SO_LINGER and a timeout, closing a non-blocking host socket fails
+ * with WSAEWOULDBLOCK while data is unsent. A blocking socket waits for it
+ * like a send, and resets the connection once the timeout is over. The
+ * state goes away with the socket; a cancelled close keeps both.
+ */
+INT blocking_close( SOCKET16 s )
+{
+    struct linger linger;
+    INT ret, len = sizeof(linger);
+    DWORD deadline = 0;
+    BOOL blocking, lingering = FALSE;
+
+    if (!begin_blocking_call( s, &blocking )) return SOCKET_ERROR;
+    if (blocking && !getsockopt( s, SOL_SOCKET, SO_LINGER, (char *)&linger, &len ) &&
+        linger.l_onoff && linger.l_linger)
+    {
+        deadline = GetTickCount() + linger.l_linger * 1000;
+        lingering = TRUE;
+    }
+    while ((ret = close_socket( s )) == SOCKET_ERROR && lingering &&
+           wait_blocking_call( s, 0, blocking ))
+    {
+        if ((LONG)(GetTickCount() - deadline) < 0) continue;
+        TRACE( "linger timeout on %04x, resetting\n", s );
+        linger.l_linger = 0;
+        setsockopt( s, SOL_SOCKET, SO_LINGER, (char *)&linger, sizeof(linger) );
+        lingering = FALSE;
+    }
+    end_blocking_call( blocking );
+    return ret;
+}
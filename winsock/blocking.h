@@ -0,0 +1,45 @@
+/*
+ * Winsock 1.1 blocking calls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINSOCK_BLOCKING_H
+#define __WINE_WINSOCK_BLOCKING_H
+
+#include "winsock16.h"
+
+#define BLOCKING_POLL_INTERVAL 50 /* ms */
+
+/* socket.c: run the task's blocking hook once, FALSE when it has nothing left to do */
+extern BOOL call_blocking_hook(void) DECLSPEC_HIDDEN;
+
+extern BOOL socket_state_add( SOCKET16 s ) DECLSPEC_HIDDEN;
+extern void socket_state_inherit( SOCKET16 s, SOCKET16 listener ) DECLSPEC_HIDDEN;
+extern BOOL socket_state_set_nonblocking( SOCKET16 s, BOOL nonblocking ) DECLSPEC_HIDDEN;
+extern void socket_state_set_async( SOCKET16 s, BOOL async ) DECLSPEC_HIDDEN;
+
+extern BOOL begin_blocking_call( SOCKET16 s, BOOL *blocking ) DECLSPEC_HIDDEN;
+extern void end_blocking_call( BOOL blocking ) DECLSPEC_HIDDEN;
+extern BOOL wait_blocking_call( SOCKET16 s, LONG events, BOOL blocking ) DECLSPEC_HIDDEN;
+extern BOOL run_blocking_hook(void) DECLSPEC_HIDDEN;
+extern BOOL cancel_blocking_call(void) DECLSPEC_HIDDEN;
+extern BOOL in_blocking_call(void) DECLSPEC_HIDDEN;
+
+extern INT blocking_recv( SOCKET16 s, char *buf, INT len, INT flags ) DECLSPEC_HIDDEN;
+extern INT blocking_send( SOCKET16 s, const char *buf, INT len, INT flags ) DECLSPEC_HIDDEN;
+extern INT blocking_close( SOCKET16 s ) DECLSPEC_HIDDEN;
+
+#endif /* __WINE_WINSOCK_BLOCKING_H */
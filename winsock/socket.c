@@ -24,6 +24,7 @@
 #include "winsock2.h"
 #include "wine/winbase16.h"
 #include "winsock16.h"
+#include "blocking.h"
 #include "wownt32.h"
 #include "winuser.h"
 #include "wine/debug.h"
@@ -113,6 +114,22 @@ static DWORD finish_query( struct async_query_header *query, LPARAM lparam )
     return 0;
 }
 
+__declspec(thread) static FARPROC16 blocking_hook;  /* NULL for the default hook */
+
+INT16 WINAPI default_hook(void);
+
+BOOL call_blocking_hook(void)
+{
+    PVOID sssp;
+    DWORD ret;
+
+    if (!blocking_hook) return default_hook();
+    sssp = getWOW32Reserved();
+    WOWCallback16Ex( (DWORD)blocking_hook, WCB16_PASCAL, 0, NULL, &ret );
+    setWOW32Reserved( sssp );
+    return LOWORD(ret);
+}
+
 static int list_size(char** l, int item_size)
 {
     int i,j = 0;
@@ -450,9 +467,16 @@ SOCKET16 WINAPI accept16(SOCKET16 s, struct sockaddr* addr, INT16* addrlen16 )
     // Passing in a value of zero in addrlen32 will cause error WSAEFAULT
     // As a fix, set addrlen32 to size of a local sockaddr structure and pass this too. Copy the returned contents to addr if necessary.
 
-    SOCKET retSocket = accept( s, &addr32, &addrlen32 );
+    SOCKET retSocket;
+    BOOL blocking;
+
+    if (!begin_blocking_call( s, &blocking )) return INVALID_SOCKET16;
+    while ((retSocket = accept( s, &addr32, &addrlen32 )) == INVALID_SOCKET &&
+           wait_blocking_call( s, FD_ACCEPT, blocking ));
+    end_blocking_call( blocking );
     if( addrlen16 ) *addrlen16 = addrlen32;
     if (retSocket != INVALID_SOCKET && addr) memcpy(addr, &addr32, addrlen32);
+    if (retSocket != INVALID_SOCKET) socket_state_inherit( retSocket, s );
     return retSocket;
 }
 
@@ -469,7 +493,7 @@ INT16 WINAPI bind16(SOCKET16 s, struct sockaddr *name, INT16 namelen)
  */
 INT16 WINAPI closesocket16(SOCKET16 s)
 {
-    return closesocket(s);
+    return blocking_close( s );
 }
 
 /***********************************************************************
@@ -477,7 +501,39 @@ INT16 WINAPI closesocket16(SOCKET16 s)
  */
 INT16 WINAPI connect16(SOCKET16 s, struct sockaddr *name, INT16 namelen)
 {
-    return connect( s, name, namelen );
+    BOOL blocking;
+    INT ret, error, len = sizeof(error);
+
+    if (!begin_blocking_call( s, &blocking )) return SOCKET_ERROR;
+    ret = connect( s, name, namelen );
+    if (ret == SOCKET_ERROR && wait_blocking_call( s, FD_CONNECT, blocking ))
+    {
+        fd_set write_set, except_set;
+        struct timeval timeout = { 0, 0 };
+
+        /* wait until the connection is established or refused */
+        while (TRUE)
+        {
+            FD_ZERO( &write_set );
+            FD_ZERO( &except_set );
+            FD_SET( s, &write_set );
+            FD_SET( s, &except_set );
+            if (select( 0, NULL, &write_set, &except_set, &timeout ) > 0)
+            {
+                if (getsockopt( s, SOL_SOCKET, SO_ERROR, (char *)&error, &len ))
+                    ; /* keep the getsockopt error */
+                else if (error)
+                    WSASetLastError( error );
+                else
+                    ret = 0;
+                break;
+            }
+            WSASetLastError( WSAEWOULDBLOCK );
+            if (!wait_blocking_call( s, FD_CONNECT, blocking )) break;
+        }
+    }
+    end_blocking_call( blocking );
+    return ret;
 }
 
 /***********************************************************************
@@ -566,7 +622,14 @@ SEGPTR WINAPI inet_ntoa16(struct in_addr in)
  */
 INT16 WINAPI ioctlsocket16(SOCKET16 s, LONG cmd, u_long *argp)
 {
-    return ioctlsocket( s, cmd, argp );
+    if (cmd != FIONBIO) return ioctlsocket( s, cmd, argp );
+    if (!argp)
+    {
+        WSASetLastError( WSAEFAULT );
+        return SOCKET_ERROR;
+    }
+    /* the host socket stays non-blocking, only the task's view changes */
+    return socket_state_set_nonblocking( s, *argp != 0 ) ? 0 : SOCKET_ERROR;
 }
 
 /***********************************************************************
@@ -599,7 +662,7 @@ u_short WINAPI ntohs16(u_short netshort)
  */
 INT16 WINAPI recv16(SOCKET16 s, char *buf, INT16 len, INT16 flags)
 {
-    return recv( s, buf, len, flags );
+    return blocking_recv( s, buf, len, flags );
 }
 
 /***********************************************************************
@@ -608,14 +671,16 @@ INT16 WINAPI recv16(SOCKET16 s, char *buf, INT16 len, INT16 flags)
 INT16 WINAPI recvfrom16(SOCKET16 s, char *buf, INT16 len, INT16 flags,
                         struct sockaddr *from, INT16 *fromlen16)
 {
-    if (fromlen16)
-    {
-        INT fromlen32 = *fromlen16;
-        INT retVal = recvfrom( s, buf, len, flags, from, &fromlen32 );
-        *fromlen16 = fromlen32;
-        return retVal;
-    }
-    else return recvfrom( s, buf, len, flags, from, NULL );
+    INT fromlen32 = fromlen16 ? *fromlen16 : 0;
+    BOOL blocking;
+    INT retVal;
+
+    if (!begin_blocking_call( s, &blocking )) return SOCKET_ERROR;
+    while ((retVal = recvfrom( s, buf, len, flags, from, fromlen16 ? &fromlen32 : NULL )) == SOCKET_ERROR &&
+           wait_blocking_call( s, FD_READ, blocking ));
+    end_blocking_call( blocking );
+    if (fromlen16) *fromlen16 = fromlen32;
+    return retVal;
 }
 
 /***********************************************************************
@@ -627,13 +692,35 @@ INT16 WINAPI select16(INT16 nfds, ws_fd_set16 *ws_readfds,
 {
     fd_set read_set, write_set, except_set;
     fd_set *pread_set = NULL, *pwrite_set = NULL, *pexcept_set = NULL;
+    DWORD start = GetTickCount(), wait = INFINITE, elapsed, count;
+    BOOL blocking;
     int ret;
 
-    if (ws_readfds) pread_set = ws_fdset_16_to_32( ws_readfds, &read_set );
-    if (ws_writefds) pwrite_set = ws_fdset_16_to_32( ws_writefds, &write_set );
-    if (ws_exceptfds) pexcept_set = ws_fdset_16_to_32( ws_exceptfds, &except_set );
     /* struct timeval is the same for both 32- and 16-bit code */
-    ret = select( nfds, pread_set, pwrite_set, pexcept_set, timeout );
+    if (timeout) wait = timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
+    if (!begin_blocking_call( INVALID_SOCKET16, &blocking )) return SOCKET_ERROR;
+    while (TRUE)
+    {
+        struct timeval slice = { 0, 0 };
+
+        elapsed = GetTickCount() - start;
+        if (elapsed < wait)
+            slice.tv_usec = min( wait - elapsed, BLOCKING_POLL_INTERVAL ) * 1000;
+        if (ws_readfds) pread_set = ws_fdset_16_to_32( ws_readfds, &read_set );
+        if (ws_writefds) pwrite_set = ws_fdset_16_to_32( ws_writefds, &write_set );
+        if (ws_exceptfds) pexcept_set = ws_fdset_16_to_32( ws_exceptfds, &except_set );
+        ReleaseThunkLock( &count );
+        ret = select( nfds, pread_set, pwrite_set, pexcept_set, &slice );
+        RestoreThunkLock( count );
+        if (ret || elapsed >= wait) break;
+
+        if (!run_blocking_hook())
+        {
+            ret = SOCKET_ERROR;
+            break;
+        }
+    }
+    end_blocking_call( blocking );
     if (ws_readfds) ws_fdset_32_to_16( &read_set, ws_readfds );
     if (ws_writefds) ws_fdset_32_to_16( &write_set, ws_writefds );
     if (ws_exceptfds) ws_fdset_32_to_16( &except_set, ws_exceptfds );
@@ -645,7 +732,7 @@ INT16 WINAPI select16(INT16 nfds, ws_fd_set16 *ws_readfds,
  */
 INT16 WINAPI send16(SOCKET16 s, char *buf, INT16 len, INT16 flags)
 {
-    return send( s, buf, len, flags );
+    return blocking_send( s, buf, len, flags );
 }
 
 /***********************************************************************
@@ -654,7 +741,14 @@ INT16 WINAPI send16(SOCKET16 s, char *buf, INT16 len, INT16 flags)
 INT16 WINAPI sendto16(SOCKET16 s, char *buf, INT16 len, INT16 flags,
                       struct sockaddr *to, INT16 tolen)
 {
-    return sendto( s, buf, len, flags, to, tolen );
+    BOOL blocking;
+    INT ret;
+
+    if (!begin_blocking_call( s, &blocking )) return SOCKET_ERROR;
+    while ((ret = sendto( s, buf, len, flags, to, tolen )) == SOCKET_ERROR &&
+           wait_blocking_call( s, FD_WRITE, blocking ));
+    end_blocking_call( blocking );
+    return ret;
 }
 
 /***********************************************************************
@@ -680,7 +774,10 @@ INT16 WINAPI shutdown16(SOCKET16 s, INT16 how)
  */
 SOCKET16 WINAPI socket16(INT16 af, INT16 type, INT16 protocol)
 {
-    return socket( af, type, protocol );
+    SOCKET s = socket( af, type, protocol );
+
+    if (s != INVALID_SOCKET) socket_state_add( s );
+    return s;
 }
 
 /***********************************************************************
@@ -763,7 +860,10 @@ INT16 WINAPI gethostname16(char *name, INT16 namelen)
  */
 INT16 WINAPI WSAAsyncSelect16(SOCKET16 s, HWND16 hWnd, UINT16 wMsg, LONG lEvent)
 {
-    return WSAAsyncSelect( s, HWND_32(hWnd), wMsg, lEvent );
+    INT ret = WSAAsyncSelect( s, HWND_32(hWnd), wMsg, lEvent );
+
+    if (!ret) socket_state_set_async( s, lEvent != 0 );
+    return ret;
 }
 
 /***********************************************************************
@@ -904,21 +1004,27 @@ INT16 WINAPI WSACancelAsyncRequest16(HANDLE16 hAsyncTaskHandle)
     return 0;
 }
 
-__declspec(thread) static FARPROC16 first_hook;
-__declspec(thread) static DWORD (WINAPI *win32_hook)() = NULL;
-
-INT16 WINAPI default_hook()
+/***********************************************************************
+ *      default_hook			(WINSOCK.2000)
+ *
+ * The Winsock 1.1 default blocking hook.
+ */
+INT16 WINAPI default_hook(void)
 {
-    return win32_hook();
+    MSG msg;
+
+    if (!PeekMessageA( &msg, NULL, 0, 0, PM_REMOVE )) return FALSE;
+    TranslateMessage( &msg );
+    DispatchMessageA( &msg );
+    return TRUE;
 }
 
-DWORD WINAPI thunk_hook()
+static FARPROC16 get_default_hook16(void)
 {
-    PVOID sssp = getWOW32Reserved();
-    DWORD ret;
-    WOWCallback16Ex(first_hook, WCB16_PASCAL, 0, NULL, &ret);
-    setWOW32Reserved(sssp);
-    return LOWORD(ret);
+    static FARPROC16 default_hook16;
+    if (!default_hook16)
+        default_hook16 = GetProcAddress16( GetModuleHandle16("WINSOCK"), "DEFAULT_HOOK" );
+    return default_hook16;
 }
 
 /***********************************************************************
@@ -926,22 +1032,14 @@ DWORD WINAPI thunk_hook()
  */
 FARPROC16 WINAPI WSASetBlockingHook16(FARPROC16 lpBlockFunc)
 {
-    static FARPROC16 default_hook = NULL;
-    if (!default_hook)
-        default_hook = GetProcAddress16(GetModuleHandle16("WINSOCK"), "DEFAULT_HOOK");
-    if (!win32_hook)
-    {
-        win32_hook = WSASetBlockingHook(thunk_hook);
-        first_hook = default_hook;
-    }
-    if (lpBlockFunc == default_hook)
+    FARPROC16 old_hook = blocking_hook ? blocking_hook : get_default_hook16();
+
+    if (in_blocking_call())
     {
-        WSASetBlockingHook(win32_hook);
-        win32_hook = NULL;
-        return 0;
+        WSASetLastError( WSAEINPROGRESS );
+        return NULL;
     }
-    FARPROC16 old_hook = first_hook;
-    first_hook = lpBlockFunc;
+    blocking_hook = lpBlockFunc == get_default_hook16() ? NULL : lpBlockFunc;
     return old_hook;
 }
 
@@ -950,8 +1048,13 @@ FARPROC16 WINAPI WSASetBlockingHook16(FARPROC16 lpBlockFunc)
  */
 INT16 WINAPI WSAUnhookBlockingHook16(void)
 {
-    win32_hook = NULL;
-    return WSAUnhookBlockingHook();
+    if (in_blocking_call())
+    {
+        WSASetLastError( WSAEINPROGRESS );
+        return SOCKET_ERROR;
+    }
+    blocking_hook = NULL;
+    return 0;
 }
 
 /***********************************************************************
@@ -975,7 +1078,7 @@ void WINAPI WSASetLastError16(INT16 iError)
  */
 INT WINAPI WSACancelBlockingCall16(void)
 {
-    return WSACancelBlockingCall();
+    return cancel_blocking_call() ? 0 : SOCKET_ERROR;
 }
 
 /***********************************************************************
@@ -983,7 +1086,7 @@ INT WINAPI WSACancelBlockingCall16(void)
  */
 BOOL WINAPI WSAIsBlocking16(void)
 {
-    return WSAIsBlocking();
+    return in_blocking_call();
 }
 
 /***********************************************************************
@@ -36,7 +36,7 @@
 106 pascal -ret16 WSAAsyncGetServByPort(word word word str segptr word) WSAAsyncGetServByPort16
 107 pascal -ret16 WSAAsyncGetServByName(word word str str segptr word) WSAAsyncGetServByName16
 108 pascal -ret16 WSACancelAsyncRequest(word) WSACancelAsyncRequest16
-109 pascal -ret16 WSASetBlockingHook(segptr) WSASetBlockingHook16
+109 pascal WSASetBlockingHook(segptr) WSASetBlockingHook16
 110 pascal -ret16 WSAUnhookBlockingHook() WSAUnhookBlockingHook16
 111 pascal -ret16 WSAGetLastError() WSAGetLastError16
 112 pascal   WSASetLastError(word) WSASetLastError16